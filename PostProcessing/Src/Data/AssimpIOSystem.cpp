@@ -0,0 +1,51 @@
+//--------------------------------------------------------------------------------------
+// Assimp file system serving files from CFileCache
+//--------------------------------------------------------------------------------------
+
+#include "AssimpIOSystem.h"
+
+#include <algorithm>
+#include <cstring>
+
+//Read whole items, as fread does, returning the number read
+size_t CAssimpIOStream::Read(void* buffer, size_t size, size_t count)
+{
+	if (size == 0 || count == 0) return 0;
+
+	size_t available = m_File->contents.size - m_Position;
+	size_t items = std::min(count, available / size);
+	size_t bytes = items * size;
+
+	memcpy(buffer, m_File->contents.data + m_Position, bytes);
+	m_Position += bytes;
+	m_Cache.CountRead(bytes);
+	return items;
+}
+
+//Move the read position. Offsets from the end are given as positive distances back from it
+aiReturn CAssimpIOStream::Seek(size_t offset, aiOrigin origin)
+{
+	size_t size = m_File->contents.size;
+	size_t position;
+	switch (origin)
+	{
+	case aiOrigin_SET: position = offset; break;
+	case aiOrigin_CUR: position = m_Position + offset; break;
+	case aiOrigin_END: if (offset > size) return aiReturn_FAILURE; position = size - offset; break;
+	default:           return aiReturn_FAILURE;
+	}
+
+	if (position > size) return aiReturn_FAILURE;
+	m_Position = position;
+	return aiReturn_SUCCESS;
+}
+
+//Open a file for reading
+Assimp::IOStream* CAssimpIOSystem::Open(const char* fileName, const char* mode)
+{
+	if (strchr(mode, 'w') || strchr(mode, 'a')) return nullptr;
+
+	std::shared_ptr<const CachedFile> file = m_Cache.Open(fileName);
+	if (!file) return nullptr;
+	return new CAssimpIOStream(m_Cache, std::move(file));
+}
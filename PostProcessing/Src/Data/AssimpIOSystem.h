@@ -0,0 +1,48 @@
+//--------------------------------------------------------------------------------------
+// Assimp file system serving files from CFileCache
+//--------------------------------------------------------------------------------------
+// By default assimp opens files through stdio, reading each one in small buffered chunks and
+// opening it again for every check it makes. Given to an importer (see Mesh.cpp), this class
+// serves the whole file from memory instead - mapped, packed or preloaded - so an import makes
+// at most one trip to the operating system per file, shared with the resource manager.
+// Read-only: opening a file for writing fails.
+#pragma once
+#include <assimp/IOSystem.hpp>
+#include <assimp/IOStream.hpp>
+#include <memory>
+
+#include "Utility/CFileCache.h"
+
+//Stream reading a file held in the cache
+class CAssimpIOStream : public Assimp::IOStream
+{
+public:
+	CAssimpIOStream(CFileCache& cache, std::shared_ptr<const CachedFile> file) : m_Cache(cache), m_File(std::move(file)) {}
+
+	size_t   Read(void* buffer, size_t size, size_t count) override;
+	size_t   Write(const void* buffer, size_t size, size_t count) override { return 0; }
+	aiReturn Seek(size_t offset, aiOrigin origin) override;
+	size_t   Tell() const override { return m_Position; }
+	size_t   FileSize() const override { return m_File->contents.size; }
+	void     Flush() override {}
+
+private:
+	CFileCache&                       m_Cache;
+	std::shared_ptr<const CachedFile> m_File;
+	size_t                            m_Position = 0;
+};
+
+//File system for an importer. The importer deletes it, the cache must outlive the importer
+class CAssimpIOSystem : public Assimp::IOSystem
+{
+public:
+	explicit CAssimpIOSystem(CFileCache& cache) : m_Cache(cache) {}
+
+	bool              Exists(const char* fileName) const override { return m_Cache.Exists(fileName); }
+	char              getOsSeparator() const override { return '/'; } // Accepted on Windows too, and what pack names use
+	Assimp::IOStream* Open(const char* fileName, const char* mode = "rb") override;
+	void              Close(Assimp::IOStream* file) override { delete file; }
+
+private:
+	CFileCache& m_Cache;
+};
@@ -0,0 +1,74 @@
+//--------------------------------------------------------------------------------------
+// Class gathering models that share a mesh and material into instanced batches
+//--------------------------------------------------------------------------------------
+
+#include "InstanceBatcher.h"
+
+#include <algorithm>
+
+//Remove all instances and batches, ready for the next frame. Keeps allocated memory
+void CInstanceBatcher::Clear()
+{
+	m_Pending.clear();
+	m_Instances.clear();
+	m_Batches.clear();
+	m_Stats = InstanceStats();
+}
+
+//Add a model to be rendered using the given mesh and texture, unless its mesh cannot be instanced
+bool CInstanceBatcher::Add(Mesh* mesh, ID3D11ShaderResourceView* texture, const CMatrix4x4& worldMatrix, const CVector3& tintColour,
+                           bool supportsInstancing)
+{
+	if (!supportsInstancing)
+	{
+		++m_Stats.instancesRejected;
+		return false;
+	}
+
+	PendingInstance instance;
+	instance.mesh = mesh;
+	instance.texture = texture;
+	instance.data.worldMatrix = worldMatrix;
+	instance.data.tintColour = tintColour;
+	instance.data.padding = 0.0f;
+	m_Pending.push_back(instance);
+	return true;
+}
+
+//Group the instances added since the last Clear() into batches sharing a mesh and texture
+void CInstanceBatcher::Build()
+{
+	m_Instances.clear();
+	m_Batches.clear();
+
+	//Sort by mesh then texture so instances sharing both end up next to each other.
+	//A stable sort keeps instances in the order they were added within each batch
+	std::stable_sort(m_Pending.begin(), m_Pending.end(), [](const PendingInstance& a, const PendingInstance& b)
+	{
+		if (a.mesh != b.mesh) return a.mesh < b.mesh;
+		return a.texture < b.texture;
+	});
+
+	m_Instances.reserve(m_Pending.size());
+	for (auto& instance : m_Pending)
+	{
+		//Start a new batch whenever the mesh or texture changes
+		if (m_Batches.empty() || m_Batches.back().mesh != instance.mesh || m_Batches.back().texture != instance.texture)
+		{
+			InstanceBatch batch;
+			batch.mesh = instance.mesh;
+			batch.texture = instance.texture;
+			batch.firstInstance = static_cast<unsigned int>(m_Instances.size());
+			batch.instanceCount = 0;
+			m_Batches.push_back(batch);
+		}
+
+		m_Instances.push_back(instance.data);
+		++m_Batches.back().instanceCount;
+	}
+
+	//Without instancing every model would be its own draw call
+	m_Stats.instancesSubmitted = static_cast<unsigned int>(m_Pending.size());
+	m_Stats.drawCalls = static_cast<unsigned int>(m_Batches.size());
+	m_Stats.drawCallsSaved = m_Stats.instancesSubmitted - m_Stats.drawCalls;
+}
@@ -0,0 +1,92 @@
+//--------------------------------------------------------------------------------------
+// Class gathering models that share a mesh and material into instanced batches
+//--------------------------------------------------------------------------------------
+// Models are added one at a time with their world matrix and tint colour. Build() then
+// groups them by mesh and texture so each group can be drawn with one DrawIndexedInstanced.
+// Models whose mesh cannot be instanced are refused, for the caller to render on their own.
+// This class does no rendering and never touches the device - the mesh and texture pointers
+// are only used as keys - so the batching logic can be exercised entirely on the CPU.
+// See InstancedRenderer.h for the class that uploads and draws the batches.
+#pragma once
+#include "Math/CVector3.h"
+#include "Math/CMatrix4x4.h"
+
+#include <vector>
+
+class Mesh;
+struct ID3D11ShaderResourceView;
+
+//Per-instance data sent to the GPU in the instance buffer - must match the InstancedVertex structure in Common.hlsli
+struct InstanceData
+{
+	CMatrix4x4 worldMatrix;
+	CVector3   tintColour;
+	float      padding;
+};
+
+//A run of instances in the instance buffer that all use the same mesh and texture
+struct InstanceBatch
+{
+	Mesh*                     mesh;
+	ID3D11ShaderResourceView* texture;
+	unsigned int              firstInstance;
+	unsigned int              instanceCount;
+};
+
+//Counters describing the last call to Build()
+struct InstanceStats
+{
+	unsigned int instancesSubmitted = 0; // Number of models added since the last Clear()
+	unsigned int instancesRejected  = 0; // Number of models refused by Add() as their mesh cannot be instanced
+	unsigned int drawCalls          = 0; // Number of draw calls needed to render them (one per batch)
+	unsigned int drawCallsSaved     = 0; // Draw calls that would have been issued without instancing minus the above
+};
+
+class CInstanceBatcher
+{
+//----------------------//
+// Construction / Usage	//
+//----------------------//
+public:
+	//Remove all instances and batches, ready for the next frame. Keeps allocated memory
+	void Clear();
+
+	//Add a model to be rendered using the given mesh and texture. supportsInstancing is the mesh's Mesh::SupportsInstancing(),
+	//passed in so the batcher never needs the mesh itself. Returns false without adding the model if it is false
+	bool Add(Mesh* mesh, ID3D11ShaderResourceView* texture, const CMatrix4x4& worldMatrix, const CVector3& tintColour,
+	         bool supportsInstancing);
+
+	//Group the instances added since the last Clear() into batches sharing a mesh and texture.
+	//Instances in a batch keep the order in which they were added
+	void Build();
+
+	//-------------------------------------
+	// Data access
+	//-------------------------------------
+
+	//Instance data ordered by batch, ready to copy into an instance buffer. Valid after Build()
+	const std::vector<InstanceData>& GetInstances() const { return m_Instances; }
+
+	//Batches referring to ranges of the instance data above. Valid after Build()
+	const std::vector<InstanceBatch>& GetBatches() const { return m_Batches; }
+
+	//Counters for the last call to Build()
+	const InstanceStats& GetStats() const { return m_Stats; }
+
+//-------------//
+// Member data //
+//-------------//
+private:
+	//An instance as it was added, before it is sorted into a batch
+	struct PendingInstance
+	{
+		Mesh*                     mesh;
+		ID3D11ShaderResourceView* texture;
+		InstanceData              data;
+	};
+
+	std::vector<PendingInstance> m_Pending;
+	std::vector<InstanceData>    m_Instances;
+	std::vector<InstanceBatch>   m_Batches;
+	InstanceStats                m_Stats;
+};
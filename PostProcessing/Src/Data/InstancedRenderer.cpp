@@ -0,0 +1,90 @@
+//--------------------------------------------------------------------------------------
+// Class drawing the batches built by CInstanceBatcher
+//--------------------------------------------------------------------------------------
+
+#include "InstancedRenderer.h"
+#include "Mesh.h"
+#include "project/Common.h"
+
+#include <algorithm>
+#include <cstring>
+
+//Constructor
+CInstancedRenderer::CInstancedRenderer()
+{
+	m_InstanceBuffer = nullptr;
+	m_Capacity = 0;
+}
+
+//Destructor
+CInstancedRenderer::~CInstancedRenderer()
+{
+	Release();
+}
+
+//Create the instance buffer with room for the given number of instances
+bool CInstancedRenderer::Initialise(unsigned int capacity)
+{
+	return CreateInstanceBuffer(capacity);
+}
+
+//Upload the batcher's instances and draw each batch
+void CInstancedRenderer::Render(const CInstanceBatcher& batcher, UINT textureSlot)
+{
+	auto& instances = batcher.GetInstances();
+	if (instances.empty()) return;
+
+	//Grow the instance buffer if this frame has more instances than it can hold
+	if (instances.size() > m_Capacity)
+	{
+		if (!CreateInstanceBuffer(std::max(static_cast<unsigned int>(instances.size()), m_Capacity * 2))) return;
+	}
+
+	//Copy all instances over to the GPU in one go
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(gD3DContext->Map(m_InstanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) return;
+	memcpy(mapped.pData, instances.data(), instances.size() * sizeof(InstanceData));
+	gD3DContext->Unmap(m_InstanceBuffer, 0);
+
+	//One draw call per batch
+	for (auto& batch : batcher.GetBatches())
+	{
+		ID3D11ShaderResourceView* texture = batch.texture;
+		gD3DContext->PSSetShaderResources(textureSlot, 1, &texture);
+		batch.mesh->RenderInstanced(m_InstanceBuffer, sizeof(InstanceData), batch.firstInstance, batch.instanceCount);
+	}
+}
+
+//Release the instance buffer
+void CInstancedRenderer::Release()
+{
+	if (m_InstanceBuffer)
+	{
+		m_InstanceBuffer->Release();
+		m_InstanceBuffer = nullptr;
+	}
+	m_Capacity = 0;
+}
+
+//Recreate the instance buffer with a new capacity
+bool CInstancedRenderer::CreateInstanceBuffer(unsigned int capacity)
+{
+	Release();
+
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;      // Instance data is read as a second vertex stream
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;               // Rewritten every frame
+	bufferDesc.ByteWidth = capacity * sizeof(InstanceData);
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+
+	if (FAILED(gD3DDevice->CreateBuffer(&bufferDesc, nullptr, &m_InstanceBuffer)))
+	{
+		m_InstanceBuffer = nullptr;
+		return false;
+	}
+
+	m_Capacity = capacity;
+	return true;
+}
@@ -0,0 +1,44 @@
+//--------------------------------------------------------------------------------------
+// Class drawing the batches built by CInstanceBatcher
+//--------------------------------------------------------------------------------------
+// Owns a dynamic instance buffer that the instance data is copied into each frame, then
+// issues one DrawIndexedInstanced per batch. Shaders, states and samplers must be set
+// beforehand (see InstancedTransform_vs.hlsl / InstancedTintedTexture_ps.hlsl).
+#pragma once
+#include "InstanceBatcher.h"
+
+#include <d3d11.h>
+
+class CInstancedRenderer
+{
+//----------------------//
+// Construction / Usage	//
+//----------------------//
+public:
+	CInstancedRenderer();
+	~CInstancedRenderer();
+
+	//Create the instance buffer with room for the given number of instances. Returns false on failure
+	bool Initialise(unsigned int capacity);
+
+	//Upload the batcher's instances and draw each batch, setting the batch's texture into the given pixel shader slot.
+	//The batcher only accepts meshes that support instancing (see Mesh::SupportsInstancing)
+	void Render(const CInstanceBatcher& batcher, UINT textureSlot);
+
+	//Release the instance buffer
+	void Release();
+
+//--------------------------//
+// Private helper functions	//
+//--------------------------//
+private:
+	//Recreate the instance buffer with a new capacity. Returns false on failure
+	bool CreateInstanceBuffer(unsigned int capacity);
+
+//-------------//
+// Member data //
+//-------------//
+private:
+	ID3D11Buffer* m_InstanceBuffer;
+	unsigned int  m_Capacity;
+};
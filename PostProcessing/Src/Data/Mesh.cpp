@@ -10,21 +10,52 @@
 #include "Utility/GraphicsHelpers.h" // Helper functions to unclutter the code here
 #include "Math/CVector2.h" 
 #include "Math/CVector3.h" 
+#include "AssimpIOSystem.h" // Serves files to assimp from the file cache
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include <assimp/DefaultLogger.hpp>
 
+#include <algorithm>
 #include <memory>
+#include <mutex>
+
+
+// Assimp's logger is a single global object, but meshes can be loaded on several threads at once (see CResourceManager).
+// The first import to start creates the logger and the last to finish destroys it, so no import has it killed mid-load
+namespace
+{
+	std::mutex gLoggerMutex;
+	int gLoggerUsers = 0;
+
+	struct ScopedAssimpLogger
+	{
+		ScopedAssimpLogger()
+		{
+			std::lock_guard<std::mutex> lock(gLoggerMutex);
+			if (gLoggerUsers++ == 0)  Assimp::DefaultLogger::create("", Assimp::DefaultLogger::VERBOSE);
+		}
+		~ScopedAssimpLogger()
+		{
+			std::lock_guard<std::mutex> lock(gLoggerMutex);
+			if (--gLoggerUsers == 0)  Assimp::DefaultLogger::kill();
+		}
+	};
+}
 
 
 // Pass the name of the mesh file to load. Uses assimp (http://www.assimp.org/) to support many file types
 // Optionally request tangents to be calculated (for normal and parallax mapping - see later lab)
 // Will throw a std::runtime_error exception on failure (since constructors can't return errors).
-Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
+// Pass a file cache to read the file through the cache rather than stdio
+Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/, CFileCache* fileCache /*= nullptr*/)
 {
 	Assimp::Importer importer;
+	if (fileCache != nullptr)
+	{
+		importer.SetIOHandler(new CAssimpIOSystem(*fileCache)); // The importer deletes it
+	}
 
 	// Flags for processing the mesh. Assimp provides a huge amount of control - right click any of these
 	// and "Peek Definition" to see documention above each constant
@@ -78,9 +109,11 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
 	importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, removeComponents);
 
 	// Import mesh with assimp given above requirements - log output
-	Assimp::DefaultLogger::create("", Assimp::DefaultLogger::VERBOSE);
-	const aiScene* scene = importer.ReadFile(fileName, assimpFlags);
-	Assimp::DefaultLogger::kill();
+	const aiScene* scene;
+	{
+		ScopedAssimpLogger logger;
+		scene = importer.ReadFile(fileName, assimpFlags);
+	}
 	if (scene == nullptr)  throw std::runtime_error("Error loading mesh (" + fileName + "). " + importer.GetErrorString());
 	if (scene->mNumMeshes == 0)  throw std::runtime_error("No usable geometry in mesh: " + fileName);
 
@@ -166,6 +199,25 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
 		if (shaderSignature)  shaderSignature->Release();
 		if (FAILED(hr))  throw std::runtime_error("Failure creating input layout for " + fileName);
 
+		// Meshes without bones also get a layout for instanced rendering. The per-instance world matrix (as four rows)
+		// and tint colour are read from a second vertex buffer - must match InstanceData in InstanceBatcher.h
+		if (!mHasBones)
+		{
+			std::vector<D3D11_INPUT_ELEMENT_DESC> instancedElements = vertexElements;
+			instancedElements.push_back({ "instanceWorld" , 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1,  0, D3D11_INPUT_PER_INSTANCE_DATA, 1 });
+			instancedElements.push_back({ "instanceWorld" , 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 });
+			instancedElements.push_back({ "instanceWorld" , 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 });
+			instancedElements.push_back({ "instanceWorld" , 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 });
+			instancedElements.push_back({ "instanceColour", 0, DXGI_FORMAT_R32G32B32_FLOAT,    1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1 });
+
+			auto instancedSignature = CreateSignatureForVertexLayout(instancedElements.data(), static_cast<int>(instancedElements.size()));
+			hr = gD3DDevice->CreateInputLayout(instancedElements.data(), static_cast<UINT>(instancedElements.size()),
+				instancedSignature->GetBufferPointer(), instancedSignature->GetBufferSize(),
+				&subMesh.instancedVertexLayout);
+			if (instancedSignature)  instancedSignature->Release();
+			if (FAILED(hr))  throw std::runtime_error("Failure creating instanced input layout for " + fileName);
+		}
+
 
 
 		//-----------------------------------
@@ -188,6 +240,7 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
 		while (position != positionEnd)
 		{
 			*(CVector3*)position = *assimpPosition;
+			mBoundingRadius = std::max(mBoundingRadius, Length(*assimpPosition));
 			position += subMesh.vertexSize;
 			++assimpPosition;
 		}
@@ -220,12 +273,17 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
 			aiVector3D* assimpUV = assimpMesh->mTextureCoords[0];
 			unsigned char* uv = vertices.get() + uvOffset;
 			unsigned char* uvEnd = uv + subMesh.numVertices * subMesh.vertexSize;
+			CVector2 uvMin = { assimpUV->x, assimpUV->y };
+			CVector2 uvMax = uvMin;
 			while (uv != uvEnd)
 			{
 				*(CVector2*)uv = CVector2(assimpUV->x, assimpUV->y);
+				uvMin = { std::min(uvMin.x, assimpUV->x), std::min(uvMin.y, assimpUV->y) };
+				uvMax = { std::max(uvMax.x, assimpUV->x), std::max(uvMax.y, assimpUV->y) };
 				uv += subMesh.vertexSize;
 				++assimpUV;
 			}
+			mTextureRepeat = std::max({ mTextureRepeat, uvMax.x - uvMin.x, uvMax.y - uvMin.y });
 		}
 
 
@@ -367,6 +425,7 @@ Mesh::~Mesh()
 		if (subMesh.indexBuffer)   subMesh.indexBuffer ->Release();
 		if (subMesh.vertexBuffer)  subMesh.vertexBuffer->Release();
 		if (subMesh.vertexLayout)  subMesh.vertexLayout->Release();
+		if (subMesh.instancedVertexLayout)  subMesh.instancedVertexLayout->Release();
 	}
 }
 
@@ -395,6 +454,28 @@ void Mesh::RenderSubMesh(const SubMesh& subMesh)
 }
 
 
+// Helper function for RenderInstanced function - renders several instances of a given sub-mesh
+void Mesh::RenderSubMeshInstanced(const SubMesh& subMesh, ID3D11Buffer* instanceBuffer, unsigned int instanceStride,
+                                  unsigned int firstInstance, unsigned int instanceCount)
+{
+	// Geometry comes from the usual vertex buffer in slot 0, per-instance data from the instance buffer in slot 1
+	ID3D11Buffer* buffers[2] = { subMesh.vertexBuffer, instanceBuffer };
+	UINT strides[2] = { subMesh.vertexSize, instanceStride };
+	UINT offsets[2] = { 0, 0 };
+	gD3DContext->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+
+	// Indicate the layout of both vertex buffers
+	gD3DContext->IASetInputLayout(subMesh.instancedVertexLayout);
+
+	// Set index buffer as next data source for GPU, indicate it uses 32-bit integers
+	gD3DContext->IASetIndexBuffer(subMesh.indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	gD3DContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	// Render all the instances
+	gD3DContext->DrawIndexedInstanced(subMesh.numIndices, instanceCount, 0, 0, firstInstance);
+}
+
+
 
 // Render the mesh with the given matrices
 // Handles rigid body meshes (including single part meshes) as well as skinned meshes
@@ -464,6 +545,37 @@ void Mesh::Render(std::vector<CMatrix4x4>& modelMatrices, ID3D11Buffer* buffer,
 }
 
 
+// GPU memory used by the vertex buffers of all sub-meshes, in bytes
+unsigned int Mesh::GetVertexBufferBytes()
+{
+	unsigned int bytes = 0;
+	for (auto& subMesh : mSubMeshes)  bytes += subMesh.numVertices * subMesh.vertexSize;
+	return bytes;
+}
+
+// GPU memory used by the index buffers of all sub-meshes, in bytes (indices are 32-bit)
+unsigned int Mesh::GetIndexBufferBytes()
+{
+	unsigned int bytes = 0;
+	for (auto& subMesh : mSubMeshes)  bytes += subMesh.numIndices * sizeof(uint32_t);
+	return bytes;
+}
+
+
+// Render several copies of the mesh with one draw call per sub-mesh. The world matrix and tint of each copy
+// come from the given instance buffer, so no per-model constant buffer update is needed
+void Mesh::RenderInstanced(ID3D11Buffer* instanceBuffer, unsigned int instanceStride, unsigned int firstInstance, unsigned int instanceCount)
+{
+	if (!SupportsInstancing() || instanceCount == 0)  return;
+
+	// Single node mesh, so the instance world matrix is the root matrix for every sub-mesh
+	for (auto& subMeshIndex : mNodes[0].subMeshes)
+	{
+		RenderSubMeshInstanced(mSubMeshes[subMeshIndex], instanceBuffer, instanceStride, firstInstance, instanceCount);
+	}
+}
+
+
 //--------------------------------------------------------------------------------------
 // Helper functions
 //--------------------------------------------------------------------------------------
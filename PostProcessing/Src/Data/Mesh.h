@@ -16,6 +16,8 @@
 #ifndef _MESH_H_INCLUDED_
 #define _MESH_H_INCLUDED_
 
+class CFileCache;
+
 class Mesh
 {
 //--------------------------------------------------------------------------------------
@@ -26,7 +28,8 @@ public:
     // Pass the name of the mesh file to load. Uses assimp (http://www.assimp.org/) to support many file types
     // Optionally request tangents to be calculated (for normal and parallax mapping - see later lab)
     // Will throw a std::runtime_error exception on failure (since constructors can't return errors).
-    Mesh(const std::string& fileName, bool requireTangents = false);
+    // Pass a file cache to read the file and any it refers to through the cache (see AssimpIOSystem.h) rather than stdio
+    Mesh(const std::string& fileName, bool requireTangents = false, CFileCache* fileCache = nullptr);
     ~Mesh();
 
 
@@ -37,12 +40,29 @@ public:
     // The default matrix for a given node - used to set the initial position for a new model
     CMatrix4x4 GetNodeDefaultMatrix(unsigned int node) { return mNodes[node].defaultMatrix; }
 
+	// GPU memory used by the vertex and index buffers of all sub-meshes, in bytes
+	unsigned int GetVertexBufferBytes();
+	unsigned int GetIndexBufferBytes();
+
+	// Radius of a sphere about the mesh's origin that holds every vertex, ignoring the node matrices
+	float GetBoundingRadius()  { return mBoundingRadius; }
+
+	// Largest span of texture coordinates in any sub-mesh, at least 1 - how many times a texture repeats across the mesh
+	float GetTextureRepeat()  { return mTextureRepeat; }
+
 
 	// Render the mesh with the given matrices
 	// Handles rigid body meshes (including single part meshes) as well as skinned meshes
 	// LIMITATION: The mesh must use a single texture throughout
 	void Render(std::vector<CMatrix4x4>& modelMatrices, ID3D11Buffer* buffer, PerModelConstants& ModelConstants);
 
+	// Whether this mesh can be drawn with RenderInstanced - only single node meshes without bones are supported
+	bool SupportsInstancing()  { return !mHasBones && mNodes.size() == 1; }
+
+	// Render several copies of the mesh with one draw call per sub-mesh. The world matrix and tint of each copy
+	// come from the given instance buffer (see InstanceBatcher.h), starting at firstInstance
+	void RenderInstanced(ID3D11Buffer* instanceBuffer, unsigned int instanceStride, unsigned int firstInstance, unsigned int instanceCount);
+
 
 
 //--------------------------------------------------------------------------------------
@@ -56,6 +76,7 @@ private:
 	{
 		unsigned int       vertexSize = 0;         // Size in bytes of a single vertex (depends on what it contains, uvs, tangents etc.)
 		ID3D11InputLayout* vertexLayout = nullptr; // DirectX specification of data held in a single vertex
+		ID3D11InputLayout* instancedVertexLayout = nullptr; // As above plus the per-instance data in a second vertex stream (meshes without bones only)
 
 		// GPU-side vertex and index buffers
 		unsigned int       numVertices = 0;
@@ -99,6 +120,10 @@ private:
 	// Helper function for Render function - renders a given sub-mesh. World matrices / textures / states etc. must already be set
 	void RenderSubMesh(const SubMesh& subMesh);
 
+	// Helper function for RenderInstanced function - renders several instances of a given sub-mesh
+	void RenderSubMeshInstanced(const SubMesh& subMesh, ID3D11Buffer* instanceBuffer, unsigned int instanceStride,
+	                            unsigned int firstInstance, unsigned int instanceCount);
+
 
 
 //--------------------------------------------------------------------------------------
@@ -110,6 +135,9 @@ private:
     std::vector<Node>    mNodes;     // The mesh hierarchy. First entry is root. remainder aree stored in depth-first order
 
 	bool mHasBones; // If any submesh has bones, then all submeshes are given bones - makes rendering easier (one shader for the whole mesh)
+
+	float mBoundingRadius = 0; // See GetBoundingRadius
+	float mTextureRepeat = 1;  // See GetTextureRepeat
 };
 
 
@@ -21,6 +21,21 @@ Model::Model(Mesh* mesh, CVector3 position /*= { 0,0,0 }*/, CVector3 rotation /*
 
 
 
+//Swap the mesh used by this model, keeping the root (world) matrix
+void Model::SetMesh(Mesh* mesh)
+{
+    if (mesh == mMesh)  return;
+
+    CMatrix4x4 worldMatrix = mWorldMatrices[0];
+    mMesh = mesh;
+
+    mWorldMatrices.resize(mesh->NumberNodes());
+    for (int i = 1; i < mWorldMatrices.size(); ++i)
+        mWorldMatrices[i] = mesh->GetNodeDefaultMatrix(i);
+    mWorldMatrices[0] = worldMatrix;
+}
+
+
 // The render function simply passes this model's matrices over to Mesh:Render.
 // All other per-frame constants must have been set already along with shaders, textures, samplers, states etc.
 void Model::Render(ID3D11Buffer* buffer, PerModelConstants& ModelConstants)
@@ -51,6 +51,7 @@ public:
                                                 Length(mWorldMatrices[node].GetRow(1)), 
                                                 Length(mWorldMatrices[node].GetRow(2)) }; } // Scale is length of rows 0-2 in matrix
 	CMatrix4x4 WorldMatrix(int node = 0)  { return mWorldMatrices[node]; }
+	Mesh* GetMesh()  { return mMesh; }
 
     // Setters - model only stores matricies , so if user sets position, rotation or scale, just update those aspects of the matrix
 	void SetPosition(CVector3 position, int node = 0)  { mWorldMatrices[node].SetRow(3, position); }
@@ -93,6 +94,10 @@ public:
     void Setup(ID3D11VertexShader* VertexShader);
     void Setup(ID3D11PixelShader* PixelShader);
     void Setup(ID3D11VertexShader* VertexShader, ID3D11PixelShader* PixelShader);
+
+    //Swap the mesh used by this model, e.g. when a mesh loaded in the background replaces its placeholder.
+    //The root (world) matrix is kept, the other nodes take the new mesh's default matrices
+    void SetMesh(Mesh* mesh);
 	//-------------------------------------
 	// Private data / members
 	//-------------------------------------
@@ -20,6 +20,7 @@
 
 // A sampler state object represents a way to filter textures, such as bilinear or trilinear. We have one object for each method we want to use
 ID3D11SamplerState* gPointSampler         = nullptr;
+ID3D11SamplerState* gBilinearSampler      = nullptr;
 ID3D11SamplerState* gTrilinearSampler     = nullptr;
 ID3D11SamplerState* gAnisotropic4xSampler = nullptr;
 
@@ -74,6 +75,24 @@ bool CreateStates(std::string& LastError)
 	}
 
 
+	////-------- Bilinear Sampling (linear-sampling blur, reads between two pixels of the top mip) --------////
+	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_LINEAR_MIP_POINT; // Bilinear filtering
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;         // Clamp addressing mode for texture coordinates outside 0->1
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;         // --"--
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;         // --"--
+	samplerDesc.MaxAnisotropy = 1;                              // Number of samples used if using anisotropic filtering, more is better but max value depends on GPU
+
+	samplerDesc.MaxLOD = 0; // Top mip only
+	samplerDesc.MinLOD = 0; // --"--
+
+	// Then create a DirectX object for your description that can be used by a shader
+	if (FAILED(gD3DDevice->CreateSamplerState(&samplerDesc, &gBilinearSampler)))
+	{
+		LastError = "Error creating bilinear sampler";
+		return false;
+	}
+
+
 	////-------- Trilinear Sampling --------////
 	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR; // Point filtering
 	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;   // Wrap addressing mode for texture coordinates outside 0->1
@@ -329,5 +348,6 @@ void ReleaseStates()
     if (gAdditiveBlendingState)  gAdditiveBlendingState->Release();
     if (gAnisotropic4xSampler)   gAnisotropic4xSampler->Release();
     if (gTrilinearSampler)       gTrilinearSampler->Release();
+    if (gBilinearSampler)        gBilinearSampler->Release();
     if (gPointSampler)           gPointSampler->Release();
 }
@@ -13,8 +13,13 @@
 #include "Math/MathHelpers.h"        
 #include "Utility/GraphicsHelpers.h" 
 #include "Utility/ColourRGBA.h" 
+#include "Utility/GaussianBlur.h"
+#include "Utility/BlurKernel.h"
+#include "Utility/BlueNoise.h"
 
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <sstream>
 #include <memory>
 
@@ -40,27 +45,36 @@ PostProcessingScene::PostProcessingScene(int width, int height)
 	m_HorizontalBlurTexture = 0;
 	m_VerticalBlurTexture = 0;
 	m_CameraTexture = 0;
+	m_SquareHolePostProcessTexture = 0;
+
+	m_LazyResources.SetIdleTimeout(m_IdleReleaseSeconds);
 }
 
 // Prepare the geometry required for the scene
 // Returns true on success
 bool PostProcessingScene::InitGeometry(std::string& LastError)
 {
+	m_StartupTimer.Reset();
+	resourceManager->setMemoryBudget(static_cast<uint64_t>(m_MemoryBudgetMB) * 1024 * 1024);
+	resourceManager->setStreamingBudget(static_cast<uint64_t>(m_StreamingBudgetMB) * 1024 * 1024);
+
 	////--------------- Load meshes ---------------////
+	// Meshes and textures load in the background. Until they are ready the resource manager returns its default
+	// mesh and texture for their handles, so the scene can start rendering straight away
 
 	try
 	{
-		resourceManager->loadMesh(L"StarsMesh", std::string("Data/Stars.x"));
-		resourceManager->loadMesh(L"GroundMesh", std::string("Data/Hills.x"));
-		resourceManager->loadMesh(L"CubeMesh", std::string("Data/Cube.x"));
-		resourceManager->loadMesh(L"Wall1Mesh", std::string("Data/Wall1.x"));
-		resourceManager->loadMesh(L"Wall2Mesh", std::string("Data/Wall2.x"));
-		resourceManager->loadMesh(L"LightMesh", std::string("Data/Light.x"));
-		resourceManager->loadMesh(L"ContainerMesh", std::string("Data/CargoContainer.x"));
-		resourceManager->loadMesh(L"TeapotMesh", std::string("Data/Teapot.x"));
-		resourceManager->loadMesh(L"TrollMesh", std::string("Data/Troll.x"));
+		m_StarsMesh = resourceManager->loadMesh(L"StarsMesh", std::string("Data/Stars.x"));
+		m_GroundMesh = resourceManager->loadMesh(L"GroundMesh", std::string("Data/Hills.x"));
+		m_CubeMesh = resourceManager->loadMesh(L"CubeMesh", std::string("Data/Cube.x"));
+		m_Wall1Mesh = resourceManager->loadMesh(L"Wall1Mesh", std::string("Data/Wall1.x"));
+		m_Wall2Mesh = resourceManager->loadMesh(L"Wall2Mesh", std::string("Data/Wall2.x"));
+		m_LightMesh = resourceManager->loadMesh(L"LightMesh", std::string("Data/Light.x"));
+		m_ContainerMesh = resourceManager->loadMesh(L"ContainerMesh", std::string("Data/CargoContainer.x"));
+		m_TeapotMesh = resourceManager->loadMesh(L"TeapotMesh", std::string("Data/Teapot.x"));
+		m_TrollMesh = resourceManager->loadMesh(L"TrollMesh", std::string("Data/Troll.x"));
 	}
-	catch (std::runtime_error e)  // Constructors cannot return error messages so use exceptions to catch mesh errors (fairly standard approach this)
+	catch (std::runtime_error e)  // The default mesh is loaded immediately and reports errors with exceptions (see Mesh.cpp)
 	{
 		LastError = e.what(); // This picks up the error message put in the exception (see Mesh.cpp)
 		return false;
@@ -68,25 +82,20 @@ bool PostProcessingScene::InitGeometry(std::string& LastError)
 
 	////--------------- Load / prepare textures & GPU states ---------------////
 
+	// The model textures are streamed - they start with only their smallest mips and sharpen as the models are seen
+	// close up (see RequestTextureSizes)
 	try
 	{
-		resourceManager->loadTexture(L"StarsTexture", std::string("Media/Stars.jpg"));
-		resourceManager->loadTexture(L"BricksTexture", std::string("Media/brick_35.jpg"));
-
-		resourceManager->loadTexture(L"GroundTexture", std::string("Data/GrassDiffuseSpecular.dds"));
-		resourceManager->loadTexture(L"CubeTexture", std::string("Data/StoneDiffuseSpecular.dds"));
-		resourceManager->loadTexture(L"WallsTexture", std::string("Data/CargoA.dds"));
-		resourceManager->loadTexture(L"LightsTexture", std::string("Media/Flare.jpg"));
-		resourceManager->loadTexture(L"ContainerTexture", std::string("Data/CargoA.dds"));
-		resourceManager->loadTexture(L"TeapotTexture", std::string("Data/StoneDiffuseSpecular.dds"));
-		resourceManager->loadTexture(L"TrollTexture", std::string("Data/TrollDiffuseSpecular.dds"));
-		
-		resourceManager->loadTexture(L"NoiseMap", std::string("Media/Noise.png"));
-		resourceManager->loadTexture(L"DistortMap", std::string("Media/Distort.png"));
-		
-		resourceManager->loadTexture(L"SpadeAlphaMap", std::string("Media/SpadeAlphaMap.png"));
-		resourceManager->loadTexture(L"CloverAlphaMap", std::string("Media/CloverAlphaMap.png"));
-		resourceManager->loadTexture(L"HeartAlphaMap", std::string("Media/HeartAlphaMap.png"));
+		m_StarsTexture = resourceManager->loadTexture(L"StarsTexture", std::string("Media/Stars.jpg"), true);
+		m_BricksTexture = resourceManager->loadTexture(L"BricksTexture", std::string("Media/brick_35.jpg"), true);
+
+		m_GroundTexture = resourceManager->loadTexture(L"GroundTexture", std::string("Data/GrassDiffuseSpecular.dds"), true);
+		m_CubeTexture = resourceManager->loadTexture(L"CubeTexture", std::string("Data/StoneDiffuseSpecular.dds"), true);
+		m_WallsTexture = resourceManager->loadTexture(L"WallsTexture", std::string("Data/CargoA.dds"), true);
+		m_LightsTexture = resourceManager->loadTexture(L"LightsTexture", std::string("Media/Flare.jpg"));
+		m_ContainerTexture = resourceManager->loadTexture(L"ContainerTexture", std::string("Data/CargoA.dds"), true);
+		m_TeapotTexture = resourceManager->loadTexture(L"TeapotTexture", std::string("Data/StoneDiffuseSpecular.dds"), true);
+		m_TrollTexture = resourceManager->loadTexture(L"TrollTexture", std::string("Data/TrollDiffuseSpecular.dds"), true);
 	}
 	catch (std::runtime_error e)  // Constructors cannot return error messages so use exceptions to catch mesh errors (fairly standard approach this)
 	{
@@ -101,6 +110,10 @@ bool PostProcessingScene::InitGeometry(std::string& LastError)
 		LastError = "Error loading Render Textures";
 		return false;
 	}
+
+	// The polygon mode and blur resources are created the first time they are used, or over the first few frames if prewarming
+	AddLazyResources();
+	if (m_PrewarmLazyResources)  m_LazyResources.Prewarm(PolygonModeResources | BlurResources);
 	
 	// Load the shaders required for the geometry we will use (see Shader.cpp / .h)
 	if (!LoadShaders(LastError))
@@ -121,6 +134,13 @@ bool PostProcessingScene::InitGeometry(std::string& LastError)
 		return false;
 	}
 
+	// Instance buffer used to draw models that share a mesh in one call, grows if more instances are needed
+	if (!m_InstancedRenderer.Initialise(NUM_LIGHTS))
+	{
+		LastError = "Error creating instance buffer";
+		return false;
+	}
+
 	// Create all filtering modes, blending modes etc. used by the app (see State.cpp/.h)
 	if (!CreateStates(LastError))
 	{
@@ -137,14 +157,14 @@ bool PostProcessingScene::InitScene()
 	////--------------- Set up scene ---------------////
 
 	// Creation of Models in the scene
-	m_StarsModel	 = new Model(resourceManager->getMesh(L"StarsMesh"));
-	m_GroundModel	 = new Model(resourceManager->getMesh(L"GroundMesh"));
-	m_CubeModel		 = new Model(resourceManager->getMesh(L"CubeMesh"));
-	m_Wall1Model	 = new Model(resourceManager->getMesh(L"Wall1Mesh"));
-	m_Wall2Model	 = new Model(resourceManager->getMesh(L"Wall2Mesh"));
-	m_ContainerModel = new Model(resourceManager->getMesh(L"ContainerMesh"));
-	m_TeapotModel	 = new Model(resourceManager->getMesh(L"TeapotMesh"));
-	m_TrollModel	 = new Model(resourceManager->getMesh(L"TrollMesh"));
+	m_StarsModel	 = new Model(resourceManager->getMesh(m_StarsMesh));
+	m_GroundModel	 = new Model(resourceManager->getMesh(m_GroundMesh));
+	m_CubeModel		 = new Model(resourceManager->getMesh(m_CubeMesh));
+	m_Wall1Model	 = new Model(resourceManager->getMesh(m_Wall1Mesh));
+	m_Wall2Model	 = new Model(resourceManager->getMesh(m_Wall2Mesh));
+	m_ContainerModel = new Model(resourceManager->getMesh(m_ContainerMesh));
+	m_TeapotModel	 = new Model(resourceManager->getMesh(m_TeapotMesh));
+	m_TrollModel	 = new Model(resourceManager->getMesh(m_TrollMesh));
 
 	// Initial positions
 	
@@ -187,7 +207,7 @@ bool PostProcessingScene::InitScene()
 	// Light set-up - using an array this time
 	for (int i = 0; i < NUM_LIGHTS; ++i)
 	{
-		Lights[i].model = new Model(resourceManager->getMesh(L"LightMesh"));
+		Lights[i].model = new Model(resourceManager->getMesh(m_LightMesh));
 	}
 
 	Lights[0].colour = { 0.8f, 0.8f, 1.0f };
@@ -228,13 +248,18 @@ void PostProcessingScene::ReleaseResources()
 	if (PostProcessingConstantBuffer)  PostProcessingConstantBuffer->Release();
 	if (PerModelConstantBuffer)        PerModelConstantBuffer->Release();
 	if (PerFrameConstantBuffer)        PerFrameConstantBuffer->Release();
+	m_InstancedRenderer.Release();
 
 	if (m_SceneTexture)			   m_SceneTexture->Shutdown();
 	if (m_SecondPassTexture)       m_SecondPassTexture->Shutdown();
-	if (m_CameraTexture)           m_CameraTexture->Shutdown();
-	if (m_SquareHolePostProcessTexture)   m_SquareHolePostProcessTexture->Shutdown();
-	if (m_HorizontalBlurTexture)   m_HorizontalBlurTexture->Shutdown();
-	if (m_VerticalBlurTexture)     m_VerticalBlurTexture->Shutdown();
+
+	// Frees the lazily created render textures and texture references, so must come before the resource manager goes
+	m_LazyResources.ReleaseAll();
+	ReleaseColourLUT();
+	ReleaseRemap(m_FisheyeRemap);
+	ReleaseRemap(m_UnderwaterRemap);
+	ReleasePaletteLUT();
+	ReleasePixelationTexture();
 	
 	ReleaseShaders();
 
@@ -279,25 +304,25 @@ void PostProcessingScene::RenderSceneFromCamera(Camera* camera)
 	m_GroundModel->SetStates(gNoBlendingState, gUseDepthBufferState, gCullBackState);
 	gD3DContext->PSSetSamplers(0, 1, &gAnisotropic4xSampler);
 	
-	m_GroundModel->SetShaderResources(0, resourceManager->getTexture(L"GroundTexture"));
+	m_GroundModel->SetShaderResources(0, resourceManager->getTexture(m_GroundTexture));
 	m_GroundModel->Render(PerModelConstantBuffer, gPerModelConstants);
 
-	m_Wall1Model->SetShaderResources(0, resourceManager->getTexture(L"BricksTexture"));
+	m_Wall1Model->SetShaderResources(0, resourceManager->getTexture(m_BricksTexture));
 	m_Wall1Model->Render(PerModelConstantBuffer, gPerModelConstants);
 	
-	m_Wall2Model->SetShaderResources(0, resourceManager->getTexture(L"BricksTexture"));
+	m_Wall2Model->SetShaderResources(0, resourceManager->getTexture(m_BricksTexture));
 	m_Wall2Model->Render(PerModelConstantBuffer, gPerModelConstants);
 
-	m_CubeModel->SetShaderResources(0, resourceManager->getTexture(L"CubeTexture"));
+	m_CubeModel->SetShaderResources(0, resourceManager->getTexture(m_CubeTexture));
 	m_CubeModel->Render(PerModelConstantBuffer, gPerModelConstants);
 	
-	m_ContainerModel->SetShaderResources(0, resourceManager->getTexture(L"ContainerTexture"));
+	m_ContainerModel->SetShaderResources(0, resourceManager->getTexture(m_ContainerTexture));
 	m_ContainerModel->Render(PerModelConstantBuffer, gPerModelConstants);
 
-	m_TeapotModel->SetShaderResources(0, resourceManager->getTexture(L"TeapotTexture"));
+	m_TeapotModel->SetShaderResources(0, resourceManager->getTexture(m_TeapotTexture));
 	m_TeapotModel->Render(PerModelConstantBuffer, gPerModelConstants);
 	
-	m_TrollModel->SetShaderResources(0, resourceManager->getTexture(L"TrollTexture"));
+	m_TrollModel->SetShaderResources(0, resourceManager->getTexture(m_TrollTexture));
 	m_TrollModel->Render(PerModelConstantBuffer, gPerModelConstants);
 
 
@@ -311,17 +336,35 @@ void PostProcessingScene::RenderSceneFromCamera(Camera* camera)
 	// Render sky
 	m_StarsModel->Setup(gBasicTransformVertexShader, gTintedTexturePixelShader);
 	m_StarsModel->SetStates(gNoBlendingState, gUseDepthBufferState, gCullNoneState);
-	m_StarsModel->SetShaderResources(0, resourceManager->getTexture(L"StarsTexture"));
+	m_StarsModel->SetShaderResources(0, resourceManager->getTexture(m_StarsTexture));
 	m_StarsModel->Render(PerModelConstantBuffer, gPerModelConstants);
 
 	////--------------- Render lights ---------------////
-	// Render all the lights in the array
+	// All the lights use the same mesh and texture, so gather them into batches and draw each batch with one instanced
+	// draw call. The light colour travels with each instance rather than through the per-model constant buffer
+	m_LightBatcher.Clear();
+	ID3D11ShaderResourceView* lightTexture = resourceManager->getTexture(m_LightsTexture);
+	std::vector<int> unbatchedLights; // Lights whose mesh cannot be instanced, rendered one at a time below
 	for (int i = 0; i < NUM_LIGHTS; ++i)
+	{
+		Mesh* mesh = Lights[i].model->GetMesh();
+		if (!m_LightBatcher.Add(mesh, lightTexture, Lights[i].model->WorldMatrix(), Lights[i].colour, mesh->SupportsInstancing()))
+		{
+			unbatchedLights.push_back(i);
+		}
+	}
+	m_LightBatcher.Build();
+
+	Lights[0].model->Setup(gInstancedTransformVertexShader, gInstancedTintedTexturePixelShader);
+	Lights[0].model->SetStates(gAdditiveBlendingState, gDepthReadOnlyState, gCullNoneState);
+	m_InstancedRenderer.Render(m_LightBatcher, 0);
+
+	for (int i : unbatchedLights)
 	{
 		Lights[i].model->Setup(gBasicTransformVertexShader, gTintedTexturePixelShader);
 		Lights[i].model->SetStates(gAdditiveBlendingState, gDepthReadOnlyState, gCullNoneState);
-		Lights[i].model->SetShaderResources(0, resourceManager->getTexture(L"LightsTexture"));
-		gPerModelConstants.objectColour = Lights[i].colour; // Set any per-model constants apart from the world matrix just before calling render (light colour here)
+		Lights[i].model->SetShaderResources(0, lightTexture);
+		gPerModelConstants.objectColour = Lights[i].colour;
 		Lights[i].model->Render(PerModelConstantBuffer, gPerModelConstants);
 	}
 }
@@ -341,36 +384,35 @@ void PostProcessingScene::SelectPostProcessShaderAndTextures(PostProcess postPro
 	else if (postProcess == PostProcess::GreyNoise)
 	{	
 		gD3DContext->PSSetShader(gGreyNoisePostProcess, nullptr, 0);
-		ID3D11ShaderResourceView* temp = resourceManager->getTexture(L"NoiseMap");
-		gD3DContext->PSSetShaderResources(1, 1, &temp);
 		gD3DContext->PSSetSamplers(1, 1, &gTrilinearSampler);
-		temp = resourceManager->getTexture(L"HeartAlphaMap");
-		gD3DContext->PSSetShaderResources(2, 1, &temp);
-		
+		SelectPolygonMask("HeartAlphaMap", m_HeartAlphaMap);
 	}
 	else if (postProcess == PostProcess::Distort)
 	{
 		gD3DContext->PSSetShader(gDistortPostProcess, nullptr, 0);
-		ID3D11ShaderResourceView* temp = resourceManager->getTexture(L"DistortMap");
-		gD3DContext->PSSetShaderResources(1, 1, &temp);
 		gD3DContext->PSSetSamplers(1, 1, &gTrilinearSampler);
-		temp = resourceManager->getTexture(L"CloverAlphaMap");
-		gD3DContext->PSSetShaderResources(2, 1, &temp);
+		SelectPolygonMask("CloverAlphaMap", m_CloverAlphaMap);
+		if (!m_UsePolygonAtlas)
+		{
+			ID3D11ShaderResourceView* temp = resourceManager->getTexture(m_DistortMap);
+			gD3DContext->PSSetShaderResources(3, 1, &temp);
+		}
 	}
 	else if (postProcess == PostProcess::Fisheye)
 	{
-		gD3DContext->PSSetShader(gFishEyeShader, nullptr, 0);
+		bool remapped = UpdateRemap(CPUPostProcess::Fisheye, m_FisheyeRemap);
+		gD3DContext->PSSetShader(remapped ? gFishEyeShader : gCopyPostProcess, nullptr, 0);
 	}
 	else if (postProcess == PostProcess::Saturation)
 	{
 		gD3DContext->PSSetShader(gSaturationPostProcess, nullptr, 0);
-		ID3D11ShaderResourceView* temp = resourceManager->getTexture(L"SpadeAlphaMap");
-		gD3DContext->PSSetShaderResources(1, 1, &temp);
 		gD3DContext->PSSetSamplers(1, 1, &gTrilinearSampler);
+		SelectPolygonMask("SpadeAlphaMap", m_SpadeAlphaMap);
 	}
 	else if (postProcess == PostProcess::Underwater)
 	{
-		gD3DContext->PSSetShader(gUnderWaterPostProcess, nullptr, 0);
+		bool remapped = UpdateRemap(CPUPostProcess::Underwater, m_UnderwaterRemap);
+		gD3DContext->PSSetShader(remapped ? gUnderWaterPostProcess : gCopyPostProcess, nullptr, 0);
 	}
 	else if (postProcess == PostProcess::Pixelation)
 	{
@@ -380,13 +422,26 @@ void PostProcessingScene::SelectPostProcessShaderAndTextures(PostProcess postPro
 	{
 		gD3DContext->PSSetShader(gVignettePostProcess, nullptr, 0);
 	}
+	else if (postProcess == PostProcess::ColourGrade)
+	{
+		gD3DContext->PSSetShader(gColourGradePostProcess, nullptr, 0);
+		gD3DContext->PSSetShaderResources(4, 1, &m_ColourLUTResource);
+	}
+	else if (postProcess == PostProcess::Palette)
+	{
+		gD3DContext->PSSetShader(gPalettePostProcess, nullptr, 0);
+		gD3DContext->PSSetShaderResources(4, 1, &m_PaletteLUTResource);
+		gD3DContext->PSSetShaderResources(5, 1, &m_DitherTileResource);
+	}
 	else if (postProcess == PostProcess::HorizontalBlur)
 	{
 		gD3DContext->PSSetShader(gHorizontalBlurPostProcess, nullptr, 0);
+		gD3DContext->PSSetSamplers(0, 1, &gBilinearSampler); // The blur's taps each read two pixels
 	}
-	else if (postProcess == PostProcess::HorizontalBlur)
+	else if (postProcess == PostProcess::VerticalBlur)
 	{
 		gD3DContext->PSSetShader(gVerticalBlurPostProcess, nullptr, 0);
+		gD3DContext->PSSetSamplers(0, 1, &gBilinearSampler);
 	}
 	else
 	{
@@ -394,6 +449,27 @@ void PostProcessingScene::SelectPostProcessShaderAndTextures(PostProcess postPro
 	}
 }
 
+// Select the cut-out mask with the given name for the next polygon draw, along with the noise map. With the atlas only the
+// rects change, as the atlas is bound once by PolygonPostProcess. The rects reach the GPU with the draw's polygon points
+void PostProcessingScene::SelectPolygonMask(const std::string& maskName, TextureHandle mask)
+{
+	gPostProcessingConstants.maskThreshold = m_PolygonMaskThreshold;
+	if (m_UsePolygonAtlas)
+	{
+		AtlasRect maskRect = m_PolygonAtlasLayout.GetRect(maskName + m_PolygonMaskSuffix);
+		AtlasRect noiseRect = m_PolygonAtlasLayout.GetRect("Noise");
+		gPostProcessingConstants.maskRect = { maskRect.u, maskRect.v, maskRect.width, maskRect.height };
+		gPostProcessingConstants.lookupRect = { noiseRect.u, noiseRect.v, noiseRect.width, noiseRect.height };
+	}
+	else
+	{
+		gPostProcessingConstants.maskRect = { 0, 0, 1, 1 };
+		gPostProcessingConstants.lookupRect = { 0, 0, 1, 1 };
+		ID3D11ShaderResourceView* textures[] = { resourceManager->getTexture(m_NoiseMap), resourceManager->getTexture(mask) };
+		gD3DContext->PSSetShaderResources(1, 2, textures);
+	}
+}
+
 //Common rendering settings when rendering a post-process
 void PostProcessingScene::FirstRender(ID3D11VertexShader* VertexShader)
 {
@@ -448,38 +524,12 @@ bool PostProcessingScene::CreateRenderTextures(std::string& LastError)
 		LastError = "Error creating SecondPass Texture";
 		return false;
 	}
-	m_HorizontalBlurTexture = new CRenderTexture;
-	if (!m_HorizontalBlurTexture) return false;
-	result = m_HorizontalBlurTexture->Initialize(gD3DDevice, m_ViewportWidth, m_ViewportHeight);
-	if (!result)
-	{
-		LastError = "Error creating Horizontal blur texture";
-		return false;
-	}
-	m_VerticalBlurTexture = new CRenderTexture;
-	if (!m_VerticalBlurTexture) return false;
-	result = m_VerticalBlurTexture->Initialize(gD3DDevice, m_ViewportWidth, m_ViewportHeight);
-	if (!result)
-	{
-		LastError = "Error creating Vertical blur texture";
-		return false;
-	}
-	m_CameraTexture = new CRenderTexture;
-	if (!m_CameraTexture) return false;
-	result = m_CameraTexture->Initialize(gD3DDevice, m_ViewportWidth, m_ViewportHeight);
-	if (!result)
-	{
-		LastError = "Error creating Vertical blur texture";
-		return false;
-	}
 
-	m_SquareHolePostProcessTexture = new CRenderTexture;
-	if (!m_SquareHolePostProcessTexture) return false;
-	result = m_SquareHolePostProcessTexture->Initialize(gD3DDevice, m_ViewportWidth, m_ViewportHeight);
-	if (!result)
+	//Count the render textures against the resource manager's memory budget. They are never evicted.
+	//The render textures only used by some modes and effects are created on first use, see AddLazyResources
+	for (CRenderTexture* renderTexture : { m_SceneTexture, m_SecondPassTexture })
 	{
-		LastError = "Error creating Vertical blur texture";
-		return false;
+		resourceManager->trackMemory(ResourceMemoryType::RenderTarget, renderTexture->GetMemoryUsage());
 	}
 	return true;
 }
@@ -493,33 +543,45 @@ void PostProcessingScene::FullScreenPostProcess(PostProcess postProcess, ID3D11S
 	//Check if the current post-process is a horizontal blur
 	if (postProcess == PostProcess::HorizontalBlur)
 	{
-		//Perform a horizontal blur to the HorizontalBlurTexture from the scene Texture
-		m_HorizontalBlurTexture->SetRenderTarget(gD3DContext, gDepthStencil);
-		m_HorizontalBlurTexture->ClearRenderTarget(gD3DContext, gBackgroundColor);
+		if (m_BoxGaussianBlur)
+		{
+			//Blur with the box compute shaders, then setup the common settings for rendering the copy below
+			BoxGaussianBlur(renderResource);
+			FirstRender(g2DQuadVertexShader);
+		}
+		else
+		{
+			//Perform a horizontal blur to the HorizontalBlurTexture from the scene Texture
+			m_HorizontalBlurTexture->SetRenderTarget(gD3DContext, gDepthStencil);
+			m_HorizontalBlurTexture->ClearRenderTarget(gD3DContext, gBackgroundColor);
 
-		currentShaderTexture = renderResource;//m_Scenetexture->GetShaderResourceView();
-		gD3DContext->PSSetShaderResources(0, 1, &currentShaderTexture);
+			currentShaderTexture = renderResource;//m_Scenetexture->GetShaderResourceView();
+			gD3DContext->PSSetShaderResources(0, 1, &currentShaderTexture);
 
-		//Setup the common settings for rendering post-processes
-		FirstRender(g2DQuadVertexShader);
+			//Setup the common settings for rendering post-processes
+			FirstRender(g2DQuadVertexShader);
 
-		//Select the Horizontal blur shader
-		SelectPostProcessShaderAndTextures(PostProcess::HorizontalBlur);
+			//Select the Horizontal blur shader
+			SelectPostProcessShaderAndTextures(PostProcess::HorizontalBlur);
 
-		//// Draw a quad
-		gD3DContext->Draw(4, 0);
+			//// Draw a quad
+			gD3DContext->Draw(4, 0);
 
-		//Perform a vertical blur to the VerticalBlurTexture from the Horizontal Texture
-		m_VerticalBlurTexture->SetRenderTarget(gD3DContext, gDepthStencil);
+			//Perform a vertical blur to the VerticalBlurTexture from the Horizontal Texture
+			m_VerticalBlurTexture->SetRenderTarget(gD3DContext, gDepthStencil);
 		
-		currentShaderTexture = m_HorizontalBlurTexture->GetShaderResourceView();
-		gD3DContext->PSSetShaderResources(0, 1, &currentShaderTexture);
+			currentShaderTexture = m_HorizontalBlurTexture->GetShaderResourceView();
+			gD3DContext->PSSetShaderResources(0, 1, &currentShaderTexture);
 		
-		//Select the Vertical blur shader
-		SelectPostProcessShaderAndTextures(PostProcess::VerticalBlur);
+			//Select the Vertical blur shader
+			SelectPostProcessShaderAndTextures(PostProcess::VerticalBlur);
 
-		//// Draw a quad
-		gD3DContext->Draw(4, 0);
+			//// Draw a quad
+			gD3DContext->Draw(4, 0);
+
+			//Back to point sampling for the copies
+			gD3DContext->PSSetSamplers(0, 1, &gPointSampler);
+		}
 
 		//Perform a copy of the blurred texture to the SecondPass texture that will be used by the back buffer later
 		m_SecondPassTexture->SetRenderTarget(gD3DContext, gDepthStencil);
@@ -533,6 +595,28 @@ void PostProcessingScene::FullScreenPostProcess(PostProcess postProcess, ID3D11S
 		//// Draw a quad
 		gD3DContext->Draw(4, 0);
 	}
+	else if (postProcess == PostProcess::Pixelation && m_AveragePixelation && UpdatePixelationTexture())
+	{
+		//Average each block of the scene into a texel of the pixelation texture, picking the green from the average
+		m_PixelationTexture->SetRenderTarget(gD3DContext);
+
+		currentShaderTexture = renderResource;
+		gD3DContext->PSSetShaderResources(0, 1, &currentShaderTexture);
+
+		FirstRender(g2DQuadVertexShader);
+		gD3DContext->PSSetShader(gPixelationAveragePostProcess, nullptr, 0);
+		gD3DContext->Draw(4, 0);
+
+		//Stretch the blocks over the SecondPass texture, point sampling filling each block with its texel
+		m_SecondPassTexture->SetRenderTarget(gD3DContext, gDepthStencil);
+		SelectPostProcessShaderAndTextures(PostProcess::Copy);
+
+		currentShaderTexture = m_PixelationTexture->GetShaderResourceView();
+		gD3DContext->PSSetShaderResources(0, 1, &currentShaderTexture);
+
+		//// Draw a quad
+		gD3DContext->Draw(4, 0);
+	}
 	else
 	{
 		//Perform the selected post process to the SecondPass texture that will be used by the back buffer later
@@ -571,18 +655,444 @@ void PostProcessingScene::FullScreenPostProcess(PostProcess postProcess, ID3D11S
 	gD3DContext->Draw(4, 0);
 }
 
+//Blur a texture with the box Gaussian blur compute shaders: three boxes across the rows, then three down the columns (see
+//Utility/GaussianBlur.h). The passes go back and forth between the two blur textures, ending in the VerticalBlurTexture
+void PostProcessingScene::BoxGaussianBlur(ID3D11ShaderResourceView* source)
+{
+	//A texture cannot be written by a compute shader while it is bound as a render target or shader resource elsewhere
+	ID3D11ShaderResourceView*  nullResource = nullptr;
+	ID3D11UnorderedAccessView* nullAccess = nullptr;
+	gD3DContext->OMSetRenderTargets(0, nullptr, nullptr);
+	gD3DContext->PSSetShaderResources(0, 1, &nullResource);
+
+	UpdateConstantBuffer(PostProcessingConstantBuffer, gPostProcessingConstants);
+	gD3DContext->CSSetConstantBuffers(1, 1, &PostProcessingConstantBuffer);
+
+	//Each group blurs a tile of 256 pixels (BOX_BLUR_TILE in BoxBlur.hlsli) of a row or column, a thread per pixel
+	const UINT tile = 256;
+	const UINT rowTiles = (m_ViewportWidth + tile - 1) / tile;
+	const UINT columnTiles = (m_ViewportHeight + tile - 1) / tile;
+	CRenderTexture* const targets[2] = { m_HorizontalBlurTexture, m_VerticalBlurTexture };
+	ID3D11ShaderResourceView* input = source;
+	for (int pass = 0; pass < 6; ++pass)
+	{
+		const bool rows = pass < 3;
+		CRenderTexture* output = targets[pass % 2];
+		ID3D11UnorderedAccessView* outputAccess = output->GetUnorderedAccessView();
+		gD3DContext->CSSetShader(rows ? gBoxBlurHorizontalShader : gBoxBlurVerticalShader, nullptr, 0);
+		gD3DContext->CSSetShaderResources(0, 1, &input);
+		gD3DContext->CSSetUnorderedAccessViews(0, 1, &outputAccess, nullptr);
+		gD3DContext->Dispatch(rows ? rowTiles : columnTiles, rows ? m_ViewportHeight : m_ViewportWidth, 1);
+
+		//Unbind both so the output can be read by the next pass
+		gD3DContext->CSSetUnorderedAccessViews(0, 1, &nullAccess, nullptr);
+		gD3DContext->CSSetShaderResources(0, 1, &nullResource);
+		input = output->GetShaderResourceView();
+	}
+	gD3DContext->CSSetShader(nullptr, nullptr, 0);
+}
+
+//Set the colour grade's chosen effects for ColourGrade_ps, running them on each pixel unless a table of them is worth it (see
+//Utility/ColourLUT.h). The table is baked and uploaded again only when something it is baked from has changed, and the 3D
+//texture made again when the table's size changes
+bool PostProcessingScene::UpdateColourLUT()
+{
+	std::vector<ColourOperator> chain;
+	if (m_GradeGradient)    chain.push_back(ColourOperator::Gradient);
+	if (m_GradeSaturation)  chain.push_back(ColourOperator::Saturation);
+	if (m_GradeUnderwater)  chain.push_back(ColourOperator::UnderwaterTint);
+	if (m_GradeGameBoy)     chain.push_back(ColourOperator::GameBoyPalette);
+	if (chain.empty())  return false;
+
+	m_ColourLUTInUse = IsColourLUTWorthwhile(chain);
+	if (!m_ColourLUTInUse)
+	{
+		SetColourLUTConstants(gPostProcessingConstants, chain, nullptr);
+		return true;
+	}
+
+	const PostProcessingConstants& constants = gPostProcessingConstants;
+	if (m_ColourLUTTexture && chain == m_ColourLUTChain && m_ColourLUT.size == static_cast<uint32_t>(m_ColourLUTSize) &&
+	    m_ColourLUT.range == m_ColourLUTRange && m_ColourLUTSaturation == constants.SaturationLevel &&
+	    m_ColourLUTLuminanceWeights.x == constants.LuminanceWeights.x && m_ColourLUTLuminanceWeights.y == constants.LuminanceWeights.y &&
+	    m_ColourLUTLuminanceWeights.z == constants.LuminanceWeights.z)
+	{
+		SetColourLUTConstants(gPostProcessingConstants, chain, &m_ColourLUT);
+		return true;
+	}
+
+	Timer bakeTimer;
+	if (!BakeColourLUT(chain, constants, static_cast<uint32_t>(m_ColourLUTSize), m_ColourLUTRange, m_ColourLUT, &m_Threads))  return false;
+	m_ColourLUTBakeTime = bakeTimer.GetTime();
+	SetColourLUTConstants(gPostProcessingConstants, chain, &m_ColourLUT);
+
+	if (m_ColourLUTTextureSize != m_ColourLUT.size)
+	{
+		ReleaseColourLUT();
+		D3D11_TEXTURE3D_DESC desc = {};
+		desc.Width = desc.Height = desc.Depth = m_ColourLUT.size;
+		desc.MipLevels = 1;
+		desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		if (FAILED(gD3DDevice->CreateTexture3D(&desc, nullptr, &m_ColourLUTTexture)) ||
+		    FAILED(gD3DDevice->CreateShaderResourceView(m_ColourLUTTexture, nullptr, &m_ColourLUTResource)))
+		{
+			ReleaseColourLUT();
+			return false;
+		}
+		m_ColourLUTTextureSize = m_ColourLUT.size;
+	}
+
+	const UINT rowPitch = m_ColourLUT.size * 4 * sizeof(float);
+	gD3DContext->UpdateSubresource(m_ColourLUTTexture, 0, nullptr, m_ColourLUT.entries.data(), rowPitch, rowPitch * m_ColourLUT.size);
+	m_ColourLUTChain = chain;
+	m_ColourLUTSaturation = constants.SaturationLevel;
+	m_ColourLUTLuminanceWeights = constants.LuminanceWeights;
+	return true;
+}
+
+//Release the colour grade's 3D texture
+void PostProcessingScene::ReleaseColourLUT()
+{
+	if (m_ColourLUTResource)  m_ColourLUTResource->Release();
+	if (m_ColourLUTTexture)   m_ColourLUTTexture->Release();
+	m_ColourLUTResource = nullptr;
+	m_ColourLUTTexture = nullptr;
+	m_ColourLUTTextureSize = 0;
+}
+
+//Bake an effect's distortion over the whole screen (see BakeCPUPostProcessRemap) into its remap texture, unless it was baked for
+//this screen size and haze phase, and bind it to t5 with bilinear sampling. The 2D texture is made again when the map's size changes
+bool PostProcessingScene::UpdateRemap(CPUPostProcess effect, RemapTexture& remap)
+{
+	//The map is in area uv, so one baked over the whole screen serves any area. The haze's offsets are then left unscaled by the
+	//area's height, which Underwater_ps scales them by
+	PostProcessingConstants constants = gPostProcessingConstants;
+	constants.area2DTopLeft = { 0, 0 };
+	constants.area2DSize = { 1, 1 };
+	const float phase = effect == CPUPostProcess::Underwater ? constants.UnderwaterEffect : 0.0f;
+	if (!remap.resource || remap.width != m_ViewportWidth || remap.height != m_ViewportHeight || remap.phase != phase)
+	{
+		const uint32_t oldWidth = remap.map.GetWidth(), oldHeight = remap.map.GetHeight();
+		if (!BakeCPUPostProcessRemap(effect, constants, {}, m_ViewportWidth, m_ViewportHeight, remap.map, &m_Threads))  return false;
+
+		if (!remap.texture || remap.map.GetWidth() != oldWidth || remap.map.GetHeight() != oldHeight)
+		{
+			ReleaseRemap(remap);
+			D3D11_TEXTURE2D_DESC desc = {};
+			desc.Width = remap.map.GetWidth();
+			desc.Height = remap.map.GetHeight();
+			desc.MipLevels = desc.ArraySize = 1;
+			desc.Format = DXGI_FORMAT_R32G32_FLOAT;
+			desc.SampleDesc.Count = 1;
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+			if (FAILED(gD3DDevice->CreateTexture2D(&desc, nullptr, &remap.texture)) ||
+			    FAILED(gD3DDevice->CreateShaderResourceView(remap.texture, nullptr, &remap.resource)))
+			{
+				ReleaseRemap(remap);
+				return false;
+			}
+		}
+
+		gD3DContext->UpdateSubresource(remap.texture, 0, nullptr, remap.map.GetData(), remap.map.GetMip(0).rowPitch, 0);
+		remap.width = m_ViewportWidth;
+		remap.height = m_ViewportHeight;
+		remap.phase = phase;
+	}
+
+	gD3DContext->PSSetShaderResources(5, 1, &remap.resource);
+	gD3DContext->PSSetSamplers(2, 1, &gBilinearSampler);
+	return true;
+}
+
+//Release a remap texture
+void PostProcessingScene::ReleaseRemap(RemapTexture& remap)
+{
+	if (remap.resource)  remap.resource->Release();
+	if (remap.texture)   remap.texture->Release();
+	remap.resource = nullptr;
+	remap.texture = nullptr;
+}
+
+//Build the chosen palette's table of nearest colours (see Utility/Palette.h) when the palette changes and upload it, then set the
+//dither for Palette_ps. The blue-noise dither's thresholds are read from the grain's tile into a texture the first time it is chosen
+bool PostProcessingScene::UpdatePaletteLUT()
+{
+	const Palette& palette = GetBuiltInPalettes()[m_PaletteIndex];
+	if (m_PaletteLUTIndex != m_PaletteIndex)
+	{
+		if (!BuildPaletteLUT(palette, PaletteLUTSize, m_PaletteLUT, &m_Threads))  return false;
+
+		if (!m_PaletteLUTTexture)
+		{
+			D3D11_TEXTURE3D_DESC desc = {};
+			desc.Width = desc.Height = desc.Depth = PaletteLUTSize;
+			desc.MipLevels = 1;
+			desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+			if (FAILED(gD3DDevice->CreateTexture3D(&desc, nullptr, &m_PaletteLUTTexture)) ||
+			    FAILED(gD3DDevice->CreateShaderResourceView(m_PaletteLUTTexture, nullptr, &m_PaletteLUTResource)))
+			{
+				ReleasePaletteLUT();
+				return false;
+			}
+		}
+
+		const std::vector<float> colours = GetPaletteLUTColours(palette, m_PaletteLUT);
+		const UINT rowPitch = PaletteLUTSize * 4 * sizeof(float);
+		gD3DContext->UpdateSubresource(m_PaletteLUTTexture, 0, nullptr, colours.data(), rowPitch, rowPitch * PaletteLUTSize);
+		m_PaletteLUTIndex = m_PaletteIndex;
+	}
+
+	DitherMode mode = static_cast<DitherMode>(m_DitherMode);
+	if (mode == DitherMode::BlueNoise && !m_DitherTileResource && !m_DitherTileFailed)
+	{
+		m_DitherTileFailed = !LoadDitherTile("Media/" + GetBlueNoiseFileName(BlueNoiseTileSize, 1), m_DitherTile);
+		if (!m_DitherTileFailed)
+		{
+			D3D11_TEXTURE2D_DESC desc = {};
+			desc.Width = desc.Height = m_DitherTile.size;
+			desc.MipLevels = desc.ArraySize = 1;
+			desc.Format = DXGI_FORMAT_R32_FLOAT;
+			desc.SampleDesc.Count = 1;
+			desc.Usage = D3D11_USAGE_IMMUTABLE;
+			desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+			D3D11_SUBRESOURCE_DATA data = { m_DitherTile.thresholds.data(), static_cast<UINT>(m_DitherTile.size * sizeof(float)), 0 };
+			if (FAILED(gD3DDevice->CreateTexture2D(&desc, &data, &m_DitherTileTexture)) ||
+			    FAILED(gD3DDevice->CreateShaderResourceView(m_DitherTileTexture, nullptr, &m_DitherTileResource)))
+			{
+				if (m_DitherTileResource)  m_DitherTileResource->Release();
+				if (m_DitherTileTexture)   m_DitherTileTexture->Release();
+				m_DitherTileResource = nullptr;
+				m_DitherTileTexture = nullptr;
+				m_DitherTileFailed = true;
+			}
+		}
+	}
+	if (mode == DitherMode::BlueNoise && !m_DitherTileResource)  mode = DitherMode::None;
+
+	SetPaletteConstants(gPostProcessingConstants, m_PaletteLUT, mode, GetPaletteSpread(palette) * m_DitherStrength);
+	return true;
+}
+
+//Release the palette's 3D texture and the dither tile's texture
+void PostProcessingScene::ReleasePaletteLUT()
+{
+	if (m_PaletteLUTResource)  m_PaletteLUTResource->Release();
+	if (m_PaletteLUTTexture)   m_PaletteLUTTexture->Release();
+	m_PaletteLUTResource = nullptr;
+	m_PaletteLUTTexture = nullptr;
+	m_PaletteLUTIndex = -1;
+
+	if (m_DitherTileResource)  m_DitherTileResource->Release();
+	if (m_DitherTileTexture)   m_DitherTileTexture->Release();
+	m_DitherTileResource = nullptr;
+	m_DitherTileTexture = nullptr;
+}
+
+//Make the texture the averaged pixelation draws a texel a block into, again when the pixel size changes
+bool PostProcessingScene::UpdatePixelationTexture()
+{
+	if (m_PixelationTexture && m_PixelationTextureSize == m_PixelWidth)  return true;
+
+	ReleasePixelationTexture();
+	m_PixelationTexture = new CRenderTexture;
+	if (!m_PixelationTexture->Initialize(gD3DDevice, m_PixelWidth, m_PixelWidth))
+	{
+		ReleasePixelationTexture();
+		return false;
+	}
+	m_PixelationTextureSize = m_PixelWidth;
+	return true;
+}
+
+//Release the averaged pixelation's texture
+void PostProcessingScene::ReleasePixelationTexture()
+{
+	if (m_PixelationTexture)
+	{
+		m_PixelationTexture->Shutdown();
+		delete m_PixelationTexture;  m_PixelationTexture = nullptr;
+	}
+	m_PixelationTextureSize = 0;
+}
+
+// Point each model at the current mesh for its handle. Models are created with the default mesh while their own
+// mesh loads in the background, this switches them over once it is ready
+void PostProcessingScene::RebindModelMeshes()
+{
+	m_StarsModel->SetMesh(resourceManager->getMesh(m_StarsMesh));
+	m_GroundModel->SetMesh(resourceManager->getMesh(m_GroundMesh));
+	m_CubeModel->SetMesh(resourceManager->getMesh(m_CubeMesh));
+	m_Wall1Model->SetMesh(resourceManager->getMesh(m_Wall1Mesh));
+	m_Wall2Model->SetMesh(resourceManager->getMesh(m_Wall2Mesh));
+	m_ContainerModel->SetMesh(resourceManager->getMesh(m_ContainerMesh));
+	m_TeapotModel->SetMesh(resourceManager->getMesh(m_TeapotMesh));
+	m_TrollModel->SetMesh(resourceManager->getMesh(m_TrollMesh));
+
+	for (int i = 0; i < NUM_LIGHTS; ++i)
+	{
+		Lights[i].model->SetMesh(resourceManager->getMesh(m_LightMesh));
+	}
+}
+
+// Ask for each model's texture at the size the model covers from the main camera. The mips are uploaded by the resource
+// manager's next update
+void PostProcessingScene::RequestTextureSizes()
+{
+	RequestTextureSize(m_StarsModel, m_StarsTexture);
+	RequestTextureSize(m_GroundModel, m_GroundTexture);
+	RequestTextureSize(m_Wall1Model, m_BricksTexture);
+	RequestTextureSize(m_Wall2Model, m_BricksTexture);
+	RequestTextureSize(m_CubeModel, m_CubeTexture);
+	RequestTextureSize(m_ContainerModel, m_ContainerTexture);
+	RequestTextureSize(m_TeapotModel, m_TeapotTexture);
+	RequestTextureSize(m_TrollModel, m_TrollTexture);
+}
+
+// Ask for a model's texture at the size the model covers on screen. The finest mip is needed where the model is closest,
+// so the model's bounding sphere is measured from its nearest point (the near clip for models around the camera such as
+// the sky and ground), then divided by the times the texture repeats across the mesh
+void PostProcessingScene::RequestTextureSize(Model* model, TextureHandle texture)
+{
+	Mesh* mesh = model->GetMesh();
+	CVector3 scale = model->Scale();
+	float radius = mesh->GetBoundingRadius() * (std::max)({ scale.x, scale.y, scale.z }); // Parenthesised as windows.h defines max
+	float distance = (std::max)(Length(model->Position() - MainCamera->Position()) - radius, MainCamera->NearClip());
+	float pixelSize = MainCamera->PixelSizeInWorldSpace(distance, m_ViewportWidth, m_ViewportHeight).x;
+	resourceManager->requestTextureSize(texture, 2.0f * radius / pixelSize / mesh->GetTextureRepeat());
+}
+
+//Register the render textures and textures that are only created once a mode or effect needing them is used
+void PostProcessingScene::AddLazyResources()
+{
+	//The box Gaussian blur's compute shaders write to these
+	AddLazyRenderTexture("Horizontal blur texture", BlurResources, m_HorizontalBlurTexture, DXGI_FORMAT_R16G16B16A16_FLOAT, true);
+	AddLazyRenderTexture("Vertical blur texture", BlurResources, m_VerticalBlurTexture, DXGI_FORMAT_R16G16B16A16_FLOAT, true);
+
+	//Polygon mode never blends with or reads the alpha of these, so they drop it for half the memory of the others
+	AddLazyRenderTexture("Camera texture", PolygonModeResources, m_CameraTexture, DXGI_FORMAT_R11G11B10_FLOAT);
+	AddLazyRenderTexture("Square hole texture", PolygonModeResources, m_SquareHolePostProcessTexture, DXGI_FORMAT_R11G11B10_FLOAT);
+
+	AddLazyTexture(PolygonModeResources, L"DistortMap", "Media/Distort.png", m_DistortMap);
+
+	//Use the atlas of the masks and noise map if it has been built and its layout has all of them, otherwise load each
+	//from its own texture. Either way the masks are signed distance fields if they have been made
+	const char* const maskNames[] = { "SpadeAlphaMap", "CloverAlphaMap", "HeartAlphaMap" };
+	std::string layoutText, layoutError;
+	m_UsePolygonAtlas = resourceManager->readFile("Media/PolygonAtlas.txt", layoutText) &&
+	                    ParseAtlasLayout(layoutText, m_PolygonAtlasLayout, layoutError);
+	auto hasEntry = [this](const std::string& name)
+	{
+		auto& entries = m_PolygonAtlasLayout.entries;
+		return std::any_of(entries.begin(), entries.end(), [&name](const AtlasEntry& entry) { return entry.name == name; });
+	};
+	auto hasMasks = [&](const std::string& suffix, auto exists)
+	{
+		return std::all_of(std::begin(maskNames), std::end(maskNames), [&](const char* name) { return exists(name + suffix); });
+	};
+
+	if (m_UsePolygonAtlas)
+	{
+		m_PolygonMaskSuffix = hasMasks("SDF", hasEntry) ? "SDF" : "";
+		m_UsePolygonAtlas = hasEntry("Noise") && hasMasks(m_PolygonMaskSuffix, hasEntry);
+	}
+	else
+	{
+		auto hasFile = [this](const std::string& name) { return resourceManager->fileExists("Media/" + name + ".dds"); };
+		m_PolygonMaskSuffix = hasMasks("SDF", hasFile) ? "SDF" : "";
+	}
+	m_PolygonMaskThreshold = m_PolygonMaskSuffix.empty() ? 0.1f : 0.5f;
+
+	if (m_UsePolygonAtlas)
+	{
+		AddLazyTexture(PolygonModeResources, L"PolygonAtlas", "Media/PolygonAtlas.dds", m_PolygonAtlas);
+	}
+	else
+	{
+		//The distance fields are only ever DDS files, the masks are PNG files that may have been compressed to DDS
+		std::string ending = m_PolygonMaskSuffix.empty() ? ".png" : "SDF.dds";
+		//The grain is the tile of blue noise shipped in Media, made by "AssetTool blue-noise --out"
+		std::string noiseFile = "Media/" + GetBlueNoiseFileName(BlueNoiseTileSize, 1);
+		m_UseBlueNoise = resourceManager->fileExists(noiseFile);
+		AddLazyTexture(PolygonModeResources, L"NoiseMap", m_UseBlueNoise ? noiseFile : "Media/Noise.png", m_NoiseMap);
+		AddLazyTexture(PolygonModeResources, L"SpadeAlphaMap", "Media/SpadeAlphaMap" + ending, m_SpadeAlphaMap);
+		AddLazyTexture(PolygonModeResources, L"CloverAlphaMap", "Media/CloverAlphaMap" + ending, m_CloverAlphaMap);
+		AddLazyTexture(PolygonModeResources, L"HeartAlphaMap", "Media/HeartAlphaMap" + ending, m_HeartAlphaMap);
+	}
+}
+
+//Register a viewport sized render texture of the given format, counted against the resource manager's budget while it exists
+void PostProcessingScene::AddLazyRenderTexture(const std::string& name, uint32_t tags, CRenderTexture*& renderTexture, DXGI_FORMAT format,
+                                               bool unorderedAccess)
+{
+	//Shared by the create and release functions
+	auto memoryEntry = std::make_shared<CResourceBudget::EntryId>(CResourceBudget::InvalidEntry);
+
+	LazyResourceCallbacks callbacks;
+	callbacks.create = [this, &renderTexture, memoryEntry, format, unorderedAccess](std::string& error)
+	{
+		renderTexture = new CRenderTexture;
+		if (!renderTexture->Initialize(gD3DDevice, m_ViewportWidth, m_ViewportHeight, format, unorderedAccess))
+		{
+			renderTexture->Shutdown();
+			delete renderTexture;  renderTexture = nullptr;
+			error = "could not create the render target";
+			return false;
+		}
+		*memoryEntry = resourceManager->trackMemory(ResourceMemoryType::RenderTarget, renderTexture->GetMemoryUsage());
+		return true;
+	};
+	callbacks.release = [this, &renderTexture, memoryEntry]()
+	{
+		resourceManager->untrackMemory(*memoryEntry);
+		renderTexture->Shutdown();
+		delete renderTexture;  renderTexture = nullptr;
+	};
+	callbacks.bytes = [&renderTexture]() { return renderTexture->GetMemoryUsage(); };
+	m_LazyResources.Add(name, tags, callbacks);
+}
+
+//Register a texture. Creating it starts a background load (the default texture is used until it finishes) and releasing it
+//frees the texture unless something else holds a reference. Until first created the handle is the default texture
+void PostProcessingScene::AddLazyTexture(uint32_t tags, const wchar_t* uniqueID, const std::string& fileName, TextureHandle& handle)
+{
+	LazyResourceCallbacks callbacks;
+	callbacks.create = [this, uniqueID, fileName, &handle](std::string&)
+	{
+		//Loading an ID again adds a reference, fetching it starts a reload if it was freed when last released
+		handle = resourceManager->loadTexture(uniqueID, fileName);
+		resourceManager->getTexture(handle);
+		return true;
+	};
+	callbacks.release = [this, &handle]()
+	{
+		resourceManager->releaseTexture(handle);
+		resourceManager->unloadTexture(handle);
+	};
+	callbacks.bytes = [this, &handle]() { return resourceManager->getTextureMemory(handle); };
+	m_LazyResources.Add(fileName, tags, callbacks);
+}
+
 // Perform an post process from "scene texture" to back buffer within the given four-point polygon and a world matrix to position/rotate/scale the polygon
 void PostProcessingScene::PolygonPostProcess()
 {
 	// First perform a full-screen copy of the scene to back-buffer
 	FullScreenPostProcess(PostProcess::Copy, m_SceneTexture->GetShaderResourceView());
 	
+	//With the atlas, bind it as the mask and noise map of every draw below, along with the distortion map
+	if (m_UsePolygonAtlas)
+	{
+		ID3D11ShaderResourceView* atlas = resourceManager->getTexture(m_PolygonAtlas);
+		ID3D11ShaderResourceView* textures[] = { atlas, atlas, resourceManager->getTexture(m_DistortMap) };
+		gD3DContext->PSSetShaderResources(1, 3, textures);
+	}
+
 	//Select the shader required for the Saturation effect
 	SelectPostProcessShaderAndTextures(PostProcess::Saturation);
-
-	//Get a reference to the Spade Alpha Map
-	ID3D11ShaderResourceView* temporary = resourceManager->getTexture(L"SpadeAlphaMap");
-	gD3DContext->PSSetShaderResources(1, 1, &temporary);
 	
 	// Loop through the given points, transform each to 2D (this is what the vertex shader normally does in most labs)
 	for (unsigned int i = 0; i < m_SpadeWindowPoints.size(); ++i)
@@ -741,13 +1251,25 @@ void PostProcessingScene::RenderScene(float frameTime)
 	//Check if a post-process is currently selected
 	if (CurrentPostProcess != PostProcess::None)
 	{
-		if (CurrentPostProcessMode == PostProcessMode::Fullscreen)
+		//Create any resources the selected mode and effect need that do not exist yet (or were released for being idle).
+		//If they cannot be created the scene is copied to the screen without the effect
+		bool polygonMode = CurrentPostProcessMode == PostProcessMode::Polygon;
+		uint32_t requiredResources = polygonMode ? PolygonModeResources : (CurrentPostProcess == PostProcess::HorizontalBlur ? BlurResources : 0);
+		if (requiredResources != 0 && !m_LazyResources.Require(requiredResources, m_StartupTimer.GetTime()))
+		{
+			FullScreenPostProcess(PostProcess::Copy, m_SceneTexture->GetShaderResourceView());
+		}
+
+		else if (CurrentPostProcessMode == PostProcessMode::Fullscreen)
 		{		
-			//Render the current post-processing effect to the screen
-			FullScreenPostProcess(CurrentPostProcess, m_SceneTexture->GetShaderResourceView());
+			//Render the current post-processing effect to the screen. Without a colour grade table the scene is copied
+			PostProcess postProcess = CurrentPostProcess;
+			if (postProcess == PostProcess::ColourGrade && !UpdateColourLUT())  postProcess = PostProcess::Copy;
+			if (postProcess == PostProcess::Palette && !UpdatePaletteLUT())     postProcess = PostProcess::Copy;
+			FullScreenPostProcess(postProcess, m_SceneTexture->GetShaderResourceView());
 		}
 
-		else if (CurrentPostProcessMode == PostProcessMode::Polygon)
+		else if (polygonMode)
 		{				
 			//Render the scene from the Fisheye cameras perspective to the CameraTexture
 			m_CameraTexture->SetRenderTarget(gD3DContext);
@@ -783,11 +1305,19 @@ void PostProcessingScene::RenderScene(float frameTime)
 	// When drawing to the off-screen back buffer is complete, we "present" the image to the front buffer (the screen)
 	// Set first parameter to 1 to lock to vsync
 	gSwapChain->Present(m_LockFPS ? 1 : 0, 0);
+
+	if (m_TimeToFirstFrame == 0.0f)  m_TimeToFirstFrame = m_StartupTimer.GetTime();
 }
 
 // Update models and camera. frameTime is the time passed since the last frame
 void PostProcessingScene::UpdateScene(float frameTime, HWND HWnd)
 {
+	// Swap in any meshes and textures that have finished loading in the background
+	if (resourceManager->update() > 0)  RebindModelMeshes();
+
+	// Create the next prewarmed resource and release the mode and effect resources that have not been used for a while
+	m_LazyResources.Update(m_StartupTimer.GetTime());
+
 	// Select post process on keys
 	if (KeyHit(Key_F1))  CurrentPostProcessMode = PostProcessMode::Fullscreen;
 	if (KeyHit(Key_F2))  CurrentPostProcessMode = PostProcessMode::Polygon;
@@ -796,14 +1326,24 @@ void PostProcessingScene::UpdateScene(float frameTime, HWND HWnd)
 	if (KeyHit(Key_2))   CurrentPostProcess = PostProcess::HorizontalBlur;
 	if (KeyHit(Key_3))   CurrentPostProcess = PostProcess::Underwater;
 	if (KeyHit(Key_4))   CurrentPostProcess = PostProcess::Pixelation;
+	if (KeyHit(Key_5))   CurrentPostProcess = PostProcess::ColourGrade;
+	if (KeyHit(Key_6))   CurrentPostProcess = PostProcess::Palette;
 	if (KeyHit(Key_0))   CurrentPostProcess = PostProcess::None;
 
-	// Noise scaling adjusts how fine the grey noise is.
-	const float grainSize = 50; // Fineness of the noise grain
+	// Noise scaling adjusts how fine the grey noise is. Blue noise is drawn a texel to a pixel, as any coarser loses what makes it blue
+	const float grainSize = m_UseBlueNoise ? static_cast<float>(BlueNoiseTileSize) : 50; // Fineness of the noise grain
 	gPostProcessingConstants.noiseScale  = { m_ViewportWidth / grainSize, m_ViewportHeight / grainSize };
 
-	// The noise offset is randomised to give a constantly changing noise effect (like tv static)
-	gPostProcessingConstants.noiseOffset = { Random(0.0f, 1.0f), Random(0.0f, 1.0f) };
+	// The noise offset changes every frame to give a constantly changing noise effect (like tv static). It follows the R2 sequence so
+	// each frame's offset is far from the last few, and moves the blue noise by whole texels so they stay on the pixels
+	float noiseU, noiseV;
+	GetBlueNoiseOffset(m_NoiseFrame++, noiseU, noiseV);
+	if (m_UseBlueNoise)
+	{
+		noiseU = std::floor(noiseU * BlueNoiseTileSize) / BlueNoiseTileSize;
+		noiseV = std::floor(noiseV * BlueNoiseTileSize) / BlueNoiseTileSize;
+	}
+	gPostProcessingConstants.noiseOffset = { noiseU, noiseV };
 
 	// Set the level of distortion
 	gPostProcessingConstants.distortLevel = 0.01f;
@@ -812,14 +1352,15 @@ void PostProcessingScene::UpdateScene(float frameTime, HWND HWnd)
 	gPostProcessingConstants.PixelWidth = m_PixelWidth;
 	gPostProcessingConstants.PixelHeight = m_PixelWidth;
 
-	//Updating the level of blur
-	gPostProcessingConstants.BlurOffset = m_BlurOffset;
-
 	gPostProcessingConstants.Feedback = m_Feedback;
-	
-	//Updating the resolution of the blur to the Blur offset
-	gPostProcessingConstants.BlurHeight = m_BlurOffset;
-	gPostProcessingConstants.BlurWidth = m_BlurOffset * 1.3;
+
+	//The taps of the linear-sampling blur shaders
+	SetBlurTapConstants(gPostProcessingConstants, ComputeBlurTaps(m_BlurSigma));
+
+	//The box for the box Gaussian blur
+	BoxBlurParameters boxBlur = ComputeBoxBlur(m_BlurSigma);
+	gPostProcessingConstants.BoxBlurRadius = static_cast<float>(boxBlur.radius);
+	gPostProcessingConstants.BoxBlurEndWeight = boxBlur.endWeight;
 	
 	//Updating the vignette effects
 	gPostProcessingConstants.vignetteStrength = m_VignetteStrength;
@@ -845,6 +1386,9 @@ void PostProcessingScene::UpdateScene(float frameTime, HWND HWnd)
 	// Control of camera
 	MainCamera->Control(frameTime, Key_Up, Key_Down, Key_Left, Key_Right, Key_W, Key_S, Key_A, Key_D);
 
+	// Stream in the texture detail the models need from the new viewpoint
+	RequestTextureSizes();
+
 	// Toggle FPS limiting
 	if (KeyHit(Key_P))  m_LockFPS = !m_LockFPS;
 
@@ -878,6 +1422,89 @@ void PostProcessingScene::IMGUI()
 	//Information about the camera's position and rotation
 	ImGui::Text("Camera Position: (%.2f, %.2f, %.2f)", MainCamera->Position().x, MainCamera->Position().y, MainCamera->Position().z);
 	ImGui::Text("Camera Rotation: (%.2f, %.2f, %.2f)", MainCamera->Rotation().x, MainCamera->Rotation().y, MainCamera->Rotation().z);
+
+	//Information about the instanced rendering of the lights
+	const InstanceStats& instanceStats = m_LightBatcher.GetStats();
+	ImGui::Text("Instanced Lights: %u instances, %u draw calls (%u saved), %u not instanced", instanceStats.instancesSubmitted,
+		instanceStats.drawCalls, instanceStats.drawCallsSaved, instanceStats.instancesRejected);
+
+	//Memory used by the resources and the budget they are kept within
+	const ResourceBudgetStats& budgetStats = resourceManager->getBudgetStats();
+	const float MB = 1.0f / (1024.0f * 1024.0f);
+	ImGui::Text("Memory: %.1f MB textures, %.1f MB vertices, %.1f MB indices, %.1f MB render targets",
+		budgetStats.residentBytes[ResourceMemoryType::Texture] * MB, budgetStats.residentBytes[ResourceMemoryType::VertexBuffer] * MB,
+		budgetStats.residentBytes[ResourceMemoryType::IndexBuffer] * MB, budgetStats.residentBytes[ResourceMemoryType::RenderTarget] * MB);
+	ImGui::Text("Resident: %u resources, %.1f MB (peak %.1f MB), %u evictions, %u reloads", budgetStats.resident,
+		budgetStats.residentBytes.Total() * MB, budgetStats.peakBytes * MB, budgetStats.evictions, budgetStats.reloads);
+	if (ImGui::SliderInt("Memory Budget (MB, 0 = unlimited)", &m_MemoryBudgetMB, 0, 512))
+	{
+		resourceManager->setMemoryBudget(static_cast<uint64_t>(m_MemoryBudgetMB) * 1024 * 1024);
+	}
+
+	//Texture mips resident against those the models' screen sizes ask for, and the upload budget that streams them in
+	const TextureStreamingStats& streamingStats = resourceManager->getStreamingStats();
+	ImGui::Text("Streaming: %u / %u mips resident (%.1f / %.1f MB), %u of %u textures waiting, %.2f MB uploaded last frame",
+		streamingStats.residentMips, streamingStats.requestedMips, streamingStats.residentBytes * MB, streamingStats.requestedBytes * MB,
+		streamingStats.waiting, streamingStats.textures, streamingStats.frameBytes * MB);
+	if (ImGui::SliderInt("Streaming Budget (MB per frame, 0 = paused)", &m_StreamingBudgetMB, 0, 64))
+	{
+		resourceManager->setStreamingBudget(static_cast<uint64_t>(m_StreamingBudgetMB) * 1024 * 1024);
+	}
+
+	//Resources loaded under several IDs that share a single copy
+	ResourceDedupStats dedupStats = resourceManager->getDedupStats();
+	ImGui::Text("Shared: %u same file, %u same contents, %.1f MB saved", dedupStats.pathDuplicates,
+		dedupStats.contentDuplicates, dedupStats.bytesSaved * MB);
+
+	//Information about the background loading of the meshes and textures
+	const ResourceLoadStats& loadStats = resourceManager->getLoadStats();
+	ImGui::Text("Time to first frame: %.1f ms", m_TimeToFirstFrame * 1000.0f);
+	if (loadStats.isLoading())
+	{
+		ImGui::Text("Loading resources: %u / %u", loadStats.completed + loadStats.failed, loadStats.requested);
+	}
+	else
+	{
+		ImGui::Text("Resources loaded: %u (%u failed, %u from %s) in %.1f ms", loadStats.completed, loadStats.failed,
+			loadStats.fromPack, CResourceManager::AssetPackFile, loadStats.totalLoadTime * 1000.0f);
+	}
+
+	//File reads shared by the texture loader and assimp. Every read is served from memory, only opening loose files reaches the OS
+	FileCacheStats fileStats = resourceManager->getFileCacheStats();
+	ImGui::Text("Files: %llu opened (%llu cached, %llu packed, %llu loose), %llu OS calls, %.1f MB",
+		fileStats.opens, fileStats.hits, fileStats.packFiles, fileStats.diskFiles, fileStats.osCalls, fileStats.bytes * MB);
+	ImGui::Text("Mesh reads: %llu from memory, %.1f MB", fileStats.reads, fileStats.readBytes * MB);
+
+	//Resources only created once a mode or effect uses them. First use is the time spent creating them on the frame they were needed
+	//(textures then finish loading in the background), on top of the time to first frame
+	uint64_t fullscreenBytes = m_SceneTexture->GetMemoryUsage() + m_SecondPassTexture->GetMemoryUsage();
+	LazyResourceStats blurStats = m_LazyResources.GetStats(BlurResources);
+	LazyResourceStats polygonStats = m_LazyResources.GetStats(PolygonModeResources);
+	ImGui::Text("Fullscreen: %.1f MB resident, blur %u/%u created (%.1f MB, first use %.1f ms, %u idle releases)",
+		(fullscreenBytes + blurStats.residentBytes) * MB, blurStats.resident, blurStats.resources, blurStats.residentBytes * MB,
+		blurStats.createTime * 1000.0f, blurStats.releases);
+	ImGui::Text("Polygon: %.1f MB resident, %u/%u created (%.1f MB, first use %.1f ms, %u idle releases)",
+		(fullscreenBytes + polygonStats.residentBytes) * MB, polygonStats.resident, polygonStats.resources, polygonStats.residentBytes * MB,
+		polygonStats.createTime * 1000.0f, polygonStats.releases);
+	if (m_UsePolygonAtlas)
+	{
+		ImGui::Text("Polygon masks: %s in a %ux%u atlas, %.1f%% used by %zu entries", m_PolygonMaskSuffix.empty() ? "alpha maps" : "distance fields",
+			m_PolygonAtlasLayout.width, m_PolygonAtlasLayout.height, m_PolygonAtlasLayout.GetUtilization() * 100.0, m_PolygonAtlasLayout.entries.size());
+	}
+	else
+	{
+		ImGui::Text("Polygon masks: %s as separate textures (build the atlas with \"AssetTool atlas\")",
+			m_PolygonMaskSuffix.empty() ? "alpha maps" : "distance fields");
+	}
+	if (!m_LazyResources.GetLastError().empty())  ImGui::Text("%s", m_LazyResources.GetLastError().c_str());
+	if (ImGui::SliderFloat("Idle release (s, 0 = never)", &m_IdleReleaseSeconds, 0.0f, 120.0f))
+	{
+		m_LazyResources.SetIdleTimeout(m_IdleReleaseSeconds);
+	}
+	if (ImGui::Checkbox("Prewarm modes", &m_PrewarmLazyResources) && m_PrewarmLazyResources)
+	{
+		m_LazyResources.Prewarm(PolygonModeResources | BlurResources);
+	}
 	ImGui::Separator();
 	ImGui::Text("");
 
@@ -926,17 +1553,56 @@ void PostProcessingScene::IMGUI()
 		CurrentPostProcess = PostProcess::Pixelation;
 
 	}
+
+	//Activate the colour grade when the button is pressed
+	if (ImGui::Button("(5)Colour Grade", m_ButtonSize))
+	{
+		CurrentPostProcess = PostProcess::ColourGrade;
+	}
+	ImGui::SameLine();
+
+	//Activate the palette effect when the button is pressed
+	if (ImGui::Button("(6)Palette", m_ButtonSize))
+	{
+		CurrentPostProcess = PostProcess::Palette;
+	}
 	ImGui::Separator();
 	ImGui::Text("");
 		
 	//Sliders to update the Blur post processing constants
-	ImGui::SliderInt("Blur divider", &m_BlurOffset, 100, 960);
+	//A sigma set for the box blur is brought back within the taps' reach when switching to the blur shaders
+	ImGui::Checkbox("Box Gaussian blur", &m_BoxGaussianBlur);
+	if (!m_BoxGaussianBlur)  m_BlurSigma = (std::min)(m_BlurSigma, MaxTapBlurSigma);
+	ImGui::SliderFloat("Blur sigma", &m_BlurSigma, 0.5f, m_BoxGaussianBlur ? 64.0f : MaxTapBlurSigma);
 	ImGui::SliderFloat("Feedback", &m_Feedback, 0.0f, 1.0);
 	ImGui::Separator();		
 
 	//Slider to update the Gameboy post processing constants
 	ImGui::Text("");
 	ImGui::SliderInt("Pixel Size", &m_PixelWidth, 40, 128);
+	ImGui::Checkbox("Average Pixel Blocks", &m_AveragePixelation);
+	ImGui::Separator();
+
+	//The effects whose colour maps the colour grade bakes, in order, and the size of its table
+	ImGui::Text("");
+	ImGui::Checkbox("Grade Gradient", &m_GradeGradient);
+	ImGui::SameLine();
+	ImGui::Checkbox("Grade Saturation", &m_GradeSaturation);
+	ImGui::Checkbox("Grade Underwater", &m_GradeUnderwater);
+	ImGui::SameLine();
+	ImGui::Checkbox("Grade Gameboy", &m_GradeGameBoy);
+	ImGui::SliderInt("Colour LUT Size", &m_ColourLUTSize, 16, 64);
+	ImGui::SliderFloat("Colour LUT Range", &m_ColourLUTRange, 1.0f, 4.0f);
+	if (m_ColourLUTInUse)  ImGui::Text("Colour LUT: %.1f KB, baked in %.2f ms", m_ColourLUT.GetSize() / 1024.0f, m_ColourLUTBakeTime * 1000.0f);
+	else                   ImGui::Text("Colour LUT: unused, the maps run on each pixel");
+	ImGui::Separator();
+
+	//The palette and its dither. Error diffusion is on the CPU only
+	ImGui::Text("");
+	const std::vector<Palette>& palettes = GetBuiltInPalettes();
+	ImGui::SliderInt("Palette", &m_PaletteIndex, 0, static_cast<int>(palettes.size()) - 1, palettes[m_PaletteIndex].name);
+	ImGui::Combo("Dither", &m_DitherMode, "None\0Bayer\0Interleaved gradient\0Blue noise\0");
+	ImGui::SliderFloat("Dither Strength", &m_DitherStrength, 0.0f, 2.0f);
 	ImGui::Separator();
 	
 	//Slider to update the Saturation post processing constants
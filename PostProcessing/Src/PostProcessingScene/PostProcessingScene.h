@@ -6,6 +6,15 @@
 #include "BasicScene/BaseScene.h"
 #include "System/CRenderTexture.h"
 #include "System/System.h"
+#include "Data/InstanceBatcher.h"
+#include "Data/InstancedRenderer.h"
+#include "Utility/Timer.h"
+#include "Utility/CLazyResourceSet.h"
+#include "Utility/CThreadPool.h"
+#include "Utility/TextureAtlas.h"
+#include "Utility/ColourLUT.h"
+#include "Utility/CPUPostProcess.h"
+#include "Utility/Palette.h"
 
 
 class PostProcessingScene : public BaseScene
@@ -67,6 +76,8 @@ private:
 		Underwater,
 		Pixelation,
 		Vignette,
+		ColourGrade,
+		Palette,
 	};
 	PostProcess CurrentPostProcess = PostProcess::Copy;
 
@@ -79,6 +90,23 @@ private:
 	};
 	PostProcessMode CurrentPostProcessMode = PostProcessMode::Fullscreen;
 
+	//Tags saying which modes and effects use the resources in m_LazyResources
+	enum LazyResourceTag : uint32_t
+	{
+		PolygonModeResources = 1 << 0, // Fisheye render textures, alpha maps, noise and distort maps
+		BlurResources        = 1 << 1, // Intermediate textures of the full-screen blur
+	};
+
+	//An effect's distortion baked by BakeCPUPostProcessRemap, and the texture its shader reads it from
+	struct RemapTexture
+	{
+		CImage map;
+		ID3D11Texture2D*          texture = nullptr;
+		ID3D11ShaderResourceView* resource = nullptr;
+		int   width = 0, height = 0; // Screen size it was baked for
+		float phase = 0.0f;          // UnderwaterEffect it was baked for, only read by the haze
+	};
+
 	//return CurrentPostProcessMode as string
 	std::string GetPostProcessModeString(PostProcessMode m)
 	{
@@ -118,11 +146,61 @@ private:
 	//return the correct shader based on the post-process
 	void SelectPostProcessShaderAndTextures(PostProcess postProcess);
 
+	//Helper Function to select the cut-out mask (and noise map) for the next polygon draw, from the atlas or its own texture
+	void SelectPolygonMask(const std::string& maskName, TextureHandle mask);
+
 	//Post-process rendering full-screen
 	void FullScreenPostProcess(PostProcess postProcess, ID3D11ShaderResourceView* renderResource);
 
+	//Blur a texture with the box Gaussian blur compute shaders into the VerticalBlurTexture
+	void BoxGaussianBlur(ID3D11ShaderResourceView* source);
+
+	//Set the colour grade's chosen effects, baking their colour maps into its table and uploading it when a table is worth it
+	//and they or their settings have changed. Returns false if none are chosen or the 3D texture cannot be created
+	bool UpdateColourLUT();
+
+	//Release the colour grade's 3D texture
+	void ReleaseColourLUT();
+
+	//Bake an effect's distortion over the whole screen into its remap texture when the screen's size or the haze's phase has
+	//changed, and bind it for the effect's shader. Returns false if the texture cannot be created
+	bool UpdateRemap(CPUPostProcess effect, RemapTexture& remap);
+
+	//Release a remap texture
+	void ReleaseRemap(RemapTexture& remap);
+
+	//Build the chosen palette's table of nearest colours when the palette changes and upload it, and set the dither, reading the
+	//blue-noise dither's tile the first time it is chosen. Returns false if the 3D texture cannot be created
+	bool UpdatePaletteLUT();
+
+	//Release the palette's 3D texture and the dither tile's texture
+	void ReleasePaletteLUT();
+
+	//Make the averaged pixelation's texture of a texel a block, returns false if it cannot be created
+	bool UpdatePixelationTexture();
+
+	//Release the averaged pixelation's texture
+	void ReleasePixelationTexture();
+
 	//Common rendering settings when rendering a post-process
 	void FirstRender(ID3D11VertexShader* VertexShader);
+
+	//Point each model at the current mesh for its handle, called when meshes finish loading in the background
+	void RebindModelMeshes();
+
+	//Ask for each model's streamed texture at the size the model covers on screen
+	void RequestTextureSizes();
+
+	//Helper Function to ask for a model's texture at the size the model covers on screen
+	void RequestTextureSize(Model* model, TextureHandle texture);
+
+	//Register the render textures and textures that are only created once a mode or effect needing them is used
+	void AddLazyResources();
+
+	//Helper Functions to register a lazily created render texture or texture with m_LazyResources
+	void AddLazyRenderTexture(const std::string& name, uint32_t tags, CRenderTexture*& renderTexture, DXGI_FORMAT format = DXGI_FORMAT_R16G16B16A16_FLOAT,
+	                          bool unorderedAccess = false);
+	void AddLazyTexture(uint32_t tags, const wchar_t* uniqueID, const std::string& fileName, TextureHandle& handle);
 	
 //-------------------------------------
 // Private members
@@ -150,7 +228,8 @@ private:
 	std::vector<CVector3> m_CloverWindowPoints = { {-7.5,7.5,0}, {-7.5,-7.5,0}, {7.5,7.5,0}, {7.5,-7.5,0} };
 	std::vector<CVector3> m_SquarePoints = { {-5,5,0}, {-5,-5,0}, {5,5,0}, {5,-5,0} };
 
-	//Textures available to be rendered to
+	//Textures available to be rendered to. Only the scene and second pass textures are created up front,
+	//the others belong to m_LazyResources and are null until the mode or effect using them needs them
 	CRenderTexture* m_SceneTexture;
 	CRenderTexture* m_SecondPassTexture;
 	CRenderTexture* m_CameraTexture;
@@ -160,6 +239,52 @@ private:
 	
 	
 
+	//Handles to the meshes and textures in the resource manager, kept from when they were loaded
+	//so that fetching them each frame is an array index rather than a search by name
+	MeshHandle m_StarsMesh;
+	MeshHandle m_GroundMesh;
+	MeshHandle m_CubeMesh;
+	MeshHandle m_Wall1Mesh;
+	MeshHandle m_Wall2Mesh;
+	MeshHandle m_LightMesh;
+	MeshHandle m_ContainerMesh;
+	MeshHandle m_TeapotMesh;
+	MeshHandle m_TrollMesh;
+
+	TextureHandle m_StarsTexture;
+	TextureHandle m_BricksTexture;
+	TextureHandle m_GroundTexture;
+	TextureHandle m_CubeTexture;
+	TextureHandle m_WallsTexture;
+	TextureHandle m_LightsTexture;
+	TextureHandle m_ContainerTexture;
+	TextureHandle m_TeapotTexture;
+	TextureHandle m_TrollTexture;
+
+	//Only loaded once polygon mode is used, see m_LazyResources
+	TextureHandle m_NoiseMap;
+	TextureHandle m_DistortMap;
+	TextureHandle m_SpadeAlphaMap;
+	TextureHandle m_CloverAlphaMap;
+	TextureHandle m_HeartAlphaMap;
+
+	//The alpha maps and noise map share this texture when "AssetTool atlas" has built it, and the separate textures
+	//above are not loaded. It stays bound for all the polygon draws, which only change the rects they sample
+	TextureHandle m_PolygonAtlas;
+	AtlasLayout   m_PolygonAtlasLayout;
+	bool          m_UsePolygonAtlas = false;
+
+	//The masks are signed distance fields when "AssetTool sdf-masks" or "AssetTool atlas" has made them, named with
+	//this suffix ("SDF") and cut out above 0.5 rather than 0.1
+	std::string m_PolygonMaskSuffix;
+	float       m_PolygonMaskThreshold = 0.1f;
+
+	//The grey noise map is a BlueNoiseTileSize tile of blue noise rather than Noise.png, unless the tile is missing from Media
+	//or the atlas is used. Its offset moves along the R2 sequence, a step each frame
+	const uint32_t BlueNoiseTileSize = 64;
+	bool           m_UseBlueNoise = false;
+	uint32_t       m_NoiseFrame = 0;
+
 	//Models in the scene
 	Model* m_StarsModel;
 	Model* m_GroundModel;
@@ -177,6 +302,31 @@ private:
 	CMatrix4x4 m_DiamondMatrix;
 	CMatrix4x4 m_CloverMatrix;
 
+	//The lights share a mesh and texture so they are gathered into instanced batches each frame
+	CInstanceBatcher m_LightBatcher;
+	CInstancedRenderer m_InstancedRenderer;
+
+	//Time from the start of InitGeometry to the first frame being presented. Resources are still loading
+	//in the background at this point, see CResourceManager::getLoadStats for when they finish
+	Timer m_StartupTimer;
+	float m_TimeToFirstFrame = 0.0f;
+
+	//Resources only needed by some modes and effects, created on first use and released after m_IdleReleaseSeconds unused
+	CLazyResourceSet m_LazyResources;
+	float m_IdleReleaseSeconds = 30.0f;
+
+	//Queue the lazy resources for every mode to be created over the first few frames, rather than on first use
+	bool m_PrewarmLazyResources = false;
+
+	//Workers for the tables baked on the CPU, the colour grade's and the palette's. The main thread waits on them
+	CThreadPool m_Threads{ CThreadPool::DefaultThreadCount() };
+
+	//Memory budget for the resource manager, unreferenced resources are evicted when over it
+	int m_MemoryBudgetMB = 256;
+
+	//Texture mips the resource manager may upload each frame as streamed textures sharpen
+	int m_StreamingBudgetMB = 4;
+
 	//Camera used to get the view of the Fisheye effect
 	Camera* m_FisheyeCamera;
 
@@ -204,8 +354,59 @@ private:
 	//Variable to control the pixelation effect
 	int m_PixelWidth = 64;
 
-	//Variable to control the Blue effect
-	int m_BlurOffset = 600;
+	//Pixelate by averaging each block into a texture of a texel a block, made again when the pixel size changes, then
+	//stretching it over the screen, rather than sampling one pixel a block (see RunCPUPixelationAreaAverage)
+	bool m_AveragePixelation = true;
+	CRenderTexture* m_PixelationTexture = nullptr;
+	int m_PixelationTextureSize = 0;
+
+	//Blur with a Gaussian of this standard deviation in pixels, by the box blur compute shaders or by the linear-sampling
+	//blur shaders with taps from ComputeBlurTaps
+	bool  m_BoxGaussianBlur = true;
+	float m_BlurSigma = 8.0f;
+	const float MaxTapBlurSigma = 10.0f; // The blur shaders' taps reach 3 sigma up to this
+
+	//The colour grade runs the chosen effects' colour maps, in this order, on each pixel. When IsColourLUTWorthwhile picks a table
+	//instead, it is baked on the CPU and uploaded to a 3D texture of the table's size again only when the chain, the table or
+	//the settings the maps read change. The gradient's turn is never baked, so does not change it
+	bool  m_GradeGradient = true;
+	bool  m_GradeSaturation = false;
+	bool  m_GradeUnderwater = false;
+	bool  m_GradeGameBoy = false;
+	int   m_ColourLUTSize = 32;
+	float m_ColourLUTRange = 2.5f; // HDR scene colours
+	float m_ColourLUTBakeTime = 0.0f;
+	bool  m_ColourLUTInUse = false;
+	ColourLUT m_ColourLUT;
+	ID3D11Texture3D*          m_ColourLUTTexture = nullptr;
+	ID3D11ShaderResourceView* m_ColourLUTResource = nullptr;
+	uint32_t                  m_ColourLUTTextureSize = 0;
+
+	//What the texture was last baked from
+	std::vector<ColourOperator> m_ColourLUTChain;
+	float    m_ColourLUTSaturation = 0.0f;
+	CVector3 m_ColourLUTLuminanceWeights;
+
+	//Fisheye_ps and Underwater_ps read their uv offsets from these rather than working them out for every pixel. The fisheye's
+	//only changes with the screen's size, the haze's single row with its phase every frame it is used
+	RemapTexture m_FisheyeRemap;
+	RemapTexture m_UnderwaterRemap;
+
+	//The palette effect quantizes the scene to one of GetBuiltInPalettes with an ordered dither, moving colours by the palette's
+	//spread times the strength. Its table of nearest colours is built on the CPU when the palette changes. The blue-noise dither's
+	//thresholds are read from the grain's tile the first time it is chosen, and it dithers with none if that fails
+	int   m_PaletteIndex = 1;
+	int   m_DitherMode = static_cast<int>(DitherMode::InterleavedGradient);
+	float m_DitherStrength = 1.0f;
+	const uint32_t PaletteLUTSize = 32;
+	PaletteLUT m_PaletteLUT;
+	int        m_PaletteLUTIndex = -1; // Palette the table was built for
+	ID3D11Texture3D*          m_PaletteLUTTexture = nullptr;
+	ID3D11ShaderResourceView* m_PaletteLUTResource = nullptr;
+	DitherTile                m_DitherTile;
+	ID3D11Texture2D*          m_DitherTileTexture = nullptr;
+	ID3D11ShaderResourceView* m_DitherTileResource = nullptr;
+	bool                      m_DitherTileFailed = false;
 
 	float m_Feedback = 0.5f;
 };
\ No newline at end of file
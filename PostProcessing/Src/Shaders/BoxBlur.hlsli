@@ -0,0 +1,84 @@
+//--------------------------------------------------------------------------------------
+// Box blur shared by the box Gaussian blur compute shaders
+//--------------------------------------------------------------------------------------
+// Three box blurs one after another approximate a Gaussian (see Utility/GaussianBlur.h). Each
+// group blurs a tile of BOX_BLUR_TILE pixels of one row or column, a thread per pixel. The tile and
+// the pixels its boxes reach are loaded into groupshared memory and summed into prefix sums, so
+// each pixel's box is the difference of two sums whatever the size of the blur. The box is
+// gBoxBlurRadius pixels either side of the centre, plus the pixel just past each end at
+// gBoxBlurEndWeight.
+
+// The texture being blurred and the texture written to, which must be different
+Texture2D<float4>   InputTexture  : register(t0);
+RWTexture2D<float4> OutputTexture : register(u0);
+
+// Pixels of a line blurred by each group, and the largest radius that fits in groupshared memory with them
+#define BOX_BLUR_TILE       256
+#define BOX_BLUR_MAX_RADIUS 512
+#define BOX_BLUR_SEGMENT    (BOX_BLUR_TILE + 2 * BOX_BLUR_MAX_RADIUS + 1)
+#define BOX_BLUR_CHUNK      ((BOX_BLUR_SEGMENT + BOX_BLUR_TILE - 1) / BOX_BLUR_TILE)
+
+// Prefix sums of the pixels from just before the first box of the tile to the end of the last, and of each thread's chunk of them
+groupshared float4 Segment[BOX_BLUR_SEGMENT];
+groupshared float4 ChunkSums[BOX_BLUR_TILE];
+
+// Pixel of a line, clamped to the ends of the line as the scene is sampled by the post-processes
+float4 LinePixel(int2 start, int2 step, int i, int last)
+{
+    return InputTexture[start + step * clamp(i, 0, last)];
+}
+
+// Blur the given tile of the line of length pixels from start, moving by step from one pixel to the next, as the given thread
+// of the group. Every thread of the group must call it
+void BoxBlurTile(int2 start, int2 step, int length, int tile, int thread)
+{
+    int   radius    = min((int)gBoxBlurRadius, BOX_BLUR_MAX_RADIUS);
+    float endWeight = gBoxBlurEndWeight;
+    float scale     = 1.0f / (2 * radius + 1 + 2 * endWeight);
+    int   last      = length - 1;
+    int   first     = tile * BOX_BLUR_TILE - radius - 1; // Pixel of the line in Segment[0]
+    int   count     = BOX_BLUR_TILE + 2 * radius + 1;
+
+    // The pixel in the middle of the tile is taken off every pixel, so the sums stay small and keep their precision
+    float4 base = LinePixel(start, step, tile * BOX_BLUR_TILE + BOX_BLUR_TILE / 2, last);
+    for (int k = thread; k < count; k += BOX_BLUR_TILE)
+    {
+        Segment[k] = LinePixel(start, step, first + k, last) - base;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // Each thread sums its own chunk of the segment, then the chunks' totals are summed across the group
+    int chunkStart = thread * BOX_BLUR_CHUNK;
+    int chunkEnd   = min(chunkStart + BOX_BLUR_CHUNK, count);
+    float4 sum = 0;
+    for (int k = chunkStart; k < chunkEnd; ++k)
+    {
+        sum += Segment[k];
+        Segment[k] = sum;
+    }
+    ChunkSums[thread] = sum;
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (int offset = 1; offset < BOX_BLUR_TILE; offset *= 2)
+    {
+        float4 earlier = thread >= offset ? ChunkSums[thread - offset] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        ChunkSums[thread] += earlier;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    float4 before = thread > 0 ? ChunkSums[thread - 1] : 0;
+    for (int k = chunkStart; k < chunkEnd; ++k)
+    {
+        Segment[k] += before;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // The box from radius before the pixel to radius after is the difference of the sums either side of it
+    int i = tile * BOX_BLUR_TILE + thread;
+    if (i >= length) return;
+    float4 box  = Segment[thread + 2 * radius + 1] - Segment[thread] + (2 * radius + 1) * base;
+    float4 ends = LinePixel(start, step, i - radius - 1, last) + LinePixel(start, step, i + radius + 1, last);
+    OutputTexture[start + step * i] = (box + ends * endWeight) * scale;
+}
@@ -0,0 +1,21 @@
+//--------------------------------------------------------------------------------------
+// Box Gaussian Blur Horizontal Compute Shader
+//--------------------------------------------------------------------------------------
+// One box of the box Gaussian blur across the rows of the texture, a group for each tile of a row
+// and a thread per pixel. Dispatch (width + 255) / 256 by height groups
+
+#include "Common.hlsli"
+#include "BoxBlur.hlsli"
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+[numthreads(BOX_BLUR_TILE, 1, 1)]
+void main(uint3 group : SV_GroupID, uint3 thread : SV_GroupThreadID)
+{
+    uint width, height;
+    InputTexture.GetDimensions(width, height);
+    BoxBlurTile(int2(0, group.y), int2(1, 0), width, group.x, thread.x);
+}
@@ -0,0 +1,21 @@
+//--------------------------------------------------------------------------------------
+// Box Gaussian Blur Vertical Compute Shader
+//--------------------------------------------------------------------------------------
+// One box of the box Gaussian blur down the columns of the texture, a group for each tile of a
+// column and a thread per pixel. Dispatch (height + 255) / 256 by width groups
+
+#include "Common.hlsli"
+#include "BoxBlur.hlsli"
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+[numthreads(BOX_BLUR_TILE, 1, 1)]
+void main(uint3 group : SV_GroupID, uint3 thread : SV_GroupThreadID)
+{
+    uint width, height;
+    InputTexture.GetDimensions(width, height);
+    BoxBlurTile(int2(group.y, 0), int2(0, 1), height, group.x, thread.x);
+}
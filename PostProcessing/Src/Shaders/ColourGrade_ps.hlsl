@@ -0,0 +1,105 @@
+//--------------------------------------------------------------------------------------
+// Colour Grade Post-Processing Pixel Shader
+//--------------------------------------------------------------------------------------
+// Runs a chain of the effects' colour maps on the scene's colour, looking up the maps after the
+// gradient in a table baked on the CPU (see Utility/ColourLUT.h) with tetrahedral interpolation as
+// the CPU does, or running each map here when the chain is too short for a table to pay
+
+#include "Common.hlsli"
+
+
+//--------------------------------------------------------------------------------------
+// Textures (texture maps)
+//--------------------------------------------------------------------------------------
+
+// The scene has been rendered to a texture, these variables allow access to that texture
+Texture2D    SceneTexture : register(t0);
+SamplerState PointSample  : register(s0);
+
+// The table, red across, green down and blue through the slices. It is read with Load as the corners are blended here
+Texture3D<float4> ColourLUT : register(t4);
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+// The gradient's hue turn through HSL, as VerticalColourGradient_ps does. Its lightness is the sum of the largest and smallest
+// channels, so the turned colour can be brighter than the one given
+float3 TurnHue(float3 colour, float turn)
+{
+    float maxComponent = max(colour.r, max(colour.g, colour.b));
+    float minComponent = min(colour.r, min(colour.g, colour.b));
+    float diff = maxComponent - minComponent;
+    float hue = 0;
+    if      (maxComponent == colour.r) hue = 0 + (colour.g - colour.b) / diff;
+    else if (maxComponent == colour.g) hue = 2 + (colour.b - colour.r) / diff;
+    else if (maxComponent == colour.b) hue = 4 + (colour.r - colour.g) / diff;
+
+    hue = frac(frac(hue / 6) + turn);
+    float3 hueRGB = saturate(float3(abs(hue * 6 - 3) - 1, 2 - abs(hue * 6 - 2), 2 - abs(hue * 6 - 4)));
+    return lerp(1, hueRGB, diff / maxComponent) * (minComponent + maxComponent);
+}
+
+// The table's RGBA at a colour. The tetrahedron holding the colour runs from the cube's first corner along the axis the colour
+// is furthest along, then the next furthest, to the opposite corner. Its corners are weighted by the differences between the
+// sorted fractions
+float4 LookupColourLUT(float3 colour)
+{
+    // The cube of entries holding the colour, and how far across it the colour is along each axis
+    float  last = gColourLUTSize - 1;
+    float3 position = clamp(colour * (last / gColourLUTRange), 0, last);
+    float3 index = min(floor(position), last - 1);
+    float3 fraction = position - index;
+
+    int3 axis0 = 0, axis1 = 0;
+    float3 sorted;
+    if (fraction.r >= fraction.g)
+    {
+        if      (fraction.g >= fraction.b) { axis0 = int3(1, 0, 0); axis1 = int3(1, 1, 0); sorted = fraction.rgb; }
+        else if (fraction.r >= fraction.b) { axis0 = int3(1, 0, 0); axis1 = int3(1, 0, 1); sorted = fraction.rbg; }
+        else                               { axis0 = int3(0, 0, 1); axis1 = int3(1, 0, 1); sorted = fraction.brg; }
+    }
+    else
+    {
+        if      (fraction.r >= fraction.b) { axis0 = int3(0, 1, 0); axis1 = int3(1, 1, 0); sorted = fraction.grb; }
+        else if (fraction.g >= fraction.b) { axis0 = int3(0, 1, 0); axis1 = int3(0, 1, 1); sorted = fraction.gbr; }
+        else                               { axis0 = int3(0, 0, 1); axis1 = int3(0, 1, 1); sorted = fraction.bgr; }
+    }
+
+    int3 corner = int3(index);
+    return ColourLUT.Load(int4(corner, 0))                 * (1 - sorted.x) +
+           ColourLUT.Load(int4(corner + axis0, 0))         * (sorted.x - sorted.y) +
+           ColourLUT.Load(int4(corner + axis1, 0))         * (sorted.y - sorted.z) +
+           ColourLUT.Load(int4(corner + int3(1, 1, 1), 0)) * sorted.z;
+}
+
+float4 main(PostProcessingInput input) : SV_Target
+{
+	float4 colour = float4(SceneTexture.Sample(PointSample, input.sceneUV).rgb, 1);
+
+    // The gradient changes down the screen and over time so is never in the table
+    uint operators = uint(gColourGradeOperators);
+    if (operators & 1)
+    {
+        colour.rgb = TurnHue(colour.rgb + lerp(gTintColour1, gTintColour2, input.sceneUV.y), gUnderwaterEffect / 10);
+    }
+    if (gColourLUTSize > 0) return LookupColourLUT(colour.rgb);
+
+    // Without a table the other maps run in turn, each writing all four channels as its effect does
+    if (operators & 2)
+    {
+        float luminance = dot(colour.rgb, gLuminanceWeights);
+        colour = float4(lerp(luminance, colour.rgb, saturationLevel), (colour.r + colour.g + colour.b) / 3);
+    }
+    if (operators & 4)
+    {
+        float3 tinted = colour.rgb + float3(0.0f, 0.0f, 0.55f);
+        colour = float4(tinted * dot(tinted, gLuminanceWeights), 0);
+    }
+    if (operators & 8)
+    {
+        colour = GameBoyPalette(dot(colour.rgb, gLuminanceWeights));
+    }
+    return colour;
+}
@@ -15,6 +15,21 @@ struct BasicVertex
     float2 uv       : uv;
 };
 
+// The vertex data for instanced rendering. The mesh vertex as above from the first vertex buffer plus the per-instance
+// data from the instance buffer - must match InstanceData in InstanceBatcher.h (world matrix passed as four rows)
+struct InstancedVertex
+{
+    float3 position : position;
+    float3 normal   : normal;
+    float2 uv       : uv;
+
+    float4 worldRow0 : instanceWorld0;
+    float4 worldRow1 : instanceWorld1;
+    float4 worldRow2 : instanceWorld2;
+    float4 worldRow3 : instanceWorld3;
+    float3 colour    : instanceColour;
+};
+
 // This structure describes what data the lighting pixel shader receives from the vertex shader.
 // The projected position is a required output from all vertex shaders - where the vertex is on the screen
 // The world position and normal at the vertex are sent to the pixel shader for the lighting equations.
@@ -40,6 +55,14 @@ struct SimplePixelShaderInput
     float2 uv                : uv;
 };
 
+// As above but the tint colour comes from the instance data rather than the per-model constant buffer
+struct InstancedPixelShaderInput
+{
+    float4 projectedPosition : SV_Position;
+    float2 uv                : uv;
+    float3 colour            : colour;
+};
+
 //**************************
 
 // The vertex data received by each post-process shader. Just the 2d projected position (pixel coordinate on screen), 
@@ -156,7 +179,56 @@ cbuffer PostProcessingConstants : register(b1)
     float gBlurOffset;
 
     float Epsilon;
-    float3 paddingG;
+
+    // Box Gaussian blur settings
+    float gBoxBlurRadius;    // Whole pixels either side of the centre of each box
+    float gBoxBlurEndWeight; // Weight of the pixel just past each end of the box
+    float gBlurTapCount;     // Taps of the linear-sampling blur in use
+
+    // Linear-sampling blur taps - pixels from the centre (x) and weight (y). The first is the centre, the others are
+    // fetched either side of it
+    float4 gBlurTaps[16];
+
+    // Polygon post-process masks - offset (xy) and size (zw) of the mask and noise map in the bound texture
+    float4 gMaskRect;
+    float4 gLookupRect;
+    float  gMaskThreshold; // The mask is cut out above this - 0.1 for an alpha map, 0.5 for a signed distance field
+
+    // Colour grade settings
+    float  gColourGradeOperators; // Bits of the operators run on each pixel - 1 gradient, 2 saturation, 4 underwater tint, 8 Gameboy
+    float  gColourLUTSize;        // Entries along each axis of the table, 0 to run the whole chain on each pixel
+    float  gColourLUTRange;       // Each channel from 0 to this spans the entries
+
+    // Palette settings
+    float  gPaletteLUTSize; // Entries along each axis of the table of nearest colours
+    float  gDitherMode;     // 0 none, 1 Bayer, 2 interleaved gradient noise, 3 blue noise
+    float  gDitherSpread;   // Ordered dithers move colours by up to half this either way
+    float  paddingF;
 }
 //**************************
 
+
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+// Sample one entry of a texture atlas, given its rect (offset in xy, size in zw). The uv repeats across the entry and the
+// gutter around each entry covers the filtering at its edges. The uv gradients are scaled down to the entry so the same
+// mip is chosen as for a texture of its own, and taken before the repeat so there is no seam where frac jumps back to 0.
+// With a rect of (0, 0, 1, 1) this samples a whole texture as usual
+float4 SampleAtlas(Texture2D atlas, SamplerState samplerState, float2 uv, float4 rect)
+{
+    return atlas.SampleGrad(samplerState, rect.xy + frac(uv) * rect.zw, ddx(uv) * rect.zw, ddy(uv) * rect.zw);
+}
+
+// The four greens of the pixelation's palette, by luminance, with the luminance as alpha
+float4 GameBoyPalette(float luminance)
+{
+    float3 colour;
+    if      (luminance > 0.75f) colour = float3(0.7333f, 0.8118f, 0.3647f);
+    else if (luminance > 0.5f)  colour = float3(0.5412f, 0.6706f, 0.0588f);
+    else if (luminance > 0.25f) colour = float3(0.1882f, 0.3804f, 0.1882f);
+    else                        colour = float3(0.0588f, 0.2196f, 0.0588f);
+    return float4(colour, luminance);
+}
@@ -16,7 +16,9 @@ SamplerState PointSample  : register(s0); // We don't usually want to filter (bi
                                           // post-processing so this sampler will use "point sampling" - no filtering
 
 // This shader also uses a "distortion" texture, which containts 2D vectors (in R & G) to shift the texture UVs to give a cut-glass impression
-Texture2D    DistortMap    : register(t1);
+// It is bound after the slots of the mask and noise map used by the other polygon effects (see GreyNoise_ps.hlsl), which
+// can then stay bound
+Texture2D    DistortMap    : register(t3);
 SamplerState TrilinearWrap : register(s1);
 
 //Texture that will be used with alpha blending to cut out the shape of the hole in the wall
@@ -35,8 +37,8 @@ float4 main(PostProcessingInput input) : SV_Target
 	// Get distort texture colour
     float3 distortTexture = DistortMap.Sample( TrilinearWrap, input.areaUV ).rgb;
 
-	// Get direction (2D vector) to distort UVs from the g & b components of the distortion texture ()
-	float2 distortVector = distortTexture.gb;
+	// Get direction (2D vector) to distort UVs from the r & g components of the distortion texture, which is all BC5 keeps
+	float2 distortVector = distortTexture.rg;
 	
 	// Converting from UV 0->1 range to -0.5->0.5 range
 	distortVector -= float2(0.5f, 0.5f);
@@ -48,11 +50,11 @@ float4 main(PostProcessingInput input) : SV_Target
 	float3 outputColour = light + SceneTexture.Sample(PointSample, input.sceneUV + gDistortLevel * distortVector).rgb * glassDarken;
 
 	//get the colour value of the alpha map
-    float alpha = AlphaMap.Sample(TrilinearWrap, input.areaUV).r;
+    float alpha = SampleAtlas(AlphaMap, TrilinearWrap, input.areaUV, gMaskRect).r;
 	
-	//if the value is greater than 0.1, then we want to cut out the shape of the hole in the wall
+	//if the value is greater than the mask threshold (0.1 for an alpha map, 0.5 for a distance field), then we want to cut out the shape of the hole in the wall
 	//by discarding this pixel
-    if (alpha > 0.1f)
+    if (alpha > gMaskThreshold)
     {
         discard;
     }
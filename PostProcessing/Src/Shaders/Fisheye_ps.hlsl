@@ -7,24 +7,15 @@
 Texture2D SceneTexture : register(t0);
 SamplerState PointSample : register(s0);
 
+// The uv offset to the distorted point for each point of the area, baked on the CPU (see BakeCPUPostProcessRemap) so each
+// pixel takes one bilinear fetch rather than an atan2, pow, cos and sin
+Texture2D<float2> RemapMap      : register(t5);
+SamplerState      BilinearClamp : register(s2);
+
 //--------------------------------------------------------------------------------------
 // Shader code
 //--------------------------------------------------------------------------------------
 
-//Distort the pixel coordinates 
-float2 distort(float2 pos)
-{
-    //Create the distortion around a circle
-    float power = 1.5f;
-    float theta = atan2(pos.y, pos.x);
-    float radius = length(pos);
-    radius = pow(radius, power);
-    pos.x = radius * cos(theta);
-    pos.y = radius * sin(theta);
-
-    return 0.5 * (pos + 1.0);
-}
-
 float4 main(PostProcessingInput input) : SV_TARGET
 {
     //Calculate the pixel position in the scene texture
@@ -33,8 +24,8 @@ float4 main(PostProcessingInput input) : SV_TARGET
     //Get the length of the pixels UV coordinates
     float d = length(xy);
 
-    //Calculate the distoted UV coordinates
-    float2 uv = distort(xy);
+    //Offset the UV coordinates by the distortion around the circle, read from the offsets baked on the CPU
+    float2 uv = input.areaUV + RemapMap.Sample(BilinearClamp, input.areaUV);
     
     //Calculate the colour of the texture at the new UV coordinates
     //and if the value is greater than 1 set the pixel to black create a circle effect
@@ -38,14 +38,14 @@ float4 main(PostProcessingInput input) : SV_Target
     float grey = (sceneColour.r + sceneColour.g + sceneColour.b) / 3.0f;
 
 	// Get noise UV by scaling and offseting scene texture UV. Scaling adjusts how fine the noise is.
-	// The offset is randomised every frame (in C++) to give a constantly changing noise effect (like tv static)
+	// The offset changes every frame (in C++) to give a constantly changing noise effect (like tv static)
     float2 noiseUV = input.sceneUV * gNoiseScale + gNoiseOffset;
-    grey += NoiseStrength * (NoiseMap.Sample(TrilinearWrap, noiseUV).r - 0.5f); // Noise can increase or decrease grey value hence the -0.5f
+    grey += NoiseStrength * (SampleAtlas(NoiseMap, TrilinearWrap, noiseUV, gLookupRect).r - 0.5f); // Noise can increase or decrease grey value hence the -0.5f
 
-    //if the value is greater than 0.1, then we want to cut out the shape of the hole in the wall
+    //if the value is greater than the mask threshold (0.1 for an alpha map, 0.5 for a distance field), then we want to cut out the shape of the hole in the wall
 	//by discarding this pixel
-    float alphaMap = AlphaMap.Sample(TrilinearWrap, input.areaUV).r;
-    if (alphaMap > 0.1f)
+    float alphaMap = SampleAtlas(AlphaMap, TrilinearWrap, input.areaUV, gMaskRect).r;
+    if (alphaMap > gMaskThreshold)
     {
         discard;
     }
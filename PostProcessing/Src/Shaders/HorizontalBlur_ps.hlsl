@@ -7,11 +7,8 @@
 Texture2D shaderTexture;
 SamplerState SampleType;
 
-//Kernel offsets taken from the Gaussian blur algorithm
-static const float kernelOffsets[3] = { 0.0f, 1.3846153846f, 3.2307692308f };
-
-//Blur values to multiply the sampled colours by
-static const float BlurWeights[3] = { 0.2270270270f, 0.3162162162f, 0.0702702703f };
+//The taps of the Gaussian kernel are in gBlurTaps (see Utility/BlurKernel.h). Each is between two pixels, so sampling with
+//bilinear filtering reads the pair weighted by the kernel in one fetch
 
 //--------------------------------------------------------------------------------------
 // Shader code
@@ -19,20 +16,23 @@ static const float BlurWeights[3] = { 0.2270270270f, 0.3162162162f, 0.0702702703
 
 float4 main(PostProcessingInput input) : SV_TARGET
 {   
-    //Multiply the value returned from the texture at the current UV coordinates by the kernel weights
-    float3 textureColour = shaderTexture.Sample(SampleType, (input.sceneUV)).rgb * BlurWeights[0];
+    //The size of one pixel along the x axis in UVs
+    float width, height;
+    shaderTexture.GetDimensions(width, height);
+    float2 pixelStep = float2(1.0f / width, 0.0f);
+
+    //Multiply the value returned from the texture at the current UV coordinates by the centre weight
+    float3 textureColour = shaderTexture.Sample(SampleType, input.sceneUV).rgb * gBlurTaps[0].y;
     
-    //loop thruogh the kernel offsets
-    for (int i = 1; i < 3; ++i)
+    //loop through the other taps
+    int tapCount = (int)gBlurTapCount;
+    for (int i = 1; i < tapCount; ++i)
     {
-        //Normalise the Kernal offsets with the BlurWidth along the X axis
-        float normalisedOffset = float2(kernelOffsets[i], 0.0f) / gBlurWidth;
+        float2 offset = pixelStep * gBlurTaps[i].x;
 
-        //add the colour sampled from the texture at the next positive x value from the sceneUV to the original colour
-        textureColour += shaderTexture.Sample(SampleType, input.sceneUV + normalisedOffset).rgb * BlurWeights[i];
-        
-        //add the colour sampled from the texture at the next negative x value from the sceneUV to the original colour
-        textureColour += shaderTexture.Sample(SampleType,input.sceneUV -  normalisedOffset).rgb * BlurWeights[i];
+        //add the colours sampled from the texture either side of the sceneUV, weighted by the tap
+        textureColour += shaderTexture.Sample(SampleType, input.sceneUV + offset).rgb * gBlurTaps[i].y;
+        textureColour += shaderTexture.Sample(SampleType, input.sceneUV - offset).rgb * gBlurTaps[i].y;
     }
     
     //Return the final colour of pixel
@@ -0,0 +1,31 @@
+//--------------------------------------------------------------------------------------
+// Instanced Model Pixel Shader
+//--------------------------------------------------------------------------------------
+// Pixel shader samples a diffuse texture map and tints with the colour of the instance being drawn
+
+#include "Common.hlsli" // Shaders can also use include files - note the extension
+
+
+//--------------------------------------------------------------------------------------
+// Textures (texture maps)
+//--------------------------------------------------------------------------------------
+
+Texture2D    DiffuseMap : register(t0); // The diffuse map shared by all instances in the draw call
+SamplerState TexSampler : register(s0);
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+// Same as TintedTexture_ps except the tint comes from the instance data rather than a constant buffer
+float4 main(InstancedPixelShaderInput input) : SV_Target
+{
+    // Sample diffuse material colour for this pixel, ignoring any alpha in the texture
+    float3 diffuseMapColour = DiffuseMap.Sample(TexSampler, input.uv).rgb;
+
+    // Blend texture colour with the per-instance colour
+    float3 finalColour = input.colour * diffuseMapColour;
+
+    return float4(finalColour, 1.0f);
+}
@@ -0,0 +1,34 @@
+//--------------------------------------------------------------------------------------
+// Instanced Model Vertex Shader
+//--------------------------------------------------------------------------------------
+// Basic matrix transformations only, with the world matrix and tint taken from the instance buffer
+
+#include "Common.hlsli" // Shaders can also use include files - note the extension
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+// Same as BasicTransform_vs except each instance brings its own world matrix and colour, so many
+// copies of a mesh can be drawn with a single draw call
+InstancedPixelShaderInput main(InstancedVertex modelVertex)
+{
+    InstancedPixelShaderInput output; // This is the data the pixel shader requires from this vertex shader
+
+    // Rebuild the instance's world matrix from its four rows
+    float4x4 worldMatrix = float4x4(modelVertex.worldRow0, modelVertex.worldRow1, modelVertex.worldRow2, modelVertex.worldRow3);
+
+    // Transform the model vertex into world space using the instance matrix (matrix is stored in rows so the
+    // vector goes on the left), then into view space and 2D projection space as usual
+    float4 modelPosition = float4(modelVertex.position, 1);
+    float4 worldPosition = mul(modelPosition, worldMatrix);
+    float4 viewPosition  = mul(gViewMatrix, worldPosition);
+    output.projectedPosition = mul(gProjectionMatrix, viewPosition);
+
+    // Pass texture coordinates and the instance tint on to the pixel shader
+    output.uv = modelVertex.uv;
+    output.colour = modelVertex.colour;
+
+    return output; // Ouput data sent down the pipeline (to the pixel shader)
+}
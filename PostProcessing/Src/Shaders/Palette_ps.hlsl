@@ -0,0 +1,68 @@
+//--------------------------------------------------------------------------------------
+// Palette Post-Processing Pixel Shader
+//--------------------------------------------------------------------------------------
+// Quantizes the scene to a palette with an ordered dither, as QuantizeToPalette does on the CPU (see Utility/Palette.h).
+// The nearest palette colour to each of a grid of colours is baked on the CPU into a 3D texture
+
+#include "Common.hlsli"
+
+
+//--------------------------------------------------------------------------------------
+// Textures (texture maps)
+//--------------------------------------------------------------------------------------
+
+// The scene has been rendered to a texture, these variables allow access to that texture
+Texture2D    SceneTexture : register(t0);
+SamplerState PointSample  : register(s0);
+
+// The palette colour nearest each entry's colour, red across, green down and blue through the slices
+Texture3D<float4> PaletteLUT : register(t4);
+
+// The blue-noise dither's thresholds, read on the CPU from the shipped tile of blue noise (see LoadDitherTile) and repeated
+// across the screen
+Texture2D<float> DitherTile : register(t5);
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+// Threshold 0->1 of the ordered dither at a pixel, 0.5 for none
+float DitherThreshold(uint2 pixel)
+{
+    if (gDitherMode == 1)
+    {
+        // The 8x8 Bayer matrix is the bits of x ^ y and y interleaved, then reversed
+        uint xy = pixel.x ^ pixel.y;
+        uint index = 0;
+        [unroll]
+        for (uint bit = 0; bit < 3; ++bit)
+        {
+            index |= ((xy >> bit) & 1) << (5 - 2 * bit);
+            index |= ((pixel.y >> bit) & 1) << (4 - 2 * bit);
+        }
+        return (index + 0.5f) / 64.0f;
+    }
+    if (gDitherMode == 2)
+    {
+        // Interleaved gradient noise (Jimenez), little of it at low frequencies
+        return frac(52.9829189f * frac(0.06711056f * pixel.x + 0.00583715f * pixel.y));
+    }
+    if (gDitherMode == 3)
+    {
+        uint2 size;
+        DitherTile.GetDimensions(size.x, size.y);
+        return DitherTile.Load(int3(pixel % size, 0));
+    }
+    return 0.5f;
+}
+
+float4 main(PostProcessingInput input) : SV_Target
+{
+    float3 colour = SceneTexture.Sample(PointSample, input.sceneUV).rgb;
+    colour += (DitherThreshold(uint2(input.projectedPosition.xy)) - 0.5f) * gDitherSpread;
+
+    // The entry nearest the colour, clamped to 0->1
+    int3 entry = int3(saturate(colour) * (gPaletteLUTSize - 1) + 0.5f);
+    return float4(PaletteLUT.Load(int4(entry, 0)).rgb, 1.0f);
+}
@@ -0,0 +1,48 @@
+//--------------------------------------------------------------------------------------
+// Pixelation Average Post-Processing Pixel Shader
+//--------------------------------------------------------------------------------------
+// Drawn into a target with a texel for each of the pixelation's blocks (gPixelWidth by gPixelHeight). Averages the
+// pixels of the scene whose centres the pixelation snaps to the block and picks the palette's green for the average, as
+// RunCPUPixelationAreaAverage does on the CPU. The target is then stretched over the screen with point sampling, which
+// fills each block with its texel
+
+#include "Common.hlsli"
+
+
+//--------------------------------------------------------------------------------------
+// Textures (texture maps)
+//--------------------------------------------------------------------------------------
+
+// The scene has been rendered to a texture, it is read with Load as every pixel of the block is added up
+Texture2D SceneTexture : register(t0);
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+float4 main(PostProcessingInput input) : SV_Target
+{
+    float2 sceneSize;
+    SceneTexture.GetDimensions(sceneSize.x, sceneSize.y);
+
+    // The block this texel is, and the pixels whose centres floor to it when scaled by the blocks across and down
+    float2 blocks = float2(gPixelWidth, gPixelHeight);
+    float2 block = floor(input.sceneUV * blocks);
+    int2 first = int2(ceil(block * sceneSize / blocks - 0.5f));
+    int2 end   = int2(ceil((block + 1) * sceneSize / blocks - 0.5f));
+
+    float4 sum = 0;
+    [loop]
+    for (int y = first.y; y < end.y; ++y)
+    {
+        [loop]
+        for (int x = first.x; x < end.x; ++x)
+        {
+            sum += SceneTexture.Load(int3(x, y, 0));
+        }
+    }
+    float4 colour = sum / max((end.x - first.x) * (end.y - first.y), 1);
+
+    return GameBoyPalette(dot(colour.rgb, gLuminanceWeights));
+}
@@ -30,24 +30,6 @@ float4 main(PostProcessingInput input) : SV_TARGET
     //Calculate the luminance value of the pixel's colour by performing a dot product between the pixel's colour and the and the luminance vector
     float luminance = dot(colour.rgb, gLuminanceWeights);
     
-    //return the correct shade of green based on the luminance value of the pixel
-    if (luminance > 0.75f)
-    {
-        colour.rgb = float3(0.7333f, 0.8118f, 0.3647f);
-    }
-    else if (luminance > 0.5f)
-    {
-        colour.rgb = float3(0.5412f, 0.6706f, 0.0588f);
-    }
-    else if (luminance > 0.25f)
-    {
-        colour.rgb = float3(0.1882f, 0.3804f, 0.1882f);
-    }
-    else
-    {
-        colour.rgb = float3(0.0588f, 0.2196f, 0.0588f);
-    }
-        
-    //Return the final colour
-    return float4(colour.rgb, luminance);
+    //return the correct shade of green based on the luminance value of the pixel, with the luminance as alpha
+    return GameBoyPalette(luminance);
 }
\ No newline at end of file
@@ -8,8 +8,9 @@
 Texture2D    SceneTexture : register(t0);
 SamplerState PointSample  : register(s0); // We don't usually want to filter (bilinear, trilinear etc.) the scene texture when
                                           // post-processing so this sampler will use "point sampling" - no filtering
-//Texture that will be used with alpha blending to cut out the shape of the hole in the wall
-Texture2D AlphaMap : register(t1);
+//Texture that will be used with alpha blending to cut out the shape of the hole in the wall. It is bound to the same slot
+//as in the other polygon effects so a mask atlas can stay bound between them
+Texture2D AlphaMap : register(t2);
 SamplerState TrilinearWrap : register(s1);
 //--------------------------------------------------------------------------------------
 // Shader code
@@ -20,7 +21,7 @@ float4 main(PostProcessingInput input) : SV_Target
 
 {
     //get the colour value of the alpha map
-    float4 alphaMap = AlphaMap.Sample(TrilinearWrap, input.areaUV);
+    float4 alphaMap = SampleAtlas(AlphaMap, TrilinearWrap, input.areaUV, gMaskRect);
     
     //Sample the colour from the sceneTexture from the current UV coordinates
     float4 outputColour = SceneTexture.Sample(PointSample, input.sceneUV);
@@ -32,9 +33,9 @@ float4 main(PostProcessingInput input) : SV_Target
     float4 dstPixel = lerp(luminance, outputColour, saturationLevel);
     dstPixel.a = (outputColour.r + outputColour.g + outputColour.b) / 3;
     
-    //if the value is greater than 0.1, then we want to cut out the shape of the hole in the wall
+    //if the value is greater than the mask threshold (0.1 for an alpha map, 0.5 for a distance field), then we want to cut out the shape of the hole in the wall
 	//by discarding this pixel
-    if (alphaMap.r > 0.1f)
+    if (alphaMap.r > gMaskThreshold)
     {
         discard;
 
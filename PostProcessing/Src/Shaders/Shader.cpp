@@ -20,6 +20,8 @@ ID3D11VertexShader*   gBasicTransformVertexShader = nullptr;
 ID3D11VertexShader*   gPixelLightingVertexShader  = nullptr;
 ID3D11PixelShader*    gTintedTexturePixelShader   = nullptr;
 ID3D11PixelShader*    gPixelLightingPixelShader   = nullptr;
+ID3D11VertexShader*   gInstancedTransformVertexShader    = nullptr;
+ID3D11PixelShader*    gInstancedTintedTexturePixelShader = nullptr;
 
 
 //*******************************
@@ -36,10 +38,16 @@ ID3D11PixelShader*  gPixelationPostProcess = nullptr;
 ID3D11PixelShader* gVignettePostProcess = nullptr;
 ID3D11PixelShader* gHorizontalBlurPostProcess = nullptr;
 ID3D11PixelShader* gVerticalBlurPostProcess = nullptr;
+ID3D11PixelShader* gColourGradePostProcess = nullptr;
+ID3D11PixelShader* gPixelationAveragePostProcess = nullptr;
+ID3D11PixelShader* gPalettePostProcess = nullptr;
 
 ID3D11VertexShader* g2DQuadVertexShader = nullptr;
 ID3D11PixelShader* gFishEyeShader = nullptr;
 
+ID3D11ComputeShader* gBoxBlurHorizontalShader = nullptr;
+ID3D11ComputeShader* gBoxBlurVerticalShader   = nullptr;
+
 
 //--------------------------------------------------------------------------------------
 // Shader creation / destruction
@@ -55,6 +63,8 @@ bool LoadShaders(std::string LastError)
 	gPixelLightingVertexShader	= LoadVertexShader("Src/Shaders/PixelLighting_vs");
 	gTintedTexturePixelShader	= LoadPixelShader("Src/Shaders/TintedTexture_ps");
 	gPixelLightingPixelShader	= LoadPixelShader("Src/Shaders/PixelLighting_ps");
+	gInstancedTransformVertexShader    = LoadVertexShader("Src/Shaders/InstancedTransform_vs");
+	gInstancedTintedTexturePixelShader = LoadPixelShader("Src/Shaders/InstancedTintedTexture_ps");
 
 	//***************************************
 	//**** Post processing shaders
@@ -73,6 +83,12 @@ bool LoadShaders(std::string LastError)
 	gHorizontalBlurPostProcess = LoadPixelShader("Src/Shaders/HorizontalBlur_ps");
 	gVerticalBlurPostProcess   = LoadPixelShader("Src/Shaders/VerticalBlur_ps");
 	gFishEyeShader			   = LoadPixelShader("Src/Shaders/Fisheye_ps");
+	gColourGradePostProcess    = LoadPixelShader("Src/Shaders/ColourGrade_ps");
+	gPixelationAveragePostProcess = LoadPixelShader("Src/Shaders/PixelationAverage_ps");
+	gPalettePostProcess        = LoadPixelShader("Src/Shaders/Palette_ps");
+
+	gBoxBlurHorizontalShader   = LoadComputeShader("Src/Shaders/BoxBlurHorizontal_cs");
+	gBoxBlurVerticalShader     = LoadComputeShader("Src/Shaders/BoxBlurVertical_cs");
 
 	if (gBasicTransformVertexShader == nullptr || gPixelLightingVertexShader == nullptr ||
 		gTintedTexturePixelShader   == nullptr || gPixelLightingPixelShader  == nullptr || 
@@ -82,7 +98,10 @@ bool LoadShaders(std::string LastError)
 		gSaturationPostProcess      == nullptr || g2DPolygonVertexShader     == nullptr ||
 		gPixelationPostProcess      == nullptr || gVignettePostProcess       == nullptr ||
 		gHorizontalBlurPostProcess  == nullptr || gFishEyeShader			 == nullptr || 
-		gVerticalBlurPostProcess    == nullptr)
+		gVerticalBlurPostProcess    == nullptr || gInstancedTransformVertexShader == nullptr ||
+		gInstancedTintedTexturePixelShader == nullptr || gBoxBlurHorizontalShader == nullptr ||
+		gBoxBlurVerticalShader      == nullptr || gColourGradePostProcess    == nullptr ||
+		gPixelationAveragePostProcess == nullptr || gPalettePostProcess        == nullptr)
 	{
 		LastError = "Error loading shaders";
 		return false;
@@ -111,6 +130,13 @@ void ReleaseShaders()
 	if (g2DQuadVertexShader) 						 g2DQuadVertexShader		->Release();
 	if (gFishEyeShader) 							 gFishEyeShader				->Release();
 	if (gVerticalBlurPostProcess)					 gVerticalBlurPostProcess	->Release();
+	if (gInstancedTransformVertexShader)			 gInstancedTransformVertexShader   ->Release();
+	if (gInstancedTintedTexturePixelShader)			 gInstancedTintedTexturePixelShader->Release();
+	if (gBoxBlurHorizontalShader)					 gBoxBlurHorizontalShader   ->Release();
+	if (gBoxBlurVerticalShader)						 gBoxBlurVerticalShader     ->Release();
+	if (gColourGradePostProcess)					 gColourGradePostProcess    ->Release();
+	if (gPixelationAveragePostProcess)				 gPixelationAveragePostProcess->Release();
+	if (gPalettePostProcess)						 gPalettePostProcess        ->Release();
 }
 
 
@@ -253,6 +279,40 @@ ID3D11PixelShader* LoadPixelShader(std::string shaderName)
 }
 
 
+// Load a compute shader, include the file in the project and pass the name (without the .hlsl extension)
+// to this function. The returned pointer needs to be released before quitting. Returns nullptr on failure. 
+// Basically the same code as above but for compute shaders
+ID3D11ComputeShader* LoadComputeShader(std::string shaderName)
+{
+	// Open compiled shader object file
+	std::ifstream shaderFile(shaderName + ".cso", std::ios::in | std::ios::binary | std::ios::ate);
+	if (!shaderFile.is_open())
+	{
+		return nullptr;
+	}
+
+	// Read file into vector of chars
+	std::streamoff fileSize = shaderFile.tellg();
+	shaderFile.seekg(0, std::ios::beg);
+	std::vector<char>byteCode(fileSize);
+	shaderFile.read(&byteCode[0], fileSize);
+	if (shaderFile.fail())
+	{
+		return nullptr;
+	}
+
+	// Create shader object from loaded file (we will use the object later when rendering)
+	ID3D11ComputeShader* shader;
+	HRESULT hr = gD3DDevice->CreateComputeShader(byteCode.data(), byteCode.size(), nullptr, &shader);
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	return shader;
+}
+
+
 
 // Very advanced topic: When creating a vertex layout for geometry (see Scene.cpp), you need the signature
 // (bytecode) of a shader that uses that vertex layout. This is an annoying requirement and tends to create
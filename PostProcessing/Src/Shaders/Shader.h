@@ -20,6 +20,8 @@ extern ID3D11VertexShader*   gBasicTransformVertexShader;
 extern ID3D11VertexShader*   gPixelLightingVertexShader;
 extern ID3D11PixelShader*    gTintedTexturePixelShader;
 extern ID3D11PixelShader*    gPixelLightingPixelShader;
+extern ID3D11VertexShader*   gInstancedTransformVertexShader;
+extern ID3D11PixelShader*    gInstancedTintedTexturePixelShader;
 
 //*******************************
 //**** Post-processing shader DirectX objects
@@ -35,11 +37,17 @@ extern ID3D11PixelShader*  gVignettePostProcess;
 
 extern ID3D11PixelShader* gHorizontalBlurPostProcess;
 extern ID3D11PixelShader* gVerticalBlurPostProcess;
+extern ID3D11PixelShader* gColourGradePostProcess;
+extern ID3D11PixelShader* gPixelationAveragePostProcess;
+extern ID3D11PixelShader* gPalettePostProcess;
 
 extern ID3D11VertexShader* g2DQuadVertexShader;
 
 extern ID3D11PixelShader* gFishEyeShader;
 
+extern ID3D11ComputeShader* gBoxBlurHorizontalShader;
+extern ID3D11ComputeShader* gBoxBlurVerticalShader;
+
 
 
 //--------------------------------------------------------------------------------------
@@ -71,6 +79,7 @@ ID3D11Buffer* CreateConstantBuffer(int size);
 ID3D11VertexShader*   LoadVertexShader  (std::string shaderName);
 ID3D11GeometryShader* LoadGeometryShader(std::string shaderName);
 ID3D11PixelShader*    LoadPixelShader   (std::string shaderName);
+ID3D11ComputeShader*  LoadComputeShader (std::string shaderName);
 
 // Special method to load a geometry shader that can use the stream-out stage, Use like the other functions in this file except
 // also pass the stream out declaration, number of entries in the declaration and the size of each output element. 
@@ -8,6 +8,11 @@
 Texture2D    SceneTexture : register(t0);
 SamplerState PointSample  : register(s0);
 
+// The haze's offset down the scene for each point across the area, in a single row baked on the CPU each frame (see
+// BakeCPUPostProcessRemap) so each pixel takes one bilinear fetch rather than a sine. It is unscaled by the area's height
+Texture2D<float2> RemapMap      : register(t5);
+SamplerState      BilinearClamp : register(s2);
+
 //--------------------------------------------------------------------------------------
 // Shader code
 //--------------------------------------------------------------------------------------
@@ -15,19 +20,12 @@ SamplerState PointSample  : register(s0);
 // Post-processing shader that tints the scene texture to a given colour
 float4 main(PostProcessingInput input) : SV_Target
 {
-	const float effectStrength = 0.015f;
-	
 	// Calculate alpha to display the effect in a softened circle, could use a texture rather than calculations for the same task.
 	// Uses the second set of area texture coordinates, which range from (0,0) to (1,1) over the area being processed
     float alpha = 0;
 
-	// Haze is a combination of sine waves in x and y dimensions
-	float SinX = sin(input.areaUV.x * radians(250.0f) + gUnderwaterEffect * 4.0f);
-    float SinY = sin(input.areaUV.y * radians(250.0f) + gUnderwaterEffect * 4.0f);
-	
-	// Offset for scene texture UV based on haze effect
-	// Adjust size of UV offset based on the constant EffectStrength, the overall size of area being processed, and the alpha value calculated above
-	float2 hazeOffset = float2(0, SinX) * effectStrength * gArea2DSize;
+	// Haze moves the scene texture UV up and down by the sine wave's offset baked on the CPU, scaled by the height of the area
+	float2 hazeOffset = float2(0, RemapMap.Sample(BilinearClamp, float2(input.areaUV.x, 0.5f)).y * gArea2DSize.y);
 
 	// Get pixel from scene texture, offset using haze
     float3 UnderWaterColourTint = { 0.0f, 0.0f, 0.55f };
@@ -6,8 +6,10 @@ CRenderTexture::CRenderTexture()
 	m_renderTargetTexture = 0;
 	m_renderTargetView = 0;
 	m_shaderResourceView = 0;
+	m_unorderedAccessView = 0;
 	m_depthStencilBuffer = 0;
 	m_depthStencilView = 0;
+	m_format = DXGI_FORMAT_R16G16B16A16_FLOAT;
 }
 
 //Deconstructor
@@ -15,8 +17,8 @@ CRenderTexture::~CRenderTexture()
 {
 }
 
-//Initialise the texture and depth buffer with the required width and height
-bool CRenderTexture::Initialize(ID3D11Device* device, int textureWidth, int textureHeight)
+//Initialise the texture and depth buffer with the required width, height and colour format
+bool CRenderTexture::Initialize(ID3D11Device* device, int textureWidth, int textureHeight, DXGI_FORMAT format, bool unorderedAccess)
 {
 	D3D11_TEXTURE2D_DESC textureDesc;
 	HRESULT result;
@@ -29,6 +31,7 @@ bool CRenderTexture::Initialize(ID3D11Device* device, int textureWidth, int text
 	// Store the width and height of the render texture.
 	m_textureWidth = textureWidth;
 	m_textureHeight = textureHeight;
+	m_format = format;
 
 	// Initialize the render target texture description.
 	ZeroMemory(&textureDesc, sizeof(textureDesc));
@@ -38,10 +41,10 @@ bool CRenderTexture::Initialize(ID3D11Device* device, int textureWidth, int text
 	textureDesc.Height = textureHeight;
 	textureDesc.MipLevels = 1;
 	textureDesc.ArraySize = 1;
-	textureDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	textureDesc.Format = format;
 	textureDesc.SampleDesc.Count = 1;
 	textureDesc.Usage = D3D11_USAGE_DEFAULT;
-	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE | (unorderedAccess ? D3D11_BIND_UNORDERED_ACCESS : 0);
 	textureDesc.CPUAccessFlags = 0;
 	textureDesc.MiscFlags = 0;
 
@@ -78,6 +81,16 @@ bool CRenderTexture::Initialize(ID3D11Device* device, int textureWidth, int text
 		return false;
 	}
 
+	// Create the unordered access view for compute shaders, if asked for.
+	if (unorderedAccess)
+	{
+		result = device->CreateUnorderedAccessView(m_renderTargetTexture, nullptr, &m_unorderedAccessView);
+		if (FAILED(result))
+		{
+			return false;
+		}
+	}
+
 	// Initialize the description of the depth buffer.
 	ZeroMemory(&depthBufferDesc, sizeof(depthBufferDesc));
 
@@ -147,6 +160,12 @@ void CRenderTexture::Shutdown()
 		m_shaderResourceView = 0;
 	}
 
+	if (m_unorderedAccessView)
+	{
+		m_unorderedAccessView->Release();
+		m_unorderedAccessView = 0;
+	}
+
 	if (m_renderTargetView)
 	{
 		m_renderTargetView->Release();
@@ -213,6 +232,12 @@ ID3D11DepthStencilView* CRenderTexture::GetDepthStencilView()
 	return m_depthStencilView;
 }
 
+//Get the unordered access view for compute shaders to write to
+ID3D11UnorderedAccessView* CRenderTexture::GetUnorderedAccessView()
+{
+	return m_unorderedAccessView;
+}
+
 //Get the Width of the texture
 int CRenderTexture::GetTextureWidth()
 {
@@ -223,4 +248,30 @@ int CRenderTexture::GetTextureWidth()
 int CRenderTexture::GetTextureHeight()
 {
 	return m_textureHeight;
-}
\ No newline at end of file
+}
+
+//Get the colour format of the texture
+DXGI_FORMAT CRenderTexture::GetFormat()
+{
+	return m_format;
+}
+
+//Get the GPU memory used by the texture and its depth buffer in bytes
+unsigned long long CRenderTexture::GetMemoryUsage()
+{
+	//Bytes per pixel of the colour texture, plus 4 for the D24S8 depth buffer
+	unsigned long long colourBytes = 8;
+	switch (m_format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_FLOAT: colourBytes = 16; break;
+	case DXGI_FORMAT_R11G11B10_FLOAT:
+	case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+	case DXGI_FORMAT_R10G10B10A2_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB: colourBytes = 4; break;
+	default: break;
+	}
+	return static_cast<unsigned long long>(m_textureWidth) * m_textureHeight * (colourBytes + 4);
+}
@@ -11,8 +11,10 @@ public:
 	CRenderTexture();
 	~CRenderTexture();
 
-	//Initialise the texture and depth buffer with the required width and height
-	bool Initialize(ID3D11Device*, int, int);
+	//Initialise the texture and depth buffer with the required width, height and colour format. Targets whose alpha is
+	//never read can use DXGI_FORMAT_R11G11B10_FLOAT, half the memory and bandwidth of the default. Set unorderedAccess for
+	//textures compute shaders write to
+	bool Initialize(ID3D11Device*, int, int, DXGI_FORMAT format = DXGI_FORMAT_R16G16B16A16_FLOAT, bool unorderedAccess = false);
 
 	//Release the resources from the class
 	void Shutdown();
@@ -33,21 +35,32 @@ public:
 	//Get the depth stencil view of the render target
 	ID3D11DepthStencilView* GetDepthStencilView();
 
+	//Get the unordered access view for compute shaders to write to, or nullptr if the texture was not created with one
+	ID3D11UnorderedAccessView* GetUnorderedAccessView();
+
 	//Get the Width of the texture
 	int GetTextureWidth();
 
 	//Get the Height of the texture
 	int GetTextureHeight();
+
+	//Get the colour format of the texture
+	DXGI_FORMAT GetFormat();
+
+	//Get the GPU memory used by the texture and its depth buffer in bytes
+	unsigned long long GetMemoryUsage();
 	
 //-------------------------------------
 // Private members
 //-------------------------------------
 private:
 	int m_textureWidth, m_textureHeight;
+	DXGI_FORMAT m_format;
 
 	ID3D11Texture2D* m_renderTargetTexture;
 	ID3D11RenderTargetView* m_renderTargetView;
 	ID3D11ShaderResourceView* m_shaderResourceView;
+	ID3D11UnorderedAccessView* m_unorderedAccessView;
 	
 	ID3D11Texture2D* m_depthStencilBuffer;
 	ID3D11DepthStencilView* m_depthStencilView;
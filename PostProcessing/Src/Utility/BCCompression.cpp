@@ -0,0 +1,657 @@
+//--------------------------------------------------------------------------------------
+// CPU compression of images to BC1, BC3, BC4 and BC5 blocks
+//--------------------------------------------------------------------------------------
+
+#include "BCCompression.h"
+#include "CThreadPool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+
+namespace
+{
+	using BlockEncoder = void (*)(const uint8_t* pixels, size_t pitch, uint8_t* block, BCQuality quality);
+
+	void Write16(uint8_t* data, uint32_t value)
+	{
+		data[0] = static_cast<uint8_t>(value);
+		data[1] = static_cast<uint8_t>(value >> 8);
+	}
+
+	int Expand5(int value) { return value << 3 | value >> 2; }
+	int Expand6(int value) { return value << 2 | value >> 4; }
+
+
+	//-------------------------------------
+	// Colour blocks
+	//-------------------------------------
+
+	//Best pair of 5 or 6-bit endpoint values to reproduce each 8-bit value with the 2/3 : 1/3 or 1/2 : 1/2 palette entry,
+	//for blocks of a single colour. Built once when the program starts
+	struct SingleColourTables
+	{
+		uint8_t thirds5[256][2], thirds6[256][2];
+		uint8_t halves5[256][2], halves6[256][2];
+
+		SingleColourTables()
+		{
+			Build(5, 3, thirds5);
+			Build(6, 3, thirds6);
+			Build(5, 2, halves5);
+			Build(6, 2, halves6);
+		}
+
+		static void Build(int bits, int divisor, uint8_t table[256][2])
+		{
+			int levels = 1 << bits;
+			for (int value = 0; value < 256; ++value)
+			{
+				int bestError = 256;
+				for (int a = 0; a < levels; ++a)
+				{
+					for (int b = 0; b < levels; ++b)
+					{
+						int ea = bits == 5 ? Expand5(a) : Expand6(a);
+						int eb = bits == 5 ? Expand5(b) : Expand6(b);
+						int decoded = divisor == 3 ? (2 * ea + eb) / 3 : (ea + eb) / 2;
+						int error = std::abs(decoded - value);
+						if (error < bestError)
+						{
+							bestError = error;
+							table[value][0] = static_cast<uint8_t>(a);
+							table[value][1] = static_cast<uint8_t>(b);
+						}
+					}
+				}
+			}
+		}
+	};
+	const SingleColourTables SingleColour;
+
+	//Nearest 5:6:5 endpoint to a colour with channels 0-255
+	uint32_t Quantise565(const float colour[3])
+	{
+		int r = static_cast<int>(std::min(std::max(colour[0], 0.0f), 255.0f) * (31.0f / 255.0f) + 0.5f);
+		int g = static_cast<int>(std::min(std::max(colour[1], 0.0f), 255.0f) * (63.0f / 255.0f) + 0.5f);
+		int b = static_cast<int>(std::min(std::max(colour[2], 0.0f), 255.0f) * (31.0f / 255.0f) + 0.5f);
+		return static_cast<uint32_t>(r << 11 | g << 5 | b);
+	}
+
+	//The distinct colours of a block and how many pixels use each, with pixels BC1 must make transparent left out
+	struct ColourSet
+	{
+		int   count = 0;
+		float points[16][3];
+		float weights[16];
+		int   remap[16];              // Distinct colour used by each pixel, -1 for transparent pixels
+		bool  anyTransparent = false;
+
+		ColourSet(const uint8_t* rgba, bool allowTransparent)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				const uint8_t* pixel = rgba + i * 4;
+				if (allowTransparent && pixel[3] < 128)
+				{
+					remap[i] = -1;
+					anyTransparent = true;
+					continue;
+				}
+
+				int match = 0;
+				while (match < count && !(points[match][0] == pixel[0] && points[match][1] == pixel[1] && points[match][2] == pixel[2])) ++match;
+				if (match == count)
+				{
+					for (int c = 0; c < 3; ++c) points[count][c] = pixel[c];
+					weights[count++] = 0;
+				}
+				weights[match] += 1;
+				remap[i] = match;
+			}
+		}
+	};
+
+	//Endpoints and indices chosen for a colour block, with their squared error over the block
+	struct ColourFit
+	{
+		uint32_t c0 = 0, c1 = 0;
+		uint8_t  indices[16] = {}; // For each distinct colour
+		int      error = INT32_MAX;
+	};
+
+	//Score a pair of endpoints, choosing the nearest palette entry for each colour as the decoder will build the palette.
+	//threeColour asks for the 3 colour + transparent palette, otherwise the 4 colour one is used. Endpoints are swapped
+	//into the order that selects the palette
+	void TryColourEndpoints(const ColourSet& set, uint32_t c0, uint32_t c1, bool threeColour, bool fourColourOnly, ColourFit& best)
+	{
+		if (threeColour ? c0 > c1 : c0 < c1) std::swap(c0, c1);
+		bool fourColours = c0 > c1 || fourColourOnly;
+		if (set.anyTransparent && fourColours) return;
+
+		int r0 = Expand5(c0 >> 11), g0 = Expand6((c0 >> 5) & 63), b0 = Expand5(c0 & 31);
+		int r1 = Expand5(c1 >> 11), g1 = Expand6((c1 >> 5) & 63), b1 = Expand5(c1 & 31);
+		int palette[4][3] = { { r0, g0, b0 }, { r1, g1, b1 } };
+		if (fourColours)
+		{
+			palette[2][0] = (2 * r0 + r1) / 3;  palette[2][1] = (2 * g0 + g1) / 3;  palette[2][2] = (2 * b0 + b1) / 3;
+			palette[3][0] = (r0 + 2 * r1) / 3;  palette[3][1] = (g0 + 2 * g1) / 3;  palette[3][2] = (b0 + 2 * b1) / 3;
+		}
+		else
+		{
+			palette[2][0] = (r0 + r1) / 2;  palette[2][1] = (g0 + g1) / 2;  palette[2][2] = (b0 + b1) / 2;
+		}
+		int entries = fourColours ? 4 : 3;
+
+		ColourFit fit;
+		fit.c0 = c0;
+		fit.c1 = c1;
+		fit.error = 0;
+		for (int i = 0; i < set.count; ++i)
+		{
+			int bestError = INT32_MAX;
+			for (int entry = 0; entry < entries; ++entry)
+			{
+				int dr = palette[entry][0] - static_cast<int>(set.points[i][0]);
+				int dg = palette[entry][1] - static_cast<int>(set.points[i][1]);
+				int db = palette[entry][2] - static_cast<int>(set.points[i][2]);
+				int error = dr * dr + dg * dg + db * db;
+				if (error < bestError)
+				{
+					bestError = error;
+					fit.indices[i] = static_cast<uint8_t>(entry);
+				}
+			}
+			fit.error += bestError * static_cast<int>(set.weights[i]);
+		}
+		if (fit.error < best.error) best = fit;
+	}
+
+	//Direction in which the colours vary most, by power iteration on their covariance
+	void PrincipalAxis(const ColourSet& set, float axis[3])
+	{
+		float centre[3] = {}, total = 0;
+		for (int i = 0; i < set.count; ++i)
+		{
+			for (int c = 0; c < 3; ++c) centre[c] += set.points[i][c] * set.weights[i];
+			total += set.weights[i];
+		}
+		for (int c = 0; c < 3; ++c) centre[c] /= total;
+
+		float covariance[3][3] = {};
+		for (int i = 0; i < set.count; ++i)
+		{
+			float d[3] = { set.points[i][0] - centre[0], set.points[i][1] - centre[1], set.points[i][2] - centre[2] };
+			for (int a = 0; a < 3; ++a)
+			{
+				for (int b = 0; b < 3; ++b) covariance[a][b] += d[a] * d[b] * set.weights[i];
+			}
+		}
+
+		//Start from the row with the most variance so the start is never at right angles to the answer
+		int row = 0;
+		for (int c = 1; c < 3; ++c) if (covariance[c][c] > covariance[row][row]) row = c;
+		for (int c = 0; c < 3; ++c) axis[c] = covariance[row][c];
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[3];
+			for (int a = 0; a < 3; ++a) next[a] = covariance[a][0] * axis[0] + covariance[a][1] * axis[1] + covariance[a][2] * axis[2];
+			float largest = std::max(std::max(std::abs(next[0]), std::abs(next[1])), std::abs(next[2]));
+			if (largest == 0) break;
+			for (int c = 0; c < 3; ++c) axis[c] = next[c] / largest;
+		}
+	}
+
+	//Try every split of the colours, ordered along the axis, into the palette's entries (3 or 4 in order from one end
+	//to the other) and return the least squares endpoints of the split with the least error
+	void ClusterFit(const ColourSet& set, const int order[16], int entries, float start[3], float end[3])
+	{
+		float total[3] = {}, totalWeight = 0;
+		for (int i = 0; i < set.count; ++i)
+		{
+			for (int c = 0; c < 3; ++c) total[c] += set.points[i][c] * set.weights[i];
+			totalWeight += set.weights[i];
+		}
+
+		//Weight each entry gives the start and end endpoints: 1, 2/3, 1/3, 0 of the start, or 1, 1/2, 0 with three entries
+		float bestError = FLT_MAX;
+		auto evaluate = [&](const float part0[3], float w0, const float part1[3], float w1, const float part2[3], float w2)
+		{
+			float part3[3] = { total[0] - part0[0] - part1[0] - part2[0], total[1] - part0[1] - part1[1] - part2[1], total[2] - part0[2] - part1[2] - part2[2] };
+			float w3 = totalWeight - w0 - w1 - w2;
+
+			float alpha2, beta2, alphaBeta, alphaX[3], betaX[3];
+			if (entries == 4)
+			{
+				alpha2 = w0 + w1 * (4.0f / 9.0f) + w2 * (1.0f / 9.0f);
+				beta2 = w3 + w2 * (4.0f / 9.0f) + w1 * (1.0f / 9.0f);
+				alphaBeta = (w1 + w2) * (2.0f / 9.0f);
+				for (int c = 0; c < 3; ++c)
+				{
+					alphaX[c] = part0[c] + part1[c] * (2.0f / 3.0f) + part2[c] * (1.0f / 3.0f);
+					betaX[c] = part3[c] + part2[c] * (2.0f / 3.0f) + part1[c] * (1.0f / 3.0f);
+				}
+			}
+			else
+			{
+				//part2 is empty with three entries, so part3 is the end cluster
+				alpha2 = w0 + w1 * 0.25f;
+				beta2 = w3 + w1 * 0.25f;
+				alphaBeta = w1 * 0.25f;
+				for (int c = 0; c < 3; ++c)
+				{
+					alphaX[c] = part0[c] + part1[c] * 0.5f;
+					betaX[c] = part3[c] + part1[c] * 0.5f;
+				}
+			}
+
+			float determinant = alpha2 * beta2 - alphaBeta * alphaBeta;
+			if (determinant < 1e-6f) return;
+			float factor = 1.0f / determinant;
+
+			//At the least squares solution the error is the constant sum of squares less a.alphaX + b.betaX
+			float a[3], b[3], error = 0;
+			for (int c = 0; c < 3; ++c)
+			{
+				a[c] = (alphaX[c] * beta2 - betaX[c] * alphaBeta) * factor;
+				b[c] = (betaX[c] * alpha2 - alphaX[c] * alphaBeta) * factor;
+				error -= a[c] * alphaX[c] + b[c] * betaX[c];
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				memcpy(start, a, sizeof(a));
+				memcpy(end, b, sizeof(b));
+			}
+		};
+
+		const float none[3] = {};
+		float part0[3] = {}, w0 = 0;
+		for (int i = 0; i <= set.count; ++i)
+		{
+			float part1[3] = {}, w1 = 0;
+			for (int j = i; j <= set.count; ++j)
+			{
+				if (entries == 3)
+				{
+					evaluate(part0, w0, part1, w1, none, 0);
+				}
+				else
+				{
+					float part2[3] = {}, w2 = 0;
+					for (int k = j; k <= set.count; ++k)
+					{
+						evaluate(part0, w0, part1, w1, part2, w2);
+						if (k < set.count)
+						{
+							for (int c = 0; c < 3; ++c) part2[c] += set.points[order[k]][c] * set.weights[order[k]];
+							w2 += set.weights[order[k]];
+						}
+					}
+				}
+				if (j < set.count)
+				{
+					for (int c = 0; c < 3; ++c) part1[c] += set.points[order[j]][c] * set.weights[order[j]];
+					w1 += set.weights[order[j]];
+				}
+			}
+			if (i < set.count)
+			{
+				for (int c = 0; c < 3; ++c) part0[c] += set.points[order[i]][c] * set.weights[order[i]];
+				w0 += set.weights[order[i]];
+			}
+		}
+	}
+
+	//Fit and write the 8 bytes of a colour block from 16 RGBA8 pixels. Colour blocks inside BC3 always decode with four
+	//colours, BC1 ones use three colours and transparent black for blocks with transparent pixels
+	void EncodeColour(const uint8_t* rgba, bool fourColourOnly, BCQuality quality, uint8_t* block)
+	{
+		ColourSet set(rgba, !fourColourOnly);
+		ColourFit best;
+
+		if (set.count == 0)
+		{
+			//Every pixel transparent
+			best.error = 0;
+		}
+		else if (set.count == 1)
+		{
+			//A single colour is matched exactly as far as possible by the 2/3 : 1/3 (or halfway) entry
+			int r = static_cast<int>(set.points[0][0]), g = static_cast<int>(set.points[0][1]), b = static_cast<int>(set.points[0][2]);
+			if (!set.anyTransparent)
+			{
+				TryColourEndpoints(set, static_cast<uint32_t>(SingleColour.thirds5[r][0] << 11 | SingleColour.thirds6[g][0] << 5 | SingleColour.thirds5[b][0]),
+				                        static_cast<uint32_t>(SingleColour.thirds5[r][1] << 11 | SingleColour.thirds6[g][1] << 5 | SingleColour.thirds5[b][1]),
+				                   false, fourColourOnly, best);
+			}
+			if (!fourColourOnly)
+			{
+				TryColourEndpoints(set, static_cast<uint32_t>(SingleColour.halves5[r][0] << 11 | SingleColour.halves6[g][0] << 5 | SingleColour.halves5[b][0]),
+				                        static_cast<uint32_t>(SingleColour.halves5[r][1] << 11 | SingleColour.halves6[g][1] << 5 | SingleColour.halves5[b][1]),
+				                   true, fourColourOnly, best);
+			}
+		}
+		else
+		{
+			float axis[3];
+			PrincipalAxis(set, axis);
+
+			//Order the colours along the axis
+			int order[16];
+			float projections[16];
+			for (int i = 0; i < set.count; ++i)
+			{
+				order[i] = i;
+				projections[i] = set.points[i][0] * axis[0] + set.points[i][1] * axis[1] + set.points[i][2] * axis[2];
+			}
+			std::sort(order, order + set.count, [&projections](int a, int b) { return projections[a] < projections[b]; });
+
+			//Range fit - the colours at either end of the axis
+			uint32_t first = Quantise565(set.points[order[0]]), last = Quantise565(set.points[order[set.count - 1]]);
+			if (!set.anyTransparent) TryColourEndpoints(set, first, last, false, fourColourOnly, best);
+			if (!fourColourOnly && (set.anyTransparent || quality == BCQuality::High)) TryColourEndpoints(set, first, last, true, fourColourOnly, best);
+
+			if (quality == BCQuality::High)
+			{
+				float start[3], end[3];
+				if (!set.anyTransparent)
+				{
+					ClusterFit(set, order, 4, start, end);
+					TryColourEndpoints(set, Quantise565(start), Quantise565(end), false, fourColourOnly, best);
+				}
+				if (!fourColourOnly)
+				{
+					ClusterFit(set, order, 3, start, end);
+					TryColourEndpoints(set, Quantise565(start), Quantise565(end), true, fourColourOnly, best);
+				}
+			}
+		}
+
+		uint32_t indices = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			uint32_t index = set.remap[i] < 0 ? 3 : best.indices[set.remap[i]];
+			indices |= index << (2 * i);
+		}
+		Write16(block, best.c0);
+		Write16(block + 2, best.c1);
+		Write16(block + 4, indices & 0xffff);
+		Write16(block + 6, indices >> 16);
+	}
+
+
+	//-------------------------------------
+	// Single channel blocks
+	//-------------------------------------
+
+	//Endpoints and indices chosen for a single channel block, with their squared error
+	struct ChannelFit
+	{
+		int     a0 = 0, a1 = 0;
+		uint8_t indices[16] = {};
+		int     error = INT32_MAX;
+	};
+
+	//Score a pair of endpoints, choosing the nearest palette entry for each value. a0 > a1 selects the 8 value palette,
+	//otherwise it is 6 values, 0 and 255 (as AlphaPalette in BCDecompression.cpp)
+	ChannelFit EvaluateChannel(const uint8_t values[16], int a0, int a1)
+	{
+		int palette[8] = { a0, a1 };
+		if (a0 > a1)
+		{
+			for (int i = 1; i < 7; ++i) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+		}
+		else
+		{
+			for (int i = 1; i < 5; ++i) palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		ChannelFit fit;
+		fit.a0 = a0;
+		fit.a1 = a1;
+		fit.error = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			//Written without branches, which the compiler turns into conditional moves
+			int bestError = INT32_MAX, bestEntry = 0;
+			for (int entry = 0; entry < 8; ++entry)
+			{
+				int error = (palette[entry] - values[i]) * (palette[entry] - values[i]);
+				bestEntry = error < bestError ? entry : bestEntry;
+				bestError = std::min(error, bestError);
+			}
+			fit.indices[i] = static_cast<uint8_t>(bestEntry);
+			fit.error += bestError;
+		}
+		return fit;
+	}
+
+	//Improve a fit by solving for the endpoints that best reproduce the values with its indices, then trying the
+	//endpoints next to the result. Keeps to the fit's palette
+	void RefineChannel(const uint8_t values[16], ChannelFit& fit)
+	{
+		bool eightValues = fit.a0 > fit.a1;
+		for (int iteration = 0; iteration < 2; ++iteration)
+		{
+			//Weight of a0 and a1 in each index's palette entry. The 6 value palette's fixed 0 and 255 take no part
+			float alpha2 = 0, beta2 = 0, alphaBeta = 0, alphaX = 0, betaX = 0;
+			for (int i = 0; i < 16; ++i)
+			{
+				int index = fit.indices[i];
+				float t;
+				if (index == 0)              t = 0;
+				else if (index == 1)         t = 1;
+				else if (eightValues)        t = (index - 1) / 7.0f;
+				else if (index < 6)          t = (index - 1) / 5.0f;
+				else                         continue;
+				alpha2 += (1 - t) * (1 - t);
+				beta2 += t * t;
+				alphaBeta += (1 - t) * t;
+				alphaX += (1 - t) * values[i];
+				betaX += t * values[i];
+			}
+			float determinant = alpha2 * beta2 - alphaBeta * alphaBeta;
+			if (determinant < 1e-6f) break;
+
+			int a0 = std::min(std::max(static_cast<int>((alphaX * beta2 - betaX * alphaBeta) / determinant + 0.5f), 0), 255);
+			int a1 = std::min(std::max(static_cast<int>((betaX * alpha2 - alphaX * alphaBeta) / determinant + 0.5f), 0), 255);
+			if (eightValues ? a0 <= a1 : a0 > a1) std::swap(a0, a1);
+			if (eightValues && a0 == a1) break;
+
+			ChannelFit refined = EvaluateChannel(values, a0, a1);
+			if (refined.error >= fit.error) break;
+			fit = refined;
+		}
+
+		//Endpoints one step either side
+		ChannelFit centre = fit;
+		for (int d0 = -1; d0 <= 1; ++d0)
+		{
+			for (int d1 = -1; d1 <= 1; ++d1)
+			{
+				int a0 = centre.a0 + d0, a1 = centre.a1 + d1;
+				if ((d0 == 0 && d1 == 0) || a0 < 0 || a0 > 255 || a1 < 0 || a1 > 255 || (eightValues != (a0 > a1))) continue;
+				ChannelFit candidate = EvaluateChannel(values, a0, a1);
+				if (candidate.error < fit.error) fit = candidate;
+			}
+		}
+	}
+
+	//Fit and write the 8 bytes of a single channel block from one byte of each of 16 RGBA8 pixels
+	void EncodeChannel(const uint8_t* rgba, int channel, BCQuality quality, uint8_t* block)
+	{
+		uint8_t values[16];
+		int low = 255, high = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			values[i] = rgba[i * 4 + channel];
+			low = std::min(low, static_cast<int>(values[i]));
+			high = std::max(high, static_cast<int>(values[i]));
+		}
+
+		//The 8 value palette spanning the block's range, or equal endpoints for a flat block
+		ChannelFit best = EvaluateChannel(values, high, low);
+		if (high > low && quality == BCQuality::High)
+		{
+			RefineChannel(values, best);
+
+			//The 6 value palette spanning the values that 0 and 255 do not already cover
+			int innerLow = 255, innerHigh = 0;
+			for (uint8_t value : values)
+			{
+				if (value == 0 || value == 255) continue;
+				innerLow = std::min(innerLow, static_cast<int>(value));
+				innerHigh = std::max(innerHigh, static_cast<int>(value));
+			}
+			if (innerLow <= innerHigh)
+			{
+				ChannelFit sixValues = EvaluateChannel(values, innerLow, innerHigh);
+				RefineChannel(values, sixValues);
+				if (sixValues.error < best.error) best = sixValues;
+			}
+		}
+
+		uint64_t indices = 0;
+		for (int i = 0; i < 16; ++i) indices |= static_cast<uint64_t>(best.indices[i]) << (3 * i);
+		block[0] = static_cast<uint8_t>(best.a0);
+		block[1] = static_cast<uint8_t>(best.a1);
+		for (int i = 0; i < 6; ++i) block[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+	}
+
+
+	//-------------------------------------
+	// Images
+	//-------------------------------------
+
+	//Copy a block's pixels to 16 packed RGBA8 pixels so each encoder works on the same layout
+	void GatherBlock(const uint8_t* pixels, size_t pitch, uint8_t rgba[64])
+	{
+		for (int y = 0; y < 4; ++y) memcpy(rgba + y * 16, pixels + y * pitch, 16);
+	}
+
+	BlockEncoder GetBlockEncoder(ImageFormat format)
+	{
+		switch (format)
+		{
+		case ImageFormat::BC1: return EncodeBC1Block;
+		case ImageFormat::BC3: return EncodeBC3Block;
+		case ImageFormat::BC4: return EncodeBC4Block;
+		case ImageFormat::BC5: return EncodeBC5Block;
+		default:               return nullptr;
+		}
+	}
+
+	//Encode a range of block rows of one mip. Source pixels outside the mip repeat its last row and column
+	void EncodeBlockRows(BlockEncoder encode, BCQuality quality, const CImage& source, CImage& destination, uint32_t mip, uint32_t firstRow, uint32_t endRow)
+	{
+		const ImageMip& layout = source.GetMip(mip);
+		uint32_t blockBytes = GetFormatBytes(destination.GetFormat());
+		uint32_t columns = (layout.width + 3) / 4;
+		bool swapRedBlue = source.GetFormat() == ImageFormat::BGRA8;
+
+		uint8_t rgba[64];
+		for (uint32_t blockY = firstRow; blockY < endRow; ++blockY)
+		{
+			uint8_t* block = destination.GetRow(mip, blockY);
+			for (uint32_t blockX = 0; blockX < columns; ++blockX, block += blockBytes)
+			{
+				for (uint32_t y = 0; y < 4; ++y)
+				{
+					const uint8_t* row = source.GetRow(mip, std::min(blockY * 4 + y, layout.height - 1));
+					for (uint32_t x = 0; x < 4; ++x)
+					{
+						const uint8_t* pixel = row + std::min(blockX * 4 + x, layout.width - 1) * 4;
+						uint8_t* out = rgba + (y * 4 + x) * 4;
+						out[0] = pixel[swapRedBlue ? 2 : 0];
+						out[1] = pixel[1];
+						out[2] = pixel[swapRedBlue ? 0 : 2];
+						out[3] = pixel[3];
+					}
+				}
+				encode(rgba, 16, block, quality);
+			}
+		}
+	}
+}
+
+
+//-------------------------------------
+// Block encoding
+//-------------------------------------
+
+void EncodeBC1Block(const uint8_t* pixels, size_t pitch, uint8_t* block, BCQuality quality)
+{
+	uint8_t rgba[64];
+	GatherBlock(pixels, pitch, rgba);
+	EncodeColour(rgba, false, quality, block);
+}
+
+void EncodeBC3Block(const uint8_t* pixels, size_t pitch, uint8_t* block, BCQuality quality)
+{
+	uint8_t rgba[64];
+	GatherBlock(pixels, pitch, rgba);
+	EncodeChannel(rgba, 3, quality, block);
+	EncodeColour(rgba, true, quality, block + 8);
+}
+
+void EncodeBC4Block(const uint8_t* pixels, size_t pitch, uint8_t* block, BCQuality quality)
+{
+	uint8_t rgba[64];
+	GatherBlock(pixels, pitch, rgba);
+	EncodeChannel(rgba, 0, quality, block);
+}
+
+void EncodeBC5Block(const uint8_t* pixels, size_t pitch, uint8_t* block, BCQuality quality)
+{
+	uint8_t rgba[64];
+	GatherBlock(pixels, pitch, rgba);
+	EncodeChannel(rgba, 0, quality, block);
+	EncodeChannel(rgba, 1, quality, block + 8);
+}
+
+
+//-------------------------------------
+// Image encoding
+//-------------------------------------
+
+//Compress every mip of an RGBA8 or BGRA8 image
+bool CompressBC(const CImage& source, ImageFormat format, CImage& destination, CThreadPool* threads, BCQuality quality)
+{
+	BlockEncoder encode = GetBlockEncoder(format);
+	if (!encode || (source.GetFormat() != ImageFormat::RGBA8 && source.GetFormat() != ImageFormat::BGRA8)) return false;
+	if (!destination.Create(format, source.GetWidth(), source.GetHeight(), source.GetMipCount())) return false;
+
+	//A few ranges of block rows per worker, as in DecompressBC. Encoding costs far more per block, so the split evens
+	//out the work well even on small mips
+	if (threads && threads->GetThreadCount() == 0) threads = nullptr;
+	uint32_t rowsPerTask = 0;
+	if (threads)
+	{
+		uint32_t totalRows = 0;
+		for (uint32_t mip = 0; mip < destination.GetMipCount(); ++mip) totalRows += destination.GetMip(mip).rows;
+		rowsPerTask = std::max(totalRows / (threads->GetThreadCount() * 4), 1u);
+	}
+
+	for (uint32_t mip = 0; mip < destination.GetMipCount(); ++mip)
+	{
+		uint32_t rows = destination.GetMip(mip).rows;
+		if (!threads)
+		{
+			EncodeBlockRows(encode, quality, source, destination, mip, 0, rows);
+			continue;
+		}
+		for (uint32_t first = 0; first < rows; first += rowsPerTask)
+		{
+			uint32_t end = std::min(first + rowsPerTask, rows);
+			threads->Submit([encode, quality, &source, &destination, mip, first, end]()
+			{
+				EncodeBlockRows(encode, quality, source, destination, mip, first, end);
+			});
+		}
+	}
+	if (threads) threads->Wait();
+	return true;
+}
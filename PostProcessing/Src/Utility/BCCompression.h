@@ -0,0 +1,35 @@
+//--------------------------------------------------------------------------------------
+// CPU compression of images to BC1, BC3, BC4 and BC5 blocks
+//--------------------------------------------------------------------------------------
+// The offline half of BCDecompression.h, used by the asset tool to turn the PNG/JPEG media into
+// DDS files the GPU samples directly at 4-8x less memory than RGBA8. Each candidate encoding is
+// scored by decoding it exactly as BCDecompression does.
+#pragma once
+#include "CImage.h"
+#include <cstddef>
+#include <cstdint>
+
+class CThreadPool;
+
+//Cluster fit orders the block's colours along their principal axis and tries every split of that order into the palette's
+//entries, solving for the endpoints that best fit each by least squares. Range fit takes the ends of the principal axis, several
+//times quicker for about a dB. Single channels start from the block's range, refined by least squares with both the 8 value and
+//the 6 value + 0/255 palettes
+enum class BCQuality
+{
+	Fast, // Range fit for colour, no refinement for single channels
+	High, // Cluster fit for colour, least squares refinement for single channels
+};
+
+//Encode 4 rows of 4 RGBA8 pixels, pitch bytes apart, into one block. BC1 uses its 3 colour + transparent palette for
+//blocks with pixels whose alpha is below 128. BC4 stores red and BC5 red and green, as the shaders sample them
+void EncodeBC1Block(const uint8_t* pixels, size_t pitch, uint8_t* block, BCQuality quality = BCQuality::High);
+void EncodeBC3Block(const uint8_t* pixels, size_t pitch, uint8_t* block, BCQuality quality = BCQuality::High);
+void EncodeBC4Block(const uint8_t* pixels, size_t pitch, uint8_t* block, BCQuality quality = BCQuality::High);
+void EncodeBC5Block(const uint8_t* pixels, size_t pitch, uint8_t* block, BCQuality quality = BCQuality::High);
+
+//Compress every mip of an RGBA8 or BGRA8 image to BC1, BC3, BC4 or BC5. Rows of blocks are shared between the pool's
+//workers, or encoded on the calling thread without a pool. Blocks overhanging the edge of a mip repeat its last row and
+//column. Returns false for other formats
+bool CompressBC(const CImage& source, ImageFormat format, CImage& destination, CThreadPool* threads = nullptr,
+                BCQuality quality = BCQuality::High);
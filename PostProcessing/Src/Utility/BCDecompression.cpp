@@ -0,0 +1,668 @@
+//--------------------------------------------------------------------------------------
+// CPU decompression of BC1, BC3, BC4, BC5 and BC7 blocks
+//--------------------------------------------------------------------------------------
+
+#include "BCDecompression.h"
+#include "CThreadPool.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define BC_DECODE_SIMD 1
+	#include <tmmintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define SSSE3_FUNCTION
+	#else
+		#define SSSE3_FUNCTION __attribute__((target("ssse3")))
+	#endif
+#else
+	#define BC_DECODE_SIMD 0
+#endif
+
+namespace
+{
+	using BlockDecoder = void (*)(const uint8_t* block, uint8_t* pixels, size_t pitch);
+
+	uint16_t Read16(const uint8_t* data) { return static_cast<uint16_t>(data[0] | data[1] << 8); }
+
+	uint32_t Read32(const uint8_t* data)
+	{
+		return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+		       static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24;
+	}
+
+	uint64_t Read64(const uint8_t* data)
+	{
+		return static_cast<uint64_t>(Read32(data)) | static_cast<uint64_t>(Read32(data + 4)) << 32;
+	}
+
+	uint32_t PackRGBA(uint32_t r, uint32_t g, uint32_t b, uint32_t a) { return r | g << 8 | b << 16 | a << 24; }
+
+
+	//-------------------------------------
+	// BC1 - BC5 palettes
+	//-------------------------------------
+
+	//Build the four RGBA8 colours of a BC1 colour block. Colour blocks inside BC3 always use four colours
+	void ColourPalette(const uint8_t* block, bool alwaysFourColours, uint32_t palette[4])
+	{
+		uint16_t c0 = Read16(block);
+		uint16_t c1 = Read16(block + 2);
+
+		//Expand 5:6:5 to 8 bits per channel by repeating the top bits
+		uint32_t r0 = (c0 >> 11) & 31, g0 = (c0 >> 5) & 63, b0 = c0 & 31;
+		uint32_t r1 = (c1 >> 11) & 31, g1 = (c1 >> 5) & 63, b1 = c1 & 31;
+		r0 = r0 << 3 | r0 >> 2;  g0 = g0 << 2 | g0 >> 4;  b0 = b0 << 3 | b0 >> 2;
+		r1 = r1 << 3 | r1 >> 2;  g1 = g1 << 2 | g1 >> 4;  b1 = b1 << 3 | b1 >> 2;
+
+		palette[0] = PackRGBA(r0, g0, b0, 255);
+		palette[1] = PackRGBA(r1, g1, b1, 255);
+		if (c0 > c1 || alwaysFourColours)
+		{
+			palette[2] = PackRGBA((2 * r0 + r1) / 3, (2 * g0 + g1) / 3, (2 * b0 + b1) / 3, 255);
+			palette[3] = PackRGBA((r0 + 2 * r1) / 3, (g0 + 2 * g1) / 3, (b0 + 2 * b1) / 3, 255);
+		}
+		else
+		{
+			//Three colours and transparent black
+			palette[2] = PackRGBA((r0 + r1) / 2, (g0 + g1) / 2, (b0 + b1) / 2, 255);
+			palette[3] = 0;
+		}
+	}
+
+	//Build the eight values of an interpolated alpha block, also used for the channels of BC4 and BC5
+	void AlphaPalette(const uint8_t* block, uint8_t palette[8])
+	{
+		uint32_t a0 = block[0];
+		uint32_t a1 = block[1];
+		palette[0] = static_cast<uint8_t>(a0);
+		palette[1] = static_cast<uint8_t>(a1);
+		if (a0 > a1)
+		{
+			for (uint32_t i = 1; i < 7; ++i) palette[i + 1] = static_cast<uint8_t>(((7 - i) * a0 + i * a1) / 7);
+		}
+		else
+		{
+			for (uint32_t i = 1; i < 5; ++i) palette[i + 1] = static_cast<uint8_t>(((5 - i) * a0 + i * a1) / 5);
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	//The 16 3-bit indices of an alpha block, pixel 0 in the low bits
+	uint64_t AlphaIndices(const uint8_t* block) { return Read64(block) >> 16; }
+
+
+	//-------------------------------------
+	// BC7 tables, from the D3D11 specification
+	//-------------------------------------
+
+	//Subset of each pixel in the 2-subset partitions, one bit per pixel with pixel 0 in the low bit
+	const uint16_t BC7Partitions2[64] =
+	{
+		0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80, 0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+		0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce, 0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+		0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a, 0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+		0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c, 0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22,
+	};
+
+	//Subset of each pixel in the 3-subset partitions, two bits per pixel with pixel 0 in the low bits
+	const uint32_t BC7Partitions3[64] =
+	{
+		0xaa685050, 0x6a5a5040, 0x5a5a4200, 0x5450a0a8, 0xa5a50000, 0xa0a05050, 0x5555a0a0, 0x5a5a5050,
+		0xaa550000, 0xaa555500, 0xaaaa5500, 0x90909090, 0x94949494, 0xa4a4a4a4, 0xa9a59450, 0x2a0a4250,
+		0xa5945040, 0x0a425054, 0xa5a5a500, 0x55a0a0a0, 0xa8a85454, 0x6a6a4040, 0xa4a45000, 0x1a1a0500,
+		0x0050a4a4, 0xaaa59090, 0x14696914, 0x69691400, 0xa08585a0, 0xaa821414, 0x50a4a450, 0x6a5a0200,
+		0xa9a58000, 0x5090a0a8, 0xa8a09050, 0x24242424, 0x00aa5500, 0x24924924, 0x24499224, 0x50a50a50,
+		0x500aa550, 0xaaaa4444, 0x66660000, 0xa5a0a5a0, 0x50a050a0, 0x69286928, 0x44aaaa44, 0x66666600,
+		0xaa444444, 0x54a854a8, 0x95809580, 0x96969600, 0xa85454a8, 0x80959580, 0xaa141414, 0x96960000,
+		0xaaaa1414, 0xa05050a0, 0xa0a5a5a0, 0x96000000, 0x40804080, 0xa9a8a9a8, 0xaaaaaa44, 0x2a4a5254,
+	};
+
+	//Anchor pixel of the second subset of each 2-subset partition (the first subset's is always pixel 0)
+	const uint8_t BC7Anchors2[64] =
+	{
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+		15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+		 6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+	};
+
+	//Anchor pixels of the second and third subsets of each 3-subset partition
+	const uint8_t BC7Anchors3Second[64] =
+	{
+		 3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+		 3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+		 8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+		 3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3,
+	};
+	const uint8_t BC7Anchors3Third[64] =
+	{
+		15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+		15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+		15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+		15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8,
+	};
+
+	//Interpolation weights out of 64 for 2, 3 and 4-bit indices
+	const uint8_t BC7Weights2[4]  = { 0, 21, 43, 64 };
+	const uint8_t BC7Weights3[8]  = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	const uint8_t BC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	const uint8_t* BC7Weights(uint32_t indexBits)
+	{
+		return indexBits == 2 ? BC7Weights2 : (indexBits == 3 ? BC7Weights3 : BC7Weights4);
+	}
+
+	//Layout of each of the eight BC7 modes
+	struct BC7Mode
+	{
+		uint8_t subsets;
+		uint8_t partitionBits;
+		uint8_t rotationBits;
+		uint8_t indexSelectionBits;
+		uint8_t colourBits;
+		uint8_t alphaBits;          // 0 if the mode has no alpha (alpha is 255)
+		uint8_t endpointPBits;      // One p-bit per endpoint
+		uint8_t sharedPBits;        // One p-bit per subset, shared by both its endpoints
+		uint8_t indexBits;
+		uint8_t secondaryIndexBits; // Modes with separate colour and alpha indices
+	};
+	const BC7Mode BC7Modes[8] =
+	{
+		{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+		{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+		{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+		{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+		{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+		{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+		{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+	};
+
+	//Reads the fields of a 128-bit block, least significant bit first
+	class BlockBits
+	{
+	public:
+		explicit BlockBits(const uint8_t* block) : m_Low(Read64(block)), m_High(Read64(block + 8)) {}
+
+		uint32_t Read(uint32_t count)
+		{
+			uint64_t value;
+			if (m_Position >= 64)                value = m_High >> (m_Position - 64);
+			else if (m_Position + count <= 64)   value = m_Low >> m_Position;
+			else                                 value = (m_Low >> m_Position) | (m_High << (64 - m_Position));
+			m_Position += count;
+			return static_cast<uint32_t>(value) & ((1u << count) - 1);
+		}
+
+	private:
+		uint64_t m_Low;
+		uint64_t m_High;
+		uint32_t m_Position = 0;
+	};
+
+
+	//-------------------------------------
+	// SIMD decoding
+	//-------------------------------------
+
+#if BC_DECODE_SIMD
+	//Byte shuffles for _mm_shuffle_epi8, built once when the program starts
+	struct ShuffleTables
+	{
+		//Select a row of 4 palette colours (4 bytes each) from one byte of BC1's 2-bit indices
+		alignas(16) uint8_t colourRow[256][16];
+
+		//Move the 4 values of pixel row y in a vector of 16 per-pixel values into the alpha, red or green bytes
+		alignas(16) uint8_t alphaRow[4][16];
+		alignas(16) uint8_t redRow[4][16];
+		alignas(16) uint8_t greenRow[4][16];
+
+		ShuffleTables()
+		{
+			for (int indices = 0; indices < 256; ++indices)
+			{
+				for (int x = 0; x < 4; ++x)
+				{
+					int entry = (indices >> (2 * x)) & 3;
+					for (int b = 0; b < 4; ++b) colourRow[indices][4 * x + b] = static_cast<uint8_t>(4 * entry + b);
+				}
+			}
+			memset(alphaRow, 0x80, sizeof(alphaRow)); // 0x80 zeroes the byte
+			memset(redRow, 0x80, sizeof(redRow));
+			memset(greenRow, 0x80, sizeof(greenRow));
+			for (int y = 0; y < 4; ++y)
+			{
+				for (int x = 0; x < 4; ++x)
+				{
+					alphaRow[y][4 * x + 3] = static_cast<uint8_t>(4 * y + x);
+					redRow[y][4 * x + 0]   = static_cast<uint8_t>(4 * y + x);
+					greenRow[y][4 * x + 1] = static_cast<uint8_t>(4 * y + x);
+				}
+			}
+		}
+	};
+	const ShuffleTables Shuffles;
+
+	//Look up the palette entry of each of the 16 pixels of an alpha block, giving one byte per pixel
+	SSSE3_FUNCTION __m128i AlphaValuesSSSE3(const uint8_t* block)
+	{
+		//Palette as in AlphaPalette, with 16-bit weighted sums of the endpoints divided by 7 or 5 by multiplying by
+		//65536 / 7 or 65536 / 5 (rounded up) and keeping the top half, which is exact for sums up to 7 * 255
+		__m128i a0 = _mm_set1_epi16(block[0]);
+		__m128i a1 = _mm_set1_epi16(block[1]);
+		__m128i palette;
+		if (block[0] > block[1])
+		{
+			__m128i sums = _mm_add_epi16(_mm_mullo_epi16(a0, _mm_setr_epi16(7, 0, 6, 5, 4, 3, 2, 1)),
+			                             _mm_mullo_epi16(a1, _mm_setr_epi16(0, 7, 1, 2, 3, 4, 5, 6)));
+			palette = _mm_mulhi_epu16(sums, _mm_set1_epi16(9363));
+		}
+		else
+		{
+			__m128i sums = _mm_add_epi16(_mm_mullo_epi16(a0, _mm_setr_epi16(5, 0, 4, 3, 2, 1, 0, 0)),
+			                             _mm_mullo_epi16(a1, _mm_setr_epi16(0, 5, 1, 2, 3, 4, 0, 0)));
+			palette = _mm_or_si128(_mm_mulhi_epu16(sums, _mm_set1_epi16(13108)), _mm_setr_epi16(0, 0, 0, 0, 0, 0, 0, 255));
+		}
+		palette = _mm_packus_epi16(palette, palette);
+
+		//Each group of 8 three-bit indices spans 3 bytes. Copy the two bytes holding each index into a 16-bit lane,
+		//then multiply to move its bits to the top of the lane and shift them down
+		__m128i bits = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(block));
+		__m128i low = _mm_shuffle_epi8(bits, _mm_setr_epi8(2, 3, 2, 3, 2, 3, 3, 4, 3, 4, 3, 4, 4, 5, 4, 5));
+		__m128i high = _mm_shuffle_epi8(bits, _mm_setr_epi8(5, 6, 5, 6, 5, 6, 6, 7, 6, 7, 6, 7, 7, 8, 7, 8));
+		const __m128i shifts = _mm_setr_epi16(1 << 13, 1 << 10, 1 << 7, 1 << 12, 1 << 9, 1 << 6, 1 << 11, 1 << 8);
+		low = _mm_srli_epi16(_mm_mullo_epi16(low, shifts), 13);
+		high = _mm_srli_epi16(_mm_mullo_epi16(high, shifts), 13);
+
+		return _mm_shuffle_epi8(palette, _mm_packus_epi16(low, high));
+	}
+
+	//Look up the palette colours of one row of a colour block
+	SSSE3_FUNCTION __m128i ColourRowSSSE3(__m128i palette, uint8_t rowIndices)
+	{
+		return _mm_shuffle_epi8(palette, _mm_load_si128(reinterpret_cast<const __m128i*>(Shuffles.colourRow[rowIndices])));
+	}
+
+	SSSE3_FUNCTION __m128i LoadShuffle(const uint8_t* shuffle)
+	{
+		return _mm_load_si128(reinterpret_cast<const __m128i*>(shuffle));
+	}
+
+	SSSE3_FUNCTION void DecodeBC1BlockSSSE3(const uint8_t* block, uint8_t* pixels, size_t pitch)
+	{
+		alignas(16) uint32_t palette[4];
+		ColourPalette(block, false, palette);
+		__m128i colours = _mm_load_si128(reinterpret_cast<const __m128i*>(palette));
+
+		for (int y = 0; y < 4; ++y)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + y * pitch), ColourRowSSSE3(colours, block[4 + y]));
+		}
+	}
+
+	SSSE3_FUNCTION void DecodeBC3BlockSSSE3(const uint8_t* block, uint8_t* pixels, size_t pitch)
+	{
+		__m128i alpha = AlphaValuesSSSE3(block);
+
+		alignas(16) uint32_t palette[4];
+		ColourPalette(block + 8, true, palette);
+		__m128i colours = _mm_load_si128(reinterpret_cast<const __m128i*>(palette));
+		const __m128i rgbMask = _mm_set1_epi32(0x00ffffff);
+
+		for (int y = 0; y < 4; ++y)
+		{
+			__m128i row = _mm_and_si128(ColourRowSSSE3(colours, block[12 + y]), rgbMask);
+			row = _mm_or_si128(row, _mm_shuffle_epi8(alpha, LoadShuffle(Shuffles.alphaRow[y])));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + y * pitch), row);
+		}
+	}
+
+	SSSE3_FUNCTION void DecodeBC4BlockSSSE3(const uint8_t* block, uint8_t* pixels, size_t pitch)
+	{
+		__m128i red = AlphaValuesSSSE3(block);
+		const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xff000000));
+
+		for (int y = 0; y < 4; ++y)
+		{
+			__m128i row = _mm_shuffle_epi8(red, LoadShuffle(Shuffles.redRow[y]));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + y * pitch), _mm_or_si128(row, opaque));
+		}
+	}
+
+	SSSE3_FUNCTION void DecodeBC5BlockSSSE3(const uint8_t* block, uint8_t* pixels, size_t pitch)
+	{
+		__m128i red = AlphaValuesSSSE3(block);
+		__m128i green = AlphaValuesSSSE3(block + 8);
+		const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xff000000));
+
+		for (int y = 0; y < 4; ++y)
+		{
+			__m128i row = _mm_or_si128(_mm_shuffle_epi8(red, LoadShuffle(Shuffles.redRow[y])),
+			                           _mm_shuffle_epi8(green, LoadShuffle(Shuffles.greenRow[y])));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + y * pitch), _mm_or_si128(row, opaque));
+		}
+	}
+#endif
+
+	//Return the block decoder for a format
+	BlockDecoder GetBlockDecoder(ImageFormat format, bool useSIMD)
+	{
+#if BC_DECODE_SIMD
+		if (useSIMD)
+		{
+			if (format == ImageFormat::BC1) return DecodeBC1BlockSSSE3;
+			if (format == ImageFormat::BC3) return DecodeBC3BlockSSSE3;
+			if (format == ImageFormat::BC4) return DecodeBC4BlockSSSE3;
+			if (format == ImageFormat::BC5) return DecodeBC5BlockSSSE3;
+		}
+#endif
+		switch (format)
+		{
+		case ImageFormat::BC1: return DecodeBC1Block;
+		case ImageFormat::BC3: return DecodeBC3Block;
+		case ImageFormat::BC4: return DecodeBC4Block;
+		case ImageFormat::BC5: return DecodeBC5Block;
+		case ImageFormat::BC7: return DecodeBC7Block;
+		default:               return nullptr;
+		}
+	}
+
+	//Decode a range of block rows of one mip. Blocks overhanging the edge of the image are decoded to a temporary
+	void DecodeBlockRows(BlockDecoder decode, const CImage& source, CImage& destination, uint32_t mip, uint32_t firstRow, uint32_t endRow)
+	{
+		const ImageMip& layout = destination.GetMip(mip);
+		uint32_t blockBytes = GetFormatBytes(source.GetFormat());
+		uint32_t columns = (layout.width + 3) / 4;
+
+		for (uint32_t blockY = firstRow; blockY < endRow; ++blockY)
+		{
+			const uint8_t* block = source.GetRow(mip, blockY);
+			uint32_t y = blockY * 4;
+			uint32_t height = std::min(layout.height - y, 4u);
+
+			for (uint32_t blockX = 0; blockX < columns; ++blockX, block += blockBytes)
+			{
+				uint32_t x = blockX * 4;
+				uint8_t* pixels = destination.GetRow(mip, y) + x * 4;
+				if (x + 4 <= layout.width && height == 4)
+				{
+					decode(block, pixels, layout.rowPitch);
+					continue;
+				}
+
+				uint8_t temporary[64];
+				decode(block, temporary, 16);
+				uint32_t width = std::min(layout.width - x, 4u);
+				for (uint32_t row = 0; row < height; ++row)
+				{
+					memcpy(pixels + row * layout.rowPitch, temporary + row * 16, width * 4);
+				}
+			}
+		}
+	}
+}
+
+
+//-------------------------------------
+// Scalar block decoding
+//-------------------------------------
+
+void DecodeBC1Block(const uint8_t* block, uint8_t* pixels, size_t pitch)
+{
+	uint32_t palette[4];
+	ColourPalette(block, false, palette);
+
+	uint32_t indices = Read32(block + 4);
+	for (int y = 0; y < 4; ++y)
+	{
+		for (int x = 0; x < 4; ++x, indices >>= 2)
+		{
+			memcpy(pixels + y * pitch + x * 4, &palette[indices & 3], 4);
+		}
+	}
+}
+
+void DecodeBC3Block(const uint8_t* block, uint8_t* pixels, size_t pitch)
+{
+	uint8_t alpha[8];
+	AlphaPalette(block, alpha);
+	uint64_t alphaIndices = AlphaIndices(block);
+
+	uint32_t palette[4];
+	ColourPalette(block + 8, true, palette);
+	uint32_t indices = Read32(block + 12);
+
+	for (int y = 0; y < 4; ++y)
+	{
+		for (int x = 0; x < 4; ++x, indices >>= 2, alphaIndices >>= 3)
+		{
+			uint8_t* pixel = pixels + y * pitch + x * 4;
+			memcpy(pixel, &palette[indices & 3], 4);
+			pixel[3] = alpha[alphaIndices & 7];
+		}
+	}
+}
+
+void DecodeBC4Block(const uint8_t* block, uint8_t* pixels, size_t pitch)
+{
+	uint8_t red[8];
+	AlphaPalette(block, red);
+	uint64_t indices = AlphaIndices(block);
+
+	for (int y = 0; y < 4; ++y)
+	{
+		for (int x = 0; x < 4; ++x, indices >>= 3)
+		{
+			uint8_t* pixel = pixels + y * pitch + x * 4;
+			pixel[0] = red[indices & 7];
+			pixel[1] = 0;
+			pixel[2] = 0;
+			pixel[3] = 255;
+		}
+	}
+}
+
+void DecodeBC5Block(const uint8_t* block, uint8_t* pixels, size_t pitch)
+{
+	uint8_t red[8], green[8];
+	AlphaPalette(block, red);
+	AlphaPalette(block + 8, green);
+	uint64_t redIndices = AlphaIndices(block);
+	uint64_t greenIndices = AlphaIndices(block + 8);
+
+	for (int y = 0; y < 4; ++y)
+	{
+		for (int x = 0; x < 4; ++x, redIndices >>= 3, greenIndices >>= 3)
+		{
+			uint8_t* pixel = pixels + y * pitch + x * 4;
+			pixel[0] = red[redIndices & 7];
+			pixel[1] = green[greenIndices & 7];
+			pixel[2] = 0;
+			pixel[3] = 255;
+		}
+	}
+}
+
+void DecodeBC7Block(const uint8_t* block, uint8_t* pixels, size_t pitch)
+{
+	//The mode is given by the position of the lowest set bit. A block with none is reserved and decodes to zero
+	uint32_t modeIndex = 0;
+	while (modeIndex < 8 && (block[0] & (1 << modeIndex)) == 0) ++modeIndex;
+	if (modeIndex == 8)
+	{
+		for (int y = 0; y < 4; ++y) memset(pixels + y * pitch, 0, 16);
+		return;
+	}
+	const BC7Mode& mode = BC7Modes[modeIndex];
+
+	BlockBits bits(block);
+	bits.Read(modeIndex + 1);
+	uint32_t partition      = bits.Read(mode.partitionBits);
+	uint32_t rotation       = bits.Read(mode.rotationBits);
+	uint32_t indexSelection = bits.Read(mode.indexSelectionBits);
+
+	//Endpoints are stored as all the reds, then all the greens, blues and alphas
+	uint32_t endpointCount = mode.subsets * 2u;
+	uint32_t endpoints[6][4];
+	for (uint32_t channel = 0; channel < 4; ++channel)
+	{
+		uint32_t channelBits = channel < 3 ? mode.colourBits : mode.alphaBits;
+		for (uint32_t e = 0; e < endpointCount; ++e) endpoints[e][channel] = bits.Read(channelBits);
+	}
+
+	//Add the p-bits as an extra low bit, then expand every channel to 8 bits by repeating its top bits
+	uint32_t pBits[6] = {};
+	for (uint32_t e = 0; e < endpointCount && mode.endpointPBits; ++e) pBits[e] = bits.Read(1);
+	for (uint32_t s = 0; s < mode.subsets && mode.sharedPBits; ++s) pBits[2 * s] = pBits[2 * s + 1] = bits.Read(1);
+
+	bool hasPBits = mode.endpointPBits || mode.sharedPBits;
+	for (uint32_t e = 0; e < endpointCount; ++e)
+	{
+		for (uint32_t channel = 0; channel < 4; ++channel)
+		{
+			uint32_t channelBits = channel < 3 ? mode.colourBits : mode.alphaBits;
+			if (channelBits == 0)
+			{
+				endpoints[e][channel] = 255;
+				continue;
+			}
+
+			uint32_t value = endpoints[e][channel];
+			if (hasPBits)
+			{
+				value = value << 1 | pBits[e];
+				++channelBits;
+			}
+			value <<= 8 - channelBits;
+			endpoints[e][channel] = value | value >> channelBits;
+		}
+	}
+
+	//Subset of each pixel and the pixels whose index has an implied top bit of 0
+	uint32_t subsets[16];
+	bool anchors[16] = { true };
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		if (mode.subsets == 1)      subsets[i] = 0;
+		else if (mode.subsets == 2) subsets[i] = (BC7Partitions2[partition] >> i) & 1;
+		else                        subsets[i] = (BC7Partitions3[partition] >> (2 * i)) & 3;
+	}
+	if (mode.subsets == 2)
+	{
+		anchors[BC7Anchors2[partition]] = true;
+	}
+	else if (mode.subsets == 3)
+	{
+		anchors[BC7Anchors3Second[partition]] = true;
+		anchors[BC7Anchors3Third[partition]] = true;
+	}
+
+	uint32_t indices[16];
+	uint32_t secondaryIndices[16] = {};
+	for (uint32_t i = 0; i < 16; ++i) indices[i] = bits.Read(mode.indexBits - (anchors[i] ? 1 : 0));
+	if (mode.secondaryIndexBits)
+	{
+		for (uint32_t i = 0; i < 16; ++i) secondaryIndices[i] = bits.Read(mode.secondaryIndexBits - (i == 0 ? 1 : 0));
+	}
+
+	//With two sets of indices colour uses the first and alpha the second, unless the index selection bit swaps them
+	const uint8_t* colourWeights = BC7Weights(mode.indexBits);
+	const uint8_t* alphaWeights = colourWeights;
+	const uint32_t* colourIndices = indices;
+	const uint32_t* alphaIndices = indices;
+	if (mode.secondaryIndexBits)
+	{
+		alphaWeights = BC7Weights(mode.secondaryIndexBits);
+		alphaIndices = secondaryIndices;
+		if (indexSelection)
+		{
+			std::swap(colourWeights, alphaWeights);
+			std::swap(colourIndices, alphaIndices);
+		}
+	}
+
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		const uint32_t* e0 = endpoints[2 * subsets[i]];
+		const uint32_t* e1 = endpoints[2 * subsets[i] + 1];
+		uint32_t colourWeight = colourWeights[colourIndices[i]];
+		uint32_t alphaWeight = alphaWeights[alphaIndices[i]];
+
+		uint8_t* pixel = pixels + (i / 4) * pitch + (i % 4) * 4;
+		for (uint32_t channel = 0; channel < 3; ++channel)
+		{
+			pixel[channel] = static_cast<uint8_t>(((64 - colourWeight) * e0[channel] + colourWeight * e1[channel] + 32) >> 6);
+		}
+		pixel[3] = static_cast<uint8_t>(((64 - alphaWeight) * e0[3] + alphaWeight * e1[3] + 32) >> 6);
+
+		//Rotation swaps alpha with one of the colour channels
+		if (rotation > 0) std::swap(pixel[3], pixel[rotation - 1]);
+	}
+}
+
+
+//-------------------------------------
+// Image decompression
+//-------------------------------------
+
+//Decompress every mip of a block compressed image into an RGBA8 image
+bool DecompressBC(const CImage& source, CImage& destination, CThreadPool* threads, bool useSIMD)
+{
+	BlockDecoder decode = GetBlockDecoder(source.GetFormat(), useSIMD && HasBCDecodeSIMD());
+	if (!decode) return false;
+	if (!destination.Create(ImageFormat::RGBA8, source.GetWidth(), source.GetHeight(), source.GetMipCount())) return false;
+
+	//A few ranges of block rows per worker, so a worker that falls behind does not hold up the rest
+	if (threads && threads->GetThreadCount() == 0) threads = nullptr;
+	uint32_t rowsPerTask = 0;
+	if (threads)
+	{
+		uint32_t totalRows = 0;
+		for (uint32_t mip = 0; mip < source.GetMipCount(); ++mip) totalRows += source.GetMip(mip).rows;
+		rowsPerTask = std::max(totalRows / (threads->GetThreadCount() * 4), 1u);
+	}
+
+	for (uint32_t mip = 0; mip < source.GetMipCount(); ++mip)
+	{
+		uint32_t rows = source.GetMip(mip).rows;
+		if (!threads)
+		{
+			DecodeBlockRows(decode, source, destination, mip, 0, rows);
+			continue;
+		}
+		for (uint32_t first = 0; first < rows; first += rowsPerTask)
+		{
+			uint32_t end = std::min(first + rowsPerTask, rows);
+			threads->Submit([decode, &source, &destination, mip, first, end]()
+			{
+				DecodeBlockRows(decode, source, destination, mip, first, end);
+			});
+		}
+	}
+	if (threads) threads->Wait();
+	return true;
+}
+
+//Return true if the processor supports the SIMD decoding path
+bool HasBCDecodeSIMD()
+{
+#if BC_DECODE_SIMD
+	static const bool supported = []()
+	{
+	#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		return (info[2] & (1 << 9)) != 0;
+	#else
+		return __builtin_cpu_supports("ssse3") != 0;
+	#endif
+	}();
+	return supported;
+#else
+	return false;
+#endif
+}
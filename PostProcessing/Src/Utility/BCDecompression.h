@@ -0,0 +1,30 @@
+//--------------------------------------------------------------------------------------
+// CPU decompression of BC1, BC3, BC4, BC5 and BC7 blocks
+//--------------------------------------------------------------------------------------
+// Each block of 4x4 pixels decodes independently, so a whole image is decoded a range of block
+// rows at a time across the workers of a thread pool. BC1 and BC3 - BC5 use SSSE3 byte shuffles
+// to look up a whole row of palette entries at once when the processor supports them (checked
+// at run time, so the same build runs anywhere); BC7's per-block modes are decoded in scalar code.
+// Results follow the D3D specification's integer interpolation, as used by most CPU decoders,
+// so may differ from a GPU's by a unit or so in the last place.
+#pragma once
+#include "CImage.h"
+#include <cstddef>
+#include <cstdint>
+
+class CThreadPool;
+
+//Decode one block into 4 rows of 4 RGBA8 pixels, pitch bytes apart
+void DecodeBC1Block(const uint8_t* block, uint8_t* pixels, size_t pitch);
+void DecodeBC3Block(const uint8_t* block, uint8_t* pixels, size_t pitch);
+void DecodeBC4Block(const uint8_t* block, uint8_t* pixels, size_t pitch); // Red, green and blue 0, alpha 255
+void DecodeBC5Block(const uint8_t* block, uint8_t* pixels, size_t pitch); // Red and green, blue 0, alpha 255
+void DecodeBC7Block(const uint8_t* block, uint8_t* pixels, size_t pitch);
+
+//Decompress every mip of a block compressed image into an RGBA8 image. Rows of blocks are shared between the
+//pool's workers, or decoded on the calling thread without a pool. Set useSIMD to false to force the scalar code,
+//e.g. to compare the two. Returns false if the source is not block compressed
+bool DecompressBC(const CImage& source, CImage& destination, CThreadPool* threads = nullptr, bool useSIMD = true);
+
+//Return true if the processor supports the SIMD decoding path
+bool HasBCDecodeSIMD();
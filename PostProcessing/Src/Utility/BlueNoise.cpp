@@ -0,0 +1,289 @@
+//--------------------------------------------------------------------------------------
+// Generating tiles of blue noise for the film grain
+//--------------------------------------------------------------------------------------
+
+#include "BlueNoise.h"
+#include "CThreadPool.h"
+#include "ImageDecoders.h"
+#include "ImageEncoders.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <random>
+
+namespace
+{
+	//Run a function over ranges of [0, count) on the pool's workers, or all at once on this thread without a pool
+	void ParallelFor(CThreadPool* threads, uint32_t count, const std::function<void(uint32_t, uint32_t)>& function)
+	{
+		if (!threads || threads->GetThreadCount() == 0 || count < 2)
+		{
+			function(0, count);
+			return;
+		}
+		uint32_t step = std::max(count / (threads->GetThreadCount() * 4), 1u);
+		for (uint32_t first = 0; first < count; first += step)
+		{
+			uint32_t end = std::min(first + step, count);
+			threads->Submit([&function, first, end]() { function(first, end); });
+		}
+		threads->Wait();
+	}
+
+	//Texels either way the Gaussian reaches before it is cut off, 3 sigma
+	const int Radius = static_cast<int>(std::ceil(3.0f * BlueNoiseSigma));
+	const int KernelWidth = 2 * Radius + 1;
+
+	//Share of the tile set at random to begin the prototype pattern
+	const float InitialShare = 0.1f;
+
+	const uint32_t None = ~0u;
+
+
+	//-------------------------------------
+	// Void and cluster
+	//-------------------------------------
+
+	//A binary pattern on a tile that wraps, with the energy of each texel - the Gaussian weighted sum of the set texels around
+	//it - and the tightest cluster and largest void of each row
+	class CPattern
+	{
+	public:
+		CPattern(uint32_t size, const std::vector<float>& kernel)
+			: m_Size(size), m_Kernel(&kernel), m_Set(size * size, 0), m_Energy(size * size, 0.0f), m_RowCluster(size, None), m_RowVoid(size)
+		{
+			for (uint32_t y = 0; y < size; ++y) m_RowVoid[y] = y * size;
+		}
+
+		uint32_t GetSetCount() const { return m_SetCount; }
+
+		//Set or clear a texel, updating the energy within reach and the rows it changed
+		void Toggle(uint32_t texel)
+		{
+			const int x = static_cast<int>(texel % m_Size), y = static_cast<int>(texel / m_Size), size = static_cast<int>(m_Size);
+			const float sign = m_Set[texel] ? -1.0f : 1.0f;
+			m_Set[texel] ^= 1;
+			m_SetCount += m_Set[texel] ? 1 : -1;
+
+			for (int dy = -Radius; dy <= Radius; ++dy)
+			{
+				float* row = m_Energy.data() + static_cast<size_t>((y + dy + size) % size) * m_Size;
+				const float* weights = m_Kernel->data() + (dy + Radius) * KernelWidth;
+				for (int dx = -Radius; dx <= Radius; ++dx)
+				{
+					row[(x + dx + size) % size] += sign * weights[dx + Radius];
+				}
+			}
+			for (int dy = -Radius; dy <= Radius; ++dy) UpdateRow(static_cast<uint32_t>((y + dy + size) % size));
+		}
+
+		//Set texel with the highest energy, the first of any equal
+		uint32_t FindTightestCluster() const
+		{
+			uint32_t best = None;
+			for (uint32_t cluster : m_RowCluster)
+			{
+				if (cluster != None && (best == None || m_Energy[cluster] > m_Energy[best])) best = cluster;
+			}
+			return best;
+		}
+
+		//Clear texel with the lowest energy, the first of any equal
+		uint32_t FindLargestVoid() const
+		{
+			uint32_t best = None;
+			for (uint32_t gap : m_RowVoid)
+			{
+				if (gap != None && (best == None || m_Energy[gap] < m_Energy[best])) best = gap;
+			}
+			return best;
+		}
+
+	private:
+		void UpdateRow(uint32_t y)
+		{
+			uint32_t cluster = None, gap = None;
+			for (uint32_t texel = y * m_Size; texel < (y + 1) * m_Size; ++texel)
+			{
+				if (m_Set[texel])
+				{
+					if (cluster == None || m_Energy[texel] > m_Energy[cluster]) cluster = texel;
+				}
+				else
+				{
+					if (gap == None || m_Energy[texel] < m_Energy[gap]) gap = texel;
+				}
+			}
+			m_RowCluster[y] = cluster;
+			m_RowVoid[y] = gap;
+		}
+
+		uint32_t                  m_Size;
+		const std::vector<float>* m_Kernel;
+		std::vector<uint8_t>      m_Set;
+		std::vector<float>        m_Energy;
+		std::vector<uint32_t>     m_RowCluster;
+		std::vector<uint32_t>     m_RowVoid;
+		uint32_t                  m_SetCount = 0;
+	};
+
+	//Gaussian weights over the square within reach, unnormalized as only their order matters
+	std::vector<float> MakeKernel()
+	{
+		std::vector<float> kernel(KernelWidth * KernelWidth);
+		for (int dy = -Radius; dy <= Radius; ++dy)
+		{
+			for (int dx = -Radius; dx <= Radius; ++dx)
+			{
+				kernel[(dy + Radius) * KernelWidth + dx + Radius] = std::exp(-(dx * dx + dy * dy) / (2.0f * BlueNoiseSigma * BlueNoiseSigma));
+			}
+		}
+		return kernel;
+	}
+
+	//Rank every texel of a tile 0 -> size * size - 1, starting from the given random generator
+	void RankTexels(uint32_t size, const std::vector<float>& kernel, std::mt19937& random, std::vector<uint32_t>& ranks)
+	{
+		const uint32_t texels = size * size;
+		ranks.assign(texels, 0);
+
+		//Set a share of the texels at random, shuffling with the generator's own output so every platform sets the same ones
+		std::vector<uint32_t> order(texels);
+		for (uint32_t i = 0; i < texels; ++i) order[i] = i;
+		for (uint32_t i = texels - 1; i > 0; --i) std::swap(order[i], order[random() % (i + 1)]);
+
+		CPattern prototype(size, kernel);
+		const uint32_t initialCount = std::max(static_cast<uint32_t>(texels * InitialShare), 1u);
+		for (uint32_t i = 0; i < initialCount; ++i) prototype.Toggle(order[i]);
+
+		//Move the tightest cluster to the largest void until the largest void is where the cluster came from
+		for (uint32_t step = 0; step < texels; ++step)
+		{
+			uint32_t cluster = prototype.FindTightestCluster();
+			prototype.Toggle(cluster);
+			uint32_t gap = prototype.FindLargestVoid();
+			prototype.Toggle(gap);
+			if (gap == cluster) break;
+		}
+
+		//Take clusters out of the prototype, each ranked below the last
+		CPattern pattern = prototype;
+		while (pattern.GetSetCount() > 0)
+		{
+			uint32_t cluster = pattern.FindTightestCluster();
+			pattern.Toggle(cluster);
+			ranks[cluster] = pattern.GetSetCount();
+		}
+
+		//Fill voids from the prototype, each ranked above the last. Every texel's energy from the set texels and from the clear
+		//ones adds up to the same total, so past half way the largest void of the set texels is still the tightest cluster of
+		//the clear ones, and Ulichney's third phase needs no separate pattern
+		pattern = prototype;
+		while (pattern.GetSetCount() < texels)
+		{
+			uint32_t gap = pattern.FindLargestVoid();
+			ranks[gap] = pattern.GetSetCount();
+			pattern.Toggle(gap);
+		}
+	}
+}
+
+
+//-------------------------------------
+// Tiles
+//-------------------------------------
+
+bool GenerateBlueNoise(uint32_t size, uint32_t channels, CImage& tile, CThreadPool* threads, uint32_t seed)
+{
+	ImageFormat format;
+	switch (channels)
+	{
+		case 1:  format = ImageFormat::R8;    break;
+		case 2:  format = ImageFormat::RG8;   break;
+		case 4:  format = ImageFormat::RGBA8; break;
+		default: return false;
+	}
+	if (size < MinBlueNoiseSize || size > MaxBlueNoiseSize) return false;
+
+	//Each channel is ranked on its own, from a generator seeded for it, so the pool gives the same tile as one thread
+	const std::vector<float> kernel = MakeKernel();
+	std::vector<std::vector<uint32_t>> ranks(channels);
+	ParallelFor(threads, channels, [&](uint32_t first, uint32_t end)
+	{
+		for (uint32_t channel = first; channel < end; ++channel)
+		{
+			std::mt19937 random(seed * 4 + channel);
+			RankTexels(size, kernel, random, ranks[channel]);
+		}
+	});
+
+	//Spread the ranks evenly over the bytes, so each value is used equally often
+	tile.Create(format, size, size);
+	const uint64_t texels = static_cast<uint64_t>(size) * size;
+	for (uint32_t y = 0; y < size; ++y)
+	{
+		uint8_t* row = tile.GetRow(0, y);
+		for (uint32_t x = 0; x < size; ++x)
+		{
+			for (uint32_t channel = 0; channel < channels; ++channel)
+			{
+				row[x * channels + channel] = static_cast<uint8_t>(ranks[channel][y * size + x] * 256ull / texels);
+			}
+		}
+	}
+	return true;
+}
+
+std::string GetBlueNoiseFileName(uint32_t size, uint32_t channels)
+{
+	std::string name = "BlueNoise" + std::to_string(size);
+	if (channels > 1) name += "x" + std::to_string(channels);
+	return name + ".dds";
+}
+
+bool LoadOrGenerateBlueNoise(const std::string& fileName, uint32_t size, uint32_t channels, CImage& tile, CThreadPool* threads, bool* generated)
+{
+	if (generated) *generated = false;
+
+	//Use the file if it holds a tile of the size asked for
+	std::ifstream stream(fileName, std::ios::binary);
+	if (stream)
+	{
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+		std::string error;
+		if (DecodeImage(data.data(), data.size(), tile, error) && tile.GetWidth() == size && tile.GetHeight() == size &&
+		    GetFormatBytes(tile.GetFormat()) == channels)
+		{
+			return true;
+		}
+	}
+	stream.close();
+
+	if (!GenerateBlueNoise(size, channels, tile, threads)) return false;
+	if (generated) *generated = true;
+
+	std::vector<uint8_t> file;
+	std::string error;
+	if (!EncodeDDS(tile, file, error)) return false;
+	std::ofstream out(fileName, std::ios::binary);
+	out.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+	return static_cast<bool>(out);
+}
+
+
+//-------------------------------------
+// Offsets
+//-------------------------------------
+
+void GetBlueNoiseOffset(uint32_t frame, float& u, float& v)
+{
+	//R2 steps by the reciprocals of the plastic number - the root of x^3 = x + 1 - and its square, from the middle of the tile.
+	//Worked in doubles so offsets stay as even after millions of frames
+	const double stepU = 0.7548776662466927, stepV = 0.5698402909980532;
+	double unused;
+	u = static_cast<float>(std::modf(0.5 + frame * stepU, &unused));
+	v = static_cast<float>(std::modf(0.5 + frame * stepV, &unused));
+}
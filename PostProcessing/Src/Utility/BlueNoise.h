@@ -0,0 +1,37 @@
+//--------------------------------------------------------------------------------------
+// Generating tiles of blue noise for the film grain
+//--------------------------------------------------------------------------------------
+// Blue noise has almost none of its energy at low frequencies, so the grain GreyNoise_ps adds
+// looks even at any scale and its tile's repeats are hard to pick out, unlike Noise.png's white
+// noise. Tiles are made offline by "AssetTool blue-noise --out" and shipped in Media.
+#pragma once
+#include "CImage.h"
+
+#include <string>
+
+class CThreadPool;
+
+//Smallest and largest tiles that can be made. The Gaussian must fit within the tile
+const uint32_t MinBlueNoiseSize = 16;
+const uint32_t MaxBlueNoiseSize = 256;
+
+//Standard deviation of the Gaussian clusters and voids are measured with, in texels (Ulichney's 1.5)
+const float BlueNoiseSigma = 1.5f;
+
+//Make a tile of blue noise size texels square (MinBlueNoiseSize -> MaxBlueNoiseSize) with 1, 2 or 4 channels of independent
+//noise - R8, RG8 or RGBA8 - using the pool's workers if one is given, which gives identical results. Each channel ranks every
+//texel by Ulichney's void-and-cluster method, with distances wrapping so the tile repeats seamlessly, from a random start the
+//seed chooses. Returns false for other sizes or channel counts
+bool GenerateBlueNoise(uint32_t size, uint32_t channels, CImage& tile, CThreadPool* threads = nullptr, uint32_t seed = 1);
+
+//File a tile is cached in, e.g. "BlueNoise64.dds", or "BlueNoise64x4.dds" for more than one channel
+std::string GetBlueNoiseFileName(uint32_t size, uint32_t channels);
+
+//Load a tile from the given DDS file, or make it and write the file if there is none. Returns false if it cannot be made, or
+//written when asked to make it. Sets generated, if given, to whether it was made
+bool LoadOrGenerateBlueNoise(const std::string& fileName, uint32_t size, uint32_t channels, CImage& tile, CThreadPool* threads = nullptr,
+                             bool* generated = nullptr);
+
+//Offset 0->1 across the tile for a frame, from the R2 sequence, which spreads any run of frames evenly across the tile where
+//random offsets can land two frames close together
+void GetBlueNoiseOffset(uint32_t frame, float& u, float& v);
@@ -0,0 +1,96 @@
+//--------------------------------------------------------------------------------------
+// Gaussian blur kernels for the linear-sampling blur shaders
+//--------------------------------------------------------------------------------------
+
+#include "BlurKernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+	const float KernelSigmas = 3.0f; // The kernel reaches this many standard deviations from the centre, if the taps allow
+}
+
+
+//Return the pixels either side of the centre the kernel for sigma covers, limited by the taps allowed
+int GetBlurKernelRadius(float sigma, int maxTaps)
+{
+	if (!(sigma > 0.0f)) return 0;
+
+	//The centre, then two pixels a tap
+	const int maxRadius = 2 * (std::clamp(maxTaps, 1, MaxBlurTaps) - 1);
+	return std::min(static_cast<int>(std::ceil(KernelSigmas * std::min(sigma, 1e4f))), maxRadius);
+}
+
+//Return the weights of pixels 0 to radius from the centre of a Gaussian sampled at each pixel, adding up to 1 over the kernel
+std::vector<double> ComputeGaussianWeights(float sigma, int radius)
+{
+	std::vector<double> weights(std::max(radius, 0) + 1, 0.0);
+	if (!(sigma > 0.0f) || radius < 1)
+	{
+		weights[0] = 1.0;
+		return weights;
+	}
+
+	//The centre counts once and the others twice, once each side, and the weights cut off past the radius are shared out
+	double total = 0.0;
+	for (int i = 0; i <= radius; ++i)
+	{
+		weights[i] = std::exp(-0.5 * i * i / (static_cast<double>(sigma) * sigma));
+		total += i ? 2.0 * weights[i] : weights[i];
+	}
+	for (double& weight : weights) weight /= total;
+	return weights;
+}
+
+//Return the taps of a blur of standard deviation sigma pixels using at most maxTaps
+std::vector<BlurTap> ComputeBlurTaps(float sigma, int maxTaps)
+{
+	const int radius = GetBlurKernelRadius(sigma, maxTaps);
+	const std::vector<double> weights = ComputeGaussianWeights(sigma, radius);
+
+	std::vector<BlurTap> taps;
+	taps.push_back({ 0.0f, static_cast<float>(weights[0]) });
+	for (int i = 1; i <= radius; i += 2)
+	{
+		//Where bilinear filtering blends pixels i and i + 1 in the ratio of their weights. Past the radius the weight is 0
+		double first = weights[i], second = i < radius ? weights[i + 1] : 0.0;
+		double weight = first + second;
+		taps.push_back({ static_cast<float>((i * first + (i + 1) * second) / weight), static_cast<float>(weight) });
+	}
+	return taps;
+}
+
+//Put taps in the post-process constants, for the blur shaders
+void SetBlurTapConstants(PostProcessingConstants& constants, const std::vector<BlurTap>& taps)
+{
+	const size_t count = std::min(taps.size(), static_cast<size_t>(MaxBlurTaps));
+	for (size_t i = 0; i < MaxBlurTaps; ++i)
+	{
+		constants.blurTaps[i] = i < count ? CVector4{ taps[i].offset, taps[i].weight, 0, 0 } : CVector4{ 0, 0, 0, 0 };
+	}
+	constants.blurTapCount = static_cast<float>(count);
+}
+
+//Return the taps as HLSL for a shader with a fixed blur
+std::string FormatBlurTapsHLSL(const std::vector<BlurTap>& taps, float sigma)
+{
+	std::ostringstream text;
+	text << std::setprecision(9);
+	text << "// Linear-sampling Gaussian blur of sigma " << sigma << " pixels, " << taps.size() * 2 - 1 << " fetches\n";
+	text << "// Generated by AssetTool blur-kernel (see Utility/BlurKernel.h) - do not edit\n\n";
+	text << std::fixed;
+	text << "static const int BlurTapCount = " << taps.size() << ";\n\n";
+	text << "// Pixels from the centre of each tap, fetched either side of it after the first\n";
+	text << "static const float BlurTapOffsets[" << taps.size() << "] = {";
+	for (size_t i = 0; i < taps.size(); ++i) text << (i ? ", " : " ") << taps[i].offset << "f";
+	text << " };\n\n";
+	text << "// Weights of the colour fetched at each tap\n";
+	text << "static const float BlurTapWeights[" << taps.size() << "] = {";
+	for (size_t i = 0; i < taps.size(); ++i) text << (i ? ", " : " ") << taps[i].weight << "f";
+	text << " };\n";
+	return text.str();
+}
@@ -0,0 +1,37 @@
+//--------------------------------------------------------------------------------------
+// Gaussian blur kernels for the linear-sampling blur shaders
+//--------------------------------------------------------------------------------------
+// Tables of taps for HorizontalBlur_ps and VerticalBlur_ps, each tap placed between two pixels of
+// a Gaussian so one bilinear fetch weighs both.
+#pragma once
+#include "project/PostProcessingConstants.h"
+
+#include <string>
+#include <vector>
+
+//One fetch of a linear-sampling blur: weight of the colour offset pixels along the line, each side of the centre
+struct BlurTap
+{
+	float offset = 0.0f;
+	float weight = 0.0f;
+};
+
+//Return the pixels either side of the centre the kernel for sigma covers - out to 3 sigma, limited by the taps allowed
+int GetBlurKernelRadius(float sigma, int maxTaps = MaxBlurTaps);
+
+//Return the weights of pixels 0 to radius from the centre of a Gaussian of standard deviation sigma pixels, sampled at each
+//pixel and scaled so the whole kernel, from -radius to radius, adds up to 1
+std::vector<double> ComputeGaussianWeights(float sigma, int radius);
+
+//Return the taps of a blur of standard deviation sigma pixels using at most maxTaps (1 -> MaxBlurTaps). The first is the
+//centre, fetched once, and the others are fetched either side of it, so a blur takes 2 * taps - 1 fetches. Pixels 1 and 2, 3
+//and 4 and so on are merged into a tap at the weighted average of their offsets, carrying the sum of their weights. The sampler
+//clamps both pixels a fetch reads, so edges are those of the discrete kernel clamped, and GPUs blend with a few bits of fraction,
+//8 on most, so differ from the exact kernel very slightly
+std::vector<BlurTap> ComputeBlurTaps(float sigma, int maxTaps = MaxBlurTaps);
+
+//Put taps in the post-process constants, for the blur shaders. The scene does this for its blur sigma each frame
+void SetBlurTapConstants(PostProcessingConstants& constants, const std::vector<BlurTap>& taps);
+
+//Return the taps as HLSL - the tap count and tables of offsets and weights as static constants - for a shader with a fixed blur
+std::string FormatBlurTapsHLSL(const std::vector<BlurTap>& taps, float sigma);
@@ -0,0 +1,298 @@
+//--------------------------------------------------------------------------------------
+// Single-file archive of the assets in Data/ and Media/
+//--------------------------------------------------------------------------------------
+
+#include "CAssetPack.h"
+#include "CContentHash.h"
+#include "LZCompression.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+	const char Magic[4] = { 'P', 'P', 'A', 'K' };
+
+	//A block stored uncompressed because compressing did not shrink it has this bit set in its size
+	const uint32_t RawBlock = 0x80000000;
+
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	uint64_t BlockCount(uint64_t size, uint32_t blockSize)
+	{
+		return (size + blockSize - 1) / blockSize;
+	}
+}
+
+//Return the name a file is stored under
+std::string CAssetPack::NormaliseName(const std::string& fileName)
+{
+	std::string name = std::filesystem::path(fileName).lexically_normal().generic_string();
+	if (name.compare(0, 2, "./") == 0) name.erase(0, 2);
+	return name;
+}
+
+//Return the hash of a normalised name, ignoring case
+uint64_t CAssetPack::HashName(const std::string& name)
+{
+	std::string lower = name;
+	std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return CContentHash::Hash(lower.data(), lower.size());
+}
+
+//Map a pack and check its table of contents
+bool CAssetPack::Open(const std::string& fileName)
+{
+	Close();
+	if (!m_File.Open(fileName)) return false;
+
+	const uint8_t* data = m_File.Data();
+	uint64_t size = m_File.Size();
+
+	PackHeader header;
+	if (size < sizeof(header))
+	{
+		Close();
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	if (memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version || header.blockSize == 0 ||
+	    header.tocOffset % Alignment != 0 ||
+	    header.tocOffset + uint64_t(header.entryCount) * sizeof(PackEntry) > size ||
+	    header.namesOffset + header.namesSize > size || header.namesSize == 0 || data[header.namesOffset + header.namesSize - 1] != 0)
+	{
+		Close();
+		return false;
+	}
+
+	//Check every entry up front so that Find and Read can trust the table
+	const PackEntry* entries = reinterpret_cast<const PackEntry*>(data + header.tocOffset);
+	for (uint32_t i = 0; i < header.entryCount; ++i)
+	{
+		const PackEntry& entry = entries[i];
+		bool valid = entry.offset + entry.storedSize <= size && entry.nameOffset < header.namesSize &&
+		             (i == 0 || entries[i - 1].nameHash <= entry.nameHash);
+		if (entry.codec == PackCodec::None)    valid = valid && entry.storedSize == entry.size;
+		else if (entry.codec == PackCodec::LZ) valid = valid && BlockCount(entry.size, header.blockSize) * sizeof(uint32_t) <= entry.storedSize;
+		else                                   valid = false;
+
+		if (!valid)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	m_Entries = entries;
+	m_EntryCount = header.entryCount;
+	m_Names = reinterpret_cast<const char*>(data + header.namesOffset);
+	m_BlockSize = header.blockSize;
+	return true;
+}
+
+//Return the entry for a file name
+const PackEntry* CAssetPack::Find(const std::string& fileName) const
+{
+	if (m_EntryCount == 0) return nullptr;
+
+	std::string name = NormaliseName(fileName);
+	uint64_t hash = HashName(name);
+
+	const PackEntry* end = m_Entries + m_EntryCount;
+	const PackEntry* entry = std::lower_bound(m_Entries, end, hash, [](const PackEntry& e, uint64_t h) { return e.nameHash < h; });
+	for (; entry != end && entry->nameHash == hash; ++entry)
+	{
+		const char* entryName = GetName(*entry);
+		if (name.size() == strlen(entryName) &&
+		    std::equal(name.begin(), name.end(), entryName, [](unsigned char a, unsigned char b) { return std::tolower(a) == std::tolower(b); }))
+		{
+			return entry;
+		}
+	}
+	return nullptr;
+}
+
+//Return a file's contents
+bool CAssetPack::Read(const PackEntry& entry, AssetSpan& contents, std::vector<uint8_t>& storage) const
+{
+	const uint8_t* payload = m_File.Data() + entry.offset;
+	if (entry.codec == PackCodec::None)
+	{
+		contents.data = payload;
+		contents.size = static_cast<size_t>(entry.size);
+		return true;
+	}
+
+	//Block sizes, then the blocks one after another
+	uint64_t blockCount = BlockCount(entry.size, m_BlockSize);
+	const uint8_t* block = payload + blockCount * sizeof(uint32_t);
+	const uint8_t* payloadEnd = payload + entry.storedSize;
+
+	storage.resize(static_cast<size_t>(entry.size));
+	for (uint64_t i = 0; i < blockCount; ++i)
+	{
+		uint32_t storedSize;
+		memcpy(&storedSize, payload + i * sizeof(uint32_t), sizeof(storedSize));
+		bool raw = (storedSize & RawBlock) != 0;
+		storedSize &= ~RawBlock;
+
+		uint64_t offset = i * m_BlockSize;
+		size_t blockSize = static_cast<size_t>(std::min<uint64_t>(m_BlockSize, entry.size - offset));
+		if (storedSize > static_cast<uint64_t>(payloadEnd - block)) return false;
+
+		if (raw)
+		{
+			if (storedSize != blockSize) return false;
+			memcpy(storage.data() + offset, block, blockSize);
+		}
+		else if (!LZDecompress(block, storedSize, storage.data() + offset, blockSize))
+		{
+			return false;
+		}
+		block += storedSize;
+	}
+
+	contents.data = storage.data();
+	contents.size = storage.size();
+	return true;
+}
+
+
+//Add a file to be stored under the given name
+void CAssetPackWriter::Add(const std::string& name, const std::string& fileName, bool compress)
+{
+	m_Sources.push_back({ CAssetPack::NormaliseName(name), fileName, compress });
+}
+
+//Write the pack
+bool CAssetPackWriter::Write(const std::string& fileName, std::string& error, Stats* stats)
+{
+	Stats written;
+
+	//Lay out the names first so the payloads can follow them
+	std::vector<PackEntry> entries(m_Sources.size());
+	std::string names;
+	for (size_t i = 0; i < m_Sources.size(); ++i)
+	{
+		entries[i] = PackEntry();
+		entries[i].nameHash = CAssetPack::HashName(m_Sources[i].name);
+		entries[i].nameOffset = static_cast<uint32_t>(names.size());
+		names += m_Sources[i].name;
+		names += '\0';
+	}
+	if (names.empty()) names += '\0';
+
+	PackHeader header = {};
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = CAssetPack::Version;
+	header.entryCount = static_cast<uint32_t>(entries.size());
+	header.blockSize = m_BlockSize;
+	header.tocOffset = AlignUp(sizeof(PackHeader), CAssetPack::Alignment);
+	header.namesOffset = header.tocOffset + entries.size() * sizeof(PackEntry);
+	header.namesSize = names.size();
+
+	std::ofstream pack(fileName, std::ios::binary | std::ios::trunc);
+	if (!pack.good())
+	{
+		error = "Cannot create " + fileName;
+		return false;
+	}
+
+	//Payloads are written first, then the header and sorted table are written over the space left for them
+	uint64_t position = AlignUp(header.namesOffset + header.namesSize, CAssetPack::Alignment);
+	std::vector<uint8_t> compressed;
+	for (size_t i = 0; i < m_Sources.size(); ++i)
+	{
+		const Source& source = m_Sources[i];
+		PackEntry& entry = entries[i];
+
+		std::vector<uint8_t> contents;
+		uint64_t size = 0;
+		if (!CContentHash::HashFile(source.fileName, entry.contentHash, size, &contents))
+		{
+			error = "Cannot read " + source.fileName;
+			return false;
+		}
+		entry.size = size;
+		entry.offset = position;
+		entry.codec = PackCodec::None;
+
+		const uint8_t* payload = contents.data();
+		uint64_t payloadSize = size;
+		if (source.compress)
+		{
+			//Compress each block separately, keeping any that do not shrink as they are
+			uint64_t blockCount = BlockCount(size, m_BlockSize);
+			compressed.assign(blockCount * sizeof(uint32_t), 0);
+			for (uint64_t b = 0; b < blockCount; ++b)
+			{
+				uint64_t offset = b * m_BlockSize;
+				size_t blockSize = static_cast<size_t>(std::min<uint64_t>(m_BlockSize, size - offset));
+
+				size_t start = compressed.size();
+				compressed.resize(start + LZCompressBound(blockSize));
+				uint32_t storedSize = static_cast<uint32_t>(LZCompress(contents.data() + offset, blockSize, compressed.data() + start));
+				if (storedSize >= blockSize)
+				{
+					memcpy(compressed.data() + start, contents.data() + offset, blockSize);
+					storedSize = static_cast<uint32_t>(blockSize) | RawBlock;
+				}
+				compressed.resize(start + (storedSize & ~RawBlock));
+				memcpy(compressed.data() + b * sizeof(uint32_t), &storedSize, sizeof(storedSize));
+			}
+
+			//Only worth unpacking at load time if it saves at least an eighth
+			if (compressed.size() < size - size / 8)
+			{
+				entry.codec = PackCodec::LZ;
+				payload = compressed.data();
+				payloadSize = compressed.size();
+				++written.compressed;
+			}
+		}
+		entry.storedSize = payloadSize;
+
+		pack.seekp(static_cast<std::streamoff>(position));
+		pack.write(reinterpret_cast<const char*>(payload), static_cast<std::streamsize>(payloadSize));
+		position = AlignUp(position + payloadSize, CAssetPack::Alignment);
+
+		++written.files;
+		written.originalBytes += size;
+	}
+
+	//Names are in the order added, the table is sorted by name hash
+	std::vector<PackEntry> sorted = entries;
+	std::stable_sort(sorted.begin(), sorted.end(), [](const PackEntry& a, const PackEntry& b) { return a.nameHash < b.nameHash; });
+
+	pack.seekp(0);
+	pack.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	pack.seekp(static_cast<std::streamoff>(header.tocOffset));
+	pack.write(reinterpret_cast<const char*>(sorted.data()), static_cast<std::streamsize>(sorted.size() * sizeof(PackEntry)));
+	pack.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+	//Pad the end so the last payload is a whole number of alignment units, matching the offsets above
+	pack.seekp(0, std::ios::end);
+	uint64_t end = static_cast<uint64_t>(pack.tellp());
+	if (end < position)
+	{
+		std::vector<char> padding(static_cast<size_t>(position - end), 0);
+		pack.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+	}
+
+	if (!pack.good())
+	{
+		error = "Cannot write " + fileName;
+		return false;
+	}
+
+	written.packBytes = position;
+	if (stats) *stats = written;
+	return true;
+}
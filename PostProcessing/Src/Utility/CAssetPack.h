@@ -0,0 +1,149 @@
+//--------------------------------------------------------------------------------------
+// Single-file archive of the assets in Data/ and Media/
+//--------------------------------------------------------------------------------------
+// Layout:  header | table of contents | names | payloads
+// The table of contents holds one PackEntry per file, sorted by the hash of the file's name so
+// that finding a file is a binary search. Names are stored normalised (see NormaliseName) and
+// compared after the hash to rule out collisions. Like Windows file names they are not case
+// sensitive. Each payload starts on a 64-byte boundary.
+// Payloads are either stored as they are, when the reader hands out pointers straight into the
+// memory-mapped pack, or split into blocks compressed with LZCompress, which are unpacked into
+// memory supplied by the caller. All values are little-endian.
+// Packs are built with "AssetTool pack".
+#pragma once
+#include "CMappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//How a pack entry's payload is stored
+enum class PackCodec : uint32_t
+{
+	None,   // The file's bytes as they are
+	LZ,     // Block sizes then blocks, see CAssetPack::Read
+};
+
+struct PackHeader
+{
+	char     magic[4];       // "PPAK"
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t blockSize;      // Uncompressed size of each compressed block, the last in an entry may be smaller
+	uint64_t tocOffset;
+	uint64_t namesOffset;
+	uint64_t namesSize;
+	uint64_t reserved;
+};
+
+struct PackEntry
+{
+	uint64_t  nameHash;      // See CAssetPack::HashName
+	uint64_t  contentHash;   // CContentHash of the uncompressed file
+	uint64_t  offset;        // Start of the payload from the start of the pack
+	uint64_t  storedSize;    // Size of the payload in the pack
+	uint64_t  size;          // Size of the original file
+	uint32_t  nameOffset;    // Start of the zero terminated name in the names section
+	PackCodec codec;
+};
+
+static_assert(sizeof(PackHeader) == 48 && sizeof(PackEntry) == 48, "Pack structures are written to disk as they are");
+
+//A range of bytes belonging to someone else - the pack's mapping or a caller's buffer
+struct AssetSpan
+{
+	const uint8_t* data = nullptr;
+	size_t         size = 0;
+};
+
+class CAssetPack
+{
+//----------------------//
+// Construction / Usage	//
+//----------------------//
+public:
+	static const uint32_t Version = 1;
+	static const uint32_t Alignment = 64;
+
+	//Map a pack and check its table of contents. Returns false if it is missing or damaged
+	bool Open(const std::string& fileName);
+
+	//Unmap the pack. Spans pointing into it must no longer be used
+	void Close() { m_File.Close(); m_Entries = nullptr; m_EntryCount = 0; }
+
+	bool IsOpen() const { return m_File.IsOpen(); }
+
+	//Return the entry for a file name, or nullptr if the file is not in the pack. Safe to call from any thread
+	const PackEntry* Find(const std::string& fileName) const;
+
+	//Return a file's contents. Uncompressed entries point into the pack without copying, compressed ones are
+	//unpacked into storage. Returns false if the entry is damaged. Safe to call from any thread
+	bool Read(const PackEntry& entry, AssetSpan& contents, std::vector<uint8_t>& storage) const;
+
+	//Return the name stored for an entry
+	const char* GetName(const PackEntry& entry) const { return m_Names + entry.nameOffset; }
+
+	//-------------------------------------
+	// Data access
+	//-------------------------------------
+
+	uint32_t         GetEntryCount()         const { return m_EntryCount; }
+	const PackEntry& GetEntry(uint32_t index) const { return m_Entries[index]; }
+	uint64_t         GetSize()               const { return m_File.Size(); }
+
+	//Return the name a file is stored under: relative path with forward slashes and "." and ".." removed
+	static std::string NormaliseName(const std::string& fileName);
+
+	//Return the hash of a normalised name that entries are sorted by, ignoring case
+	static uint64_t HashName(const std::string& name);
+
+//-------------//
+// Member data //
+//-------------//
+private:
+	CMappedFile      m_File;
+	const PackEntry* m_Entries = nullptr;
+	uint32_t         m_EntryCount = 0;
+	const char*      m_Names = nullptr;
+	uint32_t         m_BlockSize = 0;
+};
+
+
+//Builds a pack from files on disk
+class CAssetPackWriter
+{
+//----------------------//
+// Construction / Usage	//
+//----------------------//
+public:
+	//Sizes of what was written
+	struct Stats
+	{
+		uint32_t files = 0;
+		uint32_t compressed = 0;     // Files stored compressed, the rest did not shrink enough to be worth it
+		uint64_t originalBytes = 0;
+		uint64_t packBytes = 0;
+	};
+
+	explicit CAssetPackWriter(uint32_t blockSize = 256 * 1024) : m_BlockSize(blockSize) {}
+
+	//Add a file to be stored under the given name, compressing it if requested and worthwhile
+	void Add(const std::string& name, const std::string& fileName, bool compress);
+
+	//Write the pack, reading each file as it is added. Returns false with an error message on failure
+	bool Write(const std::string& fileName, std::string& error, Stats* stats = nullptr);
+
+//-------------//
+// Member data //
+//-------------//
+private:
+	struct Source
+	{
+		std::string name;
+		std::string fileName;
+		bool compress;
+	};
+
+	std::vector<Source> m_Sources;
+	uint32_t            m_BlockSize;
+};
@@ -0,0 +1,206 @@
+//--------------------------------------------------------------------------------------
+// Fast 64-bit non-cryptographic hash of file contents
+//--------------------------------------------------------------------------------------
+
+#include "CContentHash.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+	const uint64_t Prime1 = 11400714785074694791ULL;
+	const uint64_t Prime2 = 14029467366897019727ULL;
+	const uint64_t Prime3 = 1609587929392839161ULL;
+	const uint64_t Prime4 = 9650029242287828579ULL;
+	const uint64_t Prime5 = 2870177450012600261ULL;
+
+	inline uint64_t RotateLeft(uint64_t value, int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	//Unaligned little-endian reads
+	inline uint64_t Read64(const uint8_t* p) { uint64_t v; memcpy(&v, p, sizeof(v)); return v; }
+	inline uint32_t Read32(const uint8_t* p) { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+
+	inline uint64_t Round(uint64_t accumulator, uint64_t input)
+	{
+		accumulator += input * Prime2;
+		accumulator = RotateLeft(accumulator, 31);
+		return accumulator * Prime1;
+	}
+
+	inline uint64_t MergeRound(uint64_t hash, uint64_t accumulator)
+	{
+		hash ^= Round(0, accumulator);
+		return hash * Prime1 + Prime4;
+	}
+}
+
+//Start again with the given seed
+void CContentHash::Reset(uint64_t seed)
+{
+	m_Seed = seed;
+	m_Accumulators[0] = seed + Prime1 + Prime2;
+	m_Accumulators[1] = seed + Prime2;
+	m_Accumulators[2] = seed;
+	m_Accumulators[3] = seed - Prime1;
+	m_TotalLength = 0;
+	m_BufferSize = 0;
+}
+
+//Add more data to the hash
+void CContentHash::Update(const void* data, size_t size)
+{
+	const uint8_t* p = static_cast<const uint8_t*>(data);
+	const uint8_t* end = p + size;
+	m_TotalLength += size;
+
+	//Top up a partly filled stripe first
+	if (m_BufferSize > 0)
+	{
+		size_t fill = 32 - m_BufferSize;
+		if (size < fill)
+		{
+			memcpy(m_Buffer + m_BufferSize, p, size);
+			m_BufferSize += static_cast<uint32_t>(size);
+			return;
+		}
+		memcpy(m_Buffer + m_BufferSize, p, fill);
+		for (int i = 0; i < 4; ++i) m_Accumulators[i] = Round(m_Accumulators[i], Read64(m_Buffer + i * 8));
+		p += fill;
+		m_BufferSize = 0;
+	}
+
+	//Whole stripes straight from the input. Four independent accumulators keep the CPU's multipliers busy
+	uint64_t v0 = m_Accumulators[0], v1 = m_Accumulators[1], v2 = m_Accumulators[2], v3 = m_Accumulators[3];
+	while (end - p >= 32)
+	{
+		v0 = Round(v0, Read64(p));
+		v1 = Round(v1, Read64(p + 8));
+		v2 = Round(v2, Read64(p + 16));
+		v3 = Round(v3, Read64(p + 24));
+		p += 32;
+	}
+	m_Accumulators[0] = v0; m_Accumulators[1] = v1; m_Accumulators[2] = v2; m_Accumulators[3] = v3;
+
+	//Keep the remainder for next time
+	if (p < end)
+	{
+		m_BufferSize = static_cast<uint32_t>(end - p);
+		memcpy(m_Buffer, p, m_BufferSize);
+	}
+}
+
+//Return the hash of all data added so far
+uint64_t CContentHash::Final() const
+{
+	uint64_t hash;
+	if (m_TotalLength >= 32)
+	{
+		const uint64_t* v = m_Accumulators;
+		hash = RotateLeft(v[0], 1) + RotateLeft(v[1], 7) + RotateLeft(v[2], 12) + RotateLeft(v[3], 18);
+		for (int i = 0; i < 4; ++i) hash = MergeRound(hash, v[i]);
+	}
+	else
+	{
+		hash = m_Seed + Prime5;
+	}
+	hash += m_TotalLength;
+
+	//Mix in the bytes that did not fill a stripe
+	const uint8_t* p = m_Buffer;
+	const uint8_t* end = m_Buffer + m_BufferSize;
+	while (end - p >= 8)
+	{
+		hash ^= Round(0, Read64(p));
+		hash = RotateLeft(hash, 27) * Prime1 + Prime4;
+		p += 8;
+	}
+	if (end - p >= 4)
+	{
+		hash ^= static_cast<uint64_t>(Read32(p)) * Prime1;
+		hash = RotateLeft(hash, 23) * Prime2 + Prime3;
+		p += 4;
+	}
+	while (p < end)
+	{
+		hash ^= (*p) * Prime5;
+		hash = RotateLeft(hash, 11) * Prime1;
+		++p;
+	}
+
+	//Final avalanche so every input bit affects every output bit
+	hash ^= hash >> 33;
+	hash *= Prime2;
+	hash ^= hash >> 29;
+	hash *= Prime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+//Hash a single block of memory
+uint64_t CContentHash::Hash(const void* data, size_t size, uint64_t seed)
+{
+	CContentHash hash(seed);
+	hash.Update(data, size);
+	return hash.Final();
+}
+
+//Hash a file, reading it in chunks
+bool CContentHash::HashFile(const std::string& fileName, uint64_t& hash, uint64_t& size,
+                            std::vector<uint8_t>* contents, uint64_t seed)
+{
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	if (!file.good()) return false;
+
+	std::streamsize fileSize = file.tellg();
+	if (fileSize <= 0) return false;
+	file.seekg(0, std::ios::beg);
+	size = static_cast<uint64_t>(fileSize);
+
+	CContentHash contentHash(seed);
+	const size_t ChunkSize = 256 * 1024;
+
+	//Read straight into the caller's buffer when keeping the contents, otherwise reuse one chunk
+	std::vector<uint8_t> chunk;
+	if (contents) contents->resize(static_cast<size_t>(size));
+	else          chunk.resize(ChunkSize);
+
+	uint64_t offset = 0;
+	while (offset < size)
+	{
+		size_t readSize = static_cast<size_t>(std::min<uint64_t>(ChunkSize, size - offset));
+		uint8_t* destination = contents ? contents->data() + offset : chunk.data();
+		if (!file.read(reinterpret_cast<char*>(destination), readSize)) return false;
+
+		contentHash.Update(destination, readSize);
+		offset += readSize;
+	}
+
+	hash = contentHash.Final();
+	return true;
+}
+
+//Return a single spelling for a file path
+std::string CanonicalPath(const std::string& path)
+{
+	namespace fs = std::filesystem;
+
+	//weakly_canonical resolves links and "..", and works for files that do not exist
+	std::error_code error;
+	fs::path canonical = fs::weakly_canonical(fs::path(path), error);
+	if (error) canonical = fs::absolute(fs::path(path), error).lexically_normal();
+	canonical.make_preferred();
+
+	std::string result = canonical.string();
+#ifdef _WIN32
+	//Windows file names are not case sensitive
+	std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+#endif
+	return result;
+}
@@ -0,0 +1,52 @@
+//--------------------------------------------------------------------------------------
+// Fast 64-bit non-cryptographic hash of file contents
+//--------------------------------------------------------------------------------------
+// Implements the XXH64 algorithm so results match other xxHash64 implementations. Data can
+// be fed in pieces of any size as it is read, giving the same result as hashing it in one go.
+// Used to spot files with identical contents - not suitable where security matters.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CContentHash
+{
+//----------------------//
+// Construction / Usage	//
+//----------------------//
+public:
+	//Start a new hash with the given seed
+	explicit CContentHash(uint64_t seed = 0) { Reset(seed); }
+
+	//Start again with the given seed
+	void Reset(uint64_t seed = 0);
+
+	//Add more data to the hash
+	void Update(const void* data, size_t size);
+
+	//Return the hash of all data added so far. More data can still be added afterwards
+	uint64_t Final() const;
+
+	//Hash a single block of memory
+	static uint64_t Hash(const void* data, size_t size, uint64_t seed = 0);
+
+	//Hash a file, reading it in chunks so the whole file never needs to be in memory. If contents is given the
+	//file is also read into it. Returns false if the file cannot be read
+	static bool HashFile(const std::string& fileName, uint64_t& hash, uint64_t& size,
+	                     std::vector<uint8_t>* contents = nullptr, uint64_t seed = 0);
+
+//-------------//
+// Member data //
+//-------------//
+private:
+	uint64_t m_Accumulators[4];
+	uint64_t m_Seed;
+	uint64_t m_TotalLength;
+	uint8_t  m_Buffer[32];   // Data that has not yet filled a whole 32-byte stripe
+	uint32_t m_BufferSize;
+};
+
+//Return a single spelling for a file path, so that different paths to the same file compare equal
+//(e.g. "Data/CargoA.dds", "data\CargoA.dds" and "./Media/../Data/CargoA.dds"). Paths that do not exist are still normalised
+std::string CanonicalPath(const std::string& path);
@@ -0,0 +1,121 @@
+//--------------------------------------------------------------------------------------
+// Cache of whole files held in memory, shared by the resource manager and the mesh importer
+//--------------------------------------------------------------------------------------
+
+#include "CFileCache.h"
+#include "CContentHash.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+namespace
+{
+	//Key for the file table - pack names ignore case, so the cache does too
+	std::string CacheKey(const std::string& fileName)
+	{
+		std::string key = CAssetPack::NormaliseName(fileName);
+		std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return key;
+	}
+
+	//CMappedFile::Open opens, sizes and maps the file, then closes the handle (or the mapping does on Windows)
+	const uint64_t OsCallsPerMap = 4;
+}
+
+//Return the contents of a file
+std::shared_ptr<const CachedFile> CFileCache::Open(const std::string& fileName)
+{
+	++m_Opens;
+	std::string key = CacheKey(fileName);
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		auto cached = m_Files.find(key);
+		if (cached != m_Files.end())
+		{
+			++m_Hits;
+			return cached->second.file;
+		}
+	}
+
+	//Read without holding the lock so other files can be opened meanwhile
+	auto file = std::make_shared<CachedFile>();
+	const PackEntry* entry = m_Pack ? m_Pack->Find(fileName) : nullptr;
+	if (entry)
+	{
+		if (!m_Pack->Read(*entry, file->contents, file->storage)) return nullptr;
+		file->hash = entry->contentHash;
+		file->fromPack = true;
+		++m_PackFiles;
+	}
+	else
+	{
+		m_OsCalls += OsCallsPerMap;
+		if (!file->mapping.Open(fileName)) return nullptr;
+		file->contents.data = file->mapping.Data();
+		file->contents.size = static_cast<size_t>(file->mapping.Size());
+		file->hash = CContentHash::Hash(file->contents.data, file->contents.size);
+		++m_DiskFiles;
+	}
+
+	//Another thread may have opened the same file meanwhile, in which case use theirs
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	auto inserted = m_Files.emplace(key, Entry{ file, false });
+	if (inserted.second) m_Bytes += file->contents.size;
+	else                 ++m_Hits;
+	return inserted.first->second.file;
+}
+
+//Return true if Open would find the file
+bool CFileCache::Exists(const std::string& fileName)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_Files.count(CacheKey(fileName))) return true;
+	}
+	if (m_Pack && m_Pack->Find(fileName)) return true;
+
+	++m_OsCalls;
+	std::error_code error;
+	return std::filesystem::is_regular_file(fileName, error);
+}
+
+//Serve the given contents for a file name from now on
+void CFileCache::AddBlob(const std::string& fileName, std::vector<uint8_t> contents)
+{
+	auto file = std::make_shared<CachedFile>();
+	file->storage = std::move(contents);
+	file->contents.data = file->storage.data();
+	file->contents.size = file->storage.size();
+	file->hash = CContentHash::Hash(file->contents.data, file->contents.size);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Files[CacheKey(fileName)] = Entry{ file, true };
+	m_Bytes += file->contents.size;
+}
+
+//Drop files that nobody is using
+void CFileCache::Trim()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (auto file = m_Files.begin(); file != m_Files.end(); )
+	{
+		if (!file->second.blob && file->second.file.use_count() == 1) file = m_Files.erase(file);
+		else                                                           ++file;
+	}
+}
+
+//Return a snapshot of the counters
+FileCacheStats CFileCache::GetStats() const
+{
+	FileCacheStats stats;
+	stats.opens     = m_Opens;
+	stats.hits      = m_Hits;
+	stats.packFiles = m_PackFiles;
+	stats.diskFiles = m_DiskFiles;
+	stats.osCalls   = m_OsCalls;
+	stats.bytes     = m_Bytes;
+	stats.reads     = m_Reads;
+	stats.readBytes = m_ReadBytes;
+	return stats;
+}
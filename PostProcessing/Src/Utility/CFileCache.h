@@ -0,0 +1,90 @@
+//--------------------------------------------------------------------------------------
+// Cache of whole files held in memory, shared by the resource manager and the mesh importer
+//--------------------------------------------------------------------------------------
+// Files come from (in order) blobs added with AddBlob, the asset pack, or are memory-mapped
+// from disk. Each file is opened once however many times it is asked for while it stays cached:
+// assimp re-opening a file to check its header, a texture and mesh reading the same file, or a
+// reload after eviction all share one copy. Contents are hashed when first opened (the pack's
+// table already holds hashes) so that duplicate detection never reads a file again.
+// Counters record how much went to the operating system so the saving can be measured.
+// All functions are safe to call from any thread.
+#pragma once
+#include "CAssetPack.h"
+#include "CMappedFile.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//A file's contents as held by the cache. Keep the pointer for as long as the contents are used
+struct CachedFile
+{
+	AssetSpan contents;
+	uint64_t  hash = 0;          // CContentHash of the contents
+	bool      fromPack = false;
+
+	std::vector<uint8_t> storage; // Owns the contents of blobs and compressed pack entries
+	CMappedFile          mapping; // Owns the contents of loose files
+};
+
+//Counters describing the work done by the cache
+struct FileCacheStats
+{
+	uint64_t opens     = 0; // Requests for a file's contents
+	uint64_t hits      = 0; // Requests served by a file already in the cache
+	uint64_t packFiles = 0; // Files served from the asset pack
+	uint64_t diskFiles = 0; // Loose files mapped from disk
+	uint64_t osCalls   = 0; // Calls into the operating system to find, open and map loose files
+	uint64_t bytes     = 0; // Bytes of file contents brought into the cache
+	uint64_t reads     = 0; // Read calls made on the contents through streams (see CAssimpIOSystem), none reach the OS
+	uint64_t readBytes = 0; // Bytes returned by those reads
+};
+
+class CFileCache
+{
+//----------------------//
+// Construction / Usage	//
+//----------------------//
+public:
+	//Create a cache, serving files from the given pack when it has them. The pack must outlive the cache
+	explicit CFileCache(const CAssetPack* pack = nullptr) : m_Pack(pack) {}
+
+	//Return the contents of a file, or nullptr if it cannot be read
+	std::shared_ptr<const CachedFile> Open(const std::string& fileName);
+
+	//Return true if Open would find the file, without reading it
+	bool Exists(const std::string& fileName);
+
+	//Serve the given contents for a file name from now on, in place of the pack or disk
+	void AddBlob(const std::string& fileName, std::vector<uint8_t> contents);
+
+	//Drop files that nobody is using, unmapping them. Blobs are kept
+	void Trim();
+
+	//Record reads made on cached contents, for the stats
+	void CountRead(uint64_t bytes) { ++m_Reads; m_ReadBytes += bytes; }
+
+	//Return a snapshot of the counters
+	FileCacheStats GetStats() const;
+
+//-------------//
+// Member data //
+//-------------//
+private:
+	//Files are keyed by their name as the pack stores it, so different spellings of a path share an entry
+	struct Entry
+	{
+		std::shared_ptr<const CachedFile> file;
+		bool blob = false;
+	};
+
+	const CAssetPack* m_Pack;
+
+	std::mutex                             m_Mutex;
+	std::unordered_map<std::string, Entry> m_Files;
+
+	std::atomic<uint64_t> m_Opens{ 0 }, m_Hits{ 0 }, m_PackFiles{ 0 }, m_DiskFiles{ 0 }, m_OsCalls{ 0 }, m_Bytes{ 0 };
+	std::atomic<uint64_t> m_Reads{ 0 }, m_ReadBytes{ 0 };
+};
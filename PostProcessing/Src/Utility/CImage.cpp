@@ -0,0 +1,103 @@
+//--------------------------------------------------------------------------------------
+// Image held in CPU memory, with its mip chain
+//--------------------------------------------------------------------------------------
+
+#include "CImage.h"
+
+#include <algorithm>
+
+//Return true for the formats stored as 4x4 blocks
+bool IsBlockCompressed(ImageFormat format)
+{
+	return format == ImageFormat::BC1 || format == ImageFormat::BC3 || format == ImageFormat::BC4 ||
+	       format == ImageFormat::BC5 || format == ImageFormat::BC7;
+}
+
+//Return the bytes in a pixel, or in a 4x4 block for the block compressed formats
+uint32_t GetFormatBytes(ImageFormat format)
+{
+	switch (format)
+	{
+	case ImageFormat::R8:    return 1;
+	case ImageFormat::RG8:   return 2;
+	case ImageFormat::RGBA8: return 4;
+	case ImageFormat::BGRA8: return 4;
+	case ImageFormat::BC1:   return 8;
+	case ImageFormat::BC3:   return 16;
+	case ImageFormat::BC4:   return 8;
+	case ImageFormat::BC5:   return 16;
+	case ImageFormat::BC7:   return 16;
+	case ImageFormat::RGBA32F: return 16;
+	case ImageFormat::RG32F:   return 8;
+	default:                 return 0;
+	}
+}
+
+//Return a short name for the format
+const char* GetFormatName(ImageFormat format)
+{
+	switch (format)
+	{
+	case ImageFormat::R8:    return "R8";
+	case ImageFormat::RG8:   return "RG8";
+	case ImageFormat::RGBA8: return "RGBA8";
+	case ImageFormat::BGRA8: return "BGRA8";
+	case ImageFormat::BC1:   return "BC1";
+	case ImageFormat::BC3:   return "BC3";
+	case ImageFormat::BC4:   return "BC4";
+	case ImageFormat::BC5:   return "BC5";
+	case ImageFormat::BC7:   return "BC7";
+	case ImageFormat::RGBA32F: return "RGBA32F";
+	case ImageFormat::RG32F:   return "RG32F";
+	default:                 return "Unknown";
+	}
+}
+
+//Allocate an image with the given format, size and number of mips
+bool CImage::Create(ImageFormat format, uint32_t width, uint32_t height, uint32_t mipCount)
+{
+	Clear();
+	uint32_t formatBytes = GetFormatBytes(format);
+	if (formatBytes == 0 || width == 0 || height == 0) return false;
+
+	uint32_t fullChain = CountMips(width, height);
+	if (mipCount == 0 || mipCount > fullChain) mipCount = fullChain;
+
+	bool blocks = IsBlockCompressed(format);
+	size_t offset = 0;
+	m_Mips.resize(mipCount);
+	for (uint32_t i = 0; i < mipCount; ++i)
+	{
+		ImageMip& mip = m_Mips[i];
+		mip.width  = std::max(width >> i, 1u);
+		mip.height = std::max(height >> i, 1u);
+
+		uint32_t columns = blocks ? (mip.width + 3) / 4 : mip.width;
+		mip.rows     = blocks ? (mip.height + 3) / 4 : mip.height;
+		mip.rowPitch = columns * formatBytes;
+		mip.offset   = offset;
+		mip.size     = static_cast<size_t>(mip.rowPitch) * mip.rows;
+		offset += mip.size;
+	}
+
+	m_Format = format;
+	m_Pixels.assign(offset, 0);
+	return true;
+}
+
+//Free the pixels, leaving an empty image
+void CImage::Clear()
+{
+	m_Format = ImageFormat::Unknown;
+	m_Mips.clear();
+	m_Pixels.clear();
+	m_Pixels.shrink_to_fit();
+}
+
+//Return the number of mips in a full chain down to 1x1
+uint32_t CImage::CountMips(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size >>= 1) ++count;
+	return count;
+}
@@ -0,0 +1,99 @@
+//--------------------------------------------------------------------------------------
+// Image held in CPU memory, with its mip chain
+//--------------------------------------------------------------------------------------
+// The format matches a DXGI texture format so an image can be uploaded as-is. Uncompressed
+// formats are stored as rows of pixels, block compressed formats as rows of 4x4 blocks; every
+// mip is tightly packed one after the other in a single allocation. This is the common type
+// passed between the CPU decoders (see ImageDecoders.h) and the rest of the texture tools, so
+// nothing here depends on the device and it builds on any platform.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Formats an image can be held in
+enum class ImageFormat
+{
+	Unknown,
+	R8,    // One byte per pixel
+	RG8,   // Two bytes per pixel, red then green
+	RGBA8, // Four bytes per pixel, red, green, blue, alpha
+	BGRA8, // Four bytes per pixel, blue, green, red, alpha
+	BC1,   // 8 byte blocks of 4x4 pixels, RGB with 1-bit alpha
+	BC3,   // 16 byte blocks, BC1 colour plus interpolated alpha
+	BC4,   // 8 byte blocks, one interpolated channel (red), e.g. masks
+	BC5,   // 16 byte blocks, two interpolated channels (red and green), typically normal maps
+	BC7,   // 16 byte blocks, high quality RGBA
+	RGBA32F, // 16 bytes per pixel, a float each for red, green, blue, alpha - e.g. frames for the CPU post-processor
+	RG32F,   // 8 bytes per pixel, a float each for red and green - e.g. uv offset maps
+};
+
+//Return true for the formats stored as 4x4 blocks
+bool IsBlockCompressed(ImageFormat format);
+
+//Return the bytes in a pixel, or in a 4x4 block for the block compressed formats
+uint32_t GetFormatBytes(ImageFormat format);
+
+//Return a short name for the format, e.g. "BC7"
+const char* GetFormatName(ImageFormat format);
+
+//Layout of one mip level within the image's pixels
+struct ImageMip
+{
+	uint32_t width    = 0;
+	uint32_t height   = 0;
+	uint32_t rowPitch = 0; // Bytes from one row of pixels (or of blocks) to the next
+	uint32_t rows     = 0; // Rows of pixels, or of blocks
+	size_t   offset   = 0; // Start of the mip in the image's pixels
+	size_t   size     = 0; // Bytes in the mip
+};
+
+class CImage
+{
+//----------------------//
+// Construction / Usage	//
+//----------------------//
+public:
+	CImage() = default;
+
+	//Allocate an image with the given format, size and number of mips (0 for a full chain). The pixels are zeroed.
+	//Returns false if the format is unknown or the size is zero
+	bool Create(ImageFormat format, uint32_t width, uint32_t height, uint32_t mipCount = 1);
+
+	//Free the pixels, leaving an empty image
+	void Clear();
+
+	//Return the number of mips in a full chain down to 1x1 for the given size
+	static uint32_t CountMips(uint32_t width, uint32_t height);
+
+	//-------------------------------------
+	// Data access
+	//-------------------------------------
+
+	bool        IsEmpty()     const { return m_Mips.empty(); }
+	ImageFormat GetFormat()   const { return m_Format; }
+	uint32_t    GetWidth()    const { return m_Mips.empty() ? 0 : m_Mips[0].width; }
+	uint32_t    GetHeight()   const { return m_Mips.empty() ? 0 : m_Mips[0].height; }
+	uint32_t    GetMipCount() const { return static_cast<uint32_t>(m_Mips.size()); }
+
+	const ImageMip& GetMip(uint32_t mip) const { return m_Mips[mip]; }
+
+	//Return the first byte of a mip
+	uint8_t*       GetData(uint32_t mip = 0)       { return m_Pixels.data() + m_Mips[mip].offset; }
+	const uint8_t* GetData(uint32_t mip = 0) const { return m_Pixels.data() + m_Mips[mip].offset; }
+
+	//Return the first byte of a row of pixels (or of blocks) in a mip
+	uint8_t*       GetRow(uint32_t mip, uint32_t row)       { return GetData(mip) + static_cast<size_t>(row) * m_Mips[mip].rowPitch; }
+	const uint8_t* GetRow(uint32_t mip, uint32_t row) const { return GetData(mip) + static_cast<size_t>(row) * m_Mips[mip].rowPitch; }
+
+	//Return the bytes used by every mip
+	size_t GetSize() const { return m_Pixels.size(); }
+
+//-------------//
+// Member data //
+//-------------//
+private:
+	ImageFormat           m_Format = ImageFormat::Unknown;
+	std::vector<ImageMip> m_Mips;
+	std::vector<uint8_t>  m_Pixels;
+};
@@ -0,0 +1,143 @@
+//--------------------------------------------------------------------------------------
+// Resources created the first time something needs them and freed again when left idle
+//--------------------------------------------------------------------------------------
+
+#include "CLazyResourceSet.h"
+
+#include <chrono>
+
+//Add a resource used by anything with one of the given tags
+CLazyResourceSet::ResourceId CLazyResourceSet::Add(const std::string& name, uint32_t tags, LazyResourceCallbacks callbacks)
+{
+	Resource resource;
+	resource.name = name;
+	resource.tags = tags;
+	resource.callbacks = std::move(callbacks);
+	m_Resources.push_back(std::move(resource));
+	return static_cast<ResourceId>(m_Resources.size() - 1);
+}
+
+//Create any missing resources with one of the given tags and mark them as used
+bool CLazyResourceSet::Require(uint32_t tags, float now)
+{
+	m_Now = now;
+	bool result = true;
+	for (Resource& resource : m_Resources)
+	{
+		if ((resource.tags & tags) == 0) continue;
+
+		if (!Create(resource)) result = false;
+		resource.lastUsed = now;
+	}
+	return result;
+}
+
+//Queue the resources with one of the given tags to be created by Update
+void CLazyResourceSet::Prewarm(uint32_t tags)
+{
+	for (ResourceId id = 0; id < m_Resources.size(); ++id)
+	{
+		if (m_Resources[id].tags & tags) m_PrewarmQueue.push_back(id);
+	}
+}
+
+//Create the next queued resource and release resources left idle for too long
+void CLazyResourceSet::Update(float now)
+{
+	m_Now = now;
+
+	//Skip anything already created since it was queued, so each call does at most one creation
+	while (!m_PrewarmQueue.empty())
+	{
+		Resource& resource = m_Resources[m_PrewarmQueue.front()];
+		m_PrewarmQueue.pop_front();
+		if (resource.resident || resource.failed) continue;
+
+		Create(resource);
+		break;
+	}
+
+	if (m_IdleSeconds <= 0.0f) return;
+
+	for (ResourceId id = 0; id < m_Resources.size(); ++id)
+	{
+		Resource& resource = m_Resources[id];
+		if (!resource.resident || now - resource.lastUsed < m_IdleSeconds) continue;
+
+		//Keep resources that are waiting in the prewarm queue, they were asked for after they were last used
+		bool queued = false;
+		for (ResourceId queuedId : m_PrewarmQueue) queued |= (queuedId == id);
+		if (queued) continue;
+
+		resource.callbacks.release();
+		resource.resident = false;
+		++resource.releases;
+	}
+}
+
+//Release every resource that exists
+void CLazyResourceSet::ReleaseAll()
+{
+	m_PrewarmQueue.clear();
+	for (Resource& resource : m_Resources)
+	{
+		if (!resource.resident) continue;
+		resource.callbacks.release();
+		resource.resident = false;
+	}
+}
+
+//Return true if every resource with one of the given tags exists
+bool CLazyResourceSet::IsResident(uint32_t tags) const
+{
+	for (const Resource& resource : m_Resources)
+	{
+		if ((resource.tags & tags) && !resource.resident) return false;
+	}
+	return true;
+}
+
+//Return the counters for the resources with one of the given tags
+LazyResourceStats CLazyResourceSet::GetStats(uint32_t tags) const
+{
+	LazyResourceStats stats;
+	for (const Resource& resource : m_Resources)
+	{
+		if ((resource.tags & tags) == 0) continue;
+
+		++stats.resources;
+		if (resource.resident)
+		{
+			++stats.resident;
+			stats.residentBytes += resource.callbacks.bytes ? resource.callbacks.bytes() : 0;
+		}
+		stats.creations += resource.creations;
+		stats.releases += resource.releases;
+		stats.createTime += resource.createTime;
+	}
+	return stats;
+}
+
+//Create a resource if it does not exist
+bool CLazyResourceSet::Create(Resource& resource)
+{
+	if (resource.resident) return true;
+	if (resource.failed) return false;
+
+	std::string error;
+	auto start = std::chrono::steady_clock::now();
+	bool created = resource.callbacks.create(error);
+	resource.createTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+	if (!created)
+	{
+		resource.failed = true;
+		m_LastError = "Error creating " + resource.name + (error.empty() ? "" : ": " + error);
+		return false;
+	}
+
+	resource.resident = true;
+	resource.lastUsed = m_Now;
+	++resource.creations;
+	return true;
+}
@@ -0,0 +1,116 @@
+//--------------------------------------------------------------------------------------
+// Resources created the first time something needs them and freed again when left idle
+//--------------------------------------------------------------------------------------
+// Each resource is tagged with a bit mask saying which modes or effects use it. Rendering code
+// calls Require with the tags it is about to use, which creates any missing resources with those
+// tags and marks them as used. Resources not required for longer than the idle timeout are
+// released by Update, to be created again on their next use. Prewarm queues the resources with
+// some tags to be created ahead of time, one per Update, so the cost is spread over several
+// frames rather than landing on the frame that first uses them.
+// The set never touches the device itself - creating, releasing and sizing the resources is
+// done through the callbacks it is given - so the policy can be driven on the CPU.
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+//Functions that manage one lazily created resource
+struct LazyResourceCallbacks
+{
+	std::function<bool(std::string& error)> create;  // Create the resource, return false and set the error if it fails
+	std::function<void()>                   release; // Free the resource
+	std::function<uint64_t()>               bytes;   // Memory used by the resource while it exists
+};
+
+//Counters describing the resources with a tag
+struct LazyResourceStats
+{
+	uint32_t resources     = 0; // Resources with the tag
+	uint32_t resident      = 0; // Resources with the tag that currently exist
+	uint64_t residentBytes = 0; // Memory used by the resources that exist
+	uint32_t creations     = 0; // Times a resource with the tag has been created, including after idle releases
+	uint32_t releases      = 0; // Times a resource with the tag has been released for being idle
+	float    createTime    = 0; // Seconds taken by the most recent creation of each resource, i.e. the cost of first use
+};
+
+class CLazyResourceSet
+{
+//----------------------//
+// Construction / Usage	//
+//----------------------//
+public:
+	using ResourceId = uint32_t;
+
+	//Create an empty set. Resources idle for longer than idleSeconds are released, 0 to never release them
+	explicit CLazyResourceSet(float idleSeconds = 0.0f) : m_IdleSeconds(idleSeconds) {}
+
+	//Release any resources that still exist
+	~CLazyResourceSet() { ReleaseAll(); }
+
+	//Add a resource used by anything with one of the given tags. It is not created until required
+	ResourceId Add(const std::string& name, uint32_t tags, LazyResourceCallbacks callbacks);
+
+	//Create any missing resources with one of the given tags and mark them as used at time now (in seconds).
+	//Returns false if any could not be created, see GetLastError. A resource that fails is not tried again
+	bool Require(uint32_t tags, float now);
+
+	//Queue the resources with one of the given tags to be created by Update before they are required
+	void Prewarm(uint32_t tags);
+
+	//Create the next queued resource and release resources left idle for too long. Call once per frame
+	void Update(float now);
+
+	//Release every resource that exists, e.g. before the device is destroyed
+	void ReleaseAll();
+
+	//Change how long resources may sit unused before being released, 0 to never release them
+	void SetIdleTimeout(float seconds) { m_IdleSeconds = seconds; }
+
+	//-------------------------------------
+	// Data access
+	//-------------------------------------
+
+	float GetIdleTimeout() const { return m_IdleSeconds; }
+
+	//Return true if every resource with one of the given tags exists
+	bool IsResident(uint32_t tags) const;
+
+	//Return the counters for the resources with one of the given tags
+	LazyResourceStats GetStats(uint32_t tags) const;
+
+	//Return the error from the most recent resource that failed to be created
+	const std::string& GetLastError() const { return m_LastError; }
+
+//--------------------------//
+// Private helper functions	//
+//--------------------------//
+private:
+	struct Resource
+	{
+		std::string name;
+		uint32_t tags = 0;
+		LazyResourceCallbacks callbacks;
+
+		bool     resident = false;
+		bool     failed = false;      // Creation failed, it is not tried again
+		float    lastUsed = 0;
+		float    createTime = 0;
+		uint32_t creations = 0;
+		uint32_t releases = 0;
+	};
+
+	//Create a resource if it does not exist. Returns false if it could not be created
+	bool Create(Resource& resource);
+
+//-------------//
+// Member data //
+//-------------//
+private:
+	std::vector<Resource> m_Resources;
+	std::deque<ResourceId> m_PrewarmQueue;
+	float m_IdleSeconds;
+	float m_Now = 0;
+	std::string m_LastError;
+};
@@ -0,0 +1,122 @@
+//--------------------------------------------------------------------------------------
+// Bounded lock-free queue for passing work between threads
+//--------------------------------------------------------------------------------------
+// Multi-producer / multi-consumer ring buffer. Each cell carries a sequence number that tells
+// producers and consumers whether it is free to write or ready to read, so a push or pop is a
+// single compare-and-swap on the shared position plus a store to the cell - no locks are taken.
+// The capacity is rounded up to a power of two. Push returns false when the queue is full.
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+template<typename T>
+class CLockFreeQueue
+{
+//----------------------//
+// Construction / Usage	//
+//----------------------//
+public:
+	explicit CLockFreeQueue(size_t capacity = 1024)
+	{
+		size_t size = 2;
+		while (size < capacity) size *= 2;
+
+		m_Mask = size - 1;
+		m_Cells.reset(new Cell[size]);
+		for (size_t i = 0; i < size; ++i) m_Cells[i].sequence.store(i, std::memory_order_relaxed);
+
+		m_EnqueuePos.store(0, std::memory_order_relaxed);
+		m_DequeuePos.store(0, std::memory_order_relaxed);
+	}
+
+	CLockFreeQueue(const CLockFreeQueue&) = delete;
+	CLockFreeQueue& operator=(const CLockFreeQueue&) = delete;
+
+	//Add an item to the back of the queue. Returns false if the queue is full, leaving the item untouched so the push can be retried
+	bool Push(T&& item)
+	{
+		Cell* cell;
+		size_t pos = m_EnqueuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			cell = &m_Cells[pos & m_Mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+			//The cell is free for this position, try to claim it
+			if (difference == 0)
+			{
+				if (m_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+			}
+			//The cell still holds an item from the previous lap, so the queue is full
+			else if (difference < 0)
+			{
+				return false;
+			}
+			//Another producer claimed this position first
+			else
+			{
+				pos = m_EnqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->data = std::move(item);
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	//Remove the item at the front of the queue. Returns false if the queue is empty
+	bool Pop(T& item)
+	{
+		Cell* cell;
+		size_t pos = m_DequeuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			cell = &m_Cells[pos & m_Mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+
+			//The cell has been written for this position, try to claim it
+			if (difference == 0)
+			{
+				if (m_DequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+			}
+			//Nothing has been written here yet, so the queue is empty
+			else if (difference < 0)
+			{
+				return false;
+			}
+			//Another consumer claimed this position first
+			else
+			{
+				pos = m_DequeuePos.load(std::memory_order_relaxed);
+			}
+		}
+
+		item = std::move(cell->data);
+		cell->sequence.store(pos + m_Mask + 1, std::memory_order_release);
+		return true;
+	}
+
+	//Maximum number of items the queue can hold
+	size_t Capacity() const { return m_Mask + 1; }
+
+//-------------//
+// Member data //
+//-------------//
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T data;
+	};
+
+	//The positions are written by different threads so keep them on separate cache lines
+	std::unique_ptr<Cell[]>          m_Cells;
+	size_t                           m_Mask;
+	alignas(64) std::atomic<size_t> m_EnqueuePos;
+	alignas(64) std::atomic<size_t> m_DequeuePos;
+};
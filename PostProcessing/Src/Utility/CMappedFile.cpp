@@ -0,0 +1,107 @@
+//--------------------------------------------------------------------------------------
+// Read-only memory mapping of a whole file
+//--------------------------------------------------------------------------------------
+
+#include "CMappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+//Map the given file
+bool CMappedFile::Open(const std::string& fileName)
+{
+	Close();
+
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+	                          FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_File = file;
+	m_Mapping = mapping;
+	m_Data = static_cast<const uint8_t*>(view);
+	m_Size = static_cast<uint64_t>(size.QuadPart);
+	return true;
+}
+
+//Unmap the file
+void CMappedFile::Close()
+{
+	if (m_Data)    UnmapViewOfFile(m_Data);
+	if (m_Mapping) CloseHandle(m_Mapping);
+	if (m_File)    CloseHandle(m_File);
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_Mapping = nullptr;
+	m_File = nullptr;
+}
+
+#else
+
+//Map the given file
+bool CMappedFile::Open(const std::string& fileName)
+{
+	Close();
+
+	int file = open(fileName.c_str(), O_RDONLY);
+	if (file < 0) return false;
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		close(file);
+		return false;
+	}
+
+	//The mapping keeps the file open, so the descriptor is not needed afterwards
+	void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (view == MAP_FAILED) return false;
+
+	m_Data = static_cast<const uint8_t*>(view);
+	m_Size = static_cast<uint64_t>(info.st_size);
+	return true;
+}
+
+//Unmap the file
+void CMappedFile::Close()
+{
+	if (m_Data) munmap(const_cast<uint8_t*>(m_Data), static_cast<size_t>(m_Size));
+
+	m_Data = nullptr;
+	m_Size = 0;
+}
+
+#endif
@@ -0,0 +1,47 @@
+//--------------------------------------------------------------------------------------
+// Read-only memory mapping of a whole file
+//--------------------------------------------------------------------------------------
+// The operating system pages the file in as it is touched, so opening a large file is cheap
+// and data can be handed out as pointers into the mapping without copying it.
+#pragma once
+#include <cstdint>
+#include <string>
+
+class CMappedFile
+{
+//----------------------//
+// Construction / Usage	//
+//----------------------//
+public:
+	CMappedFile() = default;
+	~CMappedFile() { Close(); }
+
+	CMappedFile(const CMappedFile&) = delete;
+	CMappedFile& operator=(const CMappedFile&) = delete;
+
+	//Map the given file, closing any file already open. Returns false if it cannot be opened or is empty
+	bool Open(const std::string& fileName);
+
+	//Unmap the file. Pointers into it must no longer be used
+	void Close();
+
+	//-------------------------------------
+	// Data access
+	//-------------------------------------
+
+	bool           IsOpen() const { return m_Data != nullptr; }
+	const uint8_t* Data()   const { return m_Data; }
+	uint64_t       Size()   const { return m_Size; }
+
+//-------------//
+// Member data //
+//-------------//
+private:
+	const uint8_t* m_Data = nullptr;
+	uint64_t       m_Size = 0;
+
+#ifdef _WIN32
+	void* m_File = nullptr;    // Windows file and mapping handles
+	void* m_Mapping = nullptr;
+#endif
+};
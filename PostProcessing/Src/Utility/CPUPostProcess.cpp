@@ -0,0 +1,1489 @@
+//--------------------------------------------------------------------------------------
+// Running the post-processes on the CPU
+//--------------------------------------------------------------------------------------
+
+#include "CPUPostProcess.h"
+#include "BCDecompression.h"
+#include "CThreadPool.h"
+#include "Float4.h"
+#include "Math/MathHelpers.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+namespace
+{
+	const uint32_t TileSize = 64;
+
+	//Run a function over ranges of [0, count) on the pool's workers, or all at once on this thread without a pool
+	void ParallelFor(CThreadPool* threads, uint32_t count, const std::function<void(uint32_t, uint32_t)>& function)
+	{
+		if (!threads || threads->GetThreadCount() == 0 || count < 2)
+		{
+			function(0, count);
+			return;
+		}
+		uint32_t step = std::max(count / (threads->GetThreadCount() * 4), 1u);
+		for (uint32_t first = 0; first < count; first += step)
+		{
+			uint32_t end = std::min(first + step, count);
+			threads->Submit([&function, first, end]() { function(first, end); });
+		}
+		threads->Wait();
+	}
+
+
+	//-------------------------------------
+	// Maths
+	//-------------------------------------
+	// As the shaders' intrinsics
+
+	float Lerp(float x, float y, float t)
+	{
+		return x + (y - x) * t;
+	}
+
+	//Dot product of the red, green and blue with a vector of weights
+	template<typename Float4>
+	float Dot3(Float4 colour, const CVector3& weights)
+	{
+		Float4 products = colour * Float4::Set(weights.x, weights.y, weights.z, 0.0f);
+		return products.Red() + products.Green() + products.Blue();
+	}
+
+	float Frac(float value)
+	{
+		return value - std::floor(value);
+	}
+
+	float Saturate(float value)
+	{
+		return value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f;
+	}
+
+
+	//-------------------------------------
+	// Samplers
+	//-------------------------------------
+
+	const float* GetPixel(const CImage& image, uint32_t mip, uint32_t x, uint32_t y)
+	{
+		return reinterpret_cast<const float*>(image.GetRow(mip, y)) + x * 4;
+	}
+
+	//Part of the top mip of an image in memory - all of it, or the window around a tile a chain holds in scratch. Pixels are
+	//addressed by their position in the whole image
+	template<typename Float>
+	struct ImageWindow
+	{
+		Float*   pixels;        // Pixel (left, top)
+		size_t   pitch;         // Floats from one row to the next
+		uint32_t left, top;     // Position of the window in the image
+		uint32_t width, height; // Size of the whole image
+
+		Float* At(uint32_t x, uint32_t y) const { return pixels + (y - top) * pitch + (x - left) * 4; }
+	};
+	using SceneWindow  = ImageWindow<const float>;
+	using TargetWindow = ImageWindow<float>;
+
+	template<typename Float, typename Image>
+	ImageWindow<Float> WholeImage(Image& image)
+	{
+		const ImageMip& layout = image.GetMip(0);
+		return { reinterpret_cast<Float*>(image.GetData()), layout.rowPitch / sizeof(float), 0, 0, layout.width, layout.height };
+	}
+
+	//Texel index, clamped to the texture's edges
+	uint32_t ClampTexelIndex(float texel, uint32_t size)
+	{
+		if (!(texel > 0.0f)) return 0; // Also NaN
+		return texel < size ? static_cast<uint32_t>(texel) : size - 1;
+	}
+
+	//Texel holding a coordinate, 0->1 across the texture, clamped to its edges
+	uint32_t ClampTexel(float coordinate, uint32_t size)
+	{
+		return ClampTexelIndex(std::floor(coordinate * size), size);
+	}
+
+	//Texel index, wrapped across the texture
+	uint32_t WrapTexel(float texel, uint32_t size)
+	{
+		if (!(std::abs(texel) < 1e9f)) return 0; // Also NaN
+		long long index = static_cast<long long>(texel) % static_cast<long long>(size);
+		return static_cast<uint32_t>(index < 0 ? index + size : index);
+	}
+
+	//Point sampling of the scene with clamping, the post-process shaders' PointSample
+	template<typename Float4>
+	Float4 SamplePoint(const SceneWindow& scene, float u, float v)
+	{
+		return Float4::Load(scene.At(ClampTexel(u, scene.width), ClampTexel(v, scene.height)));
+	}
+
+	template<typename Float4>
+	Float4 SampleBilinearWrap(const CImage& image, uint32_t mip, float u, float v)
+	{
+		const ImageMip& layout = image.GetMip(mip);
+		float x = u * layout.width - 0.5f, y = v * layout.height - 0.5f;
+		float left = std::floor(x), top = std::floor(y);
+		float fx = x - left, fy = y - top;
+		uint32_t x0 = WrapTexel(left, layout.width), y0 = WrapTexel(top, layout.height);
+		uint32_t x1 = x0 + 1 == layout.width ? 0 : x0 + 1, y1 = y0 + 1 == layout.height ? 0 : y0 + 1;
+
+		Float4 upper = Lerp(Float4::Load(GetPixel(image, mip, x0, y0)), Float4::Load(GetPixel(image, mip, x1, y0)), fx);
+		Float4 lower = Lerp(Float4::Load(GetPixel(image, mip, x0, y1)), Float4::Load(GetPixel(image, mip, x1, y1)), fx);
+		return Lerp(upper, lower, fy);
+	}
+
+	//Bilinear sampling of the scene with clamping, the Bilinear sampler. Each of the four texels is clamped to the edges
+	template<typename Float4>
+	Float4 SampleBilinearClamp(const SceneWindow& scene, float u, float v)
+	{
+		float x = u * scene.width - 0.5f, y = v * scene.height - 0.5f;
+		float left = std::floor(x), top = std::floor(y);
+		float fx = x - left, fy = y - top;
+		uint32_t x0 = ClampTexelIndex(left, scene.width), x1 = ClampTexelIndex(left + 1.0f, scene.width);
+		uint32_t y0 = ClampTexelIndex(top, scene.height), y1 = ClampTexelIndex(top + 1.0f, scene.height);
+
+		Float4 upper = Lerp(Float4::Load(scene.At(x0, y0)), Float4::Load(scene.At(x1, y0)), fx);
+		Float4 lower = Lerp(Float4::Load(scene.At(x0, y1)), Float4::Load(scene.At(x1, y1)), fx);
+		return Lerp(upper, lower, fy);
+	}
+
+	//Bilinear sampling of an RG32F uv offset map with clamping, as the Bilinear sampler. The four texels around the uv are read
+	//together, as a gather reads them, then blended
+	void SampleRemap(const CImage& map, float u, float v, float& du, float& dv)
+	{
+		const uint32_t width = map.GetWidth(), height = map.GetHeight();
+		float x = u * width - 0.5f;
+		float left = std::floor(x);
+		float fx = x - left;
+		uint32_t x0 = ClampTexelIndex(left, width) * 2, x1 = ClampTexelIndex(left + 1.0f, width) * 2;
+		if (height == 1) // A single row, as the haze's, blends across only
+		{
+			const float* row = reinterpret_cast<const float*>(map.GetData());
+			du = Lerp(row[x0], row[x1], fx);
+			dv = Lerp(row[x0 + 1], row[x1 + 1], fx);
+			return;
+		}
+
+		float y = v * height - 0.5f;
+		float top = std::floor(y);
+		float fy = y - top;
+		const float* upper = reinterpret_cast<const float*>(map.GetRow(0, ClampTexelIndex(top, height)));
+		const float* lower = reinterpret_cast<const float*>(map.GetRow(0, ClampTexelIndex(top + 1.0f, height)));
+		const float texels[8] = { upper[x0], upper[x0 + 1], upper[x1], upper[x1 + 1], lower[x0], lower[x0 + 1], lower[x1], lower[x1 + 1] };
+		du = Lerp(Lerp(texels[0], texels[2], fx), Lerp(texels[4], texels[6], fx), fy);
+		dv = Lerp(Lerp(texels[1], texels[3], fx), Lerp(texels[5], texels[7], fx), fy);
+	}
+
+	//Trilinear sampling with wrapping, the TrilinearWrap sampler, at a level of detail found by ComputeLOD
+	template<typename Float4>
+	Float4 SampleTrilinearWrap(const CImage& image, float u, float v, float lod)
+	{
+		uint32_t mip = static_cast<uint32_t>(lod);
+		float blend = lod - mip;
+		Float4 colour = SampleBilinearWrap<Float4>(image, mip, u, v);
+		if (blend > 0.0f && mip + 1 < image.GetMipCount()) colour = Lerp(colour, SampleBilinearWrap<Float4>(image, mip + 1, u, v), blend);
+		return colour;
+	}
+
+	//SampleAtlas in Common.hlsli - the uv repeats across the given rect of the texture
+	template<typename Float4>
+	Float4 SampleAtlas(const CImage& image, float u, float v, const CVector4& rect, float lod)
+	{
+		return SampleTrilinearWrap<Float4>(image, rect.x + Frac(u) * rect.z, rect.y + Frac(v) * rect.w, lod);
+	}
+
+	//Mip level the GPU samples, from the change in uv to the next pixel across (dx) and down (dy). The level is clamped to the
+	//image's mips, as the samplers allow every mip
+	float ComputeLOD(const CImage* image, float dudx, float dvdx, float dudy, float dvdy)
+	{
+		if (!image) return 0.0f;
+		const float width = static_cast<float>(image->GetWidth()), height = static_cast<float>(image->GetHeight());
+		float across = std::sqrt(dudx * width * dudx * width + dvdx * height * dvdx * height);
+		float down = std::sqrt(dudy * width * dudy * width + dvdy * height * dvdy * height);
+		float lod = std::log2(std::max(across, down));
+		if (!(lod > 0.0f)) return 0.0f; // Also -inf for no change and NaN
+		return std::min(lod, static_cast<float>(image->GetMipCount() - 1));
+	}
+
+
+	//-------------------------------------
+	// Shaders
+	//-------------------------------------
+	// Each returns false where the shader discards the pixel
+
+	//Everything a draw's shaders read besides the pixel's own position
+	struct Draw
+	{
+		const PostProcessingConstants* constants;
+		const CPUPostProcessTextures*  textures;
+		SceneWindow                    scene; // t0, in place of textures->scene
+
+		//Levels of detail of the trilinearly sampled textures. The uv of every pixel of the quad changes at the same rate, so
+		//these are the same for the whole draw
+		float noiseLOD;
+		float maskLOD;
+		float distortLOD;
+	};
+
+	//The interpolated values the 2D quad vertex shader passes on
+	struct PixelInput
+	{
+		float sceneU, sceneV; // 0->1 across the target
+		float areaU, areaV;   // 0->1 across the area being processed
+	};
+
+	template<typename Float4>
+	bool ShadeCopy(const Draw& draw, const PixelInput& input, Float4& output)
+	{
+		output = SamplePoint<Float4>(draw.scene, input.sceneU, input.sceneV).WithAlpha(draw.constants->Feedback);
+		return true;
+	}
+
+	//RGB to the shader's HSL, whose lightness is the sum of the largest and smallest channels
+	void RGBToHSL(float red, float green, float blue, float hsl[3])
+	{
+		float maxComponent = std::max(red, std::max(green, blue));
+		float minComponent = std::min(red, std::min(green, blue));
+		float diff = maxComponent - minComponent;
+		float hue = 0.0f;
+		if      (maxComponent == red)   hue = 0.0f + (green - blue) / diff;
+		else if (maxComponent == green) hue = 2.0f + (blue - red) / diff;
+		else if (maxComponent == blue)  hue = 4.0f + (red - green) / diff;
+		hsl[0] = Frac(hue / 6.0f);
+		hsl[1] = diff / maxComponent;
+		hsl[2] = minComponent + maxComponent;
+	}
+
+	template<typename Float4>
+	Float4 HSLToRGB(const float hsl[3])
+	{
+		float hue = Frac(hsl[0]);
+		float red = Saturate(std::abs(hue * 6.0f - 3.0f) - 1.0f);
+		float green = Saturate(2.0f - std::abs(hue * 6.0f - 2.0f));
+		float blue = Saturate(2.0f - std::abs(hue * 6.0f - 4.0f));
+		return Lerp(Float4::Splat(1.0f), Float4::Set(red, green, blue, 1.0f), hsl[1]) * hsl[2];
+	}
+
+	template<typename Float4>
+	bool ShadeVerticalColourGradient(const Draw& draw, const PixelInput& input, Float4& output)
+	{
+		const PostProcessingConstants& constants = *draw.constants;
+		const CVector3& tint1 = constants.tintColour1;
+		const CVector3& tint2 = constants.tintColour2;
+		Float4 colour = SamplePoint<Float4>(draw.scene, input.sceneU, input.sceneV);
+		colour = colour + Lerp(Float4::Set(tint1.x, tint1.y, tint1.z, 0.0f), Float4::Set(tint2.x, tint2.y, tint2.z, 0.0f), input.sceneV);
+
+		float hsl[3];
+		RGBToHSL(colour.Red(), colour.Green(), colour.Blue(), hsl);
+		hsl[0] += constants.UnderwaterEffect / 10.0f;
+		output = HSLToRGB<Float4>(hsl).WithAlpha(1.0f);
+		return true;
+	}
+
+	//The linear-sampling blur shaders, reading the taps in the constants (see BlurKernel.h) a pixel step apart along one axis
+	template<typename Float4>
+	Float4 Blur(const SceneWindow& scene, const PixelInput& input, const PostProcessingConstants& constants, float stepU, float stepV)
+	{
+		Float4 colour = SampleBilinearClamp<Float4>(scene, input.sceneU, input.sceneV) * constants.blurTaps[0].y;
+		const int tapCount = std::min(static_cast<int>(constants.blurTapCount), MaxBlurTaps);
+		for (int i = 1; i < tapCount; ++i)
+		{
+			const CVector4& tap = constants.blurTaps[i];
+			float offsetU = stepU * tap.x, offsetV = stepV * tap.x;
+			colour = colour + SampleBilinearClamp<Float4>(scene, input.sceneU + offsetU, input.sceneV + offsetV) * tap.y;
+			colour = colour + SampleBilinearClamp<Float4>(scene, input.sceneU - offsetU, input.sceneV - offsetV) * tap.y;
+		}
+		return colour.WithAlpha(1.0f);
+	}
+
+	template<typename Float4>
+	bool ShadeHorizontalBlur(const Draw& draw, const PixelInput& input, Float4& output)
+	{
+		output = Blur<Float4>(draw.scene, input, *draw.constants, 1.0f / draw.scene.width, 0.0f);
+		return true;
+	}
+
+	template<typename Float4>
+	bool ShadeVerticalBlur(const Draw& draw, const PixelInput& input, Float4& output)
+	{
+		output = Blur<Float4>(draw.scene, input, *draw.constants, 0.0f, 1.0f / draw.scene.height);
+		return true;
+	}
+
+	//Where the fisheye reads the scene for a point of its area, distorted around a circle
+	void FisheyeUV(float areaU, float areaV, float& u, float& v)
+	{
+		float x = 2.0f * areaU - 1.0f, y = 2.0f * areaV - 1.0f;
+		float d = std::sqrt(x * x + y * y);
+		float theta = std::atan2(y, x);
+		float radius = std::pow(d, 1.5f);
+		u = 0.5f * (radius * std::cos(theta) + 1.0f);
+		v = 0.5f * (radius * std::sin(theta) + 1.0f);
+	}
+
+	template<typename Float4>
+	bool ShadeFisheye(const Draw& draw, const PixelInput& input, Float4& output)
+	{
+		float u, v;
+		if (draw.textures->remap)
+		{
+			SampleRemap(*draw.textures->remap, input.areaU, input.areaV, u, v);
+			u += input.areaU;
+			v += input.areaV;
+		}
+		else
+		{
+			FisheyeUV(input.areaU, input.areaV, u, v);
+		}
+
+		float x = 2.0f * input.areaU - 1.0f, y = 2.0f * input.areaV - 1.0f;
+		output = SamplePoint<Float4>(draw.scene, u, v);
+		if (std::sqrt(x * x + y * y) >= 1.0f) output = Float4::Set(0.0f, 0.0f, 0.0f, output.Alpha());
+		return true;
+	}
+
+	//The cut-out mask of the polygon effects, true where the pixel is kept
+	bool InsideMask(const Draw& draw, const PixelInput& input)
+	{
+		const PostProcessingConstants& constants = *draw.constants;
+		return SampleAtlas<ScalarFloat4>(*draw.textures->mask, input.areaU, input.areaV, constants.maskRect, draw.maskLOD).Red() <= constants.maskThreshold;
+	}
+
+	template<typename Float4>
+	bool ShadeGreyNoise(const Draw& draw, const PixelInput& input, Float4& output)
+	{
+		if (!InsideMask(draw, input)) return false;
+
+		const PostProcessingConstants& constants = *draw.constants;
+		const float NoiseStrength = 0.5f;
+		Float4 scene = SamplePoint<Float4>(draw.scene, input.sceneU, input.sceneV);
+		float grey = (scene.Red() + scene.Green() + scene.Blue()) / 3.0f;
+		float noiseU = input.sceneU * constants.noiseScale.x + constants.noiseOffset.x;
+		float noiseV = input.sceneV * constants.noiseScale.y + constants.noiseOffset.y;
+		grey += NoiseStrength * (SampleAtlas<Float4>(*draw.textures->noise, noiseU, noiseV, constants.lookupRect, draw.noiseLOD).Red() - 0.5f);
+		output = Float4::Set(grey, grey, grey, 0.0f);
+		return true;
+	}
+
+	//How far the distortion map moves a point of the area, before scaling by the distort level
+	void DistortDeviation(const Draw& draw, float areaU, float areaV, float& dx, float& dy)
+	{
+		ScalarFloat4 distort = SampleTrilinearWrap<ScalarFloat4>(*draw.textures->distort, areaU, areaV, draw.distortLOD);
+		dx = distort.Red() - 0.5f;
+		dy = distort.Green() - 0.5f;
+	}
+
+	template<typename Float4>
+	bool ShadeDistort(const Draw& draw, const PixelInput& input, Float4& output)
+	{
+		if (!InsideMask(draw, input)) return false;
+
+		const PostProcessingConstants& constants = *draw.constants;
+		const float lightStrength = 0.015f;
+		const float glassDarken = 0.8f;
+		float dx, dy;
+		if (draw.textures->remap) SampleRemap(*draw.textures->remap, input.areaU, input.areaV, dx, dy);
+		else                      DistortDeviation(draw, input.areaU, input.areaV, dx, dy);
+		float length = std::sqrt(dx * dx + dy * dy);
+		float light = (dx / length * 0.707f + dy / length * 0.707f) * lightStrength;
+
+		Float4 scene = SamplePoint<Float4>(draw.scene, input.sceneU + constants.distortLevel * dx, input.sceneV + constants.distortLevel * dy);
+		output = (Float4::Splat(light) + scene * glassDarken).WithAlpha(1.0f);
+		return true;
+	}
+
+	template<typename Float4>
+	bool ShadeSaturation(const Draw& draw, const PixelInput& input, Float4& output)
+	{
+		if (!InsideMask(draw, input)) return false;
+
+		const PostProcessingConstants& constants = *draw.constants;
+		Float4 colour = SamplePoint<Float4>(draw.scene, input.sceneU, input.sceneV);
+		float luminance = Dot3(colour, constants.LuminanceWeights);
+		output = Lerp(Float4::Splat(luminance), colour, constants.SaturationLevel).WithAlpha((colour.Red() + colour.Green() + colour.Blue()) / 3.0f);
+		return true;
+	}
+
+	//How far the haze moves the scene uv down at a point across the area. It only moves the uv up and down
+	float UnderwaterOffset(const PostProcessingConstants& constants, float areaU)
+	{
+		const float effectStrength = 0.015f;
+		float sinX = std::sin(areaU * ToRadians(250.0f) + constants.UnderwaterEffect * 4.0f);
+		return sinX * effectStrength * constants.area2DSize.y;
+	}
+
+	template<typename Float4>
+	bool ShadeUnderwater(const Draw& draw, const PixelInput& input, Float4& output)
+	{
+		const PostProcessingConstants& constants = *draw.constants;
+		float hazeOffset, unused;
+		if (draw.textures->remap) SampleRemap(*draw.textures->remap, input.areaU, 0.5f, unused, hazeOffset);
+		else                      hazeOffset = UnderwaterOffset(constants, input.areaU);
+
+		Float4 colour = SamplePoint<Float4>(draw.scene, input.sceneU, input.sceneV + hazeOffset) + Float4::Set(0.0f, 0.0f, 0.55f, 0.0f);
+		float luminance = Dot3(colour, constants.LuminanceWeights);
+		output = (colour * luminance).WithAlpha(0.0f);
+		return true;
+	}
+
+	//The four greens of Pixelation_ps's palette, by luminance, with the luminance as alpha
+	template<typename Float4>
+	Float4 GameBoyPalette(float luminance)
+	{
+		if      (luminance > 0.75f) return Float4::Set(0.7333f, 0.8118f, 0.3647f, luminance);
+		else if (luminance > 0.5f)  return Float4::Set(0.5412f, 0.6706f, 0.0588f, luminance);
+		else if (luminance > 0.25f) return Float4::Set(0.1882f, 0.3804f, 0.1882f, luminance);
+		else                        return Float4::Set(0.0588f, 0.2196f, 0.0588f, luminance);
+	}
+
+	template<typename Float4>
+	bool ShadePixelation(const Draw& draw, const PixelInput& input, Float4& output)
+	{
+		const PostProcessingConstants& constants = *draw.constants;
+		float u = std::floor(input.sceneU * constants.PixelWidth) / constants.PixelWidth;
+		float v = std::floor(input.sceneV * constants.PixelHeight) / constants.PixelHeight;
+		Float4 colour = SamplePoint<Float4>(draw.scene, u, v);
+		output = GameBoyPalette<Float4>(Dot3(colour, constants.LuminanceWeights));
+		return true;
+	}
+
+	template<typename Float4>
+	bool ShadeVignette(const Draw& draw, const PixelInput& input, Float4& output)
+	{
+		const PostProcessingConstants& constants = *draw.constants;
+		Float4 colour = SamplePoint<Float4>(draw.scene, input.sceneU, input.sceneV);
+		float dx = input.areaU - 0.5f, dy = input.areaV - 0.5f;
+		float dist = std::sqrt(dx * dx + dy * dy);
+
+		//smoothstep from the size to the size less the falloff
+		float t = Saturate((dist - constants.vignetteSize) / (-constants.vignetteFalloff));
+		float vignette = t * t * (3.0f - 2.0f * t);
+		vignette = Lerp(1.0f, vignette, constants.vignetteStrength);
+		output = Saturate(colour * vignette);
+		return true;
+	}
+
+
+	//-------------------------------------
+	// Drawing
+	//-------------------------------------
+
+	//Pixels of the target, [left, right) x [top, bottom)
+	struct Tile
+	{
+		uint32_t left, top, right, bottom;
+
+		bool     IsEmpty() const { return left >= right || top >= bottom; }
+		uint32_t GetWidth() const { return right - left; }
+		uint32_t GetHeight() const { return bottom - top; }
+	};
+
+	//The pixels in both tiles
+	Tile Intersect(const Tile& a, const Tile& b)
+	{
+		return { std::max(a.left, b.left), std::max(a.top, b.top), std::min(a.right, b.right), std::min(a.bottom, b.bottom) };
+	}
+
+	//A tile grown by the given pixels each side, within an image of the given size
+	Tile Expand(const Tile& tile, uint32_t across, uint32_t down, uint32_t width, uint32_t height)
+	{
+		return { tile.left - std::min(tile.left, across), tile.top - std::min(tile.top, down),
+		         std::min(tile.right + across, width), std::min(tile.bottom + down, height) };
+	}
+
+	//Split an area into tiles of the given size, the last in each row and column cut short
+	std::vector<Tile> SplitIntoTiles(const Tile& area, uint32_t size)
+	{
+		std::vector<Tile> tiles;
+		for (uint32_t y = area.top; y < area.bottom; y += size)
+		{
+			for (uint32_t x = area.left; x < area.right; x += size)
+			{
+				tiles.push_back({ x, y, std::min(x + size, area.right), std::min(y + size, area.bottom) });
+			}
+		}
+		return tiles;
+	}
+
+	//Shade the pixels of a tile of the target with an effect
+	using ShadeTileFunction = void (*)(const Draw&, const TargetWindow&, const Tile&);
+
+	template<typename Float4, bool (*Shade)(const Draw&, const PixelInput&, Float4&)>
+	void ShadeTile(const Draw& draw, const TargetWindow& target, const Tile& tile)
+	{
+		const PostProcessingConstants& constants = *draw.constants;
+		const float width = static_cast<float>(target.width), height = static_cast<float>(target.height);
+		PixelInput input;
+		for (uint32_t y = tile.top; y < tile.bottom; ++y)
+		{
+			//Values at the pixel's centre, as the rasterizer interpolates them
+			input.sceneV = (y + 0.5f) / height;
+			input.areaV = (input.sceneV - constants.area2DTopLeft.y) / constants.area2DSize.y;
+			float* pixel = target.At(tile.left, y);
+			for (uint32_t x = tile.left; x < tile.right; ++x, pixel += 4)
+			{
+				input.sceneU = (x + 0.5f) / width;
+				input.areaU = (input.sceneU - constants.area2DTopLeft.x) / constants.area2DSize.x;
+				Float4 colour;
+				if (Shade(draw, input, colour)) colour.Store(pixel);
+			}
+		}
+	}
+
+	template<typename Float4>
+	ShadeTileFunction GetShadeTile(CPUPostProcess effect)
+	{
+		switch (effect)
+		{
+		case CPUPostProcess::Copy:                   return ShadeTile<Float4, ShadeCopy<Float4>>;
+		case CPUPostProcess::VerticalColourGradient: return ShadeTile<Float4, ShadeVerticalColourGradient<Float4>>;
+		case CPUPostProcess::HorizontalBlur:         return ShadeTile<Float4, ShadeHorizontalBlur<Float4>>;
+		case CPUPostProcess::VerticalBlur:           return ShadeTile<Float4, ShadeVerticalBlur<Float4>>;
+		case CPUPostProcess::Fisheye:                return ShadeTile<Float4, ShadeFisheye<Float4>>;
+		case CPUPostProcess::GreyNoise:              return ShadeTile<Float4, ShadeGreyNoise<Float4>>;
+		case CPUPostProcess::Distort:                return ShadeTile<Float4, ShadeDistort<Float4>>;
+		case CPUPostProcess::Saturation:             return ShadeTile<Float4, ShadeSaturation<Float4>>;
+		case CPUPostProcess::Underwater:             return ShadeTile<Float4, ShadeUnderwater<Float4>>;
+		case CPUPostProcess::Pixelation:             return ShadeTile<Float4, ShadePixelation<Float4>>;
+		case CPUPostProcess::Vignette:               return ShadeTile<Float4, ShadeVignette<Float4>>;
+		default:                                     return nullptr;
+		}
+	}
+
+	template<typename Float4>
+	void DrawTiles(CPUPostProcess effect, const Draw& draw, const TargetWindow& target, const std::vector<Tile>& tiles, CThreadPool* threads)
+	{
+		ShadeTileFunction shadeTile = GetShadeTile<Float4>(effect);
+		if (!shadeTile) return;
+
+		ParallelFor(threads, static_cast<uint32_t>(tiles.size()), [&](uint32_t first, uint32_t end)
+		{
+			for (uint32_t i = first; i < end; ++i) shadeTile(draw, target, tiles[i]);
+		});
+	}
+
+	bool IsFloatImage(const CImage* image)
+	{
+		return image && !image->IsEmpty() && image->GetFormat() == ImageFormat::RGBA32F;
+	}
+
+	//True for the polygon effects, which discard pixels outside their cut-out mask
+	bool IsMasked(CPUPostProcess effect)
+	{
+		return effect == CPUPostProcess::GreyNoise || effect == CPUPostProcess::Distort || effect == CPUPostProcess::Saturation;
+	}
+
+	//Check the effect has every texture it samples besides the scene
+	bool HasTextures(CPUPostProcess effect, const CPUPostProcessTextures& textures)
+	{
+		return (!IsMasked(effect) || IsFloatImage(textures.mask)) && (effect != CPUPostProcess::GreyNoise || IsFloatImage(textures.noise)) &&
+		       (effect != CPUPostProcess::Distort || IsFloatImage(textures.distort));
+	}
+
+	//First and one past the last pixel whose centre is in [start, end) of a target's size - the rasterizer's top-left rule
+	void CoveredPixels(float start, float end, uint32_t size, uint32_t& first, uint32_t& last)
+	{
+		const auto pixel = [size](float edge)
+		{
+			float index = std::ceil(edge * size - 0.5f);
+			return index > 0.0f ? static_cast<uint32_t>(std::min(index, static_cast<float>(size))) : 0u;
+		};
+		first = pixel(start);
+		last = std::max(pixel(end), first);
+	}
+
+	//Pixels of a target of the given size covered by the area given by the constants
+	Tile GetDrawArea(const PostProcessingConstants& constants, uint32_t width, uint32_t height)
+	{
+		Tile area;
+		CoveredPixels(constants.area2DTopLeft.x, constants.area2DTopLeft.x + constants.area2DSize.x, width, area.left, area.right);
+		CoveredPixels(constants.area2DTopLeft.y, constants.area2DTopLeft.y + constants.area2DSize.y, height, area.top, area.bottom);
+		return area;
+	}
+
+	//A draw over a target of the given size, with all but its scene
+	Draw SetupDraw(const PostProcessingConstants& constants, const CPUPostProcessTextures& textures, uint32_t width, uint32_t height)
+	{
+		//The change in uv from one pixel to the next, across then down, for the area's uv and the noise map's uv
+		const float areaDU = 1.0f / (width * constants.area2DSize.x), areaDV = 1.0f / (height * constants.area2DSize.y);
+		const float noiseDU = constants.noiseScale.x / width, noiseDV = constants.noiseScale.y / height;
+		const CVector4& maskRect = constants.maskRect;
+		const CVector4& noiseRect = constants.lookupRect;
+
+		Draw draw;
+		draw.constants = &constants;
+		draw.textures = &textures;
+		draw.noiseLOD = ComputeLOD(textures.noise, noiseDU * noiseRect.z, 0.0f, 0.0f, noiseDV * noiseRect.w);
+		draw.maskLOD = ComputeLOD(textures.mask, areaDU * maskRect.z, 0.0f, 0.0f, areaDV * maskRect.w);
+		draw.distortLOD = ComputeLOD(textures.distort, areaDU, 0.0f, 0.0f, areaDV);
+		return draw;
+	}
+
+
+	//-------------------------------------
+	// Polygons
+	//-------------------------------------
+	// The polygon vertex shader draws the four points of polygon2DPoints, in clip space, as a triangle strip. Each triangle is
+	// clipped to the depth range and a guard band far outside the target, then rasterized as Direct3D 11 does: positions are
+	// snapped to 1/256 of a pixel and a pixel is covered if its centre is inside all three edges, or on a top or left edge, so
+	// triangles sharing an edge never both cover a pixel. Each row's covered span comes from the edges in whole numbers
+
+	const float     GuardBand     = 16.0f; // Clip space x and y are clipped to +-16 w, which keeps the edge sums in range
+	const long long SubpixelSteps = 256;   // Positions are snapped to 1/256 of a pixel
+	const uint32_t  BandHeight    = 16;    // Rows of each band of the target shared between workers, even so no quad of pixels is split
+
+	//A corner of a polygon in clip space, with the area uv the vertex shader gives it
+	struct ClipVertex
+	{
+		float x, y, z, w;
+		float areaU, areaV;
+	};
+
+	//Clip a convex polygon to the side of a plane where distance() is not negative, interpolating new corners in clip space.
+	//New corners are always found from the corner inside, so triangles sharing an edge clip it to the same point
+	template<typename Distance>
+	void ClipPolygon(std::vector<ClipVertex>& polygon, Distance distance)
+	{
+		std::vector<ClipVertex> clipped;
+		for (size_t i = 0; i < polygon.size(); ++i)
+		{
+			const ClipVertex& a = polygon[i];
+			const ClipVertex& b = polygon[(i + 1) % polygon.size()];
+			const float da = distance(a), db = distance(b);
+			if (da >= 0.0f) clipped.push_back(a);
+			if ((da >= 0.0f) != (db >= 0.0f))
+			{
+				const ClipVertex& inside = da >= 0.0f ? a : b;
+				const ClipVertex& outside = da >= 0.0f ? b : a;
+				const float dInside = std::max(da, db), t = dInside / (dInside - std::min(da, db));
+				clipped.push_back({ Lerp(inside.x, outside.x, t), Lerp(inside.y, outside.y, t), Lerp(inside.z, outside.z, t),
+				                    Lerp(inside.w, outside.w, t), Lerp(inside.areaU, outside.areaU, t), Lerp(inside.areaV, outside.areaV, t) });
+			}
+		}
+		polygon = std::move(clipped);
+	}
+
+	//Edge from one corner of a triangle to the next, in 1/256ths of a pixel. Positive inside, where the pixel centre's weight
+	//for the corner opposite is the edge's value there
+	struct TriangleEdge
+	{
+		long long startX, startY;
+		long long dx, dy;
+		long long bias; // 1 unless a top or left edge, which covers the pixel centres on it
+
+		long long Evaluate(long long x, long long y) const { return dx * (y - startY) - dy * (x - startX); }
+	};
+
+	//A triangle ready to rasterize, with its edges clockwise on the target
+	struct ScreenTriangle
+	{
+		TriangleEdge edges[3];     // Edge i is opposite corner i
+		double       uOverW[3];    // The area uv over w and 1 over w at each corner, to interpolate with perspective
+		double       vOverW[3];
+		double       oneOverW[3];
+		Tile         bounds;       // Pixels whose centre is within the triangle's bounding box
+	};
+
+	long long FloorDivide(long long a, long long b) // b > 0
+	{
+		return a >= 0 ? a / b : -((-a + b - 1) / b);
+	}
+
+	//Snap a clipped triangle to the target's pixels and set up its edges. Returns false if it covers no area
+	bool SetupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, uint32_t width, uint32_t height, ScreenTriangle& triangle)
+	{
+		const ClipVertex* corners[3] = { &a, &b, &c };
+		long long x[3], y[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			//The viewport transform, with y down the target
+			const ClipVertex& corner = *corners[i];
+			x[i] = std::llround((corner.x / corner.w * 0.5f + 0.5f) * width * SubpixelSteps);
+			y[i] = std::llround((0.5f - corner.y / corner.w * 0.5f) * height * SubpixelSteps);
+		}
+		long long area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+		if (area == 0) return false;
+		if (area < 0) // Both sides are drawn, as the polygons are drawn with no culling
+		{
+			std::swap(corners[1], corners[2]);
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+		}
+
+		for (int i = 0; i < 3; ++i)
+		{
+			const int start = (i + 1) % 3, end = (i + 2) % 3;
+			TriangleEdge& edge = triangle.edges[i];
+			edge = { x[start], y[start], x[end] - x[start], y[end] - y[start], 1 };
+			if ((edge.dy == 0 && edge.dx > 0) || edge.dy < 0) edge.bias = 0; // Top, then left
+			triangle.oneOverW[i] = 1.0 / corners[i]->w;
+			triangle.uOverW[i] = corners[i]->areaU * triangle.oneOverW[i];
+			triangle.vOverW[i] = corners[i]->areaV * triangle.oneOverW[i];
+		}
+
+		//Pixels whose centre, at pixel + 1/2, is in the box
+		const auto firstPixel = [](long long edge, uint32_t size)
+		{
+			return static_cast<uint32_t>(std::clamp(-FloorDivide(SubpixelSteps / 2 - edge, SubpixelSteps), 0LL, static_cast<long long>(size)));
+		};
+		const auto endPixel = [](long long edge, uint32_t size)
+		{
+			return static_cast<uint32_t>(std::clamp(FloorDivide(edge - SubpixelSteps / 2, SubpixelSteps) + 1, 0LL, static_cast<long long>(size)));
+		};
+		triangle.bounds = { firstPixel(*std::min_element(x, x + 3), width), firstPixel(*std::min_element(y, y + 3), height),
+		                    endPixel(*std::max_element(x, x + 3), width), endPixel(*std::max_element(y, y + 3), height) };
+		return !triangle.bounds.IsEmpty();
+	}
+
+	//The triangles of the polygon the constants give, clipped and snapped to a target of the given size
+	std::vector<ScreenTriangle> SetupPolygon(const PostProcessingConstants& constants, uint32_t width, uint32_t height)
+	{
+		//The vertex shader's UVs for each point, and the strip's triangles - the second is wound the other way, as in a strip
+		const float polygonUVs[4][2] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 1, 1 } };
+		const int strip[2][3] = { { 0, 1, 2 }, { 2, 1, 3 } };
+
+		std::vector<ScreenTriangle> triangles;
+		for (auto& corners : strip)
+		{
+			std::vector<ClipVertex> polygon;
+			for (int corner : corners)
+			{
+				const CVector4& point = constants.polygon2DPoints[corner];
+				polygon.push_back({ point.x, point.y, point.z, point.w, polygonUVs[corner][0], polygonUVs[corner][1] });
+			}
+
+			//Between the near and far planes, which also puts w above 0, and inside the guard band
+			ClipPolygon(polygon, [](const ClipVertex& v) { return v.z; });
+			ClipPolygon(polygon, [](const ClipVertex& v) { return v.w - v.z; });
+			ClipPolygon(polygon, [](const ClipVertex& v) { return GuardBand * v.w - v.x; });
+			ClipPolygon(polygon, [](const ClipVertex& v) { return GuardBand * v.w + v.x; });
+			ClipPolygon(polygon, [](const ClipVertex& v) { return GuardBand * v.w - v.y; });
+			ClipPolygon(polygon, [](const ClipVertex& v) { return GuardBand * v.w + v.y; });
+			if (std::any_of(polygon.begin(), polygon.end(), [](const ClipVertex& v) { return !(v.w > 0.0f); })) continue;
+
+			//A fan of triangles over what is left
+			for (size_t i = 2; i < polygon.size(); ++i)
+			{
+				ScreenTriangle triangle;
+				if (SetupTriangle(polygon[0], polygon[i - 1], polygon[i], width, height, triangle)) triangles.push_back(triangle);
+			}
+		}
+		return triangles;
+	}
+
+	//The pixels [first, end) of a row, within the given area, a triangle covers
+	void GetCoveredSpan(const ScreenTriangle& triangle, uint32_t y, const Tile& area, uint32_t& first, uint32_t& end)
+	{
+		long long left = area.left, right = area.right;
+		const long long centreY = y * SubpixelSteps + SubpixelSteps / 2;
+		for (const TriangleEdge& edge : triangle.edges)
+		{
+			//The edge's value, less its bias, is constant + step * x at the centre of pixel x. It must not be negative
+			const long long constant = edge.Evaluate(SubpixelSteps / 2, centreY) - edge.bias;
+			const long long step = -edge.dy * SubpixelSteps;
+			if      (step > 0)     left = std::max(left, -FloorDivide(constant, step));
+			else if (step < 0)     right = std::min(right, FloorDivide(constant, -step) + 1);
+			else if (constant < 0) right = left;
+		}
+		first = static_cast<uint32_t>(left);
+		end = static_cast<uint32_t>(std::max(left, right));
+	}
+
+	//The area uv at the centre of a pixel, interpolated with perspective. Pixels outside the triangle extrapolate, as the
+	//helper pixels the GPU shades to find the change in uv across a quad do
+	void InterpolateAreaUV(const ScreenTriangle& triangle, long long x, long long y, float& u, float& v)
+	{
+		const long long centreX = x * SubpixelSteps + SubpixelSteps / 2, centreY = y * SubpixelSteps + SubpixelSteps / 2;
+		double sumU = 0.0, sumV = 0.0, sumW = 0.0;
+		for (int i = 0; i < 3; ++i)
+		{
+			const double weight = static_cast<double>(triangle.edges[i].Evaluate(centreX, centreY));
+			sumU += weight * triangle.uOverW[i];
+			sumV += weight * triangle.vOverW[i];
+			sumW += weight * triangle.oneOverW[i];
+		}
+		const double w = 1.0 / sumW;
+		u = static_cast<float>(sumU * w);
+		v = static_cast<float>(sumV * w);
+	}
+
+	//Shade the pixels of a band of the target the triangles cover with an effect
+	using ShadeBandFunction = void (*)(const Draw&, const TargetWindow&, const std::vector<ScreenTriangle>&, const Tile&);
+
+	template<typename Float4, bool (*Shade)(const Draw&, const PixelInput&, Float4&)>
+	void ShadePolygonBand(const Draw& polygonDraw, const TargetWindow& target, const std::vector<ScreenTriangle>& triangles, const Tile& band)
+	{
+		const float width = static_cast<float>(target.width), height = static_cast<float>(target.height);
+		const CVector4& maskRect = polygonDraw.constants->maskRect;
+		const CPUPostProcessTextures& textures = *polygonDraw.textures;
+		const bool sampledByArea = textures.mask || textures.distort;
+		Draw draw = polygonDraw;
+		PixelInput input;
+		for (const ScreenTriangle& triangle : triangles)
+		{
+			//A quad of 2x2 pixels at a time, as the GPU shades
+			const Tile area = Intersect(triangle.bounds, band);
+			for (uint32_t top = area.top & ~1u; top < area.bottom; top += 2)
+			{
+				uint32_t first[2], end[2];
+				for (uint32_t row = 0; row < 2; ++row)
+				{
+					first[row] = end[row] = 0;
+					if (top + row >= area.top && top + row < area.bottom) GetCoveredSpan(triangle, top + row, area, first[row], end[row]);
+				}
+				if (first[0] == end[0] && first[1] == end[1]) continue;
+				const uint32_t left = (first[0] == end[0] ? first[1] : first[1] == end[1] ? first[0] : std::min(first[0], first[1])) & ~1u;
+				const uint32_t right = std::max(end[0], end[1]);
+
+				for (uint32_t x = left; x < right; x += 2)
+				{
+					//The quad's uv, and from the change across its top row and down its left column, the textures' mips
+					float u[4], v[4];
+					for (uint32_t p = 0; p < 4; ++p) InterpolateAreaUV(triangle, x + p % 2, top + p / 2, u[p], v[p]);
+					if (sampledByArea)
+					{
+						const float dudx = u[1] - u[0], dvdx = v[1] - v[0], dudy = u[2] - u[0], dvdy = v[2] - v[0];
+						draw.maskLOD = ComputeLOD(textures.mask, dudx * maskRect.z, dvdx * maskRect.w, dudy * maskRect.z, dvdy * maskRect.w);
+						draw.distortLOD = ComputeLOD(textures.distort, dudx, dvdx, dudy, dvdy);
+					}
+
+					for (uint32_t p = 0; p < 4; ++p)
+					{
+						const uint32_t px = x + p % 2, row = p / 2;
+						if (px < first[row] || px >= end[row]) continue;
+
+						//The scene uv is interpolated without perspective from the corners' positions, so is the pixel's centre
+						input.sceneU = (px + 0.5f) / width;
+						input.sceneV = (top + row + 0.5f) / height;
+						input.areaU = u[p];
+						input.areaV = v[p];
+						Float4 colour;
+						if (Shade(draw, input, colour)) colour.Store(target.At(px, top + row));
+					}
+				}
+			}
+		}
+	}
+
+	template<typename Float4>
+	ShadeBandFunction GetShadePolygonBand(CPUPostProcess effect)
+	{
+		switch (effect)
+		{
+		case CPUPostProcess::Copy:                   return ShadePolygonBand<Float4, ShadeCopy<Float4>>;
+		case CPUPostProcess::VerticalColourGradient: return ShadePolygonBand<Float4, ShadeVerticalColourGradient<Float4>>;
+		case CPUPostProcess::HorizontalBlur:         return ShadePolygonBand<Float4, ShadeHorizontalBlur<Float4>>;
+		case CPUPostProcess::VerticalBlur:           return ShadePolygonBand<Float4, ShadeVerticalBlur<Float4>>;
+		case CPUPostProcess::Fisheye:                return ShadePolygonBand<Float4, ShadeFisheye<Float4>>;
+		case CPUPostProcess::GreyNoise:              return ShadePolygonBand<Float4, ShadeGreyNoise<Float4>>;
+		case CPUPostProcess::Distort:                return ShadePolygonBand<Float4, ShadeDistort<Float4>>;
+		case CPUPostProcess::Saturation:             return ShadePolygonBand<Float4, ShadeSaturation<Float4>>;
+		case CPUPostProcess::Underwater:             return ShadePolygonBand<Float4, ShadeUnderwater<Float4>>;
+		case CPUPostProcess::Pixelation:             return ShadePolygonBand<Float4, ShadePixelation<Float4>>;
+		case CPUPostProcess::Vignette:               return ShadePolygonBand<Float4, ShadeVignette<Float4>>;
+		default:                                     return nullptr;
+		}
+	}
+
+	//Shade the triangles a band of rows at a time, shared between the pool's workers
+	template<typename Float4>
+	void DrawPolygon(CPUPostProcess effect, const Draw& draw, const TargetWindow& target, const std::vector<ScreenTriangle>& triangles,
+	                 CThreadPool* threads)
+	{
+		ShadeBandFunction shadeBand = GetShadePolygonBand<Float4>(effect);
+		if (!shadeBand) return;
+
+		//Only the polygon effects' mips change across the polygon, so the others skip finding them
+		CPUPostProcessTextures textures = *draw.textures;
+		if (!IsMasked(effect)) textures.mask = nullptr;
+		if (effect != CPUPostProcess::Distort) textures.distort = nullptr;
+		Draw polygonDraw = draw;
+		polygonDraw.textures = &textures;
+
+		uint32_t top = target.height, bottom = 0;
+		for (const ScreenTriangle& triangle : triangles)
+		{
+			top = std::min(top, triangle.bounds.top);
+			bottom = std::max(bottom, triangle.bounds.bottom);
+		}
+		top &= ~1u;
+		if (top >= bottom) return;
+
+		ParallelFor(threads, (bottom - top + BandHeight - 1) / BandHeight, [&](uint32_t first, uint32_t end)
+		{
+			for (uint32_t b = first; b < end; ++b)
+			{
+				const uint32_t bandTop = top + b * BandHeight;
+				shadeBand(polygonDraw, target, triangles, { 0, bandTop, target.width, std::min(bandTop + BandHeight, bottom) });
+			}
+		});
+	}
+
+
+	//-------------------------------------
+	// Chains
+	//-------------------------------------
+	// Stages of a chain that read only near each pixel are fused into a group, run a tile at a time. Working back from the
+	// last stage, each stage's result is needed over the tile grown by the halo the stages after it read, and it reads its
+	// own reach further. The first stage reads the group's input image and the last writes the tile of its output, with the
+	// results between in two buffers of scratch that stay in the cache
+
+	const uint32_t MaxHalo         = 64;         // Stages reading further from each pixel start a group, reading a whole image
+	const size_t   ChainCacheBytes = 256 * 1024; // Most a fused tile reads and writes, for it to stay in a core's L2 cache
+	const double   PassCost        = 1.0;        // A pass through full-size images per pixel, in scene fetches - about a copy
+	const double   ScratchCost     = 0.5;        // Handing a stage's result to the next through the scratch of a fused tile
+	const double   MinFusionSaving = 0.05;       // Least share of a chain's cost fusing a stage must save to outweigh the tiles
+
+	//Pixels from each pixel, across and down, an effect reads the scene at most. Returns false if it may read anywhere
+	bool GetSceneReach(const CPUPostProcessStage& stage, const CPUPostProcessTextures& textures, uint32_t width, uint32_t height,
+	                   uint32_t& across, uint32_t& down)
+	{
+		const PostProcessingConstants& constants = stage.constants;
+		const auto pixels = [](double distance) { return std::ceil(distance) + 1.0; }; // A pixel more for rounding
+		double x = 0.0, y = 0.0;
+		switch (stage.effect)
+		{
+		case CPUPostProcess::HorizontalBlur:
+		case CPUPostProcess::VerticalBlur:
+		{
+			//Bilinear filtering reads the pixel either side of a tap on both axes, whichever way the uv rounds
+			double offset = 0.0;
+			const int tapCount = std::min(static_cast<int>(constants.blurTapCount), MaxBlurTaps);
+			for (int i = 1; i < tapCount; ++i) offset = std::max(offset, static_cast<double>(std::abs(constants.blurTaps[i].x)));
+			x = pixels(offset);
+			y = 1.0;
+			if (stage.effect == CPUPostProcess::VerticalBlur) std::swap(x, y);
+			break;
+		}
+		case CPUPostProcess::Underwater:
+			y = pixels(0.015 * std::abs(constants.area2DSize.y) * height);
+			break;
+		case CPUPostProcess::Pixelation:
+			//Back to the corner of the block the pixel is in
+			if (!(constants.PixelWidth > 0.0f) || !(constants.PixelHeight > 0.0f)) return false;
+			x = pixels(width / constants.PixelWidth);
+			y = pixels(height / constants.PixelHeight);
+			break;
+		case CPUPostProcess::Distort:
+		{
+			//As far as the distortion map's red and green reach from 0.5, in any mip
+			if (!IsFloatImage(textures.distort)) return false;
+			const float* values = reinterpret_cast<const float*>(textures.distort->GetData());
+			double distortion = 0.0;
+			for (size_t i = 0; i < textures.distort->GetSize() / sizeof(float); i += 4)
+			{
+				distortion = std::max({ distortion, std::abs(values[i] - 0.5), std::abs(values[i + 1] - 0.5) });
+			}
+			x = pixels(std::abs(constants.distortLevel) * distortion * width);
+			y = pixels(std::abs(constants.distortLevel) * distortion * height);
+			break;
+		}
+		case CPUPostProcess::Fisheye:
+			return false;
+		default:
+			break; // The rest read the scene at the pixel itself
+		}
+		if (!(x <= MaxHalo) || !(y <= MaxHalo)) return false; // Also NaN
+		across = static_cast<uint32_t>(x);
+		down = static_cast<uint32_t>(y);
+		return true;
+	}
+
+	//Rough cost of shading a pixel with an effect, in scene fetches - the blurs fetch for every tap, the polygon effects also
+	//sample their mask
+	double EstimateShadeCost(const CPUPostProcessStage& stage)
+	{
+		if (stage.effect == CPUPostProcess::HorizontalBlur || stage.effect == CPUPostProcess::VerticalBlur)
+		{
+			return std::max(2.0 * std::min(static_cast<int>(stage.constants.blurTapCount), MaxBlurTaps) - 1.0, 1.0);
+		}
+		return IsMasked(stage.effect) ? 2.0 : 1.0;
+	}
+
+	//How a stage of a chain reads its scene, and what its pixels cost
+	struct StagePlan
+	{
+		uint32_t reachAcross = 0, reachDown = 0;
+		double   cost = 1.0;
+	};
+
+	//Stages [first, end) of a chain run together, with the halo of extra pixels each stage's result is needed over
+	struct ChainGroup
+	{
+		size_t first, end;
+		std::vector<uint32_t> haloAcross, haloDown;
+		uint32_t readAcross, readDown; // How far the first stage reads the input
+		uint32_t tileSize;
+		size_t   scratchFloats; // In each of the buffers, one less than the stages up to two
+	};
+
+	//Work out the halos of a group, back from none for the last stage, and the largest tiles whose results fit in the scratch.
+	//Returns the estimated cost of running the group for each pixel of the image: its shading, halos included, a pass through
+	//full-size images, and the scratch between each stage and the next
+	double PlanChainGroup(ChainGroup& group, const std::vector<StagePlan>& plans)
+	{
+		const size_t count = group.end - group.first;
+		group.haloAcross.assign(count, 0);
+		group.haloDown.assign(count, 0);
+		for (size_t s = count - 1; s > 0; --s)
+		{
+			group.haloAcross[s - 1] = group.haloAcross[s] + plans[group.first + s].reachAcross;
+			group.haloDown[s - 1] = group.haloDown[s] + plans[group.first + s].reachDown;
+		}
+		group.readAcross = plans[group.first].reachAcross;
+		group.readDown = plans[group.first].reachDown;
+		group.tileSize = TileSize;
+		group.scratchFloats = 0;
+		if (count == 1) return plans[group.first].cost + PassCost;
+
+		//From 256 pixels down to 16, so the results fit in the cache with the same area of the input the first stage reads
+		const size_t buffers = std::min(count - 1, size_t(2));
+		const auto floats = [&](uint32_t size) { return size_t(size + 2 * group.haloAcross[0]) * (size + 2 * group.haloDown[0]) * 4; };
+		group.tileSize = 256;
+		while (group.tileSize > 16 && floats(group.tileSize) * (buffers + 1) * sizeof(float) > ChainCacheBytes) group.tileSize -= 16;
+		group.scratchFloats = floats(group.tileSize);
+
+		double shaded = 0.0;
+		for (size_t s = 0; s < count; ++s)
+		{
+			shaded += plans[group.first + s].cost * (group.tileSize + 2 * group.haloAcross[s]) * (group.tileSize + 2 * group.haloDown[s]);
+		}
+		return shaded / (double(group.tileSize) * group.tileSize) + PassCost + ScratchCost * (count - 1);
+	}
+
+	//Copy the pixels of a tile from one image window to another
+	template<typename Source>
+	void CopyTile(const Source& source, const TargetWindow& destination, const Tile& tile)
+	{
+		for (uint32_t y = tile.top; y < tile.bottom; ++y)
+		{
+			const float* in = source.At(tile.left, y);
+			std::copy(in, in + tile.GetWidth() * 4, destination.At(tile.left, y));
+		}
+	}
+
+	//Run a group of stages over an input image into an output image of the same size, a tile of the output at a time
+	template<typename Float4>
+	void RunChainGroup(const std::vector<CPUPostProcessStage>& stages, const ChainGroup& group, const CPUPostProcessTextures& textures,
+	                   const CImage& input, CImage& output, CThreadPool* threads, CPUPostProcessChainStats& stats)
+	{
+		const uint32_t width = input.GetWidth(), height = input.GetHeight();
+		const size_t count = group.end - group.first;
+
+		//Each stage's draw, reading from the whole input or from scratch set for each tile
+		std::vector<Draw> draws;
+		std::vector<Tile> areas;
+		std::vector<ShadeTileFunction> shadeTiles;
+		for (size_t s = group.first; s < group.end; ++s)
+		{
+			draws.push_back(SetupDraw(stages[s].constants, textures, width, height));
+			areas.push_back(GetDrawArea(stages[s].constants, width, height));
+			shadeTiles.push_back(GetShadeTile<Float4>(stages[s].effect));
+		}
+
+		const uint32_t tileSize = group.tileSize;
+		const size_t scratchFloats = group.scratchFloats, buffers = std::min(count - 1, size_t(2));
+		const std::vector<Tile> tiles = SplitIntoTiles({ 0, 0, width, height }, tileSize);
+
+		const SceneWindow whole = WholeImage<const float>(input);
+		const TargetWindow target = WholeImage<float>(output);
+		std::vector<size_t> inputBytes(tiles.size()), shadedPixels(tiles.size());
+		ParallelFor(threads, static_cast<uint32_t>(tiles.size()), [&](uint32_t first, uint32_t end)
+		{
+			std::vector<float> scratch(scratchFloats * buffers);
+			for (uint32_t t = first; t < end; ++t)
+			{
+				const Tile& tile = tiles[t];
+				SceneWindow scene = whole;
+				for (size_t s = 0; s < count; ++s)
+				{
+					//Each stage draws over a copy of its scene, into scratch or, last, the output
+					const Tile region = Expand(tile, group.haloAcross[s], group.haloDown[s], width, height);
+					TargetWindow result = target;
+					if (s + 1 < count)
+					{
+						result = { scratch.data() + scratchFloats * (s % 2), region.GetWidth() * size_t(4), region.left, region.top, width, height };
+					}
+					const Tile shaded = Intersect(region, areas[s]);
+					const bool covered = !IsMasked(stages[group.first + s].effect) && !shaded.IsEmpty() &&
+					                     shaded.GetWidth() == region.GetWidth() && shaded.GetHeight() == region.GetHeight();
+					if (!covered) CopyTile(scene, result, region); // Only needed where pixels pass through
+					if (!shaded.IsEmpty() && shadeTiles[s])
+					{
+						Draw draw = draws[s];
+						draw.scene = scene;
+						shadeTiles[s](draw, result, shaded);
+						shadedPixels[t] += size_t(shaded.GetWidth()) * shaded.GetHeight();
+					}
+					if (s == 0)
+					{
+						const Tile read = Expand(region, group.readAcross, group.readDown, width, height);
+						inputBytes[t] = size_t(read.GetWidth()) * read.GetHeight() * 4 * sizeof(float);
+					}
+					scene = { result.pixels, result.pitch, result.left, result.top, width, height };
+				}
+			}
+		});
+
+		++stats.passes;
+		stats.tileSize = tileSize;
+		stats.scratchBytes = std::max(stats.scratchBytes, scratchFloats * buffers * sizeof(float));
+		for (size_t t = 0; t < tiles.size(); ++t)
+		{
+			stats.imageBytes += inputBytes[t] + size_t(tiles[t].GetWidth()) * tiles[t].GetHeight() * 4 * sizeof(float);
+			stats.shadedPixels += shadedPixels[t];
+		}
+	}
+
+	template<typename Float4>
+	void RunChain(const std::vector<CPUPostProcessStage>& stages, const std::vector<ChainGroup>& groups, const CPUPostProcessTextures& textures,
+	              CImage& target, CThreadPool* threads, CPUPostProcessChainStats& stats)
+	{
+		//Groups before the last write to two full-size images in turn
+		const CImage& scene = *textures.scene;
+		CImage intermediates[2];
+		const CImage* input = &scene;
+		for (size_t g = 0; g < groups.size(); ++g)
+		{
+			CImage* output = &target;
+			if (g + 1 < groups.size())
+			{
+				output = &intermediates[g % 2];
+				if (output->IsEmpty()) output->Create(ImageFormat::RGBA32F, scene.GetWidth(), scene.GetHeight());
+			}
+			RunChainGroup<Float4>(stages, groups[g], textures, *input, *output, threads, stats);
+			input = output;
+		}
+	}
+
+
+	//-------------------------------------
+	// Area-averaged pixelation
+	//-------------------------------------
+
+	//First pixel of each of Pixelation_ps's blocks along one axis, then one past the last pixel. A pixel is in the block its
+	//centre's uv floors to, as the shader snaps it, so blocks too narrow to hold a pixel's centre have none and are left out
+	std::vector<uint32_t> GetBlockStarts(uint32_t pixels, float blocks)
+	{
+		std::vector<uint32_t> starts;
+		float lastBlock = 0.0f;
+		for (uint32_t i = 0; i < pixels; ++i)
+		{
+			float block = std::floor((i + 0.5f) / pixels * blocks);
+			if (starts.empty() || block != lastBlock) starts.push_back(i);
+			lastBlock = block;
+		}
+		starts.push_back(pixels);
+		return starts;
+	}
+
+	//Pixelate the rows of blocks [first, end): add up each block's pixels a row at a time, average them, pick the green and fill
+	//the block with it. All of a row of blocks is read before any of it is written, so the target may be the scene
+	template<typename Float4>
+	void PixelateBlocks(const PostProcessingConstants& constants, const SceneWindow& scene, const TargetWindow& target,
+	                    const std::vector<uint32_t>& columns, const std::vector<uint32_t>& rows, uint32_t first, uint32_t end)
+	{
+		const size_t blocksAcross = columns.size() - 1;
+		std::vector<Float4> blocks(blocksAcross);
+		for (uint32_t row = first; row < end; ++row)
+		{
+			std::fill(blocks.begin(), blocks.end(), Float4::Splat(0.0f));
+			for (uint32_t y = rows[row]; y < rows[row + 1]; ++y)
+			{
+				const float* pixel = scene.At(0, y);
+				for (size_t b = 0; b < blocksAcross; ++b)
+				{
+					Float4 sum = blocks[b];
+					for (uint32_t x = columns[b]; x < columns[b + 1]; ++x, pixel += 4) sum = sum + Float4::Load(pixel);
+					blocks[b] = sum;
+				}
+			}
+
+			const uint32_t blockHeight = rows[row + 1] - rows[row];
+			for (size_t b = 0; b < blocksAcross; ++b)
+			{
+				Float4 average = blocks[b] * (1.0f / (static_cast<float>(columns[b + 1] - columns[b]) * blockHeight));
+				blocks[b] = GameBoyPalette<Float4>(Dot3(average, constants.LuminanceWeights));
+			}
+
+			for (uint32_t y = rows[row]; y < rows[row + 1]; ++y)
+			{
+				float* pixel = target.At(0, y);
+				for (size_t b = 0; b < blocksAcross; ++b)
+				{
+					for (uint32_t x = columns[b]; x < columns[b + 1]; ++x, pixel += 4) blocks[b].Store(pixel);
+				}
+			}
+		}
+	}
+}
+
+
+//Return the name of an effect's pixel shader
+const char* GetPostProcessName(CPUPostProcess effect)
+{
+	switch (effect)
+	{
+	case CPUPostProcess::Copy:                   return "Copy";
+	case CPUPostProcess::VerticalColourGradient: return "VerticalColourGradient";
+	case CPUPostProcess::HorizontalBlur:         return "HorizontalBlur";
+	case CPUPostProcess::VerticalBlur:           return "VerticalBlur";
+	case CPUPostProcess::Fisheye:                return "Fisheye";
+	case CPUPostProcess::GreyNoise:              return "GreyNoise";
+	case CPUPostProcess::Distort:                return "Distort";
+	case CPUPostProcess::Saturation:             return "Saturation";
+	case CPUPostProcess::Underwater:             return "Underwater";
+	case CPUPostProcess::Pixelation:             return "Pixelation";
+	case CPUPostProcess::Vignette:               return "Vignette";
+	default:                                     return "Unknown";
+	}
+}
+
+//Run a post-process over the area of the target given by the constants
+bool RunCPUPostProcess(CPUPostProcess effect, const PostProcessingConstants& constants, const CPUPostProcessTextures& textures,
+                       CImage& target, CThreadPool* threads, bool useSIMD)
+{
+	if (!IsFloatImage(&target) || !IsFloatImage(textures.scene) || !HasTextures(effect, textures)) return false;
+
+	const uint32_t width = target.GetWidth(), height = target.GetHeight();
+	const Tile area = GetDrawArea(constants, width, height);
+	if (area.IsEmpty()) return true;
+
+	Draw draw = SetupDraw(constants, textures, width, height);
+	draw.scene = WholeImage<const float>(*textures.scene);
+	const std::vector<Tile> tiles = SplitIntoTiles(area, TileSize);
+
+#if FLOAT4_SIMD
+	if (useSIMD)
+	{
+		DrawTiles<SSEFloat4>(effect, draw, WholeImage<float>(target), tiles, threads);
+		return true;
+	}
+#else
+	(void)useSIMD;
+#endif
+	DrawTiles<ScalarFloat4>(effect, draw, WholeImage<float>(target), tiles, threads);
+	return true;
+}
+
+//Run a post-process over the polygon given by the four points in the constants, as the polygon vertex shader draws it
+bool RunCPUPostProcessPolygon(CPUPostProcess effect, const PostProcessingConstants& constants, const CPUPostProcessTextures& textures,
+                              CImage& target, CThreadPool* threads, bool useSIMD)
+{
+	if (!IsFloatImage(&target) || !IsFloatImage(textures.scene) || !HasTextures(effect, textures)) return false;
+
+	const uint32_t width = target.GetWidth(), height = target.GetHeight();
+	const std::vector<ScreenTriangle> triangles = SetupPolygon(constants, width, height);
+	if (triangles.empty()) return true;
+
+	Draw draw = SetupDraw(constants, textures, width, height);
+	draw.scene = WholeImage<const float>(*textures.scene);
+
+#if FLOAT4_SIMD
+	if (useSIMD)
+	{
+		DrawPolygon<SSEFloat4>(effect, draw, WholeImage<float>(target), triangles, threads);
+		return true;
+	}
+#else
+	(void)useSIMD;
+#endif
+	DrawPolygon<ScalarFloat4>(effect, draw, WholeImage<float>(target), triangles, threads);
+	return true;
+}
+
+//True for the effects whose distortion can be baked into a uv offset map
+bool HasCPUPostProcessRemap(CPUPostProcess effect)
+{
+	return effect == CPUPostProcess::Fisheye || effect == CPUPostProcess::Underwater || effect == CPUPostProcess::Distort;
+}
+
+//Bake the uv offsets of an effect's distortion over the area of a target of the given size into an RG32F map
+bool BakeCPUPostProcessRemap(CPUPostProcess effect, const PostProcessingConstants& constants, const CPUPostProcessTextures& textures,
+                             uint32_t width, uint32_t height, CImage& map, CThreadPool* threads)
+{
+	if (!HasCPUPostProcessRemap(effect) || (effect == CPUPostProcess::Distort && !IsFloatImage(textures.distort))) return false;
+
+	//A texel for each pixel of the area, in one row for the haze, which only changes across it
+	const Tile area = GetDrawArea(constants, width, height);
+	const uint32_t mapWidth = std::max(area.GetWidth(), 1u);
+	const uint32_t mapHeight = effect == CPUPostProcess::Underwater ? 1 : std::max(area.GetHeight(), 1u);
+	if (!map.Create(ImageFormat::RG32F, mapWidth, mapHeight)) return false;
+
+	const Draw draw = SetupDraw(constants, textures, width, height);
+	ParallelFor(threads, mapHeight, [&](uint32_t first, uint32_t end)
+	{
+		for (uint32_t y = first; y < end; ++y)
+		{
+			//Offsets at the area uv of each texel's centre
+			const float areaV = (y + 0.5f) / mapHeight;
+			float* texel = reinterpret_cast<float*>(map.GetRow(0, y));
+			for (uint32_t x = 0; x < mapWidth; ++x, texel += 2)
+			{
+				const float areaU = (x + 0.5f) / mapWidth;
+				switch (effect)
+				{
+				case CPUPostProcess::Fisheye:
+					FisheyeUV(areaU, areaV, texel[0], texel[1]);
+					texel[0] -= areaU;
+					texel[1] -= areaV;
+					break;
+				case CPUPostProcess::Underwater:
+					texel[0] = 0.0f;
+					texel[1] = UnderwaterOffset(constants, areaU);
+					break;
+				default:
+					DistortDeviation(draw, areaU, areaV, texel[0], texel[1]);
+					break;
+				}
+			}
+		}
+	});
+	return true;
+}
+
+//Pixelate a scene by averaging each of Pixelation_ps's blocks of pixels
+bool RunCPUPixelationAreaAverage(const PostProcessingConstants& constants, const CImage& scene, CImage& target, CThreadPool* threads,
+                                 bool useSIMD)
+{
+	if (!IsFloatImage(&scene)) return false;
+	const uint32_t width = scene.GetWidth(), height = scene.GetHeight();
+	if (&scene != &target && !target.Create(ImageFormat::RGBA32F, width, height)) return false;
+
+	const std::vector<uint32_t> columns = GetBlockStarts(width, constants.PixelWidth);
+	const std::vector<uint32_t> rows = GetBlockStarts(height, constants.PixelHeight);
+	const SceneWindow sceneWindow = WholeImage<const float>(scene);
+	const TargetWindow targetWindow = WholeImage<float>(target);
+
+	//Rows of blocks are shared between the pool's workers
+	ParallelFor(threads, static_cast<uint32_t>(rows.size() - 1), [&](uint32_t first, uint32_t end)
+	{
+#if FLOAT4_SIMD
+		if (useSIMD)
+		{
+			PixelateBlocks<SSEFloat4>(constants, sceneWindow, targetWindow, columns, rows, first, end);
+			return;
+		}
+#else
+		(void)useSIMD;
+#endif
+		PixelateBlocks<ScalarFloat4>(constants, sceneWindow, targetWindow, columns, rows, first, end);
+	});
+	return true;
+}
+
+//Run a chain of effects over a scene into the target
+bool RunCPUPostProcessChain(const std::vector<CPUPostProcessStage>& stages, const CPUPostProcessTextures& sceneTextures, CImage& target,
+                            CThreadPool* threads, bool useSIMD, bool fuse, CPUPostProcessChainStats* stats)
+{
+	//A remap is baked for one effect, so is not shared between the stages
+	CPUPostProcessTextures textures = sceneTextures;
+	textures.remap = nullptr;
+	if (stages.empty() || !IsFloatImage(textures.scene) || &target == textures.scene) return false;
+	for (auto& stage : stages)
+	{
+		if (!HasTextures(stage.effect, textures)) return false;
+	}
+
+	const CImage& scene = *textures.scene;
+	const uint32_t width = scene.GetWidth(), height = scene.GetHeight();
+	if (!IsFloatImage(&target) || target.GetWidth() != width || target.GetHeight() != height)
+	{
+		if (!target.Create(ImageFormat::RGBA32F, width, height)) return false;
+	}
+
+	std::vector<StagePlan> plans(stages.size());
+	std::vector<bool> bounded(stages.size());
+	double chainCost = 0.0;
+	for (size_t s = 0; s < stages.size(); ++s)
+	{
+		bounded[s] = GetSceneReach(stages[s], textures, width, height, plans[s].reachAcross, plans[s].reachDown);
+		plans[s].cost = EstimateShadeCost(stages[s]);
+		chainCost += plans[s].cost + PassCost;
+	}
+
+	//Stages join the group before when that is estimated to save a good share of running the chain unfused - so a cheap stage
+	//whose pass is little of the whole, such as a copy after a blur, keeps its own pass. Stages that may read the scene
+	//anywhere need the whole of the one before's result, so always start a group
+	std::vector<ChainGroup> groups;
+	double groupCost = 0.0;
+	for (size_t s = 0; s < stages.size(); ++s)
+	{
+		if (s > 0 && fuse && bounded[s])
+		{
+			ChainGroup joined = groups.back();
+			joined.end = s + 1;
+			const double together = PlanChainGroup(joined, plans);
+			if (groupCost + plans[s].cost + PassCost - together >= chainCost * MinFusionSaving)
+			{
+				groups.back() = std::move(joined);
+				groupCost = together;
+				continue;
+			}
+		}
+		groups.push_back({ s, s + 1, {}, {}, 0, 0, 0, 0 });
+		groupCost = PlanChainGroup(groups.back(), plans);
+	}
+
+	CPUPostProcessChainStats chainStats;
+#if FLOAT4_SIMD
+	if (useSIMD) RunChain<SSEFloat4>(stages, groups, textures, target, threads, chainStats);
+	else         RunChain<ScalarFloat4>(stages, groups, textures, target, threads, chainStats);
+#else
+	(void)useSIMD;
+	RunChain<ScalarFloat4>(stages, groups, textures, target, threads, chainStats);
+#endif
+	if (stats) *stats = chainStats;
+	return true;
+}
+
+//Convert every mip of an image to RGBA32F, with the values a shader would read from it
+bool ConvertToRGBA32F(const CImage& source, CImage& destination, CThreadPool* threads)
+{
+	if (IsBlockCompressed(source.GetFormat()))
+	{
+		CImage decompressed;
+		return DecompressBC(source, decompressed, threads) && ConvertToRGBA32F(decompressed, destination, threads);
+	}
+
+	const ImageFormat format = source.GetFormat();
+	if (format != ImageFormat::R8 && format != ImageFormat::RG8 && format != ImageFormat::RGBA8 && format != ImageFormat::BGRA8 && format != ImageFormat::RGBA32F) return false;
+	if (&source == &destination) return format == ImageFormat::RGBA32F;
+	if (!destination.Create(ImageFormat::RGBA32F, source.GetWidth(), source.GetHeight(), source.GetMipCount())) return false;
+
+	const uint32_t bytes = GetFormatBytes(format);
+	for (uint32_t mip = 0; mip < source.GetMipCount(); ++mip)
+	{
+		const ImageMip& layout = source.GetMip(mip);
+		if (format == ImageFormat::RGBA32F)
+		{
+			std::copy(source.GetData(mip), source.GetData(mip) + layout.size, destination.GetData(mip));
+			continue;
+		}
+		ParallelFor(threads, layout.height, [&](uint32_t first, uint32_t end)
+		{
+			for (uint32_t y = first; y < end; ++y)
+			{
+				const uint8_t* in = source.GetRow(mip, y);
+				float* out = reinterpret_cast<float*>(destination.GetRow(mip, y));
+				for (uint32_t x = 0; x < layout.width; ++x, in += bytes, out += 4)
+				{
+					switch (format)
+					{
+					case ImageFormat::R8:    out[0] = in[0] / 255.0f;  out[1] = 0.0f;            out[2] = 0.0f;            out[3] = 1.0f;            break;
+					case ImageFormat::RG8:   out[0] = in[0] / 255.0f;  out[1] = in[1] / 255.0f;  out[2] = 0.0f;            out[3] = 1.0f;            break;
+					case ImageFormat::BGRA8: out[0] = in[2] / 255.0f;  out[1] = in[1] / 255.0f;  out[2] = in[0] / 255.0f;  out[3] = in[3] / 255.0f;  break;
+					default:                 out[0] = in[0] / 255.0f;  out[1] = in[1] / 255.0f;  out[2] = in[2] / 255.0f;  out[3] = in[3] / 255.0f;  break;
+					}
+				}
+			}
+		});
+	}
+	return true;
+}
@@ -0,0 +1,115 @@
+//--------------------------------------------------------------------------------------
+// Running the post-processes on the CPU
+//--------------------------------------------------------------------------------------
+// Each post-process pixel shader has a C++ copy here that runs over RGBA32F images, taking the
+// same PostProcessingConstants as the GPU, so the effects can be run, timed and checked against
+// the shaders on machines without Direct3D.
+#pragma once
+#include "CImage.h"
+#include "project/PostProcessingConstants.h"
+
+#include <vector>
+
+class CThreadPool;
+
+//Effects that can be run, one for each post-process pixel shader
+enum class CPUPostProcess
+{
+	Copy,
+	VerticalColourGradient,
+	HorizontalBlur,
+	VerticalBlur,
+	Fisheye,
+	GreyNoise,
+	Distort,
+	Saturation,
+	Underwater,
+	Pixelation,
+	Vignette,
+};
+const CPUPostProcess AllCPUPostProcesses[] =
+{
+	CPUPostProcess::Copy, CPUPostProcess::VerticalColourGradient, CPUPostProcess::HorizontalBlur, CPUPostProcess::VerticalBlur,
+	CPUPostProcess::Fisheye, CPUPostProcess::GreyNoise, CPUPostProcess::Distort, CPUPostProcess::Saturation,
+	CPUPostProcess::Underwater, CPUPostProcess::Pixelation, CPUPostProcess::Vignette,
+};
+
+//Return the name of an effect's pixel shader, e.g. "Fisheye"
+const char* GetPostProcessName(CPUPostProcess effect);
+
+//Textures bound to the post-process, all RGBA32F (see ConvertToRGBA32F). Only those the effect samples are needed
+struct CPUPostProcessTextures
+{
+	const CImage* scene   = nullptr; // t0, the frame being processed - only its top mip is read
+	const CImage* noise   = nullptr; // t1, the grey noise map, or the mask atlas
+	const CImage* mask    = nullptr; // t2, the cut-out mask, or the mask atlas
+	const CImage* distort = nullptr; // t3, the distortion map
+	const CImage* remap   = nullptr; // The effect's distortion baked by BakeCPUPostProcessRemap, RG32F, read in its place if set
+};
+
+//Run a post-process over the area of the target given by the constants, using the pool's workers if one is given. The target
+//is RGBA32F, typically of the scene's size. Textures are sampled as the samplers in State.cpp do: the scene point sampled and
+//clamped (bilinearly for the blurs), the others trilinearly with wrapping. Discarded pixels are left as they were and blending
+//is left to the caller. Set useSIMD to false to force the scalar code, which gives identical results. Returns false if the
+//target or a texture the effect needs is missing or not RGBA32F
+bool RunCPUPostProcess(CPUPostProcess effect, const PostProcessingConstants& constants, const CPUPostProcessTextures& textures,
+                       CImage& target, CThreadPool* threads = nullptr, bool useSIMD = true);
+
+//Run a post-process over the polygon given by the four points of polygon2DPoints in the constants, in clip space, as the
+//polygon vertex shader draws them. It is rasterized as the GPU does - two triangles clipped to the depth range, snapped to
+//1/256 of a pixel and filled by the top-left rule, so their shared edge is drawn once - with the area uv interpolated in
+//perspective. Returns false as RunCPUPostProcess
+bool RunCPUPostProcessPolygon(CPUPostProcess effect, const PostProcessingConstants& constants, const CPUPostProcessTextures& textures,
+                              CImage& target, CThreadPool* threads = nullptr, bool useSIMD = true);
+
+//True for the effects whose distortion can be baked into a uv offset map: Fisheye, Underwater and Distort
+bool HasCPUPostProcessRemap(CPUPostProcess effect);
+
+//Bake the uv offsets of an effect's distortion over the area of a target of the given size, as the constants give it, into an
+//RG32F map for CPUPostProcessTextures::remap, using the pool's workers if one is given. Drawing then reads each pixel's offset
+//with one bilinear fetch rather than working it out again. Rebake when the settings change - Underwater's phase changes every
+//frame, but its map is a single row. Distort needs the distortion map, and its offsets are left unscaled by distortLevel so
+//its slider needs no rebake. The scene also uploads the fisheye's and the haze's maps for Fisheye_ps and Underwater_ps to read.
+//Returns false for other effects
+bool BakeCPUPostProcessRemap(CPUPostProcess effect, const PostProcessingConstants& constants, const CPUPostProcessTextures& textures,
+                             uint32_t width, uint32_t height, CImage& map, CThreadPool* threads = nullptr);
+
+//Pixelate the top mip of an RGBA32F scene over the whole of the target, created to match unless it is the scene, by averaging
+//the pixels of each of Pixelation_ps's blocks (PixelWidth by PixelHeight of them across the scene) and filling the block with the
+//green for the average, using the pool's workers if one is given. Unlike the shader's single sample a block, the average barely
+//changes as the view moves. Set useSIMD to false to force the scalar code, which gives identical results. Returns false if the
+//scene is not RGBA32F
+bool RunCPUPixelationAreaAverage(const PostProcessingConstants& constants, const CImage& scene, CImage& target,
+                                 CThreadPool* threads = nullptr, bool useSIMD = true);
+
+//One effect of a chain, with the settings it is drawn with
+struct CPUPostProcessStage
+{
+	CPUPostProcess          effect;
+	PostProcessingConstants constants;
+};
+
+//What running a chain took
+struct CPUPostProcessChainStats
+{
+	uint32_t passes       = 0; // Passes through full-size images - one for each effect unfused, one for each group fused
+	uint32_t tileSize     = 0; // Width and height of the tiles of the last pass
+	size_t   imageBytes   = 0; // Bytes read from and written to full-size images, counting each pixel a tile reads once
+	size_t   scratchBytes = 0; // Most scratch a worker uses for the results of a tile
+	size_t   shadedPixels = 0; // Pixels shaded by every effect, including the halos shaded again for neighbouring tiles
+};
+
+//Run a chain of effects over textures.scene into the target, which is made RGBA32F of the scene's size and must not be the
+//scene. Each effect reads the result of the one before as its scene and is drawn over a copy of it, so pixels outside its
+//area or discarded pass through. The remap, baked for a single effect, is not used. Set fuse to run the effects a tile at a
+//time, each over the tile grown by the halo of pixels the effects after it read, rather than each over a full-size image,
+//which gives identical results. Effects are only fused where that is estimated to save a good share of the work, so a cheap
+//effect after a costly one keeps its own pass. Effects that may read anywhere, such as Fisheye, start a new group from a
+//full-size image.
+//Returns false if the target is the scene or a texture an effect needs is missing
+bool RunCPUPostProcessChain(const std::vector<CPUPostProcessStage>& stages, const CPUPostProcessTextures& textures, CImage& target,
+                            CThreadPool* threads = nullptr, bool useSIMD = true, bool fuse = true, CPUPostProcessChainStats* stats = nullptr);
+
+//Convert every mip of an image to RGBA32F, with the values a shader would read from it: 0->1 for 8-bit channels, and 0 for
+//missing colour channels and 1 for missing alpha. Block compressed images are decompressed first
+bool ConvertToRGBA32F(const CImage& source, CImage& destination, CThreadPool* threads = nullptr);
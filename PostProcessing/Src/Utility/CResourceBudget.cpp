@@ -0,0 +1,192 @@
+//--------------------------------------------------------------------------------------
+// Memory budget for loaded resources with least-recently-used eviction
+//--------------------------------------------------------------------------------------
+
+#include "CResourceBudget.h"
+
+//Create a budget using the given allocator to evict and reload resources
+CResourceBudget::CResourceBudget(IResourceAllocator* allocator, uint64_t budgetBytes)
+	: m_Allocator(allocator)
+{
+	m_Stats.budgetBytes = budgetBytes;
+}
+
+//Start tracking a resource that is being loaded
+CResourceBudget::EntryId CResourceBudget::Add(uint32_t key)
+{
+	Entry entry;
+	entry.key = key;
+
+	//Reuse a removed entry, so tracking short lived resources does not grow the list
+	if (!m_FreeEntries.empty())
+	{
+		EntryId id = m_FreeEntries.back();
+		m_FreeEntries.pop_back();
+		m_Entries[id] = entry;
+		return id;
+	}
+	m_Entries.push_back(entry);
+	return static_cast<EntryId>(m_Entries.size() - 1);
+}
+
+//Record that a resource has been (re)loaded and how much memory it uses
+void CResourceBudget::SetResident(EntryId id, const ResourceBytes& bytes)
+{
+	Entry& entry = m_Entries[id];
+
+	//Replacing a resident resource, e.g. loading the same ID again
+	if (entry.state == State::Resident)
+	{
+		RemoveBytes(entry.bytes);
+		Unlink(id);
+		--m_Stats.resident;
+	}
+	if (entry.reloading) ++m_Stats.reloads;
+
+	entry.state = State::Resident;
+	entry.reloading = false;
+	entry.bytes = bytes;
+	AddBytes(bytes);
+	LinkAtHead(id);
+	++m_Stats.resident;
+}
+
+//Record that a resource could not be loaded
+void CResourceBudget::SetFailed(EntryId id)
+{
+	Entry& entry = m_Entries[id];
+	if (entry.state == State::Resident)
+	{
+		RemoveBytes(entry.bytes);
+		Unlink(id);
+		--m_Stats.resident;
+	}
+	entry.state = State::Failed;
+	entry.reloading = false;
+	entry.bytes = ResourceBytes();
+}
+
+//Stop tracking a resource that has been freed by its owner
+void CResourceBudget::Remove(EntryId id)
+{
+	if (m_Entries[id].state == State::Removed) return;
+
+	SetFailed(id);
+	m_Entries[id].state = State::Removed;
+	m_Entries[id].refCount = 0;
+	m_FreeEntries.push_back(id);
+}
+
+//Add a reference
+void CResourceBudget::AddRef(EntryId id)
+{
+	++m_Entries[id].refCount;
+}
+
+//Remove a reference. The resource stays in memory until the budget needs the space
+void CResourceBudget::Release(EntryId id)
+{
+	if (m_Entries[id].refCount > 0) --m_Entries[id].refCount;
+}
+
+//Mark a resource as used now, requesting a reload if it has been evicted
+bool CResourceBudget::Use(EntryId id)
+{
+	Entry& entry = m_Entries[id];
+	if (entry.state == State::Resident)
+	{
+		//Move to the front of the list, unless it is already there
+		if (m_Head != id)
+		{
+			Unlink(id);
+			LinkAtHead(id);
+		}
+		return true;
+	}
+
+	if (entry.state == State::Evicted)
+	{
+		entry.state = State::Loading;
+		entry.reloading = true;
+		m_Allocator->Reload(entry.key); // May call SetResident before returning
+		return m_Entries[id].state == State::Resident;
+	}
+
+	return false;
+}
+
+//Evict unreferenced resources, least recently used first, until the total is within the budget
+void CResourceBudget::Enforce()
+{
+	if (m_Stats.budgetBytes == 0) return;
+
+	EntryId id = m_Tail;
+	while (id != InvalidEntry && m_Stats.residentBytes.Total() > m_Stats.budgetBytes)
+	{
+		EntryId prev = m_Entries[id].prev;
+		if (m_Entries[id].refCount == 0) Evict(id);
+		id = prev;
+	}
+}
+
+//Evict a resource straight away if it is in memory and has no references
+bool CResourceBudget::EvictIfUnreferenced(EntryId id)
+{
+	if (m_Entries[id].state != State::Resident || m_Entries[id].refCount > 0) return false;
+	Evict(id);
+	return true;
+}
+
+//Free an entry's memory through the allocator and update the totals
+void CResourceBudget::Evict(EntryId id)
+{
+	Entry& entry = m_Entries[id];
+	m_Allocator->Evict(entry.key);
+
+	RemoveBytes(entry.bytes);
+	Unlink(id);
+	entry.state = State::Evicted;
+	entry.bytes = ResourceBytes();
+
+	--m_Stats.resident;
+	++m_Stats.evictions;
+}
+
+//Add an entry to the front (most recently used end) of the list
+void CResourceBudget::LinkAtHead(EntryId id)
+{
+	Entry& entry = m_Entries[id];
+	entry.prev = InvalidEntry;
+	entry.next = m_Head;
+	if (m_Head != InvalidEntry) m_Entries[m_Head].prev = id;
+	m_Head = id;
+	if (m_Tail == InvalidEntry) m_Tail = id;
+}
+
+//Remove an entry from the list
+void CResourceBudget::Unlink(EntryId id)
+{
+	Entry& entry = m_Entries[id];
+	if (entry.prev != InvalidEntry) m_Entries[entry.prev].next = entry.next;
+	else                            m_Head = entry.next;
+	if (entry.next != InvalidEntry) m_Entries[entry.next].prev = entry.prev;
+	else                            m_Tail = entry.prev;
+	entry.prev = entry.next = InvalidEntry;
+}
+
+void CResourceBudget::AddBytes(const ResourceBytes& bytes)
+{
+	for (int i = 0; i < static_cast<int>(ResourceMemoryType::Count); ++i)
+	{
+		m_Stats.residentBytes.bytes[i] += bytes.bytes[i];
+	}
+	if (m_Stats.residentBytes.Total() > m_Stats.peakBytes) m_Stats.peakBytes = m_Stats.residentBytes.Total();
+}
+
+void CResourceBudget::RemoveBytes(const ResourceBytes& bytes)
+{
+	for (int i = 0; i < static_cast<int>(ResourceMemoryType::Count); ++i)
+	{
+		m_Stats.residentBytes.bytes[i] -= bytes.bytes[i];
+	}
+}
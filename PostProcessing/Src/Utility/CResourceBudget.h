@@ -0,0 +1,170 @@
+//--------------------------------------------------------------------------------------
+// Memory budget for loaded resources with least-recently-used eviction
+//--------------------------------------------------------------------------------------
+// Keeps a reference count, a size in bytes (split by the kind of GPU memory) and a load state
+// for every resource it is told about. Resident resources sit in a list ordered by when they
+// were last used. When the total goes over the budget, resources nobody holds a reference to
+// are evicted starting from the least recently used. Using an evicted resource asks for it to
+// be reloaded.
+// The budget never touches the device itself - freeing and reloading is done through the
+// IResourceAllocator it is given - so the policy can be driven by a mock allocator on the CPU.
+#pragma once
+#include <cstdint>
+#include <vector>
+
+//Kinds of memory that are accounted for separately
+enum class ResourceMemoryType
+{
+	Texture,
+	VertexBuffer,
+	IndexBuffer,
+	RenderTarget,
+	Count
+};
+
+//Size of a resource in each kind of memory
+struct ResourceBytes
+{
+	uint64_t bytes[static_cast<int>(ResourceMemoryType::Count)] = {};
+
+	uint64_t& operator[](ResourceMemoryType type) { return bytes[static_cast<int>(type)]; }
+	uint64_t  operator[](ResourceMemoryType type) const { return bytes[static_cast<int>(type)]; }
+
+	uint64_t Total() const
+	{
+		uint64_t total = 0;
+		for (uint64_t b : bytes) total += b;
+		return total;
+	}
+};
+
+//Interface used by the budget to free and recreate resources
+class IResourceAllocator
+{
+public:
+	virtual ~IResourceAllocator() = default;
+
+	//Free the memory used by the resource with the given key. It will not be used again until reloaded
+	virtual void Evict(uint32_t key) = 0;
+
+	//Start recreating the resource with the given key. Call CResourceBudget::SetResident when it is ready
+	//(this may be before returning), or SetFailed if it cannot be loaded
+	virtual void Reload(uint32_t key) = 0;
+};
+
+//Counters describing the state of the budget
+struct ResourceBudgetStats
+{
+	ResourceBytes residentBytes;    // Bytes currently in use, by kind
+	uint64_t      budgetBytes = 0;  // Budget, 0 for unlimited
+	uint64_t      peakBytes   = 0;  // Highest total seen
+	uint32_t      resident    = 0;  // Number of resources currently in memory
+	uint32_t      evictions   = 0;  // Total number of resources evicted
+	uint32_t      reloads     = 0;  // Total number of resources reloaded after eviction
+};
+
+class CResourceBudget
+{
+//----------------------//
+// Construction / Usage	//
+//----------------------//
+public:
+	using EntryId = uint32_t;
+	static const EntryId InvalidEntry = 0xffffffff;
+
+	//Create a budget using the given allocator to evict and reload resources. A budget of 0 is unlimited
+	CResourceBudget(IResourceAllocator* allocator, uint64_t budgetBytes = 0);
+
+	//Start tracking a resource that is being loaded. The key is passed back to the allocator.
+	//The resource starts with no references. Reuses the ID of an entry that has been removed, if there is one
+	EntryId Add(uint32_t key);
+
+	//Record that a resource has been (re)loaded and how much memory it uses. It becomes the most recently used
+	void SetResident(EntryId entry, const ResourceBytes& bytes);
+
+	//Record that a resource could not be loaded. It will not be reloaded on use
+	void SetFailed(EntryId entry);
+
+	//Stop tracking a resource that has been freed by its owner. Its memory is no longer counted, and its ID may be given
+	//to the next resource added
+	void Remove(EntryId entry);
+
+	//Add or remove a reference. Resources with references are never evicted
+	void AddRef(EntryId entry);
+	void Release(EntryId entry);
+
+	//Mark a resource as used now. If it has been evicted a reload is requested.
+	//Returns true if the resource is in memory
+	bool Use(EntryId entry);
+
+	//Evict unreferenced resources, least recently used first, until the total is within the budget
+	void Enforce();
+
+	//Evict a resource straight away if it is in memory and has no references. Returns true if it was evicted
+	bool EvictIfUnreferenced(EntryId entry);
+
+	//Change the budget. Takes effect at the next Enforce()
+	void SetBudget(uint64_t budgetBytes) { m_Stats.budgetBytes = budgetBytes; }
+
+	//-------------------------------------
+	// Data access
+	//-------------------------------------
+
+	uint32_t GetRefCount(EntryId entry) const { return m_Entries[entry].refCount; }
+	bool     IsResident(EntryId entry)  const { return m_Entries[entry].state == State::Resident; }
+	uint32_t GetKey(EntryId entry)      const { return m_Entries[entry].key; }
+
+	const ResourceBytes& GetBytes(EntryId entry) const { return m_Entries[entry].bytes; }
+
+	//Number of entries held, including removed ones waiting to be reused
+	uint32_t GetEntryCount() const { return static_cast<uint32_t>(m_Entries.size()); }
+
+	const ResourceBudgetStats& GetStats() const { return m_Stats; }
+
+//--------------------------//
+// Private helper functions	//
+//--------------------------//
+private:
+	enum class State
+	{
+		Loading,
+		Resident,
+		Evicted,
+		Failed,
+		Removed
+	};
+
+	struct Entry
+	{
+		uint32_t      key = 0;
+		State         state = State::Loading;
+		uint32_t      refCount = 0;
+		bool          reloading = false; // Loading again after an eviction
+		ResourceBytes bytes;
+
+		//Links in the least-recently-used list, only resident entries are in the list
+		EntryId       prev = InvalidEntry;
+		EntryId       next = InvalidEntry;
+	};
+
+	//Free an entry's memory through the allocator and update the totals
+	void Evict(EntryId entry);
+
+	//Least-recently-used list operations. The head is the most recently used
+	void LinkAtHead(EntryId entry);
+	void Unlink(EntryId entry);
+
+	void AddBytes(const ResourceBytes& bytes);
+	void RemoveBytes(const ResourceBytes& bytes);
+
+//-------------//
+// Member data //
+//-------------//
+private:
+	IResourceAllocator* m_Allocator;
+	std::vector<Entry>  m_Entries;
+	std::vector<EntryId> m_FreeEntries; // Removed entries, reused by Add
+	EntryId             m_Head = InvalidEntry;
+	EntryId             m_Tail = InvalidEntry;
+	ResourceBudgetStats m_Stats;
+};
@@ -1,109 +1,756 @@
 #include "CResourceManager.h"
+#include "ImageDecoders.h"
+#include "MipGeneration.h"
+
+#include <atomic>
+#include <thread>
+
+const char* const CResourceManager::AssetPackFile = "Assets.pak";
 
 //Constructor
 CResourceManager::CResourceManager()
+	: fileCache(&pack), budget(this), streamer(this), finishedLoads(256)
 {
+	//Without a pack every file is loaded loose
+	pack.Open(AssetPackFile);
+
+	//Slot 0 of each registry holds the default resource, which is always referenced so it is never evicted
+	textureSources.push_back({ "", budget.Add(0), 0 });
+	meshSources.push_back({ "Data/Teapot.x", false, budget.Add(MeshKey | 0), 0 });
+	budget.AddRef(textureSources[0].entry);
+	budget.AddRef(meshSources[0].entry);
 }
 
-//Function to load a texture into the textureMap 
-void CResourceManager::loadTexture(const wchar_t* uniqueID, std::string filename)
+//Function to start loading a texture in the background
+TextureHandle CResourceManager::loadTexture(const wchar_t* uniqueID, std::string filename, bool streamed)
 {
-	HRESULT result;
+	//The default texture needs the device so is created with the first texture rather than in the constructor
+	if (!textures.GetSlot(TextureHandle())) createDefaultTexture();
+	startWorkers();
 
-	// Set the texture to the default one if this filename is not valid
-	if (!doesFileExist(filename))
+	//The ID is interned straight away so the handle can be used (returning the default texture) while the texture loads
+	uint32_t existingSlots = textures.Size();
+	TextureHandle handle = textures.Intern(uniqueID);
+
+	//An ID that has been seen before just gains a reference
+	if (handle.index < existingSlots)
 	{
-		filename = "../Media/DefaultDiffuse.png";
+		acquireTexture(handle);
+		return handle;
 	}
 
-	std::string dds = ".dds"; //check the filename extension (case insensitive)
-	if (filename.size() >= 4 &&
-		std::equal(dds.rbegin(), dds.rend(), filename.rbegin(), [](unsigned char a, unsigned char b) { return std::tolower(a) == std::tolower(b); }))
+	//A file already loaded under another ID shares its texture, without touching the disk
+	std::string path = CanonicalPath(filename);
+	auto loaded = texturePaths.find(path);
+	if (loaded != texturePaths.end())
 	{
-		result = DirectX::CreateDDSTextureFromFile(gD3DDevice, CA2CT(filename.c_str()), NULL, &texture);
+		textureSources.push_back({ filename, CResourceBudget::InvalidEntry, loaded->second });
+		duplicateTextures.push_back(handle.index);
+		++pathDuplicates;
+		acquireTexture(handle);
+		return handle;
 	}
-	else
+	texturePaths[path] = handle.index;
+
+	textureSources.push_back({ filename, budget.Add(handle.index), handle.index, streamed });
+	budget.AddRef(textureSources[handle.index].entry);
+	startTextureLoad(handle.index);
+	return handle;
+}
+
+//Function to start loading a mesh in the background
+MeshHandle CResourceManager::loadMesh(const wchar_t* uniqueID, std::string &filename, bool requireTangents)
+{
+	//Models need a mesh to be created with, so the default mesh is loaded immediately. Throws if it cannot be loaded
+	if (!meshes.GetSlot(MeshHandle()))
+	{
+		Mesh* defaultMesh = new Mesh(meshSources[0].fileName, false, &fileCache);
+		meshes.Set(MeshHandle(), defaultMesh);
+		budget.SetResident(meshSources[0].entry, getMeshBytes(defaultMesh));
+	}
+	startWorkers();
+
+	uint32_t existingSlots = meshes.Size();
+	MeshHandle handle = meshes.Intern(uniqueID);
+
+	//An ID that has been seen before just gains a reference
+	if (handle.index < existingSlots)
+	{
+		acquireMesh(handle);
+		return handle;
+	}
+
+	//A file already loaded under another ID shares its mesh, without touching the disk
+	std::string path = CanonicalPath(filename) + (requireTangents ? "|tangents" : "");
+	auto loaded = meshPaths.find(path);
+	if (loaded != meshPaths.end())
 	{
-		result = DirectX::CreateWICTextureFromFile(gD3DDevice, gD3DContext, CA2CT(filename.c_str()), NULL, &texture);
+		meshSources.push_back({ filename, requireTangents, CResourceBudget::InvalidEntry, loaded->second });
+		duplicateMeshes.push_back(handle.index);
+		++pathDuplicates;
+		acquireMesh(handle);
+		return handle;
 	}
+	meshPaths[path] = handle.index;
+
+	meshSources.push_back({ filename, requireTangents, budget.Add(MeshKey | handle.index), handle.index });
+	budget.AddRef(meshSources[handle.index].entry);
+	startMeshLoad(handle.index);
+	return handle;
+}
+
+//Functions to add and remove references. Duplicates reference the resource they share
+void CResourceManager::acquireTexture(TextureHandle handle)
+{
+	budget.AddRef(textureSources[resolveTexture(handle).index].entry);
+}
 
-	textureMap.insert(std::make_pair(const_cast<wchar_t*>(uniqueID), texture));
+void CResourceManager::releaseTexture(TextureHandle handle)
+{
+	//The default texture keeps its own reference
+	handle = resolveTexture(handle);
+	if (handle.index > 0) budget.Release(textureSources[handle.index].entry);
+}
+
+void CResourceManager::acquireMesh(MeshHandle handle)
+{
+	budget.AddRef(meshSources[resolveMesh(handle).index].entry);
+}
+
+void CResourceManager::releaseMesh(MeshHandle handle)
+{
+	handle = resolveMesh(handle);
+	if (handle.index > 0) budget.Release(meshSources[handle.index].entry);
+}
+
+//Function to free a texture straight away if nothing holds a reference to it. The default texture is never freed
+bool CResourceManager::unloadTexture(TextureHandle handle)
+{
+	handle = resolveTexture(handle);
+	return handle.index > 0 && budget.EvictIfUnreferenced(textureSources[handle.index].entry);
+}
 
+//Function to return the memory used by a texture
+uint64_t CResourceManager::getTextureMemory(TextureHandle handle) const
+{
+	handle = resolveTexture(handle);
+	return budget.GetBytes(textureSources[handle.index].entry).Total();
+}
+
+//Function to ask for a streamed texture to be sharp at the given size on screen. Duplicates ask for the texture they share
+void CResourceManager::requestTextureSize(TextureHandle handle, float screenPixels)
+{
+	handle = resolveTexture(handle);
+	CTextureStreamer::EntryId entry = textureSources[handle.index].streamEntry;
+	if (entry != CTextureStreamer::InvalidEntry) streamer.Request(entry, screenPixels);
 }
 
-//Function to load a texture into the meshMap 
-void CResourceManager::loadMesh(const wchar_t* uniqueID, std::string &filename, bool requireTangents)
+//Function to return how many IDs share another's resource and the memory that saves
+ResourceDedupStats CResourceManager::getDedupStats() const
 {
-	// Set the texture to the default one if this filename is not valid
-	if (!doesFileExist(filename))
+	ResourceDedupStats stats;
+	stats.pathDuplicates = pathDuplicates;
+	stats.contentDuplicates = static_cast<unsigned int>(duplicateTextures.size() + duplicateMeshes.size()) - pathDuplicates;
+
+	//Each duplicate would hold a copy of what its original currently has in memory
+	for (uint32_t index : duplicateTextures)
 	{
-		filename = "Data/Teapot.x";
+		stats.bytesSaved += budget.GetBytes(textureSources[resolveSlot(textureSources, index)].entry).Total();
 	}
-	//Check if the Model requires tangents and if yes then create a new mesh with tangents
-	//otherwise create a new mesh without tangents 
-	if(requireTangents) mesh = new Mesh(filename, true);
-	else mesh = new Mesh(filename);
+	for (uint32_t index : duplicateMeshes)
+	{
+		stats.bytesSaved += budget.GetBytes(meshSources[resolveSlot(meshSources, index)].entry).Total();
+	}
+	return stats;
+}
 
-	//Add the new mesh to the meshMap paired with the unique ID Created
-	meshMap.insert(std::make_pair(const_cast<wchar_t*>(uniqueID), mesh));
+//Function to read a small data file through the file cache
+bool CResourceManager::readFile(const std::string& fileName, std::string& contents)
+{
+	std::shared_ptr<const CachedFile> file = fileCache.Open(fileName);
+	if (!file) return false;
+
+	contents.assign(reinterpret_cast<const char*>(file->contents.data), file->contents.size);
+	return true;
 }
 
-//Function to return the Texture at the given ID in the textureMap
-ID3D11ShaderResourceView* CResourceManager::getTexture(const wchar_t* uid)
+//Function to count memory not owned by the manager against the budget
+CResourceBudget::EntryId CResourceManager::trackMemory(ResourceMemoryType type, uint64_t bytes)
 {
-	//Search through the textureMap for the requested texture
-	//if no texture found then return the default Texture
-	if (textureMap.find(const_cast<wchar_t*>(uid)) != textureMap.end())
+	ResourceBytes resourceBytes;
+	resourceBytes[type] = bytes;
+
+	CResourceBudget::EntryId entry = budget.Add(ExternalKey);
+	budget.AddRef(entry);
+	budget.SetResident(entry, resourceBytes);
+	return entry;
+}
+
+//Function to stop counting memory added with trackMemory
+void CResourceManager::untrackMemory(CResourceBudget::EntryId entry)
+{
+	budget.Remove(entry);
+}
+
+//Helper Function to queue the background work to load the texture in a slot
+void CResourceManager::startTextureLoad(uint32_t index)
+{
+	++loadStats.requested;
+
+	//Read and hash the file on an I/O thread, then pass it to a decode thread to create the texture
+	std::string sourceName = textureSources[index].fileName;
+	bool streamed = textureSources[index].streamed;
+	ioThreads->Submit([this, index, sourceName, streamed]()
+	{
+		std::string filename = findCompressedTexture(sourceName);
+		std::shared_ptr<const CachedFile> file = fileCache.Open(filename);
+		if (!file)
+		{
+			LoadResult result;
+			result.index = index;
+			result.error = "Cannot read texture " + filename;
+			pushResult(std::move(result));
+			return;
+		}
+
+		//Contents already loaded by another slot are shared rather than decoded again
+		uint32_t original = claimContent(textureContents, file->hash, file->contents.size, index);
+		if (original != index)
+		{
+			LoadResult result;
+			result.index = index;
+			result.isDuplicate = true;
+			result.original = original;
+			result.fromPack = file->fromPack;
+			pushResult(std::move(result));
+			return;
+		}
+
+		//The decode task keeps the file's contents alive
+		decodeThreads->Submit([this, index, filename, file, streamed]()
+		{
+			LoadResult result = decodeTexture(index, filename, file->contents, streamed);
+			result.fromPack = file->fromPack;
+			pushResult(std::move(result));
+		});
+	});
+}
+
+//Helper Function to queue the background work to load the mesh in a slot
+void CResourceManager::startMeshLoad(uint32_t index)
+{
+	++loadStats.requested;
+
+	//Meshes go straight to a decode thread. The file is opened here to check for duplicates, which keeps it in the cache
+	//while assimp reads it
+	std::string filename = meshSources[index].fileName;
+	bool requireTangents = meshSources[index].requireTangents;
+	decodeThreads->Submit([this, index, filename, requireTangents]()
 	{
-		// texture exists
-		texture = textureMap.at(const_cast<wchar_t*>(uid));
-		return texture;
+		LoadResult result;
+		result.isMesh = true;
+		result.index = index;
+
+		std::shared_ptr<const CachedFile> file = fileCache.Open(filename);
+		if (!file)
+		{
+			result.error = "Cannot find mesh " + filename;
+			pushResult(std::move(result));
+			return;
+		}
+		result.fromPack = file->fromPack;
+
+		//Contents already loaded by another slot are shared rather than imported again
+		result.original = claimContent(meshContents, requireTangents ? file->hash ^ TangentsHashSalt : file->hash, file->contents.size, index);
+		if (result.original != index)
+		{
+			result.isDuplicate = true;
+		}
+		else
+		{
+			//The mesh constructor reports errors with exceptions, which must not escape the worker thread
+			try
+			{
+				result.mesh = new Mesh(filename, requireTangents, &fileCache);
+			}
+			catch (std::exception& e)
+			{
+				result.error = e.what();
+			}
+		}
+		pushResult(std::move(result));
+	});
+}
+
+//Called by the budget to free an unreferenced resource. Its handle returns the default resource until reloaded
+void CResourceManager::Evict(uint32_t key)
+{
+	if (key & ExternalKey) return;
+
+	uint32_t index = key & IndexMask;
+	if (key & MeshKey)
+	{
+		MeshHandle handle;
+		handle.index = index;
+		delete meshes.GetSlot(handle);
+		meshes.Set(handle, nullptr);
 	}
 	else
 	{
-		return textureMap.at(L"default");
+		TextureHandle handle;
+		handle.index = index;
+		if (ID3D11ShaderResourceView* texture = textures.GetSlot(handle)) texture->Release();
+		textures.Set(handle, nullptr);
+		stopStreaming(index);
 	}
+	++evictedSinceUpdate;
 }
 
-//Function to return the Mesh at the given ID in the meshMap
-Mesh* CResourceManager::getMesh(const wchar_t* uid)
+//Called by the budget when an evicted resource is used again
+void CResourceManager::Reload(uint32_t key)
 {
-	//Search through the textureMap for the requested texture
-	//if no texture found then return the default Mesh
-	if (meshMap.find(const_cast<wchar_t*>(uid)) != meshMap.end())
+	if (key & ExternalKey) return;
+
+	uint32_t index = key & IndexMask;
+	if (key & MeshKey) startMeshLoad(index);
+	else               startTextureLoad(index);
+}
+
+//Called by the streamer to give a texture its next finer mip. Textures cannot gain mips, so a new one a level larger
+//replaces it. The coarser mips are copied across on the GPU and only the new mip is uploaded from the CPU
+bool CResourceManager::UploadMip(uint32_t key, uint32_t mip)
+{
+	TextureHandle handle;
+	handle.index = key;
+	TextureSource& source = textureSources[key];
+	ID3D11ShaderResourceView* previous = textures.GetSlot(handle);
+	if (!source.image || !previous) return false;
+
+	ID3D11ShaderResourceView* view = nullptr;
+	if (FAILED(createTexture(*source.image, mip, false, &view))) return false;
+
+	ID3D11Resource* from = nullptr;
+	ID3D11Resource* to = nullptr;
+	previous->GetResource(&from);
+	view->GetResource(&to);
+	for (uint32_t level = mip + 1; level < source.image->GetMipCount(); ++level)
 	{
-		// texture exists
-		mesh = meshMap.at(const_cast<wchar_t*>(uid));
-		return mesh;
+		gD3DContext->CopySubresourceRegion(to, level - mip, 0, 0, 0, from, level - mip - 1, nullptr);
+	}
+	gD3DContext->UpdateSubresource(to, 0, nullptr, source.image->GetData(mip), source.image->GetMip(mip).rowPitch, 0);
+	from->Release();
+	to->Release();
+
+	previous->Release();
+	textures.Set(handle, view);
+
+	ResourceBytes bytes;
+	bytes[ResourceMemoryType::Texture] = GetTextureMemoryUsage(view);
+	budget.SetResident(source.entry, bytes);
+
+	//The CPU copy is not needed once every mip is on the GPU
+	if (mip == 0) source.image.reset();
+	return true;
+}
+
+//Helper Function to stop streaming the texture in a slot and free its CPU copy
+void CResourceManager::stopStreaming(uint32_t index)
+{
+	TextureSource& source = textureSources[index];
+	if (source.streamEntry != CTextureStreamer::InvalidEntry) streamer.Remove(source.streamEntry);
+	source.streamEntry = CTextureStreamer::InvalidEntry;
+	source.image.reset();
+}
+
+//Function to swap in every resource that has finished loading since the last call
+unsigned int CResourceManager::update()
+{
+	unsigned int swapped = evictedSinceUpdate;
+	evictedSinceUpdate = 0;
+
+	bool finishedAny = false;
+	LoadResult result;
+	while (finishedLoads.Pop(result))
+	{
+		finishedAny = true;
+		if (result.fromPack) ++loadStats.fromPack;
+
+		if (result.isDuplicate)
+		{
+			//The slot never gets a resource of its own, its references move to the original
+			if (result.isMesh)
+			{
+				shareResource(meshSources, result.index, result.original);
+				duplicateMeshes.push_back(result.index);
+				++swapped; // Models using the handle need the original mesh
+			}
+			else
+			{
+				shareResource(textureSources, result.index, result.original);
+				duplicateTextures.push_back(result.index);
+			}
+			++loadStats.completed;
+		}
+		else if (!result.error.empty())
+		{
+			++loadStats.failed;
+			loadErrors.push_back(result.error);
+			budget.SetFailed(result.isMesh ? meshSources[result.index].entry : textureSources[result.index].entry);
+		}
+		else if (result.isMesh)
+		{
+			MeshHandle handle;
+			handle.index = result.index;
+
+			//Loading the same ID twice replaces the previous mesh
+			delete meshes.GetSlot(handle);
+			meshes.Set(handle, result.mesh);
+			budget.SetResident(meshSources[result.index].entry, getMeshBytes(result.mesh));
+			++loadStats.completed;
+			++swapped;
+		}
+		else
+		{
+			TextureHandle handle;
+			handle.index = result.index;
+
+			//Run the work recorded while the texture was created (e.g. mip generation) on the immediate context
+			if (result.commands)
+			{
+				gD3DContext->ExecuteCommandList(result.commands, TRUE);
+				result.commands->Release();
+			}
+
+			//Loading the same ID twice replaces the previous texture, which may still be streaming
+			if (ID3D11ShaderResourceView* previous = textures.GetSlot(handle)) previous->Release();
+			textures.Set(handle, result.texture);
+			stopStreaming(result.index);
+
+			ResourceBytes bytes;
+			bytes[ResourceMemoryType::Texture] = GetTextureMemoryUsage(result.texture);
+			budget.SetResident(textureSources[result.index].entry, bytes);
+
+			//A streamed texture has its smallest mips, the streamer uploads the rest as they are asked for
+			if (result.image)
+			{
+				std::vector<uint64_t> mipBytes;
+				for (uint32_t mip = 0; mip < result.image->GetMipCount(); ++mip) mipBytes.push_back(result.image->GetMip(mip).size);
+
+				TextureSource& source = textureSources[result.index];
+				source.streamEntry = streamer.Add(result.index, result.image->GetWidth(), result.image->GetHeight(), mipBytes, result.residentMip);
+				source.image = std::move(result.image);
+			}
+			++loadStats.completed;
+			++swapped;
+		}
+
+		float sinceFirstRequest = std::chrono::duration<float>(result.finished - firstRequest).count();
+		if (sinceFirstRequest > loadStats.totalLoadTime) loadStats.totalLoadTime = sinceFirstRequest;
+
+		result = LoadResult();
+	}
+
+	//Once everything has loaded, unmap the files the loaders were holding. Reloads map them again
+	if (finishedAny && !loadStats.isLoading()) fileCache.Trim();
+
+	//Upload the texture mips asked for since the last update, most needed first
+	streamer.Update(streamingBudget);
+
+	//Make room for what has just been loaded. Evicting here rather than as each load arrives means
+	//resources used this frame have already been marked as recently used
+	budget.Enforce();
+	swapped += evictedSinceUpdate;
+	evictedSinceUpdate = 0;
+
+	return swapped;
+}
+
+//Helper Function to record the contents of a file being loaded into a slot
+uint32_t CResourceManager::claimContent(std::unordered_map<uint64_t, ContentOwner>& owners, uint64_t hash, uint64_t size, uint32_t index)
+{
+	std::lock_guard<std::mutex> lock(contentMutex);
+
+	//The first slot to claim some contents owns them, including when it reloads them after eviction
+	auto owner = owners.emplace(hash, ContentOwner{ index, size }).first;
+	if (owner->second.size != size) return index; // Hash collision, load separately
+	return owner->second.index;
+}
+
+//Helper Function to return the DDS file made from an image by the asset tool's compress-media command if there is one,
+//otherwise the image itself
+std::string CResourceManager::findCompressedTexture(const std::string& fileName)
+{
+	size_t dot = fileName.find_last_of('.');
+	if (dot == std::string::npos) return fileName;
+
+	std::string extension = fileName.substr(dot);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	if (extension != ".png" && extension != ".jpg" && extension != ".jpeg") return fileName;
+
+	std::string compressed = fileName.substr(0, dot) + ".dds";
+	return fileCache.Exists(compressed) ? compressed : fileName;
+}
+
+//Helper Function to create a texture from a file already read into memory. Runs on a decode thread
+CResourceManager::LoadResult CResourceManager::decodeTexture(uint32_t index, const std::string& fileName, const AssetSpan& contents, bool streamed)
+{
+	LoadResult result;
+	result.index = index;
+	HRESULT hr;
+
+	if (streamed && decodeStreamedTexture(fileName, contents, &result)) return result;
+
+	std::string dds = ".dds"; //check the filename extension (case insensitive)
+	if (fileName.size() >= 4 &&
+		std::equal(dds.rbegin(), dds.rend(), fileName.rbegin(), [](unsigned char a, unsigned char b) { return std::tolower(a) == std::tolower(b); }))
+	{
+		//DDS files contain their own mips so only need the device, which is safe to use from any thread
+		hr = DirectX::CreateDDSTextureFromMemory(gD3DDevice, contents.data, contents.size, nullptr, &result.texture);
 	}
 	else
 	{
-		return meshMap.at(L"default");
+		//Other formats are decoded and given their mips on the CPU, filtered in linear space (see MipGeneration.h),
+		//so the texture is created complete from this thread
+		CImage image, mips;
+		std::string error;
+		if (DecodeImage(contents.data, contents.size, image, error) && GenerateMips(image, mips, ChooseMipOptions(fileName)))
+		{
+			hr = createTexture(mips, 0, true, &result.texture);
+		}
+		else
+		{
+			hr = decodeTextureWIC(contents, &result);
+		}
+	}
+
+	if (FAILED(hr))
+	{
+		discardResult(result);
+		result.error = "Cannot decode texture " + fileName;
+	}
+	return result;
+}
+
+//Helper Function to create the smallest mips of a streamed texture, keeping the image for the rest
+bool CResourceManager::decodeStreamedTexture(const std::string& fileName, const AssetSpan& contents, LoadResult* result)
+{
+	//DDS files bring their own mips, other images are given them as in decodeTexture
+	auto image = std::make_unique<CImage>();
+	CImage decoded;
+	std::string error;
+	if (!DecodeImage(contents.data, contents.size, decoded, error)) return false;
+	if (decoded.GetMipCount() > 1)                                   *image = std::move(decoded);
+	else if (!GenerateMips(decoded, *image, ChooseMipOptions(fileName))) return false;
+	if (getTextureFormat(image->GetFormat()) == DXGI_FORMAT_UNKNOWN) return false;
+
+	//Block compressed textures need every mip they are cut down to to be a whole number of blocks across.
+	//Textures no larger than the tail are not worth streaming
+	uint32_t tail = CTextureStreamer::GetTailMip(image->GetWidth(), image->GetHeight(), image->GetMipCount());
+	for (uint32_t mip = 1; mip <= tail && IsBlockCompressed(image->GetFormat()); ++mip)
+	{
+		if (image->GetMip(mip).width % 4 != 0 || image->GetMip(mip).height % 4 != 0) tail = mip - 1;
+	}
+	if (tail == 0) return false;
+
+	if (FAILED(createTexture(*image, tail, true, &result->texture))) return false;
+	result->image = std::move(image);
+	result->residentMip = tail;
+	return true;
+}
+
+//Helper Function to create a texture from a file the CPU decoders do not support, with WIC
+HRESULT CResourceManager::decodeTextureWIC(const AssetSpan& contents, LoadResult* result)
+{
+	//Mip generation by WIC needs a context. The immediate context belongs to the rendering thread,
+	//so record the work on a deferred context and let update() run it
+	ID3D11DeviceContext* deferredContext = nullptr;
+	if (FAILED(gD3DDevice->CreateDeferredContext(0, &deferredContext)))
+	{
+		return DirectX::CreateWICTextureFromMemory(gD3DDevice, contents.data, contents.size, nullptr, &result->texture);
+	}
+
+	HRESULT hr = DirectX::CreateWICTextureFromMemory(gD3DDevice, deferredContext, contents.data, contents.size, nullptr, &result->texture);
+	if (SUCCEEDED(hr) && FAILED(deferredContext->FinishCommandList(FALSE, &result->commands)))
+	{
+		result->commands = nullptr;
+	}
+	deferredContext->Release();
+	return hr;
+}
+
+//Helper Function to create a texture holding the mips of an image from firstMip on
+HRESULT CResourceManager::createTexture(const CImage& image, uint32_t firstMip, bool fill, ID3D11ShaderResourceView** view)
+{
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = image.GetMip(firstMip).width;
+	textureDesc.Height = image.GetMip(firstMip).height;
+	textureDesc.MipLevels = image.GetMipCount() - firstMip;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = getTextureFormat(image.GetFormat());
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = fill ? D3D11_USAGE_IMMUTABLE : D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	if (textureDesc.Format == DXGI_FORMAT_UNKNOWN) return E_INVALIDARG;
+
+	std::vector<D3D11_SUBRESOURCE_DATA> initData(textureDesc.MipLevels);
+	for (uint32_t mip = firstMip; mip < image.GetMipCount(); ++mip)
+	{
+		initData[mip - firstMip].pSysMem = image.GetData(mip);
+		initData[mip - firstMip].SysMemPitch = image.GetMip(mip).rowPitch;
+	}
+
+	ID3D11Texture2D* texture = nullptr;
+	HRESULT hr = gD3DDevice->CreateTexture2D(&textureDesc, fill ? initData.data() : nullptr, &texture);
+	if (FAILED(hr)) return hr;
+
+	hr = gD3DDevice->CreateShaderResourceView(texture, nullptr, view);
+	texture->Release(); // The view keeps its own reference
+	return hr;
+}
+
+//Helper Function to return the texture format holding an image format. The shaders read every texture as linear data
+DXGI_FORMAT CResourceManager::getTextureFormat(ImageFormat format)
+{
+	switch (format)
+	{
+	case ImageFormat::R8:    return DXGI_FORMAT_R8_UNORM;
+	case ImageFormat::RG8:   return DXGI_FORMAT_R8G8_UNORM;
+	case ImageFormat::RGBA8: return DXGI_FORMAT_R8G8B8A8_UNORM;
+	case ImageFormat::BGRA8: return DXGI_FORMAT_B8G8R8A8_UNORM;
+	case ImageFormat::BC1:   return DXGI_FORMAT_BC1_UNORM;
+	case ImageFormat::BC3:   return DXGI_FORMAT_BC3_UNORM;
+	case ImageFormat::BC4:   return DXGI_FORMAT_BC4_UNORM;
+	case ImageFormat::BC5:   return DXGI_FORMAT_BC5_UNORM;
+	case ImageFormat::BC7:   return DXGI_FORMAT_BC7_UNORM;
+	case ImageFormat::RGBA32F: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+	case ImageFormat::RG32F:   return DXGI_FORMAT_R32G32_FLOAT;
+	default:                 return DXGI_FORMAT_UNKNOWN;
 	}
 }
 
-//Helper Function to check whether the file given actually exists 
-bool CResourceManager::doesFileExist(std::string &fname)
+//Helper Function to create the plain white texture returned for textures that have not loaded
+bool CResourceManager::createDefaultTexture()
 {
-	//Checks if the string containing the FileName is viable
-	std::ifstream infile(fname);
-	return infile.good();
+	const uint32_t white = 0xffffffff;
+
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = 1;
+	textureDesc.Height = 1;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA initData = {};
+	initData.pSysMem = &white;
+	initData.SysMemPitch = sizeof(white);
+
+	ID3D11Texture2D* defaultTexture = nullptr;
+	if (FAILED(gD3DDevice->CreateTexture2D(&textureDesc, &initData, &defaultTexture))) return false;
+
+	ID3D11ShaderResourceView* defaultView = nullptr;
+	HRESULT result = gD3DDevice->CreateShaderResourceView(defaultTexture, nullptr, &defaultView);
+	defaultTexture->Release(); // The view keeps its own reference
+	if (FAILED(result)) return false;
+
+	textures.Set(TextureHandle(), defaultView);
+
+	ResourceBytes bytes;
+	bytes[ResourceMemoryType::Texture] = GetTextureMemoryUsage(defaultView);
+	budget.SetResident(textureSources[0].entry, bytes);
+	return true;
+}
+
+//Helper Function to create the worker threads the first time a load is requested
+void CResourceManager::startWorkers()
+{
+	if (ioThreads) return;
+
+	firstRequest = std::chrono::steady_clock::now();
+
+	//A couple of threads are enough to keep the disk busy
+	ioThreads = std::make_unique<CThreadPool>(2);
+
+	//The WIC texture loader uses COM, which must be initialised on each thread that uses it
+	decodeThreads = std::make_unique<CThreadPool>(CThreadPool::DefaultThreadCount(),
+		[]() { CoInitializeEx(nullptr, COINIT_MULTITHREADED); },
+		[]() { CoUninitialize(); });
+}
+
+//Helper Function to hand a finished load back to the rendering thread
+void CResourceManager::pushResult(LoadResult&& result)
+{
+	result.finished = std::chrono::steady_clock::now();
+
+	//If the queue is full wait for the rendering thread to drain it
+	while (!finishedLoads.Push(std::move(result)))
+	{
+		std::this_thread::yield();
+	}
+}
+
+//Helper Function to release the resources held by a load result that will not be used
+void CResourceManager::discardResult(LoadResult& result)
+{
+	if (result.texture)  result.texture->Release();
+	if (result.commands) result.commands->Release();
+	delete result.mesh;
+	result.image.reset();
+
+	result.texture = nullptr;
+	result.commands = nullptr;
+	result.mesh = nullptr;
+}
+
+//Helper Function to return the memory used by a mesh
+ResourceBytes CResourceManager::getMeshBytes(Mesh* mesh)
+{
+	ResourceBytes bytes;
+	bytes[ResourceMemoryType::VertexBuffer] = mesh->GetVertexBufferBytes();
+	bytes[ResourceMemoryType::IndexBuffer] = mesh->GetIndexBufferBytes();
+	return bytes;
 }
 
 //Destructor
 CResourceManager::~CResourceManager()
 {
-	if (texture) texture->Release();
-	if (mesh) mesh->~Mesh();
+	//Let outstanding loads finish, draining their results as they arrive so the workers never wait on a full queue.
+	//The I/O threads are stopped first as they hand work on to the decode threads
+	auto stopWorkers = [this](std::unique_ptr<CThreadPool>& pool)
+	{
+		if (!pool) return;
+		std::atomic<bool> stopped(false);
+		std::thread stopper([&pool, &stopped]() { pool.reset(); stopped = true; });
+		LoadResult result;
+		while (!stopped)
+		{
+			while (finishedLoads.Pop(result)) discardResult(result);
+			std::this_thread::yield();
+		}
+		stopper.join();
+	};
+	stopWorkers(ioThreads);
+	stopWorkers(decodeThreads);
+
+	LoadResult result;
+	while (finishedLoads.Pop(result)) discardResult(result);
 
-	for (auto it = textureMap.cbegin(), next_it = it; it != textureMap.cend(); it = next_it)
+	//Every slot owns its resource, including the default one
+	for (uint32_t i = 0; i < textures.Size(); ++i)
 	{
-		++next_it;
-		textureMap.erase(it);
+		TextureHandle handle;
+		handle.index = i;
+		if (ID3D11ShaderResourceView* texture = textures.GetSlot(handle)) texture->Release();
 	}
-	for (auto it = meshMap.cbegin(), next_it = it; it != meshMap.cend(); it = next_it)
+	for (uint32_t i = 0; i < meshes.Size(); ++i)
 	{
-		++next_it;
-		meshMap.erase(it);
+		MeshHandle handle;
+		handle.index = i;
+		delete meshes.GetSlot(handle);
 	}
-}
\ No newline at end of file
+
+	textures.Clear();
+	meshes.Clear();
+}
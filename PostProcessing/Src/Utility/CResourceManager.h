@@ -1,14 +1,56 @@
 #pragma once
 #include "GraphicsHelpers.h"
+#include "CResourceRegistry.h"
+#include "CResourceBudget.h"
+#include "CTextureStreamer.h"
+#include "CLockFreeQueue.h"
+#include "CThreadPool.h"
+#include "CContentHash.h"
+#include "CAssetPack.h"
+#include "CFileCache.h"
+#include "CImage.h"
 #include "Data/Mesh.h"
 #include <WICTextureLoader.h>
 #include <DDSTextureLoader.h>
 #include <cctype>
-#include <map>
 #include <atlbase.h>
+#include <chrono>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
-class CResourceManager
+//Counters describing the progress of the background loading
+struct ResourceLoadStats
+{
+	unsigned int requested = 0; // Loads started, including reloads after eviction
+	unsigned int completed = 0; // Loads that have finished and replaced their placeholder
+	unsigned int failed    = 0; // Loads that failed, these keep using the default resource
+	unsigned int fromPack  = 0; // Loads read from the asset pack rather than loose files
+	float totalLoadTime    = 0; // Seconds from the first request to the last load finishing
+
+	bool isLoading() const { return completed + failed < requested; }
+};
+
+//Counters describing the resources that share another's memory instead of loading their own copy
+struct ResourceDedupStats
+{
+	unsigned int pathDuplicates    = 0; // IDs loaded from a file already loaded under another ID, no file access needed
+	unsigned int contentDuplicates = 0; // IDs loaded from a different file with identical contents, read but not decoded
+	uint64_t     bytesSaved        = 0; // Memory the duplicates would currently be using if each had its own copy
+};
+
+//Textures and meshes are reference counted. loadTexture/loadMesh and acquireTexture/acquireMesh each add a
+//reference which must be given back with releaseTexture/releaseMesh. Resources with no references stay loaded
+//until the memory budget needs the space, at which point the least recently used are evicted. Fetching an
+//evicted resource reloads it in the background, serving the default resource until it is ready.
+//Models hold a raw Mesh pointer, so keep a reference to any mesh a model is using.
+//IDs loaded from the same file, or from files with identical contents, share a single resource and reference count.
+//Files are read through a CFileCache, from the asset pack (see AssetPackFile) when it contains them, otherwise from
+//loose files. Meshes are imported through the same cache so each file reaches the operating system at most once.
+//Streamed textures are created with only their smallest mips and gain finer ones as the scene asks for them with
+//requestTextureSize, within a per-frame upload budget (see CTextureStreamer.h).
+class CResourceManager : private IResourceAllocator, private IMipUploader
 {
 //----------------------//
 // Construction / Usage	//
@@ -20,32 +62,274 @@ public:
 	//Destructor
 	~CResourceManager();
 
-	//Function to load a texture into the textureMap 
-	void loadTexture(const wchar_t* uniqueID, std::string filename);
+	//Function to start loading a texture in the background, returns the handle to use when fetching it and adds a reference.
+	//The default texture is returned for the handle until the texture has loaded, or for good if it fails.
+	//Loading an ID that is already loaded just adds a reference. A streamed texture starts with only its smallest mips
+	TextureHandle loadTexture(const wchar_t* uniqueID, std::string filename, bool streamed = false);
+
+	//Function to start loading a mesh in the background, returns the handle to use when fetching it and adds a reference.
+	//The default mesh is returned for the handle until the mesh has loaded, or for good if it fails.
+	//The default mesh itself is loaded immediately the first time this is called
+	MeshHandle loadMesh(const wchar_t* uniqueID, std::string &filename, bool requireTangents = false);
+
+	//Functions to add and remove references. A resource with no references may be evicted when over budget
+	void acquireTexture(TextureHandle handle);
+	void releaseTexture(TextureHandle handle);
+	void acquireMesh(MeshHandle handle);
+	void releaseMesh(MeshHandle handle);
+
+	//Function to free a texture straight away if nothing holds a reference to it, rather than waiting for the budget
+	//to need the space. Fetching it afterwards reloads it in the background. Returns true if it was freed
+	bool unloadTexture(TextureHandle handle);
+
+	//Function to return the memory used by a texture, 0 if it is not loaded
+	uint64_t getTextureMemory(TextureHandle handle) const;
+
+	//Function to ask for a streamed texture to be sharp when one repeat of it covers the given number of pixels on screen.
+	//Call each frame for every model using the texture. The mips are uploaded by the following update()
+	void requestTextureSize(TextureHandle handle, float screenPixels);
+
+	//Function to set the bytes of texture mips uploaded by each update(), 0 to pause streaming
+	void setStreamingBudget(uint64_t bytesPerFrame) { streamingBudget = bytesPerFrame; }
+
+	//Function to return the resident and requested mips of the streamed textures and the bytes uploaded
+	const TextureStreamingStats& getStreamingStats() const { return streamer.GetStats(); }
+
+	//Function to swap in every resource that has finished loading since the last call, upload the texture mips asked for,
+	//then evict resources if over budget. Call once per frame from the rendering thread. Returns the number of resources
+	//swapped in or out
+	unsigned int update();
+
+	//Function to return the Texture for the given handle - a couple of array indices. Marks the texture as used
+	ID3D11ShaderResourceView* getTexture(TextureHandle handle) { handle = resolveTexture(handle); useTexture(handle); return textures.Get(handle); }
+
+	//Function to return the Mesh for the given handle - a couple of array indices. Marks the mesh as used
+	Mesh* getMesh(MeshHandle handle) { handle = resolveMesh(handle); useMesh(handle); return meshes.Get(handle); }
 
-	//Function to load a texture into the meshMap 
-	void loadMesh(const wchar_t* uniqueID, std::string &filename, bool requireTangents = false);
+	//Function to return the Texture with the given ID, or the default texture if there is none.
+	//Searches by name so prefer keeping the handle returned by loadTexture
+	ID3D11ShaderResourceView* getTexture(const wchar_t* uid) { return getTexture(textures.Find(uid)); }
 
-	//Function to return the Texture at the given ID in the textureMap
-	ID3D11ShaderResourceView* getTexture(const wchar_t* uid);
+	//Function to return the Mesh with the given ID, or the default mesh if there is none.
+	//Searches by name so prefer keeping the handle returned by loadMesh
+	Mesh* getMesh(const wchar_t* uid) { return getMesh(meshes.Find(uid)); }
 
-	//Function to return the Mesh at the given ID in the meshMap
-	Mesh* getMesh(const wchar_t* uid);
+	//Function to return the handle for a texture or mesh ID, the default handle if it has not been loaded
+	TextureHandle findTexture(const wchar_t* uid) const { return textures.Find(uid); }
+	MeshHandle    findMesh(const wchar_t* uid) const { return meshes.Find(uid); }
+
+	//Function to count memory not owned by the manager (e.g. render targets) against the budget. It is never evicted
+	CResourceBudget::EntryId trackMemory(ResourceMemoryType type, uint64_t bytes);
+
+	//Function to stop counting memory added with trackMemory
+	void untrackMemory(CResourceBudget::EntryId entry);
+
+	//Function to set the memory budget in bytes, 0 for unlimited
+	void setMemoryBudget(uint64_t bytes) { budget.SetBudget(bytes); }
+
+	//Function to return the memory used by each type of resource, the budget and eviction counts
+	const ResourceBudgetStats& getBudgetStats() const { return budget.GetStats(); }
+
+	//Function to return the progress of the background loading
+	const ResourceLoadStats& getLoadStats() const { return loadStats; }
+
+	//Function to return the errors from any loads that failed
+	const std::vector<std::string>& getLoadErrors() const { return loadErrors; }
+
+	//Function to return how many IDs share another's resource and the memory that saves
+	ResourceDedupStats getDedupStats() const;
+
+	//Function to return the counters of the file cache shared by the loaders
+	FileCacheStats getFileCacheStats() const { return fileCache.GetStats(); }
+
+	//Function to read a small data file, such as a texture atlas layout, through the file cache so it comes from the
+	//asset pack when the pack has it. Returns false if the file cannot be read
+	bool readFile(const std::string& fileName, std::string& contents);
+
+	//Function to return true if a file can be read, from the asset pack or as a loose file
+	bool fileExists(const std::string& fileName) { return fileCache.Exists(fileName); }
+
+	//Pack opened by the constructor, relative to the working directory. Build it with "AssetTool pack"
+	static const char* const AssetPackFile;
 
 //--------------------------//
 // Private helper functions	//
 //--------------------------//
 private:
-	//Helper Function to check whether the file given actually exists 
-	bool doesFileExist(std::string &fileName);
+	//A finished load, passed from the worker threads back to update()
+	struct LoadResult
+	{
+		bool isMesh = false;
+		uint32_t index = 0;                              // Registry slot to fill
+		ID3D11ShaderResourceView* texture = nullptr;
+		ID3D11CommandList* commands = nullptr;           // Work recorded on a deferred context (mip generation), run in update()
+		std::unique_ptr<CImage> image;                   // Every mip of a streamed texture, whose texture holds residentMip onwards
+		uint32_t residentMip = 0;
+		Mesh* mesh = nullptr;
+		bool isDuplicate = false;                        // The file's contents match the resource already in slot original
+		bool fromPack = false;
+		uint32_t original = 0;
+		std::string error;                               // Set if the load failed
+		std::chrono::steady_clock::time_point finished;
+	};
+
+	//Where each texture and mesh slot was loaded from, so that it can be reloaded after eviction.
+	//A slot that duplicates another holds no resource of its own, original is the slot it shares (its own index otherwise)
+	//and its budget entry is unused - references go to the original's entry
+	//A streamed texture keeps every mip on the CPU until they are all resident
+	struct TextureSource
+	{
+		std::string fileName;
+		CResourceBudget::EntryId entry;
+		uint32_t original;
+		bool streamed = false;
+		CTextureStreamer::EntryId streamEntry = CTextureStreamer::InvalidEntry;
+		std::unique_ptr<CImage> image;
+	};
+	struct MeshSource
+	{
+		std::string fileName;
+		bool requireTangents;
+		CResourceBudget::EntryId entry;
+		uint32_t original;
+	};
+
+	//Identifies the first slot to load some file contents. A matching size guards against hash collisions
+	struct ContentOwner
+	{
+		uint32_t index;
+		uint64_t size;
+	};
+
+	//Budget keys identify the slot a budget entry refers to. The top bits say which registry it is in
+	static const uint32_t MeshKey     = 0x80000000;
+	static const uint32_t ExternalKey = 0x40000000;
+	static const uint32_t IndexMask   = 0x3fffffff;
+
+	//Mixed into mesh content hashes when tangents are requested, as the same file then gives a different mesh
+	static const uint64_t TangentsHashSalt = 0x9e3779b97f4a7c15ULL;
+
+	//Helper Functions to return the handle of the slot holding the resource for a handle, following duplicates to the
+	//slot they share. Unknown handles give the default. Chains are at most two long (a path duplicate of a content duplicate)
+	TextureHandle resolveTexture(TextureHandle handle) const { return { resolveSlot(textureSources, handle.index) }; }
+	MeshHandle    resolveMesh(MeshHandle handle) const       { return { resolveSlot(meshSources, handle.index) }; }
+
+	template<typename Source>
+	static uint32_t resolveSlot(const std::vector<Source>& sources, uint32_t index)
+	{
+		if (index >= sources.size()) return 0;
+		while (sources[index].original != index) index = sources[index].original;
+		return index;
+	}
+
+	//Helper Functions to mark a resource as used, reloading it if it has been evicted. Take resolved handles
+	void useTexture(TextureHandle handle) { budget.Use(textureSources[handle.index].entry); }
+	void useMesh(MeshHandle handle)       { budget.Use(meshSources[handle.index].entry); }
+
+	//Helper Function to make a slot share the resource in another slot once its contents are found to match.
+	//The slot's references move to the original
+	template<typename Source>
+	void shareResource(std::vector<Source>& sources, uint32_t index, uint32_t original)
+	{
+		CResourceBudget::EntryId entry = sources[index].entry;
+		for (uint32_t i = budget.GetRefCount(entry); i > 0; --i) budget.AddRef(sources[original].entry);
+		budget.Remove(entry);
+		sources[index].original = original;
+	}
+
+	//Helper Function to record the contents of a file being loaded into a slot. Returns the slot that first loaded
+	//the same contents, which is the given slot unless it is a duplicate. Called from the worker threads
+	uint32_t claimContent(std::unordered_map<uint64_t, ContentOwner>& owners, uint64_t hash, uint64_t size, uint32_t index);
+
+	//Helper Functions to queue the background work to load the texture or mesh in a slot
+	void startTextureLoad(uint32_t index);
+	void startMeshLoad(uint32_t index);
+
+	//IResourceAllocator functions called by the budget to free and reload resources
+	void Evict(uint32_t key) override;
+	void Reload(uint32_t key) override;
+
+	//IMipUploader function called by the streamer to give a texture its next finer mip. Keys are texture slots
+	bool UploadMip(uint32_t key, uint32_t mip) override;
+
+	//Helper Function to stop streaming the texture in a slot and free its CPU copy
+	void stopStreaming(uint32_t index);
+
+	//Helper Function to return the block compressed DDS file made from a PNG or JPEG by the asset tool, if there is one,
+	//otherwise the file itself. Runs on an I/O thread
+	std::string findCompressedTexture(const std::string& fileName);
+
+	//Helper Function to create a texture from a file already read into memory. Runs on a decode thread
+	LoadResult decodeTexture(uint32_t index, const std::string& fileName, const AssetSpan& contents, bool streamed);
+
+	//Helper Function to create the first, smallest mips of a streamed texture, keeping the image for the rest.
+	//Returns false if the image cannot or need not be streamed. Runs on a decode thread
+	static bool decodeStreamedTexture(const std::string& fileName, const AssetSpan& contents, LoadResult* result);
+
+	//Helper Function to create a texture with WIC, for images the CPU decoders do not support. Runs on a decode thread
+	HRESULT decodeTextureWIC(const AssetSpan& contents, LoadResult* result);
+
+	//Helper Function to create a texture holding the mips of an image from firstMip on. Filled with the image it is
+	//immutable, otherwise its mips are left for the rendering thread to fill
+	static HRESULT createTexture(const CImage& image, uint32_t firstMip, bool fill, ID3D11ShaderResourceView** view);
+
+	//Helper Function to return the texture format holding an image format, DXGI_FORMAT_UNKNOWN if there is none
+	static DXGI_FORMAT getTextureFormat(ImageFormat format);
+
+	//Helper Function to create the plain white texture returned for textures that have not loaded
+	bool createDefaultTexture();
+
+	//Helper Function to create the worker threads the first time a load is requested
+	void startWorkers();
+
+	//Helper Function to hand a finished load back to the rendering thread
+	void pushResult(LoadResult&& result);
+
+	//Helper Function to release the resources held by a load result that will not be used
+	static void discardResult(LoadResult& result);
+
+	//Helper Function to return the memory used by a mesh
+	static ResourceBytes getMeshBytes(Mesh* mesh);
 
 //-------------//
 // Member data //
 //-------------//
 private:
-	ID3D11ShaderResourceView* texture;
-	Mesh* mesh;
+	CResourceRegistry<TextureHandle, ID3D11ShaderResourceView*> textures;
+	CResourceRegistry<MeshHandle, Mesh*> meshes;
+
+	//Indexed by the same slots as the registries above
+	std::vector<TextureSource> textureSources;
+	std::vector<MeshSource> meshSources;
+
+	CAssetPack pack;
+	CFileCache fileCache;
+
+	CResourceBudget budget;
+	unsigned int evictedSinceUpdate = 0;
+
+	CTextureStreamer streamer;
+	uint64_t streamingBudget = 4 * 1024 * 1024;
+
+	//File reading and decoding run on separate pools so that a slow decode does not hold up the reads behind it
+	std::unique_ptr<CThreadPool> ioThreads;
+	std::unique_ptr<CThreadPool> decodeThreads;
+	CLockFreeQueue<LoadResult> finishedLoads;
+
+	//Slots that own a resource, by canonical file path and by content hash, used to find duplicates.
+	//Mesh paths include whether tangents were requested and mesh hashes are mixed with it, as the results differ
+	std::unordered_map<std::string, uint32_t> texturePaths;
+	std::unordered_map<std::string, uint32_t> meshPaths;
+	std::unordered_map<uint64_t, ContentOwner> textureContents;
+	std::unordered_map<uint64_t, ContentOwner> meshContents;
+	std::mutex contentMutex;
+
+	//Slots sharing another slot's resource, for the dedup stats
+	std::vector<uint32_t> duplicateTextures;
+	std::vector<uint32_t> duplicateMeshes;
+	unsigned int pathDuplicates = 0;
 
-	std::map<wchar_t*, ID3D11ShaderResourceView*> textureMap;
-	std::map<wchar_t*, Mesh*> meshMap;
-};
\ No newline at end of file
+	ResourceLoadStats loadStats;
+	std::vector<std::string> loadErrors;
+	std::chrono::steady_clock::time_point firstRequest;
+};
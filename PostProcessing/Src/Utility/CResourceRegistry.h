@@ -0,0 +1,118 @@
+//--------------------------------------------------------------------------------------
+// Registry of named resources addressed through dense 32-bit handles
+//--------------------------------------------------------------------------------------
+// Names are interned once when a resource is loaded and given the next free slot in a
+// vector. Everything after that works on the handle, so fetching a resource at render
+// time is a single array index rather than a map search. Slot 0 is reserved for the
+// default resource, which is what a null handle or an unknown name resolves to.
+// The registry does not own its resources - releasing them is up to the caller.
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Handle to a resource in a CResourceRegistry. The tag type stops a handle for one kind of
+//resource being passed where another kind is expected (e.g. a mesh handle to getTexture)
+template<typename Tag>
+struct ResourceHandle
+{
+	uint32_t index = 0; // Slot in the registry, 0 is the default resource
+
+	bool IsDefault() const { return index == 0; }
+
+	bool operator==(const ResourceHandle& other) const { return index == other.index; }
+	bool operator!=(const ResourceHandle& other) const { return index != other.index; }
+};
+
+struct TextureTag;
+struct MeshTag;
+using TextureHandle = ResourceHandle<TextureTag>;
+using MeshHandle    = ResourceHandle<MeshTag>;
+
+
+template<typename Handle, typename Resource>
+class CResourceRegistry
+{
+//----------------------//
+// Construction / Usage	//
+//----------------------//
+public:
+	//Constructor, creates the empty default slot
+	CResourceRegistry()
+	{
+		m_Names.push_back(L"default");
+		m_Resources.push_back(Resource());
+		m_Lookup.emplace(m_Names[0], 0);
+	}
+
+	//Return the handle for the given name, adding a new empty slot if the name has not been seen before
+	Handle Intern(const std::wstring& name)
+	{
+		auto result = m_Lookup.emplace(name, static_cast<uint32_t>(m_Resources.size()));
+		if (result.second)
+		{
+			m_Names.push_back(name);
+			m_Resources.push_back(Resource());
+		}
+
+		Handle handle;
+		handle.index = result.first->second;
+		return handle;
+	}
+
+	//Return the handle for the given name, or the default handle if the name is unknown
+	Handle Find(const std::wstring& name) const
+	{
+		Handle handle;
+		auto it = m_Lookup.find(name);
+		if (it != m_Lookup.end()) handle.index = it->second;
+		return handle;
+	}
+
+	//Store a resource in the slot for the given handle
+	void Set(Handle handle, Resource resource)
+	{
+		if (handle.index < m_Resources.size()) m_Resources[handle.index] = resource;
+	}
+
+	//Return the resource for the given handle. Handles from another registry and empty slots
+	//give the default resource instead
+	Resource Get(Handle handle) const
+	{
+		if (handle.index < m_Resources.size() && m_Resources[handle.index]) return m_Resources[handle.index];
+		return m_Resources[0];
+	}
+
+	//Return the resource stored directly in the given slot, without falling back to the default
+	Resource GetSlot(Handle handle) const
+	{
+		return handle.index < m_Resources.size() ? m_Resources[handle.index] : Resource();
+	}
+
+	//Return the name the given handle was interned with
+	const std::wstring& GetName(Handle handle) const
+	{
+		return handle.index < m_Names.size() ? m_Names[handle.index] : m_Names[0];
+	}
+
+	//Number of slots including the default one
+	uint32_t Size() const { return static_cast<uint32_t>(m_Resources.size()); }
+
+	//Remove every name and resource, leaving only an empty default slot
+	void Clear()
+	{
+		m_Lookup.clear();
+		m_Names.resize(1);
+		m_Resources.assign(1, Resource());
+		m_Lookup.emplace(m_Names[0], 0);
+	}
+
+//-------------//
+// Member data //
+//-------------//
+private:
+	std::unordered_map<std::wstring, uint32_t> m_Lookup;    // Only used when loading or looking up by name
+	std::vector<std::wstring>                  m_Names;     // Indexed by handle
+	std::vector<Resource>                      m_Resources; // Indexed by handle
+};
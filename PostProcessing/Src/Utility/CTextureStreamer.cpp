@@ -0,0 +1,170 @@
+//--------------------------------------------------------------------------------------
+// Scheduling the upload of texture mips by how large the textures appear on screen
+//--------------------------------------------------------------------------------------
+
+#include "CTextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+
+//Create a streamer using the given uploader to make mips resident
+CTextureStreamer::CTextureStreamer(IMipUploader* uploader)
+	: m_Uploader(uploader)
+{
+}
+
+//Return the finest mip no larger than TailSize, or the last mip
+uint32_t CTextureStreamer::GetTailMip(uint32_t width, uint32_t height, uint32_t mipCount)
+{
+	uint32_t size = std::max(width, height);
+	uint32_t mip = 0;
+	while (mip + 1 < mipCount && (size >> mip) > TailSize) ++mip;
+	return mip;
+}
+
+//Start streaming a texture
+CTextureStreamer::EntryId CTextureStreamer::Add(uint32_t key, uint32_t width, uint32_t height, const std::vector<uint64_t>& mipBytes, uint32_t residentMip)
+{
+	EntryId id;
+	if (!m_FreeEntries.empty())
+	{
+		id = m_FreeEntries.back();
+		m_FreeEntries.pop_back();
+	}
+	else
+	{
+		id = static_cast<EntryId>(m_Entries.size());
+		m_Entries.emplace_back();
+	}
+
+	Entry& entry = m_Entries[id];
+	entry = Entry();
+	entry.key = key;
+	entry.active = true;
+	entry.size = std::max(width, height);
+	entry.mipBytes = mipBytes;
+	entry.residentMip = std::min(residentMip, static_cast<uint32_t>(mipBytes.size()) - 1);
+	entry.tailMip = entry.residentMip;
+	entry.requestedMip = entry.residentMip;
+
+	UpdateTotals();
+	return id;
+}
+
+//Stop streaming a texture
+void CTextureStreamer::Remove(EntryId id)
+{
+	m_Entries[id].active = false;
+	m_Entries[id].mipBytes.clear();
+	m_FreeEntries.push_back(id);
+	UpdateTotals();
+}
+
+//Ask for a texture to be sharp at the given size on screen, keeping the largest size asked for this frame
+void CTextureStreamer::Request(EntryId id, float screenPixels)
+{
+	Entry& entry = m_Entries[id];
+	entry.screenPixels = std::max(entry.screenPixels, screenPixels);
+}
+
+//Upload the most needed mips until the budget is spent
+void CTextureStreamer::Update(uint64_t byteBudget)
+{
+	m_Stats.frameUploads = 0;
+	m_Stats.frameBytes = 0;
+
+	//Textures short of the mips asked for, the blurriest at the front of the heap
+	std::vector<std::pair<float, EntryId>> queue;
+	for (EntryId id = 0; id < m_Entries.size(); ++id)
+	{
+		Entry& entry = m_Entries[id];
+		if (!entry.active) continue;
+
+		entry.requestedMip = WantedMip(entry);
+		if (!entry.failed && entry.residentMip > entry.requestedMip) queue.push_back({ Blurriness(entry), id });
+	}
+	std::make_heap(queue.begin(), queue.end());
+
+	//Upload one mip at a time, putting the texture back in the queue with its new blurriness if it needs more.
+	//A budget of 0 pauses the streaming
+	while (!queue.empty() && byteBudget > 0)
+	{
+		EntryId id = queue.front().second;
+		Entry& entry = m_Entries[id];
+		uint32_t mip = entry.residentMip - 1;
+		uint64_t bytes = entry.mipBytes[mip];
+
+		//Keep to the budget, but never leave a mip larger than the whole budget waiting for good
+		if (m_Stats.frameUploads > 0 && m_Stats.frameBytes + bytes > byteBudget) break;
+
+		std::pop_heap(queue.begin(), queue.end());
+		queue.pop_back();
+
+		if (!m_Uploader->UploadMip(entry.key, mip))
+		{
+			entry.failed = true;
+			++m_Stats.failedUploads;
+			continue;
+		}
+		entry.residentMip = mip;
+		++m_Stats.frameUploads;
+		m_Stats.frameBytes += bytes;
+
+		if (entry.residentMip > entry.requestedMip)
+		{
+			queue.push_back({ Blurriness(entry), id });
+			std::push_heap(queue.begin(), queue.end());
+		}
+	}
+
+	m_Stats.totalUploads += m_Stats.frameUploads;
+	m_Stats.totalBytes += m_Stats.frameBytes;
+	m_Stats.peakFrameBytes = std::max(m_Stats.peakFrameBytes, m_Stats.frameBytes);
+	UpdateTotals();
+
+	//The next frame's requests start afresh
+	for (auto& entry : m_Entries) entry.screenPixels = 0;
+}
+
+//Return the finest mip needed to draw a texture at the size it has been asked for. A texture covering half as many
+//pixels as its mip 0 has is sampled from mip 1 and so on - rounding down keeps the mip the GPU blends towards resident
+uint32_t CTextureStreamer::WantedMip(const Entry& entry) const
+{
+	if (entry.screenPixels <= 0) return entry.tailMip;
+
+	float texelsPerPixel = static_cast<float>(entry.size) / entry.screenPixels;
+	if (texelsPerPixel <= 1.0f) return 0;
+
+	uint32_t mip = static_cast<uint32_t>(std::floor(std::log2(texelsPerPixel)));
+	return std::min(mip, entry.tailMip);
+}
+
+//Return the screen pixels covered by each texel of the finest resident mip
+float CTextureStreamer::Blurriness(const Entry& entry)
+{
+	return entry.screenPixels / static_cast<float>(std::max(entry.size >> entry.residentMip, 1u));
+}
+
+//Recount the resident and requested mips of every texture
+void CTextureStreamer::UpdateTotals()
+{
+	m_Stats.textures = 0;
+	m_Stats.waiting = 0;
+	m_Stats.residentMips = 0;
+	m_Stats.requestedMips = 0;
+	m_Stats.residentBytes = 0;
+	m_Stats.requestedBytes = 0;
+
+	for (auto& entry : m_Entries)
+	{
+		if (!entry.active) continue;
+
+		uint32_t mipCount = static_cast<uint32_t>(entry.mipBytes.size());
+		++m_Stats.textures;
+		if (entry.residentMip > entry.requestedMip) ++m_Stats.waiting;
+		m_Stats.residentMips += mipCount - entry.residentMip;
+		m_Stats.requestedMips += mipCount - entry.requestedMip;
+		for (uint32_t mip = entry.residentMip; mip < mipCount; ++mip) m_Stats.residentBytes += entry.mipBytes[mip];
+		for (uint32_t mip = entry.requestedMip; mip < mipCount; ++mip) m_Stats.requestedBytes += entry.mipBytes[mip];
+	}
+}
@@ -0,0 +1,125 @@
+//--------------------------------------------------------------------------------------
+// Scheduling the upload of texture mips by how large the textures appear on screen
+//--------------------------------------------------------------------------------------
+// Streamed textures start with only their smallest mips resident. Each frame the mips the screen
+// needs are uploaded, blurriest textures first, within a byte budget, through an IMipUploader so
+// the scheduling can be driven on the CPU.
+#pragma once
+#include <cstdint>
+#include <vector>
+
+//Interface used by the streamer to make mips resident
+class IMipUploader
+{
+public:
+	virtual ~IMipUploader() = default;
+
+	//Make the given mip of the texture with the given key resident. The coarser mips already are.
+	//Returns false if it cannot, in which case the texture is not streamed any further
+	virtual bool UploadMip(uint32_t key, uint32_t mip) = 0;
+};
+
+//Counters describing the state of the streaming
+struct TextureStreamingStats
+{
+	uint32_t textures       = 0; // Textures being streamed
+	uint32_t waiting        = 0; // Textures with fewer mips resident than requested
+	uint32_t residentMips   = 0; // Mips resident, over every texture
+	uint32_t requestedMips  = 0; // Mips wanted for the screen sizes given before the last Update, over every texture
+	uint64_t residentBytes  = 0; // Bytes of the resident mips
+	uint64_t requestedBytes = 0; // Bytes of the requested mips
+	uint32_t frameUploads   = 0; // Mips uploaded by the last Update
+	uint64_t frameBytes     = 0; // Bytes uploaded by the last Update
+	uint64_t peakFrameBytes = 0; // Most bytes uploaded by one Update
+	uint32_t totalUploads   = 0; // Mips uploaded since the streamer was created
+	uint64_t totalBytes     = 0; // Bytes uploaded since the streamer was created
+	uint32_t failedUploads  = 0; // Uploads the uploader could not make
+};
+
+class CTextureStreamer
+{
+//----------------------//
+// Construction / Usage	//
+//----------------------//
+public:
+	using EntryId = uint32_t;
+	static const EntryId InvalidEntry = 0xffffffff;
+
+	//Largest size, in pixels along the longer side, of the finest mip a texture starts with
+	static const uint32_t TailSize = 64;
+
+	//Create a streamer using the given uploader to make mips resident
+	explicit CTextureStreamer(IMipUploader* uploader);
+
+	//Return the mip a texture of the given size starts with: the finest no larger than TailSize, or the last mip
+	static uint32_t GetTailMip(uint32_t width, uint32_t height, uint32_t mipCount);
+
+	//Start streaming a texture. The key is passed back to the uploader. mipBytes holds the size of each mip, finest
+	//first, and residentMip is the finest mip already resident (normally GetTailMip)
+	EntryId Add(uint32_t key, uint32_t width, uint32_t height, const std::vector<uint64_t>& mipBytes, uint32_t residentMip);
+
+	//Stop streaming a texture, e.g. when it has been freed. The entry may be reused by a later Add
+	void Remove(EntryId entry);
+
+	//Ask for a texture to be sharp when it covers the given number of pixels along its longer side on screen.
+	//Call for each use of the texture each frame - the largest size asked for since the last Update is kept
+	void Request(EntryId entry, float screenPixels);
+
+	//Upload mips, most needed first, until about the given number of bytes have been uploaded. Each upload is the next finer mip
+	//of the texture that looks blurriest - the ratio of its screen size to its finest resident mip's - so a texture filling the
+	//screen sharpens before one in the distance, and several sharpen together. A mip larger than the whole budget is uploaded on
+	//its own when it is at the front, so it does not hold up the others for good. Mips are never dropped here; freeing unused
+	//textures is left to the memory budget (see CResourceBudget.h). The requests are then cleared ready for the next frame
+	void Update(uint64_t byteBudget);
+
+	//-------------------------------------
+	// Data access
+	//-------------------------------------
+
+	uint32_t GetKey(EntryId entry)         const { return m_Entries[entry].key; }
+	uint32_t GetResidentMip(EntryId entry) const { return m_Entries[entry].residentMip; }
+	uint32_t GetMipCount(EntryId entry)    const { return static_cast<uint32_t>(m_Entries[entry].mipBytes.size()); }
+
+	//Return the finest mip wanted for the screen sizes given before the last Update
+	uint32_t GetRequestedMip(EntryId entry) const { return m_Entries[entry].requestedMip; }
+
+	//Return true once every mip of a texture is resident, so it needs no further streaming
+	bool IsComplete(EntryId entry) const { return m_Entries[entry].residentMip == 0; }
+
+	const TextureStreamingStats& GetStats() const { return m_Stats; }
+
+//--------------------------//
+// Private helper functions	//
+//--------------------------//
+private:
+	struct Entry
+	{
+		uint32_t              key = 0;
+		bool                  active = false;
+		bool                  failed = false;       // The uploader could not make a mip resident, stream no further
+		uint32_t              size = 0;             // Pixels along the longer side of mip 0
+		std::vector<uint64_t> mipBytes;
+		uint32_t              residentMip = 0;
+		uint32_t              tailMip = 0;          // Mip the texture started with
+		uint32_t              requestedMip = 0;
+		float                 screenPixels = 0;     // Largest size asked for since the last Update
+	};
+
+	//Return the finest mip needed to draw a texture at the size it has been asked for, never coarser than its tail
+	uint32_t WantedMip(const Entry& entry) const;
+
+	//Return how blurry a texture looks with its finest resident mip - screen pixels per texel
+	static float Blurriness(const Entry& entry);
+
+	//Recount the resident and requested mips of every texture
+	void UpdateTotals();
+
+//-------------//
+// Member data //
+//-------------//
+private:
+	IMipUploader*         m_Uploader;
+	std::vector<Entry>    m_Entries;
+	std::vector<EntryId>  m_FreeEntries;
+	TextureStreamingStats m_Stats;
+};
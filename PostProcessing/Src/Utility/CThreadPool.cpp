@@ -0,0 +1,87 @@
+//--------------------------------------------------------------------------------------
+// Fixed set of worker threads that run submitted tasks
+//--------------------------------------------------------------------------------------
+
+#include "CThreadPool.h"
+
+#include <algorithm>
+
+//Start the given number of worker threads
+CThreadPool::CThreadPool(unsigned int threadCount, std::function<void()> threadStart, std::function<void()> threadEnd)
+	: m_ThreadStart(std::move(threadStart)), m_ThreadEnd(std::move(threadEnd))
+{
+	threadCount = std::max(threadCount, 1u);
+	m_Workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		m_Workers.emplace_back(&CThreadPool::WorkerLoop, this);
+	}
+}
+
+//Finish every task already submitted, then stop the workers
+CThreadPool::~CThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_TaskAvailable.notify_all();
+
+	for (auto& worker : m_Workers) worker.join();
+}
+
+//Queue a task to be run on one of the workers
+void CThreadPool::Submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Tasks.push_back(std::move(task));
+	}
+	m_TaskAvailable.notify_one();
+}
+
+//Block until every task submitted so far has finished
+void CThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_TasksFinished.wait(lock, [this]() { return m_Tasks.empty() && m_ActiveTasks == 0; });
+}
+
+//One worker per hardware thread, less the given number reserved for other work
+unsigned int CThreadPool::DefaultThreadCount(unsigned int reserved)
+{
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	return hardwareThreads > reserved ? hardwareThreads - reserved : 1;
+}
+
+//Loop run by each worker thread
+void CThreadPool::WorkerLoop()
+{
+	if (m_ThreadStart) m_ThreadStart();
+
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_TaskAvailable.wait(lock, [this]() { return m_Stopping || !m_Tasks.empty(); });
+
+			//Only stop once the queue has been emptied
+			if (m_Tasks.empty()) break;
+
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop_front();
+			++m_ActiveTasks;
+		}
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			--m_ActiveTasks;
+			if (m_Tasks.empty() && m_ActiveTasks == 0) m_TasksFinished.notify_all();
+		}
+	}
+
+	if (m_ThreadEnd) m_ThreadEnd();
+}
@@ -0,0 +1,63 @@
+//--------------------------------------------------------------------------------------
+// Fixed set of worker threads that run submitted tasks
+//--------------------------------------------------------------------------------------
+// Tasks are run in the order they were submitted by whichever worker is free. Optional
+// start/end functions are run on each worker when it starts and before it exits, for
+// any per-thread setup a task needs (e.g. COM initialisation).
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CThreadPool
+{
+//----------------------//
+// Construction / Usage	//
+//----------------------//
+public:
+	//Start the given number of worker threads
+	CThreadPool(unsigned int threadCount, std::function<void()> threadStart = nullptr, std::function<void()> threadEnd = nullptr);
+
+	//Finish every task already submitted, then stop the workers
+	~CThreadPool();
+
+	CThreadPool(const CThreadPool&) = delete;
+	CThreadPool& operator=(const CThreadPool&) = delete;
+
+	//Queue a task to be run on one of the workers
+	void Submit(std::function<void()> task);
+
+	//Block until every task submitted so far has finished
+	void Wait();
+
+	//Number of worker threads
+	unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_Workers.size()); }
+
+	//One worker per hardware thread, less the given number reserved for other work. Always at least one
+	static unsigned int DefaultThreadCount(unsigned int reserved = 1);
+
+//--------------------------//
+// Private helper functions	//
+//--------------------------//
+private:
+	//Loop run by each worker thread
+	void WorkerLoop();
+
+//-------------//
+// Member data //
+//-------------//
+private:
+	std::vector<std::thread>          m_Workers;
+	std::deque<std::function<void()>> m_Tasks;
+	std::mutex                        m_Mutex;
+	std::condition_variable           m_TaskAvailable;
+	std::condition_variable           m_TasksFinished;
+	unsigned int                      m_ActiveTasks = 0;
+	bool                              m_Stopping = false;
+
+	std::function<void()> m_ThreadStart;
+	std::function<void()> m_ThreadEnd;
+};
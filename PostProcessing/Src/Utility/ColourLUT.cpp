@@ -0,0 +1,326 @@
+//--------------------------------------------------------------------------------------
+// Baking the post-processes' colour maps into a 3D colour lookup table
+//--------------------------------------------------------------------------------------
+
+#include "ColourLUT.h"
+#include "CThreadPool.h"
+#include "Float4.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace
+{
+	//Run a function over ranges of [0, count) on the pool's workers, or all at once on this thread without a pool
+	void ParallelFor(CThreadPool* threads, uint32_t count, const std::function<void(uint32_t, uint32_t)>& function)
+	{
+		if (!threads || threads->GetThreadCount() == 0 || count < 2)
+		{
+			function(0, count);
+			return;
+		}
+		uint32_t step = std::max(count / (threads->GetThreadCount() * 4), 1u);
+		for (uint32_t first = 0; first < count; first += step)
+		{
+			uint32_t end = std::min(first + step, count);
+			threads->Submit([&function, first, end]() { function(first, end); });
+		}
+		threads->Wait();
+	}
+
+
+	//-------------------------------------
+	// Operators
+	//-------------------------------------
+	// As the shaders, in the same order of operations as the CPU post-processes so the results match theirs
+
+	float Frac(float value)
+	{
+		return value - std::floor(value);
+	}
+
+	float Saturate(float value)
+	{
+		return value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f;
+	}
+
+	float Luminance(const float rgb[3], const CVector3& weights)
+	{
+		return rgb[0] * weights.x + rgb[1] * weights.y + rgb[2] * weights.z;
+	}
+
+	//The hue turned through the shader's HSL, whose lightness is the sum of the largest and smallest channels
+	void TurnHue(const float rgb[3], float turn, float rgba[4])
+	{
+		float maxComponent = std::max(rgb[0], std::max(rgb[1], rgb[2]));
+		float minComponent = std::min(rgb[0], std::min(rgb[1], rgb[2]));
+		float diff = maxComponent - minComponent;
+		float hue = 0.0f;
+		if      (maxComponent == rgb[0]) hue = 0.0f + (rgb[1] - rgb[2]) / diff;
+		else if (maxComponent == rgb[1]) hue = 2.0f + (rgb[2] - rgb[0]) / diff;
+		else if (maxComponent == rgb[2]) hue = 4.0f + (rgb[0] - rgb[1]) / diff;
+		float saturation = diff / maxComponent;
+		float lightness = minComponent + maxComponent;
+
+		hue = Frac(Frac(hue / 6.0f) + turn);
+		const float hueRGB[3] = { Saturate(std::abs(hue * 6.0f - 3.0f) - 1.0f), Saturate(2.0f - std::abs(hue * 6.0f - 2.0f)),
+		                          Saturate(2.0f - std::abs(hue * 6.0f - 4.0f)) };
+		for (int c = 0; c < 3; ++c) rgba[c] = (1.0f + (hueRGB[c] - 1.0f) * saturation) * lightness;
+		rgba[3] = 1.0f;
+	}
+
+	void ApplyOperator(ColourOperator op, const PostProcessingConstants& constants, const float rgb[3], float rgba[4])
+	{
+		switch (op)
+		{
+		case ColourOperator::Gradient:
+			TurnHue(rgb, constants.UnderwaterEffect / 10.0f, rgba);
+			break;
+
+		case ColourOperator::Saturation:
+		{
+			float luminance = Luminance(rgb, constants.LuminanceWeights);
+			for (int c = 0; c < 3; ++c) rgba[c] = luminance + (rgb[c] - luminance) * constants.SaturationLevel;
+			rgba[3] = (rgb[0] + rgb[1] + rgb[2]) / 3.0f;
+			break;
+		}
+
+		case ColourOperator::UnderwaterTint:
+		{
+			const float tinted[3] = { rgb[0] + 0.0f, rgb[1] + 0.0f, rgb[2] + 0.55f };
+			float luminance = Luminance(tinted, constants.LuminanceWeights);
+			for (int c = 0; c < 3; ++c) rgba[c] = tinted[c] * luminance;
+			rgba[3] = 0.0f;
+			break;
+		}
+
+		case ColourOperator::GameBoyPalette:
+		{
+			//The four greens of the shader's palette, by luminance
+			static const float Palette[4][3] = { { 0.0588f, 0.2196f, 0.0588f }, { 0.1882f, 0.3804f, 0.1882f },
+			                                     { 0.5412f, 0.6706f, 0.0588f }, { 0.7333f, 0.8118f, 0.3647f } };
+			float luminance = Luminance(rgb, constants.LuminanceWeights);
+			int shade = luminance > 0.75f ? 3 : (luminance > 0.5f ? 2 : (luminance > 0.25f ? 1 : 0));
+			std::copy(Palette[shade], Palette[shade] + 3, rgba);
+			rgba[3] = luminance;
+			break;
+		}
+		}
+	}
+
+
+	//-------------------------------------
+	// Grading
+	//-------------------------------------
+
+	bool IsFloatImage(const CImage& image)
+	{
+		return !image.IsEmpty() && image.GetFormat() == ImageFormat::RGBA32F;
+	}
+
+	//The entry a colour is in the cube after, along one axis, and how far across the cube it is. Colours outside the table are
+	//clamped to its edge
+	uint32_t FindCube(float channel, float scale, float last, uint32_t lastCube, float& fraction)
+	{
+		float position = channel * scale;
+		position = position > 0.0f ? (position < last ? position : last) : 0.0f; // Also NaN
+		uint32_t index = std::min(static_cast<uint32_t>(position), lastCube);
+		fraction = position - index;
+		return index;
+	}
+
+	//Tetrahedral interpolation of the table at a colour, scale being the entries per unit of colour. The tetrahedron holding
+	//the colour runs from the cube's first corner along the axis the colour is furthest along, then the next furthest, to the
+	//opposite corner, and its corners are weighted by the differences between the sorted fractions. Colours are in no order
+	//from one pixel to the next, so the axes are picked with arithmetic rather than branches
+	template<typename Float4>
+	Float4 LookupTable(const ColourLUT& lut, float scale, const float rgb[3])
+	{
+		const float last = static_cast<float>(lut.size - 1);
+		const size_t greenStride = static_cast<size_t>(lut.size) * 4, blueStride = greenStride * lut.size;
+		float red, green, blue;
+		const float* corner = lut.entries.data() + FindCube(rgb[0], scale, last, lut.size - 2, red) * 4 +
+		                      FindCube(rgb[1], scale, last, lut.size - 2, green) * greenStride +
+		                      FindCube(rgb[2], scale, last, lut.size - 2, blue) * blueStride;
+
+		const size_t redFirst = red >= green, redBeforeBlue = red >= blue, greenBeforeBlue = green >= blue;
+		const size_t largestRed = redFirst & redBeforeBlue, largestGreen = (redFirst ^ 1) & greenBeforeBlue;
+		const size_t smallestRed = (redFirst | redBeforeBlue) ^ 1, smallestBlue = redBeforeBlue & greenBeforeBlue;
+		const size_t largestStride = largestRed * 4 + largestGreen * greenStride + (1 - largestRed - largestGreen) * blueStride;
+		const size_t smallestStride = smallestRed * 4 + smallestBlue * blueStride + (1 - smallestRed - smallestBlue) * greenStride;
+
+		const float redGreenMin = red < green ? red : green, redGreenMax = red < green ? green : red;
+		const float largest = redGreenMax > blue ? redGreenMax : blue;
+		const float smallest = redGreenMin < blue ? redGreenMin : blue;
+		const float middle = redGreenMax < blue ? redGreenMax : (redGreenMin > blue ? redGreenMin : blue);
+
+		const float* opposite = corner + 4 + greenStride + blueStride;
+		return Float4::Load(corner) * (1.0f - largest) + Float4::Load(corner + largestStride) * (largest - middle) +
+		       Float4::Load(opposite - smallestStride) * (middle - smallest) + Float4::Load(opposite) * smallest;
+	}
+
+	//Grade each pixel of the scene into the target with a function from the scene's colour, plus the gradient's tint for the
+	//row if asked, to the RGBA written
+	template<typename Grade>
+	bool GradeImage(const PostProcessingConstants& constants, const CImage& scene, CImage& target, bool gradientTint, CThreadPool* threads,
+	                const Grade& grade)
+	{
+		if (!IsFloatImage(scene)) return false;
+		const uint32_t width = scene.GetWidth(), height = scene.GetHeight();
+		if (&scene != &target && !target.Create(ImageFormat::RGBA32F, width, height)) return false;
+
+		const CVector3& tint1 = constants.tintColour1;
+		const CVector3& tint2 = constants.tintColour2;
+		ParallelFor(threads, height, [&](uint32_t first, uint32_t end)
+		{
+			for (uint32_t y = first; y < end; ++y)
+			{
+				//At the pixel's centre, as the rasterizer interpolates it
+				const float v = (y + 0.5f) / height;
+				const float tint[3] = { gradientTint ? tint1.x + (tint2.x - tint1.x) * v : 0.0f,
+				                        gradientTint ? tint1.y + (tint2.y - tint1.y) * v : 0.0f,
+				                        gradientTint ? tint1.z + (tint2.z - tint1.z) * v : 0.0f };
+				const float* in = reinterpret_cast<const float*>(scene.GetRow(0, y));
+				float* out = reinterpret_cast<float*>(target.GetRow(0, y));
+				for (uint32_t x = 0; x < width; ++x, in += 4, out += 4)
+				{
+					const float rgb[3] = { in[0] + tint[0], in[1] + tint[1], in[2] + tint[2] };
+					grade(rgb, out);
+				}
+			}
+		});
+		return true;
+	}
+
+	//Grade through a table, turning each pixel's hue first if the table starts after the gradient
+	template<typename Float4>
+	bool GradeWithTable(const ColourLUT& lut, const PostProcessingConstants& constants, const CImage& scene, CImage& target,
+	                    CThreadPool* threads)
+	{
+		const float scale = (lut.size - 1) / lut.range, turn = constants.UnderwaterEffect / 10.0f;
+		return GradeImage(constants, scene, target, lut.gradient, threads, [&lut, scale, turn](const float* rgb, float* rgba)
+		{
+			if (!lut.gradient)
+			{
+				LookupTable<Float4>(lut, scale, rgb).Store(rgba);
+				return;
+			}
+			float turned[4];
+			TurnHue(rgb, turn, turned);
+			LookupTable<Float4>(lut, scale, turned).Store(rgba);
+		});
+	}
+}
+
+
+//Name of a colour operator, for reports
+const char* GetColourOperatorName(ColourOperator op)
+{
+	switch (op)
+	{
+	case ColourOperator::Gradient:       return "Gradient";
+	case ColourOperator::Saturation:     return "Saturation";
+	case ColourOperator::UnderwaterTint: return "UnderwaterTint";
+	case ColourOperator::GameBoyPalette: return "GameBoyPalette";
+	default:                             return "Unknown";
+	}
+}
+
+//Run a chain of colour operators on one colour, as the effects do
+void ApplyColourOperators(const std::vector<ColourOperator>& chain, const PostProcessingConstants& constants, const float rgb[3], float rgba[4])
+{
+	//Each operator writes all four channels from the red, green and blue before it
+	float colour[3] = { rgb[0], rgb[1], rgb[2] };
+	rgba[3] = 1.0f;
+	for (ColourOperator op : chain)
+	{
+		ApplyOperator(op, constants, colour, rgba);
+		std::copy(rgba, rgba + 3, colour);
+	}
+	std::copy(colour, colour + 3, rgba);
+}
+
+//Whether a chain is faster looked up in a table than run on each pixel
+bool IsColourLUTWorthwhile(const std::vector<ColourOperator>& chain)
+{
+	return chain.size() >= 3 && std::find(chain.begin(), chain.end(), ColourOperator::Gradient) == chain.end();
+}
+
+//Bake a chain of colour operators, leaving out the gradient at its start, into a table of size entries along each axis,
+//covering 0->range of each channel
+bool BakeColourLUT(const std::vector<ColourOperator>& chain, const PostProcessingConstants& constants, uint32_t size, float range,
+                   ColourLUT& lut, CThreadPool* threads)
+{
+	const bool gradient = !chain.empty() && chain.front() == ColourOperator::Gradient;
+	const std::vector<ColourOperator> baked(chain.begin() + (gradient ? 1 : 0), chain.end());
+	if (baked.empty() || std::find(baked.begin(), baked.end(), ColourOperator::Gradient) != baked.end()) return false;
+	if (size < MinColourLUTSize || size > MaxColourLUTSize || !(range > 0.0f) || !std::isfinite(range)) return false;
+
+	lut.size = size;
+	lut.range = range;
+	lut.gradient = gradient;
+	lut.entries.assign(static_cast<size_t>(size) * size * size * 4, 0.0f);
+
+	//A slice of blue at a time
+	const float step = range / (size - 1);
+	ParallelFor(threads, size, [&](uint32_t first, uint32_t end)
+	{
+		for (uint32_t b = first; b < end; ++b)
+		{
+			float* entry = lut.entries.data() + static_cast<size_t>(b) * size * size * 4;
+			for (uint32_t g = 0; g < size; ++g)
+			{
+				for (uint32_t r = 0; r < size; ++r, entry += 4)
+				{
+					const float rgb[3] = { r * step, g * step, b * step };
+					ApplyColourOperators(baked, constants, rgb, entry);
+				}
+			}
+		}
+	});
+	return true;
+}
+
+//Look up a colour in a table with tetrahedral interpolation
+void LookupColourLUT(const ColourLUT& lut, const float rgb[3], float rgba[4])
+{
+	LookupTable<ScalarFloat4>(lut, (lut.size - 1) / lut.range, rgb).Store(rgba);
+}
+
+//Grade the top mip of an RGBA32F scene into target by looking up each pixel in a table
+bool ApplyColourLUT(const ColourLUT& lut, const PostProcessingConstants& constants, const CImage& scene, CImage& target, CThreadPool* threads,
+                    bool useSIMD)
+{
+	if (lut.size < MinColourLUTSize || lut.entries.size() != static_cast<size_t>(lut.size) * lut.size * lut.size * 4) return false;
+
+#if FLOAT4_SIMD
+	if (useSIMD) return GradeWithTable<SSEFloat4>(lut, constants, scene, target, threads);
+#else
+	(void)useSIMD;
+#endif
+	return GradeWithTable<ScalarFloat4>(lut, constants, scene, target, threads);
+}
+
+//As above running the chain of colour operators on each pixel instead
+bool ApplyColourOperators(const std::vector<ColourOperator>& chain, const PostProcessingConstants& constants, const CImage& scene,
+                          CImage& target, CThreadPool* threads)
+{
+	if (chain.empty()) return false;
+	return GradeImage(constants, scene, target, chain.front() == ColourOperator::Gradient, threads,
+		[&](const float* rgb, float* rgba) { ApplyColourOperators(chain, constants, rgb, rgba); });
+}
+
+//Put the colour grade's settings in the post-process constants, for ColourGrade_ps
+void SetColourLUTConstants(PostProcessingConstants& constants, const std::vector<ColourOperator>& chain, const ColourLUT* lut)
+{
+	//A bit for each operator run on each pixel - all of them without a table, only the gradient with one
+	uint32_t operators = 0;
+	for (ColourOperator op : chain)
+	{
+		if (!lut || op == ColourOperator::Gradient) operators |= 1u << static_cast<uint32_t>(op);
+	}
+	constants.colourGradeOperators = static_cast<float>(operators);
+	constants.colourLUTSize = lut ? static_cast<float>(lut->size) : 0.0f;
+	constants.colourLUTRange = lut ? lut->range : 1.0f;
+}
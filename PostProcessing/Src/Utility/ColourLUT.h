@@ -0,0 +1,79 @@
+//--------------------------------------------------------------------------------------
+// Baking the post-processes' colour maps into a 3D colour lookup table
+//--------------------------------------------------------------------------------------
+// The effects whose colour depends only on the colour read from the scene are worked out once for
+// a grid of colours and looked up with tetrahedral interpolation, on the CPU here and on the GPU by
+// ColourGrade_ps. The gradient changes down the screen and over time, so it is run on each pixel
+// before any lookup, and chains that a table would not speed up are run on each pixel instead.
+#pragma once
+#include "CImage.h"
+#include "project/PostProcessingConstants.h"
+
+#include <vector>
+
+class CThreadPool;
+
+//The effects' maps from the colour read from the scene to the colour written
+enum class ColourOperator
+{
+	Gradient,       // VerticalColourGradient_ps - the tint for the row, then the hue turned by UnderwaterEffect / 10. Chains may only start with it
+	Saturation,     // Saturation_ps - lerp from the luminance by SaturationLevel, alpha the average of red, green and blue
+	UnderwaterTint, // Underwater_ps - blue added, then darkened by the luminance, alpha 0
+	GameBoyPalette, // Pixelation_ps - the four greens by luminance, alpha the luminance
+};
+
+//Name of a colour operator, for reports
+const char* GetColourOperatorName(ColourOperator op);
+
+//A chain of colour operators baked for a grid of colours, after the gradient if the chain starts with it
+struct ColourLUT
+{
+	uint32_t size = 0;         // Entries along each axis
+	float    range = 1.0f;     // Each channel from 0 to this spans the entries
+	bool     gradient = false; // Run the gradient on the scene colour before looking it up
+	std::vector<float> entries; // RGBA for each entry, red fastest, then green, then blue
+
+	//Bytes held by the entries, as an RGBA32F 3D texture
+	size_t GetSize() const { return entries.size() * sizeof(float); }
+};
+
+//Smallest and largest sizes of table that can be baked
+const uint32_t MinColourLUTSize = 2;
+const uint32_t MaxColourLUTSize = 128;
+
+//Run a chain of colour operators on one colour, as the effects do, giving the RGBA written. The gradient's tint is left out,
+//so rgb is the colour after it for a chain starting with the gradient
+void ApplyColourOperators(const std::vector<ColourOperator>& chain, const PostProcessingConstants& constants, const float rgb[3], float rgba[4]);
+
+//Whether a chain is faster looked up in a table than run on each pixel. By colour-lut-bench a lookup costs more than any two
+//operators, and the gradient's turn on each pixel before it costs as much as the rest of the chain, so only chains of three or
+//more operators without the gradient are worth it
+bool IsColourLUTWorthwhile(const std::vector<ColourOperator>& chain);
+
+//Bake a chain of colour operators, leaving out the gradient at its start, into a table of size (MinColourLUTSize ->
+//MaxColourLUTSize) entries along each axis, covering 0->range of each channel, using the pool's workers if one is given. The
+//table holds the chain's RGBA for each entry, and does not change with the gradient's tint or turn. Colours outside 0->range
+//are clamped to it when looked up, so the range needs to cover the scene's HDR values, and for the gradient its turned colours,
+//whose channels reach the sum of the tinted colour's largest and smallest. Returns false for a chain with nothing to bake, one
+//with the gradient after its start, or a size or range out of bounds
+bool BakeColourLUT(const std::vector<ColourOperator>& chain, const PostProcessingConstants& constants, uint32_t size, float range,
+                   ColourLUT& lut, CThreadPool* threads = nullptr);
+
+//Look up a colour in a table with tetrahedral interpolation, giving the RGBA written. The tetrahedron around the colour takes 4
+//entries where trilinear takes 8, and is exact for maps that are linear in the colour such as the saturation lerp. The lookup
+//blends across the Gameboy palette's steps, so colours within a cube of entries of a step get a mix of two greens
+void LookupColourLUT(const ColourLUT& lut, const float rgb[3], float rgba[4]);
+
+//Grade the top mip of an RGBA32F scene into target (created to match) by looking up each pixel in a table, running the gradient
+//first if the table needs it - the CPU copy of ColourGrade_ps over the whole screen. Set useSIMD to false to force the scalar
+//code, which gives identical results. Returns false for other formats or an empty table
+bool ApplyColourLUT(const ColourLUT& lut, const PostProcessingConstants& constants, const CImage& scene, CImage& target,
+                    CThreadPool* threads = nullptr, bool useSIMD = true);
+
+//As above running the chain of colour operators on each pixel instead, as ColourGrade_ps does without a table
+bool ApplyColourOperators(const std::vector<ColourOperator>& chain, const PostProcessingConstants& constants, const CImage& scene,
+                          CImage& target, CThreadPool* threads = nullptr);
+
+//Put the colour grade's settings in the post-process constants, for ColourGrade_ps - the operators it runs on each pixel, and the
+//table's size and range, or a size of 0 to run the whole chain without a table
+void SetColourLUTConstants(PostProcessingConstants& constants, const std::vector<ColourOperator>& chain, const ColourLUT* lut);
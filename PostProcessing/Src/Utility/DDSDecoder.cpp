@@ -0,0 +1,204 @@
+//--------------------------------------------------------------------------------------
+// DDS decoding, see ImageDecoders.h
+//--------------------------------------------------------------------------------------
+
+#include "ImageDecoders.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	uint32_t Read32(const uint8_t* data)
+	{
+		return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+		       static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24;
+	}
+
+	uint32_t FourCC(const char* code) { return Read32(reinterpret_cast<const uint8_t*>(code)); }
+
+	//Offsets into the file of the DDS_HEADER fields used, which follow the 4 byte magic number
+	const size_t HeaderSize        = 4 + 124;
+	const size_t HeightOffset      = 12;
+	const size_t WidthOffset       = 16;
+	const size_t MipCountOffset    = 28;
+	const size_t PixelFormatOffset = 76;
+	const size_t Caps2Offset       = 112;
+	const size_t DX10HeaderSize    = 20;
+
+	//Largest top mip accepted, checked before allocating so a corrupt header cannot ask for gigabytes
+	const uint64_t MaxPixels = 1ull << 28;
+
+	//DDS_PIXELFORMAT flags
+	const uint32_t PixelAlphaPixels = 0x1;
+	const uint32_t PixelAlpha       = 0x2;
+	const uint32_t PixelFourCC      = 0x4;
+	const uint32_t PixelRGB         = 0x40;
+	const uint32_t PixelLuminance   = 0x20000;
+
+	const uint32_t Caps2CubeMap = 0x200;
+	const uint32_t Caps2Volume  = 0x200000;
+	const uint32_t MiscCubeMap  = 0x4;
+	const uint32_t DimensionTexture2D = 3;
+
+	//Format of a DX10 header's DXGI_FORMAT, Unknown if not supported. The sRGB and typeless variants hold the same data
+	ImageFormat FromDXGIFormat(uint32_t format)
+	{
+		switch (format)
+		{
+		case 27: case 28: case 29: return ImageFormat::RGBA8; // R8G8B8A8 typeless, unorm, unorm sRGB
+		case 87: case 90: case 91: return ImageFormat::BGRA8; // B8G8R8A8 unorm, typeless, unorm sRGB
+		case 60: case 61:          return ImageFormat::R8;    // R8 typeless, unorm
+		case 48: case 49:          return ImageFormat::RG8;   // R8G8 typeless, unorm
+		case 70: case 71: case 72: return ImageFormat::BC1;
+		case 76: case 77: case 78: return ImageFormat::BC3;
+		case 79: case 80:          return ImageFormat::BC4;
+		case 82: case 83:          return ImageFormat::BC5;
+		case 97: case 98: case 99: return ImageFormat::BC7;
+		case 1: case 2:            return ImageFormat::RGBA32F; // R32G32B32A32 typeless, float
+		case 15: case 16:          return ImageFormat::RG32F;   // R32G32 typeless, float
+		default:                   return ImageFormat::Unknown;
+		}
+	}
+
+	//A channel of an uncompressed legacy pixel format, given as a bit mask
+	struct MaskChannel
+	{
+		uint32_t mask = 0;
+		uint32_t shift = 0;
+		uint32_t maximum = 0; // Largest value the channel can hold, 0 if it is absent
+
+		explicit MaskChannel(uint32_t channelMask) : mask(channelMask)
+		{
+			if (mask == 0) return;
+			while (((mask >> shift) & 1) == 0) ++shift;
+			maximum = mask >> shift;
+		}
+
+		uint8_t Expand(uint32_t pixel, uint8_t absent) const
+		{
+			if (maximum == 0) return absent;
+			return static_cast<uint8_t>((((pixel & mask) >> shift) * 255 + maximum / 2) / maximum);
+		}
+	};
+
+	//Convert an uncompressed legacy format described by bit masks to RGBA8
+	void ConvertMasked(const uint8_t* source, uint32_t bytesPerPixel, const uint8_t* pixelFormat, CImage& image)
+	{
+		uint32_t flags = Read32(pixelFormat + 4);
+		MaskChannel red(Read32(pixelFormat + 16));
+		MaskChannel green(Read32(pixelFormat + 20));
+		MaskChannel blue(Read32(pixelFormat + 24));
+		MaskChannel alpha((flags & (PixelAlphaPixels | PixelAlpha)) ? Read32(pixelFormat + 28) : 0);
+		bool luminance = (flags & PixelLuminance) != 0;
+
+		for (uint32_t mip = 0; mip < image.GetMipCount(); ++mip)
+		{
+			const ImageMip& layout = image.GetMip(mip);
+			uint8_t* destination = image.GetData(mip);
+			for (size_t i = 0; i < static_cast<size_t>(layout.width) * layout.height; ++i, source += bytesPerPixel, destination += 4)
+			{
+				uint32_t pixel = 0;
+				memcpy(&pixel, source, bytesPerPixel);
+
+				destination[0] = red.Expand(pixel, 0);
+				destination[1] = luminance ? destination[0] : green.Expand(pixel, 0);
+				destination[2] = luminance ? destination[0] : blue.Expand(pixel, 0);
+				destination[3] = alpha.Expand(pixel, 255);
+			}
+		}
+	}
+}
+
+//Decode a DDS file
+bool DecodeDDS(const uint8_t* data, size_t size, CImage& image, std::string& error)
+{
+	if (size < HeaderSize || memcmp(data, "DDS ", 4) != 0 || Read32(data + 4) != 124)
+	{
+		error = "Not a DDS file";
+		return false;
+	}
+
+	uint32_t height = Read32(data + HeightOffset);
+	uint32_t width = Read32(data + WidthOffset);
+	uint32_t mipCount = std::max(Read32(data + MipCountOffset), 1u);
+	const uint8_t* pixelFormat = data + PixelFormatOffset;
+	uint32_t pixelFlags = Read32(pixelFormat + 4);
+	uint32_t fourCC = Read32(pixelFormat + 8);
+	uint32_t bitCount = Read32(pixelFormat + 12);
+
+	if (Read32(data + Caps2Offset) & (Caps2CubeMap | Caps2Volume))
+	{
+		error = "Only 2D DDS textures are supported";
+		return false;
+	}
+
+	//Work out the format. Uncompressed data that matches RGBA8 or BGRA8 exactly is used as it is, other masked layouts
+	//(16 and 24-bit, luminance, alpha-only, no alpha) are converted to RGBA8
+	ImageFormat format = ImageFormat::Unknown;
+	size_t dataOffset = HeaderSize;
+	uint32_t maskedBytes = 0;
+	if (pixelFlags & PixelFourCC)
+	{
+		if (fourCC == FourCC("DX10"))
+		{
+			if (size < HeaderSize + DX10HeaderSize)
+			{
+				error = "Truncated DDS header";
+				return false;
+			}
+			const uint8_t* dx10 = data + HeaderSize;
+			if (Read32(dx10 + 4) != DimensionTexture2D || (Read32(dx10 + 8) & MiscCubeMap) || Read32(dx10 + 12) > 1)
+			{
+				error = "Only single 2D DDS textures are supported";
+				return false;
+			}
+			format = FromDXGIFormat(Read32(dx10));
+			dataOffset += DX10HeaderSize;
+		}
+		else if (fourCC == FourCC("DXT1"))                               format = ImageFormat::BC1;
+		else if (fourCC == FourCC("DXT5"))                               format = ImageFormat::BC3;
+		else if (fourCC == FourCC("ATI1") || fourCC == FourCC("BC4U"))   format = ImageFormat::BC4;
+		else if (fourCC == FourCC("ATI2") || fourCC == FourCC("BC5U"))   format = ImageFormat::BC5;
+	}
+	else if ((pixelFlags & (PixelRGB | PixelLuminance | PixelAlpha)) && (bitCount == 8 || bitCount == 16 || bitCount == 24 || bitCount == 32))
+	{
+		uint32_t redMask = Read32(pixelFormat + 16), greenMask = Read32(pixelFormat + 20), blueMask = Read32(pixelFormat + 24);
+		uint32_t alphaMask = (pixelFlags & PixelAlphaPixels) ? Read32(pixelFormat + 28) : 0;
+		bool rgb = (pixelFlags & PixelRGB) && bitCount == 32 && alphaMask == 0xff000000 && greenMask == 0xff00;
+		if (rgb && redMask == 0xff && blueMask == 0xff0000)      format = ImageFormat::RGBA8;
+		else if (rgb && redMask == 0xff0000 && blueMask == 0xff) format = ImageFormat::BGRA8;
+		else
+		{
+			format = ImageFormat::RGBA8;
+			maskedBytes = bitCount / 8;
+		}
+	}
+	if (format == ImageFormat::Unknown)
+	{
+		error = "Unsupported DDS pixel format";
+		return false;
+	}
+
+	if (static_cast<uint64_t>(width) * height > MaxPixels || !image.Create(format, width, height, std::min(mipCount, CImage::CountMips(width, height))))
+	{
+		error = "Invalid DDS size";
+		return false;
+	}
+
+	//Mips are stored one after another, tightly packed, with each masked pixel taking bitCount bits
+	size_t dataSize = maskedBytes ? 0 : image.GetSize();
+	for (uint32_t mip = 0; mip < image.GetMipCount() && maskedBytes; ++mip)
+	{
+		dataSize += static_cast<size_t>(image.GetMip(mip).width) * image.GetMip(mip).height * maskedBytes;
+	}
+	if (size - dataOffset < dataSize)
+	{
+		error = "Truncated DDS data";
+		return false;
+	}
+
+	if (maskedBytes) ConvertMasked(data + dataOffset, maskedBytes, pixelFormat, image);
+	else             memcpy(image.GetData(), data + dataOffset, dataSize);
+	return true;
+}
@@ -0,0 +1,138 @@
+//--------------------------------------------------------------------------------------
+// DDS encoding, see ImageEncoders.h
+//--------------------------------------------------------------------------------------
+
+#include "ImageEncoders.h"
+
+#include <cstring>
+
+namespace
+{
+	void Write32(uint8_t* data, uint32_t value)
+	{
+		data[0] = static_cast<uint8_t>(value);
+		data[1] = static_cast<uint8_t>(value >> 8);
+		data[2] = static_cast<uint8_t>(value >> 16);
+		data[3] = static_cast<uint8_t>(value >> 24);
+	}
+
+	uint32_t FourCC(const char* code)
+	{
+		return static_cast<uint32_t>(static_cast<uint8_t>(code[0])) | static_cast<uint32_t>(static_cast<uint8_t>(code[1])) << 8 |
+		       static_cast<uint32_t>(static_cast<uint8_t>(code[2])) << 16 | static_cast<uint32_t>(static_cast<uint8_t>(code[3])) << 24;
+	}
+
+	//Offsets into the file of the DDS_HEADER fields written, as in DDSDecoder.cpp
+	const size_t HeaderSize        = 4 + 124;
+	const size_t FlagsOffset       = 8;
+	const size_t HeightOffset      = 12;
+	const size_t WidthOffset       = 16;
+	const size_t PitchOffset       = 20;
+	const size_t MipCountOffset    = 28;
+	const size_t PixelFormatOffset = 76;
+	const size_t CapsOffset        = 108;
+	const size_t DX10HeaderSize    = 20;
+
+	//DDS_HEADER flags: caps, height, width and pixel format are always present
+	const uint32_t HeaderRequired    = 0x1007;
+	const uint32_t HeaderPitch       = 0x8;
+	const uint32_t HeaderMipCount    = 0x20000;
+	const uint32_t HeaderLinearSize  = 0x80000;
+
+	//DDS_PIXELFORMAT flags
+	const uint32_t PixelAlphaPixels = 0x1;
+	const uint32_t PixelFourCC      = 0x4;
+	const uint32_t PixelRGB         = 0x40;
+
+	//Caps
+	const uint32_t CapsComplex = 0x8;
+	const uint32_t CapsTexture = 0x1000;
+	const uint32_t CapsMipMap  = 0x400000;
+
+	const uint32_t DimensionTexture2D = 3;
+
+	//DXGI_FORMAT of the formats that need the DX10 header, 0 for those that do not
+	uint32_t ToDXGIFormat(ImageFormat format)
+	{
+		switch (format)
+		{
+		case ImageFormat::R8:  return 61; // R8 unorm
+		case ImageFormat::RG8: return 49; // R8G8 unorm
+		case ImageFormat::BC7: return 98; // BC7 unorm
+		case ImageFormat::RGBA32F: return 2; // R32G32B32A32 float
+		case ImageFormat::RG32F:   return 16; // R32G32 float
+		default:               return 0;
+		}
+	}
+
+	//Legacy FourCC of the other block compressed formats
+	uint32_t ToFourCC(ImageFormat format)
+	{
+		switch (format)
+		{
+		case ImageFormat::BC1: return FourCC("DXT1");
+		case ImageFormat::BC3: return FourCC("DXT5");
+		case ImageFormat::BC4: return FourCC("ATI1");
+		case ImageFormat::BC5: return FourCC("ATI2");
+		default:               return 0;
+		}
+	}
+}
+
+//Encode an image and all its mips as a DDS file
+bool EncodeDDS(const CImage& image, std::vector<uint8_t>& file, std::string& error)
+{
+	ImageFormat format = image.GetFormat();
+	uint32_t dxgiFormat = ToDXGIFormat(format);
+	uint32_t fourCC = ToFourCC(format);
+	bool masked = format == ImageFormat::RGBA8 || format == ImageFormat::BGRA8;
+	if (image.IsEmpty() || (!dxgiFormat && !fourCC && !masked))
+	{
+		error = "Image format cannot be written to DDS";
+		return false;
+	}
+
+	size_t dataOffset = HeaderSize + (dxgiFormat ? DX10HeaderSize : 0);
+	file.assign(dataOffset + image.GetSize(), 0);
+	uint8_t* header = file.data();
+
+	//The pitch field holds the bytes in the top mip for block compressed formats, the bytes in a row otherwise
+	bool blocks = IsBlockCompressed(format);
+	memcpy(header, "DDS ", 4);
+	Write32(header + 4, 124);
+	Write32(header + FlagsOffset, HeaderRequired | (blocks ? HeaderLinearSize : HeaderPitch) | (image.GetMipCount() > 1 ? HeaderMipCount : 0));
+	Write32(header + HeightOffset, image.GetHeight());
+	Write32(header + WidthOffset, image.GetWidth());
+	Write32(header + PitchOffset, blocks ? static_cast<uint32_t>(image.GetMip(0).size) : image.GetMip(0).rowPitch);
+	Write32(header + MipCountOffset, image.GetMipCount());
+	Write32(header + CapsOffset, CapsTexture | (image.GetMipCount() > 1 ? CapsComplex | CapsMipMap : 0));
+
+	uint8_t* pixelFormat = header + PixelFormatOffset;
+	Write32(pixelFormat, 32);
+	if (masked)
+	{
+		bool rgba = format == ImageFormat::RGBA8;
+		Write32(pixelFormat + 4, PixelRGB | PixelAlphaPixels);
+		Write32(pixelFormat + 12, 32);
+		Write32(pixelFormat + 16, rgba ? 0xff : 0xff0000);
+		Write32(pixelFormat + 20, 0xff00);
+		Write32(pixelFormat + 24, rgba ? 0xff0000 : 0xff);
+		Write32(pixelFormat + 28, 0xff000000);
+	}
+	else
+	{
+		Write32(pixelFormat + 4, PixelFourCC);
+		Write32(pixelFormat + 8, dxgiFormat ? FourCC("DX10") : fourCC);
+	}
+
+	if (dxgiFormat)
+	{
+		uint8_t* dx10 = header + HeaderSize;
+		Write32(dx10, dxgiFormat);
+		Write32(dx10 + 4, DimensionTexture2D);
+		Write32(dx10 + 12, 1); // Array size
+	}
+
+	memcpy(file.data() + dataOffset, image.GetData(), image.GetSize());
+	return true;
+}
@@ -0,0 +1,227 @@
+//--------------------------------------------------------------------------------------
+// Signed distance fields made from cut-out masks
+//--------------------------------------------------------------------------------------
+
+#include "DistanceField.h"
+#include "CThreadPool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+
+namespace
+{
+	//Run a function over ranges of [0, count) on the pool's workers, or all at once on this thread without a pool
+	void ParallelFor(CThreadPool* threads, uint32_t count, const std::function<void(uint32_t, uint32_t)>& function)
+	{
+		if (!threads || threads->GetThreadCount() == 0 || count < 2)
+		{
+			function(0, count);
+			return;
+		}
+		uint32_t step = std::max(count / (threads->GetThreadCount() * 4), 1u);
+		for (uint32_t first = 0; first < count; first += step)
+		{
+			uint32_t end = std::min(first + step, count);
+			threads->Submit([&function, first, end]() { function(first, end); });
+		}
+		threads->Wait();
+	}
+
+	//Replace the squared distances along one row, f, with the lowest of f[q] + (p - q)^2 over every q - the lower envelope
+	//of parabolas rooted at each pixel. Pixels at FLT_MAX have no parabola. parabolas and bounds are scratch space of n and
+	//n + 1 entries. The intersections are found in double precision as f + q^2 outgrows a float's exact integers on large images
+	void TransformRow(const float* f, int n, float* output, int* parabolas, double* bounds)
+	{
+		//Build the envelope from left to right, dropping parabolas that the new one is below beyond their left bound
+		int k = -1;
+		for (int q = 0; q < n; ++q)
+		{
+			if (f[q] == FLT_MAX) continue;
+
+			double s = -DBL_MAX;
+			while (k >= 0)
+			{
+				int v = parabolas[k];
+				s = ((f[q] + static_cast<double>(q) * q) - (f[v] + static_cast<double>(v) * v)) / (2.0 * (q - v));
+				if (s > bounds[k]) break;
+				--k;
+			}
+			++k;
+			parabolas[k] = q;
+			bounds[k] = k == 0 ? -DBL_MAX : s;
+		}
+		if (k < 0)
+		{
+			std::fill(output, output + n, FLT_MAX);
+			return;
+		}
+		bounds[k + 1] = DBL_MAX;
+
+		//Read each pixel's distance from the parabola that is lowest there
+		int j = 0;
+		for (int p = 0; p < n; ++p)
+		{
+			while (bounds[j + 1] < p) ++j;
+			double offset = p - parabolas[j];
+			output[p] = static_cast<float>(offset * offset + f[parabolas[j]]);
+		}
+	}
+
+	//Return the offset of a channel, 0-3 for red, green, blue, alpha, within a pixel of the given format
+	uint32_t ChannelOffset(ImageFormat format, uint32_t channel)
+	{
+		return (format == ImageFormat::BGRA8 && channel != 1 && channel != 3) ? 2 - channel : channel;
+	}
+
+	//Return a field value for a distance in pixels of the field, 0.5 on the edge
+	uint8_t EncodeDistance(float distance, float spread)
+	{
+		float value = std::clamp(0.5f + distance / (2.0f * spread), 0.0f, 1.0f);
+		return static_cast<uint8_t>(value * 255.0f + 0.5f);
+	}
+}
+
+
+//Compute the squared Euclidean distance from every pixel to the nearest site
+void ComputeSquaredDistances(const std::vector<uint8_t>& sites, uint32_t width, uint32_t height, std::vector<float>& distances, CThreadPool* threads)
+{
+	distances.assign(static_cast<size_t>(width) * height, FLT_MAX);
+
+	//Down each column, the distance to the nearest site in the column, by a sweep down then a sweep back up
+	ParallelFor(threads, width, [&](uint32_t first, uint32_t end)
+	{
+		for (uint32_t x = first; x < end; ++x)
+		{
+			float run = FLT_MAX;
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				size_t i = static_cast<size_t>(y) * width + x;
+				run = sites[i] ? 0.0f : (run == FLT_MAX ? FLT_MAX : run + 1.0f);
+				distances[i] = run;
+			}
+			run = FLT_MAX;
+			for (uint32_t y = height; y-- > 0;)
+			{
+				size_t i = static_cast<size_t>(y) * width + x;
+				run = distances[i] == 0.0f ? 0.0f : (run == FLT_MAX ? FLT_MAX : run + 1.0f);
+				distances[i] = std::min(distances[i], run);
+			}
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				float& d = distances[static_cast<size_t>(y) * width + x];
+				if (d != FLT_MAX) d *= d;
+			}
+		}
+	});
+
+	//Along each row, the nearest of those column distances once the distance across is added
+	ParallelFor(threads, height, [&](uint32_t first, uint32_t end)
+	{
+		std::vector<float> row(width);
+		std::vector<int> parabolas(width);
+		std::vector<double> bounds(width + 1);
+		for (uint32_t y = first; y < end; ++y)
+		{
+			float* line = distances.data() + static_cast<size_t>(y) * width;
+			std::copy(line, line + width, row.begin());
+			TransformRow(row.data(), static_cast<int>(width), line, parabolas.data(), bounds.data());
+		}
+	});
+}
+
+
+//Make a signed distance field, R8 with a full mip chain, from the top mip of an RGBA8 or BGRA8 mask
+bool GenerateSignedDistanceField(const CImage& mask, CImage& field, const DistanceFieldOptions& options, CThreadPool* threads)
+{
+	if ((mask.GetFormat() != ImageFormat::RGBA8 && mask.GetFormat() != ImageFormat::BGRA8) || options.channel > 3 || options.spread <= 0) return false;
+
+	const uint32_t width = mask.GetWidth(), height = mask.GetHeight();
+	const uint32_t fieldWidth = options.width ? options.width : width;
+	const uint32_t fieldHeight = options.height ? options.height : height;
+	if (!field.Create(ImageFormat::R8, fieldWidth, fieldHeight, 0)) return false;
+
+	//Distances from each pixel outside the shape to the nearest inside it, and from each inside to the nearest outside
+	const uint32_t offset = ChannelOffset(mask.GetFormat(), options.channel);
+	const float threshold = options.threshold * 255.0f;
+	std::vector<uint8_t> inside(static_cast<size_t>(width) * height), outside(inside.size());
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const uint8_t* row = mask.GetRow(0, y);
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			size_t i = static_cast<size_t>(y) * width + x;
+			inside[i] = row[x * 4 + offset] <= threshold;
+			outside[i] = !inside[i];
+		}
+	}
+	std::vector<float> toInside, toOutside;
+	ComputeSquaredDistances(inside, width, height, toInside, threads);
+	ComputeSquaredDistances(outside, width, height, toOutside, threads);
+
+	//Signed distance in pixels of the mask, positive outside. The edge lies half way between the centres of an inside and
+	//an outside pixel. A mask that is all inside or all outside has no edge, so is given the largest distance
+	std::vector<float> distance(inside.size());
+	const float far = static_cast<float>(width + height);
+	for (size_t i = 0; i < distance.size(); ++i)
+	{
+		if (inside[i]) distance[i] = toOutside[i] == FLT_MAX ? -far : 0.5f - std::sqrt(toOutside[i]);
+		else           distance[i] = toInside[i]  == FLT_MAX ?  far : std::sqrt(toInside[i]) - 0.5f;
+	}
+
+	//Top mip of the field: the distances interpolated at the centre of each of its pixels, rescaled to its pixels.
+	//Distances are kept in floating point down the mip chain, each mip averaging the one above
+	const float scale = static_cast<float>(fieldWidth) / width;
+	std::vector<float> level(static_cast<size_t>(fieldWidth) * fieldHeight);
+	ParallelFor(threads, fieldHeight, [&](uint32_t first, uint32_t end)
+	{
+		for (uint32_t y = first; y < end; ++y)
+		{
+			float sourceY = std::clamp((y + 0.5f) * height / fieldHeight - 0.5f, 0.0f, static_cast<float>(height - 1));
+			uint32_t y0 = static_cast<uint32_t>(sourceY), y1 = std::min(y0 + 1, height - 1);
+			float fy = sourceY - y0;
+			for (uint32_t x = 0; x < fieldWidth; ++x)
+			{
+				float sourceX = std::clamp((x + 0.5f) * width / fieldWidth - 0.5f, 0.0f, static_cast<float>(width - 1));
+				uint32_t x0 = static_cast<uint32_t>(sourceX), x1 = std::min(x0 + 1, width - 1);
+				float fx = sourceX - x0;
+				const float* row0 = distance.data() + static_cast<size_t>(y0) * width;
+				const float* row1 = distance.data() + static_cast<size_t>(y1) * width;
+				float top = row0[x0] + (row0[x1] - row0[x0]) * fx;
+				float bottom = row1[x0] + (row1[x1] - row1[x0]) * fx;
+				level[static_cast<size_t>(y) * fieldWidth + x] = (top + (bottom - top) * fy) * scale;
+			}
+		}
+	});
+
+	for (uint32_t mip = 0; mip < field.GetMipCount(); ++mip)
+	{
+		const ImageMip& layout = field.GetMip(mip);
+		if (mip > 0)
+		{
+			//Average the 2x2 pixels above each, repeating the last row or column of odd sizes
+			const ImageMip& above = field.GetMip(mip - 1);
+			std::vector<float> next(static_cast<size_t>(layout.width) * layout.height);
+			for (uint32_t y = 0; y < layout.height; ++y)
+			{
+				uint32_t y0 = std::min(y * 2, above.height - 1), y1 = std::min(y * 2 + 1, above.height - 1);
+				for (uint32_t x = 0; x < layout.width; ++x)
+				{
+					uint32_t x0 = std::min(x * 2, above.width - 1), x1 = std::min(x * 2 + 1, above.width - 1);
+					next[static_cast<size_t>(y) * layout.width + x] = 0.25f *
+						(level[y0 * above.width + x0] + level[y0 * above.width + x1] + level[y1 * above.width + x0] + level[y1 * above.width + x1]);
+				}
+			}
+			level.swap(next);
+		}
+
+		//The spread is measured in pixels of the top mip, so each mip places the edge at the same value
+		for (uint32_t y = 0; y < layout.height; ++y)
+		{
+			uint8_t* row = field.GetRow(mip, y);
+			for (uint32_t x = 0; x < layout.width; ++x) row[x] = EncodeDistance(level[static_cast<size_t>(y) * layout.width + x], options.spread);
+		}
+	}
+	return true;
+}
@@ -0,0 +1,31 @@
+//--------------------------------------------------------------------------------------
+// Signed distance fields made from cut-out masks
+//--------------------------------------------------------------------------------------
+// Each pixel holds how far it is from the edge of the shape, so a bilinear sample compared to the
+// half way value gives a smooth, sharp edge at any scale, from a field much smaller than the mask.
+#pragma once
+#include "CImage.h"
+#include <vector>
+
+class CThreadPool;
+
+struct DistanceFieldOptions
+{
+	uint32_t channel   = 0;    // Channel of the mask to read, 0-3 for red, green, blue, alpha
+	float    threshold = 0.1f; // Pixels at or below this (0->1) are inside the shape - the polygon shaders cut out mask values above 0.1
+	uint32_t width     = 128;  // Size of the field, 0 for the size of the mask
+	uint32_t height    = 128;
+	float    spread    = 8.0f; // Distance from the edge, in pixels of the field, at which its values reach 0 inside and 1 outside
+};
+
+//Compute the squared Euclidean distance from every pixel to the nearest site, where sites holds one byte per pixel, non-zero
+//for a site. Pixels are a site's own distance 0, and every distance is FLT_MAX if there are no sites. The distances are exact,
+//in linear time by Felzenszwalb and Huttenlocher's two passes: the distance down each column to the nearest site in it, then
+//along each row the lower envelope of the parabolas those make. The columns, then the rows, are shared between the pool's
+//workers if one is given
+void ComputeSquaredDistances(const std::vector<uint8_t>& sites, uint32_t width, uint32_t height, std::vector<float>& distances, CThreadPool* threads = nullptr);
+
+//Make a signed distance field, R8 with a full mip chain, from the top mip of an RGBA8 or BGRA8 mask. The field is 0.5 on the
+//edge of the shape, less inside it and more outside, so like the mask it is cut out where it is above a threshold (0.5).
+//Returns false for other formats
+bool GenerateSignedDistanceField(const CImage& mask, CImage& field, const DistanceFieldOptions& options = DistanceFieldOptions(), CThreadPool* threads = nullptr);
@@ -0,0 +1,82 @@
+//--------------------------------------------------------------------------------------
+// Four floats worked on together
+//--------------------------------------------------------------------------------------
+// Code processing pixels of four float channels on the CPU is written once, as a template over
+// the type holding a pixel, and compiled for both types here. ScalarFloat4 is plain C++ and
+// SSEFloat4 uses SSE2, which is part of x64 so needs no target attributes or run time check
+// (FLOAT4_SIMD is 0 elsewhere). Both do the same float operations in the same order, so give
+// identical results, and the scalar version can be used to check the SIMD one.
+#pragma once
+
+#if defined(_M_X64) || defined(__x86_64__)
+	#define FLOAT4_SIMD 1
+	#include <emmintrin.h>
+#else
+	#define FLOAT4_SIMD 0
+#endif
+
+struct ScalarFloat4
+{
+	float r, g, b, a;
+
+	static ScalarFloat4 Load(const float* p)                   { return { p[0], p[1], p[2], p[3] }; }
+	static ScalarFloat4 Set(float r, float g, float b, float a) { return { r, g, b, a }; }
+	static ScalarFloat4 Splat(float value)                      { return { value, value, value, value }; }
+	void Store(float* p) const { p[0] = r;  p[1] = g;  p[2] = b;  p[3] = a; }
+
+	float Red()   const { return r; }
+	float Green() const { return g; }
+	float Blue()  const { return b; }
+	float Alpha() const { return a; }
+	ScalarFloat4 WithAlpha(float alpha) const { return { r, g, b, alpha }; }
+
+	friend ScalarFloat4 operator+(ScalarFloat4 x, ScalarFloat4 y) { return { x.r + y.r, x.g + y.g, x.b + y.b, x.a + y.a }; }
+	friend ScalarFloat4 operator-(ScalarFloat4 x, ScalarFloat4 y) { return { x.r - y.r, x.g - y.g, x.b - y.b, x.a - y.a }; }
+	friend ScalarFloat4 operator*(ScalarFloat4 x, ScalarFloat4 y) { return { x.r * y.r, x.g * y.g, x.b * y.b, x.a * y.a }; }
+	friend ScalarFloat4 operator*(ScalarFloat4 x, float s)        { return { x.r * s, x.g * s, x.b * s, x.a * s }; }
+
+	//Clamp to 0->1, with NaN becoming 0 as HLSL's saturate does
+	friend ScalarFloat4 Saturate(ScalarFloat4 x)
+	{
+		const auto clamp = [](float value) { return value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f; };
+		return { clamp(x.r), clamp(x.g), clamp(x.b), clamp(x.a) };
+	}
+};
+
+#if FLOAT4_SIMD
+struct SSEFloat4
+{
+	__m128 v;
+
+	static SSEFloat4 Load(const float* p)                   { return { _mm_loadu_ps(p) }; }
+	static SSEFloat4 Set(float r, float g, float b, float a) { return { _mm_setr_ps(r, g, b, a) }; }
+	static SSEFloat4 Splat(float value)                      { return { _mm_set1_ps(value) }; }
+	void Store(float* p) const { _mm_storeu_ps(p, v); }
+
+	float Red()   const { return _mm_cvtss_f32(v); }
+	float Green() const { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))); }
+	float Blue()  const { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))); }
+	float Alpha() const { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))); }
+	SSEFloat4 WithAlpha(float alpha) const
+	{
+		//Move alpha next to blue, then take red and green from v and blue and alpha from that
+		__m128 blueAlpha = _mm_unpackhi_ps(v, _mm_set1_ps(alpha));
+		return { _mm_shuffle_ps(v, blueAlpha, _MM_SHUFFLE(1, 0, 1, 0)) };
+	}
+
+	friend SSEFloat4 operator+(SSEFloat4 x, SSEFloat4 y) { return { _mm_add_ps(x.v, y.v) }; }
+	friend SSEFloat4 operator-(SSEFloat4 x, SSEFloat4 y) { return { _mm_sub_ps(x.v, y.v) }; }
+	friend SSEFloat4 operator*(SSEFloat4 x, SSEFloat4 y) { return { _mm_mul_ps(x.v, y.v) }; }
+	friend SSEFloat4 operator*(SSEFloat4 x, float s)     { return { _mm_mul_ps(x.v, _mm_set1_ps(s)) }; }
+
+	//max returns its second operand when either is NaN, so NaN becomes 0
+	friend SSEFloat4 Saturate(SSEFloat4 x) { return { _mm_min_ps(_mm_max_ps(x.v, _mm_setzero_ps()), _mm_set1_ps(1.0f)) }; }
+};
+#endif
+
+//Linear interpolation from x (t = 0) to y (t = 1)
+template<typename Float4>
+Float4 Lerp(Float4 x, Float4 y, float t)
+{
+	return x + (y - x) * t;
+}
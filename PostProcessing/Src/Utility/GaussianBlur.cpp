@@ -0,0 +1,249 @@
+//--------------------------------------------------------------------------------------
+// Gaussian blur of any size in constant time per pixel
+//--------------------------------------------------------------------------------------
+
+#include "GaussianBlur.h"
+#include "CThreadPool.h"
+#include "Float4.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+namespace
+{
+	const int      BoxPasses  = 3;
+	const uint32_t StripWidth = 32; // Pixels across each strip of columns blurred down the image
+
+	//Run a function over ranges of [0, count) on the pool's workers, or all at once on this thread without a pool
+	void ParallelFor(CThreadPool* threads, uint32_t count, const std::function<void(uint32_t, uint32_t)>& function)
+	{
+		if (!threads || threads->GetThreadCount() == 0 || count < 2)
+		{
+			function(0, count);
+			return;
+		}
+		uint32_t step = std::max(count / (threads->GetThreadCount() * 4), 1u);
+		for (uint32_t first = 0; first < count; first += step)
+		{
+			uint32_t end = std::min(first + step, count);
+			threads->Submit([&function, first, end]() { function(first, end); });
+		}
+		threads->Wait();
+	}
+
+	//Box blur of the pixels [begin, end) of a line of pixels of four floats, spaced step floats apart in both input and output.
+	//The input must cover [begin - radius - 1, end + radius + 1)
+	template<typename Float4>
+	void BoxLine(const float* input, float* output, size_t step, int begin, int end, const BoxBlurParameters& box, float scale)
+	{
+		const auto at = [&](int i) { return Float4::Load(input + i * step); };
+
+		Float4 sum = Float4::Splat(0.0f);
+		for (int i = begin - box.radius; i <= begin + box.radius; ++i) sum = sum + at(i);
+		for (int i = begin; i < end; ++i)
+		{
+			Float4 entering = at(i + box.radius + 1);
+			Float4 ends = at(i - box.radius - 1) + entering;
+			((sum + ends * box.endWeight) * scale).Store(output + i * step);
+			sum = sum + entering - at(i - box.radius);
+		}
+	}
+
+	//As above down the rows [begin, end) of a strip of columns, pixels wide, with a running sum for each pixel across the strip.
+	//pitch is the floats from one row to the next in both input and output, and sums holds a pixel's worth of floats for each column
+	template<typename Float4>
+	void BoxColumns(const float* input, float* output, size_t pitch, uint32_t pixels, int begin, int end, const BoxBlurParameters& box,
+	                float scale, float* sums)
+	{
+		const size_t floats = pixels * 4;
+		std::fill(sums, sums + floats, 0.0f);
+		for (int y = begin - box.radius; y <= begin + box.radius; ++y)
+		{
+			const float* in = input + y * pitch;
+			for (size_t f = 0; f < floats; f += 4) (Float4::Load(sums + f) + Float4::Load(in + f)).Store(sums + f);
+		}
+		for (int y = begin; y < end; ++y)
+		{
+			const float* before = input + (y - box.radius - 1) * pitch;
+			const float* first = input + (y - box.radius) * pitch;
+			const float* after = input + (y + box.radius + 1) * pitch;
+			float* out = output + y * pitch;
+			for (size_t f = 0; f < floats; f += 4)
+			{
+				Float4 sum = Float4::Load(sums + f);
+				Float4 entering = Float4::Load(after + f);
+				Float4 ends = Float4::Load(before + f) + entering;
+				((sum + ends * box.endWeight) * scale).Store(out + f);
+				(sum + entering - Float4::Load(first + f)).Store(sums + f);
+			}
+		}
+	}
+
+	//Each line is extended by the pixels the three boxes reach past its ends, repeating the pixel at each end, so the result
+	//is the same as for the Gaussian clamped at the edges. Each box is then valid over a narrower part of the extended line,
+	//ending with the line itself, so none need clamp
+	template<typename Float4>
+	void BlurBoxes(const CImage& source, CImage& destination, const BoxBlurParameters& box, CThreadPool* threads)
+	{
+		const int width = static_cast<int>(source.GetWidth()), height = static_cast<int>(source.GetHeight());
+		const size_t pitch = static_cast<size_t>(width) * 4;
+		const float scale = 1.0f / (2 * box.radius + 1 + 2 * box.endWeight);
+		const int reach = box.radius + 1, border = reach * BoxPasses;
+		const float* input = reinterpret_cast<const float*>(source.GetData());
+		float* output = reinterpret_cast<float*>(destination.GetData());
+
+		//Every box across each row, through two extended rows of scratch space so the row stays in the cache
+		ParallelFor(threads, height, [&](uint32_t first, uint32_t end)
+		{
+			const int length = width + border * 2;
+			std::vector<float> scratch(static_cast<size_t>(length) * 4 * 2);
+			float* line1 = scratch.data();
+			float* line2 = scratch.data() + length * 4;
+			for (uint32_t y = first; y < end; ++y)
+			{
+				const float* row = input + y * pitch;
+				for (int x = 0; x < length; ++x)
+				{
+					const float* pixel = row + std::clamp(x - border, 0, width - 1) * 4;
+					std::copy(pixel, pixel + 4, line1 + x * 4);
+				}
+				BoxLine<Float4>(line1, line2, 4, reach, length - reach, box, scale);
+				BoxLine<Float4>(line2, line1, 4, reach * 2, length - reach * 2, box, scale);
+				BoxLine<Float4>(line1, line2, 4, border, length - border, box, scale);
+				std::copy(line2 + border * 4, line2 + (border + width) * 4, output + y * pitch);
+			}
+		});
+
+		//Then down each strip of columns, through two extended strips of scratch space, in place in the destination
+		const uint32_t strips = (width + StripWidth - 1) / StripWidth;
+		ParallelFor(threads, strips, [&](uint32_t first, uint32_t end)
+		{
+			const int length = height + border * 2;
+			const size_t stripPitch = StripWidth * 4;
+			std::vector<float> scratch(stripPitch * length * 2), sums(stripPitch);
+			float* strip1 = scratch.data();
+			float* strip2 = scratch.data() + stripPitch * length;
+			for (uint32_t s = first; s < end; ++s)
+			{
+				const uint32_t left = s * StripWidth, pixels = std::min(StripWidth, width - left);
+				float* columns = output + left * 4;
+				for (int y = 0; y < length; ++y)
+				{
+					const float* row = columns + std::clamp(y - border, 0, height - 1) * pitch;
+					std::copy(row, row + pixels * 4, strip1 + y * stripPitch);
+				}
+				BoxColumns<Float4>(strip1, strip2, stripPitch, pixels, reach, length - reach, box, scale, sums.data());
+				BoxColumns<Float4>(strip2, strip1, stripPitch, pixels, reach * 2, length - reach * 2, box, scale, sums.data());
+				BoxColumns<Float4>(strip1, strip2, stripPitch, pixels, border, length - border, box, scale, sums.data());
+				for (int y = 0; y < height; ++y)
+				{
+					const float* row = strip2 + (y + border) * stripPitch;
+					std::copy(row, row + pixels * 4, columns + y * pitch);
+				}
+			}
+		});
+	}
+
+	bool IsFloatImage(const CImage& image)
+	{
+		return !image.IsEmpty() && image.GetFormat() == ImageFormat::RGBA32F;
+	}
+}
+
+
+//Return the box that, run the given number of times, has the variance of a Gaussian of standard deviation sigma pixels
+BoxBlurParameters ComputeBoxBlur(float sigma, int passes)
+{
+	BoxBlurParameters box;
+	if (!(sigma > 0.0f) || passes < 1) return box;
+
+	//A box of radius r has variance r(r + 1) / 3, and the end weight adds to that up to the variance of the next radius
+	const double variance = static_cast<double>(sigma) * sigma / passes;
+	int radius = static_cast<int>(std::floor((std::sqrt(1.0 + 12.0 * variance) - 1.0) / 2.0));
+	if ((radius + 1.0) * (radius + 2.0) / 3.0 <= variance) ++radius; // Rounding of the square root
+	double endWeight = (2.0 * radius + 1.0) * (variance - radius * (radius + 1.0) / 3.0) / (2.0 * ((radius + 1.0) * (radius + 1.0) - variance));
+	box.radius = radius;
+	box.endWeight = static_cast<float>(std::clamp(endWeight, 0.0, 1.0));
+	return box;
+}
+
+//Blur the top mip of an RGBA32F image with three boxes approximating a Gaussian of standard deviation sigma pixels
+bool GaussianBlur(const CImage& source, CImage& destination, float sigma, CThreadPool* threads, bool useSIMD)
+{
+	if (!IsFloatImage(source)) return false;
+	if (&source != &destination && !destination.Create(ImageFormat::RGBA32F, source.GetWidth(), source.GetHeight())) return false;
+
+	const BoxBlurParameters box = ComputeBoxBlur(sigma, BoxPasses);
+#if FLOAT4_SIMD
+	if (useSIMD)
+	{
+		BlurBoxes<SSEFloat4>(source, destination, box, threads);
+		return true;
+	}
+#else
+	(void)useSIMD;
+#endif
+	BlurBoxes<ScalarFloat4>(source, destination, box, threads);
+	return true;
+}
+
+//As above by convolving with the Gaussian itself
+bool GaussianBlurReference(const CImage& source, CImage& destination, float sigma, CThreadPool* threads)
+{
+	if (!IsFloatImage(source)) return false;
+
+	const int width = static_cast<int>(source.GetWidth()), height = static_cast<int>(source.GetHeight());
+	const size_t pitch = static_cast<size_t>(width) * 4;
+	const int radius = sigma > 0.0f ? static_cast<int>(std::ceil(4.0f * sigma)) : 0;
+	std::vector<double> kernel(radius * 2 + 1);
+	double total = 0.0;
+	for (int i = -radius; i <= radius; ++i)
+	{
+		kernel[i + radius] = radius ? std::exp(-0.5 * i * i / (static_cast<double>(sigma) * sigma)) : 1.0;
+		total += kernel[i + radius];
+	}
+	for (double& weight : kernel) weight /= total;
+
+	//Across the rows into doubles, then down the columns into the destination
+	const float* input = reinterpret_cast<const float*>(source.GetData());
+	std::vector<double> across(pitch * height);
+	ParallelFor(threads, height, [&](uint32_t first, uint32_t end)
+	{
+		for (uint32_t y = first; y < end; ++y)
+		{
+			const float* row = input + y * pitch;
+			for (int x = 0; x < width; ++x)
+			{
+				double sum[4] = {};
+				for (int i = -radius; i <= radius; ++i)
+				{
+					const float* pixel = row + std::clamp(x + i, 0, width - 1) * 4;
+					for (int c = 0; c < 4; ++c) sum[c] += kernel[i + radius] * pixel[c];
+				}
+				std::copy(sum, sum + 4, across.begin() + y * pitch + x * 4);
+			}
+		}
+	});
+
+	CImage result;
+	result.Create(ImageFormat::RGBA32F, width, height);
+	float* output = reinterpret_cast<float*>(result.GetData());
+	ParallelFor(threads, height, [&](uint32_t first, uint32_t end)
+	{
+		std::vector<double> sums(pitch);
+		for (uint32_t y = first; y < end; ++y)
+		{
+			std::fill(sums.begin(), sums.end(), 0.0);
+			for (int i = -radius; i <= radius; ++i)
+			{
+				const double* row = across.data() + std::clamp(static_cast<int>(y) + i, 0, height - 1) * pitch;
+				for (size_t f = 0; f < pitch; ++f) sums[f] += kernel[i + radius] * row[f];
+			}
+			std::transform(sums.begin(), sums.end(), output + y * pitch, [](double value) { return static_cast<float>(value); });
+		}
+	});
+	destination = std::move(result);
+	return true;
+}
@@ -0,0 +1,34 @@
+//--------------------------------------------------------------------------------------
+// Gaussian blur of any size in constant time per pixel
+//--------------------------------------------------------------------------------------
+// A Gaussian approximated by three box blurs one after another, each a running sum along the line
+// so the cost is the same whatever the width. BoxBlurHorizontal_cs and BoxBlurVertical_cs run the
+// same boxes on the GPU.
+#pragma once
+#include "CImage.h"
+
+class CThreadPool;
+
+//One of the boxes: the average of radius pixels either side of the centre, and the centre, with the pixel just past each
+//end counted with endWeight (0 -> 1). This fraction of a pixel past each end (Gwosdek et al's "extended box") lets three boxes
+//have exactly a Gaussian's variance rather than the nearest a whole-pixel box allows
+struct BoxBlurParameters
+{
+	int   radius    = 0;
+	float endWeight = 0.0f;
+};
+
+//Return the box that, run the given number of times, has the variance of a Gaussian of standard deviation sigma pixels
+BoxBlurParameters ComputeBoxBlur(float sigma, int passes = 3);
+
+//Blur the top mip of an RGBA32F image with three boxes approximating a Gaussian of standard deviation sigma pixels, using the
+//pool's workers if one is given. The boxes run across each row in one go, then down the image a strip of columns at a time with
+//SSE, rows then strips split between the workers. Set useSIMD to false to force the scalar code, which gives identical results.
+//Each line is extended past its ends by the pixels the boxes reach, so the result is the whole Gaussian clamped at the edge; the
+//compute shaders clamp each box in turn instead, which differs slightly within a few sigma of the edges. source and destination
+//may be the same. Returns false for other formats
+bool GaussianBlur(const CImage& source, CImage& destination, float sigma, CThreadPool* threads = nullptr, bool useSIMD = true);
+
+//As above by convolving with the Gaussian itself, sampled at each pixel out to 4 sigma, in double precision. Slow - for
+//measuring the accuracy of GaussianBlur
+bool GaussianBlurReference(const CImage& source, CImage& destination, float sigma, CThreadPool* threads = nullptr);
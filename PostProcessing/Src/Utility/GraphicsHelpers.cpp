@@ -36,6 +36,110 @@ bool LoadTexture(std::string filename, ID3D11Resource** texture, ID3D11ShaderRes
 }
 
 
+// Return the number of bits per pixel for a DXGI format (4 or 8 for block compressed formats), 0 if unrecognised
+// Only covers the formats that the texture loaders and render textures in this project produce
+unsigned int BitsPerPixel(DXGI_FORMAT format)
+{
+    switch (format)
+    {
+    case DXGI_FORMAT_R32G32B32A32_FLOAT:
+    case DXGI_FORMAT_R32G32B32A32_UINT:
+        return 128;
+
+    case DXGI_FORMAT_R32G32B32_FLOAT:
+        return 96;
+
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:
+    case DXGI_FORMAT_R16G16B16A16_UNORM:
+    case DXGI_FORMAT_R32G32_FLOAT:
+        return 64;
+
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+    case DXGI_FORMAT_B8G8R8A8_UNORM:
+    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+    case DXGI_FORMAT_B8G8R8X8_UNORM:
+    case DXGI_FORMAT_R10G10B10A2_UNORM:
+    case DXGI_FORMAT_R11G11B10_FLOAT:
+    case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+    case DXGI_FORMAT_R16G16_FLOAT:
+    case DXGI_FORMAT_R16G16_UNORM:
+    case DXGI_FORMAT_R32_FLOAT:
+    case DXGI_FORMAT_D24_UNORM_S8_UINT:
+    case DXGI_FORMAT_D32_FLOAT:
+        return 32;
+
+    case DXGI_FORMAT_R8G8_UNORM:
+    case DXGI_FORMAT_R16_FLOAT:
+    case DXGI_FORMAT_R16_UNORM:
+    case DXGI_FORMAT_B5G6R5_UNORM:
+    case DXGI_FORMAT_B5G5R5A1_UNORM:
+        return 16;
+
+    case DXGI_FORMAT_R8_UNORM:
+    case DXGI_FORMAT_A8_UNORM:
+    case DXGI_FORMAT_BC2_UNORM:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_BC5_UNORM:
+    case DXGI_FORMAT_BC5_SNORM:
+    case DXGI_FORMAT_BC6H_UF16:
+    case DXGI_FORMAT_BC6H_SF16:
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        return 8;
+
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC4_UNORM:
+    case DXGI_FORMAT_BC4_SNORM:
+        return 4;
+
+    default:
+        return 0;
+    }
+}
+
+
+// Return the number of bytes of GPU memory used by the texture behind a shader resource view
+uint64_t GetTextureMemoryUsage(ID3D11ShaderResourceView* textureSRV)
+{
+    if (textureSRV == nullptr)  return 0;
+
+    ID3D11Resource* resource = nullptr;
+    textureSRV->GetResource(&resource);
+    if (resource == nullptr)  return 0;
+
+    uint64_t bytes = 0;
+    ID3D11Texture2D* texture = nullptr;
+    if (SUCCEEDED(resource->QueryInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&texture))))
+    {
+        D3D11_TEXTURE2D_DESC desc;
+        texture->GetDesc(&desc);
+
+        // Block compressed formats store 4x4 blocks, so round each mip up to a whole number of blocks
+        bool blockCompressed = (desc.Format >= DXGI_FORMAT_BC1_TYPELESS && desc.Format <= DXGI_FORMAT_BC5_SNORM) ||
+                               (desc.Format >= DXGI_FORMAT_BC6H_TYPELESS && desc.Format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+        uint64_t bitsPerPixel = BitsPerPixel(desc.Format);
+
+        uint64_t width = desc.Width, height = desc.Height;
+        for (UINT mip = 0; mip < desc.MipLevels; ++mip)
+        {
+            uint64_t w = blockCompressed ? ((width  + 3) / 4) * 4 : width;
+            uint64_t h = blockCompressed ? ((height + 3) / 4) * 4 : height;
+            bytes += w * h * bitsPerPixel / 8;
+            width  = width  > 1 ? width  / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+        }
+        bytes *= desc.ArraySize;
+        texture->Release();
+    }
+    resource->Release();
+    return bytes;
+}
+
+
 //--------------------------------------------------------------------------------------
 // Camera Helpers
 //--------------------------------------------------------------------------------------
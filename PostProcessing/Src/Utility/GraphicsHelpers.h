@@ -38,6 +38,13 @@ void UpdateConstantBuffer(ID3D11Buffer* buffer, const T& bufferData)
 // The function will fill in these pointers with usable data. Returns false on failure
 bool LoadTexture(std::string filename, ID3D11Resource** texture, ID3D11ShaderResourceView** textureSRV);
 
+// Return the number of bytes of GPU memory used by the texture behind a shader resource view, including all
+// mip levels and array slices. Block compressed formats are accounted for. Returns 0 for unrecognised formats
+uint64_t GetTextureMemoryUsage(ID3D11ShaderResourceView* textureSRV);
+
+// Return the number of bits per pixel for a DXGI format (4 or 8 for block compressed formats), 0 if unrecognised
+unsigned int BitsPerPixel(DXGI_FORMAT format);
+
 
 //--------------------------------------------------------------------------------------
 // Camera helpers
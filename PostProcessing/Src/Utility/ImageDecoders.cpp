@@ -0,0 +1,20 @@
+//--------------------------------------------------------------------------------------
+// Choosing an image decoder, see ImageDecoders.h
+//--------------------------------------------------------------------------------------
+
+#include "ImageDecoders.h"
+
+#include <cstring>
+
+//Decode a DDS, PNG or JPEG file, choosing the decoder from the signature at the start of the file
+bool DecodeImage(const uint8_t* data, size_t size, CImage& image, std::string& error, CThreadPool* threads)
+{
+	static const uint8_t PNGSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+	if (size >= 4 && memcmp(data, "DDS ", 4) == 0)                        return DecodeDDS(data, size, image, error);
+	if (size >= sizeof(PNGSignature) && memcmp(data, PNGSignature, sizeof(PNGSignature)) == 0) return DecodePNG(data, size, image, error);
+	if (size >= 3 && data[0] == 0xff && data[1] == 0xd8 && data[2] == 0xff) return DecodeJPEG(data, size, image, error, threads);
+
+	error = "Unknown image file type";
+	return false;
+}
@@ -0,0 +1,27 @@
+//--------------------------------------------------------------------------------------
+// CPU decoders for the texture file formats used by the assets
+//--------------------------------------------------------------------------------------
+// DDS, PNG and JPEG files decoded to a CImage in CPU memory, as DirectXTK's loaders do to a texture,
+// so tools can work on textures without Direct3D or WIC. Each takes the whole file in memory and
+// returns false with an error if it is corrupt or uses a feature that is not supported.
+#pragma once
+#include "CImage.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class CThreadPool;
+
+//Decode a DDS file of a 2D texture with its mips. Block compressed data (BC1, BC3, BC4, BC5, BC7) is kept compressed - see
+//DecompressBC. RGBA8, BGRA8, R8 and RG8 data is kept as it is, and other uncompressed 8/16/24/32-bit layouts are given as RGBA8
+bool DecodeDDS(const uint8_t* data, size_t size, CImage& image, std::string& error);
+
+//Decode a PNG file of any colour type and bit depth, interlaced or not, as RGBA8
+bool DecodePNG(const uint8_t* data, size_t size, CImage& image, std::string& error);
+
+//Decode a baseline or progressive Huffman-coded greyscale or YCbCr JPEG file as RGBA8. The entropy decoding is serial, the inverse DCT and colour conversion of each row of
+//blocks is shared between the pool's workers if one is given
+bool DecodeJPEG(const uint8_t* data, size_t size, CImage& image, std::string& error, CThreadPool* threads = nullptr);
+
+//Decode a DDS, PNG or JPEG file, choosing the decoder from the signature at the start of the file
+bool DecodeImage(const uint8_t* data, size_t size, CImage& image, std::string& error, CThreadPool* threads = nullptr);
@@ -0,0 +1,14 @@
+//--------------------------------------------------------------------------------------
+// CPU encoders for the texture file formats written by the tools
+//--------------------------------------------------------------------------------------
+// The other half of ImageDecoders.h. DDS is the only format written, since it can hold every
+// ImageFormat with its mips and DirectXTK's CreateDDSTextureFromMemory uploads it as it is.
+#pragma once
+#include "CImage.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Encode an image and all its mips as a DDS file. BC1, BC3, BC4, BC5, RGBA8 and BGRA8 use the legacy header that any
+//DDS reader understands, R8, RG8 and BC7 add the DX10 header
+bool EncodeDDS(const CImage& image, std::vector<uint8_t>& file, std::string& error);
@@ -0,0 +1,467 @@
+//--------------------------------------------------------------------------------------
+// Deflate decompression (RFC 1951) and the zlib wrapper around it (RFC 1950)
+//--------------------------------------------------------------------------------------
+
+#include "Inflate.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const uint32_t MaxCodeBits = 15;
+	const uint32_t FastBits = 10; // Codes up to this long are decoded with one table read
+
+	//Lengths and distances are a base value plus some extra bits, per symbol
+	const uint16_t LengthBase[29]  = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t  LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t DistanceBase[30]  = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+	                                     1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t  DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	//Order the code length code lengths are stored in
+	const uint8_t CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	//Canonical Huffman code, decoded from the least significant bits of the bit buffer
+	class HuffmanTable
+	{
+	public:
+		//Build the table from each symbol's code length (0 for unused). Returns false if the lengths are over-subscribed
+		bool Build(const uint8_t* lengths, uint32_t count)
+		{
+			uint16_t lengthCounts[MaxCodeBits + 1] = {};
+			for (uint32_t i = 0; i < count; ++i) ++lengthCounts[lengths[i]];
+			lengthCounts[0] = 0;
+
+			//Each length's codes follow on from the previous length's, and symbols are sorted by length
+			uint32_t code = 0;
+			uint32_t offset = 0;
+			uint32_t nextCode[MaxCodeBits + 1] = {};
+			uint32_t nextOffset[MaxCodeBits + 1] = {};
+			for (uint32_t length = 1; length <= MaxCodeBits; ++length)
+			{
+				code = (code + lengthCounts[length - 1]) << 1;
+				if (code + lengthCounts[length] > (1u << length)) return false;
+
+				m_FirstCode[length] = code;
+				m_FirstOffset[length] = offset;
+				m_Counts[length] = lengthCounts[length];
+				nextCode[length] = code;
+				nextOffset[length] = offset;
+				offset += lengthCounts[length];
+			}
+
+			memset(m_Fast, 0, sizeof(m_Fast));
+			for (uint32_t symbol = 0; symbol < count; ++symbol)
+			{
+				uint32_t length = lengths[symbol];
+				if (length == 0) continue;
+
+				m_Symbols[nextOffset[length]++] = static_cast<uint16_t>(symbol);
+				uint32_t symbolCode = nextCode[length]++;
+				if (length > FastBits) continue;
+
+				//Codes are stored most significant bit first, so reverse it to index by the next input bits
+				uint32_t reversed = 0;
+				for (uint32_t bit = 0; bit < length; ++bit) reversed |= ((symbolCode >> bit) & 1) << (length - 1 - bit);
+				for (uint32_t entry = reversed; entry < (1u << FastBits); entry += 1u << length)
+				{
+					m_Fast[entry] = static_cast<uint16_t>(symbol << 4 | length);
+				}
+			}
+			return true;
+		}
+
+		//Decode the symbol at the bottom of the bit buffer, which must hold at least MaxCodeBits bits.
+		//Returns the code length in length, 0 if the bits are not a valid code
+		uint32_t Decode(uint64_t bits, uint32_t& length) const
+		{
+			uint16_t entry = m_Fast[bits & ((1u << FastBits) - 1)];
+			if (entry)
+			{
+				length = entry & 15;
+				return entry >> 4;
+			}
+
+			uint32_t code = 0;
+			for (uint32_t bitLength = 1; bitLength <= MaxCodeBits; ++bitLength)
+			{
+				code = code << 1 | static_cast<uint32_t>((bits >> (bitLength - 1)) & 1);
+				if (code - m_FirstCode[bitLength] < m_Counts[bitLength])
+				{
+					length = bitLength;
+					return m_Symbols[m_FirstOffset[bitLength] + code - m_FirstCode[bitLength]];
+				}
+			}
+			length = 0;
+			return 0;
+		}
+
+	private:
+		uint16_t m_Fast[1 << FastBits];        // symbol << 4 | length, 0 if the code is longer than FastBits
+		uint32_t m_FirstCode[MaxCodeBits + 1];
+		uint32_t m_FirstOffset[MaxCodeBits + 1];
+		uint32_t m_Counts[MaxCodeBits + 1];
+		uint16_t m_Symbols[288];
+	};
+
+	//Reads the input least significant bit first
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t* data, size_t size) : m_Data(data), m_Size(size) {}
+
+		//Make sure the buffer holds at least 57 bits. Past the end of the input it is padded with zeros,
+		//which is caught by Overrun once those bits are used
+		void Refill()
+		{
+			//Whole bytes from an unaligned little-endian load while there are 8 left. The top bits of the buffer may
+			//take part of the next byte, which is harmless as it is ORed in again with the same value
+			if (m_Count > 56) return;
+			if (m_Position + 8 <= m_Size)
+			{
+				uint64_t word;
+				memcpy(&word, m_Data + m_Position, 8);
+				m_Bits |= word << m_Count;
+				uint32_t bytes = (64 - m_Count) >> 3;
+				m_Position += bytes;
+				m_Count += bytes * 8;
+				return;
+			}
+			while (m_Count <= 56)
+			{
+				uint64_t byte = m_Position < m_Size ? m_Data[m_Position] : 0;
+				m_Bits |= byte << m_Count;
+				++m_Position;
+				m_Count += 8;
+			}
+		}
+
+		uint64_t Peek() const { return m_Bits; }
+
+		void Skip(uint32_t count)
+		{
+			m_Bits >>= count;
+			m_Count -= count;
+		}
+
+		uint32_t Read(uint32_t count)
+		{
+			if (m_Count < count) Refill();
+			uint32_t value = static_cast<uint32_t>(m_Bits & ((1ull << count) - 1));
+			Skip(count);
+			return value;
+		}
+
+		//Discard bits up to the next byte boundary
+		void AlignToByte() { Skip(m_Count & 7); }
+
+		//Bytes of input used so far, the buffered bits having been handed back
+		size_t Consumed() const { return m_Position - m_Count / 8; }
+
+		bool Overrun() const { return Consumed() > m_Size; }
+
+		//Copy bytes straight from the input after AlignToByte, for stored blocks
+		bool CopyBytes(uint8_t* destination, size_t count)
+		{
+			size_t start = Consumed();
+			if (start + count > m_Size) return false;
+			memcpy(destination, m_Data + start, count);
+			m_Position = start + count;
+			m_Bits = 0;
+			m_Count = 0;
+			return true;
+		}
+
+	private:
+		const uint8_t* m_Data;
+		size_t         m_Size;
+		size_t         m_Position = 0;
+		uint64_t       m_Bits = 0;
+		uint32_t       m_Count = 0;
+	};
+
+	//Tables for the fixed codes of block type 1, built once
+	struct FixedTables
+	{
+		HuffmanTable literals;
+		HuffmanTable distances;
+
+		FixedTables()
+		{
+			uint8_t lengths[288];
+			std::fill(lengths, lengths + 144, 8);
+			std::fill(lengths + 144, lengths + 256, 9);
+			std::fill(lengths + 256, lengths + 280, 7);
+			std::fill(lengths + 280, lengths + 288, 8);
+			literals.Build(lengths, 288);
+
+			std::fill(lengths, lengths + 30, 5);
+			distances.Build(lengths, 30);
+		}
+	};
+
+	//Read the code lengths of a dynamic block and build its tables
+	bool ReadDynamicTables(BitReader& bits, HuffmanTable& literals, HuffmanTable& distances, std::string& error)
+	{
+		uint32_t literalCount  = bits.Read(5) + 257;
+		uint32_t distanceCount = bits.Read(5) + 1;
+		uint32_t codeLengthCount = bits.Read(4) + 4;
+		if (literalCount > 286 || distanceCount > 30)
+		{
+			error = "Too many codes in dynamic block";
+			return false;
+		}
+
+		uint8_t codeLengthLengths[19] = {};
+		for (uint32_t i = 0; i < codeLengthCount; ++i) codeLengthLengths[CodeLengthOrder[i]] = static_cast<uint8_t>(bits.Read(3));
+
+		HuffmanTable codeLengths;
+		if (!codeLengths.Build(codeLengthLengths, 19))
+		{
+			error = "Invalid code length code";
+			return false;
+		}
+
+		//Literal and distance lengths run on from one to the other, so repeats may cross between them
+		uint8_t lengths[286 + 30] = {};
+		uint32_t total = literalCount + distanceCount;
+		uint32_t i = 0;
+		while (i < total)
+		{
+			bits.Refill();
+			uint32_t length;
+			uint32_t symbol = codeLengths.Decode(bits.Peek(), length);
+			if (length == 0)
+			{
+				error = "Invalid code length";
+				return false;
+			}
+			bits.Skip(length);
+
+			if (symbol < 16)
+			{
+				lengths[i++] = static_cast<uint8_t>(symbol);
+				continue;
+			}
+
+			uint8_t value = 0;
+			uint32_t repeat;
+			if (symbol == 16)
+			{
+				if (i == 0)
+				{
+					error = "Repeated code length with no previous length";
+					return false;
+				}
+				value = lengths[i - 1];
+				repeat = 3 + bits.Read(2);
+			}
+			else if (symbol == 17) repeat = 3 + bits.Read(3);
+			else                   repeat = 11 + bits.Read(7);
+
+			if (i + repeat > total)
+			{
+				error = "Code lengths overflow";
+				return false;
+			}
+			memset(lengths + i, value, repeat);
+			i += repeat;
+		}
+
+		if (lengths[256] == 0)
+		{
+			error = "Block has no end code";
+			return false;
+		}
+		if (!literals.Build(lengths, literalCount) || !distances.Build(lengths + literalCount, distanceCount))
+		{
+			error = "Invalid Huffman code";
+			return false;
+		}
+		return true;
+	}
+
+	//Decompress deflate data, returning the number of input bytes used or 0 on failure
+	size_t InflateData(const uint8_t* source, size_t size, std::vector<uint8_t>& output, std::string& error, size_t sizeHint)
+	{
+		static const FixedTables fixed;
+
+		//Written through a raw pointer with the vector grown ahead of it, then trimmed to the real size at the end
+		size_t position = output.size();
+		output.resize(position + std::max<size_t>(sizeHint, 1024));
+
+		BitReader bits(source, size);
+		HuffmanTable dynamicLiterals, dynamicDistances;
+		bool finalBlock = false;
+		while (!finalBlock)
+		{
+			bits.Refill();
+			finalBlock = bits.Read(1) != 0;
+			uint32_t type = bits.Read(2);
+
+			if (type == 0)
+			{
+				//Stored block - a length, its complement and that many bytes
+				bits.AlignToByte();
+				uint32_t length = bits.Read(16);
+				uint32_t complement = bits.Read(16);
+				if ((length ^ 0xffff) != complement)
+				{
+					error = "Corrupt stored block length";
+					return 0;
+				}
+				if (position + length > output.size()) output.resize(std::max(output.size() * 2, position + length));
+				if (!bits.CopyBytes(output.data() + position, length))
+				{
+					error = "Truncated stored block";
+					return 0;
+				}
+				position += length;
+				continue;
+			}
+
+			const HuffmanTable* literals = &fixed.literals;
+			const HuffmanTable* distances = &fixed.distances;
+			if (type == 2)
+			{
+				if (!ReadDynamicTables(bits, dynamicLiterals, dynamicDistances, error)) return 0;
+				literals = &dynamicLiterals;
+				distances = &dynamicDistances;
+			}
+			else if (type != 1)
+			{
+				error = "Invalid block type";
+				return 0;
+			}
+
+			for (;;)
+			{
+				//Room for the longest match, so the copies below need no checks. Truncated input reads as zeros,
+				//which could decode to literals forever, so check for running off the end whenever the output grows
+				if (position + 258 > output.size())
+				{
+					if (bits.Overrun())
+					{
+						error = "Truncated deflate data";
+						return 0;
+					}
+					output.resize(output.size() * 2);
+				}
+				uint8_t* out = output.data();
+
+				bits.Refill();
+				uint32_t length;
+				uint32_t symbol = literals->Decode(bits.Peek(), length);
+				if (length == 0)
+				{
+					error = "Invalid literal/length code";
+					return 0;
+				}
+				bits.Skip(length);
+
+				if (symbol < 256)
+				{
+					out[position++] = static_cast<uint8_t>(symbol);
+					continue;
+				}
+				if (symbol == 256) break;
+
+				symbol -= 257;
+				if (symbol >= 29)
+				{
+					error = "Invalid length symbol";
+					return 0;
+				}
+				uint32_t matchLength = LengthBase[symbol] + bits.Read(LengthExtra[symbol]);
+
+				bits.Refill();
+				uint32_t distanceSymbol = distances->Decode(bits.Peek(), length);
+				if (length == 0 || distanceSymbol >= 30)
+				{
+					error = "Invalid distance code";
+					return 0;
+				}
+				bits.Skip(length);
+				uint32_t distance = DistanceBase[distanceSymbol] + bits.Read(DistanceExtra[distanceSymbol]);
+				if (distance > position)
+				{
+					error = "Distance before start of output";
+					return 0;
+				}
+
+				//Overlapping matches repeat the bytes just written, so copy forwards a byte at a time
+				const uint8_t* from = out + position - distance;
+				uint8_t* to = out + position;
+				if (distance >= matchLength) memcpy(to, from, matchLength);
+				else for (uint32_t i = 0; i < matchLength; ++i) to[i] = from[i];
+				position += matchLength;
+			}
+
+			if (bits.Overrun())
+			{
+				error = "Truncated deflate data";
+				return 0;
+			}
+		}
+
+		output.resize(position);
+		return bits.Consumed();
+	}
+
+	//Adler-32 checksum, as used by zlib
+	uint32_t Adler32(const uint8_t* data, size_t size)
+	{
+		uint32_t a = 1, b = 0;
+		while (size > 0)
+		{
+			//The largest run that cannot overflow before taking the modulus
+			size_t run = std::min<size_t>(size, 5552);
+			size -= run;
+			for (size_t i = 0; i < run; ++i)
+			{
+				a += data[i];
+				b += a;
+			}
+			data += run;
+			a %= 65521;
+			b %= 65521;
+		}
+		return b << 16 | a;
+	}
+}
+
+//Decompress raw deflate data, appending to the output
+bool Inflate(const uint8_t* source, size_t size, std::vector<uint8_t>& output, std::string& error, size_t sizeHint)
+{
+	return InflateData(source, size, output, error, sizeHint) != 0;
+}
+
+//Decompress a zlib stream, checking its header and checksum
+bool ZlibDecompress(const uint8_t* source, size_t size, std::vector<uint8_t>& output, std::string& error, size_t sizeHint)
+{
+	//Compression method 8 (deflate) with a window of at most 32KB, no preset dictionary, and a header checksum
+	if (size < 6 || (source[0] & 15) != 8 || (source[0] >> 4) > 7 || (source[1] & 0x20) || ((source[0] << 8) | source[1]) % 31 != 0)
+	{
+		error = "Invalid zlib header";
+		return false;
+	}
+
+	size_t start = output.size();
+	size_t consumed = InflateData(source + 2, size - 2, output, error, sizeHint);
+	if (consumed == 0) return false;
+
+	const uint8_t* trailer = source + 2 + consumed;
+	if (2 + consumed + 4 > size)
+	{
+		error = "Missing zlib checksum";
+		return false;
+	}
+	uint32_t expected = static_cast<uint32_t>(trailer[0]) << 24 | trailer[1] << 16 | trailer[2] << 8 | trailer[3];
+	if (Adler32(output.data() + start, output.size() - start) != expected)
+	{
+		error = "zlib checksum mismatch";
+		return false;
+	}
+	return true;
+}
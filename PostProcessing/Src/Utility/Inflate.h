@@ -0,0 +1,18 @@
+//--------------------------------------------------------------------------------------
+// Deflate decompression (RFC 1951) and the zlib wrapper around it (RFC 1950)
+//--------------------------------------------------------------------------------------
+// Used by the PNG decoder, whose image data is one zlib stream split across IDAT chunks.
+// Huffman codes are decoded with a lookup table indexed by the next few bits of input, so
+// most symbols take a single table read; only rare long codes are decoded bit by bit.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Decompress raw deflate data, appending to the output. sizeHint reserves space up front when the size is known.
+//Returns false with an error if the data is corrupt or truncated
+bool Inflate(const uint8_t* source, size_t size, std::vector<uint8_t>& output, std::string& error, size_t sizeHint = 0);
+
+//Decompress a zlib stream - a two byte header, deflate data and an Adler-32 checksum of the output, which is checked
+bool ZlibDecompress(const uint8_t* source, size_t size, std::vector<uint8_t>& output, std::string& error, size_t sizeHint = 0);
@@ -0,0 +1,956 @@
+//--------------------------------------------------------------------------------------
+// JPEG decoding, see ImageDecoders.h
+//--------------------------------------------------------------------------------------
+// Baseline and progressive scans are both decoded into a buffer of quantised coefficients for
+// every block, so the two share everything after the entropy decoding. The inverse DCT, chroma
+// upsampling and colour conversion then follow libjpeg's defaults (the accurate integer IDCT and
+// "fancy" triangle-filter upsampling), so results match the usual desktop decoders closely.
+
+#include "ImageDecoders.h"
+#include "CThreadPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace
+{
+	//Natural (row-major) position of each coefficient in zig-zag order. The padding catches
+	//corrupt runs that go past the last coefficient, as libjpeg does
+	const uint8_t ZigZag[64 + 16] =
+	{
+		 0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+		12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+		35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+		58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+		63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+	};
+
+	//Largest image accepted, to keep the coefficient buffers well within memory
+	const uint64_t MaxPixels = 1ull << 28;
+
+	uint32_t ReadBE16(const uint8_t* data) { return static_cast<uint32_t>(data[0]) << 8 | data[1]; }
+
+	uint8_t Clamp(int64_t value) { return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value)); }
+
+	//Run a function over ranges of [0, count) on the pool's workers, or all at once on this thread without one
+	void ParallelFor(CThreadPool* threads, uint32_t count, const std::function<void(uint32_t, uint32_t)>& function)
+	{
+		if (!threads || threads->GetThreadCount() == 0 || count < 2)
+		{
+			function(0, count);
+			return;
+		}
+		uint32_t step = std::max(count / (threads->GetThreadCount() * 4), 1u);
+		for (uint32_t first = 0; first < count; first += step)
+		{
+			uint32_t end = std::min(first + step, count);
+			threads->Submit([&function, first, end]() { function(first, end); });
+		}
+		threads->Wait();
+	}
+
+
+	//-------------------------------------
+	// Entropy decoding
+	//-------------------------------------
+
+	//Huffman table from a DHT segment
+	struct HuffmanTable
+	{
+		static const uint32_t FastBits = 9;
+
+		bool     defined = false;
+		uint16_t fast[1 << FastBits] = {}; // symbol << 8 | length for codes up to FastBits long, 0 for longer codes
+		int32_t  maxCode[18] = {};         // Largest code of each length, -1 if none
+		int32_t  valueOffset[17] = {};     // Index in values of the first code of each length, less that code
+		uint8_t  values[256] = {};
+
+		//Build from the count of codes of each length (1-16) and the symbols in code order.
+		//Returns false if there are more codes than the lengths allow
+		bool Build(const uint8_t counts[16], const uint8_t* symbols, uint32_t symbolCount)
+		{
+			memcpy(values, symbols, symbolCount);
+			memset(fast, 0, sizeof(fast));
+
+			uint32_t code = 0;
+			uint32_t index = 0;
+			for (uint32_t length = 1; length <= 16; ++length)
+			{
+				valueOffset[length] = static_cast<int32_t>(index) - static_cast<int32_t>(code);
+				for (uint32_t i = 0; i < counts[length - 1]; ++i, ++code, ++index)
+				{
+					if (length <= FastBits)
+					{
+						//Every entry starting with this code
+						uint32_t first = code << (FastBits - length);
+						for (uint32_t entry = 0; entry < (1u << (FastBits - length)); ++entry)
+						{
+							fast[first + entry] = static_cast<uint16_t>(values[index] << 8 | length);
+						}
+					}
+				}
+				maxCode[length] = counts[length - 1] ? static_cast<int32_t>(code) - 1 : -1;
+				if (code > (1u << length)) return false;
+				code <<= 1;
+			}
+			maxCode[17] = 0x7fffffff; // Stops the search for a code that does not exist
+			defined = true;
+			return true;
+		}
+	};
+
+	//Reads the entropy coded data of a scan, most significant bit first. Stuffed zero bytes after 0xff are removed,
+	//and reaching a marker supplies zeros from then on
+	class EntropyReader
+	{
+	public:
+		EntropyReader(const uint8_t* data, size_t size, size_t position) : m_Data(data), m_Size(size), m_Position(position) {}
+
+		//Make sure the buffer holds at least 25 bits
+		void Fill()
+		{
+			while (m_Count <= 24)
+			{
+				uint32_t byte = 0;
+				if (!m_AtMarker && m_Position < m_Size)
+				{
+					byte = m_Data[m_Position];
+					if (byte == 0xff)
+					{
+						uint8_t next = m_Position + 1 < m_Size ? m_Data[m_Position + 1] : 0xd9;
+						if (next == 0) m_Position += 2;
+						else
+						{
+							m_AtMarker = true;
+							byte = 0;
+						}
+					}
+					else ++m_Position;
+				}
+				m_Bits |= byte << (24 - m_Count);
+				m_Count += 8;
+			}
+		}
+
+		uint32_t GetBits(uint32_t count)
+		{
+			if (count == 0) return 0;
+			if (m_Count < count) Fill();
+			uint32_t value = m_Bits >> (32 - count);
+			m_Bits <<= count;
+			m_Count -= count;
+			return value;
+		}
+
+		uint32_t GetBit() { return GetBits(1); }
+
+		//Read a count-bit value and extend it to a signed coefficient, as in F.2.2.1 of the specification
+		int Receive(uint32_t count)
+		{
+			if (count == 0) return 0;
+			int value = static_cast<int>(GetBits(count));
+			return value < (1 << (count - 1)) ? value - (1 << count) + 1 : value;
+		}
+
+		uint32_t Decode(const HuffmanTable& table)
+		{
+			Fill();
+			uint16_t entry = table.fast[m_Bits >> (32 - HuffmanTable::FastBits)];
+			if (entry)
+			{
+				uint32_t length = entry & 0xff;
+				m_Bits <<= length;
+				m_Count -= length;
+				return entry >> 8;
+			}
+
+			uint32_t length = HuffmanTable::FastBits + 1;
+			while (static_cast<int32_t>(m_Bits >> (32 - length)) > table.maxCode[length]) ++length;
+			if (length > 16)
+			{
+				//Not a valid code - return a symbol that ends the block and carry on
+				m_Corrupt = true;
+				return 0;
+			}
+			int32_t code = static_cast<int32_t>(m_Bits >> (32 - length));
+			m_Bits <<= length;
+			m_Count -= length;
+			return table.values[(table.valueOffset[length] + code) & 0xff];
+		}
+
+		//Skip to just past the next restart marker and start reading afresh
+		void Restart()
+		{
+			m_Bits = 0;
+			m_Count = 0;
+			m_AtMarker = false;
+			while (m_Position + 1 < m_Size && !(m_Data[m_Position] == 0xff && m_Data[m_Position + 1] >= 0xd0 && m_Data[m_Position + 1] <= 0xd7)) ++m_Position;
+			m_Position = std::min(m_Position + 2, m_Size);
+		}
+
+		//Position of the next marker after the scan's data, skipping any restart markers
+		size_t FindNextMarker() const
+		{
+			size_t position = m_Position;
+			while (position + 1 < m_Size)
+			{
+				uint8_t next = m_Data[position + 1];
+				if (m_Data[position] == 0xff && next != 0 && next != 0xff && !(next >= 0xd0 && next <= 0xd7)) return position;
+				++position;
+			}
+			return m_Size;
+		}
+
+		bool IsCorrupt() const { return m_Corrupt; }
+
+	private:
+		const uint8_t* m_Data;
+		size_t   m_Size;
+		size_t   m_Position;
+		uint32_t m_Bits = 0;
+		uint32_t m_Count = 0;
+		bool     m_AtMarker = false;
+		bool     m_Corrupt = false;
+	};
+
+
+	//-------------------------------------
+	// Inverse DCT
+	//-------------------------------------
+
+	//The accurate integer inverse DCT of libjpeg's jidctint.c, with 13-bit fixed point constants
+	const int ConstBits = 13;
+	const int Pass1Bits = 2;
+	const int Fix_0_298631336 = 2446,  Fix_0_390180644 = 3196,  Fix_0_541196100 = 4433,  Fix_0_765366865 = 6270;
+	const int Fix_0_899976223 = 7373,  Fix_1_175875602 = 9633,  Fix_1_501321110 = 12299, Fix_1_847759065 = 15137;
+	const int Fix_1_961570560 = 16069, Fix_2_053119869 = 16819, Fix_2_562915447 = 20995, Fix_3_072711026 = 25172;
+
+	int64_t Descale(int64_t value, int bits) { return (value + (1 << (bits - 1))) >> bits; }
+
+	//One dimensional 8 point IDCT giving out[0..7] scaled by 2^ConstBits (before descaling). Done in 64 bits, which
+	//costs nothing on x64, so corrupt coefficients cannot overflow
+	void IDCT1D(int64_t s0, int64_t s1, int64_t s2, int64_t s3, int64_t s4, int64_t s5, int64_t s6, int64_t s7, int64_t out[8])
+	{
+		//Even part
+		int64_t z1 = (s2 + s6) * Fix_0_541196100;
+		int64_t tmp2 = z1 + s6 * -Fix_1_847759065;
+		int64_t tmp3 = z1 + s2 * Fix_0_765366865;
+		int64_t tmp0 = (s0 + s4) * (1 << ConstBits);
+		int64_t tmp1 = (s0 - s4) * (1 << ConstBits);
+		int64_t tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3;
+		int64_t tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+
+		//Odd part
+		tmp0 = s7; tmp1 = s5; tmp2 = s3; tmp3 = s1;
+		z1 = tmp0 + tmp3;
+		int64_t z2 = tmp1 + tmp2, z3 = tmp0 + tmp2, z4 = tmp1 + tmp3;
+		int64_t z5 = (z3 + z4) * Fix_1_175875602;
+		tmp0 *= Fix_0_298631336;  tmp1 *= Fix_2_053119869;  tmp2 *= Fix_3_072711026;  tmp3 *= Fix_1_501321110;
+		z1 *= -Fix_0_899976223;   z2 *= -Fix_2_562915447;   z3 *= -Fix_1_961570560;   z4 *= -Fix_0_390180644;
+		z3 += z5;
+		z4 += z5;
+		tmp0 += z1 + z3;  tmp1 += z2 + z4;  tmp2 += z2 + z3;  tmp3 += z1 + z4;
+
+		out[0] = tmp10 + tmp3;  out[7] = tmp10 - tmp3;
+		out[1] = tmp11 + tmp2;  out[6] = tmp11 - tmp2;
+		out[2] = tmp12 + tmp1;  out[5] = tmp12 - tmp1;
+		out[3] = tmp13 + tmp0;  out[4] = tmp13 - tmp0;
+	}
+
+	//Dequantise and inverse transform a block into 8x8 samples
+	void InverseDCT(const int16_t* coefficients, const uint16_t* quantisation, uint8_t* output, size_t pitch)
+	{
+		int64_t workspace[64];
+		int64_t column[8];
+		for (int x = 0; x < 8; ++x)
+		{
+			const int16_t* in = coefficients + x;
+			const uint16_t* q = quantisation + x;
+			if (!in[8] && !in[16] && !in[24] && !in[32] && !in[40] && !in[48] && !in[56])
+			{
+				int64_t dc = static_cast<int64_t>(in[0]) * q[0] * (1 << Pass1Bits);
+				for (int y = 0; y < 8; ++y) workspace[y * 8 + x] = dc;
+				continue;
+			}
+			IDCT1D(static_cast<int64_t>(in[0]) * q[0], in[8] * q[8], in[16] * q[16], in[24] * q[24], in[32] * q[32], in[40] * q[40], in[48] * q[48], in[56] * q[56], column);
+			for (int y = 0; y < 8; ++y) workspace[y * 8 + x] = Descale(column[y], ConstBits - Pass1Bits);
+		}
+
+		const int rowBits = ConstBits + Pass1Bits + 3;
+		for (int y = 0; y < 8; ++y, output += pitch)
+		{
+			const int64_t* in = workspace + y * 8;
+			if (!in[1] && !in[2] && !in[3] && !in[4] && !in[5] && !in[6] && !in[7])
+			{
+				memset(output, Clamp(Descale(in[0], Pass1Bits + 3) + 128), 8);
+				continue;
+			}
+			int64_t row[8];
+			IDCT1D(in[0], in[1], in[2], in[3], in[4], in[5], in[6], in[7], row);
+			for (int x = 0; x < 8; ++x) output[x] = Clamp(Descale(row[x], rowBits) + 128);
+		}
+	}
+
+
+	//-------------------------------------
+	// Colour conversion
+	//-------------------------------------
+
+	//YCbCr to RGB lookup tables with 16-bit fixed point, as in libjpeg's jdcolor.c
+	struct ColourTables
+	{
+		int crToR[256], cbToB[256], crToG[256], cbToG[256];
+
+		ColourTables()
+		{
+			const int ScaleBits = 16;
+			const int Half = 1 << (ScaleBits - 1);
+			auto fix = [](double value) { return static_cast<int>(value * 65536.0 + 0.5); };
+			for (int i = 0; i < 256; ++i)
+			{
+				int x = i - 128;
+				crToR[i] = (fix(1.40200) * x + Half) >> ScaleBits;
+				cbToB[i] = (fix(1.77200) * x + Half) >> ScaleBits;
+				crToG[i] = -fix(0.71414) * x;
+				cbToG[i] = -fix(0.34414) * x + Half;
+			}
+		}
+	};
+
+
+	//-------------------------------------
+	// Decoder
+	//-------------------------------------
+
+	struct Component
+	{
+		uint8_t  id = 0;
+		uint32_t h = 1, v = 1;             // Sampling factors
+		uint32_t quantTable = 0;
+		uint32_t width = 0, height = 0;    // Samples covering the image
+		uint32_t blocksWide = 0, blocksHigh = 0; // Blocks stored, padded out to whole MCUs
+		uint32_t dcTable = 0, acTable = 0;
+		int      dcPredictor = 0;           // Kept to 16 bits, like the coefficients, so corrupt data cannot overflow it
+		std::vector<int16_t> coefficients; // 64 per block, natural order, quantised
+		std::vector<uint8_t> samples;      // blocksWide * 8 wide, after the inverse DCT
+
+		int16_t* Block(uint32_t x, uint32_t y) { return coefficients.data() + (static_cast<size_t>(y) * blocksWide + x) * 64; }
+	};
+
+	class JPEGDecoder
+	{
+	public:
+		JPEGDecoder(const uint8_t* data, size_t size) : m_Data(data), m_Size(size) {}
+
+		bool Decode(CImage& image, std::string& error, CThreadPool* threads)
+		{
+			if (m_Size < 4 || m_Data[0] != 0xff || m_Data[1] != 0xd8)
+			{
+				error = "Not a JPEG file";
+				return false;
+			}
+
+			size_t position = 2;
+			for (;;)
+			{
+				//Markers may be preceded by any number of 0xff fill bytes
+				while (position < m_Size && m_Data[position] == 0xff && position + 1 < m_Size && m_Data[position + 1] == 0xff) ++position;
+				if (position + 2 > m_Size || m_Data[position] != 0xff)
+				{
+					//Some files are cut short after the last scan, which is fine once there is a frame
+					if (m_FrameRead && m_ScanCount > 0) break;
+					error = "Truncated JPEG file";
+					return false;
+				}
+				uint8_t marker = m_Data[position + 1];
+				position += 2;
+				if (marker == 0xd9) break; // End of image
+				if (marker >= 0xd0 && marker <= 0xd7) continue;
+
+				if (position + 2 > m_Size)
+				{
+					error = "Truncated JPEG segment";
+					return false;
+				}
+				uint32_t length = ReadBE16(m_Data + position);
+				if (length < 2 || position + length > m_Size)
+				{
+					error = "Truncated JPEG segment";
+					return false;
+				}
+				const uint8_t* segment = m_Data + position + 2;
+				uint32_t segmentSize = length - 2;
+				position += length;
+
+				bool ok = true;
+				switch (marker)
+				{
+				case 0xc0: case 0xc1: ok = ReadFrame(segment, segmentSize, false, error); break;
+				case 0xc2:            ok = ReadFrame(segment, segmentSize, true, error); break;
+				case 0xc4:            ok = ReadHuffmanTables(segment, segmentSize, error); break;
+				case 0xdb:            ok = ReadQuantisationTables(segment, segmentSize, error); break;
+				case 0xdd:            m_RestartInterval = segmentSize >= 2 ? ReadBE16(segment) : 0; break;
+				case 0xda:            ok = ReadScan(segment, segmentSize, position, error); break;
+				case 0xee:
+					//Adobe segment, whose transform flag says whether three components are YCbCr or RGB
+					if (segmentSize >= 12 && memcmp(segment, "Adobe", 5) == 0)
+					{
+						m_HasAdobe = true;
+						m_AdobeTransform = segment[11];
+					}
+					break;
+				default:
+					//Other frame types are lossless, hierarchical or arithmetic coded
+					if ((marker >= 0xc3 && marker <= 0xcf) && marker != 0xc4 && marker != 0xc8 && marker != 0xcc)
+					{
+						error = "Unsupported JPEG coding (only baseline and progressive Huffman)";
+						return false;
+					}
+					break;
+				}
+				if (!ok) return false;
+			}
+
+			if (!m_FrameRead || m_ScanCount == 0)
+			{
+				error = "JPEG has no image data";
+				return false;
+			}
+			ProduceImage(image, threads);
+			return true;
+		}
+
+	private:
+		bool ReadFrame(const uint8_t* segment, uint32_t size, bool progressive, std::string& error)
+		{
+			if (m_FrameRead || size < 6)
+			{
+				error = "Invalid JPEG frame";
+				return false;
+			}
+			m_Progressive = progressive;
+			uint32_t precision = segment[0];
+			m_Height = ReadBE16(segment + 1);
+			m_Width = ReadBE16(segment + 3);
+			uint32_t count = segment[5];
+			if (precision != 8 || (count != 1 && count != 3) || size < 6 + count * 3)
+			{
+				error = "Unsupported JPEG format (only 8-bit greyscale and three component images)";
+				return false;
+			}
+			if (m_Width == 0 || m_Height == 0 || static_cast<uint64_t>(m_Width) * m_Height > MaxPixels)
+			{
+				error = "Invalid JPEG size";
+				return false;
+			}
+
+			m_Components.resize(count);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				Component& component = m_Components[i];
+				component.id = segment[6 + i * 3];
+				component.h = segment[7 + i * 3] >> 4;
+				component.v = segment[7 + i * 3] & 15;
+				component.quantTable = segment[8 + i * 3];
+				if (component.h < 1 || component.h > 4 || component.v < 1 || component.v > 4 || component.quantTable > 3)
+				{
+					error = "Invalid JPEG component";
+					return false;
+				}
+				m_MaxH = std::max(m_MaxH, component.h);
+				m_MaxV = std::max(m_MaxV, component.v);
+			}
+
+			//Components are stored as whole MCUs of h x v blocks, so interleaved scans never go off the end
+			m_MCUsWide = (m_Width + 8 * m_MaxH - 1) / (8 * m_MaxH);
+			m_MCUsHigh = (m_Height + 8 * m_MaxV - 1) / (8 * m_MaxV);
+			for (Component& component : m_Components)
+			{
+				component.width = (m_Width * component.h + m_MaxH - 1) / m_MaxH;
+				component.height = (m_Height * component.v + m_MaxV - 1) / m_MaxV;
+				component.blocksWide = m_MCUsWide * component.h;
+				component.blocksHigh = m_MCUsHigh * component.v;
+				component.coefficients.assign(static_cast<size_t>(component.blocksWide) * component.blocksHigh * 64, 0);
+			}
+			m_FrameRead = true;
+			return true;
+		}
+
+		bool ReadHuffmanTables(const uint8_t* segment, uint32_t size, std::string& error)
+		{
+			uint32_t position = 0;
+			while (position + 17 <= size)
+			{
+				uint32_t type = segment[position] >> 4;
+				uint32_t index = segment[position] & 15;
+				const uint8_t* counts = segment + position + 1;
+				uint32_t symbolCount = 0;
+				for (int i = 0; i < 16; ++i) symbolCount += counts[i];
+				if (type > 1 || index > 3 || symbolCount > 256 || position + 17 + symbolCount > size)
+				{
+					error = "Invalid JPEG Huffman table";
+					return false;
+				}
+				HuffmanTable& table = type == 0 ? m_DCTables[index] : m_ACTables[index];
+				if (!table.Build(counts, segment + position + 17, symbolCount))
+				{
+					error = "Invalid JPEG Huffman table";
+					return false;
+				}
+				position += 17 + symbolCount;
+			}
+			return true;
+		}
+
+		bool ReadQuantisationTables(const uint8_t* segment, uint32_t size, std::string& error)
+		{
+			uint32_t position = 0;
+			while (position < size)
+			{
+				uint32_t precision = segment[position] >> 4;
+				uint32_t index = segment[position] & 15;
+				uint32_t tableSize = precision ? 128 : 64;
+				if (precision > 1 || index > 3 || position + 1 + tableSize > size)
+				{
+					error = "Invalid JPEG quantisation table";
+					return false;
+				}
+				const uint8_t* values = segment + position + 1;
+				for (uint32_t k = 0; k < 64; ++k)
+				{
+					m_Quantisation[index][ZigZag[k]] = static_cast<uint16_t>(precision ? ReadBE16(values + 2 * k) : values[k]);
+				}
+				position += 1 + tableSize;
+			}
+			return true;
+		}
+
+		//Read a scan header then decode the entropy coded data following it, leaving position at the next marker
+		bool ReadScan(const uint8_t* segment, uint32_t size, size_t& position, std::string& error)
+		{
+			if (!m_FrameRead || size < 1 || size < 4u + segment[0] * 2)
+			{
+				error = "Invalid JPEG scan";
+				return false;
+			}
+
+			uint32_t count = segment[0];
+			std::vector<Component*> components;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				uint8_t id = segment[1 + i * 2];
+				auto found = std::find_if(m_Components.begin(), m_Components.end(), [id](const Component& c) { return c.id == id; });
+				if (found == m_Components.end())
+				{
+					error = "JPEG scan refers to an unknown component";
+					return false;
+				}
+				found->dcTable = segment[2 + i * 2] >> 4;
+				found->acTable = segment[2 + i * 2] & 15;
+				if (found->dcTable > 3 || found->acTable > 3)
+				{
+					error = "Invalid JPEG scan";
+					return false;
+				}
+				components.push_back(&*found);
+			}
+			m_SpectralStart = segment[1 + count * 2];
+			m_SpectralEnd = segment[2 + count * 2];
+			m_ApproximationHigh = segment[3 + count * 2] >> 4;
+			m_ApproximationLow = segment[3 + count * 2] & 15;
+
+			bool dcOnly = m_SpectralStart == 0;
+			if (m_Progressive)
+			{
+				if (m_SpectralEnd > 63 || m_SpectralStart > m_SpectralEnd || (dcOnly && m_SpectralEnd != 0) || (!dcOnly && count != 1) || m_ApproximationLow > 13)
+				{
+					error = "Invalid progressive JPEG scan";
+					return false;
+				}
+			}
+			else
+			{
+				m_SpectralStart = 0;
+				m_SpectralEnd = 63;
+				m_ApproximationHigh = m_ApproximationLow = 0;
+			}
+
+			//Check the tables the scan will use exist
+			for (Component* component : components)
+			{
+				bool needsDC = !m_Progressive || (dcOnly && m_ApproximationHigh == 0);
+				bool needsAC = !m_Progressive || !dcOnly;
+				if ((needsDC && !m_DCTables[component->dcTable].defined) || (needsAC && !m_ACTables[component->acTable].defined))
+				{
+					error = "JPEG scan uses an undefined Huffman table";
+					return false;
+				}
+				component->dcPredictor = 0;
+			}
+			m_EOBRun = 0;
+
+			EntropyReader reader(m_Data, m_Size, position);
+			uint32_t restartCount = 0;
+			auto restart = [&]()
+			{
+				if (m_RestartInterval == 0 || restartCount++ == 0 || (restartCount - 1) % m_RestartInterval != 0) return;
+				reader.Restart();
+				for (Component* component : components) component->dcPredictor = 0;
+				m_EOBRun = 0;
+			};
+
+			if (components.size() == 1)
+			{
+				//A single component scan covers just the blocks inside the image, with no MCU padding
+				Component& component = *components[0];
+				uint32_t blocksWide = (component.width + 7) / 8;
+				uint32_t blocksHigh = (component.height + 7) / 8;
+				for (uint32_t y = 0; y < blocksHigh; ++y)
+				{
+					for (uint32_t x = 0; x < blocksWide; ++x)
+					{
+						restart();
+						DecodeBlock(reader, component, component.Block(x, y));
+					}
+				}
+			}
+			else
+			{
+				for (uint32_t mcuY = 0; mcuY < m_MCUsHigh; ++mcuY)
+				{
+					for (uint32_t mcuX = 0; mcuX < m_MCUsWide; ++mcuX)
+					{
+						restart();
+						for (Component* component : components)
+						{
+							for (uint32_t v = 0; v < component->v; ++v)
+							{
+								for (uint32_t h = 0; h < component->h; ++h)
+								{
+									DecodeBlock(reader, *component, component->Block(mcuX * component->h + h, mcuY * component->v + v));
+								}
+							}
+						}
+					}
+				}
+			}
+
+			position = reader.FindNextMarker();
+			++m_ScanCount;
+			return true;
+		}
+
+		void DecodeBlock(EntropyReader& reader, Component& component, int16_t* block)
+		{
+			if (!m_Progressive)              DecodeBaseline(reader, component, block);
+			else if (m_SpectralStart == 0)   DecodeDC(reader, component, block);
+			else if (m_ApproximationHigh == 0) DecodeACFirst(reader, component, block);
+			else                             DecodeACRefine(reader, component, block);
+		}
+
+		void DecodeBaseline(EntropyReader& reader, Component& component, int16_t* block)
+		{
+			uint32_t size = reader.Decode(m_DCTables[component.dcTable]);
+			component.dcPredictor = static_cast<int16_t>(component.dcPredictor + reader.Receive(size & 15));
+			block[0] = static_cast<int16_t>(component.dcPredictor);
+
+			const HuffmanTable& ac = m_ACTables[component.acTable];
+			for (uint32_t k = 1; k < 64; ++k)
+			{
+				uint32_t symbol = reader.Decode(ac);
+				uint32_t run = symbol >> 4;
+				uint32_t bits = symbol & 15;
+				if (bits == 0)
+				{
+					if (run != 15) break; // End of block
+					k += 15;              // Sixteen zeros
+					continue;
+				}
+				k += run;
+				block[ZigZag[std::min(k, 63u)]] = static_cast<int16_t>(reader.Receive(bits));
+			}
+		}
+
+		//DC coefficients of a progressive image, the first scan giving the top bits and later ones a bit each
+		void DecodeDC(EntropyReader& reader, Component& component, int16_t* block)
+		{
+			if (m_ApproximationHigh == 0)
+			{
+				uint32_t size = reader.Decode(m_DCTables[component.dcTable]);
+				component.dcPredictor = static_cast<int16_t>(component.dcPredictor + reader.Receive(size & 15));
+				block[0] = static_cast<int16_t>(component.dcPredictor * (1 << m_ApproximationLow));
+			}
+			else if (reader.GetBit())
+			{
+				block[0] = static_cast<int16_t>(block[0] | (1 << m_ApproximationLow));
+			}
+		}
+
+		//First scan of a band of AC coefficients. Runs of blocks with no coefficients in the band are coded as one EOB run
+		void DecodeACFirst(EntropyReader& reader, Component& component, int16_t* block)
+		{
+			if (m_EOBRun > 0)
+			{
+				--m_EOBRun;
+				return;
+			}
+
+			const HuffmanTable& ac = m_ACTables[component.acTable];
+			for (uint32_t k = m_SpectralStart; k <= m_SpectralEnd; ++k)
+			{
+				uint32_t symbol = reader.Decode(ac);
+				uint32_t run = symbol >> 4;
+				uint32_t bits = symbol & 15;
+				if (bits == 0)
+				{
+					if (run < 15)
+					{
+						m_EOBRun = (1u << run) - 1 + reader.GetBits(run);
+						break;
+					}
+					k += 15;
+					continue;
+				}
+				k += run;
+				block[ZigZag[std::min(k, 63u)]] = static_cast<int16_t>(reader.Receive(bits) * (1 << m_ApproximationLow));
+			}
+		}
+
+		//Later scans of an AC band, adding a bit to coefficients already non-zero and placing newly non-zero ones.
+		//Follows decode_mcu_AC_refine in libjpeg's jdphuff.c
+		void DecodeACRefine(EntropyReader& reader, Component& component, int16_t* block)
+		{
+			int positive = 1 << m_ApproximationLow;
+			int negative = -1 * (1 << m_ApproximationLow);
+			uint32_t k = m_SpectralStart;
+
+			auto refine = [&](int16_t& coefficient)
+			{
+				if (reader.GetBit() && (coefficient & positive) == 0)
+				{
+					coefficient = static_cast<int16_t>(coefficient + (coefficient >= 0 ? positive : negative));
+				}
+			};
+
+			if (m_EOBRun == 0)
+			{
+				const HuffmanTable& ac = m_ACTables[component.acTable];
+				for (; k <= m_SpectralEnd; ++k)
+				{
+					uint32_t symbol = reader.Decode(ac);
+					int run = static_cast<int>(symbol >> 4);
+					int value = 0;
+					if (symbol & 15)
+					{
+						value = reader.GetBit() ? positive : negative;
+					}
+					else if (run != 15)
+					{
+						m_EOBRun = (1u << run) + reader.GetBits(run);
+						break;
+					}
+
+					//Skip past run zero coefficients, refining the non-zero ones on the way, to where the new one goes
+					do
+					{
+						int16_t& coefficient = block[ZigZag[k]];
+						if (coefficient != 0) refine(coefficient);
+						else if (--run < 0) break;
+						++k;
+					} while (k <= m_SpectralEnd);
+
+					if (value != 0) block[ZigZag[k]] = static_cast<int16_t>(value);
+				}
+			}
+
+			if (m_EOBRun > 0)
+			{
+				for (; k <= m_SpectralEnd; ++k)
+				{
+					int16_t& coefficient = block[ZigZag[k]];
+					if (coefficient != 0) refine(coefficient);
+				}
+				--m_EOBRun;
+			}
+		}
+
+		//Inverse transform every component then upsample and convert to RGBA8
+		void ProduceImage(CImage& image, CThreadPool* threads)
+		{
+			for (Component& component : m_Components)
+			{
+				size_t pitch = component.blocksWide * 8;
+				component.samples.resize(pitch * component.blocksHigh * 8);
+				const uint16_t* quantisation = m_Quantisation[component.quantTable];
+				ParallelFor(threads, component.blocksHigh, [&component, quantisation, pitch](uint32_t first, uint32_t end)
+				{
+					for (uint32_t y = first; y < end; ++y)
+					{
+						for (uint32_t x = 0; x < component.blocksWide; ++x)
+						{
+							InverseDCT(component.Block(x, y), quantisation, component.samples.data() + (y * 8) * pitch + x * 8, pitch);
+						}
+					}
+				});
+				component.coefficients.clear();
+				component.coefficients.shrink_to_fit();
+			}
+
+			//Three components are YCbCr unless an Adobe segment or JFIF-style component IDs say RGB
+			bool rgb = m_Components.size() == 3 &&
+				(m_HasAdobe ? m_AdobeTransform == 0 : (m_Components[0].id == 'R' && m_Components[1].id == 'G' && m_Components[2].id == 'B'));
+
+			image.Create(ImageFormat::RGBA8, m_Width, m_Height);
+			ParallelFor(threads, m_Height, [this, &image, rgb](uint32_t first, uint32_t end)
+			{
+				static const ColourTables tables;
+				std::vector<uint8_t> rows[3];
+				for (auto& row : rows) row.resize(m_Width + 16);
+
+				for (uint32_t y = first; y < end; ++y)
+				{
+					for (size_t c = 0; c < m_Components.size(); ++c) UpsampleRow(m_Components[c], y, rows[c].data());
+
+					uint8_t* out = image.GetRow(0, y);
+					for (uint32_t x = 0; x < m_Width; ++x, out += 4)
+					{
+						if (m_Components.size() == 1)
+						{
+							out[0] = out[1] = out[2] = rows[0][x];
+						}
+						else if (rgb)
+						{
+							out[0] = rows[0][x];
+							out[1] = rows[1][x];
+							out[2] = rows[2][x];
+						}
+						else
+						{
+							int luma = rows[0][x], cb = rows[1][x], cr = rows[2][x];
+							out[0] = Clamp(luma + tables.crToR[cr]);
+							out[1] = Clamp(luma + ((tables.cbToG[cb] + tables.crToG[cr]) >> 16));
+							out[2] = Clamp(luma + tables.cbToB[cb]);
+						}
+						out[3] = 255;
+					}
+				}
+			});
+		}
+
+		//Produce row y of a component at full resolution. 2x horizontal and/or vertical subsampling uses libjpeg's
+		//triangle filters (3/4 of the nearest sample and 1/4 of the next), other ratios repeat samples
+		void UpsampleRow(const Component& component, uint32_t y, uint8_t* out) const
+		{
+			uint32_t scaleH = m_MaxH / component.h, scaleV = m_MaxV / component.v;
+			size_t pitch = component.blocksWide * 8;
+			bool fancyH = scaleH == 2 && component.width > 1 && m_MaxH % component.h == 0;
+			bool fancyV = scaleV == 2 && m_MaxV % component.v == 0;
+
+			uint32_t row = y / std::max(scaleV, 1u);
+			const uint8_t* near = component.samples.data() + std::min(row, component.height - 1) * pitch;
+
+			if (scaleH == 1 && scaleV == 1)
+			{
+				memcpy(out, near, m_Width);
+				return;
+			}
+			if (!fancyV && !fancyH)
+			{
+				for (uint32_t x = 0; x < m_Width; ++x) out[x] = near[x / std::max(scaleH, 1u)];
+				return;
+			}
+
+			//The row the vertical filter blends in is above for the top output row of a pair and below for the bottom one
+			const uint8_t* far = near;
+			if (fancyV)
+			{
+				bool upper = (y & 1) == 0;
+				uint32_t other = upper ? (row == 0 ? 0 : row - 1) : std::min(row + 1, component.height - 1);
+				far = component.samples.data() + other * pitch;
+			}
+
+			if (!fancyH)
+			{
+				//Vertical only (h1v2)
+				int bias = (y & 1) ? 2 : 1;
+				for (uint32_t x = 0; x < m_Width; ++x)
+				{
+					uint32_t column = std::min(x / scaleH, component.width - 1);
+					out[x] = static_cast<uint8_t>((near[column] * 3 + far[column] + bias) >> 2);
+				}
+				return;
+			}
+
+			std::vector<uint8_t> wide(component.width * 2);
+			uint32_t last = component.width - 1;
+			if (!fancyV)
+			{
+				//Horizontal only (h2v1)
+				wide[0] = near[0];
+				wide[1] = static_cast<uint8_t>((near[0] * 3 + near[1] + 2) >> 2);
+				for (uint32_t x = 1; x < last; ++x)
+				{
+					int value = near[x] * 3;
+					wide[2 * x] = static_cast<uint8_t>((value + near[x - 1] + 1) >> 2);
+					wide[2 * x + 1] = static_cast<uint8_t>((value + near[x + 1] + 2) >> 2);
+				}
+				wide[2 * last] = static_cast<uint8_t>((near[last] * 3 + near[last - 1] + 1) >> 2);
+				wide[2 * last + 1] = near[last];
+			}
+			else
+			{
+				//Both (h2v2) - sum the columns vertically, then filter horizontally
+				auto columnSum = [near, far](uint32_t x) { return near[x] * 3 + far[x]; };
+				int thisSum = columnSum(0), nextSum = columnSum(1), lastSum = thisSum;
+				wide[0] = static_cast<uint8_t>((thisSum * 4 + 8) >> 4);
+				wide[1] = static_cast<uint8_t>((thisSum * 3 + nextSum + 7) >> 4);
+				for (uint32_t x = 1; x < last; ++x)
+				{
+					lastSum = thisSum;
+					thisSum = nextSum;
+					nextSum = columnSum(x + 1);
+					wide[2 * x] = static_cast<uint8_t>((thisSum * 3 + lastSum + 8) >> 4);
+					wide[2 * x + 1] = static_cast<uint8_t>((thisSum * 3 + nextSum + 7) >> 4);
+				}
+				lastSum = thisSum;
+				thisSum = nextSum;
+				wide[2 * last] = static_cast<uint8_t>((thisSum * 3 + lastSum + 8) >> 4);
+				wide[2 * last + 1] = static_cast<uint8_t>((thisSum * 4 + 7) >> 4);
+			}
+			memcpy(out, wide.data(), std::min<size_t>(m_Width, wide.size()));
+		}
+
+	private:
+		const uint8_t* m_Data;
+		size_t m_Size;
+
+		bool m_FrameRead = false;
+		bool m_Progressive = false;
+		uint32_t m_Width = 0, m_Height = 0;
+		uint32_t m_MaxH = 1, m_MaxV = 1;
+		uint32_t m_MCUsWide = 0, m_MCUsHigh = 0;
+		std::vector<Component> m_Components;
+
+		HuffmanTable m_DCTables[4];
+		HuffmanTable m_ACTables[4];
+		uint16_t m_Quantisation[4][64] = {};
+		uint32_t m_RestartInterval = 0;
+		bool m_HasAdobe = false;
+		uint8_t m_AdobeTransform = 0;
+		uint32_t m_ScanCount = 0;
+
+		//Current scan
+		uint32_t m_SpectralStart = 0, m_SpectralEnd = 63;
+		uint32_t m_ApproximationHigh = 0, m_ApproximationLow = 0;
+		uint32_t m_EOBRun = 0;
+	};
+}
+
+//Decode a JPEG file
+bool DecodeJPEG(const uint8_t* data, size_t size, CImage& image, std::string& error, CThreadPool* threads)
+{
+	JPEGDecoder decoder(data, size);
+	return decoder.Decode(image, error, threads);
+}
@@ -0,0 +1,166 @@
+//--------------------------------------------------------------------------------------
+// Small LZ77-style byte compression used for asset pack entries
+//--------------------------------------------------------------------------------------
+
+#include "LZCompression.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const size_t MinMatch = 4;
+	const size_t MaxOffset = 65535;
+	const int    HashBits = 16;
+
+	inline uint32_t Read32(const uint8_t* p) { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+
+	inline uint32_t HashSequence(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	//Lengths of 15 or more spill into following bytes, each adding up to 255
+	inline uint8_t* WriteLength(uint8_t* out, size_t length)
+	{
+		while (length >= 255)
+		{
+			*out++ = 255;
+			length -= 255;
+		}
+		*out++ = static_cast<uint8_t>(length);
+		return out;
+	}
+
+	inline uint8_t* WriteSequence(uint8_t* out, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength)
+	{
+		uint8_t* token = out++;
+		size_t literalToken = literalCount < 15 ? literalCount : 15;
+		if (literalCount >= 15) out = WriteLength(out, literalCount - 15);
+		if (literalCount > 0) memcpy(out, literals, literalCount);
+		out += literalCount;
+
+		//The last sequence has literals only
+		if (matchLength == 0)
+		{
+			*token = static_cast<uint8_t>(literalToken << 4);
+			return out;
+		}
+
+		*out++ = static_cast<uint8_t>(offset);
+		*out++ = static_cast<uint8_t>(offset >> 8);
+		size_t lengthCode = matchLength - MinMatch;
+		*token = static_cast<uint8_t>((literalToken << 4) | (lengthCode < 15 ? lengthCode : 15));
+		if (lengthCode >= 15) out = WriteLength(out, lengthCode - 15);
+		return out;
+	}
+
+	//Read a length that may continue into following bytes. Returns false if it runs off the end of the input
+	inline bool ReadLength(const uint8_t*& in, const uint8_t* end, size_t& length)
+	{
+		uint8_t byte;
+		do
+		{
+			if (in >= end) return false;
+			byte = *in++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+}
+
+//Largest possible compressed size of a block
+size_t LZCompressBound(size_t size)
+{
+	//One token per block plus one length byte per 255 literals
+	return size + size / 255 + 16;
+}
+
+//Compress a block
+size_t LZCompress(const uint8_t* source, size_t sourceSize, uint8_t* destination)
+{
+	uint8_t* out = destination;
+	const uint8_t* end = source + sourceSize;
+	const uint8_t* literals = source;
+
+	if (sourceSize >= MinMatch)
+	{
+		//Most recent position of each hashed 4-byte sequence, greedy matching against it
+		std::vector<uint32_t> table(size_t(1) << HashBits, 0xffffffff);
+		const uint8_t* matchLimit = end - MinMatch;
+		const uint8_t* p = source;
+
+		while (p <= matchLimit)
+		{
+			uint32_t sequence = Read32(p);
+			uint32_t& slot = table[HashSequence(sequence)];
+			const uint8_t* candidate = slot != 0xffffffff ? source + slot : nullptr;
+			slot = static_cast<uint32_t>(p - source);
+
+			if (!candidate || static_cast<size_t>(p - candidate) > MaxOffset || Read32(candidate) != sequence)
+			{
+				++p;
+				continue;
+			}
+
+			//Extend the match as far as it goes
+			size_t length = MinMatch;
+			while (p + length < end && candidate[length] == p[length]) ++length;
+
+			out = WriteSequence(out, literals, p - literals, p - candidate, length);
+
+			//Remember a position inside the match so that nearby repeats are still found
+			if (p + length - 2 <= matchLimit) table[HashSequence(Read32(p + length - 2))] = static_cast<uint32_t>(p + length - 2 - source);
+
+			p += length;
+			literals = p;
+		}
+	}
+
+	out = WriteSequence(out, literals, end - literals, 0, 0);
+	return out - destination;
+}
+
+//Decompress a block
+bool LZDecompress(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationSize)
+{
+	const uint8_t* in = source;
+	const uint8_t* inEnd = source + sourceSize;
+	uint8_t* out = destination;
+	uint8_t* outEnd = destination + destinationSize;
+
+	while (in < inEnd)
+	{
+		uint8_t token = *in++;
+
+		size_t literalCount = token >> 4;
+		if (literalCount == 15 && !ReadLength(in, inEnd, literalCount)) return false;
+		if (literalCount > static_cast<size_t>(inEnd - in) || literalCount > static_cast<size_t>(outEnd - out)) return false;
+		if (literalCount > 0) memcpy(out, in, literalCount);
+		in += literalCount;
+		out += literalCount;
+
+		//A sequence without a match ends the block
+		if (in == inEnd) break;
+
+		if (inEnd - in < 2) return false;
+		size_t offset = in[0] | (in[1] << 8);
+		in += 2;
+
+		size_t length = token & 15;
+		if (length == 15 && !ReadLength(in, inEnd, length)) return false;
+		length += MinMatch;
+
+		if (offset == 0 || offset > static_cast<size_t>(out - destination) || length > static_cast<size_t>(outEnd - out)) return false;
+
+		//Matches may overlap their own output (e.g. runs). Copying offset bytes at a time never reads what the same copy writes
+		while (length > 0)
+		{
+			size_t count = offset < length ? offset : length;
+			memcpy(out, out - offset, count);
+			out += count;
+			length -= count;
+		}
+	}
+	return out == outEnd;
+}
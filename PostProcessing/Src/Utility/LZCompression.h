@@ -0,0 +1,21 @@
+//--------------------------------------------------------------------------------------
+// Small LZ77-style byte compression used for asset pack entries
+//--------------------------------------------------------------------------------------
+// The format is a sequence of (literals, match) pairs in the style of LZ4 blocks: a token byte
+// holding the literal count and match length, the literal bytes, a 16-bit offset back into the
+// output and any extra length bytes. Decompression is a tight copy loop so unpacking costs
+// far less than reading the extra bytes from disk would.
+// Both functions only work on whole blocks in memory, see CAssetPack for how larger files are split.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+//Largest possible compressed size of a block of the given size (incompressible data grows slightly)
+size_t LZCompressBound(size_t size);
+
+//Compress a block into a buffer of at least LZCompressBound(sourceSize) bytes. Returns the compressed size
+size_t LZCompress(const uint8_t* source, size_t sourceSize, uint8_t* destination);
+
+//Decompress a block, which must produce exactly destinationSize bytes. Returns false if the data is corrupt.
+//Never reads or writes outside the given buffers
+bool LZDecompress(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationSize);
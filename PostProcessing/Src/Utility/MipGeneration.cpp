@@ -0,0 +1,436 @@
+//--------------------------------------------------------------------------------------
+// Generating the mip chain of an image on the CPU
+//--------------------------------------------------------------------------------------
+
+#include "MipGeneration.h"
+#include "CThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define MIP_SIMD 1
+	#include <emmintrin.h>
+	#if defined(_MSC_VER)
+		#define SSE_FUNCTION
+	#else
+		#define SSE_FUNCTION __attribute__((target("sse2")))
+	#endif
+#else
+	#define MIP_SIMD 0
+#endif
+
+namespace
+{
+	const float Pi = 3.14159265358979f;
+
+	//Run a function over ranges of [0, count) on the pool's workers, or all at once on this thread without a pool
+	void ParallelFor(CThreadPool* threads, uint32_t count, const std::function<void(uint32_t, uint32_t)>& function)
+	{
+		if (!threads || threads->GetThreadCount() == 0 || count < 2)
+		{
+			function(0, count);
+			return;
+		}
+		uint32_t step = std::max(count / (threads->GetThreadCount() * 4), 1u);
+		for (uint32_t first = 0; first < count; first += step)
+		{
+			uint32_t end = std::min(first + step, count);
+			threads->Submit([&function, first, end]() { function(first, end); });
+		}
+		threads->Wait();
+	}
+
+
+	//-------------------------------------
+	// sRGB
+	//-------------------------------------
+
+	//Conversions between 8-bit sRGB and linear values 0-1. Linear values are looked up in steps fine enough that
+	//even the darkest sRGB values, where the curve is steepest, round correctly
+	struct SRGBTables
+	{
+		static const int LinearSteps = 16383;
+
+		float   toLinear[256];
+		uint8_t fromLinear[LinearSteps + 1];
+
+		SRGBTables()
+		{
+			for (int i = 0; i < 256; ++i)
+			{
+				float value = i / 255.0f;
+				toLinear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i <= LinearSteps; ++i)
+			{
+				float value = static_cast<float>(i) / LinearSteps;
+				float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+				fromLinear[i] = static_cast<uint8_t>(encoded * 255.0f + 0.5f);
+			}
+		}
+	};
+	const SRGBTables SRGB;
+
+
+	//-------------------------------------
+	// Filters
+	//-------------------------------------
+
+	float Sinc(float x)
+	{
+		if (std::abs(x) < 1e-5f) return 1.0f;
+		x *= Pi;
+		return std::sin(x) / x;
+	}
+
+	//Modified Bessel function of the first kind, order 0, for the Kaiser window
+	float BesselI0(float x)
+	{
+		float sum = 1.0f, term = 1.0f;
+		for (int k = 1; k < 50 && term > sum * 1e-8f; ++k)
+		{
+			float factor = x / (2.0f * k);
+			term *= factor * factor;
+			sum += term;
+		}
+		return sum;
+	}
+
+	//Filter weight at a distance in output pixels. Box is handled by area instead
+	float FilterWeight(MipFilter filter, float x)
+	{
+		const float Width = 3.0f;
+		x = std::abs(x);
+		if (x >= Width) return 0.0f;
+		if (filter == MipFilter::Lanczos) return Sinc(x) * Sinc(x / Width);
+
+		const float Alpha = 4.0f; // Kaiser window shape, higher trades sharpness for less ringing
+		float t = x / Width;
+		return Sinc(x) * BesselI0(Alpha * std::sqrt(1.0f - t * t)) / BesselI0(Alpha);
+	}
+
+	//The source pixels and weights making up each output pixel along one axis. Every output pixel has the same number
+	//of taps, with source pixels past the edge repeating the edge pixel
+	struct FilterTaps
+	{
+		uint32_t              width = 0;
+		std::vector<uint32_t> indices;
+		std::vector<float>    weights;
+	};
+
+	FilterTaps BuildTaps(uint32_t sourceSize, uint32_t destinationSize, MipFilter filter)
+	{
+		float scale = static_cast<float>(sourceSize) / destinationSize;
+		float support = (filter == MipFilter::Box ? 0.5f : 3.0f) * scale;
+
+		//Enough taps for the source pixels overlapping the widest footprint
+		FilterTaps taps;
+		for (uint32_t d = 0; d < destinationSize; ++d)
+		{
+			float centre = (d + 0.5f) * scale;
+			int span = static_cast<int>(std::ceil(centre + support)) - static_cast<int>(std::floor(centre - support));
+			taps.width = std::max(taps.width, static_cast<uint32_t>(span));
+		}
+		taps.indices.resize(static_cast<size_t>(taps.width) * destinationSize);
+		taps.weights.resize(taps.indices.size());
+		for (uint32_t d = 0; d < destinationSize; ++d)
+		{
+			float centre = (d + 0.5f) * scale;
+			int first = static_cast<int>(std::floor(centre - support));
+			uint32_t* indices = &taps.indices[static_cast<size_t>(d) * taps.width];
+			float* weights = &taps.weights[static_cast<size_t>(d) * taps.width];
+
+			float total = 0.0f;
+			for (uint32_t k = 0; k < taps.width; ++k)
+			{
+				int s = first + static_cast<int>(k);
+				if (filter == MipFilter::Box)
+				{
+					weights[k] = std::max(std::min(s + 1.0f, centre + support) - std::max(static_cast<float>(s), centre - support), 0.0f);
+				}
+				else
+				{
+					weights[k] = FilterWeight(filter, (s + 0.5f - centre) / scale);
+				}
+				indices[k] = static_cast<uint32_t>(std::min(std::max(s, 0), static_cast<int>(sourceSize) - 1));
+				total += weights[k];
+			}
+			for (uint32_t k = 0; k < taps.width; ++k) weights[k] /= total;
+		}
+		return taps;
+	}
+
+
+	//-------------------------------------
+	// Passes
+	//-------------------------------------
+
+	//Filter a row of RGBA float pixels across to a row of count pixels
+	void FilterAcross(const float* source, float* destination, const FilterTaps& taps, uint32_t count)
+	{
+		const uint32_t* indices = taps.indices.data();
+		const float* weights = taps.weights.data();
+		for (uint32_t d = 0; d < count; ++d, destination += 4)
+		{
+			float sum[4] = {};
+			for (uint32_t k = 0; k < taps.width; ++k, ++indices, ++weights)
+			{
+				const float* pixel = source + *indices * 4;
+				for (int c = 0; c < 4; ++c) sum[c] += *weights * pixel[c];
+			}
+			for (int c = 0; c < 4; ++c) destination[c] = sum[c];
+		}
+	}
+
+	//Combine rows of floats, given by the taps of one output row, into one row clamped to 0-1. The source holds the rows
+	//from firstIndex on
+	void FilterDown(const float* source, size_t pitch, uint32_t firstIndex, float* destination, const FilterTaps& taps, uint32_t row, uint32_t floats)
+	{
+		const uint32_t* indices = &taps.indices[static_cast<size_t>(row) * taps.width];
+		const float* weights = &taps.weights[static_cast<size_t>(row) * taps.width];
+		for (uint32_t i = 0; i < floats; ++i)
+		{
+			float sum = 0.0f;
+			for (uint32_t k = 0; k < taps.width; ++k) sum += weights[k] * source[(indices[k] - firstIndex) * pitch + i];
+			destination[i] = std::min(std::max(sum, 0.0f), 1.0f);
+		}
+	}
+
+	//Convert a row of RGBA floats 0-1 to bytes, first scaling each channel (clamped to 1) and sRGB encoding the colour if asked
+	void ToBytes(const float* input, uint8_t* output, uint32_t pixels, bool sRGB, const float scales[4])
+	{
+		for (uint32_t p = 0; p < pixels; ++p, input += 4, output += 4)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				float value = std::min(input[c] * scales[c], 1.0f);
+				output[c] = (sRGB && c < 3) ? SRGB.fromLinear[static_cast<int>(value * SRGBTables::LinearSteps + 0.5f)] : static_cast<uint8_t>(value * 255.0f + 0.5f);
+			}
+		}
+	}
+
+#if MIP_SIMD
+	SSE_FUNCTION void ToBytesSSE(const float* input, uint8_t* output, uint32_t pixels, bool sRGB, const float scales[4])
+	{
+		const float colourSteps = sRGB ? static_cast<float>(SRGBTables::LinearSteps) : 255.0f;
+		const __m128 scale = _mm_loadu_ps(scales), one = _mm_set1_ps(1.0f), half = _mm_set1_ps(0.5f);
+		const __m128 steps = _mm_setr_ps(colourSteps, colourSteps, colourSteps, 255.0f);
+		alignas(16) int32_t values[4];
+		for (uint32_t p = 0; p < pixels; ++p, input += 4, output += 4)
+		{
+			__m128 value = _mm_min_ps(_mm_mul_ps(_mm_loadu_ps(input), scale), one);
+			_mm_store_si128(reinterpret_cast<__m128i*>(values), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, steps), half)));
+			if (sRGB)
+			{
+				output[0] = SRGB.fromLinear[values[0]];
+				output[1] = SRGB.fromLinear[values[1]];
+				output[2] = SRGB.fromLinear[values[2]];
+			}
+			else
+			{
+				output[0] = static_cast<uint8_t>(values[0]);
+				output[1] = static_cast<uint8_t>(values[1]);
+				output[2] = static_cast<uint8_t>(values[2]);
+			}
+			output[3] = static_cast<uint8_t>(values[3]);
+		}
+	}
+
+	SSE_FUNCTION void FilterAcrossSSE(const float* source, float* destination, const FilterTaps& taps, uint32_t count)
+	{
+		const uint32_t* indices = taps.indices.data();
+		const float* weights = taps.weights.data();
+		for (uint32_t d = 0; d < count; ++d, destination += 4)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (uint32_t k = 0; k < taps.width; ++k, ++indices, ++weights)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(*weights), _mm_loadu_ps(source + *indices * 4)));
+			}
+			_mm_storeu_ps(destination, sum);
+		}
+	}
+
+	//Rows of RGBA floats are always a multiple of 4 floats long
+	SSE_FUNCTION void FilterDownSSE(const float* source, size_t pitch, uint32_t firstIndex, float* destination, const FilterTaps& taps, uint32_t row, uint32_t floats)
+	{
+		const uint32_t* indices = &taps.indices[static_cast<size_t>(row) * taps.width];
+		const float* weights = &taps.weights[static_cast<size_t>(row) * taps.width];
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+		for (uint32_t i = 0; i < floats; i += 4)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (uint32_t k = 0; k < taps.width; ++k)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(source + (indices[k] - firstIndex) * pitch + i)));
+			}
+			_mm_storeu_ps(destination + i, _mm_min_ps(_mm_max_ps(sum, zero), one));
+		}
+	}
+#endif
+
+	//Channel of a pixel in memory holding the given RGBA channel
+	uint32_t MemoryChannel(ImageFormat format, uint32_t channel)
+	{
+		return (format == ImageFormat::BGRA8 && channel != 1 && channel != 3) ? 2 - channel : channel;
+	}
+
+	//Scale for one channel of a mip's RGBA floats that leaves the same fraction of its values above the reference as in
+	//the top mip. The threshold falls halfway between the smallest value that should pass and the largest that should not
+	float CoverageScale(const std::vector<float>& pixels, uint32_t channel, float reference, float target)
+	{
+		const float MaxScale = 64.0f;
+		std::vector<float> values;
+		values.reserve(pixels.size() / 4);
+		for (size_t i = channel; i < pixels.size(); i += 4) values.push_back(pixels[i]);
+
+		size_t passing = static_cast<size_t>(target * values.size() + 0.5f);
+		if (passing == 0) return 1.0f;
+		if (passing > values.size()) passing = values.size();
+
+		auto lowestPassing = values.end() - passing;
+		std::nth_element(values.begin(), lowestPassing, values.end());
+		float threshold = *lowestPassing;
+		if (lowestPassing != values.begin()) threshold = (threshold + *std::max_element(values.begin(), lowestPassing)) * 0.5f;
+		return threshold > reference / MaxScale ? reference / threshold : MaxScale;
+	}
+}
+
+
+//Return the options suited to a texture from its file name
+MipOptions ChooseMipOptions(const std::string& fileName)
+{
+	MipOptions options;
+	if (fileName.find("AlphaMap") != std::string::npos)
+	{
+		options.sRGB = false;
+		options.preserveCoverage = true;
+		options.coverageChannel = 0; // The shaders read the mask from red
+		options.coverageReference = 0.1f;
+	}
+	else if (fileName.find("Noise") != std::string::npos || fileName.find("Distort") != std::string::npos)
+	{
+		options.sRGB = false;
+	}
+	return options;
+}
+
+//Make a full mip chain for the top mip of an RGBA8 or BGRA8 image
+bool GenerateMips(const CImage& source, CImage& destination, const MipOptions& options, CThreadPool* threads)
+{
+	ImageFormat format = source.GetFormat();
+	if (format != ImageFormat::RGBA8 && format != ImageFormat::BGRA8) return false;
+	if (!destination.Create(format, source.GetWidth(), source.GetHeight(), 0)) return false;
+	std::copy(source.GetData(0), source.GetData(0) + source.GetMip(0).size, destination.GetData(0));
+
+	auto filterAcross = FilterAcross;
+	auto filterDown = FilterDown;
+	auto toBytes = ToBytes;
+#if MIP_SIMD
+	if (options.useSIMD)
+	{
+		filterAcross = FilterAcrossSSE;
+		filterDown = FilterDownSSE;
+		toBytes = ToBytesSSE;
+	}
+#endif
+
+	//Values 0-1 of each channel, linear if sRGB
+	float toFloat[4][256];
+	for (uint32_t channel = 0; channel < 4; ++channel)
+	{
+		for (int value = 0; value < 256; ++value)
+		{
+			toFloat[channel][value] = (options.sRGB && channel < 3) ? SRGB.toLinear[value] : value * (1.0f / 255.0f);
+		}
+	}
+
+	uint32_t coverageChannel = MemoryChannel(format, std::min(options.coverageChannel, 3u));
+	float coverageTarget = 0.0f;
+	if (options.preserveCoverage)
+	{
+		size_t covered = 0, pixels = static_cast<size_t>(source.GetWidth()) * source.GetHeight();
+		const uint8_t* data = source.GetData();
+		for (size_t i = 0; i < pixels; ++i) covered += data[i * 4 + coverageChannel] * (1.0f / 255.0f) > options.coverageReference;
+		coverageTarget = static_cast<float>(covered) / pixels;
+	}
+
+	//Each mip is filtered from the floating point copy of the one above, apart from the first which reads the source.
+	//The mip is made in bands of rows, each filtering across just the rows above it needs, so the intermediate rows
+	//stay in the cache rather than making a half size copy of the mip above
+	const uint32_t BandRows = 32;
+	std::vector<float> above, below;
+	for (uint32_t mip = 1; mip < destination.GetMipCount(); ++mip)
+	{
+		const ImageMip& sourceLayout = destination.GetMip(mip - 1);
+		const ImageMip& layout = destination.GetMip(mip);
+		FilterTaps tapsAcross = BuildTaps(sourceLayout.width, layout.width, options.filter);
+		FilterTaps tapsDown = BuildTaps(sourceLayout.height, layout.height, options.filter);
+		size_t pitch = static_cast<size_t>(layout.width) * 4;
+		below.resize(pitch * layout.height);
+
+		//Back to bytes, with the coverage channel scaled. The unscaled floats are kept for filtering the next mip
+		auto convertRows = [&](uint32_t first, uint32_t end, float coverageScale)
+		{
+			float scales[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+			scales[coverageChannel] = coverageScale;
+			for (uint32_t y = first; y < end; ++y) toBytes(below.data() + y * pitch, destination.GetRow(mip, y), layout.width, options.sRGB, scales);
+		};
+
+		uint32_t bands = (layout.height + BandRows - 1) / BandRows;
+		ParallelFor(threads, bands, [&](uint32_t firstBand, uint32_t endBand)
+		{
+			std::vector<float> row, across;
+			for (uint32_t band = firstBand; band < endBand; ++band)
+			{
+				uint32_t firstRow = band * BandRows, endRow = std::min(firstRow + BandRows, layout.height);
+				auto firstTap = tapsDown.indices.begin() + static_cast<size_t>(firstRow) * tapsDown.width;
+				auto endTap = tapsDown.indices.begin() + static_cast<size_t>(endRow) * tapsDown.width;
+				uint32_t low = *std::min_element(firstTap, endTap), high = *std::max_element(firstTap, endTap);
+
+				//Across each row of the mip above that the band reads
+				across.resize((high - low + 1) * pitch);
+				for (uint32_t y = low; y <= high; ++y)
+				{
+					const float* input;
+					if (mip == 1)
+					{
+						const uint8_t* bytes = source.GetRow(0, y);
+						row.resize(static_cast<size_t>(sourceLayout.width) * 4);
+						for (size_t i = 0; i < row.size(); i += 4)
+						{
+							row[i] = toFloat[0][bytes[i]];
+							row[i + 1] = toFloat[1][bytes[i + 1]];
+							row[i + 2] = toFloat[2][bytes[i + 2]];
+							row[i + 3] = toFloat[3][bytes[i + 3]];
+						}
+						input = row.data();
+					}
+					else
+					{
+						input = above.data() + static_cast<size_t>(y) * sourceLayout.width * 4;
+					}
+					filterAcross(input, across.data() + (y - low) * pitch, tapsAcross, layout.width);
+				}
+
+				//Then down
+				for (uint32_t y = firstRow; y < endRow; ++y)
+				{
+					filterDown(across.data(), pitch, low, below.data() + y * pitch, tapsDown, y, static_cast<uint32_t>(pitch));
+				}
+				if (!options.preserveCoverage) convertRows(firstRow, endRow, 1.0f);
+			}
+		});
+
+		if (options.preserveCoverage)
+		{
+			float coverageScale = CoverageScale(below, coverageChannel, options.coverageReference, coverageTarget);
+			ParallelFor(threads, layout.height, [&](uint32_t first, uint32_t end) { convertRows(first, end, coverageScale); });
+		}
+		std::swap(above, below);
+	}
+	return true;
+}
@@ -0,0 +1,39 @@
+//--------------------------------------------------------------------------------------
+// Generating the mip chain of an image on the CPU
+//--------------------------------------------------------------------------------------
+// Each mip is filtered from the one above it in floating point, for textures with no mips of their
+// own and for those compressed offline, as the GPU cannot generate mips for block compressed formats.
+#pragma once
+#include "CImage.h"
+#include <string>
+
+class CThreadPool;
+
+enum class MipFilter
+{
+	Box,     // Average of the pixels covered
+	Kaiser,  // Kaiser windowed sinc, 3 pixels wide - keeps small mips sharper at the cost of slight ringing
+	Lanczos, // Lanczos-3 windowed sinc, likewise
+};
+
+//Filtering sRGB colour in linear space keeps bright and dark areas averaging to the right brightness rather than darkening.
+//Preserving coverage keeps thin cut-out shapes from fading away in the distance
+struct MipOptions
+{
+	MipFilter filter            = MipFilter::Kaiser;
+	bool      sRGB              = true;  // Red, green and blue hold sRGB colour, so are filtered in linear space. Alpha is always linear
+	bool      preserveCoverage  = false; // Scale coverageChannel in each mip so the fraction above coverageReference matches the top mip
+	uint32_t  coverageChannel   = 3;     // 0-3 for red, green, blue, alpha. Treated as linear data
+	float     coverageReference = 0.5f;
+	bool      useSIMD           = true;  // Use SSE where available, false for the plain C++ version
+};
+
+//Return the options suited to a texture from its file name: masks (*AlphaMap*) keep their coverage of the 0.1 threshold
+//the shaders cut them out at, and masks, noise and distortion vectors are data rather than colour so are filtered as
+//they are. Everything else is sRGB colour
+MipOptions ChooseMipOptions(const std::string& fileName);
+
+//Make a full mip chain for the top mip of an RGBA8 or BGRA8 image, each mip filtered across then down from the one above, in
+//floating point so rounding does not build up down the chain. The rows of each pass are shared between the pool's workers if one
+//is given, and each does the four channels of a pixel at once with SSE. Returns false for other formats
+bool GenerateMips(const CImage& source, CImage& destination, const MipOptions& options = MipOptions(), CThreadPool* threads = nullptr);
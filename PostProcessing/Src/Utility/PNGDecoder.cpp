@@ -0,0 +1,349 @@
+//--------------------------------------------------------------------------------------
+// PNG decoding, see ImageDecoders.h
+//--------------------------------------------------------------------------------------
+
+#include "ImageDecoders.h"
+#include "Inflate.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const uint8_t PNGSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+	//Largest image accepted, to keep the RGBA8 size well within memory
+	const uint64_t MaxPixels = 1ull << 28;
+
+	uint32_t ReadBE32(const uint8_t* data)
+	{
+		return static_cast<uint32_t>(data[0]) << 24 | static_cast<uint32_t>(data[1]) << 16 |
+		       static_cast<uint32_t>(data[2]) << 8 | data[3];
+	}
+
+	//What the IHDR, PLTE and tRNS chunks say about the pixels
+	struct PNGInfo
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t bitDepth = 0;
+		uint32_t colourType = 0;   // 0 grey, 2 RGB, 3 palette, 4 grey and alpha, 6 RGBA
+		bool     interlaced = false;
+		uint32_t bitsPerPixel = 0;
+
+		uint8_t  palette[256][4] = {};
+		bool     hasKey = false;   // tRNS gives a grey or RGB value to treat as transparent
+		uint16_t key[3] = {};
+	};
+
+	//Bytes in a row of the given number of pixels, not counting the filter type byte
+	size_t RowBytes(uint32_t width, uint32_t bitsPerPixel)
+	{
+		return (static_cast<size_t>(width) * bitsPerPixel + 7) / 8;
+	}
+
+	//Read a sample of less than 8 bits, packed from the most significant bit of each byte
+	uint32_t PackedSample(const uint8_t* row, uint32_t x, uint32_t depth)
+	{
+		uint32_t bit = x * depth;
+		return (row[bit >> 3] >> (8 - depth - (bit & 7))) & ((1u << depth) - 1);
+	}
+
+	uint32_t Sample16(const uint8_t* data) { return static_cast<uint32_t>(data[0]) << 8 | data[1]; }
+
+	uint8_t Paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+		if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+		return static_cast<uint8_t>(pb <= pc ? b : c);
+	}
+
+	//Reverse the filters of a run of rows in place. Each row starts with its filter type byte, and filters
+	//refer to the byte stride bytes to the left (a whole pixel, or one byte for packed pixels) and the row above
+	bool Unfilter(uint8_t* data, uint32_t rows, size_t rowBytes, size_t stride, std::string& error)
+	{
+		std::vector<uint8_t> zeroRow(rowBytes, 0);
+		const uint8_t* previous = zeroRow.data();
+		for (uint32_t y = 0; y < rows; ++y)
+		{
+			uint8_t filter = data[0];
+			uint8_t* row = data + 1;
+			switch (filter)
+			{
+			case 0:
+				break;
+			case 1:
+				for (size_t i = stride; i < rowBytes; ++i) row[i] = static_cast<uint8_t>(row[i] + row[i - stride]);
+				break;
+			case 2:
+				for (size_t i = 0; i < rowBytes; ++i) row[i] = static_cast<uint8_t>(row[i] + previous[i]);
+				break;
+			case 3:
+				for (size_t i = 0; i < stride && i < rowBytes; ++i) row[i] = static_cast<uint8_t>(row[i] + previous[i] / 2);
+				for (size_t i = stride; i < rowBytes; ++i) row[i] = static_cast<uint8_t>(row[i] + (row[i - stride] + previous[i]) / 2);
+				break;
+			case 4:
+				for (size_t i = 0; i < stride && i < rowBytes; ++i) row[i] = static_cast<uint8_t>(row[i] + previous[i]);
+				for (size_t i = stride; i < rowBytes; ++i) row[i] = static_cast<uint8_t>(row[i] + Paeth(row[i - stride], previous[i], previous[i - stride]));
+				break;
+			default:
+				error = "Invalid PNG filter type";
+				return false;
+			}
+			previous = row;
+			data += rowBytes + 1;
+		}
+		return true;
+	}
+
+	//Convert one unfiltered row of pixels to RGBA8
+	void ConvertRow(const uint8_t* row, uint32_t width, const PNGInfo& info, uint8_t* rgba)
+	{
+		uint32_t depth = info.bitDepth;
+		for (uint32_t x = 0; x < width; ++x, rgba += 4)
+		{
+			switch (info.colourType)
+			{
+			case 0:
+			{
+				uint32_t sample;
+				uint8_t grey;
+				if (depth == 16)     { sample = Sample16(row + 2 * x); grey = row[2 * x]; }
+				else if (depth == 8) { sample = row[x]; grey = row[x]; }
+				else                 { sample = PackedSample(row, x, depth); grey = static_cast<uint8_t>(sample * (255 / ((1u << depth) - 1))); }
+				rgba[0] = rgba[1] = rgba[2] = grey;
+				rgba[3] = (info.hasKey && sample == info.key[0]) ? 0 : 255;
+				break;
+			}
+			case 2:
+			{
+				bool keyed = info.hasKey;
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					uint32_t sample = depth == 16 ? Sample16(row + 6 * x + 2 * c) : row[3 * x + c];
+					rgba[c] = depth == 16 ? row[6 * x + 2 * c] : row[3 * x + c];
+					keyed = keyed && sample == info.key[c];
+				}
+				rgba[3] = keyed ? 0 : 255;
+				break;
+			}
+			case 3:
+			{
+				uint32_t index = depth == 8 ? row[x] : PackedSample(row, x, depth);
+				memcpy(rgba, info.palette[index], 4);
+				break;
+			}
+			case 4:
+			{
+				uint32_t step = depth / 8;
+				rgba[0] = rgba[1] = rgba[2] = row[2 * step * x];
+				rgba[3] = row[2 * step * x + step];
+				break;
+			}
+			default:
+			{
+				uint32_t step = depth / 8;
+				for (uint32_t c = 0; c < 4; ++c) rgba[c] = row[4 * step * x + step * c];
+				break;
+			}
+			}
+		}
+	}
+
+	//Check the bit depth is allowed for the colour type, and find the size of a pixel
+	bool CheckFormat(PNGInfo& info)
+	{
+		uint32_t depth = info.bitDepth;
+		bool anyDepth = depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16;
+		bool wholeBytes = depth == 8 || depth == 16;
+		switch (info.colourType)
+		{
+		case 0: info.bitsPerPixel = depth;     return anyDepth;
+		case 2: info.bitsPerPixel = depth * 3; return wholeBytes;
+		case 3: info.bitsPerPixel = depth;     return anyDepth && depth <= 8;
+		case 4: info.bitsPerPixel = depth * 2; return wholeBytes;
+		case 6: info.bitsPerPixel = depth * 4; return wholeBytes;
+		default: return false;
+		}
+	}
+}
+
+//Decode a PNG file
+bool DecodePNG(const uint8_t* data, size_t size, CImage& image, std::string& error)
+{
+	if (size < 8 || memcmp(data, PNGSignature, 8) != 0)
+	{
+		error = "Not a PNG file";
+		return false;
+	}
+
+	//Gather the image data, which may be split across any number of IDAT chunks. A single chunk is used in place
+	PNGInfo info;
+	bool hasHeader = false;
+	const uint8_t* imageData = nullptr;
+	size_t imageDataSize = 0;
+	std::vector<uint8_t> joinedData;
+	for (size_t position = 8;;)
+	{
+		if (position + 12 > size)
+		{
+			error = "Truncated PNG chunk";
+			return false;
+		}
+		uint32_t length = ReadBE32(data + position);
+		const uint8_t* type = data + position + 4;
+		const uint8_t* chunk = data + position + 8;
+		if (length > size - position - 12)
+		{
+			error = "Truncated PNG chunk";
+			return false;
+		}
+		position += 12 + static_cast<size_t>(length);
+
+		if (memcmp(type, "IHDR", 4) == 0)
+		{
+			if (length != 13)
+			{
+				error = "Invalid PNG header";
+				return false;
+			}
+			info.width = ReadBE32(chunk);
+			info.height = ReadBE32(chunk + 4);
+			info.bitDepth = chunk[8];
+			info.colourType = chunk[9];
+			info.interlaced = chunk[12] == 1;
+			if (info.width == 0 || info.height == 0 || static_cast<uint64_t>(info.width) * info.height > MaxPixels ||
+			    chunk[10] != 0 || chunk[11] != 0 || chunk[12] > 1 || !CheckFormat(info))
+			{
+				error = "Unsupported PNG format";
+				return false;
+			}
+			hasHeader = true;
+		}
+		else if (!hasHeader)
+		{
+			error = "PNG header missing";
+			return false;
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			if (length % 3 != 0 || length > 256 * 3)
+			{
+				error = "Invalid PNG palette";
+				return false;
+			}
+			for (uint32_t i = 0; i < length / 3; ++i)
+			{
+				info.palette[i][0] = chunk[3 * i];
+				info.palette[i][1] = chunk[3 * i + 1];
+				info.palette[i][2] = chunk[3 * i + 2];
+				info.palette[i][3] = 255;
+			}
+		}
+		else if (memcmp(type, "tRNS", 4) == 0)
+		{
+			if (info.colourType == 3)
+			{
+				for (uint32_t i = 0; i < length && i < 256; ++i) info.palette[i][3] = chunk[i];
+			}
+			else if ((info.colourType == 0 && length >= 2) || (info.colourType == 2 && length >= 6))
+			{
+				info.hasKey = true;
+				for (uint32_t c = 0; c < (info.colourType == 0 ? 1u : 3u); ++c) info.key[c] = static_cast<uint16_t>(Sample16(chunk + 2 * c));
+			}
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			if (!imageData)
+			{
+				imageData = chunk;
+				imageDataSize = length;
+			}
+			else
+			{
+				if (joinedData.empty()) joinedData.assign(imageData, imageData + imageDataSize);
+				joinedData.insert(joinedData.end(), chunk, chunk + length);
+			}
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			break;
+		}
+		else if ((type[0] & 0x20) == 0)
+		{
+			//Chunks with an upper case first letter are critical and cannot be skipped
+			error = "Unsupported PNG chunk " + std::string(reinterpret_cast<const char*>(type), 4);
+			return false;
+		}
+	}
+	if (!joinedData.empty())
+	{
+		imageData = joinedData.data();
+		imageDataSize = joinedData.size();
+	}
+	if (!imageData)
+	{
+		error = "PNG has no image data";
+		return false;
+	}
+
+	//Interlaced images are stored as seven smaller images (passes), each a subset of the pixels
+	struct Pass { uint32_t x, y, stepX, stepY; };
+	static const Pass Adam7[7] = { { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 } };
+	static const Pass Whole[1] = { { 0, 0, 1, 1 } };
+	const Pass* passes = info.interlaced ? Adam7 : Whole;
+	uint32_t passCount = info.interlaced ? 7 : 1;
+
+	size_t expectedSize = 0;
+	for (uint32_t p = 0; p < passCount; ++p)
+	{
+		uint32_t width = (info.width - passes[p].x + passes[p].stepX - 1) / passes[p].stepX;
+		uint32_t height = (info.height - passes[p].y + passes[p].stepY - 1) / passes[p].stepY;
+		if (width > 0 && height > 0) expectedSize += height * (RowBytes(width, info.bitsPerPixel) + 1);
+	}
+
+	std::vector<uint8_t> raw;
+	if (!ZlibDecompress(imageData, imageDataSize, raw, error, expectedSize)) return false;
+	if (raw.size() < expectedSize)
+	{
+		error = "PNG image data is too short";
+		return false;
+	}
+
+	image.Create(ImageFormat::RGBA8, info.width, info.height);
+	size_t stride = std::max(info.bitsPerPixel / 8, 1u);
+	std::vector<uint8_t> passRow;
+	uint8_t* pass = raw.data();
+	for (uint32_t p = 0; p < passCount; ++p)
+	{
+		uint32_t width = (info.width - passes[p].x + passes[p].stepX - 1) / passes[p].stepX;
+		uint32_t height = (info.height - passes[p].y + passes[p].stepY - 1) / passes[p].stepY;
+		if (width == 0 || height == 0) continue;
+
+		size_t rowBytes = RowBytes(width, info.bitsPerPixel);
+		if (!Unfilter(pass, height, rowBytes, stride, error)) return false;
+
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			const uint8_t* row = pass + y * (rowBytes + 1) + 1;
+			uint8_t* destination = image.GetRow(0, passes[p].y + y * passes[p].stepY);
+			if (!info.interlaced)
+			{
+				ConvertRow(row, width, info, destination);
+				continue;
+			}
+
+			passRow.resize(width * 4);
+			ConvertRow(row, width, info, passRow.data());
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				memcpy(destination + (passes[p].x + x * passes[p].stepX) * 4, passRow.data() + x * 4, 4);
+			}
+		}
+		pass += height * (rowBytes + 1);
+	}
+	return true;
+}
@@ -0,0 +1,390 @@
+//--------------------------------------------------------------------------------------
+// Quantizing the scene to a palette, with dithering
+//--------------------------------------------------------------------------------------
+
+#include "Palette.h"
+#include "CThreadPool.h"
+#include "ImageDecoders.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <thread>
+
+namespace
+{
+	//Run a function over ranges of [0, count) on the pool's workers, or all at once on this thread without a pool
+	void ParallelFor(CThreadPool* threads, uint32_t count, const std::function<void(uint32_t, uint32_t)>& function)
+	{
+		if (!threads || threads->GetThreadCount() == 0 || count < 2)
+		{
+			function(0, count);
+			return;
+		}
+		uint32_t step = std::max(count / (threads->GetThreadCount() * 4), 1u);
+		for (uint32_t first = 0; first < count; first += step)
+		{
+			uint32_t end = std::min(first + step, count);
+			threads->Submit([&function, first, end]() { function(first, end); });
+		}
+		threads->Wait();
+	}
+
+	//Pixels of a row diffused between checks on the row above, and between telling the row below how far this one has got
+	const uint32_t WavefrontChunk = 32;
+
+
+	//-------------------------------------
+	// Colour
+	//-------------------------------------
+
+	struct Lab
+	{
+		float L, a, b;
+	};
+
+	float LinearFromSRGB(float value)
+	{
+		value = std::clamp(value, 0.0f, 1.0f);
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	//OKLab of a colour given as display values (Ottosson's matrices)
+	Lab ToOKLab(const float rgb[3])
+	{
+		float r = LinearFromSRGB(rgb[0]), g = LinearFromSRGB(rgb[1]), b = LinearFromSRGB(rgb[2]);
+		float l = std::cbrt(0.4122214708f * r + 0.5363325363f * g + 0.0514459929f * b);
+		float m = std::cbrt(0.2119034982f * r + 0.6806995451f * g + 0.1073969566f * b);
+		float s = std::cbrt(0.0883024619f * r + 0.2817188376f * g + 0.6299787005f * b);
+		return { 0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s,
+		         1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s,
+		         0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s };
+	}
+
+	//Index of the nearest of the palette's colours, already in OKLab
+	uint32_t FindNearest(const std::vector<Lab>& colours, const Lab& colour)
+	{
+		uint32_t nearest = 0;
+		float nearestDistance = INFINITY;
+		for (uint32_t i = 0; i < colours.size(); ++i)
+		{
+			float dL = colours[i].L - colour.L, da = colours[i].a - colour.a, db = colours[i].b - colour.b;
+			float distance = dL * dL + da * da + db * db;
+			if (distance < nearestDistance)
+			{
+				nearest = i;
+				nearestDistance = distance;
+			}
+		}
+		return nearest;
+	}
+
+	bool IsFloatImage(const CImage& image)
+	{
+		return !image.IsEmpty() && image.GetFormat() == ImageFormat::RGBA32F;
+	}
+
+
+	//-------------------------------------
+	// Quantizing
+	//-------------------------------------
+
+	//Match a pixel's colour, clamped to 0->1, to the palette and write the palette colour. The clamped colour is returned in rgb
+	void MatchPixel(const Palette& palette, const PaletteLUT& lut, float rgb[3], float* out)
+	{
+		for (int c = 0; c < 3; ++c) rgb[c] = std::clamp(rgb[c], 0.0f, 1.0f);
+		const CVector3& colour = palette.colours[LookupPaletteLUT(lut, rgb)];
+		out[0] = colour.x;
+		out[1] = colour.y;
+		out[2] = colour.z;
+		out[3] = 1.0f;
+	}
+
+	//Floyd-Steinberg over the target in place: each pixel's error goes 7/16 to the right, 3/16 down-left, 5/16 down and 1/16
+	//down-right. A pixel's errors from the row above come from the three pixels above it, and the pixel to its right is sent
+	//its error only once the row above has sent that pixel its own. So a chunk of a row waits until the row above has done
+	//two pixels past the chunk's end, which keeps the order every error arrives in the same as one row after another
+	void DiffuseErrors(const Palette& palette, const PaletteLUT& lut, CImage& target, CThreadPool* threads)
+	{
+		const uint32_t width = target.GetWidth(), height = target.GetHeight();
+		std::unique_ptr<std::atomic<uint32_t>[]> done(new std::atomic<uint32_t>[height]); // Pixels of each row diffused
+		for (uint32_t y = 0; y < height; ++y) done[y].store(0, std::memory_order_relaxed);
+		std::atomic<uint32_t> nextRow(0);
+
+		//Rows are taken in order, so a row only waits on one already being worked on
+		const auto diffuseRows = [&]()
+		{
+			for (uint32_t y = nextRow++; y < height; y = nextRow++)
+			{
+				float* row = reinterpret_cast<float*>(target.GetRow(0, y));
+				float* below = y + 1 < height ? reinterpret_cast<float*>(target.GetRow(0, y + 1)) : nullptr;
+				for (uint32_t first = 0; first < width; first += WavefrontChunk)
+				{
+					const uint32_t end = std::min(first + WavefrontChunk, width);
+					if (y > 0)
+					{
+						const uint32_t needed = std::min(end + 2, width);
+						while (done[y - 1].load(std::memory_order_acquire) < needed) std::this_thread::yield();
+					}
+
+					for (uint32_t x = first; x < end; ++x)
+					{
+						float* pixel = row + x * 4;
+						float rgb[3] = { pixel[0], pixel[1], pixel[2] };
+						MatchPixel(palette, lut, rgb, pixel);
+						for (int c = 0; c < 3; ++c)
+						{
+							const float error = rgb[c] - pixel[c];
+							if (x + 1 < width) pixel[4 + c] += error * (7.0f / 16.0f);
+							if (!below) continue;
+							if (x > 0) below[(x - 1) * 4 + c] += error * (3.0f / 16.0f);
+							below[x * 4 + c] += error * (5.0f / 16.0f);
+							if (x + 1 < width) below[(x + 1) * 4 + c] += error * (1.0f / 16.0f);
+						}
+					}
+					done[y].store(end, std::memory_order_release);
+				}
+			}
+		};
+
+		if (!threads || threads->GetThreadCount() == 0 || height < 2)
+		{
+			diffuseRows();
+			return;
+		}
+		for (unsigned int i = 0; i < threads->GetThreadCount(); ++i) threads->Submit(diffuseRows);
+		threads->Wait();
+	}
+}
+
+
+//The palettes the scene offers
+const std::vector<Palette>& GetBuiltInPalettes()
+{
+	static const std::vector<Palette> Palettes =
+	{
+		{ "Gameboy", { { 0.0588f, 0.2196f, 0.0588f }, { 0.1882f, 0.3804f, 0.1882f }, { 0.5412f, 0.6706f, 0.0588f },
+		               { 0.7333f, 0.8118f, 0.3647f } } },
+		{ "PICO-8",  { { 0.0000f, 0.0000f, 0.0000f }, { 0.1137f, 0.1686f, 0.3255f }, { 0.4941f, 0.1451f, 0.3255f },
+		               { 0.0000f, 0.5294f, 0.3176f }, { 0.6706f, 0.3216f, 0.2118f }, { 0.3725f, 0.3412f, 0.3098f },
+		               { 0.7608f, 0.7647f, 0.7804f }, { 1.0000f, 0.9451f, 0.9098f }, { 1.0000f, 0.0000f, 0.3020f },
+		               { 1.0000f, 0.6392f, 0.0000f }, { 1.0000f, 0.9255f, 0.1529f }, { 0.0000f, 0.8941f, 0.2118f },
+		               { 0.1608f, 0.6784f, 1.0000f }, { 0.5137f, 0.4627f, 0.6118f }, { 1.0000f, 0.4667f, 0.6588f },
+		               { 1.0000f, 0.8000f, 0.6667f } } },
+		{ "CGA",     { { 0.0000f, 0.0000f, 0.0000f }, { 0.3333f, 1.0000f, 1.0000f }, { 1.0000f, 0.3333f, 1.0000f },
+		               { 1.0000f, 1.0000f, 1.0000f } } },
+	};
+	return Palettes;
+}
+
+//Name of a dither mode, for reports
+const char* GetDitherModeName(DitherMode mode)
+{
+	switch (mode)
+	{
+	case DitherMode::None:                return "None";
+	case DitherMode::Bayer:               return "Bayer";
+	case DitherMode::InterleavedGradient: return "InterleavedGradient";
+	case DitherMode::BlueNoise:           return "BlueNoise";
+	case DitherMode::FloydSteinberg:      return "FloydSteinberg";
+	default:                              return "Unknown";
+	}
+}
+
+//Index of the palette colour nearest a colour in OKLab, searching the whole palette
+uint32_t FindNearestPaletteColour(const Palette& palette, const float rgb[3])
+{
+	std::vector<Lab> colours;
+	for (const CVector3& colour : palette.colours)
+	{
+		const float entry[3] = { colour.x, colour.y, colour.z };
+		colours.push_back(ToOKLab(entry));
+	}
+	return colours.empty() ? 0 : FindNearest(colours, ToOKLab(rgb));
+}
+
+//Build the table of a palette's nearest colours
+bool BuildPaletteLUT(const Palette& palette, uint32_t size, PaletteLUT& lut, CThreadPool* threads)
+{
+	if (palette.colours.empty() || palette.colours.size() > MaxPaletteColours || size < MinPaletteLUTSize || size > MaxPaletteLUTSize)
+	{
+		return false;
+	}
+
+	std::vector<Lab> colours;
+	for (const CVector3& colour : palette.colours)
+	{
+		const float entry[3] = { colour.x, colour.y, colour.z };
+		colours.push_back(ToOKLab(entry));
+	}
+
+	lut.size = size;
+	lut.indices.resize(static_cast<size_t>(size) * size * size);
+	const float step = 1.0f / (size - 1);
+	ParallelFor(threads, size, [&](uint32_t first, uint32_t end)
+	{
+		for (uint32_t b = first; b < end; ++b)
+		{
+			uint8_t* entry = lut.indices.data() + static_cast<size_t>(b) * size * size;
+			for (uint32_t g = 0; g < size; ++g)
+			{
+				for (uint32_t r = 0; r < size; ++r)
+				{
+					const float rgb[3] = { r * step, g * step, b * step };
+					*entry++ = static_cast<uint8_t>(FindNearest(colours, ToOKLab(rgb)));
+				}
+			}
+		}
+	});
+	return true;
+}
+
+//Index of the palette colour in the table's entry nearest a colour
+uint32_t LookupPaletteLUT(const PaletteLUT& lut, const float rgb[3])
+{
+	const float last = static_cast<float>(lut.size - 1);
+	uint32_t index[3];
+	for (int c = 0; c < 3; ++c)
+	{
+		const float position = rgb[c] > 0.0f ? (rgb[c] < 1.0f ? rgb[c] * last : last) : 0.0f; // Also NaN
+		index[c] = static_cast<uint32_t>(position + 0.5f);
+	}
+	return lut.indices[(static_cast<size_t>(index[2]) * lut.size + index[1]) * lut.size + index[0]];
+}
+
+//The colours of the table's entries, RGBA32F with alpha 1
+std::vector<float> GetPaletteLUTColours(const Palette& palette, const PaletteLUT& lut)
+{
+	std::vector<float> colours;
+	colours.reserve(lut.indices.size() * 4);
+	for (uint8_t index : lut.indices)
+	{
+		const CVector3& colour = palette.colours[index];
+		colours.insert(colours.end(), { colour.x, colour.y, colour.z, 1.0f });
+	}
+	return colours;
+}
+
+//Average distance in each channel from each palette colour to its nearest neighbour
+float GetPaletteSpread(const Palette& palette)
+{
+	if (palette.colours.size() < 2) return 0.0f;
+
+	float total = 0.0f;
+	for (size_t i = 0; i < palette.colours.size(); ++i)
+	{
+		float nearest = INFINITY;
+		for (size_t j = 0; j < palette.colours.size(); ++j)
+		{
+			if (i == j) continue;
+			const CVector3& a = palette.colours[i];
+			const CVector3& b = palette.colours[j];
+			nearest = std::min(nearest, std::sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) + (a.z - b.z) * (a.z - b.z)));
+		}
+		total += nearest;
+	}
+	//A distance along the diagonal of the colour cube is sqrt(3) times the change in each channel
+	return total / (palette.colours.size() * std::sqrt(3.0f));
+}
+
+//Read a tile of blue noise into the blue-noise dither's thresholds
+bool LoadDitherTile(const std::string& fileName, DitherTile& tile)
+{
+	std::ifstream stream(fileName, std::ios::binary);
+	if (!stream) return false;
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+	CImage noise;
+	std::string error;
+	if (!DecodeImage(data.data(), data.size(), noise, error) || noise.GetFormat() != ImageFormat::R8 || noise.GetWidth() == 0 ||
+	    noise.GetWidth() != noise.GetHeight())
+	{
+		return false;
+	}
+
+	tile.size = noise.GetWidth();
+	tile.thresholds.resize(static_cast<size_t>(tile.size) * tile.size);
+	for (uint32_t y = 0; y < tile.size; ++y)
+	{
+		const uint8_t* row = noise.GetRow(0, y);
+		for (uint32_t x = 0; x < tile.size; ++x) tile.thresholds[y * tile.size + x] = (row[x] + 0.5f) / 256.0f;
+	}
+	return true;
+}
+
+//Threshold 0->1 of an ordered dither at a pixel
+float GetDitherThreshold(DitherMode mode, uint32_t x, uint32_t y, const DitherTile* tile)
+{
+	if (mode == DitherMode::Bayer)
+	{
+		//The 8x8 Bayer matrix is the bits of x ^ y and y interleaved, then reversed
+		uint32_t xy = x ^ y, index = 0;
+		for (int bit = 0; bit < 3; ++bit)
+		{
+			index |= ((xy >> bit) & 1) << (5 - 2 * bit);
+			index |= ((y >> bit) & 1) << (4 - 2 * bit);
+		}
+		return (index + 0.5f) / 64.0f;
+	}
+	if (mode == DitherMode::InterleavedGradient)
+	{
+		//Interleaved gradient noise (Jimenez), at the pixel as the shader takes it from SV_Position
+		float value = 0.06711056f * x + 0.00583715f * y;
+		value = 52.9829189f * (value - std::floor(value));
+		return value - std::floor(value);
+	}
+	if (mode == DitherMode::BlueNoise && tile && tile->size > 0)
+	{
+		return tile->thresholds[(y % tile->size) * tile->size + x % tile->size];
+	}
+	return 0.5f;
+}
+
+//Quantize a scene to a palette into the target, dithering as asked
+bool QuantizeToPalette(const Palette& palette, const PaletteLUT& lut, DitherMode mode, float spread, const CImage& scene, CImage& target,
+                       CThreadPool* threads, const DitherTile* tile)
+{
+	if (!IsFloatImage(scene) || lut.size < MinPaletteLUTSize || lut.indices.size() != static_cast<size_t>(lut.size) * lut.size * lut.size)
+	{
+		return false;
+	}
+	if (mode == DitherMode::BlueNoise && (!tile || tile->size == 0)) return false;
+	const uint32_t width = scene.GetWidth(), height = scene.GetHeight();
+
+	if (mode == DitherMode::FloydSteinberg)
+	{
+		//The errors are added up in the target, starting from the scene
+		if (&scene != &target) target = scene;
+		DiffuseErrors(palette, lut, target, threads);
+		return true;
+	}
+
+	if (&scene != &target && !target.Create(ImageFormat::RGBA32F, width, height)) return false;
+	ParallelFor(threads, height, [&](uint32_t first, uint32_t end)
+	{
+		for (uint32_t y = first; y < end; ++y)
+		{
+			const float* in = reinterpret_cast<const float*>(scene.GetRow(0, y));
+			float* out = reinterpret_cast<float*>(target.GetRow(0, y));
+			for (uint32_t x = 0; x < width; ++x, in += 4, out += 4)
+			{
+				const float offset = (GetDitherThreshold(mode, x, y, tile) - 0.5f) * spread;
+				float rgb[3] = { in[0] + offset, in[1] + offset, in[2] + offset };
+				MatchPixel(palette, lut, rgb, out);
+			}
+		}
+	});
+	return true;
+}
+
+//Put a table's size and the dither in the post-process constants, for Palette_ps
+void SetPaletteConstants(PostProcessingConstants& constants, const PaletteLUT& lut, DitherMode mode, float spread)
+{
+	constants.paletteLUTSize = static_cast<float>(lut.size);
+	constants.ditherMode = mode == DitherMode::FloydSteinberg ? 0.0f : static_cast<float>(mode);
+	constants.ditherSpread = mode == DitherMode::None ? 0.0f : spread;
+}
@@ -0,0 +1,101 @@
+//--------------------------------------------------------------------------------------
+// Quantizing the scene to a palette, with dithering
+//--------------------------------------------------------------------------------------
+// Each pixel is matched to the nearest colour of a palette in OKLab, through a table of nearest
+// colours built once per palette. Ordered dithers move colours by a repeating threshold first, and
+// Floyd-Steinberg passes each pixel's error on instead, on the CPU only. Palette_ps does the
+// ordered dithers and the lookup on the GPU.
+#pragma once
+#include "CImage.h"
+#include "project/PostProcessingConstants.h"
+
+#include <string>
+#include <vector>
+
+class CThreadPool;
+
+//A palette of colours, red, green and blue each 0->1 as displayed
+struct Palette
+{
+	const char*           name;
+	std::vector<CVector3> colours;
+};
+
+//The palettes the scene offers: the Gameboy's four greens, PICO-8's sixteen colours and CGA's cyan, magenta and white
+const std::vector<Palette>& GetBuiltInPalettes();
+
+//Largest palette that can be used, as the table holds a byte per entry
+const size_t MaxPaletteColours = 256;
+
+//Ways of dithering the scene as it is quantized. The values are the shader's gDitherMode
+enum class DitherMode
+{
+	None,
+	Bayer,
+	InterleavedGradient,
+	BlueNoise,
+	FloydSteinberg, // CPU only
+};
+
+//Name of a dither mode, for reports
+const char* GetDitherModeName(DitherMode mode);
+
+//The nearest palette colour to each of a grid of colours
+struct PaletteLUT
+{
+	uint32_t size = 0;            // Entries along each axis, covering 0->1
+	std::vector<uint8_t> indices; // Palette index for each entry, red fastest, then green, then blue
+
+	//Bytes held by the table
+	size_t GetSize() const { return indices.size(); }
+};
+
+//Smallest and largest sizes of table that can be built
+const uint32_t MinPaletteLUTSize = 2;
+const uint32_t MaxPaletteLUTSize = 128;
+
+//Index of the palette colour nearest a colour in OKLab, searching the whole palette. OKLab distances follow how different colours
+//look far better than RGB's. Colours are display values, as the palettes' are, so are linearized from sRGB first
+uint32_t FindNearestPaletteColour(const Palette& palette, const float rgb[3]);
+
+//Build the table of a palette's nearest colours with size (MinPaletteLUTSize -> MaxPaletteLUTSize) entries along each axis,
+//using the pool's workers if one is given, so pixels read an entry rather than search the palette. Colours near the edge between
+//two palette colours can pick the other one, less often for a larger table. Returns false for an empty palette, one of more than
+//MaxPaletteColours or a size out of bounds
+bool BuildPaletteLUT(const Palette& palette, uint32_t size, PaletteLUT& lut, CThreadPool* threads = nullptr);
+
+//Index of the palette colour in the table's entry nearest a colour, clamped to 0->1
+uint32_t LookupPaletteLUT(const PaletteLUT& lut, const float rgb[3]);
+
+//The colours of the table's entries, RGBA32F with alpha 1, for Palette_ps's 3D texture
+std::vector<float> GetPaletteLUTColours(const Palette& palette, const PaletteLUT& lut);
+
+//Average distance in each channel from each palette colour to its nearest neighbour, the ordered dithers' default spread
+float GetPaletteSpread(const Palette& palette);
+
+//Thresholds of the blue-noise dither, a tile repeated across the scene
+struct DitherTile
+{
+	uint32_t size = 0;             // Texels along each side
+	std::vector<float> thresholds; // 0->1 for each texel, row by row
+};
+
+//Read a square R8 tile of blue noise, as "AssetTool blue-noise" makes Media/BlueNoise64.dds, into a dither tile. Each byte b
+//becomes the threshold (b + 0.5) / 256, centred as Bayer's are. Returns false if the file cannot be read or holds another image
+bool LoadDitherTile(const std::string& fileName, DitherTile& tile);
+
+//Threshold 0->1 of an ordered dither at a pixel, 0.5 for the other modes. Bayer is the 8x8 Bayer matrix, whose regular pattern
+//shows as a grid. InterleavedGradient is Jimenez's interleaved gradient noise, with less low frequency so the mix looks more
+//like grain. BlueNoise reads the tile at the pixel modulo its size, with almost no low frequency at all, and is 0.5 without one
+float GetDitherThreshold(DitherMode mode, uint32_t x, uint32_t y, const DitherTile* tile = nullptr);
+
+//Quantize the top mip of an RGBA32F scene to a palette into target (created to match, and may be the scene), dithering as
+//asked with ordered dithers moving colours by up to half of spread either way, using the pool's workers if one is given.
+//Floyd-Steinberg's rows run at once as a wavefront, each waiting until the row above is far enough ahead that its errors have
+//arrived, in the same order as one row after another. So every way gives the same results with or without the pool. Alpha is
+//written as 1. BlueNoise needs the tile. Returns false for other formats, an empty table or BlueNoise without a tile
+bool QuantizeToPalette(const Palette& palette, const PaletteLUT& lut, DitherMode mode, float spread, const CImage& scene, CImage& target,
+                       CThreadPool* threads = nullptr, const DitherTile* tile = nullptr);
+
+//Put a table's size and the dither in the post-process constants, for Palette_ps
+void SetPaletteConstants(PostProcessingConstants& constants, const PaletteLUT& lut, DitherMode mode, float spread);
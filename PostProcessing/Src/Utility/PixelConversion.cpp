@@ -0,0 +1,428 @@
+//--------------------------------------------------------------------------------------
+// Converting pixels between formats on the CPU
+//--------------------------------------------------------------------------------------
+
+#include "PixelConversion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define PIXEL_SIMD 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define SSE_FUNCTION
+		#define F16C_FUNCTION
+	#else
+		#define SSE_FUNCTION  __attribute__((target("sse2")))
+		#define F16C_FUNCTION __attribute__((target("avx,f16c")))
+	#endif
+#else
+	#define PIXEL_SIMD 0
+#endif
+
+namespace
+{
+	uint32_t FloatBits(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	float BitsFloat(uint32_t bits)
+	{
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	//Shift right, rounding to nearest with ties to even
+	uint32_t ShiftRoundEven(uint64_t value, uint32_t shift)
+	{
+		if (shift == 0) return static_cast<uint32_t>(value);
+		if (shift > 40) return 0;
+		uint64_t odd = (value >> shift) & 1;
+		return static_cast<uint32_t>((value + (1ull << (shift - 1)) - 1 + odd) >> shift);
+	}
+
+
+	//-------------------------------------
+	// Small unsigned floats
+	//-------------------------------------
+	// The channels of R11G11B10 have a 5-bit exponent with bias 15, as a half float, and 6 or 5 bits of mantissa with no sign
+
+	//Convert a float to a small unsigned float, following D3D: negative values become 0, values above the largest finite
+	//value clamp to it, infinity stays infinity and NaN stays NaN. Rounds to nearest even
+	uint32_t FloatToSmallFloat(float value, uint32_t mantissaBits)
+	{
+		const uint32_t bits = FloatBits(value);
+		const uint32_t mantissaMask = (1u << mantissaBits) - 1;
+		const uint32_t infinity = 31u << mantissaBits;
+		if ((bits & 0x7f800000) == 0x7f800000)
+		{
+			if (bits & 0x7fffff) return infinity | (1u << (mantissaBits - 1)) | ((bits >> (23 - mantissaBits)) & mantissaMask);
+			return (bits & 0x80000000) ? 0 : infinity;
+		}
+		if (bits & 0x80000000) return 0;
+
+		//The largest finite value is exponent 30 (2^15) with every mantissa bit set
+		const uint32_t largest = (142u << 23) | (mantissaMask << (23 - mantissaBits));
+		if (bits > largest) return (30u << mantissaBits) | mantissaMask;
+
+		const uint32_t exponent = bits >> 23;
+		if (exponent < 113)
+		{
+			//Below 2^-14 the small float is denormal: shift the whole mantissa, with its leading 1, down to its units
+			if (exponent == 0) return 0;
+			return ShiftRoundEven((bits & 0x7fffff) | 0x800000, 136 - mantissaBits - exponent);
+		}
+		//Rebias the exponent from 127 to 15 and round the mantissa, letting a carry out of it step the exponent
+		return ShiftRoundEven(bits - (112u << 23), 23 - mantissaBits);
+	}
+
+	float SmallFloatToFloat(uint32_t value, uint32_t mantissaBits)
+	{
+		const uint32_t exponent = value >> mantissaBits;
+		const uint32_t mantissa = value & ((1u << mantissaBits) - 1);
+		if (exponent == 31) return BitsFloat(0x7f800000 | (mantissa << (23 - mantissaBits)) | (mantissa ? 0x400000 : 0));
+		if (exponent == 0) return std::ldexp(static_cast<float>(mantissa), -14 - static_cast<int>(mantissaBits));
+		return BitsFloat(((exponent + 112) << 23) | (mantissa << (23 - mantissaBits)));
+	}
+
+
+	//-------------------------------------
+	// sRGB
+	//-------------------------------------
+
+	struct SRGBTable
+	{
+		float toLinear[256];
+
+		SRGBTable()
+		{
+			for (int i = 0; i < 256; ++i)
+			{
+				double s = i / 255.0;
+				toLinear[i] = static_cast<float>(s <= 0.04045 ? s / 12.92 : std::pow((s + 0.055) / 1.055, 2.4));
+			}
+		}
+	};
+	const SRGBTable SRGB;
+
+	//Above the linear toe, 1.055 * x^(1/2.4) - 0.055 is approximated from x^(1/2), x^(1/4) and x^(1/8), which only need square
+	//roots, so the SIMD and scalar versions give exactly the same bytes
+	const float SRGBToe = 0.0031308f;
+	const float SRGBPolynomial[4] = { 0.662002687f, 0.684122060f, -0.323583601f, -0.0225411470f };
+
+	uint8_t LinearToSRGBScalar(float value)
+	{
+		if (!(value > 0.0f)) return 0; // Also NaN
+		value = std::min(value, 1.0f);
+		float encoded;
+		if (value <= SRGBToe)
+		{
+			encoded = value * 12.92f;
+		}
+		else
+		{
+			float s1 = std::sqrt(value), s2 = std::sqrt(s1), s3 = std::sqrt(s2);
+			encoded = SRGBPolynomial[0] * s1 + SRGBPolynomial[1] * s2 + SRGBPolynomial[2] * s3 + SRGBPolynomial[3] * value;
+		}
+		return static_cast<uint8_t>(std::min(encoded, 1.0f) * 255.0f + 0.5f);
+	}
+
+
+	//-------------------------------------
+	// RGB9E5
+	//-------------------------------------
+	// Three 9-bit mantissas sharing one 5-bit exponent with bias 15, as specified for GL_EXT_texture_shared_exponent and D3D
+
+	const float RGB9E5Largest = 65408.0f; // (511 / 512) * 2^16
+
+	float ClampRGB9E5(float value)
+	{
+		return value > 0.0f ? std::min(value, RGB9E5Largest) : 0.0f; // Also NaN to 0, which the format cannot hold
+	}
+
+
+#if PIXEL_SIMD
+	//-------------------------------------
+	// SIMD versions
+	//-------------------------------------
+
+	F16C_FUNCTION void F32ToF16F16C(const float* input, uint16_t* output, size_t count)
+	{
+		for (size_t i = 0; i < count; i += 8)
+		{
+			__m128i halves = _mm256_cvtps_ph(_mm256_loadu_ps(input + i), _MM_FROUND_TO_NEAREST_INT);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), halves);
+		}
+	}
+
+	F16C_FUNCTION void F16ToF32F16C(const uint16_t* input, float* output, size_t count)
+	{
+		for (size_t i = 0; i < count; i += 8)
+		{
+			_mm256_storeu_ps(output + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i))));
+		}
+	}
+
+	SSE_FUNCTION void LinearToSRGB8SSE(const float* input, uint8_t* output, size_t count)
+	{
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), toe = _mm_set1_ps(SRGBToe), slope = _mm_set1_ps(12.92f);
+		const __m128 c0 = _mm_set1_ps(SRGBPolynomial[0]), c1 = _mm_set1_ps(SRGBPolynomial[1]);
+		const __m128 c2 = _mm_set1_ps(SRGBPolynomial[2]), c3 = _mm_set1_ps(SRGBPolynomial[3]);
+		const __m128 scale = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+		for (size_t i = 0; i < count; i += 4)
+		{
+			//max with zero first turns NaN to 0, as the scalar version does
+			__m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(input + i), zero), one);
+			__m128 s1 = _mm_sqrt_ps(value), s2 = _mm_sqrt_ps(s1), s3 = _mm_sqrt_ps(s2);
+			__m128 curve = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, s1), _mm_mul_ps(c1, s2)), _mm_mul_ps(c2, s3)), _mm_mul_ps(c3, value));
+			__m128 linear = _mm_mul_ps(value, slope);
+			__m128 useLinear = _mm_cmple_ps(value, toe);
+			__m128 encoded = _mm_or_ps(_mm_and_ps(useLinear, linear), _mm_andnot_ps(useLinear, curve));
+			__m128i bytes = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(encoded, one), scale), half));
+			bytes = _mm_packs_epi32(bytes, bytes);
+			bytes = _mm_packus_epi16(bytes, bytes);
+			uint32_t packed = static_cast<uint32_t>(_mm_cvtsi128_si32(bytes));
+			std::memcpy(output + i, &packed, 4);
+		}
+	}
+
+	SSE_FUNCTION void SwapRedBlueSSE(const uint8_t* input, uint8_t* output, size_t pixels)
+	{
+		const __m128i greenAlpha = _mm_set1_epi32(static_cast<int>(0xff00ff00));
+		for (size_t i = 0; i < pixels; i += 4)
+		{
+			__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i * 4));
+			__m128i redBlue = _mm_andnot_si128(greenAlpha, p);
+			redBlue = _mm_shufflehi_epi16(_mm_shufflelo_epi16(redBlue, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+			__m128i swapped = _mm_or_si128(_mm_and_si128(greenAlpha, p), redBlue);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i * 4), swapped);
+		}
+	}
+#endif
+}
+
+
+//-------------------------------------
+// Single values
+//-------------------------------------
+
+//Convert a float to a half float, rounding to nearest even. Values too large for a half become infinity, and NaN stays NaN with
+//the top of its payload, made quiet, as the F16C instructions do
+uint16_t FloatToHalf(float value)
+{
+	uint32_t bits = FloatBits(value);
+	const uint32_t sign = (bits >> 16) & 0x8000;
+	bits &= 0x7fffffff;
+
+	uint32_t half;
+	if (bits >= 0x47800000) // 2^16 and above, where the exponent overflows, and infinity and NaN
+	{
+		half = bits > 0x7f800000 ? 0x7e00 | ((bits >> 13) & 0x3ff) : 0x7c00;
+	}
+	else if (bits < 0x38800000) // Below 2^-14, where the half is denormal
+	{
+		//Adding 0.5 lines the half's denormal units up with the float's last mantissa bit, and the addition rounds to nearest even
+		half = FloatBits(BitsFloat(bits) + 0.5f) - 0x3f000000;
+	}
+	else
+	{
+		//Rebias the exponent from 127 to 15 and round the mantissa, letting a carry out of it step the exponent (up to infinity)
+		half = ShiftRoundEven(bits - (112u << 23), 13);
+	}
+	return static_cast<uint16_t>(half | sign);
+}
+
+//Convert a half float to a float, which is exact. A signalling NaN becomes quiet, as with the F16C instructions
+float HalfToFloat(uint16_t half)
+{
+	const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+	const uint32_t exponent = (half >> 10) & 0x1f;
+	const uint32_t mantissa = half & 0x3ff;
+	uint32_t bits;
+	if (exponent == 31)
+	{
+		bits = 0x7f800000 | (mantissa << 13) | (mantissa ? 0x400000 : 0);
+	}
+	else if (exponent == 0)
+	{
+		return BitsFloat(sign | FloatBits(mantissa * (1.0f / 16777216.0f))); // mantissa * 2^-24
+	}
+	else
+	{
+		bits = ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	return BitsFloat(sign | bits);
+}
+
+float SRGBToLinear(uint8_t value)
+{
+	return SRGB.toLinear[value];
+}
+
+uint8_t LinearToSRGB(float value)
+{
+	return LinearToSRGBScalar(value);
+}
+
+uint32_t PackR11G11B10(float red, float green, float blue)
+{
+	return FloatToSmallFloat(red, 6) | FloatToSmallFloat(green, 6) << 11 | FloatToSmallFloat(blue, 5) << 22;
+}
+
+void UnpackR11G11B10(uint32_t packed, float rgb[3])
+{
+	rgb[0] = SmallFloatToFloat(packed & 0x7ff, 6);
+	rgb[1] = SmallFloatToFloat((packed >> 11) & 0x7ff, 6);
+	rgb[2] = SmallFloatToFloat(packed >> 22, 5);
+}
+
+//Pack to RGB9E5. The shared exponent is chosen so the largest channel fits, and the channels are rounded to nearest in it
+uint32_t PackRGB9E5(float red, float green, float blue)
+{
+	const float r = ClampRGB9E5(red), g = ClampRGB9E5(green), b = ClampRGB9E5(blue);
+	const float largest = std::max(r, std::max(g, b));
+
+	//floor(log2(largest)) + 1 + bias, exactly from the float's exponent, at least 0
+	int exponent = 0;
+	if (largest > 0.0f)
+	{
+		int power;
+		std::frexp(largest, &power); // largest = f * 2^power with f in [0.5, 1)
+		exponent = std::max(power, -15) + 15;
+	}
+	//If the largest channel rounds up to 512 it needs the next exponent
+	if (std::floor(std::ldexp(largest, 24 - exponent) + 0.5f) >= 512.0f) ++exponent;
+
+	const auto mantissa = [exponent](float value) { return static_cast<uint32_t>(std::floor(std::ldexp(value, 24 - exponent) + 0.5f)); };
+	return mantissa(r) | mantissa(g) << 9 | mantissa(b) << 18 | static_cast<uint32_t>(exponent) << 27;
+}
+
+void UnpackRGB9E5(uint32_t packed, float rgb[3])
+{
+	const int exponent = static_cast<int>(packed >> 27) - 24;
+	rgb[0] = std::ldexp(static_cast<float>(packed & 0x1ff), exponent);
+	rgb[1] = std::ldexp(static_cast<float>((packed >> 9) & 0x1ff), exponent);
+	rgb[2] = std::ldexp(static_cast<float>((packed >> 18) & 0x1ff), exponent);
+}
+
+
+//-------------------------------------
+// Arrays
+//-------------------------------------
+
+void ConvertF32ToF16(const float* input, uint16_t* output, size_t count, bool useSIMD)
+{
+	size_t i = 0;
+#if PIXEL_SIMD
+	if (useSIMD && HasF16C())
+	{
+		i = count & ~static_cast<size_t>(7);
+		F32ToF16F16C(input, output, i);
+	}
+#endif
+	for (; i < count; ++i) output[i] = FloatToHalf(input[i]);
+}
+
+void ConvertF16ToF32(const uint16_t* input, float* output, size_t count, bool useSIMD)
+{
+	size_t i = 0;
+#if PIXEL_SIMD
+	if (useSIMD && HasF16C())
+	{
+		i = count & ~static_cast<size_t>(7);
+		F16ToF32F16C(input, output, i);
+	}
+#endif
+	for (; i < count; ++i) output[i] = HalfToFloat(input[i]);
+}
+
+void ConvertSRGB8ToLinear(const uint8_t* input, float* output, size_t count)
+{
+	for (size_t i = 0; i < count; ++i) output[i] = SRGB.toLinear[input[i]];
+}
+
+void ConvertLinearToSRGB8(const float* input, uint8_t* output, size_t count, bool useSIMD)
+{
+	size_t i = 0;
+#if PIXEL_SIMD
+	if (useSIMD)
+	{
+		i = count & ~static_cast<size_t>(3);
+		LinearToSRGB8SSE(input, output, i);
+	}
+#endif
+	for (; i < count; ++i) output[i] = LinearToSRGBScalar(input[i]);
+}
+
+void ConvertRGBToR11G11B10(const float* input, uint32_t* output, size_t pixels)
+{
+	for (size_t p = 0; p < pixels; ++p, input += 3) output[p] = PackR11G11B10(input[0], input[1], input[2]);
+}
+
+void ConvertR11G11B10ToRGB(const uint32_t* input, float* output, size_t pixels)
+{
+	for (size_t p = 0; p < pixels; ++p, output += 3) UnpackR11G11B10(input[p], output);
+}
+
+void ConvertRGBToRGB9E5(const float* input, uint32_t* output, size_t pixels)
+{
+	for (size_t p = 0; p < pixels; ++p, input += 3) output[p] = PackRGB9E5(input[0], input[1], input[2]);
+}
+
+void ConvertRGB9E5ToRGB(const uint32_t* input, float* output, size_t pixels)
+{
+	for (size_t p = 0; p < pixels; ++p, output += 3) UnpackRGB9E5(input[p], output);
+}
+
+void SwapRedBlue(const uint8_t* input, uint8_t* output, size_t pixels, bool useSIMD)
+{
+	const uint8_t order[4] = { 2, 1, 0, 3 };
+#if PIXEL_SIMD
+	if (useSIMD)
+	{
+		size_t simdPixels = pixels & ~static_cast<size_t>(3);
+		SwapRedBlueSSE(input, output, simdPixels);
+		SwizzleRGBA8(input + simdPixels * 4, output + simdPixels * 4, pixels - simdPixels, order);
+		return;
+	}
+#endif
+	SwizzleRGBA8(input, output, pixels, order);
+}
+
+void SwizzleRGBA8(const uint8_t* input, uint8_t* output, size_t pixels, const uint8_t order[4])
+{
+	for (size_t p = 0; p < pixels; ++p, input += 4, output += 4)
+	{
+		uint8_t pixel[4] = { input[0], input[1], input[2], input[3] };
+		for (int c = 0; c < 4; ++c) output[c] = pixel[order[c] & 3];
+	}
+}
+
+//Return true if the processor supports the F16C half float conversions, and the operating system saves the AVX registers they use
+bool HasF16C()
+{
+#if PIXEL_SIMD
+	static const bool supported = []()
+	{
+	#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		const int osxsave = 1 << 27, avx = 1 << 28, f16c = 1 << 29;
+		if ((info[2] & (osxsave | avx | f16c)) != (osxsave | avx | f16c)) return false;
+		return (_xgetbv(0) & 6) == 6; // SSE and AVX state
+	#else
+		return __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+	#endif
+	}();
+	return supported;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,59 @@
+//--------------------------------------------------------------------------------------
+// Converting pixels between formats on the CPU
+//--------------------------------------------------------------------------------------
+// Whole arrays of values converted between 32-bit floats and the formats rendered to or read from
+// textures - half floats, sRGB bytes and the packed HDR formats - with SIMD where it helps. The
+// single value versions are for code converting one value at a time.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+//-------------------------------------
+// Single values
+//-------------------------------------
+
+//Rounded to nearest even
+uint16_t FloatToHalf(float value);
+float    HalfToFloat(uint16_t half);
+
+float   SRGBToLinear(uint8_t value);
+uint8_t LinearToSRGB(float value); // Clamped to 0->1
+
+//The packed HDR formats have no sign, so negative values are clamped to 0 and values too large for the format to its largest.
+//They round as D3D does, to nearest even for R11G11B10 and to nearest for RGB9E5's shared exponent
+uint32_t PackR11G11B10(float red, float green, float blue);
+void     UnpackR11G11B10(uint32_t packed, float rgb[3]);
+
+uint32_t PackRGB9E5(float red, float green, float blue);
+void     UnpackRGB9E5(uint32_t packed, float rgb[3]);
+
+
+//-------------------------------------
+// Arrays
+//-------------------------------------
+// Set useSIMD to false to force the scalar code, e.g. to compare the two
+
+//Half floats use the F16C instructions eight at a time when the processor supports them, checked at run time so the same build
+//runs anywhere, and exact bit manipulation otherwise. Both give identical results
+void ConvertF32ToF16(const float* input, uint16_t* output, size_t count, bool useSIMD = true);
+void ConvertF16ToF32(const uint16_t* input, float* output, size_t count, bool useSIMD = true);
+
+//sRGB bytes become linear floats through a 256 entry table. Linear floats become sRGB bytes through a polynomial in square roots,
+//four at a time with SSE2, which is within one step of the exact result and exact for every byte decoded by the table
+void ConvertSRGB8ToLinear(const uint8_t* input, float* output, size_t count);
+void ConvertLinearToSRGB8(const float* input, uint8_t* output, size_t count, bool useSIMD = true);
+
+//Pack and unpack pixels of three floats (red, green, blue) to and from one 32-bit value each
+void ConvertRGBToR11G11B10(const float* input, uint32_t* output, size_t pixels);
+void ConvertR11G11B10ToRGB(const uint32_t* input, float* output, size_t pixels);
+void ConvertRGBToRGB9E5(const float* input, uint32_t* output, size_t pixels);
+void ConvertRGB9E5ToRGB(const uint32_t* input, float* output, size_t pixels);
+
+//Swap the red and blue channels of RGBA8 pixels, turning RGBA8 into BGRA8 and back, with SSE2. input and output may be the same
+void SwapRedBlue(const uint8_t* input, uint8_t* output, size_t pixels, bool useSIMD = true);
+
+//Reorder the channels of RGBA8 pixels: output channel c is input channel order[c], 0-3. input and output may be the same
+void SwizzleRGBA8(const uint8_t* input, uint8_t* output, size_t pixels, const uint8_t order[4]);
+
+//Return true if the processor supports the F16C half float conversions
+bool HasF16C();
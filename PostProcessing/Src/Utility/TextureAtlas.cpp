@@ -0,0 +1,207 @@
+//--------------------------------------------------------------------------------------
+// Packing several small textures into one atlas texture
+//--------------------------------------------------------------------------------------
+
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+//ImGui builds its own copy of stb_rect_pack privately (STBRP_STATIC), so this file does the same
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+namespace
+{
+	//Return the source coordinate for a destination coordinate that may lie in the gutter, either side of an entry of the given size
+	uint32_t AddressEntry(int coordinate, uint32_t size, bool wrap)
+	{
+		int s = static_cast<int>(size);
+		if (wrap) return static_cast<uint32_t>(((coordinate % s) + s) % s);
+		return static_cast<uint32_t>(std::clamp(coordinate, 0, s - 1));
+	}
+
+	//Place rects of the given sizes (in cells) in an atlas of the given size. Returns false if they do not all fit
+	bool PackCells(std::vector<stbrp_rect>& rects, int width, int height)
+	{
+		std::vector<stbrp_node> nodes(width);
+		stbrp_context context;
+		stbrp_init_target(&context, width, height, nodes.data(), width);
+		return stbrp_pack_rects(&context, rects.data(), static_cast<int>(rects.size())) != 0;
+	}
+}
+
+
+//Return the rect of the entry with the given name, or the whole atlas if there is none
+AtlasRect AtlasLayout::GetRect(const std::string& name) const
+{
+	AtlasRect rect;
+	for (auto& entry : entries)
+	{
+		if (entry.name != name) continue;
+		rect.u      = static_cast<float>(entry.left)   / width;
+		rect.v      = static_cast<float>(entry.top)    / height;
+		rect.width  = static_cast<float>(entry.width)  / width;
+		rect.height = static_cast<float>(entry.height) / height;
+		break;
+	}
+	return rect;
+}
+
+//Fraction of the atlas's area covered by the entries
+double AtlasLayout::GetUtilization() const
+{
+	return GetUtilizationWithGutters(0);
+}
+
+//Fraction of the atlas's area covered by the entries and the gutters around them
+double AtlasLayout::GetUtilizationWithGutters(uint32_t gutter) const
+{
+	if (width == 0 || height == 0) return 0;
+	double used = 0;
+	for (auto& entry : entries) used += static_cast<double>(entry.width + 2 * gutter) * (entry.height + 2 * gutter);
+	return used / (static_cast<double>(width) * height);
+}
+
+
+//Pack images into an atlas no larger than maxSize on either side
+bool BuildAtlas(const std::vector<AtlasInput>& inputs, uint32_t gutter, uint32_t maxSize, CImage& atlas, AtlasLayout& layout, std::string& error)
+{
+	if (inputs.empty() || gutter == 0 || (gutter & (gutter - 1)) != 0)
+	{
+		error = "An atlas needs at least one image and a power of two gutter";
+		return false;
+	}
+
+	//Every image shares the atlas's format, and the atlas has no more mips than the gutter keeps apart or any image can fill
+	ImageFormat format = inputs[0].image ? inputs[0].image->GetFormat() : ImageFormat::Unknown;
+	uint32_t mipCount = CImage::CountMips(gutter, gutter);
+	for (auto& input : inputs)
+	{
+		if (!input.image || input.image->IsEmpty() || input.image->GetFormat() != format ||
+		    (format != ImageFormat::RGBA8 && format != ImageFormat::BGRA8))
+		{
+			error = "Atlas image " + input.name + " is missing or not in the same RGBA8 or BGRA8 format as the others";
+			return false;
+		}
+		mipCount = std::min(mipCount, input.image->GetMipCount());
+		while (mipCount > 1 && ((input.image->GetWidth() | input.image->GetHeight()) & ((1u << (mipCount - 1)) - 1)) != 0) --mipCount;
+	}
+
+	//Pack in cells of the gutter size, each image taking a cell of gutter on every side, so entries start on a multiple of
+	//the gutter and keep it between them at every mip
+	std::vector<stbrp_rect> rects(inputs.size());
+	for (size_t i = 0; i < inputs.size(); ++i)
+	{
+		rects[i].id = static_cast<int>(i);
+		rects[i].w = static_cast<stbrp_coord>((inputs[i].image->GetWidth()  + gutter - 1) / gutter + 2);
+		rects[i].h = static_cast<stbrp_coord>((inputs[i].image->GetHeight() + gutter - 1) / gutter + 2);
+	}
+
+	//Try each width in whole cells, packing with room to spare below and keeping the width whose packing covers the least
+	//area, squarer first. The GPU needs no power of two sizes, and a multiple of the gutter still halves evenly down to the
+	//last mip
+	const int maxCells = static_cast<int>(maxSize / gutter);
+	int bestWidth = 0, bestHeight = 0;
+	for (int width = 1; width <= maxCells; ++width)
+	{
+		if (!PackCells(rects, width, maxCells)) continue;
+
+		int height = 0;
+		for (auto& rect : rects) height = std::max(height, rect.y + rect.h);
+		uint64_t area = static_cast<uint64_t>(width) * height, bestArea = static_cast<uint64_t>(bestWidth) * bestHeight;
+		if (bestWidth == 0 || area < bestArea || (area == bestArea && std::max(width, height) < std::max(bestWidth, bestHeight)))
+		{
+			bestWidth = width;
+			bestHeight = height;
+		}
+	}
+	if (bestWidth == 0 || !PackCells(rects, bestWidth, bestHeight))
+	{
+		error = "The images do not fit in an atlas of " + std::to_string(maxSize) + " pixels";
+		return false;
+	}
+
+	layout = AtlasLayout();
+	layout.width = bestWidth * gutter;
+	layout.height = bestHeight * gutter;
+	layout.entries.resize(inputs.size());
+	for (auto& rect : rects)
+	{
+		AtlasEntry& entry = layout.entries[rect.id];
+		entry.name = inputs[rect.id].name;
+		entry.left = (rect.x + 1) * gutter;
+		entry.top = (rect.y + 1) * gutter;
+		entry.width = inputs[rect.id].image->GetWidth();
+		entry.height = inputs[rect.id].image->GetHeight();
+	}
+
+	//Copy each mip of each image to the matching mip of the atlas with its gutter around it. The gap left by rounding up to
+	//whole cells stays black
+	if (!atlas.Create(format, layout.width, layout.height, mipCount))
+	{
+		error = "Cannot create the atlas image";
+		return false;
+	}
+	for (uint32_t mip = 0; mip < mipCount; ++mip)
+	{
+		int mipGutter = static_cast<int>(gutter >> mip);
+		for (size_t i = 0; i < inputs.size(); ++i)
+		{
+			const CImage& image = *inputs[i].image;
+			const ImageMip& source = image.GetMip(mip);
+			const AtlasEntry& entry = layout.entries[i];
+			for (int y = -mipGutter; y < static_cast<int>(source.height) + mipGutter; ++y)
+			{
+				const uint8_t* sourceRow = image.GetRow(mip, AddressEntry(y, source.height, inputs[i].wrap));
+				uint8_t* row = atlas.GetRow(mip, (entry.top >> mip) + y) + static_cast<size_t>(entry.left >> mip) * 4;
+				for (int x = -mipGutter; x < static_cast<int>(source.width) + mipGutter; ++x)
+				{
+					memcpy(row + x * 4, sourceRow + static_cast<size_t>(AddressEntry(x, source.width, inputs[i].wrap)) * 4, 4);
+				}
+			}
+		}
+	}
+	return true;
+}
+
+
+//Write a layout as text: "atlas <width> <height>" then "<name> <left> <top> <width> <height>" for each entry
+std::string FormatAtlasLayout(const AtlasLayout& layout)
+{
+	std::ostringstream text;
+	text << "atlas " << layout.width << " " << layout.height << "\n";
+	for (auto& entry : layout.entries)
+	{
+		text << entry.name << " " << entry.left << " " << entry.top << " " << entry.width << " " << entry.height << "\n";
+	}
+	return text.str();
+}
+
+//Read a layout written by FormatAtlasLayout, checking each entry lies within the atlas
+bool ParseAtlasLayout(const std::string& text, AtlasLayout& layout, std::string& error)
+{
+	std::istringstream stream(text);
+	std::string keyword;
+	layout = AtlasLayout();
+	if (!(stream >> keyword >> layout.width >> layout.height) || keyword != "atlas" || layout.width == 0 || layout.height == 0)
+	{
+		error = "Atlas layout does not start with the atlas size";
+		return false;
+	}
+
+	AtlasEntry entry;
+	while (stream >> entry.name)
+	{
+		if (!(stream >> entry.left >> entry.top >> entry.width >> entry.height) || entry.width == 0 || entry.height == 0 ||
+		    entry.left + entry.width > layout.width || entry.top + entry.height > layout.height)
+		{
+			error = "Atlas entry " + entry.name + " is incomplete or outside the atlas";
+			return false;
+		}
+		layout.entries.push_back(entry);
+	}
+	return true;
+}
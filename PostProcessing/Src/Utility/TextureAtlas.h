@@ -0,0 +1,62 @@
+//--------------------------------------------------------------------------------------
+// Packing several small textures into one atlas texture
+//--------------------------------------------------------------------------------------
+// Textures used together share one texture, each sampled from its rectangle of the atlas, so
+// drawing with each needs no change of binding.
+#pragma once
+#include "CImage.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//An image to place in an atlas. The image is RGBA8 or BGRA8, with as many mips as the atlas should have (usually a full chain)
+struct AtlasInput
+{
+	std::string   name;
+	const CImage* image = nullptr;
+	bool          wrap  = false; // The image repeats, so its gutter is filled from its opposite edges
+};
+
+//Where an entry was placed, in pixels of the atlas's top mip, not counting its gutter
+struct AtlasEntry
+{
+	std::string name;
+	uint32_t    left   = 0;
+	uint32_t    top    = 0;
+	uint32_t    width  = 0;
+	uint32_t    height = 0;
+};
+
+//Part of an atlas to sample from - uv runs 0->1 across the entry and becomes offset + uv * size.
+//The default covers a whole texture, so shaders sampling through a rect also work with a texture of their own
+struct AtlasRect
+{
+	float u = 0, v = 0;
+	float width = 1, height = 1;
+};
+
+struct AtlasLayout
+{
+	uint32_t width  = 0;
+	uint32_t height = 0;
+	std::vector<AtlasEntry> entries;
+
+	//Return the rect of the entry with the given name, or the whole atlas if there is none
+	AtlasRect GetRect(const std::string& name) const;
+
+	//Fraction of the atlas's area covered by the entries, without and with their gutters
+	double GetUtilization() const;
+	double GetUtilizationWithGutters(uint32_t gutter) const;
+};
+
+//Pack images into an atlas no larger than maxSize on either side, placed by stb_rect_pack (the copy vendored with ImGui) at the
+//atlas width that packs them into the least area. gutter is a power of two, the pixels kept around each entry in the top mip and
+//filled from its own edges, clamped or wrapped, as filtering reads past the edge. Every mip is built from the entries' own mips
+//and entries sit on a grid of the gutter size, so the gutter keeps neighbours apart until it is one pixel wide. The atlas has at
+//most log2(gutter) + 1 mips - fewer if an image has fewer or its size does not halve evenly that far. Returns false with an
+//error if the images do not fit
+bool BuildAtlas(const std::vector<AtlasInput>& inputs, uint32_t gutter, uint32_t maxSize, CImage& atlas, AtlasLayout& layout, std::string& error);
+
+//Write a layout as text, one line for the atlas size and one per entry, and read it back
+std::string FormatAtlasLayout(const AtlasLayout& layout);
+bool ParseAtlasLayout(const std::string& text, AtlasLayout& layout, std::string& error);
@@ -7,6 +7,7 @@
 #include "Math/CVector2.h"
 #include "Math/CVector3.h"
 #include "Math/CMatrix4x4.h"
+#include "project/PostProcessingConstants.h"
 
 #include <d3d11.h>
 #include <string>
@@ -99,53 +100,8 @@ extern ID3D11Buffer*     PerModelConstantBuffer; // This variable controls the G
 
 //**************************
 
-// Settings used by post-processes - must match the similar structure in the Common.hlsli shader file
-struct PostProcessingConstants
-{
-	CVector2 area2DTopLeft; // Top-left of post-process area on screen, provided as coordinate from 0.0->1.0 not as a pixel coordinate
-	CVector2 area2DSize;    // Size of post-process area on screen, provided as sizes from 0.0->1.0 (1 = full screen) not as a size in pixels
-	
-	float  area2DDepth;   // Depth buffer value for area (0.0 nearest to 1.0 furthest). Full screen post-processing uses 0.0f
-	float  PixelWidth;
-	float  PixelHeight;
-	float  Feedback;
-      // Pad things to collections of 4 floats (see notes in earlier labs to read about padding)
-
-	CVector4 polygon2DPoints[4]; // Four points of a polygon in 2D viewport space for polygon post-processing. Matrix transformations already done on C++ side
-
-	// Tint post-process settings
-	CVector3 tintColour1;
-	float    BlurWidth;
-
-	// Grey noise post-process settings
-    CVector2 noiseScale;
-	CVector2 noiseOffset;
-
-	// Blur post-process settings
-	float    BlurHeight;
-	CVector3 tintColour2;
-
-	// Distort post-process settings
-	float    distortLevel;
-	CVector3 LuminanceWeights;
-
-	// Saturation post-process settings
-	float SaturationLevel;
-	CVector3 paddingD;
-
-	// Underwater post-process settings
-	float    UnderwaterEffect;
-	CVector3 paddingE;
-	
-	// Vignette post-process settings	
-	float    vignetteStrength;
-	float	 vignetteSize;
-	float	 vignetteFalloff;
-	float    BlurOffset;
-
-	float    Epsilon;
-	CVector3 paddingG;
-};
+// Settings used by post-processes - the structure is in its own header, which does not need Direct3D, so the CPU
+// post-processor (see Utility/CPUPostProcess.h) can read the same settings
 extern PostProcessingConstants gPostProcessingConstants;      // This variable holds the CPU-side constant buffer described above
 extern ID3D11Buffer*           PostProcessingConstantBuffer; // This variable controls the GPU-side constant buffer related to the above structure
 
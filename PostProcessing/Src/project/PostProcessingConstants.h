@@ -0,0 +1,94 @@
+//--------------------------------------------------------------------------------------
+// Settings used by the post-processes
+//--------------------------------------------------------------------------------------
+// Kept apart from Common.h, which needs Direct3D, so the CPU post-processor and the tools can
+// share the structure sent to the GPU
+#ifndef _POST_PROCESSING_CONSTANTS_H_INCLUDED_
+#define _POST_PROCESSING_CONSTANTS_H_INCLUDED_
+
+#include "Math/CVector2.h"
+#include "Math/CVector3.h"
+#include "Math/CVector4.h"
+
+// Most taps the linear-sampling blur shaders can be given - must match the size of gBlurTaps in Common.hlsli
+const int MaxBlurTaps = 16;
+
+
+// Settings used by post-processes - must match the similar structure in the Common.hlsli shader file
+struct PostProcessingConstants
+{
+	CVector2 area2DTopLeft; // Top-left of post-process area on screen, provided as coordinate from 0.0->1.0 not as a pixel coordinate
+	CVector2 area2DSize;    // Size of post-process area on screen, provided as sizes from 0.0->1.0 (1 = full screen) not as a size in pixels
+	
+	float  area2DDepth;   // Depth buffer value for area (0.0 nearest to 1.0 furthest). Full screen post-processing uses 0.0f
+	float  PixelWidth;
+	float  PixelHeight;
+	float  Feedback;
+      // Pad things to collections of 4 floats (see notes in earlier labs to read about padding)
+
+	CVector4 polygon2DPoints[4]; // Four points of a polygon in 2D viewport space for polygon post-processing. Matrix transformations already done on C++ side
+
+	// Tint post-process settings
+	CVector3 tintColour1;
+	float    BlurWidth;
+
+	// Grey noise post-process settings
+    CVector2 noiseScale;
+	CVector2 noiseOffset;
+
+	// Blur post-process settings
+	float    BlurHeight;
+	CVector3 tintColour2;
+
+	// Distort post-process settings
+	float    distortLevel;
+	CVector3 LuminanceWeights;
+
+	// Saturation post-process settings
+	float SaturationLevel;
+	CVector3 paddingD;
+
+	// Underwater post-process settings
+	float    UnderwaterEffect;
+	CVector3 paddingE;
+	
+	// Vignette post-process settings	
+	float    vignetteStrength;
+	float	 vignetteSize;
+	float	 vignetteFalloff;
+	float    BlurOffset;
+
+	float    Epsilon;
+
+	// Box Gaussian blur settings, from ComputeBoxBlur (see Utility/GaussianBlur.h)
+	float    BoxBlurRadius;    // Whole pixels either side of the centre of each box
+	float    BoxBlurEndWeight; // Weight of the pixel just past each end of the box
+	float    blurTapCount;     // Taps of the linear-sampling blur in use, 1 -> MaxBlurTaps
+
+	// Linear-sampling blur taps, from ComputeBlurTaps (see Utility/BlurKernel.h) - pixels from the centre (x) and weight (y).
+	// The first is the centre and the others are fetched either side of it
+	CVector4 blurTaps[MaxBlurTaps];
+
+	// Polygon post-process masks - the part of the bound texture holding the cut-out mask and the noise map for the
+	// current draw, as offset (x, y) and size (z, w) in UVs. The whole texture unless the masks are in an atlas
+	CVector4 maskRect;
+	CVector4 lookupRect;
+	float    maskThreshold; // Masks are cut out above this - 0.1 for alpha maps, 0.5 for signed distance fields
+
+	// Colour grade settings, from SetColourLUTConstants (see Utility/ColourLUT.h)
+	float    colourGradeOperators; // Bits of the ColourOperators run on each pixel rather than looked up
+	float    colourLUTSize;        // Entries along each axis of the table, 0 to run the whole chain on each pixel
+	float    colourLUTRange;       // Each channel from 0 to this spans the entries
+
+	// Palette settings, from SetPaletteConstants (see Utility/Palette.h)
+	float    paletteLUTSize; // Entries along each axis of the table of nearest colours
+	float    ditherMode;     // 0 none, 1 Bayer, 2 interleaved gradient noise, 3 blue noise - error diffusion is on the CPU only
+	float    ditherSpread;   // Ordered dithers move colours by up to half this either way
+	float    paddingF;
+};
+
+// Constant buffers are made of whole 16 byte registers
+static_assert(sizeof(PostProcessingConstants) % 16 == 0, "PostProcessingConstants must be a multiple of 16 bytes");
+
+
+#endif //_POST_PROCESSING_CONSTANTS_H_INCLUDED_
@@ -0,0 +1,192 @@
+//--------------------------------------------------------------------------------------
+// Packing the polygon post-process masks into one atlas texture
+//--------------------------------------------------------------------------------------
+// "atlas" packs the three polygon cut-out alpha maps and the noise map into Media/PolygonAtlas.dds,
+// with the position of each in Media/PolygonAtlas.txt. When both files are present the scene binds
+// the atlas once for every polygon draw and passes each draw the rect of its mask as a constant,
+// instead of binding a separate texture per draw.
+// The masks are first turned into small signed distance fields (see DistanceField.h) unless
+// --sdf is 0, and their entries are then named <name>SDF so the scene knows to cut them out at
+// 0.5. Every entry is only sampled for its red channel, so the atlas is compressed to BC4 like
+// the separate masks are by compress-media. The distortion map keeps its own texture: it needs two
+// channels, and moving the masks to BC5 to make room for it would double their size.
+// The report gives the position of each entry, how much of the atlas the entries fill, and the
+// memory taken by the atlas against the separate textures, both as RGBA8 decoded from the PNG
+// files and as BC4 DDS files.
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Utility/BCCompression.h"
+#include "Utility/CThreadPool.h"
+#include "Utility/DistanceField.h"
+#include "Utility/ImageDecoders.h"
+#include "Utility/ImageEncoders.h"
+#include "Utility/MipGeneration.h"
+#include "Utility/TextureAtlas.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+	const double MB = 1.0 / (1024.0 * 1024.0);
+
+	//Textures in the atlas - the cut-out masks are clamped at their edges, the noise repeats across the screen
+	struct AtlasTexture
+	{
+		const char* name;
+		bool        wrap;
+		bool        mask; // Replaced by its distance field unless --sdf is 0
+	};
+	const AtlasTexture AtlasTextures[] =
+	{
+		{ "SpadeAlphaMap",  false, true  },
+		{ "HeartAlphaMap",  false, true  },
+		{ "CloverAlphaMap", false, true  },
+		{ "Noise",          true,  false },
+	};
+
+	//Return the bytes taken by an image of the given size and mip count, with the given bytes per pixel or per 4x4 block
+	uint64_t MipChainBytes(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t bytes, bool blocks)
+	{
+		uint64_t total = 0;
+		for (uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			uint64_t w = std::max(width >> mip, 1u), h = std::max(height >> mip, 1u);
+			total += blocks ? ((w + 3) / 4) * ((h + 3) / 4) * bytes : w * h * bytes;
+		}
+		return total;
+	}
+
+	//Copy every mip of an R8 image to the red, green and blue of an RGBA8 image
+	void ExpandToRGBA(const CImage& source, CImage& destination)
+	{
+		destination.Create(ImageFormat::RGBA8, source.GetWidth(), source.GetHeight(), source.GetMipCount());
+		for (uint32_t mip = 0; mip < source.GetMipCount(); ++mip)
+		{
+			const ImageMip& layout = source.GetMip(mip);
+			for (uint32_t y = 0; y < layout.height; ++y)
+			{
+				const uint8_t* in = source.GetRow(mip, y);
+				uint8_t* out = destination.GetRow(mip, y);
+				for (uint32_t x = 0; x < layout.width; ++x, out += 4)
+				{
+					out[0] = out[1] = out[2] = in[x];
+					out[3] = 255;
+				}
+			}
+		}
+	}
+
+	bool WriteFile(const std::filesystem::path& path, const void* data, size_t size)
+	{
+		std::ofstream out(path, std::ios::binary);
+		out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		return static_cast<bool>(out);
+	}
+}
+
+int RunAtlasBuilder(const CommandArgs& args)
+{
+	namespace fs = std::filesystem;
+	const fs::path  media       = fs::path(GetOption(args, "--dir", std::string("PostProcessing"))) / "Media";
+	const long long gutter      = GetOption(args, "--gutter", 8LL);
+	const long long maxSize     = GetOption(args, "--max-size", 4096LL);
+	const long long sdfSize     = GetOption(args, "--sdf", 128LL);
+	const long long threadCount = GetOption(args, "--threads", static_cast<long long>(CThreadPool::DefaultThreadCount(0)));
+	const BCQuality quality     = HasFlag(args, "--fast") ? BCQuality::Fast : BCQuality::High;
+
+	if (gutter < 1 || gutter > 256 || (gutter & (gutter - 1)) != 0 || maxSize < gutter || maxSize > 16384 || threadCount < 1 || threadCount > 256 ||
+	    sdfSize < 0 || sdfSize > 4096)
+	{
+		printf("--gutter must be a power of two up to 256, --max-size at least the gutter and up to 16384, --threads between 1 and 256, --sdf up to 4096\n");
+		return 1;
+	}
+	CThreadPool threads(static_cast<unsigned int>(threadCount));
+
+	//Decode each texture and make its mips as the loader would
+	std::vector<CImage> images(std::size(AtlasTextures));
+	std::vector<AtlasInput> inputs;
+	uint64_t separateRGBA = 0, separateBC4 = 0;
+	for (size_t i = 0; i < std::size(AtlasTextures); ++i)
+	{
+		std::string fileName = std::string(AtlasTextures[i].name) + ".png";
+		std::ifstream stream(media / fileName, std::ios::binary);
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+		CImage decoded;
+		std::string error;
+		if (!DecodeImage(data.data(), data.size(), decoded, error, &threads) || !GenerateMips(decoded, images[i], ChooseMipOptions(fileName), &threads))
+		{
+			printf("%s: %s\n", (media / fileName).string().c_str(), error.empty() ? "Unsupported pixel format" : error.c_str());
+			return 1;
+		}
+
+		separateRGBA += images[i].GetSize();
+		separateBC4 += MipChainBytes(images[i].GetWidth(), images[i].GetHeight(), images[i].GetMipCount(), 8, true);
+
+		//Replace a mask with its distance field
+		std::string entryName = AtlasTextures[i].name;
+		if (sdfSize > 0 && AtlasTextures[i].mask)
+		{
+			DistanceFieldOptions options;
+			options.width = options.height = static_cast<uint32_t>(sdfSize);
+			CImage field;
+			if (!GenerateSignedDistanceField(decoded, field, options, &threads))
+			{
+				printf("%s: cannot make a distance field\n", (media / fileName).string().c_str());
+				return 1;
+			}
+			ExpandToRGBA(field, images[i]);
+			entryName += "SDF";
+		}
+		inputs.push_back({ entryName, &images[i], AtlasTextures[i].wrap });
+	}
+
+	CImage atlas, compressed;
+	AtlasLayout layout;
+	std::string error;
+	double seconds = MeasureSeconds([&]()
+	{
+		if (!BuildAtlas(inputs, static_cast<uint32_t>(gutter), static_cast<uint32_t>(maxSize), atlas, layout, error)) atlas.Clear();
+	});
+	if (atlas.IsEmpty())
+	{
+		printf("%s\n", error.c_str());
+		return 1;
+	}
+
+	std::vector<uint8_t> file;
+	std::string text = FormatAtlasLayout(layout);
+	if (!CompressBC(atlas, ImageFormat::BC4, compressed, &threads, quality) || !EncodeDDS(compressed, file, error))
+	{
+		printf("Cannot compress the atlas: %s\n", error.empty() ? "unsupported format" : error.c_str());
+		return 1;
+	}
+	if (!WriteFile(media / "PolygonAtlas.dds", file.data(), file.size()) || !WriteFile(media / "PolygonAtlas.txt", text.data(), text.size()))
+	{
+		printf("Cannot write the atlas to %s\n", media.string().c_str());
+		return 1;
+	}
+
+	printf("%-18s %6s %6s %11s   %s\n", "Entry", "Left", "Top", "Size", "UV rect");
+	for (auto& entry : layout.entries)
+	{
+		AtlasRect rect = layout.GetRect(entry.name);
+		char size[32];
+		snprintf(size, sizeof(size), "%ux%u", entry.width, entry.height);
+		printf("%-18s %6u %6u %11s   %.4f %.4f %.4f %.4f\n", entry.name.c_str(), entry.left, entry.top, size, rect.u, rect.v, rect.width, rect.height);
+	}
+
+	uint64_t atlasRGBA = atlas.GetSize();
+	printf("\nAtlas %ux%u with %u mips (gutter %lld), packed in %.2f ms\n", layout.width, layout.height, atlas.GetMipCount(), gutter, seconds * 1000.0);
+	printf("  utilization   %.1f%% by the entries, %.1f%% with their gutters\n", layout.GetUtilization() * 100.0,
+		layout.GetUtilizationWithGutters(static_cast<uint32_t>(gutter)) * 100.0);
+	printf("  RGBA8         %.2f MB as separate textures, %.2f MB as the atlas\n", separateRGBA * MB, atlasRGBA * MB);
+	printf("  BC4           %.2f MB as separate textures, %.2f MB as the atlas\n", separateBC4 * MB, compressed.GetSize() * MB);
+	printf("Wrote %s and PolygonAtlas.txt\n", (media / "PolygonAtlas.dds").string().c_str());
+	return 0;
+}
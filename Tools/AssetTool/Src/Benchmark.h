@@ -0,0 +1,47 @@
+//--------------------------------------------------------------------------------------
+// Small helpers shared by the benchmarking commands
+//--------------------------------------------------------------------------------------
+#pragma once
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+//Time a function, returning the number of seconds it took
+template<typename Function>
+double MeasureSeconds(Function function)
+{
+	auto start = std::chrono::steady_clock::now();
+	function();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+//Return the value following the given option in the argument list (e.g. "--frames 1000"), or the fallback if absent
+template<typename Args>
+std::string GetOption(const Args& args, const std::string& option, const std::string& fallback)
+{
+	for (size_t i = 0; i + 1 < args.size(); ++i)
+	{
+		if (args[i] == option) return args[i + 1];
+	}
+	return fallback;
+}
+
+//As above, converting the value to an integer
+template<typename Args>
+long long GetOption(const Args& args, const std::string& option, long long fallback)
+{
+	std::string value = GetOption(args, option, std::string());
+	return value.empty() ? fallback : std::atoll(value.c_str());
+}
+
+//Return true if the given flag appears in the argument list
+template<typename Args>
+bool HasFlag(const Args& args, const std::string& flag)
+{
+	for (auto& arg : args)
+	{
+		if (arg == flag) return true;
+	}
+	return false;
+}
@@ -0,0 +1,185 @@
+//--------------------------------------------------------------------------------------
+// Making, checking and timing tiles of blue noise
+//--------------------------------------------------------------------------------------
+// "blue-noise" makes tiles of blue noise (see Utility/BlueNoise.h) of each size from the
+// smallest up to --max, with one channel and with --channels. For each it:
+// - checks making it across the pool gives the same tile as on one thread, and that every byte
+//   value is used equally often, so the grain is as likely to be any brightness
+// - reports the time taken on one thread and across the pool. Channels are ranked on the pool's
+//   workers at once, so a one channel tile takes as long either way
+// - reports how much low frequency the tile has: the variance left after a 3x3 box blur that
+//   wraps around the tile, over the variance before it, as a share of what white noise keeps
+//   (1/9). White noise scores 1 and blue noise far less. Media/Noise.png is scored the same way
+// With --out the tiles are written to that folder, named as the scene looks for them in Media, and
+// read back to check they match. The scene's Media/BlueNoise64.dds is made this way.
+// Any check failing fails the command.
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Utility/BlueNoise.h"
+#include "Utility/CThreadPool.h"
+#include "Utility/ImageDecoders.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	//Fastest of several runs of a function
+	template<typename Function>
+	double BestSeconds(long long repeats, Function function)
+	{
+		double best = 1e30;
+		for (long long r = 0; r < repeats; ++r) best = std::min(best, MeasureSeconds(function));
+		return best;
+	}
+
+	bool SameImage(const CImage& a, const CImage& b)
+	{
+		return a.GetFormat() == b.GetFormat() && a.GetSize() == b.GetSize() && std::memcmp(a.GetData(), b.GetData(), a.GetSize()) == 0;
+	}
+
+	//Whether each channel of an 8 bit tile uses every byte value equally often
+	bool IsEvenlySpread(const CImage& tile)
+	{
+		const uint32_t channels = GetFormatBytes(tile.GetFormat());
+		const size_t texels = static_cast<size_t>(tile.GetWidth()) * tile.GetHeight();
+		for (uint32_t channel = 0; channel < channels; ++channel)
+		{
+			size_t counts[256] = {};
+			for (size_t t = 0; t < texels; ++t) ++counts[tile.GetData()[t * channels + channel]];
+			for (size_t count : counts)
+			{
+				if (count != texels / 256) return false;
+			}
+		}
+		return true;
+	}
+
+	//Variance of a channel after a 3x3 box blur that wraps, over its variance before, times 9 so white noise scores 1
+	double LowFrequencyScore(const CImage& tile, uint32_t channel)
+	{
+		const uint32_t channels = GetFormatBytes(tile.GetFormat());
+		const uint32_t width = tile.GetWidth(), height = tile.GetHeight();
+		auto value = [&](uint32_t x, uint32_t y) { return static_cast<double>(tile.GetRow(0, y)[x * channels + channel]); };
+
+		double mean = 0.0;
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x) mean += value(x, y);
+		}
+		mean /= static_cast<double>(width) * height;
+
+		double variance = 0.0, blurredVariance = 0.0;
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				double blurred = 0.0;
+				for (uint32_t dy = 0; dy < 3; ++dy)
+				{
+					for (uint32_t dx = 0; dx < 3; ++dx) blurred += value((x + width + dx - 1) % width, (y + height + dy - 1) % height);
+				}
+				blurred = blurred / 9.0 - mean;
+				double difference = value(x, y) - mean;
+				variance += difference * difference;
+				blurredVariance += blurred * blurred;
+			}
+		}
+		return variance > 0.0 ? 9.0 * blurredVariance / variance : 0.0;
+	}
+
+	//Worst low frequency score of a tile's channels
+	double WorstScore(const CImage& tile)
+	{
+		double worst = 0.0;
+		for (uint32_t channel = 0; channel < GetFormatBytes(tile.GetFormat()); ++channel)
+		{
+			worst = std::max(worst, LowFrequencyScore(tile, channel));
+		}
+		return worst;
+	}
+}
+
+int RunBlueNoiseBenchmark(const CommandArgs& args)
+{
+	const fs::path    media       = fs::path(GetOption(args, "--dir", std::string("PostProcessing"))) / "Media";
+	const std::string out         = GetOption(args, "--out", std::string());
+	const long long   repeats     = std::max(1LL, GetOption(args, "--repeat", 1LL));
+	const long long   maxSize     = GetOption(args, "--max", 128LL);
+	const long long   channels    = GetOption(args, "--channels", 4LL);
+	const long long   threadCount = GetOption(args, "--threads", static_cast<long long>(CThreadPool::DefaultThreadCount(0)));
+
+	if (threadCount < 1 || threadCount > 256 || maxSize < MinBlueNoiseSize || maxSize > MaxBlueNoiseSize || (channels != 2 && channels != 4))
+	{
+		printf("--threads must be between 1 and 256, --max between %u and %u and --channels 2 or 4\n", MinBlueNoiseSize, MaxBlueNoiseSize);
+		return 1;
+	}
+	if (!out.empty())
+	{
+		std::error_code error;
+		fs::create_directories(out, error);
+	}
+	CThreadPool threads(static_cast<unsigned int>(threadCount));
+
+	printf("Blue noise tiles, best of %lld runs on %lld threads\n\n", repeats, threadCount);
+	printf("%-20s %12s %12s %10s\n", "Tile", "1 thread ms", "Pool ms", "Low freq");
+	for (uint32_t size = MinBlueNoiseSize; size <= maxSize; size *= 2)
+	{
+		for (uint32_t tileChannels : { 1u, static_cast<uint32_t>(channels) })
+		{
+			std::string name = GetBlueNoiseFileName(size, tileChannels);
+			CImage plain, pooled;
+			if (!GenerateBlueNoise(size, tileChannels, plain) || !GenerateBlueNoise(size, tileChannels, pooled, &threads) ||
+			    !SameImage(plain, pooled))
+			{
+				printf("FAILED: making %s across the pool differs from one thread\n", name.c_str());
+				return 1;
+			}
+			if (!IsEvenlySpread(pooled))
+			{
+				printf("FAILED: %s does not use every value equally often\n", name.c_str());
+				return 1;
+			}
+
+			CImage tile;
+			double plainSeconds = BestSeconds(repeats, [&]() { GenerateBlueNoise(size, tileChannels, tile); });
+			double pooledSeconds = BestSeconds(repeats, [&]() { GenerateBlueNoise(size, tileChannels, tile, &threads); });
+			printf("%-20s %12.2f %12.2f %10.3f\n", name.c_str(), plainSeconds * 1e3, pooledSeconds * 1e3, WorstScore(pooled));
+
+			//Cache the tile and read it back as the scene would
+			if (!out.empty())
+			{
+				std::string path = (fs::path(out) / name).string();
+				CImage cached;
+				bool generated = false;
+				if (!LoadOrGenerateBlueNoise(path, size, tileChannels, cached, &threads, &generated) ||
+				    !LoadOrGenerateBlueNoise(path, size, tileChannels, cached, &threads, &generated) || generated || !SameImage(cached, pooled))
+				{
+					printf("FAILED: %s does not read back as it was made\n", path.c_str());
+					return 1;
+				}
+			}
+		}
+	}
+
+	//The white noise tile the grain used before, for comparison
+	std::ifstream stream(media / "Noise.png", std::ios::binary);
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+	CImage noise;
+	std::string error;
+	if (DecodeImage(data.data(), data.size(), noise, error) && GetFormatBytes(noise.GetFormat()) <= 4 && !IsBlockCompressed(noise.GetFormat()))
+	{
+		char tileName[32];
+		snprintf(tileName, sizeof(tileName), "Noise.png %ux%u", noise.GetWidth(), noise.GetHeight());
+		printf("%-20s %12s %12s %10.3f\n", tileName, "-", "-", LowFrequencyScore(noise, 0));
+	}
+	printf("\nLow freq is the variance left after a 3x3 blur as a share of what white noise keeps - 1 for white noise, lower is bluer\n");
+	return 0;
+}
@@ -0,0 +1,108 @@
+//--------------------------------------------------------------------------------------
+// Checking and timing the constant time Gaussian blur
+//--------------------------------------------------------------------------------------
+// "blur-bench" blurs an image the size of the app's viewport (1268x960 by default) holding random
+// noise and hard-edged squares, the worst case for a blur's accuracy, at standard deviations from
+// half a pixel to 64 pixels. For each it:
+// - checks the box blur gives identical results in plain C++, with SSE and with SSE across a
+//   thread pool, failing the command on any difference
+// - measures its error against convolving with the Gaussian itself, as the largest and the RMS
+//   difference over every channel of every pixel
+// - times the box blur the three ways and the reference convolution, whose time grows with sigma
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Utility/CThreadPool.h"
+#include "Utility/GaussianBlur.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+namespace
+{
+	//Fastest of several runs of a function
+	template<typename Function>
+	double BestSeconds(long long repeats, Function function)
+	{
+		double best = 1e30;
+		for (long long r = 0; r < repeats; ++r) best = std::min(best, MeasureSeconds(function));
+		return best;
+	}
+}
+
+int RunBlurBenchmark(const CommandArgs& args)
+{
+	const long long width       = GetOption(args, "--width", 1268LL);
+	const long long height      = GetOption(args, "--height", 960LL);
+	const long long repeats     = std::max(1LL, GetOption(args, "--repeat", 3LL));
+	const long long threadCount = GetOption(args, "--threads", static_cast<long long>(CThreadPool::DefaultThreadCount(0)));
+
+	if (threadCount < 1 || threadCount > 256 || width < 1 || width > 16384 || height < 1 || height > 16384)
+	{
+		printf("--threads must be between 1 and 256, --width and --height between 1 and 16384\n");
+		return 1;
+	}
+	CThreadPool threads(static_cast<unsigned int>(threadCount));
+
+	//Noise in 0->1, with a 32 pixel square of 4s every 64 pixels
+	CImage image;
+	image.Create(ImageFormat::RGBA32F, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> value(0.0f, 1.0f);
+	float* pixels = reinterpret_cast<float*>(image.GetData());
+	for (long long y = 0; y < height; ++y)
+	{
+		for (long long x = 0; x < width; ++x)
+		{
+			bool square = (x / 32) % 2 == 0 && (y / 32) % 2 == 0;
+			for (int c = 0; c < 4; ++c) pixels[(y * width + x) * 4 + c] = square ? 4.0f : value(random);
+		}
+	}
+	const size_t floats = image.GetSize() / sizeof(float);
+	const double pixelCount = static_cast<double>(width) * height;
+
+	printf("Gaussian blur of a %lldx%lld image, best of %lld runs\n\n", width, height, repeats);
+	printf("%6s %6s %7s %10s %10s %9s %9s %9s %12s %12s\n", "Sigma", "Radius", "End", "Max error", "RMS error",
+		"C++ ms", "SSE ms", "SSE N ms", "MPixel/s (N)", "Convolve ms");
+	const float sigmas[] = { 0.5f, 1.0f, 2.0f, 4.0f, 8.0f, 16.0f, 32.0f, 64.0f };
+	for (float sigma : sigmas)
+	{
+		CImage plain, simd, pooled, reference;
+		GaussianBlur(image, plain, sigma, nullptr, false);
+		GaussianBlur(image, simd, sigma, nullptr, true);
+		GaussianBlur(image, pooled, sigma, &threads, true);
+		for (const CImage* result : { &simd, &pooled })
+		{
+			if (std::memcmp(plain.GetData(), result->GetData(), plain.GetSize()) != 0)
+			{
+				printf("FAILED: the blur of sigma %g %s differs from plain C++\n", sigma, result == &simd ? "with SSE" : "with threads");
+				return 1;
+			}
+		}
+
+		double referenceSeconds = MeasureSeconds([&]() { GaussianBlurReference(image, reference, sigma, &threads); });
+		const float* expected = reinterpret_cast<const float*>(reference.GetData());
+		const float* actual = reinterpret_cast<const float*>(plain.GetData());
+		double maxError = 0.0, squaredError = 0.0;
+		for (size_t i = 0; i < floats; ++i)
+		{
+			double error = std::abs(static_cast<double>(actual[i]) - expected[i]);
+			maxError = std::max(maxError, error);
+			squaredError += error * error;
+		}
+
+		CImage target;
+		double plainSeconds = BestSeconds(repeats, [&]() { GaussianBlur(image, target, sigma, nullptr, false); });
+		double simdSeconds = BestSeconds(repeats, [&]() { GaussianBlur(image, target, sigma, nullptr, true); });
+		double pooledSeconds = BestSeconds(repeats, [&]() { GaussianBlur(image, target, sigma, &threads, true); });
+		BoxBlurParameters box = ComputeBoxBlur(sigma);
+		printf("%6.1f %6d %7.4f %10.5f %10.6f %9.2f %9.2f %9.2f %12.1f %12.1f\n", sigma, box.radius, box.endWeight, maxError,
+			std::sqrt(squaredError / floats), plainSeconds * 1000.0, simdSeconds * 1000.0, pooledSeconds * 1000.0,
+			pixelCount / pooledSeconds * 1e-6, referenceSeconds * 1000.0);
+	}
+	printf("\nN = %lld threads. Values are 0->1 noise and squares of 4, so errors are of that range\n", threadCount);
+	return 0;
+}
@@ -0,0 +1,187 @@
+//--------------------------------------------------------------------------------------
+// Checking the linear-sampling blur kernels
+//--------------------------------------------------------------------------------------
+// "blur-kernel" makes the taps of the blur shaders (see Utility/BlurKernel.h) for standard
+// deviations from half a pixel to 16 pixels within a tap budget, and for each:
+// - checks there are no more taps than allowed, each lies between the two pixels it merges and
+//   the kernel's weights add up to 1
+// - blurs an image of noise and hard-edged squares with the CPU copies of HorizontalBlur_ps and
+//   VerticalBlur_ps, which read the taps with bilinear filtering, and checks the result matches
+//   convolving with every pixel of the discrete kernel, clamped at the edges, in double precision.
+//   Either check failing fails the command
+// - reports the fetches each pass takes against convolving directly, the Gaussian's weight cut off
+//   past the kernel's radius and the error against the untruncated Gaussian (GaussianBlurReference)
+// With --out the taps for --sigma are written as a .hlsli of constants.
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Utility/BlurKernel.h"
+#include "Utility/CPUPostProcess.h"
+#include "Utility/GaussianBlur.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+namespace
+{
+	//Largest difference the bilinear taps may have from direct convolution, for values up to 4 and float sums
+	const double Tolerance = 1e-4;
+
+	//Convolve an image with a kernel given as weights 0 -> radius from the centre, across then down, clamped at the edges
+	std::vector<double> Convolve(const CImage& image, const std::vector<double>& weights)
+	{
+		const int width = static_cast<int>(image.GetWidth()), height = static_cast<int>(image.GetHeight());
+		const int radius = static_cast<int>(weights.size()) - 1;
+		const float* input = reinterpret_cast<const float*>(image.GetData());
+		std::vector<double> across(static_cast<size_t>(width) * height * 4), down(across.size());
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				for (int i = -radius; i <= radius; ++i)
+				{
+					const float* pixel = input + (static_cast<size_t>(y) * width + std::clamp(x + i, 0, width - 1)) * 4;
+					for (int c = 0; c < 4; ++c) across[(static_cast<size_t>(y) * width + x) * 4 + c] += weights[std::abs(i)] * pixel[c];
+				}
+			}
+		}
+		for (int y = 0; y < height; ++y)
+		{
+			for (int i = -radius; i <= radius; ++i)
+			{
+				const double* row = across.data() + static_cast<size_t>(std::clamp(y + i, 0, height - 1)) * width * 4;
+				double* out = down.data() + static_cast<size_t>(y) * width * 4;
+				for (size_t f = 0; f < static_cast<size_t>(width) * 4; ++f) out[f] += weights[std::abs(i)] * row[f];
+			}
+		}
+		return down;
+	}
+
+	//Largest and RMS difference between the red, green and blue of an image and some expected values, as the blurs set alpha to 1
+	template<typename Value>
+	void MeasureError(const CImage& image, const Value* expected, double& maxError, double& rmsError)
+	{
+		const float* actual = reinterpret_cast<const float*>(image.GetData());
+		const size_t floats = image.GetSize() / sizeof(float);
+		double squaredError = 0.0;
+		maxError = 0.0;
+		for (size_t i = 0; i < floats; ++i)
+		{
+			if (i % 4 == 3) continue;
+			double error = std::abs(actual[i] - static_cast<double>(expected[i]));
+			maxError = std::max(maxError, error);
+			squaredError += error * error;
+		}
+		rmsError = std::sqrt(squaredError / (floats / 4 * 3));
+	}
+}
+
+int RunBlurKernelCheck(const CommandArgs& args)
+{
+	const long long width  = GetOption(args, "--width", 320LL);
+	const long long height = GetOption(args, "--height", 240LL);
+	const long long budget = GetOption(args, "--taps", static_cast<long long>(MaxBlurTaps));
+	const float     sigma  = static_cast<float>(std::atof(GetOption(args, "--sigma", std::string("8")).c_str()));
+	const std::string output = GetOption(args, "--out", std::string());
+
+	if (budget < 1 || budget > MaxBlurTaps || width < 1 || width > 4096 || height < 1 || height > 4096 || !(sigma >= 0.0f))
+	{
+		printf("--taps must be between 1 and %d, --width and --height between 1 and 4096 and --sigma not negative\n", MaxBlurTaps);
+		return 1;
+	}
+
+	if (!output.empty())
+	{
+		std::ofstream out(output, std::ios::binary);
+		out << FormatBlurTapsHLSL(ComputeBlurTaps(sigma, static_cast<int>(budget)), sigma);
+		if (!out)
+		{
+			printf("Cannot write %s\n", output.c_str());
+			return 1;
+		}
+		printf("Wrote the taps for sigma %g to %s\n\n", sigma, output.c_str());
+	}
+
+	//Noise in 0->1, with a 16 pixel square of 4s every 32 pixels
+	CImage image;
+	image.Create(ImageFormat::RGBA32F, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> value(0.0f, 1.0f);
+	float* pixels = reinterpret_cast<float*>(image.GetData());
+	for (long long y = 0; y < height; ++y)
+	{
+		for (long long x = 0; x < width; ++x)
+		{
+			bool square = (x / 16) % 2 == 0 && (y / 16) % 2 == 0;
+			for (int c = 0; c < 4; ++c) pixels[(y * width + x) * 4 + c] = square ? 4.0f : value(random);
+		}
+	}
+
+	PostProcessingConstants constants = {};
+	constants.area2DTopLeft = { 0, 0 };
+	constants.area2DSize = { 1, 1 };
+	CPUPostProcessTextures textures;
+
+	printf("Linear-sampling blur of a %lldx%lld image with at most %lld taps\n\n", width, height, budget);
+	printf("%6s %6s %5s %14s %12s %11s %11s %14s\n", "Sigma", "Radius", "Taps", "Fetches/pass", "Tail weight", "Max diff", "Max error",
+		"RMS error");
+	const float sigmas[] = { 0.5f, 1.0f, 1.5f, 2.0f, 3.0f, 4.0f, 6.0f, 8.0f, 10.0f, 12.0f, 16.0f };
+	for (float s : sigmas)
+	{
+		const int radius = GetBlurKernelRadius(s, static_cast<int>(budget));
+		const std::vector<double> weights = ComputeGaussianWeights(s, radius);
+		const std::vector<BlurTap> taps = ComputeBlurTaps(s, static_cast<int>(budget));
+
+		//The taps themselves
+		double total = taps[0].weight;
+		bool ordered = taps.size() <= static_cast<size_t>(budget) && taps[0].offset == 0.0f;
+		for (size_t i = 1; i < taps.size(); ++i)
+		{
+			total += 2.0 * taps[i].weight;
+			ordered = ordered && taps[i].offset >= 2.0f * i - 1.0f && taps[i].offset <= 2.0f * i;
+		}
+		if (!ordered || std::abs(total - 1.0) > 1e-6)
+		{
+			printf("FAILED: the %zu taps for sigma %g are out of place or their weights add up to %.9g\n", taps.size(), s, total);
+			return 1;
+		}
+
+		//Both blur passes with bilinear fetches, against direct convolution with the same kernel
+		SetBlurTapConstants(constants, taps);
+		CImage across = image, blurred = image;
+		textures.scene = &image;
+		RunCPUPostProcess(CPUPostProcess::HorizontalBlur, constants, textures, across);
+		textures.scene = &across;
+		RunCPUPostProcess(CPUPostProcess::VerticalBlur, constants, textures, blurred);
+
+		const std::vector<double> expected = Convolve(image, weights);
+		double maxDifference, rmsDifference;
+		MeasureError(blurred, expected.data(), maxDifference, rmsDifference);
+		if (maxDifference > Tolerance)
+		{
+			printf("FAILED: the taps for sigma %g differ from convolving with the kernel by up to %g\n", s, maxDifference);
+			return 1;
+		}
+
+		//The weight of the sampled Gaussian past the radius, before the kernel is scaled back up to 1
+		double inside = 0.0, everywhere = 0.0;
+		for (int i = 0; i <= static_cast<int>(std::ceil(12.0f * s)); ++i)
+		{
+			double weight = std::exp(-0.5 * i * i / (static_cast<double>(s) * s)) * (i ? 2.0 : 1.0);
+			everywhere += weight;
+			if (i <= radius) inside += weight;
+		}
+
+		CImage reference;
+		GaussianBlurReference(image, reference, s);
+		double maxError, rmsError;
+		MeasureError(blurred, reinterpret_cast<const float*>(reference.GetData()), maxError, rmsError);
+		printf("%6.1f %6d %5zu %6zu (of %3d) %12.2e %11.2e %11.5f %14.6f\n", s, radius, taps.size(), taps.size() * 2 - 1, radius * 2 + 1,
+			1.0 - inside / everywhere, maxDifference, maxError, rmsError);
+	}
+	printf("\nMax diff is against convolving with the kernel, the errors against the Gaussian to 4 sigma. Values are 0->1 noise and squares of 4\n");
+	return 0;
+}
@@ -0,0 +1,190 @@
+//--------------------------------------------------------------------------------------
+// Simulation of the resource memory budget against a mock allocator
+//--------------------------------------------------------------------------------------
+// Drives CResourceBudget through a series of frames without a device. A pool of resources of
+// varying sizes is loaded, some are kept referenced, and each frame uses a window of resources
+// that slides across the pool, so older resources fall out of use and must be evicted to make
+// room. The mock allocator completes reloads one frame after they are requested, as the
+// background loader would. Alongside them, short lived memory is tracked and untracked each
+// frame as the lazily created render targets are, which must reuse the removed entries rather
+// than growing the budget's list. The policy's invariants are checked every frame.
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Utility/CResourceBudget.h"
+
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace
+{
+	//Stands in for CResourceManager - records what the budget asks of it
+	class MockAllocator : public IResourceAllocator
+	{
+	public:
+		std::vector<bool>     loaded;
+		std::vector<uint32_t> pendingReloads;
+		uint32_t              evictCalls = 0;
+		bool                  error = false;
+
+		void Evict(uint32_t key) override
+		{
+			if (!loaded[key])
+			{
+				printf("Evicted resource %u which was not loaded\n", key);
+				error = true;
+			}
+			loaded[key] = false;
+			++evictCalls;
+		}
+
+		void Reload(uint32_t key) override
+		{
+			pendingReloads.push_back(key);
+		}
+	};
+
+	const float MB = 1.0f / (1024.0f * 1024.0f);
+
+	//Key of the short lived memory, which is always referenced so never passed to the allocator
+	const uint32_t TrackedKey = 0xffffffff;
+	const int      TrackedPerFrame = 3;
+	const int      TrackedLifetime = 2; // Frames each lasts before it is untracked
+	const int      WarmUpFrames = TrackedLifetime + 1;
+}
+
+int RunBudgetSimulation(const CommandArgs& args)
+{
+	const int      resourceCount = static_cast<int>(GetOption(args, "--resources", 64LL));
+	const int      frames        = static_cast<int>(GetOption(args, "--frames", 1000LL));
+	const int      window        = static_cast<int>(GetOption(args, "--window", 12LL));
+	const uint64_t budgetBytes   = static_cast<uint64_t>(GetOption(args, "--budget-mb", 64LL)) * 1024 * 1024;
+
+	MockAllocator allocator;
+	CResourceBudget budget(&allocator, budgetBytes);
+
+	//Resources of 0.25-4MB split between texture and mesh memory. Every eighth one is held by a reference
+	std::mt19937 random(1234);
+	std::uniform_int_distribution<uint64_t> sizeDistribution(256 * 1024, 4 * 1024 * 1024);
+	std::vector<ResourceBytes> sizes(resourceCount);
+	std::vector<CResourceBudget::EntryId> entries(resourceCount);
+	allocator.loaded.assign(resourceCount, false);
+
+	for (int i = 0; i < resourceCount; ++i)
+	{
+		if (i % 3 == 0)
+		{
+			sizes[i][ResourceMemoryType::VertexBuffer] = sizeDistribution(random);
+			sizes[i][ResourceMemoryType::IndexBuffer] = sizes[i][ResourceMemoryType::VertexBuffer] / 4;
+		}
+		else
+		{
+			sizes[i][ResourceMemoryType::Texture] = sizeDistribution(random);
+		}
+
+		entries[i] = budget.Add(static_cast<uint32_t>(i));
+		if (i % 8 == 0) budget.AddRef(entries[i]);
+	}
+
+	uint64_t referencedBytes = 0;
+	for (int i = 0; i < resourceCount; i += 8) referencedBytes += sizes[i].Total();
+
+	//Short lived render targets of 64KB, tracked and untracked as the lazy resources are created and released
+	ResourceBytes trackedSize;
+	trackedSize[ResourceMemoryType::RenderTarget] = 64 * 1024;
+	referencedBytes += trackedSize.Total() * TrackedPerFrame * (TrackedLifetime + 1);
+	std::deque<CResourceBudget::EntryId> tracked;
+	uint32_t trackedCount = 0, settledEntryCount = 0;
+
+	double seconds = MeasureSeconds([&]()
+	{
+		for (int frame = 0; frame < frames && !allocator.error; ++frame)
+		{
+			//Loads requested last frame (and the initial loads on the first frame) complete
+			if (frame == 0)
+			{
+				for (int i = 0; i < resourceCount; ++i) allocator.pendingReloads.push_back(i);
+			}
+			std::vector<uint32_t> completing;
+			completing.swap(allocator.pendingReloads);
+			for (uint32_t key : completing)
+			{
+				allocator.loaded[key] = true;
+				budget.SetResident(entries[key], sizes[key]);
+			}
+
+			//Use a window of resources sliding across the pool
+			int first = (frame / 4) % resourceCount;
+			for (int i = 0; i < window; ++i)
+			{
+				budget.Use(entries[(first + i) % resourceCount]);
+			}
+
+			//Untrack the memory tracked TrackedLifetime frames ago and track more. Once the first has been untracked, every
+			//new entry should reuse a removed one
+			while (tracked.size() > static_cast<size_t>(TrackedPerFrame * TrackedLifetime))
+			{
+				budget.Remove(tracked.front());
+				tracked.pop_front();
+			}
+			for (int i = 0; i < TrackedPerFrame; ++i)
+			{
+				CResourceBudget::EntryId entry = budget.Add(TrackedKey);
+				budget.AddRef(entry);
+				budget.SetResident(entry, trackedSize);
+				tracked.push_back(entry);
+				++trackedCount;
+			}
+			if (frame == WarmUpFrames) settledEntryCount = budget.GetEntryCount();
+			if (frame > WarmUpFrames && budget.GetEntryCount() != settledEntryCount)
+			{
+				printf("Frame %d: the budget holds %u entries, %u after the first untracked memory\n", frame, budget.GetEntryCount(),
+					settledEntryCount);
+				allocator.error = true;
+			}
+
+			budget.Enforce();
+
+			//Check the policy: referenced resources stay loaded, and the total is within the budget
+			//unless the referenced resources alone exceed it
+			for (int i = 0; i < resourceCount; i += 8)
+			{
+				if (!budget.IsResident(entries[i]))
+				{
+					printf("Frame %d: referenced resource %d was evicted\n", frame, i);
+					allocator.error = true;
+				}
+			}
+			uint64_t total = budget.GetStats().residentBytes.Total();
+			if (total > budgetBytes && total > referencedBytes)
+			{
+				bool anyEvictable = false;
+				for (int i = 0; i < resourceCount; ++i)
+				{
+					anyEvictable |= budget.IsResident(entries[i]) && budget.GetRefCount(entries[i]) == 0;
+				}
+				if (anyEvictable)
+				{
+					printf("Frame %d: %.1f MB resident is over the %.1f MB budget\n", frame, total * MB, budgetBytes * MB);
+					allocator.error = true;
+				}
+			}
+		}
+	});
+
+	const ResourceBudgetStats& stats = budget.GetStats();
+	printf("%d resources, %d frames, window of %d, budget %.1f MB (%.1f MB always referenced)\n",
+		resourceCount, frames, window, budgetBytes * MB, referencedBytes * MB);
+	printf("  resident       %u resources, %.1f MB (peak %.1f MB)\n", stats.resident, stats.residentBytes.Total() * MB, stats.peakBytes * MB);
+	printf("  by type        textures %.1f MB, vertices %.1f MB, indices %.1f MB\n",
+		stats.residentBytes[ResourceMemoryType::Texture] * MB, stats.residentBytes[ResourceMemoryType::VertexBuffer] * MB,
+		stats.residentBytes[ResourceMemoryType::IndexBuffer] * MB);
+	printf("  evictions      %u\n", stats.evictions);
+	printf("  reloads        %u\n", stats.reloads);
+	printf("  tracked        %u short lived entries, %u entries held\n", trackedCount, budget.GetEntryCount());
+	printf("  policy time    %.3f ms\n", seconds * 1000.0);
+	printf("%s\n", allocator.error ? "FAILED" : "OK");
+	return allocator.error ? 1 : 0;
+}
@@ -0,0 +1,742 @@
+//--------------------------------------------------------------------------------------
+// Checking and timing the CPU post-processes
+//--------------------------------------------------------------------------------------
+// "cpu-post-bench" runs every effect in CPUPostProcess.h over a random scene at the app's
+// resolution (1268x960, see project/Main.cpp) and at 4K (3840x2160), with the noise map, spade
+// mask and distortion map from the media folder and the scene's default settings. Each effect is
+// first checked to give identical output in plain C++ on one thread, with SSE on one thread and
+// with SSE across a thread pool - any difference prints the first bad pixel and fails the command.
+// Each is then timed the same three ways and the rates reported in megapixels per second.
+// "cpu-chain-bench" runs chains of effects at the same sizes, starting with the scene's blur -
+// across, down, then a copy - one effect after another through full-size images, then fused a
+// tile at a time (see RunCPUPostProcessChain). The fused results are checked to be identical, in plain
+// C++ as well, and each way is timed with SSE across the pool. The bytes moved through full-size
+// images are reported with the rate they moved at, and for the fused chains the tile size, the
+// scratch each worker uses and the extra pixels shaded for the halos.
+// "cpu-polygon-bench" draws the effects over windows like the scene's, seen in perspective, with
+// RunCPUPostProcessPolygon - one cut by the near plane. Each is checked to give identical output
+// the three ways, and its two triangles drawn alone to cover the pixels the whole draw does with
+// none covered twice. A rectangle facing the camera is checked to cover the same pixels as the
+// area of the 2D quad and give the same area uv, and two halves of it split along the centres of
+// a column of pixels to cover it exactly between them. Any failure fails the command. The draws
+// are then timed, with the rate in megapixels covered per second.
+// "cpu-remap-bench" bakes the distortions of Fisheye, Underwater and Distort into uv offset maps
+// (see BakeCPUPostProcessRemap) and draws with them. The bake is checked to be identical on one
+// thread and across the pool, and drawing with the map to be identical the three ways as above.
+// Drawing with the map is compared with working the distortion out at each pixel: the pixels that
+// read a different texel of the scene and the largest difference are reported, and more than 1 in
+// 1000 pixels differing fails the command. The bake and both ways of drawing are then timed.
+// "cpu-pixelation-bench" pixelates a scene of brick1.jpg tiled across the frame, at the app's
+// resolution and at 4K, with each setting of the scene's "Pixel Size" slider, by averaging each
+// block (see RunCPUPixelationAreaAverage) and by point-sampling it as Pixelation does. Averaging
+// is checked to give identical output in plain C++, with SSE and across the pool, the same output
+// in place, and the same as Pixelation when each block is one pixel. Both ways are timed, and the
+// scene panned a pixel at a time across several frames to report the share of pixels changing
+// from one frame to the next - the shimmer as the camera moves.
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Utility/BlurKernel.h"
+#include "Utility/CPUPostProcess.h"
+#include "Utility/CThreadPool.h"
+#include "Utility/ImageDecoders.h"
+#include "Utility/MipGeneration.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	//Fastest of several runs of a function
+	template<typename Function>
+	double BestSeconds(long long repeats, Function function)
+	{
+		double best = 1e30;
+		for (long long r = 0; r < repeats; ++r) best = std::min(best, MeasureSeconds(function));
+		return best;
+	}
+
+	//Decode a texture from the media folder, make its mips as the loader would and convert it for the post-processes
+	bool LoadTexture(const fs::path& media, const std::string& fileName, CImage& image, CThreadPool& threads)
+	{
+		std::ifstream stream(media / fileName, std::ios::binary);
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+		CImage decoded, mips;
+		std::string error;
+		if (!DecodeImage(data.data(), data.size(), decoded, error, &threads) || !GenerateMips(decoded, mips, ChooseMipOptions(fileName), &threads) ||
+		    !ConvertToRGBA32F(mips, image, &threads))
+		{
+			printf("%s: %s\n", (media / fileName).string().c_str(), error.empty() ? "Unsupported pixel format" : error.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	//The settings the scene starts with (see Scene.cpp and the constants' defaults), for a viewport of the given size
+	PostProcessingConstants DefaultConstants(uint32_t width, uint32_t height)
+	{
+		PostProcessingConstants constants = {};
+		constants.area2DTopLeft = { 0, 0 };
+		constants.area2DSize = { 1, 1 };
+		constants.area2DDepth = 0;
+		constants.tintColour1 = { 0, 0, 1 };
+		constants.tintColour2 = { 0, 1, 0 };
+		constants.noiseScale = { width / 50.0f, height / 50.0f };
+		constants.noiseOffset = { 0.3f, 0.7f };
+		constants.distortLevel = 0.01f;
+		constants.UnderwaterEffect = 1.5f;
+		constants.LuminanceWeights = { 0.2126f, 0.7152f, 0.0722f };
+		constants.SaturationLevel = 30.0f;
+		constants.vignetteSize = 0.6f;
+		constants.vignetteFalloff = 0.25f;
+		constants.vignetteStrength = 1.3f;
+		constants.PixelWidth = 64.0f;
+		constants.PixelHeight = 64.0f;
+		constants.Feedback = 0.5f;
+		constants.maskThreshold = 0.1f;
+		constants.lookupRect = { 0, 0, 1, 1 };
+		constants.maskRect = { 0, 0, 1, 1 };
+		SetBlurTapConstants(constants, ComputeBlurTaps(8.0f));
+		return constants;
+	}
+
+	//Random colours with some values above 1, as a HDR scene has
+	void RandomScene(CImage& scene, uint32_t width, uint32_t height)
+	{
+		scene.Create(ImageFormat::RGBA32F, width, height);
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> value(0.0f, 1.25f);
+		float* pixels = reinterpret_cast<float*>(scene.GetData());
+		for (size_t i = 0; i < scene.GetSize() / sizeof(float); ++i) pixels[i] = value(random);
+	}
+
+	//Load the textures the effects sample from the media folder
+	bool LoadTextures(const fs::path& media, CImage& noise, CImage& mask, CImage& distort, CPUPostProcessTextures& textures, CThreadPool& threads)
+	{
+		if (!LoadTexture(media, "Noise.png", noise, threads) || !LoadTexture(media, "SpadeAlphaMap.png", mask, threads) ||
+		    !LoadTexture(media, "Distort.png", distort, threads))
+		{
+			return false;
+		}
+		textures.noise = &noise;
+		textures.mask = &mask;
+		textures.distort = &distort;
+		return true;
+	}
+
+	//Put a window in clip space: corners given as top-left, bottom-left, top-right, bottom-right, turned by yaw radians about
+	//y, moved to (x, y, z) and seen by a camera at the origin looking along z with a 60 degree field of view
+	void ProjectWindow(PostProcessingConstants& constants, const float corners[4][2], float yaw, float x, float y, float z, float aspect)
+	{
+		const float Near = 1.0f, Far = 10000.0f, cotangent = 1.0f / std::tan(3.14159265f / 6.0f);
+		for (int i = 0; i < 4; ++i)
+		{
+			float px = corners[i][0] * std::cos(yaw) + x, py = corners[i][1] + y, pz = corners[i][0] * std::sin(yaw) + z;
+			constants.polygon2DPoints[i] = CVector4(px * cotangent / aspect, py * cotangent, (pz - Near) * Far / (Far - Near), pz);
+		}
+	}
+
+	//Clip space corners of the rectangle of pixels [left, right) x [top, bottom) of a target, facing the camera w away
+	void ProjectRectangle(PostProcessingConstants& constants, float left, float top, float right, float bottom, uint32_t width,
+	                      uint32_t height, float w)
+	{
+		const float xs[4] = { left, left, right, right }, ys[4] = { top, bottom, top, bottom };
+		for (int i = 0; i < 4; ++i)
+		{
+			constants.polygon2DPoints[i] = CVector4((xs[i] / width * 2.0f - 1.0f) * w, (1.0f - ys[i] / height * 2.0f) * w, 0.5f * w, w);
+		}
+	}
+
+	//Return the index of the first float that differs between two images of the same size, or -1 if they match
+	long long FirstDifference(const CImage& a, const CImage& b)
+	{
+		if (std::memcmp(a.GetData(), b.GetData(), a.GetSize()) == 0) return -1;
+		for (size_t i = 0; i < a.GetSize(); i += sizeof(float))
+		{
+			if (std::memcmp(a.GetData() + i, b.GetData() + i, sizeof(float)) != 0) return static_cast<long long>(i / sizeof(float));
+		}
+		return -1;
+	}
+
+	//Fill the scene with a texture's top mip tiled across it, panned left by offset pixels
+	void TileScene(const CImage& texture, CImage& scene, uint32_t width, uint32_t height, uint32_t offset)
+	{
+		scene.Create(ImageFormat::RGBA32F, width, height);
+		const uint32_t textureWidth = texture.GetWidth(), textureHeight = texture.GetHeight();
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			const float* row = reinterpret_cast<const float*>(texture.GetRow(0, y % textureHeight));
+			float* pixel = reinterpret_cast<float*>(scene.GetRow(0, y));
+			for (uint32_t x = 0; x < width; ++x, pixel += 4) std::memcpy(pixel, row + (x + offset) % textureWidth * 4, 4 * sizeof(float));
+		}
+	}
+
+	//Pixels of two images that differ in colour. Alpha is left out, as the pixelation writes the luminance there
+	size_t CountChangedPixels(const CImage& a, const CImage& b)
+	{
+		size_t changed = 0;
+		for (size_t i = 0; i < a.GetSize(); i += 4 * sizeof(float))
+		{
+			if (std::memcmp(a.GetData() + i, b.GetData() + i, 3 * sizeof(float)) != 0) ++changed;
+		}
+		return changed;
+	}
+}
+
+int RunCPUPostProcessBenchmark(const CommandArgs& args)
+{
+	const fs::path  media       = fs::path(GetOption(args, "--dir", std::string("PostProcessing"))) / "Media";
+	const long long repeats     = std::max(1LL, GetOption(args, "--repeat", 3LL));
+	const long long threadCount = GetOption(args, "--threads", static_cast<long long>(CThreadPool::DefaultThreadCount(0)));
+
+	if (threadCount < 1 || threadCount > 256)
+	{
+		printf("--threads must be between 1 and 256\n");
+		return 1;
+	}
+	CThreadPool threads(static_cast<unsigned int>(threadCount));
+
+	CPUPostProcessTextures textures;
+	CImage noise, mask, distort;
+	if (!LoadTextures(media, noise, mask, distort, textures, threads)) return 1;
+
+	struct Size { uint32_t width, height; };
+	const Size sizes[] = { { 1268, 960 }, { 3840, 2160 } };
+	for (auto& size : sizes)
+	{
+		CImage scene;
+		RandomScene(scene, size.width, size.height);
+		textures.scene = &scene;
+
+		const PostProcessingConstants constants = DefaultConstants(size.width, size.height);
+		const double pixelCount = static_cast<double>(size.width) * size.height;
+		printf("%ux%u, best of %lld runs\n", size.width, size.height, repeats);
+		printf("%-24s %14s %14s %14s\n", "Effect", "C++ MPixel/s", "SSE MPixel/s", "SSE N MPixel/s");
+		for (CPUPostProcess effect : AllCPUPostProcesses)
+		{
+			//Start each check from the same target, as discarded pixels are left untouched
+			CImage plain = scene, simd = scene, pooled = scene;
+			if (!RunCPUPostProcess(effect, constants, textures, plain, nullptr, false) ||
+			    !RunCPUPostProcess(effect, constants, textures, simd, nullptr, true) ||
+			    !RunCPUPostProcess(effect, constants, textures, pooled, &threads, true))
+			{
+				printf("FAILED: %s did not run\n", GetPostProcessName(effect));
+				return 1;
+			}
+			for (const CImage* result : { &simd, &pooled })
+			{
+				long long bad = FirstDifference(plain, *result);
+				if (bad >= 0)
+				{
+					const float* expected = reinterpret_cast<const float*>(plain.GetData());
+					const float* actual = reinterpret_cast<const float*>(result->GetData());
+					printf("FAILED: %s %s differs from C++ at pixel %lld channel %lld: %.9g, not %.9g\n", GetPostProcessName(effect),
+						result == &simd ? "with SSE" : "with threads", bad / 4, bad % 4, actual[bad], expected[bad]);
+					return 1;
+				}
+			}
+
+			CImage target = scene;
+			double plainSeconds = BestSeconds(repeats, [&]() { RunCPUPostProcess(effect, constants, textures, target, nullptr, false); });
+			double simdSeconds = BestSeconds(repeats, [&]() { RunCPUPostProcess(effect, constants, textures, target, nullptr, true); });
+			double pooledSeconds = BestSeconds(repeats, [&]() { RunCPUPostProcess(effect, constants, textures, target, &threads, true); });
+			printf("%-24s %14.1f %14.1f %14.1f\n", GetPostProcessName(effect), pixelCount / plainSeconds * 1e-6,
+				pixelCount / simdSeconds * 1e-6, pixelCount / pooledSeconds * 1e-6);
+		}
+		printf("\n");
+	}
+	printf("N = %lld threads. All effects give identical results each way\n", threadCount);
+	return 0;
+}
+
+int RunCPUPostProcessChainBenchmark(const CommandArgs& args)
+{
+	const fs::path  media       = fs::path(GetOption(args, "--dir", std::string("PostProcessing"))) / "Media";
+	const long long repeats     = std::max(1LL, GetOption(args, "--repeat", 3LL));
+	const long long threadCount = GetOption(args, "--threads", static_cast<long long>(CThreadPool::DefaultThreadCount(0)));
+
+	if (threadCount < 1 || threadCount > 256)
+	{
+		printf("--threads must be between 1 and 256\n");
+		return 1;
+	}
+	CThreadPool threads(static_cast<unsigned int>(threadCount));
+
+	CPUPostProcessTextures textures;
+	CImage noise, mask, distort;
+	if (!LoadTextures(media, noise, mask, distort, textures, threads)) return 1;
+
+	struct Chain
+	{
+		const char* name;
+		std::vector<CPUPostProcess> effects;
+	};
+	const Chain chains[] =
+	{
+		{ "Blur (as the scene)",      { CPUPostProcess::HorizontalBlur, CPUPostProcess::VerticalBlur, CPUPostProcess::Copy } },
+		{ "Blur+Vignette+Underwater+Copy", { CPUPostProcess::HorizontalBlur, CPUPostProcess::VerticalBlur, CPUPostProcess::Vignette, CPUPostProcess::Underwater,
+		                                     CPUPostProcess::Copy } },
+		{ "Gradient+Saturation+Pixelation+Vignette", { CPUPostProcess::VerticalColourGradient, CPUPostProcess::Saturation, CPUPostProcess::Pixelation,
+		                                               CPUPostProcess::Vignette } },
+		{ "Vignette+Distort+Fisheye+Copy", { CPUPostProcess::Vignette, CPUPostProcess::Distort, CPUPostProcess::Fisheye, CPUPostProcess::Copy } },
+	};
+
+	struct Size { uint32_t width, height; };
+	const Size sizes[] = { { 1268, 960 }, { 3840, 2160 } };
+	for (auto& size : sizes)
+	{
+		CImage scene;
+		RandomScene(scene, size.width, size.height);
+		textures.scene = &scene;
+
+		printf("%ux%u, best of %lld runs with SSE on %lld threads\n", size.width, size.height, repeats, threadCount);
+		printf("%-40s | %6s %9s %8s %7s | %6s %5s %10s %6s %9s %8s %7s | %8s\n", "Chain", "Passes", "Image MB", "ms", "GB/s",
+			"Passes", "Tile", "Scratch KB", "Halo", "Image MB", "ms", "GB/s", "Speed-up");
+		for (auto& chain : chains)
+		{
+			std::vector<CPUPostProcessStage> stages;
+			for (CPUPostProcess effect : chain.effects) stages.push_back({ effect, DefaultConstants(size.width, size.height) });
+
+			CImage unfused, fused, plain;
+			CPUPostProcessChainStats unfusedStats, fusedStats;
+			if (!RunCPUPostProcessChain(stages, textures, unfused, &threads, true, false, &unfusedStats) ||
+			    !RunCPUPostProcessChain(stages, textures, fused, &threads, true, true, &fusedStats) ||
+			    !RunCPUPostProcessChain(stages, textures, plain, nullptr, false, true))
+			{
+				printf("FAILED: %s did not run\n", chain.name);
+				return 1;
+			}
+			for (const CImage* result : { &fused, &plain })
+			{
+				long long bad = FirstDifference(unfused, *result);
+				if (bad >= 0)
+				{
+					const float* expected = reinterpret_cast<const float*>(unfused.GetData());
+					const float* actual = reinterpret_cast<const float*>(result->GetData());
+					printf("FAILED: %s fused%s differs from unfused at pixel %lld channel %lld: %.9g, not %.9g\n", chain.name,
+						result == &plain ? " in plain C++" : "", bad / 4, bad % 4, actual[bad], expected[bad]);
+					return 1;
+				}
+			}
+
+			CImage target;
+			double unfusedSeconds = BestSeconds(repeats, [&]() { RunCPUPostProcessChain(stages, textures, target, &threads, true, false); });
+			double fusedSeconds = BestSeconds(repeats, [&]() { RunCPUPostProcessChain(stages, textures, target, &threads, true, true); });
+			const double MB = 1.0 / (1024.0 * 1024.0);
+			printf("%-40s | %6u %9.1f %8.2f %7.2f | %6u %5u %10.0f %5.1f%% %9.1f %8.2f %7.2f | %7.2fx\n", chain.name,
+				unfusedStats.passes, unfusedStats.imageBytes * MB, unfusedSeconds * 1000.0, unfusedStats.imageBytes / unfusedSeconds * 1e-9,
+				fusedStats.passes, fusedStats.tileSize, fusedStats.scratchBytes / 1024.0,
+				(static_cast<double>(fusedStats.shadedPixels) / unfusedStats.shadedPixels - 1.0) * 100.0, fusedStats.imageBytes * MB,
+				fusedSeconds * 1000.0, fusedStats.imageBytes / fusedSeconds * 1e-9, unfusedSeconds / fusedSeconds);
+		}
+		printf("\n");
+	}
+	printf("Unfused on the left, fused on the right. Image MB is read from and written to full-size images, and halo the extra\n"
+	       "pixels shaded around the tiles. All chains give identical results each way\n");
+	return 0;
+}
+
+int RunCPUPostProcessPolygonBenchmark(const CommandArgs& args)
+{
+	const fs::path  media       = fs::path(GetOption(args, "--dir", std::string("PostProcessing"))) / "Media";
+	const long long repeats     = std::max(1LL, GetOption(args, "--repeat", 3LL));
+	const long long threadCount = GetOption(args, "--threads", static_cast<long long>(CThreadPool::DefaultThreadCount(0)));
+
+	if (threadCount < 1 || threadCount > 256)
+	{
+		printf("--threads must be between 1 and 256\n");
+		return 1;
+	}
+	CThreadPool threads(static_cast<unsigned int>(threadCount));
+
+	CPUPostProcessTextures textures;
+	CImage noise, mask, distort;
+	if (!LoadTextures(media, noise, mask, distort, textures, threads)) return 1;
+
+	//The scene's windows (see PostProcessingScene.h), each turned to the camera and at a distance
+	const float spade[4][2]   = { { -5.5f, 6 }, { -5.5f, -6 }, { 5.5f, 6 }, { 5.5f, -6 } };
+	const float heart[4][2]   = { { -5.5f, 5 }, { -5.5f, -5 }, { 5.5f, 5 }, { 5.5f, -5 } };
+	const float diamond[4][2] = { { -1, 4.65f }, { -4.65f, 0 }, { 2.65f, 0 }, { -1, -4.65f } };
+	const float clover[4][2]  = { { -7.5f, 7.5f }, { -7.5f, -7.5f }, { 7.5f, 7.5f }, { 7.5f, -7.5f } };
+	const float square[4][2]  = { { -5, 5 }, { -5, -5 }, { 5, 5 }, { 5, -5 } };
+	struct Window
+	{
+		const char*     name;
+		CPUPostProcess  effect;
+		const float   (*corners)[2];
+		float           yaw, x, y, z;
+	};
+	const Window windows[] =
+	{
+		{ "Spade",                   CPUPostProcess::Saturation, spade,   0.5f, -18,  0, 40 },
+		{ "Heart",                   CPUPostProcess::GreyNoise,  heart,  -0.3f,  15,  3, 35 },
+		{ "Diamond",                 CPUPostProcess::Vignette,   diamond, 0.2f,  -3, -5, 30 },
+		{ "Clover",                  CPUPostProcess::Distort,    clover,  1.0f,   5,  0, 25 },
+		{ "Square",                  CPUPostProcess::Fisheye,    square,  1.2f,   0,  0, 12 },
+		{ "Clover, past near plane", CPUPostProcess::Copy,       clover,  1.45f,  0,  0,  6 },
+	};
+
+	struct Size { uint32_t width, height; };
+	const Size sizes[] = { { 1268, 960 }, { 3840, 2160 } };
+	for (auto& size : sizes)
+	{
+		CImage scene;
+		RandomScene(scene, size.width, size.height);
+		textures.scene = &scene;
+		const float aspect = static_cast<float>(size.width) / size.height;
+
+		//The pixels a draw covers, drawing the scene over a target of -1s
+		CImage coverageTarget;
+		const auto coverage = [&](const PostProcessingConstants& constants, std::vector<uint8_t>& covered)
+		{
+			coverageTarget.Create(ImageFormat::RGBA32F, size.width, size.height);
+			float* pixels = reinterpret_cast<float*>(coverageTarget.GetData());
+			std::fill(pixels, pixels + coverageTarget.GetSize() / sizeof(float), -1.0f);
+			RunCPUPostProcessPolygon(CPUPostProcess::Copy, constants, textures, coverageTarget, &threads);
+			covered.resize(static_cast<size_t>(size.width) * size.height);
+			for (size_t i = 0; i < covered.size(); ++i) covered[i] = pixels[i * 4] != -1.0f;
+		};
+		const auto countCovered = [](const std::vector<uint8_t>& covered) { return std::count(covered.begin(), covered.end(), 1); };
+
+		//A rectangle facing the camera, against the 2D quad over the same area
+		PostProcessingConstants rectangle = DefaultConstants(size.width, size.height);
+		const float left = 100.25f, top = 50.75f, right = size.width - 99.75f, bottom = size.height - 60.25f;
+		ProjectRectangle(rectangle, left, top, right, bottom, size.width, size.height, 7.0f);
+		rectangle.area2DTopLeft = { left / size.width, top / size.height };
+		rectangle.area2DSize = { (right - left) / size.width, (bottom - top) / size.height };
+		CImage polygonVignette = scene, quadVignette = scene;
+		RunCPUPostProcessPolygon(CPUPostProcess::Vignette, rectangle, textures, polygonVignette, &threads);
+		RunCPUPostProcess(CPUPostProcess::Vignette, rectangle, textures, quadVignette, &threads);
+		double maxDifference = 0.0;
+		const float* polygonPixels = reinterpret_cast<const float*>(polygonVignette.GetData());
+		const float* quadPixels = reinterpret_cast<const float*>(quadVignette.GetData());
+		for (size_t i = 0; i < polygonVignette.GetSize() / sizeof(float); ++i)
+		{
+			maxDifference = std::max(maxDifference, static_cast<double>(std::abs(polygonPixels[i] - quadPixels[i])));
+		}
+		std::vector<uint8_t> polygonCovered, quadCovered(static_cast<size_t>(size.width) * size.height), leftCovered, rightCovered;
+		coverage(rectangle, polygonCovered);
+		for (uint32_t y = 0; y < size.height; ++y)
+		{
+			for (uint32_t x = 0; x < size.width; ++x) quadCovered[y * size.width + x] = x + 0.5f >= left && x + 0.5f < right && y + 0.5f >= top && y + 0.5f < bottom;
+		}
+		if (polygonCovered != quadCovered || maxDifference > 1e-4)
+		{
+			printf("FAILED: a rectangle covers %lld pixels, not %lld, and its vignette differs from the 2D quad's by up to %g\n",
+				static_cast<long long>(countCovered(polygonCovered)), static_cast<long long>(countCovered(quadCovered)), maxDifference);
+			return 1;
+		}
+
+		//Split down the centres of a column, which the left edge of the right half covers
+		PostProcessingConstants half = rectangle;
+		const float split = std::floor((left + right) / 2.0f) + 0.5f;
+		ProjectRectangle(half, left, top, split, bottom, size.width, size.height, 7.0f);
+		coverage(half, leftCovered);
+		ProjectRectangle(half, split, top, right, bottom, size.width, size.height, 7.0f);
+		coverage(half, rightCovered);
+		for (size_t i = 0; i < quadCovered.size(); ++i)
+		{
+			if ((leftCovered[i] && rightCovered[i]) || (leftCovered[i] || rightCovered[i]) != quadCovered[i])
+			{
+				printf("FAILED: the halves of a rectangle cover pixel (%zu, %zu) %s\n", i % size.width, i / size.width,
+					leftCovered[i] && rightCovered[i] ? "twice" : "wrongly");
+				return 1;
+			}
+		}
+
+		printf("%ux%u, best of %lld runs\n", size.width, size.height, repeats);
+		printf("%-24s %-12s %10s %14s %14s %14s\n", "Window", "Effect", "Pixels", "C++ MPixel/s", "SSE MPixel/s", "SSE N MPixel/s");
+		for (auto& window : windows)
+		{
+			PostProcessingConstants constants = DefaultConstants(size.width, size.height);
+			ProjectWindow(constants, window.corners, window.yaw, window.x, window.y, window.z, aspect);
+			const char* effectName = GetPostProcessName(window.effect);
+
+			CImage plain = scene, simd = scene, pooled = scene;
+			if (!RunCPUPostProcessPolygon(window.effect, constants, textures, plain, nullptr, false) ||
+			    !RunCPUPostProcessPolygon(window.effect, constants, textures, simd, nullptr, true) ||
+			    !RunCPUPostProcessPolygon(window.effect, constants, textures, pooled, &threads, true))
+			{
+				printf("FAILED: %s did not run\n", window.name);
+				return 1;
+			}
+			for (const CImage* result : { &simd, &pooled })
+			{
+				long long bad = FirstDifference(plain, *result);
+				if (bad >= 0)
+				{
+					const float* expected = reinterpret_cast<const float*>(plain.GetData());
+					const float* actual = reinterpret_cast<const float*>(result->GetData());
+					printf("FAILED: %s %s differs from C++ at pixel %lld channel %lld: %.9g, not %.9g\n", window.name,
+						result == &simd ? "with SSE" : "with threads", bad / 4, bad % 4, actual[bad], expected[bad]);
+					return 1;
+				}
+			}
+
+			//The strip's triangles alone, (0, 1, 2) and (2, 1, 3), each repeating its last corner for a second with no area
+			std::vector<uint8_t> covered, firstCovered, secondCovered;
+			coverage(constants, covered);
+			PostProcessingConstants triangle = constants;
+			triangle.polygon2DPoints[3] = constants.polygon2DPoints[2];
+			coverage(triangle, firstCovered);
+			triangle.polygon2DPoints[0] = constants.polygon2DPoints[2];
+			triangle.polygon2DPoints[2] = triangle.polygon2DPoints[3] = constants.polygon2DPoints[3];
+			coverage(triangle, secondCovered);
+			for (size_t i = 0; i < covered.size(); ++i)
+			{
+				if ((firstCovered[i] && secondCovered[i]) || (firstCovered[i] || secondCovered[i]) != covered[i])
+				{
+					printf("FAILED: the triangles of %s cover pixel (%zu, %zu) %s\n", window.name, i % size.width, i / size.width,
+						firstCovered[i] && secondCovered[i] ? "twice" : "wrongly");
+					return 1;
+				}
+			}
+
+			CImage target = scene;
+			const double pixelCount = static_cast<double>(countCovered(covered));
+			double plainSeconds = BestSeconds(repeats, [&]() { RunCPUPostProcessPolygon(window.effect, constants, textures, target, nullptr, false); });
+			double simdSeconds = BestSeconds(repeats, [&]() { RunCPUPostProcessPolygon(window.effect, constants, textures, target, nullptr, true); });
+			double pooledSeconds = BestSeconds(repeats, [&]() { RunCPUPostProcessPolygon(window.effect, constants, textures, target, &threads, true); });
+			printf("%-24s %-12s %10.0f %14.1f %14.1f %14.1f\n", window.name, effectName, pixelCount, pixelCount / plainSeconds * 1e-6,
+				pixelCount / simdSeconds * 1e-6, pixelCount / pooledSeconds * 1e-6);
+		}
+		printf("\n");
+	}
+	printf("N = %lld threads. All windows give identical results each way, and cover each pixel once\n", threadCount);
+	return 0;
+}
+
+int RunCPUPostProcessRemapBenchmark(const CommandArgs& args)
+{
+	const fs::path  media       = fs::path(GetOption(args, "--dir", std::string("PostProcessing"))) / "Media";
+	const long long repeats     = std::max(1LL, GetOption(args, "--repeat", 3LL));
+	const long long threadCount = GetOption(args, "--threads", static_cast<long long>(CThreadPool::DefaultThreadCount(0)));
+
+	if (threadCount < 1 || threadCount > 256)
+	{
+		printf("--threads must be between 1 and 256\n");
+		return 1;
+	}
+	CThreadPool threads(static_cast<unsigned int>(threadCount));
+
+	CPUPostProcessTextures textures;
+	CImage noise, mask, distort;
+	if (!LoadTextures(media, noise, mask, distort, textures, threads)) return 1;
+
+	struct Size { uint32_t width, height; };
+	const Size sizes[] = { { 1268, 960 }, { 3840, 2160 } };
+	for (auto& size : sizes)
+	{
+		CImage scene;
+		RandomScene(scene, size.width, size.height);
+		textures.scene = &scene;
+
+		const PostProcessingConstants constants = DefaultConstants(size.width, size.height);
+		const double pixelCount = static_cast<double>(size.width) * size.height;
+		printf("%ux%u, best of %lld runs with SSE on %lld threads\n", size.width, size.height, repeats, threadCount);
+		printf("%-12s %10s %9s %12s %10s | %14s %14s %8s\n", "Effect", "Map", "Bake ms", "Pixels off", "Max diff", "Direct MPix/s",
+			"Remap MPix/s", "Speed-up");
+		for (CPUPostProcess effect : AllCPUPostProcesses)
+		{
+			if (!HasCPUPostProcessRemap(effect)) continue;
+			const char* name = GetPostProcessName(effect);
+
+			CImage map, pooledMap;
+			if (!BakeCPUPostProcessRemap(effect, constants, textures, size.width, size.height, map, nullptr) ||
+			    !BakeCPUPostProcessRemap(effect, constants, textures, size.width, size.height, pooledMap, &threads))
+			{
+				printf("FAILED: %s did not bake\n", name);
+				return 1;
+			}
+			if (map.GetSize() != pooledMap.GetSize() || std::memcmp(map.GetData(), pooledMap.GetData(), map.GetSize()) != 0)
+			{
+				printf("FAILED: %s bakes differently across threads\n", name);
+				return 1;
+			}
+
+			//Drawn directly, then with the map each way
+			CPUPostProcessTextures remapped = textures;
+			remapped.remap = &map;
+			CImage direct = scene, plain = scene, simd = scene, pooled = scene;
+			if (!RunCPUPostProcess(effect, constants, textures, direct, &threads, true) ||
+			    !RunCPUPostProcess(effect, constants, remapped, plain, nullptr, false) ||
+			    !RunCPUPostProcess(effect, constants, remapped, simd, nullptr, true) ||
+			    !RunCPUPostProcess(effect, constants, remapped, pooled, &threads, true))
+			{
+				printf("FAILED: %s did not run\n", name);
+				return 1;
+			}
+			for (const CImage* result : { &simd, &pooled })
+			{
+				long long bad = FirstDifference(plain, *result);
+				if (bad >= 0)
+				{
+					const float* expected = reinterpret_cast<const float*>(plain.GetData());
+					const float* actual = reinterpret_cast<const float*>(result->GetData());
+					printf("FAILED: %s remapped %s differs from C++ at pixel %lld channel %lld: %.9g, not %.9g\n", name,
+						result == &simd ? "with SSE" : "with threads", bad / 4, bad % 4, actual[bad], expected[bad]);
+					return 1;
+				}
+			}
+
+			//Pixels whose offset rounds to another texel of the scene read something else entirely, so are counted apart
+			const float* expected = reinterpret_cast<const float*>(direct.GetData());
+			const float* actual = reinterpret_cast<const float*>(plain.GetData());
+			size_t pixelsOff = 0;
+			double maxDifference = 0.0;
+			for (size_t i = 0; i < direct.GetSize() / sizeof(float); i += 4)
+			{
+				double difference = 0.0;
+				for (size_t c = 0; c < 4; ++c) difference = std::max(difference, static_cast<double>(std::abs(actual[i + c] - expected[i + c])));
+				if (difference > 1e-5) ++pixelsOff;
+				else                   maxDifference = std::max(maxDifference, difference);
+			}
+			if (pixelsOff * 1000 > static_cast<size_t>(pixelCount))
+			{
+				printf("FAILED: %s remapped reads another texel of the scene at %zu pixels\n", name, pixelsOff);
+				return 1;
+			}
+
+			CImage target = scene, timedMap;
+			double bakeSeconds = BestSeconds(repeats, [&]() { BakeCPUPostProcessRemap(effect, constants, textures, size.width, size.height, timedMap, &threads); });
+			double directSeconds = BestSeconds(repeats, [&]() { RunCPUPostProcess(effect, constants, textures, target, &threads, true); });
+			double remapSeconds = BestSeconds(repeats, [&]() { RunCPUPostProcess(effect, constants, remapped, target, &threads, true); });
+			char mapSize[32];
+			snprintf(mapSize, sizeof(mapSize), "%ux%u", map.GetWidth(), map.GetHeight());
+			printf("%-12s %10s %9.2f %5zu (%3.2f%%) %10.1e | %14.1f %14.1f %7.2fx\n", name, mapSize, bakeSeconds * 1000.0, pixelsOff,
+				pixelsOff * 100.0 / pixelCount, maxDifference, pixelCount / directSeconds * 1e-6, pixelCount / remapSeconds * 1e-6,
+				directSeconds / remapSeconds);
+		}
+		printf("\n");
+	}
+	printf("Pixels off read another texel of the scene than working the distortion out directly, and max diff is over the rest.\n"
+	       "The bake is needed when the settings change - each frame for Underwater, whose phase moves\n");
+	return 0;
+}
+
+int RunCPUPixelationBenchmark(const CommandArgs& args)
+{
+	const fs::path  media       = fs::path(GetOption(args, "--dir", std::string("PostProcessing"))) / "Media";
+	const long long repeats     = std::max(1LL, GetOption(args, "--repeat", 3LL));
+	const long long frames      = std::max(2LL, GetOption(args, "--frames", 8LL));
+	const long long threadCount = GetOption(args, "--threads", static_cast<long long>(CThreadPool::DefaultThreadCount(0)));
+
+	if (threadCount < 1 || threadCount > 256)
+	{
+		printf("--threads must be between 1 and 256\n");
+		return 1;
+	}
+	CThreadPool threads(static_cast<unsigned int>(threadCount));
+
+	CImage bricks;
+	if (!LoadTexture(media, "brick1.jpg", bricks, threads)) return 1;
+
+	//With a block a pixel, averaging reads the same pixel as the point sample
+	{
+		CImage scene, point, average;
+		RandomScene(scene, 512, 512);
+		PostProcessingConstants constants = DefaultConstants(512, 512);
+		constants.PixelWidth = 512.0f;
+		constants.PixelHeight = 512.0f;
+		CPUPostProcessTextures textures;
+		textures.scene = &scene;
+		point = scene;
+		if (!RunCPUPostProcess(CPUPostProcess::Pixelation, constants, textures, point, &threads) ||
+		    !RunCPUPixelationAreaAverage(constants, scene, average, &threads) || FirstDifference(point, average) >= 0)
+		{
+			printf("FAILED: averaging blocks of one pixel differs from Pixelation\n");
+			return 1;
+		}
+	}
+
+	//The settings of the scene's "Pixel Size" slider, the blocks across and down the screen
+	const int pixelSizes[] = { 40, 48, 64, 80, 96, 112, 128 };
+
+	struct Size { uint32_t width, height; };
+	const Size sizes[] = { { 1268, 960 }, { 3840, 2160 } };
+	for (auto& size : sizes)
+	{
+		CImage scene;
+		TileScene(bricks, scene, size.width, size.height, 0);
+		CPUPostProcessTextures textures;
+		textures.scene = &scene;
+
+		//The scene panned a pixel at a time
+		std::vector<CImage> panned(static_cast<size_t>(frames));
+		for (size_t f = 0; f < panned.size(); ++f) TileScene(bricks, panned[f], size.width, size.height, static_cast<uint32_t>(f));
+
+		const double pixelCount = static_cast<double>(size.width) * size.height;
+		printf("%ux%u of brick1.jpg, best of %lld runs, changes over %lld frames panned a pixel at a time\n", size.width, size.height,
+			repeats, frames);
+		printf("%-10s %9s %12s %12s %12s %12s %9s %9s\n", "Pixel Size", "Block px", "Point ms", "Average C++", "Average SSE",
+			"Average N", "Point %", "Average %");
+		for (int pixelSize : pixelSizes)
+		{
+			PostProcessingConstants constants = DefaultConstants(size.width, size.height);
+			constants.PixelWidth = static_cast<float>(pixelSize);
+			constants.PixelHeight = static_cast<float>(pixelSize);
+
+			CImage plain, simd, pooled, inPlace = scene;
+			if (!RunCPUPixelationAreaAverage(constants, scene, plain, nullptr, false) ||
+			    !RunCPUPixelationAreaAverage(constants, scene, simd, nullptr, true) ||
+			    !RunCPUPixelationAreaAverage(constants, scene, pooled, &threads, true) ||
+			    !RunCPUPixelationAreaAverage(constants, inPlace, inPlace, &threads, true))
+			{
+				printf("FAILED: averaging the blocks did not run\n");
+				return 1;
+			}
+			for (const CImage* result : { &simd, &pooled, &inPlace })
+			{
+				long long bad = FirstDifference(plain, *result);
+				if (bad >= 0)
+				{
+					const float* expected = reinterpret_cast<const float*>(plain.GetData());
+					const float* actual = reinterpret_cast<const float*>(result->GetData());
+					printf("FAILED: averaging the blocks %s differs from C++ at pixel %lld channel %lld: %.9g, not %.9g\n",
+						result == &simd ? "with SSE" : (result == &pooled ? "with threads" : "in place"), bad / 4, bad % 4, actual[bad],
+						expected[bad]);
+					return 1;
+				}
+			}
+
+			CImage target = scene;
+			double pointSeconds = BestSeconds(repeats, [&]() { RunCPUPostProcess(CPUPostProcess::Pixelation, constants, textures, target, &threads); });
+			double plainSeconds = BestSeconds(repeats, [&]() { RunCPUPixelationAreaAverage(constants, scene, target, nullptr, false); });
+			double simdSeconds = BestSeconds(repeats, [&]() { RunCPUPixelationAreaAverage(constants, scene, target, nullptr, true); });
+			double pooledSeconds = BestSeconds(repeats, [&]() { RunCPUPixelationAreaAverage(constants, scene, target, &threads, true); });
+
+			//Pixels changing from each frame to the next, each way
+			size_t pointChanged = 0, averageChanged = 0;
+			CImage point[2], average[2];
+			for (size_t f = 0; f < panned.size(); ++f)
+			{
+				CPUPostProcessTextures frame;
+				frame.scene = &panned[f];
+				point[f % 2] = panned[f];
+				RunCPUPostProcess(CPUPostProcess::Pixelation, constants, frame, point[f % 2], &threads);
+				RunCPUPixelationAreaAverage(constants, panned[f], average[f % 2], &threads);
+				if (f == 0) continue;
+				pointChanged += CountChangedPixels(point[0], point[1]);
+				averageChanged += CountChangedPixels(average[0], average[1]);
+			}
+			const double comparedPixels = pixelCount * (panned.size() - 1);
+
+			printf("%-10d %9.1f %12.2f %12.2f %12.2f %12.2f %8.2f%% %8.2f%%\n", pixelSize, static_cast<double>(size.width) / pixelSize,
+				pointSeconds * 1e3, plainSeconds * 1e3, simdSeconds * 1e3, pooledSeconds * 1e3, pointChanged * 100.0 / comparedPixels,
+				averageChanged * 100.0 / comparedPixels);
+		}
+		printf("\n");
+	}
+	printf("Point is Pixelation with SSE across the pool, and Average is averaging the blocks in plain C++, with SSE on one thread and\n"
+	       "with SSE across the pool. The last two columns are the pixels changing colour from one panned frame to the next\n");
+	return 0;
+}
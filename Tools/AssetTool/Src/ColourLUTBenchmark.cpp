@@ -0,0 +1,229 @@
+//--------------------------------------------------------------------------------------
+// Checking and timing the colour lookup tables
+//--------------------------------------------------------------------------------------
+// "colour-lut-bench" grades an image the size of the app's viewport (1268x960 by default) of
+// random HDR colours, red, green and blue each 0->1.25, with chains of the effects' colour maps
+// (see Utility/ColourLUT.h). It:
+// - checks running the gradient, saturation and palette maps on each pixel of a smaller image gives
+//   the same results as the CPU copies of their shaders, with the palette's blocks a pixel wide
+// - checks a table of the saturation lerp, which is linear in the colour, matches it to float
+//   rounding, as tetrahedral interpolation is exact for linear maps, and that looking it up with
+//   SSE gives identical results to plain C++
+// - for each chain and size of table, times baking the table and grading the image by looking up
+//   the table, after running the gradient on each pixel, against running the chain on each pixel,
+//   and measures the table's error against that as the largest and RMS difference over every
+//   channel, and the share of pixels with a channel off by more than 1/255. It shows whether
+//   IsColourLUTWorthwhile picks the table for the chain, which should be where it saves time
+// Any check failing fails the command.
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Utility/ColourLUT.h"
+#include "Utility/CPUPostProcess.h"
+#include "Utility/CThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+
+namespace
+{
+	//Fastest of several runs of a function
+	template<typename Function>
+	double BestSeconds(long long repeats, Function function)
+	{
+		double best = 1e30;
+		for (long long r = 0; r < repeats; ++r) best = std::min(best, MeasureSeconds(function));
+		return best;
+	}
+
+	//The scene's settings for the effects with colour maps
+	PostProcessingConstants GradeConstants()
+	{
+		PostProcessingConstants constants = {};
+		constants.area2DTopLeft = { 0, 0 };
+		constants.area2DSize = { 1, 1 };
+		constants.tintColour1 = { 0, 0, 1 };
+		constants.tintColour2 = { 0, 1, 0 };
+		constants.UnderwaterEffect = 1.5f;
+		constants.LuminanceWeights = { 0.2126f, 0.7152f, 0.0722f };
+		constants.SaturationLevel = 30.0f;
+		constants.maskThreshold = 0.1f;
+		constants.maskRect = { 0, 0, 1, 1 };
+		return constants;
+	}
+
+	//Largest difference between the channels of two images, with NaN only matching NaN
+	double MaxDifference(const CImage& a, const CImage& b)
+	{
+		const float* first = reinterpret_cast<const float*>(a.GetData());
+		const float* second = reinterpret_cast<const float*>(b.GetData());
+		double largest = 0.0;
+		for (size_t i = 0; i < a.GetSize() / sizeof(float); ++i)
+		{
+			if (std::isnan(first[i]) || std::isnan(second[i]))
+			{
+				if (std::isnan(first[i]) != std::isnan(second[i])) return INFINITY;
+				continue;
+			}
+			largest = std::max(largest, std::abs(static_cast<double>(first[i]) - second[i]));
+		}
+		return largest;
+	}
+
+	//Largest and RMS difference of the table's grade from the chain's, over the finite channels, and the share of pixels with a
+	//channel off by more than 1/255
+	void MeasureError(const CImage& graded, const CImage& expected, double& maxError, double& rmsError, double& visible)
+	{
+		const float* actual = reinterpret_cast<const float*>(graded.GetData());
+		const float* wanted = reinterpret_cast<const float*>(expected.GetData());
+		const size_t pixels = graded.GetSize() / (sizeof(float) * 4);
+		double squaredError = 0.0;
+		size_t channels = 0, offPixels = 0;
+		maxError = 0.0;
+		for (size_t p = 0; p < pixels; ++p)
+		{
+			bool off = false;
+			for (int c = 0; c < 4; ++c)
+			{
+				if (!std::isfinite(wanted[p * 4 + c])) continue;
+				double error = std::abs(actual[p * 4 + c] - static_cast<double>(wanted[p * 4 + c]));
+				maxError = std::max(maxError, error);
+				squaredError += error * error;
+				off = off || error > 1.0 / 255.0;
+				++channels;
+			}
+			if (off) ++offPixels;
+		}
+		rmsError = channels ? std::sqrt(squaredError / channels) : 0.0;
+		visible = pixels ? 100.0 * offPixels / pixels : 0.0;
+	}
+
+	//Red, green and blue each 0->1.25, as a HDR scene has
+	void RandomColours(CImage& image)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> value(0.0f, 1.25f);
+		float* pixels = reinterpret_cast<float*>(image.GetData());
+		for (size_t i = 0; i < image.GetSize() / sizeof(float); ++i) pixels[i] = value(random);
+	}
+
+	std::string ChainName(const std::vector<ColourOperator>& chain)
+	{
+		std::string name;
+		for (ColourOperator op : chain) name += (name.empty() ? "" : "+") + std::string(GetColourOperatorName(op));
+		return name;
+	}
+}
+
+int RunColourLUTBenchmark(const CommandArgs& args)
+{
+	const long long width       = GetOption(args, "--width", 1268LL);
+	const long long height      = GetOption(args, "--height", 960LL);
+	const long long repeats     = std::max(1LL, GetOption(args, "--repeat", 3LL));
+	const long long threadCount = GetOption(args, "--threads", static_cast<long long>(CThreadPool::DefaultThreadCount(0)));
+	const float     range       = static_cast<float>(std::atof(GetOption(args, "--range", std::string("4")).c_str()));
+
+	if (width < 1 || width > 8192 || height < 1 || height > 8192 || threadCount < 1 || threadCount > 256 || !(range > 0.0f))
+	{
+		printf("--width and --height must be between 1 and 8192, --threads between 1 and 256 and --range above 0\n");
+		return 1;
+	}
+	CThreadPool threads(static_cast<unsigned int>(threadCount));
+
+	CImage scene;
+	scene.Create(ImageFormat::RGBA32F, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+	RandomColours(scene);
+
+	//The colour maps run on each pixel against the shaders' CPU copies. The check is 512 pixels square so the palette's blocks
+	//land exactly on each pixel
+	CImage checkScene, clearMask; // Saturation's mask, cutting nothing out
+	checkScene.Create(ImageFormat::RGBA32F, 512, 512);
+	RandomColours(checkScene);
+	clearMask.Create(ImageFormat::RGBA32F, 1, 1);
+	PostProcessingConstants constants = GradeConstants();
+	constants.PixelWidth = 512.0f;
+	constants.PixelHeight = 512.0f;
+	CPUPostProcessTextures textures;
+	textures.scene = &checkScene;
+	textures.mask = &clearMask;
+	const std::pair<ColourOperator, CPUPostProcess> shaders[] = { { ColourOperator::Gradient, CPUPostProcess::VerticalColourGradient },
+		{ ColourOperator::Saturation, CPUPostProcess::Saturation }, { ColourOperator::GameBoyPalette, CPUPostProcess::Pixelation } };
+	for (const auto& shader : shaders)
+	{
+		CImage effect = checkScene, graded;
+		if (!RunCPUPostProcess(shader.second, constants, textures, effect, &threads) ||
+		    !ApplyColourOperators({ shader.first }, constants, checkScene, graded, &threads) || MaxDifference(effect, graded) != 0.0)
+		{
+			printf("FAILED: the %s colour map differs from %s\n", GetColourOperatorName(shader.first), GetPostProcessName(shader.second));
+			return 1;
+		}
+	}
+
+	//A table of a linear map against the map itself
+	{
+		ColourLUT lut;
+		CImage graded, expected;
+		BakeColourLUT({ ColourOperator::Saturation }, constants, 17, range, lut, &threads);
+		ApplyColourLUT(lut, constants, scene, graded, &threads);
+		ApplyColourOperators({ ColourOperator::Saturation }, constants, scene, expected, &threads);
+		double maxError = MaxDifference(graded, expected);
+		if (maxError > 1e-4 * constants.SaturationLevel * range)
+		{
+			printf("FAILED: a table of the saturation lerp differs from it by up to %g\n", maxError);
+			return 1;
+		}
+
+		CImage scalar;
+		ApplyColourLUT(lut, constants, scene, scalar, nullptr, false);
+		if (MaxDifference(graded, scalar) != 0.0)
+		{
+			printf("FAILED: looking up the table with SSE differs from plain C++\n");
+			return 1;
+		}
+	}
+
+	const std::vector<std::vector<ColourOperator>> chains =
+	{
+		{ ColourOperator::Saturation },
+		{ ColourOperator::UnderwaterTint },
+		{ ColourOperator::GameBoyPalette },
+		{ ColourOperator::Saturation, ColourOperator::UnderwaterTint },
+		{ ColourOperator::UnderwaterTint, ColourOperator::GameBoyPalette },
+		{ ColourOperator::Saturation, ColourOperator::UnderwaterTint, ColourOperator::GameBoyPalette },
+		{ ColourOperator::Gradient, ColourOperator::UnderwaterTint },
+		{ ColourOperator::Gradient, ColourOperator::Saturation, ColourOperator::UnderwaterTint },
+		{ ColourOperator::Gradient, ColourOperator::Saturation, ColourOperator::UnderwaterTint, ColourOperator::GameBoyPalette },
+	};
+	const uint32_t sizes[] = { 16, 32, 64 };
+
+	constants = GradeConstants();
+	printf("Colour grading a %lldx%lld image of colours 0->1.25, tables covering 0->%g, best of %lld runs on %lld threads\n\n", width, height,
+		range, repeats, threadCount);
+	printf("%-54s %4s %8s %8s %10s %10s %10s %10s %11s %8s %6s\n", "Chain", "Size", "KB", "Bake ms", "Chain ms", "Table ms", "Saved ms",
+		"Max error", "RMS error", "> 1/255", "Table");
+	for (const std::vector<ColourOperator>& chain : chains)
+	{
+		CImage expected, graded;
+		ApplyColourOperators(chain, constants, scene, expected, &threads);
+		double chainSeconds = BestSeconds(repeats, [&]() { ApplyColourOperators(chain, constants, scene, expected, &threads); });
+		for (uint32_t size : sizes)
+		{
+			ColourLUT lut;
+			double bakeSeconds = BestSeconds(repeats, [&]() { BakeColourLUT(chain, constants, size, range, lut, &threads); });
+			double tableSeconds = BestSeconds(repeats, [&]() { ApplyColourLUT(lut, constants, scene, graded, &threads); });
+
+			double maxError, rmsError, visible;
+			MeasureError(graded, expected, maxError, rmsError, visible);
+			printf("%-54s %4u %8.0f %8.3f %10.2f %10.2f %10.2f %10.4f %11.6f %7.2f%% %6s\n", ChainName(chain).c_str(), size,
+				lut.GetSize() / 1024.0, bakeSeconds * 1e3, chainSeconds * 1e3, tableSeconds * 1e3, (chainSeconds - tableSeconds) * 1e3, maxError,
+				rmsError, visible, IsColourLUTWorthwhile(chain) ? "yes" : "no");
+		}
+	}
+	printf("\nSaved is the chain's time less the table's. The table is only baked again when the chain or its settings change,\n"
+	       "as the gradient runs on each pixel. Table is whether the app looks the chain up in a table. The maps are checked\n"
+	       "against the shaders' CPU copies, and the errors are of the table against running the chain on each pixel\n");
+	return 0;
+}
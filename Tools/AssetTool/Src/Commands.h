@@ -0,0 +1,79 @@
+//--------------------------------------------------------------------------------------
+// Commands available in the asset tool
+//--------------------------------------------------------------------------------------
+// Each command receives the arguments following its name and returns the process exit code.
+// Add new commands here and to the table in Main.cpp
+#pragma once
+#include <string>
+#include <vector>
+
+using CommandArgs = std::vector<std::string>;
+
+//Compare the cost of fetching resources by name against fetching them through handles
+int RunLookupBenchmark(const CommandArgs& args);
+
+//Run the resource memory budget against a mock allocator and check its eviction policy
+int RunBudgetSimulation(const CommandArgs& args);
+
+//Hash every file under a directory and report files with identical contents
+int RunDedupReport(const CommandArgs& args);
+
+//Build an asset pack from folders of loose files
+int RunPackAssets(const CommandArgs& args);
+
+//Compare getting every file ready for loading from loose files against from a pack
+int RunPackBenchmark(const CommandArgs& args);
+
+//Time decoding the texture files and BC blocks on the CPU
+int RunImageBenchmark(const CommandArgs& args);
+
+//Compress the PNG and JPEG media to BC1/BC3/BC4/BC5 DDS files with mips and report their quality
+int RunCompressMedia(const CommandArgs& args);
+
+//Time generating mip chains with each filter, with and without SSE and threads
+int RunMipBenchmark(const CommandArgs& args);
+
+//Run the texture mip streaming scheduler against a mock uploader and check its invariants
+int RunStreamingSimulation(const CommandArgs& args);
+
+//Pack the polygon cut-out masks and noise map into one BC4 atlas texture and report its utilization
+int RunAtlasBuilder(const CommandArgs& args);
+
+//Convert the polygon cut-out masks to small signed distance fields and report the time taken and memory saved
+int RunSDFMasks(const CommandArgs& args);
+
+//Check the pixel format conversions exhaustively and time them with and without SIMD
+int RunPixelFormatBenchmark(const CommandArgs& args);
+
+//Run the post-process shaders' CPU copies, check SIMD and threads give identical results, and time them in megapixels per second
+int RunCPUPostProcessBenchmark(const CommandArgs& args);
+
+//Run chains of the CPU post-processes through full-size images and fused a tile at a time, check they match and time them
+int RunCPUPostProcessChainBenchmark(const CommandArgs& args);
+
+//Check and time the CPU post-processes drawn over polygons in perspective
+int RunCPUPostProcessPolygonBenchmark(const CommandArgs& args);
+
+//Bake the geometric post-processes' distortions into uv offset maps, check drawing with them against the direct way and time both
+int RunCPUPostProcessRemapBenchmark(const CommandArgs& args);
+
+//Pixelate by averaging each block and by point-sampling it, check the average and time both across the scene's pixel sizes
+int RunCPUPixelationBenchmark(const CommandArgs& args);
+
+//Check the constant time Gaussian blur against convolution and time it against sigma
+int RunBlurBenchmark(const CommandArgs& args);
+
+//Check the linear-sampling blur kernels against convolution and optionally write one out as HLSL
+int RunBlurKernelCheck(const CommandArgs& args);
+
+//Bake chains of the effects' colour maps into lookup tables, check them against the shaders and time grading with each
+int RunColourLUTBenchmark(const CommandArgs& args);
+
+//Quantize to the built-in palettes with each dither, check the tables and the wavefront and report quality and throughput
+int RunPaletteBenchmark(const CommandArgs& args);
+
+//Make tiles of blue noise for the film grain, check them and report the time per tile size [--out DIR caches them]
+int RunBlueNoiseBenchmark(const CommandArgs& args);
+
+//Check the instanced batching of models against grouping them by mesh and texture directly
+int RunInstanceBatcherCheck(const CommandArgs& args);
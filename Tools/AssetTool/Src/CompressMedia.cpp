@@ -0,0 +1,197 @@
+//--------------------------------------------------------------------------------------
+// Compressing the PNG and JPEG media to block compressed DDS files
+//--------------------------------------------------------------------------------------
+// "compress-media" decodes every PNG and JPEG file in the Media folder, makes its mips with the
+// options ChooseMipOptions picks for the file, and compresses them, writing a DDS file of the
+// same name beside it. CResourceManager loads the DDS in place of the original when it finds one,
+// so the textures take 4x (BC3, BC5) or 8x (BC1, BC4) less memory than RGBA8 and need no decoding
+// or mip generation at load time.
+// The format is chosen from the file name and contents: BC4 for the single channel masks, BC5 for
+// the two channel distortion map, BC3 for images with any transparency and BC1 for the rest.
+// For each file the PSNR of the decompressed top mip against the original is reported, over the
+// channels the format keeps, along with the encoding rate.
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Utility/BCCompression.h"
+#include "Utility/BCDecompression.h"
+#include "Utility/CThreadPool.h"
+#include "Utility/ImageDecoders.h"
+#include "Utility/ImageEncoders.h"
+#include "Utility/MipGeneration.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace
+{
+	const double MB = 1.0 / (1024.0 * 1024.0);
+
+	//Split a comma separated list
+	std::vector<std::string> SplitList(const std::string& list)
+	{
+		std::vector<std::string> items;
+		std::stringstream stream(list);
+		std::string item;
+		while (std::getline(stream, item, ','))
+		{
+			if (!item.empty()) items.push_back(item);
+		}
+		return items;
+	}
+
+	bool NameContains(const std::string& name, const std::vector<std::string>& parts)
+	{
+		for (auto& part : parts)
+		{
+			if (name.find(part) != std::string::npos) return true;
+		}
+		return false;
+	}
+
+	bool HasTransparency(const CImage& image)
+	{
+		const uint8_t* pixels = image.GetData();
+		for (size_t i = 3; i < image.GetMip(0).size; i += 4)
+		{
+			if (pixels[i] != 255) return true;
+		}
+		return false;
+	}
+
+	//Number of channels, starting from red, that a format keeps
+	uint32_t KeptChannels(ImageFormat format)
+	{
+		switch (format)
+		{
+		case ImageFormat::BC4: return 1;
+		case ImageFormat::BC5: return 2;
+		case ImageFormat::BC1: return 3;
+		default:               return 4;
+		}
+	}
+
+	//Peak signal to noise ratio in dB of the first channels of two RGBA8 or BGRA8 top mips, infinite if they match
+	double ComputePSNR(const CImage& original, const CImage& decoded, uint32_t channels)
+	{
+		bool swapRedBlue = original.GetFormat() != decoded.GetFormat();
+		double squaredError = 0;
+		size_t pixels = static_cast<size_t>(original.GetWidth()) * original.GetHeight();
+		const uint8_t* a = original.GetData();
+		const uint8_t* b = decoded.GetData();
+		for (size_t i = 0; i < pixels; ++i, a += 4, b += 4)
+		{
+			for (uint32_t c = 0; c < channels; ++c)
+			{
+				uint32_t other = (swapRedBlue && c != 1 && c != 3) ? 2 - c : c;
+				double difference = static_cast<double>(a[c]) - b[other];
+				squaredError += difference * difference;
+			}
+		}
+		if (squaredError == 0) return INFINITY;
+		return 10.0 * std::log10(255.0 * 255.0 * pixels * channels / squaredError);
+	}
+}
+
+int RunCompressMedia(const CommandArgs& args)
+{
+	namespace fs = std::filesystem;
+	const std::string directory = GetOption(args, "--dir", std::string("PostProcessing"));
+	const long long threadCount = GetOption(args, "--threads", static_cast<long long>(CThreadPool::DefaultThreadCount(0)));
+	const BCQuality quality = HasFlag(args, "--fast") ? BCQuality::Fast : BCQuality::High;
+	const std::vector<std::string> singleChannel = SplitList(GetOption(args, "--bc4", std::string("AlphaMap,Noise")));
+	const std::vector<std::string> twoChannel = SplitList(GetOption(args, "--bc5", std::string("Distort")));
+
+	if (threadCount < 1 || threadCount > 256)
+	{
+		printf("--threads must be between 1 and 256\n");
+		return 1;
+	}
+	CThreadPool threads(static_cast<unsigned int>(threadCount));
+
+	std::vector<fs::path> paths;
+	std::error_code folderError;
+	for (auto& entry : fs::directory_iterator(fs::path(directory) / "Media", folderError))
+	{
+		std::string extension = entry.path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+		if (entry.is_regular_file() && (extension == ".png" || extension == ".jpg" || extension == ".jpeg"))
+		{
+			paths.push_back(entry.path());
+		}
+	}
+	if (folderError)
+	{
+		printf("Cannot read folder %s: %s\n", (fs::path(directory) / "Media").string().c_str(), folderError.message().c_str());
+		return 1;
+	}
+	std::sort(paths.begin(), paths.end());
+
+	printf("Compressing %zu files, %s quality, %lld threads\n\n", paths.size(), quality == BCQuality::High ? "high" : "fast", threadCount);
+	printf("%-20s %-6s %11s %10s %10s %6s %8s %9s %9s\n", "File", "Format", "Size", "RGBA8 MB", "DDS MB", "Ratio", "PSNR dB", "ms", "MPixel/s");
+	double totalSeconds = 0, totalPixels = 0, totalBefore = 0, totalAfter = 0;
+	int failures = 0;
+	for (auto& path : paths)
+	{
+		std::string name = path.filename().string();
+		std::ifstream stream(path, std::ios::binary);
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+		CImage image, mips, compressed, decompressed;
+		std::string error;
+		if (!DecodeImage(data.data(), data.size(), image, error, &threads) || !GenerateMips(image, mips, ChooseMipOptions(name), &threads))
+		{
+			printf("%-20s %s\n", name.c_str(), error.empty() ? "Unsupported pixel format" : error.c_str());
+			++failures;
+			continue;
+		}
+
+		ImageFormat format = NameContains(name, singleChannel) ? ImageFormat::BC4 :
+		                     NameContains(name, twoChannel)    ? ImageFormat::BC5 :
+		                     HasTransparency(image)            ? ImageFormat::BC3 : ImageFormat::BC1;
+
+		double seconds = MeasureSeconds([&]() { CompressBC(mips, format, compressed, &threads, quality); });
+		DecompressBC(compressed, decompressed, &threads);
+
+		std::vector<uint8_t> file;
+		fs::path output = path;
+		output.replace_extension(".dds");
+		if (!EncodeDDS(compressed, file, error))
+		{
+			printf("%-20s %s\n", name.c_str(), error.c_str());
+			++failures;
+			continue;
+		}
+		std::ofstream out(output, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+		if (!out)
+		{
+			printf("%-20s Cannot write %s\n", name.c_str(), output.string().c_str());
+			++failures;
+			continue;
+		}
+
+		double pixels = static_cast<double>(mips.GetSize()) / 4.0;
+		double before = mips.GetSize() * MB, after = file.size() * MB;
+		char size[32];
+		snprintf(size, sizeof(size), "%ux%u", image.GetWidth(), image.GetHeight());
+		printf("%-20s %-6s %11s %10.2f %10.2f %5.1fx %8.2f %9.1f %9.2f\n", name.c_str(), GetFormatName(format), size, before, after,
+			before / after, ComputePSNR(image, decompressed, KeptChannels(format)), seconds * 1000.0, pixels / seconds * 1e-6);
+
+		totalSeconds += seconds;
+		totalPixels += pixels;
+		totalBefore += before;
+		totalAfter += after;
+	}
+	if (totalSeconds > 0)
+	{
+		printf("\nAll files: %.2f MB as RGBA8 with mips, %.2f MB compressed (%.1fx), encoded in %.1f s at %.2f MPixel/s\n",
+			totalBefore, totalAfter, totalBefore / totalAfter, totalSeconds, totalPixels / totalSeconds * 1e-6);
+	}
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,111 @@
+//--------------------------------------------------------------------------------------
+// Report of duplicate asset files, as found by CResourceManager's content hashing
+//--------------------------------------------------------------------------------------
+// Hashes every file under a directory (streamed, as the resource manager does on its I/O
+// threads), groups files with identical contents and reports how many bytes loading only one
+// of each group saves. Files are looked up through hash maps so this scales to large asset sets.
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Utility/CContentHash.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	struct HashedFile
+	{
+		std::string path;
+		uint64_t size;
+	};
+}
+
+int RunDedupReport(const CommandArgs& args)
+{
+	namespace fs = std::filesystem;
+	const std::string directory = GetOption(args, "--dir", std::string("PostProcessing"));
+	const bool verbose = HasFlag(args, "--verbose");
+
+	std::error_code error;
+	if (!fs::is_directory(directory, error))
+	{
+		printf("'%s' is not a directory\n", directory.c_str());
+		return 1;
+	}
+
+	//Files with identical contents, keyed by hash. Canonical paths catch the same file reached twice (e.g. through a link)
+	std::unordered_map<uint64_t, std::vector<HashedFile>> contents;
+	std::unordered_map<std::string, uint64_t> canonicalPaths;
+	uint64_t totalBytes = 0;
+	unsigned int fileCount = 0, unreadable = 0, samePath = 0;
+
+	double seconds = MeasureSeconds([&]()
+	{
+		for (auto& entry : fs::recursive_directory_iterator(directory, fs::directory_options::follow_directory_symlink, error))
+		{
+			if (!entry.is_regular_file()) continue;
+
+			std::string path = entry.path().generic_string();
+			if (!canonicalPaths.emplace(CanonicalPath(path), 0).second)
+			{
+				++samePath;
+				continue;
+			}
+
+			uint64_t hash, size;
+			if (!CContentHash::HashFile(path, hash, size))
+			{
+				++unreadable; // Includes empty files
+				continue;
+			}
+			contents[hash].push_back({ path, size });
+			totalBytes += size;
+			++fileCount;
+		}
+	});
+
+	//Report the groups largest saving first. A matching size is required as well as the hash, as the resource manager does
+	std::multimap<uint64_t, const std::vector<HashedFile>*, std::greater<uint64_t>> groups;
+	uint64_t bytesSaved = 0;
+	unsigned int duplicates = 0;
+	for (auto& group : contents)
+	{
+		const std::vector<HashedFile>& files = group.second;
+		if (files.size() < 2) continue;
+
+		uint64_t saved = 0;
+		for (size_t i = 1; i < files.size(); ++i)
+		{
+			if (files[i].size == files[0].size)
+			{
+				saved += files[i].size;
+				++duplicates;
+			}
+		}
+		bytesSaved += saved;
+		groups.emplace(saved, &files);
+	}
+
+	const double MB = 1.0 / (1024.0 * 1024.0);
+	printf("Hashed %u files, %.2f MB in %.1f ms (%.0f MB/s)\n", fileCount, totalBytes * MB, seconds * 1000.0,
+		seconds > 0 ? totalBytes * MB / seconds : 0.0);
+	if (unreadable > 0) printf("Skipped %u empty or unreadable files\n", unreadable);
+	if (samePath > 0)   printf("Skipped %u paths to files already hashed\n", samePath);
+	printf("%u duplicate files in %zu groups, %.2f MB saved by sharing (%.1f%%)\n", duplicates, groups.size(),
+		bytesSaved * MB, totalBytes > 0 ? 100.0 * bytesSaved / totalBytes : 0.0);
+
+	if (verbose)
+	{
+		for (auto& group : groups)
+		{
+			printf("\n%.2f MB saved:\n", group.first * MB);
+			for (auto& file : *group.second) printf("  %s\n", file.path.c_str());
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,148 @@
+//--------------------------------------------------------------------------------------
+// Benchmarking the CPU image decoders
+//--------------------------------------------------------------------------------------
+// "image-bench" decodes every DDS, PNG and JPEG file in the assets from memory (so disk speed
+// does not count) and reports the rate in MB/s of both file bytes read and pixel bytes produced,
+// on one thread and across a thread pool. The DDS files the scene uses are uncompressed, so BC
+// decompression is timed on generated images of random blocks, which exercise every BC7 mode.
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Utility/BCDecompression.h"
+#include "Utility/CThreadPool.h"
+#include "Utility/ImageDecoders.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+namespace
+{
+	const double MB = 1.0 / (1024.0 * 1024.0);
+
+	struct ImageFile
+	{
+		std::string          name;
+		std::vector<uint8_t> data;
+	};
+
+	//Read every file with one of the given extensions in a folder, sorted by name
+	bool ReadFiles(const std::filesystem::path& folder, const std::vector<std::string>& extensions, std::vector<ImageFile>& files)
+	{
+		namespace fs = std::filesystem;
+		std::vector<fs::path> paths;
+		std::error_code error;
+		for (auto& entry : fs::directory_iterator(folder, error))
+		{
+			std::string extension = entry.path().extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+			if (entry.is_regular_file() && std::find(extensions.begin(), extensions.end(), extension) != extensions.end())
+			{
+				paths.push_back(entry.path());
+			}
+		}
+		if (error)
+		{
+			printf("Cannot read folder %s: %s\n", folder.string().c_str(), error.message().c_str());
+			return false;
+		}
+		std::sort(paths.begin(), paths.end());
+
+		for (auto& path : paths)
+		{
+			std::ifstream stream(path, std::ios::binary);
+			ImageFile file;
+			file.name = path.filename().string();
+			file.data.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+			files.push_back(std::move(file));
+		}
+		return true;
+	}
+
+	//Fastest of several runs of a function
+	template<typename Function>
+	double BestSeconds(long long repeats, Function function)
+	{
+		double best = 1e30;
+		for (long long r = 0; r < repeats; ++r) best = std::min(best, MeasureSeconds(function));
+		return best;
+	}
+}
+
+int RunImageBenchmark(const CommandArgs& args)
+{
+	const std::string directory = GetOption(args, "--dir", std::string("PostProcessing"));
+	const long long repeats = std::max(1LL, GetOption(args, "--repeat", 3LL));
+	const long long threadCount = GetOption(args, "--threads", static_cast<long long>(CThreadPool::DefaultThreadCount(0)));
+	const long long blockSize = GetOption(args, "--bc-size", 2048LL);
+
+	if (threadCount < 1 || threadCount > 256 || blockSize < 4 || blockSize > 16384)
+	{
+		printf("--threads must be between 1 and 256 and --bc-size between 4 and 16384\n");
+		return 1;
+	}
+	CThreadPool threads(static_cast<unsigned int>(threadCount));
+
+	std::vector<ImageFile> files;
+	if (!ReadFiles(std::filesystem::path(directory) / "Data", { ".dds" }, files) ||
+		!ReadFiles(std::filesystem::path(directory) / "Media", { ".dds", ".png", ".jpg", ".jpeg" }, files))
+	{
+		return 1;
+	}
+
+	//Decoding the asset files
+	printf("Decoding %zu files, best of %lld runs, 1 thread and %lld threads\n\n", files.size(), repeats, threadCount);
+	printf("%-26s %-6s %11s %9s %9s %9s %9s\n", "File", "Format", "Size", "File MB", "ms (1)", "ms (N)", "MB/s in/out (N)");
+	double totalSeconds = 0, totalIn = 0, totalOut = 0;
+	for (auto& file : files)
+	{
+		CImage image;
+		std::string error;
+		if (!DecodeImage(file.data.data(), file.data.size(), image, error))
+		{
+			printf("%-26s %s\n", file.name.c_str(), error.c_str());
+			continue;
+		}
+
+		double serial = BestSeconds(repeats, [&]() { DecodeImage(file.data.data(), file.data.size(), image, error); });
+		double pooled = BestSeconds(repeats, [&]() { DecodeImage(file.data.data(), file.data.size(), image, error, &threads); });
+		double in = file.data.size() * MB, out = image.GetSize() * MB;
+		char size[32];
+		snprintf(size, sizeof(size), "%ux%u", image.GetWidth(), image.GetHeight());
+		printf("%-26s %-6s %11s %9.2f %9.2f %9.2f %7.0f / %.0f\n", file.name.c_str(), GetFormatName(image.GetFormat()), size,
+			in, serial * 1000.0, pooled * 1000.0, in / pooled, out / pooled);
+
+		totalSeconds += pooled;
+		totalIn += in;
+		totalOut += out;
+	}
+	if (totalSeconds > 0)
+	{
+		printf("\nAll files: %.2f MB in, %.2f MB out in %.1f ms, %.0f MB/s in, %.0f MB/s out\n",
+			totalIn, totalOut, totalSeconds * 1000.0, totalIn / totalSeconds, totalOut / totalSeconds);
+	}
+
+	//Block decompression on random blocks
+	printf("\nBC decompression of %lldx%lld random blocks (SIMD %s)\n\n", blockSize, blockSize, HasBCDecodeSIMD() ? "available" : "not available");
+	printf("%-6s %14s %14s %14s\n", "Format", "Scalar MB/s", "SIMD MB/s", "SIMD N MB/s");
+	std::mt19937 random(1234);
+	for (ImageFormat format : { ImageFormat::BC1, ImageFormat::BC3, ImageFormat::BC5, ImageFormat::BC7 })
+	{
+		CImage blocks, pixels;
+		blocks.Create(format, static_cast<uint32_t>(blockSize), static_cast<uint32_t>(blockSize));
+		uint8_t* data = blocks.GetData();
+		for (size_t i = 0; i < blocks.GetSize(); ++i) data[i] = static_cast<uint8_t>(random());
+
+		double scalar = BestSeconds(repeats, [&]() { DecompressBC(blocks, pixels, nullptr, false); });
+		double simd = BestSeconds(repeats, [&]() { DecompressBC(blocks, pixels, nullptr, true); });
+		double pooled = BestSeconds(repeats, [&]() { DecompressBC(blocks, pixels, &threads, true); });
+		double out = pixels.GetSize() * MB;
+		printf("%-6s %14.0f %14.0f %14.0f\n", GetFormatName(format), out / scalar, out / simd, out / pooled);
+	}
+	printf("\nRates are of RGBA8 output. BC7 has no SIMD path, so its two single thread rates should match\n");
+	return 0;
+}
@@ -0,0 +1,167 @@
+//--------------------------------------------------------------------------------------
+// Check of the instanced batching against a plain grouping of the models
+//--------------------------------------------------------------------------------------
+// Drives CInstanceBatcher without a device. Each trial adds models with a random mix of mesh and
+// texture keys - some of whose meshes cannot be instanced - in a random order, builds the
+// batches and checks them against grouping the models by key directly:
+// - there is one batch per mesh and texture used, in order of mesh then texture
+// - each batch covers the next run of instances, holding its models in the order they were added
+// - refused models are reported as such and appear in no batch
+// - the counters add up: draw calls are the batches, and every other accepted model is a draw saved
+// The first trial is a fixed case, so a failure there is easy to follow by hand.
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Data/InstanceBatcher.h"
+
+#include <cstdio>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	//A model as added to the batcher. Its number travels in the tint so instances can be traced back to it
+	struct TestModel
+	{
+		uint32_t mesh, texture;
+		bool     supportsInstancing;
+	};
+
+	//Add the models to a cleared batcher, build it and check the result. Returns false and prints why on failure
+	bool CheckBatches(CInstanceBatcher& batcher, const std::vector<TestModel>& models, std::vector<char>& meshKeys, std::vector<char>& textureKeys)
+	{
+		//The batcher only compares the keys, so addresses in two arrays stand in for meshes and textures
+		auto meshKey = [&](uint32_t i) { return reinterpret_cast<Mesh*>(&meshKeys[i]); };
+		auto textureKey = [&](uint32_t i) { return reinterpret_cast<ID3D11ShaderResourceView*>(&textureKeys[i]); };
+
+		batcher.Clear();
+		std::map<std::pair<uint32_t, uint32_t>, std::vector<uint32_t>> expected;
+		uint32_t rejected = 0;
+		for (uint32_t i = 0; i < models.size(); ++i)
+		{
+			const TestModel& model = models[i];
+			CMatrix4x4 world = {};
+			bool added = batcher.Add(meshKey(model.mesh), textureKey(model.texture), world, CVector3(static_cast<float>(i), 0, 0),
+			                         model.supportsInstancing);
+			if (added != model.supportsInstancing)
+			{
+				printf("Model %u was %s, its mesh %s be instanced\n", i, added ? "added" : "refused", model.supportsInstancing ? "can" : "cannot");
+				return false;
+			}
+			if (added) expected[{ model.mesh, model.texture }].push_back(i);
+			else       ++rejected;
+		}
+		batcher.Build();
+
+		const std::vector<InstanceBatch>& batches = batcher.GetBatches();
+		const std::vector<InstanceData>& instances = batcher.GetInstances();
+		const InstanceStats& stats = batcher.GetStats();
+		if (batches.size() != expected.size())
+		{
+			printf("%zu batches, expected %zu\n", batches.size(), expected.size());
+			return false;
+		}
+
+		//The map is ordered by mesh then texture, as the keys' addresses are
+		uint32_t batchIndex = 0, nextInstance = 0;
+		for (auto& [key, members] : expected)
+		{
+			const InstanceBatch& batch = batches[batchIndex];
+			if (batch.mesh != meshKey(key.first) || batch.texture != textureKey(key.second))
+			{
+				printf("Batch %u is for the wrong mesh or texture, expected mesh %u texture %u\n", batchIndex, key.first, key.second);
+				return false;
+			}
+			if (batch.firstInstance != nextInstance || batch.instanceCount != members.size())
+			{
+				printf("Batch %u covers instances %u-%u, expected %u-%zu\n", batchIndex, batch.firstInstance,
+					batch.firstInstance + batch.instanceCount, nextInstance, nextInstance + members.size());
+				return false;
+			}
+			for (uint32_t m = 0; m < members.size(); ++m)
+			{
+				uint32_t model = static_cast<uint32_t>(instances[nextInstance + m].tintColour.x);
+				if (model != members[m])
+				{
+					printf("Batch %u holds model %u at %u, expected model %u\n", batchIndex, model, m, members[m]);
+					return false;
+				}
+			}
+			nextInstance += batch.instanceCount;
+			++batchIndex;
+		}
+
+		const uint32_t accepted = static_cast<uint32_t>(models.size()) - rejected;
+		if (instances.size() != accepted || stats.instancesSubmitted != accepted || stats.instancesRejected != rejected ||
+		    stats.drawCalls != batches.size() || stats.drawCallsSaved != accepted - batches.size())
+		{
+			printf("Counters show %u submitted, %u refused, %u draw calls, %u saved - expected %u, %u, %zu, %zu\n", stats.instancesSubmitted,
+				stats.instancesRejected, stats.drawCalls, stats.drawCallsSaved, accepted, rejected, batches.size(), accepted - batches.size());
+			return false;
+		}
+		return true;
+	}
+}
+
+int RunInstanceBatcherCheck(const CommandArgs& args)
+{
+	const int trials = static_cast<int>(GetOption(args, "--trials", 1000LL));
+	const int maxModels = static_cast<int>(GetOption(args, "--models", 64LL));
+	if (trials < 1 || maxModels < 1)
+	{
+		printf("--trials and --models must be at least 1\n");
+		return 1;
+	}
+
+	const uint32_t meshCount = 4, textureCount = 3;
+	std::vector<char> meshKeys(meshCount), textureKeys(textureCount);
+	CInstanceBatcher batcher;
+
+	//Lights sharing a mesh and texture, a second mesh with two textures interleaved with them, and an uninstanceable mesh
+	const std::vector<TestModel> fixed =
+	{
+		{ 1, 0, true }, { 0, 0, true }, { 1, 2, true }, { 3, 0, false }, { 0, 0, true }, { 1, 0, true }, { 0, 0, true }, { 3, 0, false },
+	};
+	if (!CheckBatches(batcher, fixed, meshKeys, textureKeys))
+	{
+		printf("FAILED on the fixed case\n");
+		return 1;
+	}
+	const InstanceStats fixedStats = batcher.GetStats();
+	printf("Fixed case: %u instances in %u draw calls (%u saved), %u refused\n", fixedStats.instancesSubmitted, fixedStats.drawCalls,
+		fixedStats.drawCallsSaved, fixedStats.instancesRejected);
+
+	//Random mixes, reusing the batcher as the scene does each frame. The last mesh cannot be instanced
+	std::mt19937 random(1234);
+	uint64_t totalModels = 0, totalDrawCalls = 0;
+	bool failed = false;
+	double seconds = MeasureSeconds([&]()
+	{
+		for (int trial = 0; trial < trials; ++trial)
+		{
+			std::vector<TestModel> models(std::uniform_int_distribution<int>(0, maxModels)(random));
+			for (auto& model : models)
+			{
+				model.mesh = random() % meshCount;
+				model.texture = random() % textureCount;
+				model.supportsInstancing = model.mesh != meshCount - 1;
+			}
+			if (!CheckBatches(batcher, models, meshKeys, textureKeys))
+			{
+				printf("FAILED on trial %d of %zu models\n", trial, models.size());
+				failed = true;
+				return;
+			}
+			totalModels += models.size();
+			totalDrawCalls += batcher.GetStats().drawCalls;
+		}
+	});
+	if (failed) return 1;
+
+	printf("%d random trials of up to %d models: %llu models in %llu draw calls, %.3f ms\n", trials, maxModels,
+		static_cast<unsigned long long>(totalModels), static_cast<unsigned long long>(totalDrawCalls), seconds * 1000.0);
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,100 @@
+//--------------------------------------------------------------------------------------
+// Benchmark of resource lookups as done by the scene each frame
+//--------------------------------------------------------------------------------------
+// Replays the scene's per-frame texture fetches (15 of them) against three implementations:
+//  - the old CResourceManager map keyed on the string literal's address, searched twice (find then at)
+//  - CResourceRegistry searched by name
+//  - CResourceRegistry indexed by a handle kept from load time
+// Resources are stand-in objects so no device is needed.
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Utility/CResourceRegistry.h"
+
+#include <cstdio>
+#include <cstdint>
+#include <map>
+
+namespace
+{
+	struct FakeTexture { uint32_t id; };
+
+	//The texture names loaded by PostProcessingScene::InitGeometry
+	const wchar_t* const TextureNames[] =
+	{
+		L"StarsTexture", L"BricksTexture", L"GroundTexture", L"CubeTexture", L"WallsTexture", L"LightsTexture",
+		L"ContainerTexture", L"TeapotTexture", L"TrollTexture", L"NoiseMap", L"DistortMap",
+		L"SpadeAlphaMap", L"CloverAlphaMap", L"HeartAlphaMap",
+	};
+	const int NumTextures = sizeof(TextureNames) / sizeof(TextureNames[0]);
+
+	//Indices into TextureNames of the fetches made in one frame (scene models, sky, lights and a post-process)
+	const int FrameFetches[] = { 2, 1, 1, 3, 6, 7, 8, 0, 5, 9, 13, 12, 10, 11, 11 };
+	const int NumFetches = sizeof(FrameFetches) / sizeof(FrameFetches[0]);
+
+	//The lookup as the old CResourceManager::getTexture did it
+	FakeTexture* LegacyGet(std::map<wchar_t*, FakeTexture*>& map, const wchar_t* uid)
+	{
+		if (map.find(const_cast<wchar_t*>(uid)) != map.end())
+		{
+			return map.at(const_cast<wchar_t*>(uid));
+		}
+		return map.at(const_cast<wchar_t*>(TextureNames[0]));
+	}
+}
+
+int RunLookupBenchmark(const CommandArgs& args)
+{
+	const long long frames = GetOption(args, "--frames", 1000000LL);
+
+	FakeTexture textures[NumTextures];
+	std::map<wchar_t*, FakeTexture*> legacyMap;
+	CResourceRegistry<TextureHandle, FakeTexture*> registry;
+	TextureHandle handles[NumTextures];
+
+	for (int i = 0; i < NumTextures; ++i)
+	{
+		textures[i].id = i;
+		legacyMap.insert(std::make_pair(const_cast<wchar_t*>(TextureNames[i]), &textures[i]));
+		handles[i] = registry.Intern(TextureNames[i]);
+		registry.Set(handles[i], &textures[i]);
+	}
+
+	//Sum the ids fetched so the compiler cannot remove the lookups, and to check every method finds the same textures
+	volatile uint64_t sink = 0;
+	uint64_t legacySum = 0, nameSum = 0, handleSum = 0;
+
+	double legacyTime = MeasureSeconds([&]()
+	{
+		for (long long frame = 0; frame < frames; ++frame)
+			for (int fetch : FrameFetches) legacySum += LegacyGet(legacyMap, TextureNames[fetch])->id;
+		sink = legacySum;
+	});
+
+	double nameTime = MeasureSeconds([&]()
+	{
+		for (long long frame = 0; frame < frames; ++frame)
+			for (int fetch : FrameFetches) nameSum += registry.Get(registry.Find(TextureNames[fetch]))->id;
+		sink = nameSum;
+	});
+
+	double handleTime = MeasureSeconds([&]()
+	{
+		for (long long frame = 0; frame < frames; ++frame)
+			for (int fetch : FrameFetches) handleSum += registry.Get(handles[fetch])->id;
+		sink = handleSum;
+	});
+
+	if (legacySum != nameSum || legacySum != handleSum)
+	{
+		printf("Lookup results differ between methods\n");
+		return 1;
+	}
+
+	const double lookups = static_cast<double>(frames) * NumFetches;
+	printf("%lld frames x %d lookups\n", frames, NumFetches);
+	printf("  %-28s %8.2f ns/lookup  %8.3f us/frame\n", "pointer-keyed map (find+at)", legacyTime * 1e9 / lookups, legacyTime * 1e6 / frames);
+	printf("  %-28s %8.2f ns/lookup  %8.3f us/frame\n", "registry by name",            nameTime   * 1e9 / lookups, nameTime   * 1e6 / frames);
+	printf("  %-28s %8.2f ns/lookup  %8.3f us/frame\n", "registry by handle",          handleTime * 1e9 / lookups, handleTime * 1e6 / frames);
+	return 0;
+}
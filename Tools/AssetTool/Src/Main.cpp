@@ -0,0 +1,74 @@
+//--------------------------------------------------------------------------------------
+// Command line tool for preparing and benchmarking the assets used by PostProcessing
+//--------------------------------------------------------------------------------------
+// Usage: AssetTool <command> [options]
+
+#include "Commands.h"
+
+#include <cstdio>
+#include <cstring>
+
+struct Command
+{
+	const char* name;
+	const char* description;
+	int (*run)(const CommandArgs& args);
+};
+
+static const Command Commands[] =
+{
+	{ "lookup-bench", "Compare resource lookup by name against lookup by handle [--frames N]", RunLookupBenchmark },
+	{ "budget-sim",   "Check the memory budget's eviction policy with a mock allocator [--resources N --frames N --window N --budget-mb N]", RunBudgetSimulation },
+	{ "dedup-report", "Find files with identical contents and the bytes sharing them saves [--dir PATH --verbose]", RunDedupReport },
+	{ "pack",         "Build an asset pack [--dir PATH --out FILE --include Data,Media --compress --block-kb N]", RunPackAssets },
+	{ "pack-bench",   "Compare loading every file in a pack from loose files and from the pack [--dir PATH --pack FILE --repeat N]", RunPackBenchmark },
+	{ "image-bench",  "Time decoding the DDS, PNG and JPEG files and BC blocks on the CPU [--dir PATH --repeat N --threads N --bc-size N]", RunImageBenchmark },
+	{ "compress-media", "Compress the PNG and JPEG media to DDS files with mips [--dir PATH --threads N --fast --bc4 AlphaMap,Noise --bc5 Distort]", RunCompressMedia },
+	{ "mip-bench",    "Time generating mip chains with each filter [--file PATH --size N --repeat N --threads N]", RunMipBenchmark },
+	{ "stream-sim",   "Check the texture streaming scheduler with a mock uploader [--textures N --frames N --budget-kb N --evict-every N]", RunStreamingSimulation },
+	{ "atlas",        "Pack the polygon masks into one atlas texture [--dir PATH --gutter N --max-size N --sdf N --threads N --fast]", RunAtlasBuilder },
+	{ "sdf-masks",    "Convert the *AlphaMap.png masks to signed distance fields [--dir PATH --size N --spread N --threads N]", RunSDFMasks },
+	{ "pixel-formats", "Check the pixel format conversions and time them in GB/s [--stride N --pixels N --repeat N]", RunPixelFormatBenchmark },
+	{ "cpu-post-bench", "Check the CPU post-processes and time them at 1268x960 and 4K [--dir PATH --threads N --repeat N]", RunCPUPostProcessBenchmark },
+	{ "cpu-chain-bench", "Check and time chains of CPU post-processes fused a tile at a time [--dir PATH --threads N --repeat N]", RunCPUPostProcessChainBenchmark },
+	{ "cpu-polygon-bench", "Check and time the CPU post-processes drawn over polygons in perspective [--dir PATH --threads N --repeat N]", RunCPUPostProcessPolygonBenchmark },
+	{ "cpu-remap-bench", "Check and time the geometric CPU post-processes with baked uv offset maps [--dir PATH --threads N --repeat N]", RunCPUPostProcessRemapBenchmark },
+	{ "cpu-pixelation-bench", "Check and time pixelating by averaging each block across the pixel sizes [--dir PATH --frames N --threads N --repeat N]", RunCPUPixelationBenchmark },
+	{ "blur-bench",   "Check the box Gaussian blur against convolution and time it by sigma [--width N --height N --threads N --repeat N]", RunBlurBenchmark },
+	{ "blur-kernel",  "Check the blur shaders' linear-sampling taps against convolution [--taps N --width N --height N --sigma S --out FILE]", RunBlurKernelCheck },
+	{ "colour-lut-bench", "Bake the effects' colour maps into lookup tables, check them and time grading [--width N --height N --range R --threads N --repeat N]", RunColourLUTBenchmark },
+	{ "palette-bench", "Quantize to the palettes with each dither, check them and report quality and speed [--dir DIR --lut N --threads N --repeat N]", RunPaletteBenchmark },
+	{ "blue-noise",   "Make blue noise tiles for the film grain, check them and time each size [--max N --channels N --threads N --repeat N --out DIR]", RunBlueNoiseBenchmark },
+	{ "instance-check", "Check batching models for instanced drawing against grouping them directly [--trials N --models N]", RunInstanceBatcherCheck },
+};
+
+static void PrintUsage()
+{
+	printf("Usage: AssetTool <command> [options]\n\nCommands:\n");
+	for (auto& command : Commands)
+	{
+		printf("  %-16s %s\n", command.name, command.description);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	for (auto& command : Commands)
+	{
+		if (strcmp(argv[1], command.name) == 0)
+		{
+			CommandArgs args(argv + 2, argv + argc);
+			return command.run(args);
+		}
+	}
+
+	printf("Unknown command '%s'\n\n", argv[1]);
+	PrintUsage();
+	return 1;
+}
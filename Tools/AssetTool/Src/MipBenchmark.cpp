@@ -0,0 +1,97 @@
+//--------------------------------------------------------------------------------------
+// Benchmarking mip generation
+//--------------------------------------------------------------------------------------
+// "mip-bench" times making the full mip chain of a large image (4096x4096 by default, or a file
+// given with --file) with each filter: in plain C++ on one thread, with SSE on one thread and with
+// SSE across a thread pool. Rates are of top mip pixels. The generated image is random, which is
+// the worst case for nothing but the cache, as every filter reads each pixel the same way.
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Utility/CThreadPool.h"
+#include "Utility/ImageDecoders.h"
+#include "Utility/MipGeneration.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+namespace
+{
+	//Fastest of several runs of a function
+	template<typename Function>
+	double BestSeconds(long long repeats, Function function)
+	{
+		double best = 1e30;
+		for (long long r = 0; r < repeats; ++r) best = std::min(best, MeasureSeconds(function));
+		return best;
+	}
+}
+
+int RunMipBenchmark(const CommandArgs& args)
+{
+	const std::string file = GetOption(args, "--file", std::string());
+	const long long size = GetOption(args, "--size", 4096LL);
+	const long long repeats = std::max(1LL, GetOption(args, "--repeat", 3LL));
+	const long long threadCount = GetOption(args, "--threads", static_cast<long long>(CThreadPool::DefaultThreadCount(0)));
+
+	if (threadCount < 1 || threadCount > 256 || size < 1 || size > 16384)
+	{
+		printf("--threads must be between 1 and 256 and --size between 1 and 16384\n");
+		return 1;
+	}
+	CThreadPool threads(static_cast<unsigned int>(threadCount));
+
+	CImage image;
+	if (!file.empty())
+	{
+		std::ifstream stream(file, std::ios::binary);
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+		std::string error;
+		if (!DecodeImage(data.data(), data.size(), image, error, &threads))
+		{
+			printf("Cannot decode %s: %s\n", file.c_str(), error.empty() ? "cannot read file" : error.c_str());
+			return 1;
+		}
+	}
+	else
+	{
+		image.Create(ImageFormat::RGBA8, static_cast<uint32_t>(size), static_cast<uint32_t>(size));
+		std::mt19937 random(1234);
+		uint8_t* data = image.GetData();
+		for (size_t i = 0; i < image.GetSize(); ++i) data[i] = static_cast<uint8_t>(random());
+	}
+
+	printf("Mip chain of a %ux%u image (%u mips), best of %lld runs\n\n", image.GetWidth(), image.GetHeight(),
+		CImage::CountMips(image.GetWidth(), image.GetHeight()), repeats);
+	printf("%-24s %12s %12s %12s %14s\n", "Filter", "C++ ms", "SSE ms", "SSE N ms", "MPixel/s (N)");
+	double pixels = static_cast<double>(image.GetWidth()) * image.GetHeight();
+	struct Case { const char* name; MipFilter filter; bool sRGB; bool coverage; };
+	const Case cases[] =
+	{
+		{ "Box",                    MipFilter::Box,     true,  false },
+		{ "Box, no sRGB",           MipFilter::Box,     false, false },
+		{ "Kaiser",                 MipFilter::Kaiser,  true,  false },
+		{ "Lanczos",                MipFilter::Lanczos, true,  false },
+		{ "Kaiser, alpha coverage", MipFilter::Kaiser,  true,  true  },
+	};
+	for (auto& test : cases)
+	{
+		MipOptions options;
+		options.filter = test.filter;
+		options.sRGB = test.sRGB;
+		options.preserveCoverage = test.coverage;
+
+		CImage mips;
+		options.useSIMD = false;
+		double plain = BestSeconds(repeats, [&]() { GenerateMips(image, mips, options); });
+		options.useSIMD = true;
+		double simd = BestSeconds(repeats, [&]() { GenerateMips(image, mips, options); });
+		double pooled = BestSeconds(repeats, [&]() { GenerateMips(image, mips, options, &threads); });
+		printf("%-24s %12.1f %12.1f %12.1f %14.1f\n", test.name, plain * 1000.0, simd * 1000.0, pooled * 1000.0, pixels / pooled * 1e-6);
+	}
+	printf("\nN = %lld threads\n", threadCount);
+	return 0;
+}
@@ -0,0 +1,177 @@
+//--------------------------------------------------------------------------------------
+// Building asset packs and comparing them with loose files
+//--------------------------------------------------------------------------------------
+// "pack" stores every file under the given folders in a single CAssetPack, named by their path
+// relative to the base directory (e.g. "Data/CargoA.dds") as the scene asks for them. Files are
+// stored uncompressed unless asked, so loading them is zero-copy. Compression shrinks the
+// assets by about a fifth, which pays off when they come from a slow disk rather than the OS cache.
+// "pack-bench" times getting every file in a pack ready for decoding: from the loose files with
+// buffered reads (open, read and hash, as CResourceManager did before CFileCache), from the loose
+// files through CFileCache (mapped), and from the pack through CFileCache (looked up and
+// unpacked). The data is touched once in each case, as a decoder would.
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Utility/CAssetPack.h"
+#include "Utility/CContentHash.h"
+#include "Utility/CFileCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <sstream>
+
+namespace
+{
+	//Split a comma separated list
+	std::vector<std::string> SplitList(const std::string& list)
+	{
+		std::vector<std::string> items;
+		std::stringstream stream(list);
+		std::string item;
+		while (std::getline(stream, item, ','))
+		{
+			if (!item.empty()) items.push_back(item);
+		}
+		return items;
+	}
+}
+
+int RunPackAssets(const CommandArgs& args)
+{
+	namespace fs = std::filesystem;
+	const std::string directory = GetOption(args, "--dir", std::string("PostProcessing"));
+	const std::string output = GetOption(args, "--out", directory + "/Assets.pak");
+	const std::vector<std::string> folders = SplitList(GetOption(args, "--include", std::string("Data,Media")));
+	const bool compress = HasFlag(args, "--compress");
+	const long long blockKB = GetOption(args, "--block-kb", 256LL);
+
+	if (blockKB <= 0 || blockKB > 1024 * 1024)
+	{
+		printf("--block-kb must be between 1 and 1048576\n");
+		return 1;
+	}
+
+	//Sort the files so the same folders always give the same pack
+	std::vector<fs::path> files;
+	for (auto& folder : folders)
+	{
+		std::error_code error;
+		for (auto& entry : fs::recursive_directory_iterator(fs::path(directory) / folder, error))
+		{
+			if (entry.is_regular_file() && entry.file_size() > 0) files.push_back(entry.path());
+		}
+		if (error)
+		{
+			printf("Cannot read folder %s: %s\n", (fs::path(directory) / folder).string().c_str(), error.message().c_str());
+			return 1;
+		}
+	}
+	std::sort(files.begin(), files.end());
+
+	CAssetPackWriter writer(static_cast<uint32_t>(blockKB * 1024));
+	for (auto& file : files)
+	{
+		writer.Add(fs::relative(file, directory).generic_string(), file.string(), compress);
+	}
+
+	CAssetPackWriter::Stats stats;
+	std::string error;
+	double seconds = MeasureSeconds([&]() { writer.Write(output, error, &stats); });
+	if (!error.empty())
+	{
+		printf("%s\n", error.c_str());
+		return 1;
+	}
+
+	const double MB = 1.0 / (1024.0 * 1024.0);
+	printf("Packed %u files (%u compressed) into %s in %.1f ms\n", stats.files, stats.compressed, output.c_str(), seconds * 1000.0);
+	printf("%.2f MB of files, %.2f MB pack (%.1f%%)\n", stats.originalBytes * MB, stats.packBytes * MB,
+		stats.originalBytes > 0 ? 100.0 * stats.packBytes / stats.originalBytes : 0.0);
+	return 0;
+}
+
+int RunPackBenchmark(const CommandArgs& args)
+{
+	const std::string directory = GetOption(args, "--dir", std::string("PostProcessing"));
+	const std::string packFile = GetOption(args, "--pack", directory + "/Assets.pak");
+	const long long repeats = std::max(1LL, GetOption(args, "--repeat", 5LL));
+
+	CAssetPack pack;
+	if (!pack.Open(packFile))
+	{
+		printf("Cannot open pack %s, build one with the pack command\n", packFile.c_str());
+		return 1;
+	}
+
+	//The names of the files to load, as the scene asks for them
+	std::vector<std::string> names;
+	for (uint32_t i = 0; i < pack.GetEntryCount(); ++i) names.push_back(pack.GetName(pack.GetEntry(i)));
+	pack.Close();
+
+	//Keep the fastest of several runs, both take their data from the OS file cache after the first
+	double bestLoose = 1e30, bestMapped = 1e30, bestPacked = 1e30;
+	FileCacheStats mappedStats;
+	uint64_t bytes = 0, checksum = 0;
+	bool failed = false;
+	for (long long r = 0; r < repeats; ++r)
+	{
+		bestLoose = std::min(bestLoose, MeasureSeconds([&]()
+		{
+			std::vector<uint8_t> contents;
+			bytes = 0;
+			for (auto& name : names)
+			{
+				uint64_t hash, size;
+				if (!CContentHash::HashFile(directory + "/" + name, hash, size, &contents)) failed = true;
+				checksum += hash;
+				bytes += size;
+			}
+		}));
+
+		bestMapped = std::min(bestMapped, MeasureSeconds([&]()
+		{
+			//Opening a file in the cache maps and hashes it
+			CFileCache cache;
+			for (auto& name : names)
+			{
+				std::shared_ptr<const CachedFile> file = cache.Open(directory + "/" + name);
+				if (!file) { failed = true; continue; }
+				checksum += file->hash;
+			}
+			mappedStats = cache.GetStats();
+		}));
+
+		bestPacked = std::min(bestPacked, MeasureSeconds([&]()
+		{
+			CAssetPack timedPack;
+			if (!timedPack.Open(packFile)) { failed = true; return; }
+
+			CFileCache cache(&timedPack);
+			for (auto& name : names)
+			{
+				std::shared_ptr<const CachedFile> file = cache.Open(name);
+				if (!file || !file->fromPack) { failed = true; continue; }
+
+				//Compare with the table's hash rather than just touching the bytes, the pack must match the loose files
+				if (CContentHash::Hash(file->contents.data, file->contents.size) != file->hash) failed = true;
+				checksum += file->hash;
+			}
+		}));
+	}
+
+	if (failed)
+	{
+		printf("FAILED: the pack does not match the loose files in %s\n", directory.c_str());
+		return 1;
+	}
+
+	const double MB = 1.0 / (1024.0 * 1024.0);
+	printf("%zu files, %.2f MB, best of %lld runs (checksum %016llx)\n", names.size(), bytes * MB, repeats,
+		static_cast<unsigned long long>(checksum));
+	printf("  loose files, read:   %8.2f ms\n", bestLoose * 1000.0);
+	printf("  loose files, mapped: %8.2f ms (%.2fx), %llu OS calls\n", bestMapped * 1000.0, bestMapped > 0 ? bestLoose / bestMapped : 0.0,
+		static_cast<unsigned long long>(mappedStats.osCalls));
+	printf("  pack:                %8.2f ms (%.2fx), 4 OS calls\n", bestPacked * 1000.0, bestPacked > 0 ? bestLoose / bestPacked : 0.0);
+	return 0;
+}
@@ -0,0 +1,186 @@
+//--------------------------------------------------------------------------------------
+// Checking and timing quantizing to a palette
+//--------------------------------------------------------------------------------------
+// "palette-bench" quantizes a smooth ramp of colours - red across, green down and blue the
+// other way - to each built-in palette (see Utility/Palette.h), at the app's resolution
+// (1268x960) and at 4K (3840x2160). It:
+// - builds each palette's table of nearest colours at several sizes, checks building it across
+//   the pool gives the same table as on one thread, and reports the time taken and the share of
+//   the ramp's pixels whose entry holds a different colour than searching the palette gives
+// - quantizes the ramp with each dither, the blue-noise one thresholding from the grain's 64x64
+//   tile in the media folder, checking the pool gives identical results to one thread
+//   - for Floyd-Steinberg, that the wavefront matches diffusing one row after another
+// - reports each dither's RMS difference from the ramp, as drawn and after a Gaussian blur of
+//   1.5 pixels standing in for the eye mixing neighbouring pixels, where dithering should bring
+//   the quantized colours back close to the ramp, and its rate in megapixels per second on one
+//   thread and across the pool
+// Any check failing fails the command.
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Utility/BlueNoise.h"
+#include "Utility/CThreadPool.h"
+#include "Utility/GaussianBlur.h"
+#include "Utility/Palette.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	//Fastest of several runs of a function
+	template<typename Function>
+	double BestSeconds(long long repeats, Function function)
+	{
+		double best = 1e30;
+		for (long long r = 0; r < repeats; ++r) best = std::min(best, MeasureSeconds(function));
+		return best;
+	}
+
+	//Red across, green down and blue the other way, each 0->1
+	void RampScene(CImage& scene, uint32_t width, uint32_t height)
+	{
+		scene.Create(ImageFormat::RGBA32F, width, height);
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			float* pixel = reinterpret_cast<float*>(scene.GetRow(0, y));
+			for (uint32_t x = 0; x < width; ++x, pixel += 4)
+			{
+				float u = (x + 0.5f) / width, v = (y + 0.5f) / height;
+				pixel[0] = u;
+				pixel[1] = v;
+				pixel[2] = 1.0f - 0.5f * (u + v);
+				pixel[3] = 1.0f;
+			}
+		}
+	}
+
+	//RMS difference of the red, green and blue of two images
+	double RMSDifference(const CImage& a, const CImage& b)
+	{
+		const float* first = reinterpret_cast<const float*>(a.GetData());
+		const float* second = reinterpret_cast<const float*>(b.GetData());
+		const size_t pixels = a.GetSize() / (4 * sizeof(float));
+		double total = 0.0;
+		for (size_t p = 0; p < pixels; ++p)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				double difference = static_cast<double>(first[p * 4 + c]) - second[p * 4 + c];
+				total += difference * difference;
+			}
+		}
+		return pixels ? std::sqrt(total / (pixels * 3)) : 0.0;
+	}
+
+	bool SameImage(const CImage& a, const CImage& b)
+	{
+		return a.GetSize() == b.GetSize() && std::memcmp(a.GetData(), b.GetData(), a.GetSize()) == 0;
+	}
+}
+
+int RunPaletteBenchmark(const CommandArgs& args)
+{
+	const fs::path  media       = fs::path(GetOption(args, "--dir", std::string("PostProcessing"))) / "Media";
+	const long long repeats     = std::max(1LL, GetOption(args, "--repeat", 3LL));
+	const long long lutSize     = GetOption(args, "--lut", 32LL);
+	const long long threadCount = GetOption(args, "--threads", static_cast<long long>(CThreadPool::DefaultThreadCount(0)));
+
+	if (threadCount < 1 || threadCount > 256 || lutSize < MinPaletteLUTSize || lutSize > MaxPaletteLUTSize)
+	{
+		printf("--threads must be between 1 and 256 and --lut between %u and %u\n", MinPaletteLUTSize, MaxPaletteLUTSize);
+		return 1;
+	}
+	DitherTile tile;
+	const fs::path tileFile = media / GetBlueNoiseFileName(64, 1);
+	if (!LoadDitherTile(tileFile.string(), tile))
+	{
+		printf("FAILED: cannot read the dither tile %s\n", tileFile.string().c_str());
+		return 1;
+	}
+	CThreadPool threads(static_cast<unsigned int>(threadCount));
+	const std::vector<Palette>& palettes = GetBuiltInPalettes();
+
+	//The tables against searching the palette for each pixel of the ramp
+	{
+		CImage ramp;
+		RampScene(ramp, 1268, 960);
+		const float* pixels = reinterpret_cast<const float*>(ramp.GetData());
+		const size_t pixelCount = ramp.GetSize() / (4 * sizeof(float));
+
+		printf("Tables of nearest colours over a 1268x960 ramp, best of %lld runs on %lld threads\n\n", repeats, threadCount);
+		printf("%-10s %4s %8s %10s %10s\n", "Palette", "Size", "KB", "Build ms", "Off");
+		for (const Palette& palette : palettes)
+		{
+			std::vector<uint32_t> nearest(pixelCount);
+			for (size_t p = 0; p < pixelCount; ++p) nearest[p] = FindNearestPaletteColour(palette, pixels + p * 4);
+
+			for (uint32_t size : { 16u, 32u, 64u })
+			{
+				PaletteLUT plain, pooled;
+				if (!BuildPaletteLUT(palette, size, plain) || !BuildPaletteLUT(palette, size, pooled, &threads) || plain.indices != pooled.indices)
+				{
+					printf("FAILED: building the %s table across the pool differs from one thread\n", palette.name);
+					return 1;
+				}
+				double buildSeconds = BestSeconds(repeats, [&]() { BuildPaletteLUT(palette, size, pooled, &threads); });
+
+				size_t off = 0;
+				for (size_t p = 0; p < pixelCount; ++p)
+				{
+					if (LookupPaletteLUT(plain, pixels + p * 4) != nearest[p]) ++off;
+				}
+				printf("%-10s %4u %8.1f %10.2f %9.2f%%\n", palette.name, size, plain.GetSize() / 1024.0, buildSeconds * 1e3,
+					off * 100.0 / pixelCount);
+			}
+		}
+		printf("\n");
+	}
+
+	const DitherMode modes[] = { DitherMode::None, DitherMode::Bayer, DitherMode::InterleavedGradient, DitherMode::BlueNoise,
+	                            DitherMode::FloydSteinberg };
+	struct Size { uint32_t width, height; };
+	const Size sizes[] = { { 1268, 960 }, { 3840, 2160 } };
+	for (auto& size : sizes)
+	{
+		CImage scene, blurredScene;
+		RampScene(scene, size.width, size.height);
+		GaussianBlur(scene, blurredScene, 1.5f, &threads);
+		const double pixelCount = static_cast<double>(size.width) * size.height;
+
+		printf("%ux%u ramp, tables of %lld entries a side, best of %lld runs\n", size.width, size.height, lutSize, repeats);
+		printf("%-10s %-19s %10s %12s %14s %14s\n", "Palette", "Dither", "RMS", "Blurred RMS", "1 MPixel/s", "N MPixel/s");
+		for (const Palette& palette : palettes)
+		{
+			PaletteLUT lut;
+			BuildPaletteLUT(palette, static_cast<uint32_t>(lutSize), lut, &threads);
+			const float spread = GetPaletteSpread(palette);
+			for (DitherMode mode : modes)
+			{
+				CImage plain, pooled, blurred;
+				if (!QuantizeToPalette(palette, lut, mode, spread, scene, plain, nullptr, &tile) ||
+				    !QuantizeToPalette(palette, lut, mode, spread, scene, pooled, &threads, &tile) || !SameImage(plain, pooled))
+				{
+					printf("FAILED: quantizing to %s with %s across the pool differs from one thread\n", palette.name, GetDitherModeName(mode));
+					return 1;
+				}
+				GaussianBlur(pooled, blurred, 1.5f, &threads);
+
+				CImage target;
+				double plainSeconds = BestSeconds(repeats, [&]() { QuantizeToPalette(palette, lut, mode, spread, scene, target, nullptr, &tile); });
+				double pooledSeconds = BestSeconds(repeats, [&]() { QuantizeToPalette(palette, lut, mode, spread, scene, target, &threads, &tile); });
+				printf("%-10s %-19s %10.4f %12.4f %14.1f %14.1f\n", palette.name, GetDitherModeName(mode), RMSDifference(pooled, scene),
+					RMSDifference(blurred, blurredScene), pixelCount / plainSeconds * 1e-6, pixelCount / pooledSeconds * 1e-6);
+			}
+		}
+		printf("\n");
+	}
+	printf("Off is the share of the ramp's pixels whose table entry holds another colour than searching the palette. The blurred\n"
+	       "RMS is after blurring both the result and the ramp, as the eye mixes neighbouring pixels - lower is closer to the ramp\n");
+	return 0;
+}
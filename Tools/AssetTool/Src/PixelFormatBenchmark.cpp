@@ -0,0 +1,353 @@
+//--------------------------------------------------------------------------------------
+// Checking and timing the pixel format conversions
+//--------------------------------------------------------------------------------------
+// "pixel-formats" first checks every conversion in PixelConversion.h, exhaustively where the
+// input has 16 bits or fewer and across all 2^32 bit patterns at --stride otherwise (--stride 1
+// checks every float):
+// - every half float converts to a float and back unchanged, with F16C and without
+// - floats convert to the same half with F16C as without
+// - every sRGB byte converts to linear and back unchanged, and linear values in 0->1 convert to
+//   within one step of the exact sRGB byte, with SSE2 and without
+// - every R11G11B10 channel value unpacks and packs back unchanged, and floats pack to the nearest
+//   channel value
+// - RGB9E5 values unpack to colours that pack back to themselves
+// - swapping red and blue with SSE2 matches the general swizzle
+// Any failure prints the first bad value and fails the command. The conversions of --pixels
+// values are then timed with and without SIMD, as GB/s of input and output together.
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Utility/PixelConversion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const size_t Batch = 1 << 20;
+
+	uint32_t FloatBits(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	float BitsFloat(uint32_t bits)
+	{
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	//Fastest of several runs of a function
+	template<typename Function>
+	double BestSeconds(long long repeats, Function function)
+	{
+		double best = 1e30;
+		for (long long r = 0; r < repeats; ++r) best = std::min(best, MeasureSeconds(function));
+		return best;
+	}
+
+	//Call a function with batches of the 32-bit patterns 0, stride, 2 * stride... up to 2^32
+	void ForEachPattern(uint64_t stride, const std::function<bool(const std::vector<uint32_t>&)>& function)
+	{
+		std::vector<uint32_t> patterns;
+		patterns.reserve(Batch);
+		for (uint64_t bits = 0; bits < (1ull << 32); bits += stride)
+		{
+			patterns.push_back(static_cast<uint32_t>(bits));
+			if (patterns.size() == Batch)
+			{
+				if (!function(patterns)) return;
+				patterns.clear();
+			}
+		}
+		if (!patterns.empty()) function(patterns);
+	}
+
+
+	//-------------------------------------
+	// Checks
+	//-------------------------------------
+
+	bool CheckHalfFloats(uint64_t stride)
+	{
+		//Every half to float and back. Signalling NaNs come back quiet
+		std::vector<uint16_t> halves(65536), back(65536);
+		std::vector<float> floats(65536), simdFloats(65536);
+		for (uint32_t h = 0; h < 65536; ++h) halves[h] = static_cast<uint16_t>(h);
+		ConvertF16ToF32(halves.data(), floats.data(), halves.size(), false);
+		ConvertF16ToF32(halves.data(), simdFloats.data(), halves.size(), true);
+		ConvertF32ToF16(floats.data(), back.data(), floats.size(), false);
+		for (uint32_t h = 0; h < 65536; ++h)
+		{
+			bool nan = (h & 0x7c00) == 0x7c00 && (h & 0x3ff) != 0;
+			uint16_t expected = static_cast<uint16_t>(nan ? h | 0x200 : h);
+			if (FloatBits(floats[h]) != FloatBits(simdFloats[h]) || back[h] != expected)
+			{
+				printf("Half 0x%04x converts to float 0x%08x (F16C 0x%08x) and back to 0x%04x\n", h, FloatBits(floats[h]), FloatBits(simdFloats[h]), back[h]);
+				return false;
+			}
+		}
+
+		//Floats to halves with and without F16C
+		bool passed = true;
+		std::vector<float> input(Batch);
+		std::vector<uint16_t> scalar(Batch), simd(Batch);
+		ForEachPattern(stride, [&](const std::vector<uint32_t>& patterns)
+		{
+			std::memcpy(input.data(), patterns.data(), patterns.size() * sizeof(float));
+			ConvertF32ToF16(input.data(), scalar.data(), patterns.size(), false);
+			ConvertF32ToF16(input.data(), simd.data(), patterns.size(), true);
+			for (size_t i = 0; i < patterns.size(); ++i)
+			{
+				if (scalar[i] != simd[i])
+				{
+					printf("Float 0x%08x converts to half 0x%04x, with F16C 0x%04x\n", patterns[i], scalar[i], simd[i]);
+					return passed = false;
+				}
+			}
+			return true;
+		});
+		return passed;
+	}
+
+	bool CheckSRGB(uint64_t stride, double& mismatches, int& worst)
+	{
+		for (int b = 0; b < 256; ++b)
+		{
+			uint8_t byte = static_cast<uint8_t>(b);
+			if (LinearToSRGB(SRGBToLinear(byte)) != byte)
+			{
+				printf("sRGB %d converts to linear %g and back to %d\n", b, SRGBToLinear(byte), LinearToSRGB(SRGBToLinear(byte)));
+				return false;
+			}
+		}
+
+		//Every float from 0 to 1 at the stride, against the exact curve
+		const uint32_t one = FloatBits(1.0f);
+		std::vector<float> values;
+		std::vector<uint8_t> scalar(Batch), simd(Batch);
+		uint64_t count = 0, wrong = 0;
+		worst = 0;
+		for (uint64_t bits = 0; bits <= one; bits += stride)
+		{
+			values.push_back(BitsFloat(static_cast<uint32_t>(bits)));
+			if (values.size() < Batch && bits + stride <= one) continue;
+
+			ConvertLinearToSRGB8(values.data(), scalar.data(), values.size(), false);
+			ConvertLinearToSRGB8(values.data(), simd.data(), values.size(), true);
+			for (size_t i = 0; i < values.size(); ++i)
+			{
+				double x = values[i];
+				double exact = (x <= 0.0031308 ? x * 12.92 : 1.055 * std::pow(x, 1.0 / 2.4) - 0.055) * 255.0 + 0.5;
+				int error = std::abs(static_cast<int>(scalar[i]) - static_cast<int>(std::floor(exact)));
+				if (scalar[i] != simd[i] || error > 1)
+				{
+					printf("Linear %.9g converts to sRGB %d, with SSE2 %d, exactly %.3f\n", x, scalar[i], simd[i], exact - 0.5);
+					return false;
+				}
+				worst = std::max(worst, error);
+				wrong += error != 0;
+			}
+			count += values.size();
+			values.clear();
+		}
+		mismatches = static_cast<double>(wrong) / count;
+		return true;
+	}
+
+	bool CheckR11G11B10(uint64_t stride)
+	{
+		//Every value of each channel, with the other two at zero. NaNs only need to stay NaN
+		const uint32_t shifts[3] = { 0, 11, 22 }, bitCounts[3] = { 11, 11, 10 };
+		for (int channel = 0; channel < 3; ++channel)
+		{
+			for (uint32_t value = 0; value < (1u << bitCounts[channel]); ++value)
+			{
+				float rgb[3];
+				UnpackR11G11B10(value << shifts[channel], rgb);
+				uint32_t back = PackR11G11B10(rgb[0], rgb[1], rgb[2]) >> shifts[channel];
+				if (back != value && !(std::isnan(rgb[channel]) && (back >> (bitCounts[channel] - 5)) == 31 && (back & ((1u << (bitCounts[channel] - 5)) - 1))))
+				{
+					printf("R11G11B10 channel %d value 0x%03x unpacks to %g and packs back to 0x%03x\n", channel, value, rgb[channel], back);
+					return false;
+				}
+			}
+		}
+
+		//Positive finite floats at the stride pack to the nearest value (red for 6 mantissa bits, blue for 5), or to the
+		//largest value above it
+		bool passed = true;
+		ForEachPattern(stride, [&](const std::vector<uint32_t>& patterns)
+		{
+			for (uint32_t bits : patterns)
+			{
+				float x = BitsFloat(bits);
+				if (!(x >= 0.0f) || std::isinf(x)) continue;
+				for (int channel : { 0, 2 })
+				{
+					float input[3] = { 0, 0, 0 }, rgb[3];
+					input[channel] = x;
+					uint32_t value = PackR11G11B10(input[0], input[1], input[2]) >> shifts[channel];
+					const uint32_t largest = (30u << (bitCounts[channel] - 5)) | ((1u << (bitCounts[channel] - 5)) - 1);
+					UnpackR11G11B10(value << shifts[channel], rgb);
+					double error = std::abs(static_cast<double>(x) - rgb[channel]);
+					for (uint32_t neighbour : { value - 1, value + 1 })
+					{
+						if (neighbour > largest) continue; // Includes 0 - 1
+						float other[3];
+						UnpackR11G11B10(neighbour << shifts[channel], other);
+						if (std::abs(static_cast<double>(x) - other[channel]) < error)
+						{
+							printf("Float %.9g packs to R11G11B10 channel %d value %g, but %g is nearer\n", x, channel, rgb[channel], other[channel]);
+							return passed = false;
+						}
+					}
+				}
+			}
+			return true;
+		});
+		return passed;
+	}
+
+	bool CheckRGB9E5(uint64_t stride)
+	{
+		//Values with large mantissas under a small exponent are not the canonical packing of their colour, so check that the
+		//colour they unpack to survives packing, rather than the value itself
+		bool passed = true;
+		ForEachPattern(stride, [&](const std::vector<uint32_t>& patterns)
+		{
+			for (uint32_t packed : patterns)
+			{
+				float rgb[3], again[3];
+				UnpackRGB9E5(packed, rgb);
+				uint32_t repacked = PackRGB9E5(rgb[0], rgb[1], rgb[2]);
+				UnpackRGB9E5(repacked, again);
+				if (rgb[0] != again[0] || rgb[1] != again[1] || rgb[2] != again[2])
+				{
+					printf("RGB9E5 0x%08x unpacks to (%g, %g, %g) but packs to 0x%08x, (%g, %g, %g)\n", packed, rgb[0], rgb[1], rgb[2], repacked, again[0], again[1], again[2]);
+					return passed = false;
+				}
+			}
+			return true;
+		});
+		return passed;
+	}
+
+	bool CheckSwizzles()
+	{
+		//An odd number of pixels so the SIMD version has a tail to finish, and in place as well
+		std::mt19937 random(1234);
+		std::vector<uint8_t> pixels(1027 * 4), simd(pixels.size()), general(pixels.size()), inPlace;
+		for (auto& byte : pixels) byte = static_cast<uint8_t>(random());
+		const uint8_t order[4] = { 2, 1, 0, 3 };
+		SwapRedBlue(pixels.data(), simd.data(), pixels.size() / 4, true);
+		SwizzleRGBA8(pixels.data(), general.data(), pixels.size() / 4, order);
+		inPlace = pixels;
+		SwapRedBlue(inPlace.data(), inPlace.data(), inPlace.size() / 4, true);
+		for (size_t p = 0; p < pixels.size(); p += 4)
+		{
+			bool swapped = general[p] == pixels[p + 2] && general[p + 1] == pixels[p + 1] && general[p + 2] == pixels[p] && general[p + 3] == pixels[p + 3];
+			if (!swapped || std::memcmp(&simd[p], &general[p], 4) != 0 || std::memcmp(&inPlace[p], &general[p], 4) != 0)
+			{
+				printf("Swapping red and blue of pixel %zu gives different results with SSE2\n", p / 4);
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int RunPixelFormatBenchmark(const CommandArgs& args)
+{
+	const long long stride  = GetOption(args, "--stride", 101LL);
+	const long long count   = GetOption(args, "--pixels", 1LL << 22);
+	const long long repeats = std::max(1LL, GetOption(args, "--repeat", 5LL));
+
+	if (stride < 1 || stride > (1LL << 24) || count < 1 || count > (1LL << 28))
+	{
+		printf("--stride must be between 1 and 2^24 and --pixels between 1 and 2^28\n");
+		return 1;
+	}
+
+	//Checks
+	printf("Checking every 16-bit value, and 32-bit patterns at a stride of %lld (F16C %s)\n", stride, HasF16C() ? "available" : "not available");
+	double srgbMismatches = 0.0;
+	int srgbWorst = 0;
+	const struct { const char* name; std::function<bool()> check; } checks[] =
+	{
+		{ "Half floats",   [&]() { return CheckHalfFloats(stride); } },
+		{ "sRGB",          [&]() { return CheckSRGB(stride, srgbMismatches, srgbWorst); } },
+		{ "R11G11B10",     [&]() { return CheckR11G11B10(stride); } },
+		{ "RGB9E5",        [&]() { return CheckRGB9E5(stride); } },
+		{ "RGBA8 swizzle", [&]() { return CheckSwizzles(); } },
+	};
+	for (auto& check : checks)
+	{
+		bool passed = false;
+		double seconds = MeasureSeconds([&]() { passed = check.check(); });
+		if (!passed)
+		{
+			printf("%s: FAILED\n", check.name);
+			return 1;
+		}
+		printf("  %-14s passed in %.2f s\n", check.name, seconds);
+	}
+	printf("Linear to sRGB differs from the exact curve by at most %d step, for %.2f%% of values\n\n", srgbWorst, srgbMismatches * 100.0);
+
+	//Benchmarks, on values in the range each format is used for
+	const size_t n = static_cast<size_t>(count);
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f), hdr(0.0f, 4.0f);
+	std::vector<float> linear(n), colour(n * 3), floats(n * 3);
+	std::vector<uint16_t> halves(n);
+	std::vector<uint8_t> bytes(n * 4), moreBytes(n * 4);
+	std::vector<uint32_t> packed(n);
+	for (auto& value : linear) value = unit(random);
+	for (auto& value : colour) value = hdr(random);
+	for (auto& byte : bytes) byte = static_cast<uint8_t>(random());
+	ConvertF32ToF16(linear.data(), halves.data(), n);
+
+	const struct
+	{
+		const char* name;
+		size_t bytes; // Input and output per value
+		std::function<void(bool)> convert;
+		bool hasSIMD;
+	}
+	tests[] =
+	{
+		{ "F32 -> F16",           6,  [&](bool simd) { ConvertF32ToF16(linear.data(), halves.data(), n, simd); }, true },
+		{ "F16 -> F32",           6,  [&](bool simd) { ConvertF16ToF32(halves.data(), floats.data(), n, simd); }, true },
+		{ "sRGB8 -> linear",      5,  [&](bool)      { ConvertSRGB8ToLinear(bytes.data(), floats.data(), n); }, false },
+		{ "Linear -> sRGB8",      5,  [&](bool simd) { ConvertLinearToSRGB8(linear.data(), moreBytes.data(), n, simd); }, true },
+		{ "RGB -> R11G11B10",     16, [&](bool)      { ConvertRGBToR11G11B10(colour.data(), packed.data(), n); }, false },
+		{ "R11G11B10 -> RGB",     16, [&](bool)      { ConvertR11G11B10ToRGB(packed.data(), floats.data(), n); }, false },
+		{ "RGB -> RGB9E5",        16, [&](bool)      { ConvertRGBToRGB9E5(colour.data(), packed.data(), n); }, false },
+		{ "RGB9E5 -> RGB",        16, [&](bool)      { ConvertRGB9E5ToRGB(packed.data(), floats.data(), n); }, false },
+		{ "RGBA8 <-> BGRA8",      8,  [&](bool simd) { SwapRedBlue(bytes.data(), moreBytes.data(), n, simd); }, true },
+	};
+
+	printf("Converting %lld values (pixels for the packed formats and swizzles), best of %lld runs\n\n", count, repeats);
+	printf("%-18s %12s %12s %9s\n", "Conversion", "Scalar GB/s", "SIMD GB/s", "Speedup");
+	for (auto& test : tests)
+	{
+		double gigabytes = static_cast<double>(n) * test.bytes * 1e-9;
+		double scalar = BestSeconds(repeats, [&]() { test.convert(false); });
+		if (!test.hasSIMD)
+		{
+			printf("%-18s %12.2f %12s %9s\n", test.name, gigabytes / scalar, "-", "-");
+			continue;
+		}
+		double simd = BestSeconds(repeats, [&]() { test.convert(true); });
+		printf("%-18s %12.2f %12.2f %8.1fx\n", test.name, gigabytes / scalar, gigabytes / simd, scalar / simd);
+	}
+	return 0;
+}
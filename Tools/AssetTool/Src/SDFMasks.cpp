@@ -0,0 +1,205 @@
+//--------------------------------------------------------------------------------------
+// Converting the polygon cut-out masks to signed distance fields
+//--------------------------------------------------------------------------------------
+// "sdf-masks" turns each *AlphaMap.png in the Media folder into a small signed distance field,
+// written beside it as <name>SDF.dds (R8 with mips). The scene uses the fields in place of the
+// masks when it finds them, cutting out where the field is above 0.5 rather than where the mask
+// is above 0.1.
+// The distance transform is first checked against a brute force search on a random image, so a
+// fault in the transform fails the command rather than producing slightly wrong fields. For each
+// mask the time to make the field is given on one thread and on the pool, along with how many of
+// the mask's pixels come out on the wrong side of the edge when the field is magnified back to
+// the mask's size, and the memory taken against the mask as RGBA8 and as BC4.
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Utility/CThreadPool.h"
+#include "Utility/DistanceField.h"
+#include "Utility/ImageDecoders.h"
+#include "Utility/ImageEncoders.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+namespace
+{
+	const double KB = 1.0 / 1024.0;
+
+	//Compare the distance transform with a brute force search over every site, on a random image with sparse sites
+	bool CheckDistanceTransform(uint32_t width, uint32_t height, CThreadPool* threads)
+	{
+		std::mt19937 random(1234);
+		std::vector<uint8_t> sites(static_cast<size_t>(width) * height);
+		for (auto& site : sites) site = random() % 50 == 0;
+
+		std::vector<float> distances;
+		ComputeSquaredDistances(sites, width, height, distances, threads);
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				float nearest = FLT_MAX;
+				for (uint32_t sy = 0; sy < height; ++sy)
+				{
+					for (uint32_t sx = 0; sx < width; ++sx)
+					{
+						if (!sites[static_cast<size_t>(sy) * width + sx]) continue;
+						float dx = static_cast<float>(sx) - x, dy = static_cast<float>(sy) - y;
+						nearest = std::min(nearest, dx * dx + dy * dy);
+					}
+				}
+				if (distances[static_cast<size_t>(y) * width + x] != nearest)
+				{
+					printf("Distance transform gives %g at (%u, %u), brute force %g\n", distances[static_cast<size_t>(y) * width + x], x, y, nearest);
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	//Return the fraction of the mask's pixels whose side of the edge differs when the field is sampled bilinearly at them
+	double CountEdgeErrors(const CImage& mask, const CImage& field, float threshold)
+	{
+		const uint32_t width = mask.GetWidth(), height = mask.GetHeight();
+		const uint32_t fieldWidth = field.GetWidth(), fieldHeight = field.GetHeight();
+		uint64_t errors = 0;
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			float fieldY = std::clamp((y + 0.5f) * fieldHeight / height - 0.5f, 0.0f, static_cast<float>(fieldHeight - 1));
+			uint32_t y0 = static_cast<uint32_t>(fieldY), y1 = std::min(y0 + 1, fieldHeight - 1);
+			float fy = fieldY - y0;
+			const uint8_t* row = mask.GetRow(0, y);
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				float fieldX = std::clamp((x + 0.5f) * fieldWidth / width - 0.5f, 0.0f, static_cast<float>(fieldWidth - 1));
+				uint32_t x0 = static_cast<uint32_t>(fieldX), x1 = std::min(x0 + 1, fieldWidth - 1);
+				float fx = fieldX - x0;
+				const uint8_t* row0 = field.GetRow(0, y0);
+				const uint8_t* row1 = field.GetRow(0, y1);
+				float top = row0[x0] + (row0[x1] - row0[x0]) * fx;
+				float bottom = row1[x0] + (row1[x1] - row1[x0]) * fx;
+				bool fieldOutside = (top + (bottom - top) * fy) > 127.5f;
+				bool maskOutside = row[x * 4] > threshold * 255.0f; // Red of RGBA8, as the decoders give
+				if (fieldOutside != maskOutside) ++errors;
+			}
+		}
+		return static_cast<double>(errors) / (static_cast<double>(width) * height);
+	}
+
+	//Return the bytes taken by an image of the given size with a full mip chain, with the given bytes per pixel or per 4x4 block
+	uint64_t MipChainBytes(uint32_t width, uint32_t height, uint32_t bytes, bool blocks)
+	{
+		uint64_t total = 0;
+		for (uint32_t mip = 0; mip < CImage::CountMips(width, height); ++mip)
+		{
+			uint64_t w = std::max(width >> mip, 1u), h = std::max(height >> mip, 1u);
+			total += blocks ? ((w + 3) / 4) * ((h + 3) / 4) * bytes : w * h * bytes;
+		}
+		return total;
+	}
+}
+
+int RunSDFMasks(const CommandArgs& args)
+{
+	namespace fs = std::filesystem;
+	const fs::path  media       = fs::path(GetOption(args, "--dir", std::string("PostProcessing"))) / "Media";
+	const long long size        = GetOption(args, "--size", 128LL);
+	const long long spread      = GetOption(args, "--spread", 8LL);
+	const long long threadCount = GetOption(args, "--threads", static_cast<long long>(CThreadPool::DefaultThreadCount(0)));
+
+	if (size < 4 || size > 4096 || spread < 1 || spread > 256 || threadCount < 1 || threadCount > 256)
+	{
+		printf("--size must be between 4 and 4096, --spread between 1 and 256 and --threads between 1 and 256\n");
+		return 1;
+	}
+	CThreadPool threads(static_cast<unsigned int>(threadCount));
+
+	if (!CheckDistanceTransform(97, 61, &threads))
+	{
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("Distance transform matches brute force\n\n");
+
+	std::vector<fs::path> paths;
+	std::error_code folderError;
+	for (auto& entry : fs::directory_iterator(media, folderError))
+	{
+		std::string name = entry.path().filename().string();
+		if (entry.is_regular_file() && name.size() > 12 && name.compare(name.size() - 12, 12, "AlphaMap.png") == 0) paths.push_back(entry.path());
+	}
+	if (folderError)
+	{
+		printf("Cannot read folder %s: %s\n", media.string().c_str(), folderError.message().c_str());
+		return 1;
+	}
+	std::sort(paths.begin(), paths.end());
+
+	DistanceFieldOptions options;
+	options.width = options.height = static_cast<uint32_t>(size);
+	options.spread = static_cast<float>(spread);
+
+	printf("%-20s %11s %9s %9s %10s %10s %10s %9s\n", "File", "Mask", "1 thread", "Pool ms", "Edge err", "RGBA8 KB", "BC4 KB", "SDF KB");
+	uint64_t totalRGBA = 0, totalBC4 = 0, totalSDF = 0;
+	int failures = 0;
+	for (auto& path : paths)
+	{
+		std::string name = path.filename().string();
+		std::ifstream stream(path, std::ios::binary);
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+		CImage mask, field;
+		std::string error;
+		if (!DecodeImage(data.data(), data.size(), mask, error, &threads))
+		{
+			printf("%-20s %s\n", name.c_str(), error.c_str());
+			++failures;
+			continue;
+		}
+
+		double singleSeconds = MeasureSeconds([&]() { GenerateSignedDistanceField(mask, field, options); });
+		double poolSeconds = MeasureSeconds([&]() { GenerateSignedDistanceField(mask, field, options, &threads); });
+
+		std::vector<uint8_t> file;
+		fs::path output = path;
+		output.replace_extension();
+		output += "SDF.dds";
+		if (field.IsEmpty() || !EncodeDDS(field, file, error))
+		{
+			printf("%-20s %s\n", name.c_str(), error.empty() ? "Unsupported pixel format" : error.c_str());
+			++failures;
+			continue;
+		}
+		std::ofstream out(output, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+		if (!out)
+		{
+			printf("%-20s Cannot write %s\n", name.c_str(), output.string().c_str());
+			++failures;
+			continue;
+		}
+
+		uint64_t rgbaBytes = MipChainBytes(mask.GetWidth(), mask.GetHeight(), 4, false);
+		uint64_t bc4Bytes = MipChainBytes(mask.GetWidth(), mask.GetHeight(), 8, true);
+		char maskSize[32];
+		snprintf(maskSize, sizeof(maskSize), "%ux%u", mask.GetWidth(), mask.GetHeight());
+		printf("%-20s %11s %9.2f %9.2f %9.3f%% %10.1f %10.1f %9.1f\n", name.c_str(), maskSize, singleSeconds * 1000.0, poolSeconds * 1000.0,
+			CountEdgeErrors(mask, field, options.threshold) * 100.0, rgbaBytes * KB, bc4Bytes * KB, field.GetSize() * KB);
+
+		totalRGBA += rgbaBytes;
+		totalBC4 += bc4Bytes;
+		totalSDF += field.GetSize();
+	}
+	if (totalSDF > 0)
+	{
+		printf("\nAll masks: %.1f KB as %lldx%lld fields, %.0fx smaller than RGBA8 and %.0fx smaller than BC4\n", totalSDF * KB, size, size,
+			static_cast<double>(totalRGBA) / totalSDF, static_cast<double>(totalBC4) / totalSDF);
+	}
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,200 @@
+//--------------------------------------------------------------------------------------
+// Simulation of texture mip streaming against a mock uploader
+//--------------------------------------------------------------------------------------
+// Drives CTextureStreamer through a series of frames without a device. A row of models, each
+// with its own RGBA8 texture of 256-4096 pixels, stands along a path. The camera flies half way
+// down the path over the first three quarters of the frames and then stops, and each frame every
+// model in front of it asks for its texture at the size it covers on screen. Every so often a
+// texture is removed and added again at its tail, as when the memory budget evicts it and it is
+// reloaded.
+// The scheduler's invariants are checked every frame: mips are uploaded finest-next in order,
+// each frame keeps to the byte budget, the blurriest waiting texture is served first and the
+// stats match the mock's own bookkeeping. Once the camera stops every requested mip must become
+// resident.
+
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Utility/CTextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+	//Stands in for CResourceManager - records what the streamer asks of it
+	class MockUploader : public IMipUploader
+	{
+	public:
+		std::vector<uint32_t> residentMip;
+		uint32_t              firstKey = 0; // Texture of the first upload since the last reset
+		uint32_t              uploads = 0;
+		bool                  error = false;
+
+		bool UploadMip(uint32_t key, uint32_t mip) override
+		{
+			if (mip + 1 != residentMip[key])
+			{
+				printf("Uploaded mip %u of texture %u which has mip %u resident\n", mip, key, residentMip[key]);
+				error = true;
+			}
+			if (uploads++ == 0) firstKey = key;
+			residentMip[key] = mip;
+			return true;
+		}
+	};
+
+	const double MB = 1.0 / (1024.0 * 1024.0);
+}
+
+int RunStreamingSimulation(const CommandArgs& args)
+{
+	const int      textureCount = static_cast<int>(GetOption(args, "--textures", 32LL));
+	const int      frames       = static_cast<int>(GetOption(args, "--frames", 2000LL));
+	const uint64_t budgetBytes  = static_cast<uint64_t>(GetOption(args, "--budget-kb", 4096LL)) * 1024;
+	const int      evictEvery   = static_cast<int>(GetOption(args, "--evict-every", 97LL));
+
+	if (textureCount < 1 || frames < 4 || budgetBytes == 0)
+	{
+		printf("--textures and --budget-kb must be at least 1 and --frames at least 4\n");
+		return 1;
+	}
+
+	MockUploader uploader;
+	CTextureStreamer streamer(&uploader);
+
+	//Square textures of 256-4096 pixels with full mip chains, one per model. Models are spread 10 units apart
+	//along the path, a little to either side of it
+	std::mt19937 random(1234);
+	std::vector<uint32_t> sizes(textureCount);
+	std::vector<std::vector<uint64_t>> mipBytes(textureCount);
+	std::vector<float> offsets(textureCount);
+	std::vector<CTextureStreamer::EntryId> entries(textureCount);
+	uploader.residentMip.resize(textureCount);
+
+	auto addTexture = [&](int i)
+	{
+		uint32_t mipCount = static_cast<uint32_t>(mipBytes[i].size());
+		uint32_t tail = CTextureStreamer::GetTailMip(sizes[i], sizes[i], mipCount);
+		uploader.residentMip[i] = tail;
+		entries[i] = streamer.Add(static_cast<uint32_t>(i), sizes[i], sizes[i], mipBytes[i], tail);
+	};
+	for (int i = 0; i < textureCount; ++i)
+	{
+		sizes[i] = 256u << (random() % 5);
+		for (uint32_t size = sizes[i]; ; size /= 2)
+		{
+			mipBytes[i].push_back(static_cast<uint64_t>(size) * size * 4);
+			if (size == 1) break;
+		}
+		offsets[i] = static_cast<float>(static_cast<int>(random() % 21) - 10);
+		addTexture(i);
+	}
+
+	//Camera with a 60 degree field of view on a 1280 pixel wide viewport, looking down the path. Models are 5 units across
+	const float pixelsPerUnitAtOne = 1280.0f / (2.0f * std::tan(0.5236f));
+	const float modelSize = 5.0f;
+	const float stopZ = textureCount * 5.0f;
+	const int   stopFrame = frames * 3 / 4;
+
+	uint64_t uploadedBefore = 0;
+	int settledFrame = -1;
+	std::vector<float> screenPixels(textureCount);
+	double seconds = MeasureSeconds([&]()
+	{
+		for (int frame = 0; frame < frames && !uploader.error; ++frame)
+		{
+			//A texture is evicted and reloaded now and then
+			if (evictEvery > 0 && frame > 0 && frame % evictEvery == 0)
+			{
+				int evicted = (frame / evictEvery) % textureCount;
+				streamer.Remove(entries[evicted]);
+				addTexture(evicted);
+			}
+
+			//Each model asks for its texture at its projected size. Models behind the camera are not drawn
+			float cameraZ = (stopZ + 20.0f) * std::min(frame, stopFrame) / stopFrame - 20.0f;
+			for (int i = 0; i < textureCount; ++i)
+			{
+				float alongPath = i * 10.0f - cameraZ;
+				float distance = std::sqrt(alongPath * alongPath + offsets[i] * offsets[i]);
+				screenPixels[i] = alongPath > 0 ? modelSize * pixelsPerUnitAtOne / std::max(distance, modelSize) : 0.0f;
+				if (screenPixels[i] > 0) streamer.Request(entries[i], screenPixels[i]);
+			}
+
+			std::vector<uint32_t> residentBefore(uploader.residentMip);
+			uploader.uploads = 0;
+			streamer.Update(budgetBytes);
+			const TextureStreamingStats& stats = streamer.GetStats();
+
+			//Check the scheduler: the frame keeps to the budget unless it uploaded a single larger mip, ...
+			if (stats.frameBytes > budgetBytes && stats.frameUploads > 1)
+			{
+				printf("Frame %d: uploaded %.2f MB in %u mips, over the %.2f MB budget\n", frame, stats.frameBytes * MB,
+					stats.frameUploads, budgetBytes * MB);
+				uploader.error = true;
+			}
+
+			//... the first texture served is the blurriest of those waiting, ...
+			if (uploader.uploads > 0)
+			{
+				auto blurriness = [&](int i) { return screenPixels[i] / static_cast<float>(std::max(sizes[i] >> residentBefore[i], 1u)); };
+				for (int i = 0; i < textureCount; ++i)
+				{
+					bool waiting = streamer.GetRequestedMip(entries[i]) < residentBefore[i];
+					if (waiting && blurriness(i) > blurriness(uploader.firstKey) * 1.0001f)
+					{
+						printf("Frame %d: served texture %u before blurrier texture %d\n", frame, uploader.firstKey, i);
+						uploader.error = true;
+					}
+				}
+			}
+
+			//... and the stats agree with the mock
+			uint32_t residentMips = 0;
+			for (int i = 0; i < textureCount; ++i)
+			{
+				residentMips += static_cast<uint32_t>(mipBytes[i].size()) - uploader.residentMip[i];
+				if (streamer.GetResidentMip(entries[i]) != uploader.residentMip[i])
+				{
+					printf("Frame %d: texture %d has mip %u resident, the streamer thinks %u\n", frame, i,
+						uploader.residentMip[i], streamer.GetResidentMip(entries[i]));
+					uploader.error = true;
+				}
+			}
+			if (residentMips != stats.residentMips || stats.totalBytes - uploadedBefore != stats.frameBytes)
+			{
+				printf("Frame %d: stats show %u mips resident, the mock has %u\n", frame, stats.residentMips, residentMips);
+				uploader.error = true;
+			}
+			uploadedBefore = stats.totalBytes;
+
+			//Once the camera has stopped, the streaming should catch up with what is asked for
+			if (frame >= stopFrame && settledFrame < 0 && stats.waiting == 0) settledFrame = frame;
+			if (frame < stopFrame) settledFrame = -1;
+		}
+	});
+
+	if (!uploader.error && settledFrame < 0)
+	{
+		printf("Still %u textures waiting for mips %d frames after the camera stopped\n", streamer.GetStats().waiting, frames - stopFrame);
+		uploader.error = true;
+	}
+
+	const TextureStreamingStats& stats = streamer.GetStats();
+	uint64_t fullBytes = 0;
+	for (auto& bytes : mipBytes)
+	{
+		for (uint64_t b : bytes) fullBytes += b;
+	}
+	printf("%d textures (%.1f MB with every mip), %d frames, budget %.2f MB per frame\n", textureCount, fullBytes * MB, frames, budgetBytes * MB);
+	printf("  resident       %u of %u requested mips, %.1f of %.1f MB\n", stats.residentMips, stats.requestedMips,
+		stats.residentBytes * MB, stats.requestedBytes * MB);
+	printf("  uploaded       %u mips, %.1f MB (peak %.2f MB in a frame)\n", stats.totalUploads, stats.totalBytes * MB, stats.peakFrameBytes * MB);
+	if (settledFrame >= 0) printf("  caught up      %d frames after the camera stopped\n", settledFrame - stopFrame);
+	printf("  scheduler time %.3f ms\n", seconds * 1000.0);
+	printf("%s\n", uploader.error ? "FAILED" : "OK");
+	return uploader.error ? 1 : 0;
+}
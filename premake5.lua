@@ -44,7 +44,8 @@ project "PostProcessing"
 		"%{prj.name}/External/GUI/backends/imgui_impl_dx11.cpp",
 		"%{prj.name}/External/GUI/backends/imgui_impl_win32.h",
 		"%{prj.name}/External/GUI/backends/imgui_impl_win32.cpp",
-		"%{prj.name}/Src/Shaders/Common.hlsli"
+		"%{prj.name}/Src/Shaders/Common.hlsli",
+		"%{prj.name}/Src/Shaders/BoxBlur.hlsli"
 
 	}
 
@@ -92,6 +93,108 @@ project "PostProcessing"
 		shadertype("Vertex")
 		shaderoptions({"/WX"})
 
+	filter("files:**_cs.hlsl")
+		shadertype("Compute")
+		shaderoptions({"/WX"})
+
+	filter "system:windows"
+		systemversion "latest"
+
+		defines
+		{
+			"PPE_PLATFORM_WINDOWS",
+		}
+
+	filter "configurations:Debug"
+		defines "PPE_DEBUG"
+		runtime "Debug"
+		symbols "on"
+
+	filter "configurations:Release"
+		defines "PPE_Release"
+		runtime "Release"
+		optimize "on"	
+
+project "AssetTool"
+	location "Tools/AssetTool"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	staticruntime "off"
+
+	targetdir ("bin/" .. outputdir .. "/%{prj.name}")
+	objdir ("bin-int/" .. outputdir .. "/%{prj.name}")
+
+	-- Only the parts of the engine that do not depend on the window or device are shared with the tool
+	files
+	{
+		"Tools/%{prj.name}/Src/**.cpp",
+		"Tools/%{prj.name}/Src/**.h",
+		"PostProcessing/Src/Data/InstanceBatcher.h",
+		"PostProcessing/Src/Data/InstanceBatcher.cpp",
+		"PostProcessing/Src/Utility/CResourceRegistry.h",
+		"PostProcessing/Src/Utility/CResourceBudget.h",
+		"PostProcessing/Src/Utility/CResourceBudget.cpp",
+		"PostProcessing/Src/Utility/CContentHash.h",
+		"PostProcessing/Src/Utility/CContentHash.cpp",
+		"PostProcessing/Src/Utility/CMappedFile.h",
+		"PostProcessing/Src/Utility/CMappedFile.cpp",
+		"PostProcessing/Src/Utility/CAssetPack.h",
+		"PostProcessing/Src/Utility/CAssetPack.cpp",
+		"PostProcessing/Src/Utility/LZCompression.h",
+		"PostProcessing/Src/Utility/LZCompression.cpp",
+		"PostProcessing/Src/Utility/CFileCache.h",
+		"PostProcessing/Src/Utility/CFileCache.cpp",
+		"PostProcessing/Src/Utility/CThreadPool.h",
+		"PostProcessing/Src/Utility/CThreadPool.cpp",
+		"PostProcessing/Src/Utility/CImage.h",
+		"PostProcessing/Src/Utility/CImage.cpp",
+		"PostProcessing/Src/Utility/BCDecompression.h",
+		"PostProcessing/Src/Utility/BCDecompression.cpp",
+		"PostProcessing/Src/Utility/Inflate.h",
+		"PostProcessing/Src/Utility/Inflate.cpp",
+		"PostProcessing/Src/Utility/ImageDecoders.h",
+		"PostProcessing/Src/Utility/ImageDecoders.cpp",
+		"PostProcessing/Src/Utility/DDSDecoder.cpp",
+		"PostProcessing/Src/Utility/PNGDecoder.cpp",
+		"PostProcessing/Src/Utility/JPEGDecoder.cpp",
+		"PostProcessing/Src/Utility/BCCompression.h",
+		"PostProcessing/Src/Utility/BCCompression.cpp",
+		"PostProcessing/Src/Utility/MipGeneration.h",
+		"PostProcessing/Src/Utility/MipGeneration.cpp",
+		"PostProcessing/Src/Utility/ImageEncoders.h",
+		"PostProcessing/Src/Utility/DDSEncoder.cpp",
+		"PostProcessing/Src/Utility/CTextureStreamer.h",
+		"PostProcessing/Src/Utility/CTextureStreamer.cpp",
+		"PostProcessing/Src/Utility/TextureAtlas.h",
+		"PostProcessing/Src/Utility/TextureAtlas.cpp",
+		"PostProcessing/Src/Utility/DistanceField.h",
+		"PostProcessing/Src/Utility/DistanceField.cpp",
+		"PostProcessing/Src/Utility/PixelConversion.h",
+		"PostProcessing/Src/Utility/PixelConversion.cpp",
+		"PostProcessing/Src/Utility/CPUPostProcess.h",
+		"PostProcessing/Src/Utility/CPUPostProcess.cpp",
+		"PostProcessing/Src/Utility/GaussianBlur.h",
+		"PostProcessing/Src/Utility/GaussianBlur.cpp",
+		"PostProcessing/Src/Utility/BlurKernel.h",
+		"PostProcessing/Src/Utility/BlurKernel.cpp",
+		"PostProcessing/Src/Utility/ColourLUT.h",
+		"PostProcessing/Src/Utility/ColourLUT.cpp",
+		"PostProcessing/Src/Utility/Palette.h",
+		"PostProcessing/Src/Utility/Palette.cpp",
+		"PostProcessing/Src/Utility/BlueNoise.h",
+		"PostProcessing/Src/Utility/BlueNoise.cpp",
+		"PostProcessing/Src/Utility/Float4.h",
+		"PostProcessing/Src/project/PostProcessingConstants.h"
+	}
+
+	includedirs
+	{
+		"Tools/%{prj.name}/Src",
+		"PostProcessing/Src",
+		"%{IncludeDir.ImGui}"
+	}
+
 	filter "system:windows"
 		systemversion "latest"
 
@@ -108,4 +211,4 @@ project "PostProcessing"
 	filter "configurations:Release"
 		defines "PPE_Release"
 		runtime "Release"
-		optimize "on"	
\ No newline at end of file
+		optimize "on"